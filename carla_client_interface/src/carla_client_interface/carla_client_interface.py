@@ -19,7 +19,6 @@ import carla
 import rospy
 from agents.navigation.local_planner import RoadOption
 from agents.navigation.global_route_planner_dao import GlobalRoutePlannerDAO
-from agents.navigation.global_route_planner import GlobalRoutePlanner
 from carla_msgs.msg import CarlaWorldInfo
 from carla_waypoint_types.srv import GetActorWaypointResponse, GetActorWaypoint
 from carla_waypoint_types.srv import GetWaypointResponse, GetWaypoint
@@ -28,6 +27,7 @@ from planning_srvs.srv import RoutePlanService, RoutePlanServiceResponse, AgentR
 from tf.transformations import euler_from_quaternion, quaternion_from_euler
 from planning_msgs.msg import Lane
 from route_planner import RandomRoutePlanner
+from route_graph_builder import route_graph_file_name, write_route_graph
 
 WAYPOINT_DISTANCE = 2.0
 
@@ -47,10 +47,22 @@ class ClinetInterface(object):
         self._goal = None
         self._role_name = rospy.get_param("~role_name", 'ego_vehicle')
         self._dao = GlobalRoutePlannerDAO(self._map, sampling_resolution=WAYPOINT_DISTANCE)
-        self._random_route_planner = RandomRoutePlanner(self._dao)
-        self._random_route_planner.setup()
-        self._global_planner = GlobalRoutePlanner(self._dao)
-        self._global_planner.setup()
+        # with a route graph directory the routes are served by the route_graph_server from the route graph file of
+        # the town, which is built here the first time the town is used
+        route_graph_directory = rospy.get_param("~route_graph_directory", "")
+        self._random_route_planner = None
+        if not route_graph_directory:
+            self._random_route_planner = RandomRoutePlanner(self._dao)
+            self._random_route_planner.setup()
+        else:
+            route_graph_file = route_graph_file_name(route_graph_directory, self._map)
+            if not os.path.isfile(route_graph_file):
+                rospy.loginfo("Building the route graph file {} .....".format(route_graph_file))
+                route_planner = RandomRoutePlanner(self._dao)
+                route_planner.setup()
+                write_route_graph(route_planner, self._map, route_graph_file, self.set_lane_type,
+                                  self.set_lane_change_type)
+            rospy.loginfo("Routes are served from the route graph file {}".format(route_graph_file))
 
         self._getWaypointService = rospy.Service(
             '/carla_waypoint_publisher/{}/get_waypoint'.format(self._role_name),
@@ -58,8 +70,10 @@ class ClinetInterface(object):
         self._getActorWaypointService = rospy.Service(
             '/carla_waypoint_publisher/{}/get_actor_waypoint'.format(self._role_name),
             GetActorWaypoint, self._get_actor_waypoint)
-        self._getRouteService = rospy.Service('/carla_client_interface/{}/get_route'.format(self._role_name),
-                                              RoutePlanService, self._get_route)
+        self._getRouteService = None
+        if self._random_route_planner is not None:
+            self._getRouteService = rospy.Service('/carla_client_interface/{}/get_route'.format(self._role_name),
+                                                  RoutePlanService, self._get_route)
         # self._getAgentPotentialRoutesService = rospy.Service(
         #     '/carla_client_interface/{}/agent_potential_routes'.format(self._role_name),
         #     RoutePlanService, self._get_agent_potential_route_service)
@@ -189,15 +203,9 @@ class ClinetInterface(object):
             waypoint.lane_width = wp[0].lane_width
             waypoint.lane_type.type = self.set_lane_type(wp[0])
 
-            lane_change_type = wp[0].lane_change
-            if lane_change_type == carla.LaneChange.NONE:
-                waypoint.lane_change.type = LaneChangeType.FORWARD
-            elif lane_change_type == carla.LaneChange.Both:
-                waypoint.lane_change.type = LaneChangeType.BOTH
-            elif lane_change_type == carla.LaneChange.Left:
-                waypoint.lane_change.type = LaneChangeType.LEFT
-            elif lane_change_type == carla.LaneChange.Right:
-                waypoint.lane_change.type = LaneChangeType.RIGHT
+            lane_change_type = self.set_lane_change_type(wp[0])
+            if lane_change_type is not None:
+                waypoint.lane_change.type = lane_change_type
 
             waypoint.road_option.option = self.set_road_option(wp)
             if waypoint.is_junction:
@@ -464,6 +472,18 @@ class ClinetInterface(object):
 
         return waypoint_road_option
 
+    def set_lane_change_type(self, wp):
+        lane_change_type = wp.lane_change
+        if lane_change_type == carla.LaneChange.NONE:
+            return LaneChangeType.FORWARD
+        elif lane_change_type == carla.LaneChange.Both:
+            return LaneChangeType.BOTH
+        elif lane_change_type == carla.LaneChange.Left:
+            return LaneChangeType.LEFT
+        elif lane_change_type == carla.LaneChange.Right:
+            return LaneChangeType.RIGHT
+        return None
+
     def set_lane_type(self, wp):
         lane_type = wp.lane_type
         waypoint_lane_type = LaneType()
@@ -0,0 +1,125 @@
+"""
+Writes the topology a RandomRoutePlanner built into the route graph file the route_graph_server memory maps.
+The layout mirrors route_graph/include/route_graph/route_graph_file.hpp, change both together.
+"""
+import os
+import struct
+
+from agents.navigation.local_planner import RoadOption
+
+ROUTE_GRAPH_MAGIC = 0x4850415247455452
+ROUTE_GRAPH_VERSION = 1
+ROUTE_GRAPH_EXTENSION = '.rgraph'
+
+HEADER_FORMAT = '<QIIIIIId5Q'
+NODE_FORMAT = '<3d'
+EDGE_FORMAT = '<4Id9db2B5x'
+WAYPOINT_FORMAT = '<14d4iI5B7x'
+SPAWN_POINT_FORMAT = '<4d'
+
+
+def route_graph_file_name(directory, carla_map):
+    """
+    the route graph file of the town, the map name is Town05 or Carla/Maps/Town05 depending on the carla version
+    """
+    return os.path.join(directory, carla_map.name.split('/')[-1] + ROUTE_GRAPH_EXTENSION)
+
+
+def _aligned(offset):
+    return (offset + 7) // 8 * 8
+
+
+def _pack_waypoint(waypoint, edge_index, lane_type_of, lane_change_of):
+    location = waypoint.transform.location
+    left_lane = waypoint.get_left_lane()
+    right_lane = waypoint.get_right_lane()
+    junction_location = (0.0, 0.0, 0.0)
+    junction_extent = (0.0, 0.0, 0.0)
+    junction_id = -1
+    if waypoint.is_junction:
+        junction = waypoint.get_junction()
+        junction_id = junction.id
+        box = junction.bounding_box
+        junction_location = (box.location.x, box.location.y, box.location.z)
+        junction_extent = (box.extent.x, box.extent.y, box.extent.z)
+    lane_type = lane_type_of(waypoint)
+    lane_change = lane_change_of(waypoint)
+    return struct.pack(
+        WAYPOINT_FORMAT,
+        location.x, location.y, location.z, waypoint.transform.rotation.yaw,
+        waypoint.s, waypoint.lane_width,
+        left_lane.lane_width if left_lane is not None else -1.0,
+        right_lane.lane_width if right_lane is not None else -1.0,
+        junction_location[0], junction_location[1], junction_location[2],
+        junction_extent[0], junction_extent[1], junction_extent[2],
+        waypoint.road_id, waypoint.section_id, waypoint.lane_id, junction_id,
+        edge_index,
+        waypoint.is_junction, left_lane is not None, right_lane is not None,
+        lane_change if isinstance(lane_change, int) else 0,
+        lane_type if isinstance(lane_type, int) else 0)
+
+
+def write_route_graph(planner, carla_map, file_name, lane_type_of, lane_change_of):
+    """
+    Write the graph of planner into file_name, through a temporary file so a reader never maps a partial file.
+    planner         :   a RandomRoutePlanner after setup()
+    lane_type_of    :   the planning_msgs LaneType of a carla.Waypoint
+    lane_change_of  :   the planning_msgs LaneChangeType of a carla.Waypoint
+    """
+    graph = planner._graph
+    # the loose ends have negative node ids
+    node_ids = sorted(graph.nodes())
+    index_of = dict((node, index) for index, node in enumerate(node_ids))
+
+    nodes = b''.join(struct.pack(NODE_FORMAT, *graph.nodes[node]['vertex']) for node in node_ids)
+    edge_offsets = [0]
+    edges = []
+    waypoints = []
+    for node in node_ids:
+        for neighbor in sorted(graph.successors(node), key=index_of.get):
+            edge = graph.edges[node, neighbor]
+            # the lane change links have no path to follow, trace_route only follows the lane follow edges
+            if edge['type'] != RoadOption.LANEFOLLOW:
+                continue
+            edge_index = len(edges)
+            path = [edge['entry_waypoint']] + edge['path'] + [edge['exit_waypoint']]
+            first_waypoint = len(waypoints)
+            for waypoint in path:
+                waypoints.append(_pack_waypoint(waypoint, edge_index, lane_type_of, lane_change_of))
+            has_vectors = edge['net_vector'] is not None
+            vectors = []
+            for name in ('entry_vector', 'exit_vector', 'net_vector'):
+                vectors.extend(edge[name] if has_vectors else (0.0, 0.0, 0.0))
+            edges.append(struct.pack(
+                EDGE_FORMAT, index_of[node], index_of[neighbor], first_waypoint, len(path), float(edge['length']),
+                *(list(map(float, vectors)) + [int(RoadOption.LANEFOLLOW.value), edge['intersection'], has_vectors])))
+        edge_offsets.append(len(edges))
+
+    spawn_points = b''.join(
+        struct.pack(SPAWN_POINT_FORMAT, transform.location.x, transform.location.y, transform.location.z,
+                    transform.rotation.yaw)
+        for transform in carla_map.get_spawn_points())
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    nodes_offset = _aligned(header_size)
+    edge_offsets_offset = _aligned(nodes_offset + len(nodes))
+    edges_offset = _aligned(edge_offsets_offset + 4 * len(edge_offsets))
+    waypoints_offset = _aligned(edges_offset + struct.calcsize(EDGE_FORMAT) * len(edges))
+    spawn_points_offset = _aligned(waypoints_offset + struct.calcsize(WAYPOINT_FORMAT) * len(waypoints))
+    header = struct.pack(HEADER_FORMAT, ROUTE_GRAPH_MAGIC, ROUTE_GRAPH_VERSION, len(node_ids), len(edges),
+                         len(waypoints), len(spawn_points) // struct.calcsize(SPAWN_POINT_FORMAT), 0,
+                         planner._dao.get_resolution(), nodes_offset, edge_offsets_offset, edges_offset,
+                         waypoints_offset, spawn_points_offset)
+
+    directory = os.path.dirname(file_name)
+    if directory and not os.path.isdir(directory):
+        os.makedirs(directory)
+    temporary_file_name = file_name + '.tmp'
+    with open(temporary_file_name, 'wb') as route_graph_file:
+        for offset, section in ((0, header), (nodes_offset, nodes),
+                                (edge_offsets_offset, struct.pack('<%dI' % len(edge_offsets), *edge_offsets)),
+                                (edges_offset, b''.join(edges)), (waypoints_offset, b''.join(waypoints)),
+                                (spawn_points_offset, spawn_points)):
+            route_graph_file.write(b'\0' * (offset - route_graph_file.tell()))
+            route_graph_file.write(section)
+    os.rename(temporary_file_name, file_name)
@@ -2,11 +2,15 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_LOCAL_PLANNER_INCLUDE_COLLISION_CHECKER_COLLISION_CHECKER_HPP_
 #include "reference_line/reference_line.hpp"
 #include "ros/ros.h"
+#include <atomic>
 #include "polygon/box2d.hpp"
+#include "polygon/box_batch.hpp"
+#include "polygon/polygon2d.hpp"
 #include <planning_msgs/Trajectory.h>
 #include "obstacle_manager/st_graph.hpp"
 #include "thread_pool/thread_pool.hpp"
 #include "obstacle_manager/obstacle.hpp"
+#include "obstacle_manager/predicted_footprint_table.hpp"
 #include "vehicle_state/vehicle_params.hpp"
 
 namespace planning {
@@ -17,7 +21,7 @@ class CollisionChecker {
 
   /**
    * @param obstacles: the nearby obstacles, which refers to vehicles, walkers and etc.
-   * @param ref_line: the reference line
+   * @param ref_line: the reference line, shared with the other components planning on it
    * @param ptr_st_graph: the st graph to check
    * @param ego_vehicle_s: ego vehicle stational state
    * @param ego_vehicle_d: ego vehicle lateral state
@@ -29,7 +33,7 @@ class CollisionChecker {
    * @param thread_pool: the thread pool, to accelerate the calculation
    */
   CollisionChecker(const std::unordered_map<int, std::shared_ptr<Obstacle>> &obstacles,
-                   const ReferenceLine &ref_line,
+                   std::shared_ptr<const ReferenceLine> ref_line,
                    std::shared_ptr<STGraph> ptr_st_graph,
                    double ego_vehicle_s,
                    double ego_vehicle_d,
@@ -39,6 +43,39 @@ class CollisionChecker {
                    double delta_t,
                    const vehicle_state::VehicleParams &vehicle_params,
                    common::ThreadPool *thread_pool);
+
+  /**
+   * @param footprint_table: the predicted footprints shared in the planning cycle, on the time grid 0, delta_t, ...
+   * up to lookahead_time
+   * @param inflated_footprint_table: footprint_table inflated by the lon and lat safety buffers
+   * @param ref_line: the reference line, shared with the other components planning on it
+   * @param ptr_st_graph: the st graph to check
+   * @param ego_vehicle_s: ego vehicle stational state
+   * @param ego_vehicle_d: ego vehicle lateral state
+   * @param vehicle_params: ego vehicle's params
+   * @param thread_pool: the thread pool, to accelerate the calculation
+   * @param swept_check_steps: 1 to check the boxes at every time step. n > 1 checks the boxes swept over every
+   * n time steps instead, which is conservative between the steps and needs n times fewer checks
+   * @param polygon_footprints: refine the box hits against the inflated footprints with their corners cut by the
+   * buffers, so the buffers are kept ahead and beside the obstacles but not across their corners. only used with
+   * swept_check_steps 1, the swept check keeps the boxes
+   * @param float_broad_phase: test the box overlaps in float32 relative to the footprints of every slice first, which
+   * doubles the simd width. only the pairs within float_guard_band of touching are decided by the exact double test,
+   * so the result is that of the double test
+   * @param float_guard_band: the margin covering the precision loss of the float32 test
+   */
+  CollisionChecker(std::shared_ptr<const PredictedFootprintTable> footprint_table,
+                   std::shared_ptr<const PredictedFootprintTable> inflated_footprint_table,
+                   std::shared_ptr<const ReferenceLine> ref_line,
+                   std::shared_ptr<STGraph> ptr_st_graph,
+                   double ego_vehicle_s,
+                   double ego_vehicle_d,
+                   const vehicle_state::VehicleParams &vehicle_params,
+                   common::ThreadPool *thread_pool,
+                   size_t swept_check_steps = 1,
+                   bool polygon_footprints = false,
+                   bool float_broad_phase = false,
+                   double float_guard_band = 0.01);
   /**
    * @brief: check ego vehicle is collision with obstacles
    * @param: trajectory: ego vehicle's trajectory
@@ -46,6 +83,47 @@ class CollisionChecker {
    */
   bool IsCollision(const planning_msgs::Trajectory &trajectory) const;
 
+  /**
+   * @brief: check the candidate trajectories in ascending cost order. with a thread pool every task checks a
+   * strided share of the candidates, and the candidates behind a lower-cost collision-free one are given up.
+   * @param trajectories: ego vehicle's candidate trajectories, sorted by ascending cost
+   * @return: index of the first collision-free trajectory, trajectories.size() if all of them collide
+   */
+  size_t FirstCollisionFree(const std::vector<planning_msgs::Trajectory> &trajectories) const;
+
+  /**
+   * @brief: check the trajectory against the inflated footprints
+   * @param trajectory: ego vehicle's trajectory
+   * @param index: index of the trajectory among the concurrently checked candidates
+   * @param first_collision_free: index of the first confirmed candidate, the check gives up and reports a
+   * collision once it drops below index. nullptr to always finish the check
+   * @return: true if collision with a certain obstacle, false otherwise
+   */
+  bool IsCollision(const planning_msgs::Trajectory &trajectory, size_t index,
+                   const std::atomic<size_t> *first_collision_free) const;
+
+  /**
+   * @brief: IsCollision on the poses of the trajectory points, without the message
+   * @param poses: x, y and heading of ego vehicle's trajectory points
+   * @param index
+   * @param first_collision_free
+   * @return: true if collision with a certain obstacle, false otherwise
+   */
+  bool IsCollision(const std::vector<Eigen::Vector3d> &poses, size_t index,
+                   const std::atomic<size_t> *first_collision_free) const;
+
+  /**
+   * @brief: the clearance of ego vehicle at every pose, the distance of its box to the nearest inflated footprint
+   * of the time step and 0 on a collision. the footprints are picked by the broad phase of the collision check, the
+   * swept check measures a pose against the swept footprints of its interval and the chamfered footprints are
+   * measured as boxes, which only lowers the clearance
+   * @param poses: x, y and heading of ego vehicle's trajectory points, on the time steps of the footprint table
+   * @param max_clearance: the footprints farther than this are skipped, the clearance is capped at it
+   * @param clearances: [out] the clearance at every pose
+   */
+  void Clearances(const std::vector<Eigen::Vector3d> &poses, double max_clearance,
+                  std::vector<double> *clearances) const;
+
   static bool IsCollision(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
                           const ReferenceLine &ref_line,
                           const planning_msgs::Trajectory &ego_trajectory,
@@ -53,16 +131,90 @@ class CollisionChecker {
                           const double ego_width,
                           const double back_axle_to_center);
 
+  /**
+   * @brief: check ego vehicle is collision with the obstacles of the footprint table, the trajectory points off
+   * the time grid of the table fall back to the predicted obstacle states
+   * @return: true if collision with a certain obstacle, false otherwise
+   */
+  static bool IsCollision(const PredictedFootprintTable &footprint_table,
+                          const planning_msgs::Trajectory &ego_trajectory,
+                          double ego_length,
+                          double ego_width,
+                          double back_axle_to_center);
+
  private:
   /**
-   *
-   * @param obstacles
+   * @brief: the considered footprints of one time step, or of one interval in the swept check, sorted by the min x
+   * of their bounding boxes. the broad phase only runs the exact overlap check on the footprints whose x range
+   * meets the ego box
+   */
+  struct FootprintSlice {
+    std::vector<double> min_xs;
+    std::vector<common::Box2d> footprints;
+    // the footprints in the same order, tested against the ego box in one batch
+    common::BoxBatch boxes;
+    // the chamfered footprints in the order of footprints, empty if the boxes are final
+    std::vector<common::Polygon2d> polygons;
+    // the widest x range of the footprints, bounds how far left of the ego box a candidate can start
+    double max_range_x = 0.0;
+    // the footprints in float32 relative to origin, in the order of footprints, empty without the float broad phase
+    double origin_x = 0.0;
+    double origin_y = 0.0;
+    std::vector<float> center_xs;
+    std::vector<float> center_ys;
+    std::vector<float> cos_headings;
+    std::vector<float> sin_headings;
+    std::vector<float> half_lengths;
+    std::vector<float> half_widths;
+  };
+
+  static FootprintSlice BuildSlice(std::vector<common::Box2d> footprints);
+
+  /**
+   * @brief: fill the float32 footprints of slice, relative to the center of its first footprint
+   */
+  static void BuildFloatFootprints(FootprintSlice *slice);
+
+  /**
+   * @brief: the separation of ego_box from the footprints [first, last) of slice in float32, the largest gap
+   * between their projections on the axes of both boxes. the boxes overlap if it is not positive. the loop runs
+   * over the float arrays of the slice without branches, so the compiler vectorizes it
+   * @param margins: [out] the separations of the footprints first, first + 1, ...
+   */
+  static void SeparationMargins(const FootprintSlice &slice, size_t first, size_t last, const common::Box2d &ego_box,
+                                float *margins);
+
+  /**
+   * @brief: a box covering a box of length and width at every pose, and at every pose interpolated in between
+   * @param poses: x, y and heading of the box center
+   * @param length
+   * @param width
+   * @return
+   */
+  static common::Box2d SweptBox(const std::vector<Eigen::Vector3d> &poses, double length, double width);
+
+  /**
+   * @brief: the range [first, last) of slice whose footprints may come within margin of ego_box in x direction
+   */
+  static std::pair<size_t, size_t> GetCandidateRange(const FootprintSlice &slice, const common::Box2d &ego_box,
+                                                     double margin = 0.0);
+
+  /**
+   * @brief: check ego vehicle against every considered footprint without the broad phase, the reference result
+   * @param trajectory: ego vehicle's trajectory
+   * @param footprint_table: the footprints to check
+   * @return: true if collision with a certain obstacle, false otherwise
+   */
+  bool IsCollisionExhaustive(const planning_msgs::Trajectory &trajectory,
+                             const PredictedFootprintTable &footprint_table) const;
+
+  /**
+   * @brief: select the obstacles of the footprint table to check
    * @param ego_vehicle_s
    * @param ego_vehicle_d
    * @param reference_line
    */
-  void Init(const std::unordered_map<int, std::shared_ptr<planning::Obstacle>> &obstacles, double ego_vehicle_s,
-            double ego_vehicle_d, const ReferenceLine &reference_line);
+  void Init(double ego_vehicle_s, double ego_vehicle_d, const ReferenceLine &reference_line);
 
   /**
    *
@@ -82,16 +234,20 @@ class CollisionChecker {
                                          const ReferenceLine &ref_line);
 
  private:
-  ReferenceLine ref_line_;
+  std::shared_ptr<const ReferenceLine> ref_line_;
   std::shared_ptr<STGraph> ptr_st_graph_;
-  std::vector<std::vector<common::Box2d>> predicted_obstacle_box_;
+  std::shared_ptr<const PredictedFootprintTable> footprint_table_;
+  std::shared_ptr<const PredictedFootprintTable> inflated_footprint_table_;
+  // indices into the footprint tables of the obstacles to check
+  std::vector<size_t> considered_obstacles_;
+  // broad phase slices over inflated_footprint_table_, per time step or per swept interval
+  std::vector<FootprintSlice> inflated_footprint_slices_;
   common::ThreadPool *thread_pool_ = nullptr;
   vehicle_state::VehicleParams vehicle_params_{};
-  double lon_buffer_{};
-  double lat_buffer_{};
-  double lookahead_time_{};
-  double delta_t_{};
-
+  size_t swept_check_steps_ = 1;
+  bool polygon_footprints_ = false;
+  bool float_broad_phase_ = false;
+  float float_guard_band_ = 0.01f;
 };
 
 }
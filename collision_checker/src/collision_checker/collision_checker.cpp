@@ -1,13 +1,30 @@
 #include "collision_checker/collision_checker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <tuple>
 #include <utility>
+#include "math/math_utils.hpp"
 
 #define DEBUG false
 
 namespace planning {
 using namespace vehicle_state;
 using namespace common;
+namespace {
+std::vector<std::shared_ptr<Obstacle>> ToObstacleVector(
+    const std::unordered_map<int, std::shared_ptr<Obstacle>> &obstacles) {
+  std::vector<std::shared_ptr<Obstacle>> obstacle_vec;
+  obstacle_vec.reserve(obstacles.size());
+  for (const auto &obstacle : obstacles) {
+    obstacle_vec.push_back(obstacle.second);
+  }
+  return obstacle_vec;
+}
+}
+
 CollisionChecker::CollisionChecker(const std::unordered_map<int, std::shared_ptr<Obstacle>> &obstacles,
-                                   const ReferenceLine &ref_line,
+                                   std::shared_ptr<const ReferenceLine> ref_line,
                                    std::shared_ptr<STGraph> ptr_st_graph,
                                    double ego_vehicle_s,
                                    double ego_vehicle_d,
@@ -17,35 +34,55 @@ CollisionChecker::CollisionChecker(const std::unordered_map<int, std::shared_ptr
                                    double delta_t,
                                    const VehicleParams &vehicle_params,
                                    ThreadPool *thread_pool)
-    : ref_line_(ref_line),
+    : ref_line_(std::move(ref_line)),
       ptr_st_graph_(std::move(ptr_st_graph)),
+      footprint_table_(std::make_shared<PredictedFootprintTable>(ToObstacleVector(obstacles), 0.0,
+                                                                 lookahead_time + delta_t, delta_t,
+                                                                 thread_pool)),
+      inflated_footprint_table_(footprint_table_->Inflate(lon_buffer, lat_buffer)),
       thread_pool_(thread_pool),
-      lon_buffer_(lon_buffer),
-      lat_buffer_(lat_buffer),
-      lookahead_time_(lookahead_time),
-      delta_t_(delta_t) {
-  predicted_obstacle_box_.clear();
-  this->Init(obstacles, ego_vehicle_s, ego_vehicle_d, ref_line_);
+      vehicle_params_(vehicle_params) {
+  this->Init(ego_vehicle_s, ego_vehicle_d, *ref_line_);
   std::cout << " ---------lon buffer: " << lon_buffer << ", lat_buffer : " << lat_buffer << std::endl;
 }
 
-bool CollisionChecker::IsCollision(const planning_msgs::Trajectory &trajectory) const {
-  double ego_width = vehicle_params_.width;
-  double ego_length = vehicle_params_.length;
-  double shift_distance = vehicle_params_.back_axle_to_center_length;
+CollisionChecker::CollisionChecker(std::shared_ptr<const PredictedFootprintTable> footprint_table,
+                                   std::shared_ptr<const PredictedFootprintTable> inflated_footprint_table,
+                                   std::shared_ptr<const ReferenceLine> ref_line,
+                                   std::shared_ptr<STGraph> ptr_st_graph,
+                                   double ego_vehicle_s,
+                                   double ego_vehicle_d,
+                                   const VehicleParams &vehicle_params,
+                                   ThreadPool *thread_pool,
+                                   size_t swept_check_steps,
+                                   bool polygon_footprints,
+                                   bool float_broad_phase,
+                                   double float_guard_band)
+    : ref_line_(std::move(ref_line)),
+      ptr_st_graph_(std::move(ptr_st_graph)),
+      footprint_table_(std::move(footprint_table)),
+      inflated_footprint_table_(std::move(inflated_footprint_table)),
+      thread_pool_(thread_pool),
+      vehicle_params_(vehicle_params),
+      swept_check_steps_(std::max<size_t>(swept_check_steps, 1)),
+      polygon_footprints_(polygon_footprints && swept_check_steps_ == 1),
+      float_broad_phase_(float_broad_phase),
+      float_guard_band_(static_cast<float>(std::max(float_guard_band, 0.0))) {
+  ROS_ASSERT(footprint_table_->NumOfObstacles() == inflated_footprint_table_->NumOfObstacles());
+  ROS_ASSERT(footprint_table_->NumOfSteps() == inflated_footprint_table_->NumOfSteps());
+  this->Init(ego_vehicle_s, ego_vehicle_d, *ref_line_);
+}
 
-  assert(trajectory.trajectory_points.size() <= predicted_obstacle_box_.size());
+bool CollisionChecker::IsCollision(const planning_msgs::Trajectory &trajectory) const {
 #if DEBUG
   std::cout << "bounding boxs for obstacle" << std::endl;
-  for (size_t i = 0; i < predicted_obstacle_box_.size(); ++i) {
-    if (!predicted_obstacle_box_[i].empty()) {
-      std::cout << "i " << i << " len: " << predicted_obstacle_box_[i].front().length() << ", width: "
-                << predicted_obstacle_box_[i].front().width()
-                << " heading: " << predicted_obstacle_box_[i].front().heading()
-                << " center_x : " << predicted_obstacle_box_[i].front().center_x()
-                << " center_y : " << predicted_obstacle_box_[i].front().center_y()
-                << std::endl;
-    }
+  for (const auto index : considered_obstacles_) {
+    const auto &footprint = footprint_table_->Footprint(index, 0);
+    std::cout << "i " << index << " len: " << footprint.length() << ", width: " << footprint.width()
+              << " heading: " << footprint.heading()
+              << " center_x : " << footprint.center_x()
+              << " center_y : " << footprint.center_y()
+              << std::endl;
   }
   std::cout << " to check trajectory is " << std::endl;
   for (const auto &trajectory_point : trajectory.trajectory_points) {
@@ -56,84 +93,380 @@ bool CollisionChecker::IsCollision(const planning_msgs::Trajectory &trajectory)
   }
 
 
-  std::cout << "=====predicted_obstacle_box_ size ===== " << predicted_obstacle_box_.size() << std::endl;
+  std::cout << "=====footprint table steps ===== " << footprint_table_->NumOfSteps() << std::endl;
 #endif
-  if (this->thread_pool_ == nullptr) {
-    for (size_t i = 0; i < trajectory.trajectory_points.size(); ++i) {
-      auto traj_point = trajectory.trajectory_points.at(i);
-      double ego_theta = traj_point.path_point.theta;
-      Box2d ego_box = Box2d({traj_point.path_point.x, traj_point.path_point.y}, ego_theta, ego_length, ego_width);
-      ego_box.Shift({shift_distance * std::cos(ego_theta), shift_distance * std::sin(ego_theta)});
+  const bool is_collision = IsCollision(trajectory, 0, nullptr);
 #if DEBUG
-      std::cout << " obstacle box at index  " << i << " size is :" << predicted_obstacle_box_[i].size() << std::endl;
-      std::cout << "relative trajectory point: x: " << traj_point.path_point.x << ", y: " << traj_point.path_point.y
-                << ", theta: " << traj_point.path_point.theta << std::endl;
+  // the swept check may only report more collisions than the sampled one, the polygon check only fewer
+  if (is_collision != IsCollisionExhaustive(trajectory, *inflated_footprint_table_)
+      && (is_collision ? swept_check_steps_ == 1 : !polygon_footprints_)) {
+    ROS_ERROR("[CollisionChecker::IsCollision], the broad phase disagrees with the exhaustive check");
+  }
 #endif
-      for (auto obstacle_box : predicted_obstacle_box_[i]) {
-        obstacle_box.LateralExtend(2.0 * lat_buffer_);
-        obstacle_box.LongitudinalExtend(2.0 * lon_buffer_);
+  return is_collision;
+}
+
+size_t CollisionChecker::FirstCollisionFree(const std::vector<planning_msgs::Trajectory> &trajectories) const {
+  const size_t num_trajectories = trajectories.size();
+  if (thread_pool_ == nullptr || num_trajectories < 2) {
+    for (size_t i = 0; i < num_trajectories; ++i) {
+      if (!IsCollision(trajectories[i])) {
+        return i;
+      }
+    }
+    return num_trajectories;
+  }
+  // task k checks the candidates k, k + num_tasks, ..., so the low-cost candidates are checked first
+  const size_t num_tasks = std::min(static_cast<size_t>(thread_pool_->Size()), num_trajectories);
+  std::atomic<size_t> first_collision_free(num_trajectories);
+  thread_pool_->ParallelFor(0, num_tasks, 1, [&](size_t k) {
+    for (size_t i = k; i < num_trajectories; i += num_tasks) {
+      if (first_collision_free.load(std::memory_order_relaxed) < i) {
+        return;
+      }
+      if (IsCollision(trajectories[i], i, &first_collision_free)) {
+        continue;
+      }
+      size_t current = first_collision_free.load(std::memory_order_relaxed);
+      while (i < current && !first_collision_free.compare_exchange_weak(current, i)) {}
+      return;
+    }
+  });
+  return first_collision_free.load();
+}
+
+bool CollisionChecker::IsCollision(const planning_msgs::Trajectory &trajectory,
+                                   size_t index,
+                                   const std::atomic<size_t> *first_collision_free) const {
+  std::vector<Eigen::Vector3d> poses;
+  poses.reserve(trajectory.trajectory_points.size());
+  for (const auto &trajectory_point : trajectory.trajectory_points) {
+    poses.emplace_back(trajectory_point.path_point.x, trajectory_point.path_point.y,
+                       trajectory_point.path_point.theta);
+  }
+  return IsCollision(poses, index, first_collision_free);
+}
 
+bool CollisionChecker::IsCollision(const std::vector<Eigen::Vector3d> &poses,
+                                   size_t index,
+                                   const std::atomic<size_t> *first_collision_free) const {
+  const double ego_width = vehicle_params_.width;
+  const double ego_length = vehicle_params_.length;
+  const double shift_distance = vehicle_params_.back_axle_to_center_length;
+  assert(poses.size() <= inflated_footprint_table_->NumOfSteps());
+  std::vector<float> margins;
+  std::vector<uint8_t> overlaps;
+  const auto has_overlap = [this, &margins, &overlaps](const FootprintSlice &slice, const Box2d &ego_box) -> bool {
+    const auto candidate_range = GetCandidateRange(slice, ego_box);
+    if (!float_broad_phase_ && slice.polygons.empty()) {
+      return OverlapAny(ego_box, slice.boxes, candidate_range.first, candidate_range.second);
+    }
+    if (float_broad_phase_) {
+      margins.resize(candidate_range.second - candidate_range.first);
+      SeparationMargins(slice, candidate_range.first, candidate_range.second, ego_box, margins.data());
+    } else {
+      overlaps.resize(candidate_range.second - candidate_range.first);
+      OverlapMask(ego_box, slice.boxes, candidate_range.first, candidate_range.second, overlaps.data());
+    }
+    for (size_t k = candidate_range.first; k < candidate_range.second; ++k) {
+      const auto &obstacle_box = slice.footprints[k];
 #if DEBUG
-        std::cout << " obstacle_box: center: x: " << obstacle_box.center_x() << ", y: " << obstacle_box.center_y()
-                  << ", theta: " << obstacle_box.heading() << ", length: " << obstacle_box.length() << ", width: "
-                  << obstacle_box.width() << std::endl;
+      std::cout << " obstacle_box: center: x: " << obstacle_box.center_x() << ", y: " << obstacle_box.center_y()
+                << ", theta: " << obstacle_box.heading() << ", length: " << obstacle_box.length() << ", width: "
+                << obstacle_box.width() << std::endl;
 #endif
-
-        if (ego_box.HasOverlapWithBox2d(obstacle_box)) {
-          return true;
-        }
+      if (!float_broad_phase_ && overlaps[k - candidate_range.first] == 0) {
+        continue;
+      }
+      // the float32 test decides unless the boxes are within the guard band of touching
+      const float margin = float_broad_phase_ ? margins[k - candidate_range.first] : 0.0f;
+      if (margin > float_guard_band_) {
+        continue;
+      }
+      if (float_broad_phase_ && margin >= -float_guard_band_ && !ego_box.HasOverlapWithBox2d(obstacle_box)) {
+        continue;
+      }
+      // the box is conservative, the chamfered footprint inside it decides
+      if (slice.polygons.empty() || Polygon2d(ego_box).HasOverlapWithPolygon2d(slice.polygons[k])) {
+        return true;
       }
     }
     return false;
-  } else {
-    std::vector<std::future<bool>> futures;
-    for (size_t i = 0; i < trajectory.trajectory_points.size(); ++i) {
-      const auto &traj_point = trajectory.trajectory_points[i];
-      double ego_theta = traj_point.path_point.theta;
-      Box2d ego_box = Box2d({traj_point.path_point.x, traj_point.path_point.y}, ego_theta, ego_length, ego_width);
+  };
+  // a lower-cost candidate is collision-free, the result of this one does not matter anymore
+  const auto is_cancelled = [first_collision_free, index]() -> bool {
+    return first_collision_free != nullptr && first_collision_free->load(std::memory_order_relaxed) < index;
+  };
+
+  if (swept_check_steps_ == 1) {
+    for (size_t i = 0; i < poses.size(); ++i) {
+      if (is_cancelled()) {
+        return true;
+      }
+      const auto &pose = poses[i];
+      double ego_theta = pose.z();
+      Box2d ego_box = Box2d({pose.x(), pose.y()}, ego_theta, ego_length, ego_width);
       ego_box.Shift({shift_distance * std::cos(ego_theta), shift_distance * std::sin(ego_theta)});
-      for (const auto &obstacle_box : predicted_obstacle_box_[i]) {
-        const auto task = [&ego_box, &obstacle_box]() -> bool {
-          return ego_box.HasOverlapWithBox2d(obstacle_box);
-        };
-        futures.emplace_back(thread_pool_->PushTask(task));
+#if DEBUG
+      std::cout << "relative trajectory point: x: " << pose.x() << ", y: " << pose.y()
+                << ", theta: " << pose.z() << std::endl;
+#endif
+      if (has_overlap(inflated_footprint_slices_[i], ego_box)) {
+        return true;
       }
     }
-    for (auto &future : futures) {
-      if (future.get()) {
+    return false;
+  }
+
+  // the swept ego box of the points [start, end] of every interval against the swept footprints of the interval
+  std::vector<Eigen::Vector3d> ego_poses;
+  ego_poses.reserve(swept_check_steps_ + 1);
+  for (size_t interval = 0, start = 0; start < poses.size(); ++interval, start += swept_check_steps_) {
+    if (is_cancelled()) {
+      return true;
+    }
+    const size_t end = std::min(start + swept_check_steps_, poses.size() - 1);
+    ego_poses.clear();
+    for (size_t i = start; i <= end; ++i) {
+      const auto &pose = poses[i];
+      ego_poses.emplace_back(pose.x() + shift_distance * std::cos(pose.z()),
+                             pose.y() + shift_distance * std::sin(pose.z()),
+                             pose.z());
+    }
+    if (has_overlap(inflated_footprint_slices_[interval], SweptBox(ego_poses, ego_length, ego_width))) {
+      return true;
+    }
+    if (end + 1 >= poses.size()) {
+      break;
+    }
+  }
+  return false;
+}
+
+void CollisionChecker::Clearances(const std::vector<Eigen::Vector3d> &poses, double max_clearance,
+                                  std::vector<double> *clearances) const {
+  const double shift_distance = vehicle_params_.back_axle_to_center_length;
+  clearances->assign(poses.size(), max_clearance);
+  for (size_t i = 0; i < poses.size(); ++i) {
+    const auto &pose = poses[i];
+    Box2d ego_box = Box2d({pose.x(), pose.y()}, pose.z(), vehicle_params_.length, vehicle_params_.width);
+    ego_box.Shift({shift_distance * std::cos(pose.z()), shift_distance * std::sin(pose.z())});
+    const size_t slice_index = i / swept_check_steps_;
+    if (slice_index >= inflated_footprint_slices_.size()) {
+      break;
+    }
+    const auto &slice = inflated_footprint_slices_[slice_index];
+    double &clearance = (*clearances)[i];
+    const auto candidate_range = GetCandidateRange(slice, ego_box, max_clearance);
+    for (size_t k = candidate_range.first; k < candidate_range.second && clearance > 0.0; ++k) {
+      const auto &footprint = slice.footprints[k];
+      // the gap between the bounding boxes bounds the distance from below
+      const double gap_x = std::max(footprint.min_x() - ego_box.max_x(), ego_box.min_x() - footprint.max_x());
+      const double gap_y = std::max(footprint.min_y() - ego_box.max_y(), ego_box.min_y() - footprint.max_y());
+      if (gap_x >= clearance || gap_y >= clearance) {
+        continue;
+      }
+      clearance = std::min(clearance, ego_box.DistanceTo(footprint));
+    }
+  }
+}
+
+bool CollisionChecker::IsCollisionExhaustive(const planning_msgs::Trajectory &trajectory,
+                                             const PredictedFootprintTable &footprint_table) const {
+  const double shift_distance = vehicle_params_.back_axle_to_center_length;
+  for (size_t i = 0; i < trajectory.trajectory_points.size(); ++i) {
+    const auto &traj_point = trajectory.trajectory_points[i];
+    double ego_theta = traj_point.path_point.theta;
+    Box2d ego_box = Box2d({traj_point.path_point.x, traj_point.path_point.y}, ego_theta,
+                          vehicle_params_.length, vehicle_params_.width);
+    ego_box.Shift({shift_distance * std::cos(ego_theta), shift_distance * std::sin(ego_theta)});
+    for (const auto index : considered_obstacles_) {
+      if (ego_box.HasOverlapWithBox2d(footprint_table.Footprint(index, i))) {
         return true;
       }
     }
-    return false;
   }
+  return false;
+}
+
+CollisionChecker::FootprintSlice CollisionChecker::BuildSlice(std::vector<Box2d> footprints) {
+  std::sort(footprints.begin(), footprints.end(), [](const Box2d &box0, const Box2d &box1) {
+    return box0.min_x() < box1.min_x();
+  });
+  FootprintSlice slice;
+  slice.min_xs.reserve(footprints.size());
+  for (const auto &footprint : footprints) {
+    slice.min_xs.push_back(footprint.min_x());
+    slice.max_range_x = std::max(slice.max_range_x, footprint.max_x() - footprint.min_x());
+  }
+  slice.boxes = BoxBatch(footprints);
+  slice.footprints = std::move(footprints);
+  return slice;
+}
+
+void CollisionChecker::BuildFloatFootprints(FootprintSlice *slice) {
+  const size_t num_footprints = slice->footprints.size();
+  slice->origin_x = num_footprints > 0 ? slice->footprints.front().center_x() : 0.0;
+  slice->origin_y = num_footprints > 0 ? slice->footprints.front().center_y() : 0.0;
+  for (auto *values : {&slice->center_xs, &slice->center_ys, &slice->cos_headings, &slice->sin_headings,
+                       &slice->half_lengths, &slice->half_widths}) {
+    values->resize(num_footprints);
+  }
+  for (size_t k = 0; k < num_footprints; ++k) {
+    const auto &footprint = slice->footprints[k];
+    slice->center_xs[k] = static_cast<float>(footprint.center_x() - slice->origin_x);
+    slice->center_ys[k] = static_cast<float>(footprint.center_y() - slice->origin_y);
+    slice->cos_headings[k] = static_cast<float>(footprint.cos_heading());
+    slice->sin_headings[k] = static_cast<float>(footprint.sin_heading());
+    slice->half_lengths[k] = static_cast<float>(footprint.half_length());
+    slice->half_widths[k] = static_cast<float>(footprint.half_width());
+  }
+}
+
+void CollisionChecker::SeparationMargins(const FootprintSlice &slice, size_t first, size_t last, const Box2d &ego_box,
+                                         float *margins) {
+  const auto ego_x = static_cast<float>(ego_box.center_x() - slice.origin_x);
+  const auto ego_y = static_cast<float>(ego_box.center_y() - slice.origin_y);
+  const auto ego_cos = static_cast<float>(ego_box.cos_heading());
+  const auto ego_sin = static_cast<float>(ego_box.sin_heading());
+  const auto ego_half_length = static_cast<float>(ego_box.half_length());
+  const auto ego_half_width = static_cast<float>(ego_box.half_width());
+  const float *center_xs = slice.center_xs.data();
+  const float *center_ys = slice.center_ys.data();
+  const float *cos_headings = slice.cos_headings.data();
+  const float *sin_headings = slice.sin_headings.data();
+  const float *half_lengths = slice.half_lengths.data();
+  const float *half_widths = slice.half_widths.data();
+  for (size_t k = first; k < last; ++k) {
+    const float shift_x = center_xs[k] - ego_x;
+    const float shift_y = center_ys[k] - ego_y;
+    // the cos and sin of the heading difference, the projections of the axes of one box onto those of the other
+    const float cos_diff = std::abs(cos_headings[k] * ego_cos + sin_headings[k] * ego_sin);
+    const float sin_diff = std::abs(sin_headings[k] * ego_cos - cos_headings[k] * ego_sin);
+    const float ego_lon_gap = std::abs(shift_x * ego_cos + shift_y * ego_sin)
+        - (half_lengths[k] * cos_diff + half_widths[k] * sin_diff + ego_half_length);
+    const float ego_lat_gap = std::abs(shift_y * ego_cos - shift_x * ego_sin)
+        - (half_lengths[k] * sin_diff + half_widths[k] * cos_diff + ego_half_width);
+    const float lon_gap = std::abs(shift_x * cos_headings[k] + shift_y * sin_headings[k])
+        - (ego_half_length * cos_diff + ego_half_width * sin_diff + half_lengths[k]);
+    const float lat_gap = std::abs(shift_y * cos_headings[k] - shift_x * sin_headings[k])
+        - (ego_half_length * sin_diff + ego_half_width * cos_diff + half_widths[k]);
+    const float ego_gap = ego_lon_gap > ego_lat_gap ? ego_lon_gap : ego_lat_gap;
+    const float gap = lon_gap > lat_gap ? lon_gap : lat_gap;
+    margins[k - first] = ego_gap > gap ? ego_gap : gap;
+  }
+}
+
+Box2d CollisionChecker::SweptBox(const std::vector<Eigen::Vector3d> &poses, double length, double width) {
+  ROS_ASSERT(!poses.empty());
+  // the headings relative to the first one, the range is spanned symmetrically around the mid heading
+  double min_dtheta = 0.0;
+  double max_dtheta = 0.0;
+  for (const auto &pose : poses) {
+    const double dtheta = MathUtils::NormalizeAngle(pose.z() - poses.front().z());
+    min_dtheta = std::min(min_dtheta, dtheta);
+    max_dtheta = std::max(max_dtheta, dtheta);
+  }
+  const double heading = MathUtils::NormalizeAngle(poses.front().z() + 0.5 * (min_dtheta + max_dtheta));
+  const double half_dtheta = 0.5 * (max_dtheta - min_dtheta);
+  // a box rotated by at most half_dtheta around its center stays in these half extents along the mid heading
+  double half_length = 0.5 * length;
+  double half_width = 0.5 * width;
+  if (half_dtheta < M_PI_2) {
+    const double sin_half_dtheta = std::sin(half_dtheta);
+    std::tie(half_length, half_width) = std::make_pair(half_length + half_width * sin_half_dtheta,
+                                                       half_width + half_length * sin_half_dtheta);
+  } else {
+    half_length = half_width = std::hypot(half_length, half_width);
+  }
+  // the centers of the poses and every center in between lie in the range of their projections on the axes
+  const Eigen::Vector2d u(std::cos(heading), std::sin(heading));
+  const Eigen::Vector2d v(-u.y(), u.x());
+  const Eigen::Vector2d origin = poses.front().head<2>();
+  double min_u = 0.0;
+  double max_u = 0.0;
+  double min_v = 0.0;
+  double max_v = 0.0;
+  for (const auto &pose : poses) {
+    const Eigen::Vector2d offset = pose.head<2>() - origin;
+    min_u = std::min(min_u, offset.dot(u));
+    max_u = std::max(max_u, offset.dot(u));
+    min_v = std::min(min_v, offset.dot(v));
+    max_v = std::max(max_v, offset.dot(v));
+  }
+  const Eigen::Vector2d center = origin + 0.5 * (min_u + max_u) * u + 0.5 * (min_v + max_v) * v;
+  return Box2d(center, heading, max_u - min_u + 2.0 * half_length, max_v - min_v + 2.0 * half_width);
+}
+
+std::pair<size_t, size_t> CollisionChecker::GetCandidateRange(const FootprintSlice &slice, const Box2d &ego_box,
+                                                               double margin) {
+  // a footprint meets the ego box in x only if min_x <= ego max_x and min_x + range_x >= ego min_x
+  const auto first = std::lower_bound(slice.min_xs.begin(), slice.min_xs.end(),
+                                      ego_box.min_x() - margin - slice.max_range_x);
+  const auto last = std::upper_bound(first, slice.min_xs.end(), ego_box.max_x() + margin);
+  return {static_cast<size_t>(first - slice.min_xs.begin()), static_cast<size_t>(last - slice.min_xs.begin())};
 }
 
-void CollisionChecker::Init(const std::unordered_map<int, std::shared_ptr<Obstacle>> &obstacles,
-                            double ego_vehicle_s,
+void CollisionChecker::Init(double ego_vehicle_s,
                             double ego_vehicle_d,
                             const ReferenceLine &reference_line) {
 
   bool ego_vehicle_in_lane = IsEgoVehicleInLane(ego_vehicle_s, ego_vehicle_d);
-  std::vector<std::shared_ptr<Obstacle>> obstacle_considered;
-  for (auto &obstacle : obstacles) {
+  considered_obstacles_.clear();
+  for (size_t i = 0; i < footprint_table_->NumOfObstacles(); ++i) {
+    const auto &obstacle = footprint_table_->GetObstacle(i);
     if (ego_vehicle_in_lane &&
-        (IsObstacleBehindEgoVehicle(obstacle.second, ego_vehicle_s, reference_line)
-            || !ptr_st_graph_->IsObstacleInGraph(obstacle.first))) {
+        (IsObstacleBehindEgoVehicle(obstacle, ego_vehicle_s, reference_line)
+            || !ptr_st_graph_->IsObstacleInGraph(obstacle->Id()))) {
       continue;
     }
-    obstacle_considered.push_back(obstacle.second);
+    considered_obstacles_.push_back(i);
   }
-
-  double relative_time = 0.0;
-  while (relative_time < lookahead_time_ + delta_t_) {
-    std::vector<Box2d> predicted_env;
-    for (const auto &obstacle : obstacle_considered) {
-      planning_msgs::TrajectoryPoint point = obstacle->GetPointAtTime(relative_time);
-      Box2d box = obstacle->GetBoundingBoxAtPoint(point);
-      predicted_env.push_back(box);
+  inflated_footprint_slices_.clear();
+  const auto &footprint_table = *inflated_footprint_table_;
+  const size_t num_steps = footprint_table.NumOfSteps();
+  std::vector<Box2d> footprints(considered_obstacles_.size());
+  if (swept_check_steps_ == 1) {
+    inflated_footprint_slices_.reserve(num_steps);
+    for (size_t step = 0; step < num_steps; ++step) {
+      for (size_t k = 0; k < considered_obstacles_.size(); ++k) {
+        footprints[k] = footprint_table.Footprint(considered_obstacles_[k], step);
+      }
+      inflated_footprint_slices_.push_back(BuildSlice(footprints));
+      if (float_broad_phase_) {
+        BuildFloatFootprints(&inflated_footprint_slices_.back());
+      }
+      if (polygon_footprints_) {
+        auto &slice = inflated_footprint_slices_.back();
+        slice.polygons.reserve(slice.footprints.size());
+        for (const auto &footprint : slice.footprints) {
+          slice.polygons.push_back(Polygon2d::ChamferedBox(footprint, footprint_table.LonBuffer(),
+                                                           footprint_table.LatBuffer()));
+        }
+      }
+    }
+    return;
+  }
+  // interval i covers the steps [i * swept_check_steps_, (i + 1) * swept_check_steps_]
+  std::vector<Eigen::Vector3d> poses;
+  for (size_t start = 0; start < num_steps; start += swept_check_steps_) {
+    const size_t end = std::min(start + swept_check_steps_, num_steps - 1);
+    for (size_t k = 0; k < considered_obstacles_.size(); ++k) {
+      poses.clear();
+      for (size_t step = start; step <= end; ++step) {
+        const auto &footprint = footprint_table.Footprint(considered_obstacles_[k], step);
+        poses.emplace_back(footprint.center_x(), footprint.center_y(), footprint.heading());
+      }
+      const auto &footprint = footprint_table.Footprint(considered_obstacles_[k], start);
+      footprints[k] = SweptBox(poses, footprint.length(), footprint.width());
+    }
+    inflated_footprint_slices_.push_back(BuildSlice(footprints));
+    if (float_broad_phase_) {
+      BuildFloatFootprints(&inflated_footprint_slices_.back());
+    }
+    if (end + 1 >= num_steps) {
+      break;
     }
-    predicted_obstacle_box_.push_back(std::move(predicted_env));
-    relative_time += delta_t_;
   }
 }
 
@@ -141,7 +474,7 @@ bool CollisionChecker::IsEgoVehicleInLane(double ego_vehicle_s, double ego_vehic
   constexpr double kDefaultLaneWidth = 3.5;
   double left_width = kDefaultLaneWidth / 2.0;
   double right_width = kDefaultLaneWidth / 2.0;
-  ref_line_.GetLaneWidth(ego_vehicle_s, &left_width, &right_width);
+  ref_line_->GetLaneWidth(ego_vehicle_s, &left_width, &right_width);
   return ego_vehicle_d < left_width && ego_vehicle_d > -right_width;
 }
 
@@ -149,9 +482,9 @@ bool CollisionChecker::IsObstacleBehindEgoVehicle(const std::shared_ptr<Obstacle
                                                   double ego_s,
                                                   const ReferenceLine &ref_line) {
   constexpr double kDefaultLaneWidth = 3.5;
-  planning_msgs::TrajectoryPoint point = obstacle->GetPointAtTime(0.0);
+  const auto state = obstacle->GetStateAtTime(0.0);
   SLPoint sl_point;
-  ref_line.XYToSL(point.path_point.x, point.path_point.y, &sl_point);
+  ref_line.XYToSL(state.x, state.y, &sl_point);
   if (ego_s > sl_point.s && std::fabs(sl_point.l) < kDefaultLaneWidth / 2.0) {
     return true;
   }
@@ -167,8 +500,6 @@ bool CollisionChecker::IsCollision(const std::vector<std::shared_ptr<Obstacle>>
   for (const auto &ego_point : ego_trajectory.trajectory_points) {
     const auto relative_time = ego_point.relative_time;
     const auto ego_theta = ego_point.path_point.theta;
-    common::SLPoint sl_point;
-    ref_line.XYToSL(ego_point.path_point.x, ego_point.path_point.y, &sl_point);
     common::Box2d ego_box({ego_point.path_point.x, ego_point.path_point.y},
                           ego_theta, ego_length, ego_width);
     double shift_distance = back_axle_to_center;
@@ -177,8 +508,7 @@ bool CollisionChecker::IsCollision(const std::vector<std::shared_ptr<Obstacle>>
     ego_box.Shift(shift_vec);
     std::vector<common::Box2d> obstacle_boxes;
     for (const auto &obstacle : obstacles) {
-      auto obstacle_point = obstacle->GetPointAtTime(relative_time);
-      common::Box2d obstacle_box = obstacle->GetBoundingBoxAtPoint(obstacle_point);
+      common::Box2d obstacle_box = obstacle->GetBoundingBoxAtState(obstacle->GetStateAtTime(relative_time));
       if (ego_box.HasOverlapWithBox2d(obstacle_box)) {
         return true;
       }
@@ -186,4 +516,33 @@ bool CollisionChecker::IsCollision(const std::vector<std::shared_ptr<Obstacle>>
   }
   return false;
 }
-}
\ No newline at end of file
+
+bool CollisionChecker::IsCollision(const PredictedFootprintTable &footprint_table,
+                                   const planning_msgs::Trajectory &ego_trajectory,
+                                   double ego_length,
+                                   double ego_width,
+                                   double back_axle_to_center) {
+  for (const auto &ego_point : ego_trajectory.trajectory_points) {
+    const auto relative_time = ego_point.relative_time;
+    const auto ego_theta = ego_point.path_point.theta;
+    common::Box2d ego_box({ego_point.path_point.x, ego_point.path_point.y},
+                          ego_theta, ego_length, ego_width);
+    ego_box.Shift({back_axle_to_center * std::cos(ego_theta), back_axle_to_center * std::sin(ego_theta)});
+    size_t step = 0;
+    const bool on_time_grid = footprint_table.GetStepAtTime(relative_time, &step);
+    for (size_t i = 0; i < footprint_table.NumOfObstacles(); ++i) {
+      if (on_time_grid) {
+        if (ego_box.HasOverlapWithBox2d(footprint_table.Footprint(i, step))) {
+          return true;
+        }
+        continue;
+      }
+      const auto &obstacle = footprint_table.GetObstacle(i);
+      if (ego_box.HasOverlapWithBox2d(obstacle->GetBoundingBoxAtState(obstacle->GetStateAtTime(relative_time)))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+}
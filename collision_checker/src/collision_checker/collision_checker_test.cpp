@@ -6,11 +6,13 @@
 #include <derived_object_msgs/Object.h>
 #include <tf/transform_datatypes.h>
 #include <math/coordinate_transformer.hpp>
+#include <obstacle_manager/obstacle_predictor.hpp>
 #include <memory>
 
 class CollisionCheckTest : public ::testing::Test {
  public:
   planning::ReferenceLine reference_line_;
+  std::shared_ptr<const planning::ReferenceLine> ptr_reference_line_;
   std::shared_ptr<planning::Obstacle> obstacle_;
   derived_object_msgs::Object object_;
   double start_s_{6.0};
@@ -40,7 +42,7 @@ class CollisionCheckTest : public ::testing::Test {
     std::unordered_map<int, std::shared_ptr<planning::Obstacle>> obstacle_map;
     obstacle_map.emplace(obstacle_->Id(), obstacle_);
     collision_checker_ = std::make_shared<planning::CollisionChecker>(obstacle_map,
-                                                                      reference_line_,
+                                                                      ptr_reference_line_,
                                                                       st_graph_,
                                                                       start_s_,
                                                                       init_d_[0],
@@ -73,7 +75,7 @@ class CollisionCheckTest : public ::testing::Test {
   void SetUpSTGraph() {
     std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_};
     st_graph_ = std::make_shared<planning::STGraph>(obstacles,
-                                                    reference_line_,
+                                                    ptr_reference_line_,
                                                     start_s_,
                                                     end_s_,
                                                     t_start_,
@@ -286,6 +288,7 @@ class CollisionCheckTest : public ::testing::Test {
     }
     reference_line_ = planning::ReferenceLine(way_points);
     reference_line_.Smooth(13, 100.0, 1.0, 5, 5);
+    ptr_reference_line_ = std::make_shared<const planning::ReferenceLine>(reference_line_);
 
   }
 };
@@ -295,13 +298,11 @@ TEST_F(CollisionCheckTest, in_lane_test) {
 }
 
 TEST_F(CollisionCheckTest, collision_test) {
-  auto predicted_obstacle_box = collision_checker_->predicted_obstacle_box_;
-  int i = 0;
-  for (const auto &obstacle_box_discrete_time : predicted_obstacle_box) {
-    EXPECT_TRUE(obstacle_box_discrete_time.size() == 1);
-    auto obstacle_box = obstacle_box_discrete_time.front();
+  const auto &footprint_table = *collision_checker_->footprint_table_;
+  EXPECT_TRUE(collision_checker_->considered_obstacles_.size() == 1);
+  for (size_t i = 0; i < footprint_table.NumOfSteps(); ++i) {
+    const auto &obstacle_box = footprint_table.Footprint(collision_checker_->considered_obstacles_.front(), i);
     std::cout << "i: " << i << "box center:" << obstacle_box.center_x() << ", " << obstacle_box.center_y() << std::endl;
-    ++i;
   }
 
   planning_msgs::Trajectory trajectory;
@@ -400,7 +401,7 @@ TEST_F(CollisionCheckTest, dynamic_obstacle_test) {
   }
   std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_};
   auto st_graph = std::make_shared<planning::STGraph>(obstacles,
-                                                      reference_line_,
+                                                      ptr_reference_line_,
                                                       start_s_,
                                                       end_s_,
                                                       t_start_,
@@ -423,7 +424,7 @@ TEST_F(CollisionCheckTest, dynamic_obstacle_test) {
   std::unordered_map<int, std::shared_ptr<planning::Obstacle>> obstacle_map;
   obstacle_map.emplace(obstacle_->Id(), obstacle_);
   auto collision_checker = std::make_shared<planning::CollisionChecker>(obstacle_map,
-                                                                        reference_line_,
+                                                                        ptr_reference_line_,
                                                                         st_graph,
                                                                         start_s_,
                                                                         init_d_[0],
@@ -434,6 +435,687 @@ TEST_F(CollisionCheckTest, dynamic_obstacle_test) {
 
 }
 
+TEST_F(CollisionCheckTest, shared_footprint_table_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_};
+  auto footprint_table = std::make_shared<planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                             lookahead_time_ + delta_t_,
+                                                                             delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(2.0, 0.3);
+  ASSERT_EQ(footprint_table->NumOfSteps(), collision_checker_->footprint_table_->NumOfSteps());
+  for (size_t i = 0; i < footprint_table->NumOfSteps(); ++i) {
+    const auto &footprint = footprint_table->Footprint(0, i);
+    const auto box = obstacle_->GetBoundingBoxAtState(obstacle_->GetStateAtTime(footprint_table->RelativeTime(i)));
+    EXPECT_DOUBLE_EQ(footprint.center_x(), box.center_x());
+    EXPECT_DOUBLE_EQ(footprint.center_y(), box.center_y());
+    EXPECT_DOUBLE_EQ(footprint.heading(), box.heading());
+    EXPECT_DOUBLE_EQ(inflated_footprint_table->Footprint(0, i).length(), box.length() + 4.0);
+    EXPECT_DOUBLE_EQ(inflated_footprint_table->Footprint(0, i).width(), box.width() + 0.6);
+    size_t step = 0;
+    EXPECT_TRUE(footprint_table->GetStepAtTime(footprint_table->RelativeTime(i), &step));
+    EXPECT_EQ(step, i);
+  }
+  size_t step = 0;
+  EXPECT_FALSE(footprint_table->GetStepAtTime(0.05, &step));
+  EXPECT_FALSE(footprint_table->GetStepAtTime(-delta_t_, &step));
+
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1, footprint_table);
+  ASSERT_EQ(st_graph->obstacles_st_boundary_.size(), st_graph_->obstacles_st_boundary_.size());
+  planning::CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                               st_graph, start_s_, init_d_[0], vehicle_params_, nullptr);
+  EXPECT_EQ(collision_checker.considered_obstacles_.size(), collision_checker_->considered_obstacles_.size());
+
+  planning_msgs::Trajectory trajectory;
+  double t = 0.0;
+  double s = start_s_;
+  while (t <= 8.0) {
+    auto ref_point = reference_line_.GetReferencePoint(s);
+    planning_msgs::TrajectoryPoint tp;
+    tp.path_point.x = ref_point.x();
+    tp.path_point.y = ref_point.y();
+    tp.path_point.theta = ref_point.theta();
+    tp.vel = 3.0;
+    tp.relative_time = t;
+    trajectory.trajectory_points.push_back(tp);
+    s += tp.vel * delta_t_;
+    t += delta_t_;
+  }
+  EXPECT_EQ(collision_checker.IsCollision(trajectory), collision_checker_->IsCollision(trajectory));
+  EXPECT_EQ(planning::CollisionChecker::IsCollision(*footprint_table, trajectory, vehicle_params_.length,
+                                                    vehicle_params_.width,
+                                                    vehicle_params_.back_axle_to_center_length),
+            planning::CollisionChecker::IsCollision(obstacles, reference_line_, trajectory, vehicle_params_.length,
+                                                    vehicle_params_.width,
+                                                    vehicle_params_.back_axle_to_center_length));
+}
+
+TEST_F(CollisionCheckTest, incremental_footprint_table_test) {
+  const double elapsed_time = 0.3;
+  auto object = object_;
+  object.id = 2;
+  object.twist.linear.x = 16.0;
+  auto moving_obstacle = std::make_shared<planning::Obstacle>(object);
+  moving_obstacle->PredictTrajectory(8.0, 0.1);
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_, moving_obstacle};
+  planning::PredictedFootprintTable previous_table(obstacles, 0.0, lookahead_time_ + delta_t_, delta_t_, nullptr);
+
+  // the moving obstacle follows its prediction, the static one jumped by a meter
+  const auto state = moving_obstacle->GetStateAtTime(elapsed_time);
+  object.pose.position.x = state.x;
+  object.pose.position.y = state.y;
+  auto next_moving_obstacle = std::make_shared<planning::Obstacle>(object);
+  next_moving_obstacle->PredictTrajectory(8.0, 0.1);
+  auto jumped_object = object_;
+  jumped_object.pose.position.y += 1.0;
+  auto next_obstacle = std::make_shared<planning::Obstacle>(jumped_object);
+  next_obstacle->PredictTrajectory(8.0, 0.1);
+  std::vector<std::shared_ptr<planning::Obstacle>> next_obstacles{next_obstacle, next_moving_obstacle};
+
+  planning::FootprintReuseBounds reuse_bounds;
+  planning::PredictedFootprintTable table(next_obstacles, 0.0, lookahead_time_ + delta_t_, delta_t_, nullptr,
+                                          previous_table, elapsed_time, reuse_bounds);
+  planning::PredictedFootprintTable fresh_table(next_obstacles, 0.0, lookahead_time_ + delta_t_, delta_t_, nullptr);
+  EXPECT_DOUBLE_EQ(table.RowAge(0), 0.0);
+  EXPECT_DOUBLE_EQ(table.RowAge(1), elapsed_time);
+  for (size_t index = 0; index < table.NumOfObstacles(); ++index) {
+    for (size_t step = 0; step < table.NumOfSteps(); ++step) {
+      const auto &footprint = table.Footprint(index, step);
+      const auto &fresh_footprint = fresh_table.Footprint(index, step);
+      EXPECT_NEAR(footprint.center_x(), fresh_footprint.center_x(), 1e-6) << "index: " << index << ", step: " << step;
+      EXPECT_NEAR(footprint.center_y(), fresh_footprint.center_y(), 1e-6) << "index: " << index << ", step: " << step;
+      EXPECT_NEAR(footprint.heading(), fresh_footprint.heading(), 1e-6) << "index: " << index << ", step: " << step;
+    }
+  }
+  // the reused footprints are rebuilt once they are older than the max age
+  planning::PredictedFootprintTable next_table(next_obstacles, 0.0, lookahead_time_ + delta_t_, delta_t_, nullptr,
+                                               table, reuse_bounds.max_age, reuse_bounds);
+  EXPECT_DOUBLE_EQ(next_table.RowAge(1), 0.0);
+}
+
+TEST_F(CollisionCheckTest, non_uniform_footprint_table_test) {
+  auto object = object_;
+  object.id = 2;
+  object.twist.linear.x = 16.0;
+  auto moving_obstacle = std::make_shared<planning::Obstacle>(object);
+  moving_obstacle->PredictTrajectory(8.0, 0.1);
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_, moving_obstacle};
+  // dense up to 3 s, sparse beyond
+  std::vector<double> relative_times;
+  for (size_t i = 0; i < 30; ++i) {
+    relative_times.push_back(static_cast<double>(i) * 0.1);
+  }
+  for (size_t i = 0; i <= 12; ++i) {
+    relative_times.push_back(3.0 + static_cast<double>(i) * 0.4);
+  }
+  relative_times.push_back(8.0);
+  planning::PredictedFootprintTable table(obstacles, relative_times, nullptr);
+  ASSERT_EQ(table.NumOfSteps(), relative_times.size());
+  for (size_t step = 0; step < table.NumOfSteps(); ++step) {
+    size_t found_step = 0;
+    ASSERT_TRUE(table.GetStepAtTime(relative_times[step], &found_step)) << "step: " << step;
+    EXPECT_EQ(found_step, step);
+    for (size_t index = 0; index < table.NumOfObstacles(); ++index) {
+      const auto &obstacle = table.GetObstacle(index);
+      const auto box = obstacle->GetBoundingBoxAtState(obstacle->GetStateAtTime(relative_times[step]));
+      EXPECT_DOUBLE_EQ(table.Footprint(index, step).center_x(), box.center_x()) << "step: " << step;
+      EXPECT_DOUBLE_EQ(table.Footprint(index, step).center_y(), box.center_y()) << "step: " << step;
+    }
+  }
+  size_t step = 0;
+  EXPECT_FALSE(table.GetStepAtTime(3.2, &step));
+  EXPECT_FALSE(table.GetStepAtTime(8.1, &step));
+  // nothing is shifted off an uneven grid
+  planning::FootprintReuseBounds reuse_bounds;
+  planning::PredictedFootprintTable next_table(obstacles, 0.0, lookahead_time_ + delta_t_, delta_t_, nullptr,
+                                               table, 0.0, reuse_bounds);
+  EXPECT_DOUBLE_EQ(next_table.RowAge(0), 0.0);
+  EXPECT_DOUBLE_EQ(next_table.RowAge(1), 0.0);
+}
+
+TEST_F(CollisionCheckTest, broad_phase_matches_exhaustive_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 40; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 2.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 5 - 2) * 1.5);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 3) * 2.0;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  std::unordered_map<int, std::shared_ptr<planning::Obstacle>> obstacle_map;
+  for (const auto &obstacle : obstacles) {
+    obstacle_map.emplace(obstacle->Id(), obstacle);
+  }
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  planning::CollisionChecker collision_checker(obstacle_map, ptr_reference_line_, st_graph, start_s_, init_d_[0],
+                                               2.0, 0.3, lookahead_time_, 0.1, vehicle_params_, nullptr);
+  planning::CollisionChecker swept_collision_checker(collision_checker.footprint_table_,
+                                                     collision_checker.inflated_footprint_table_,
+                                                     ptr_reference_line_, st_graph, start_s_, init_d_[0],
+                                                     vehicle_params_, nullptr, 5);
+  size_t num_collisions = 0;
+  for (double d = -6.0; d <= 6.0; d += 0.5) {
+    for (double v = 0.0; v <= 12.0; v += 3.0) {
+      planning_msgs::Trajectory trajectory;
+      double t = 0.0;
+      double s = start_s_;
+      while (t <= 8.0) {
+        auto ref_point = reference_line_.GetReferencePoint(s);
+        auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(),
+                                                                   ref_point.y(), d);
+        planning_msgs::TrajectoryPoint tp;
+        tp.path_point.x = xy.x();
+        tp.path_point.y = xy.y();
+        tp.path_point.theta = ref_point.theta();
+        tp.vel = v;
+        tp.relative_time = t;
+        trajectory.trajectory_points.push_back(tp);
+        s += v * delta_t_;
+        t += delta_t_;
+      }
+      const bool is_collision = collision_checker.IsCollision(trajectory);
+      EXPECT_EQ(is_collision,
+                collision_checker.IsCollisionExhaustive(trajectory, *collision_checker.inflated_footprint_table_))
+                << "d: " << d << ", v: " << v;
+      // the swept check is conservative, it never misses a collision of the sampled check
+      if (is_collision) {
+        EXPECT_TRUE(swept_collision_checker.IsCollision(trajectory)) << "d: " << d << ", v: " << v;
+      }
+      num_collisions += is_collision ? 1 : 0;
+    }
+  }
+  EXPECT_GT(num_collisions, 0);
+}
+
+TEST_F(CollisionCheckTest, float_broad_phase_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 40; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 2.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 5 - 2) * 1.5);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 3) * 2.0;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  auto footprint_table = std::make_shared<const planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                                   lookahead_time_ + delta_t_,
+                                                                                   delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(2.0, 0.3);
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  planning::CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                               st_graph, start_s_, init_d_[0], vehicle_params_, nullptr);
+  planning::CollisionChecker float_collision_checker(footprint_table, inflated_footprint_table,
+                                                     ptr_reference_line_, st_graph, start_s_, init_d_[0],
+                                                     vehicle_params_, nullptr, 1, false, true, 0.01);
+  size_t num_collisions = 0;
+  // the lateral offsets sweep the ego across the borders of the footprints in fine steps
+  for (double d = -6.0; d <= 6.0; d += 0.05) {
+    for (double v = 0.0; v <= 12.0; v += 3.0) {
+      planning_msgs::Trajectory trajectory;
+      double t = 0.0;
+      double s = start_s_;
+      while (t <= 8.0) {
+        auto ref_point = reference_line_.GetReferencePoint(s);
+        auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(),
+                                                                   ref_point.y(), d);
+        planning_msgs::TrajectoryPoint tp;
+        tp.path_point.x = xy.x();
+        tp.path_point.y = xy.y();
+        tp.path_point.theta = ref_point.theta();
+        tp.vel = v;
+        tp.relative_time = t;
+        trajectory.trajectory_points.push_back(tp);
+        s += v * delta_t_;
+        t += delta_t_;
+      }
+      const bool is_collision = collision_checker.IsCollision(trajectory);
+      EXPECT_EQ(is_collision, float_collision_checker.IsCollision(trajectory)) << "d: " << d << ", v: " << v;
+      num_collisions += is_collision ? 1 : 0;
+    }
+  }
+  EXPECT_GT(num_collisions, 0);
+
+  // far from the map origin the float32 test is relative to the footprints, a box touching within the guard band
+  // falls back to the exact test
+  const Eigen::Vector2d center{45000.0, -32000.0};
+  planning::CollisionChecker::FootprintSlice slice =
+      planning::CollisionChecker::BuildSlice({common::Box2d(center, 0.4, 4.0, 2.0)});
+  planning::CollisionChecker::BuildFloatFootprints(&slice);
+  const Eigen::Vector2d lon_axis{std::cos(0.4), std::sin(0.4)};
+  for (const double gap : {-0.5, -1e-3, 1e-3, 0.5}) {
+    const common::Box2d ego_box(center + (4.0 + gap) * lon_axis, 0.4, 4.0, 2.0);
+    float margin = 0.0f;
+    planning::CollisionChecker::SeparationMargins(slice, 0, 1, ego_box, &margin);
+    EXPECT_NEAR(margin, gap, 1e-3) << "gap: " << gap;
+    EXPECT_EQ(ego_box.HasOverlapWithBox2d(slice.footprints.front()), gap < 0.0) << "gap: " << gap;
+  }
+}
+
+TEST_F(CollisionCheckTest, vehicle_footprint_test) {
+  // a static 1 m box beside the path of the rear axle, within reach of the ego width only
+  const double obstacle_s = start_s_ + 20.0;
+  const auto obstacle_ref_point = reference_line_.GetReferencePoint(obstacle_s);
+  auto object = object_;
+  object.id = 100;
+  object.shape.dimensions = {1.0, 1.0, 1.5};
+  const auto obstacle_xy = common::CoordinateTransformer::CalcCatesianPoint(
+      obstacle_ref_point.theta(), obstacle_ref_point.x(), obstacle_ref_point.y(), 1.2);
+  object.pose.position.x = obstacle_xy.x();
+  object.pose.position.y = obstacle_xy.y();
+  object.pose.orientation = tf::createQuaternionMsgFromYaw(obstacle_ref_point.theta());
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{std::make_shared<planning::Obstacle>(object)};
+  obstacles.back()->PredictTrajectory(8.0, 0.1);
+  auto footprint_table = std::make_shared<const planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                                   lookahead_time_ + delta_t_,
+                                                                                   delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(0.0, 0.0);
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+
+  // the rear axle passes the box on the reference line
+  planning_msgs::Trajectory trajectory;
+  double s = start_s_;
+  for (double t = 0.0; t <= 8.0; t += delta_t_) {
+    const auto ref_point = reference_line_.GetReferencePoint(s);
+    planning_msgs::TrajectoryPoint tp;
+    tp.path_point.x = ref_point.x();
+    tp.path_point.y = ref_point.y();
+    tp.path_point.theta = ref_point.theta();
+    tp.vel = 5.0;
+    tp.relative_time = t;
+    trajectory.trajectory_points.push_back(tp);
+    s += tp.vel * delta_t_;
+  }
+
+  // the rear axle point alone stays 0.7 m clear of the box, the 3 m wide ego overlaps it
+  const planning::CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                                     st_graph, start_s_, init_d_[0], vehicle_params_, nullptr);
+  EXPECT_TRUE(collision_checker.IsCollision(trajectory));
+  EXPECT_TRUE(collision_checker.IsCollisionExhaustive(trajectory, *inflated_footprint_table));
+  const vehicle_state::VehicleParams point_params{};
+  const planning::CollisionChecker point_collision_checker(footprint_table, inflated_footprint_table,
+                                                           ptr_reference_line_, st_graph, start_s_, init_d_[0],
+                                                           point_params, nullptr);
+  EXPECT_FALSE(point_collision_checker.IsCollision(trajectory));
+}
+
+TEST_F(CollisionCheckTest, clearance_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 40; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 2.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 5 - 2) * 1.5);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 3) * 2.0;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  auto footprint_table = std::make_shared<const planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                                   lookahead_time_ + delta_t_,
+                                                                                   delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(2.0, 0.3);
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  planning::CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                               st_graph, start_s_, init_d_[0], vehicle_params_, nullptr);
+  const double max_clearance = 3.0;
+  const double shift_distance = vehicle_params_.back_axle_to_center_length;
+  size_t num_collisions = 0;
+  size_t num_near_misses = 0;
+  for (double d = -6.0; d <= 6.0; d += 0.25) {
+    std::vector<Eigen::Vector3d> poses;
+    double s = start_s_;
+    for (size_t step = 0; step < 80; ++step) {
+      auto ref_point = reference_line_.GetReferencePoint(s);
+      auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(),
+                                                                 ref_point.y(), d);
+      poses.emplace_back(xy.x(), xy.y(), ref_point.theta());
+      s += 6.0 * delta_t_;
+    }
+    std::vector<double> clearances;
+    collision_checker.Clearances(poses, max_clearance, &clearances);
+    ASSERT_EQ(clearances.size(), poses.size());
+    bool has_zero_clearance = false;
+    for (size_t step = 0; step < poses.size(); ++step) {
+      const auto &pose = poses[step];
+      common::Box2d ego_box({pose.x(), pose.y()}, pose.z(), vehicle_params_.length, vehicle_params_.width);
+      ego_box.Shift({shift_distance * std::cos(pose.z()), shift_distance * std::sin(pose.z())});
+      double expected_clearance = max_clearance;
+      for (const auto index : collision_checker.considered_obstacles_) {
+        expected_clearance = std::min(expected_clearance,
+                                      ego_box.DistanceTo(inflated_footprint_table->Footprint(index, step)));
+      }
+      EXPECT_NEAR(clearances[step], expected_clearance, 1e-9) << "d: " << d << ", step: " << step;
+      has_zero_clearance |= clearances[step] == 0.0;
+      num_near_misses += clearances[step] > 0.0 && clearances[step] < max_clearance ? 1 : 0;
+    }
+    // a zero clearance is a collision of the check
+    EXPECT_EQ(has_zero_clearance, collision_checker.IsCollision(poses, 0, nullptr)) << "d: " << d;
+    num_collisions += has_zero_clearance ? 1 : 0;
+  }
+  EXPECT_GT(num_collisions, 0);
+  EXPECT_GT(num_near_misses, 0);
+}
+
+TEST_F(CollisionCheckTest, footprint_clearance_test) {
+  // a static 1 m box in the lane of the st graph, its inflated inner side 1.4 m off the reference line
+  const double obstacle_s = start_s_ + 20.0;
+  const auto obstacle_ref_point = reference_line_.GetReferencePoint(obstacle_s);
+  auto object = object_;
+  object.id = 100;
+  object.shape.dimensions = {1.0, 1.0, 1.5};
+  const auto obstacle_xy = common::CoordinateTransformer::CalcCatesianPoint(
+      obstacle_ref_point.theta(), obstacle_ref_point.x(), obstacle_ref_point.y(), 2.2);
+  object.pose.position.x = obstacle_xy.x();
+  object.pose.position.y = obstacle_xy.y();
+  object.pose.orientation = tf::createQuaternionMsgFromYaw(obstacle_ref_point.theta());
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{std::make_shared<planning::Obstacle>(object)};
+  obstacles.back()->PredictTrajectory(8.0, 0.1);
+  auto footprint_table = std::make_shared<const planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                                   lookahead_time_ + delta_t_,
+                                                                                   delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(0.0, 0.3);
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  vehicle_state::VehicleParams vehicle_params = vehicle_params_;
+  vehicle_params.width = 2.0;
+  const planning::CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                                     st_graph, start_s_, init_d_[0], vehicle_params, nullptr);
+
+  // the rear axle on the reference line, the center of the 5 x 2 m ego 1.5 m ahead of it, at lon gaps of
+  // -1 (beside the box), 1 and 10 m between the front of the ego and the back of the box
+  const double half_length = 0.5 * vehicle_params.length;
+  const double shift_distance = vehicle_params.back_axle_to_center_length;
+  std::vector<Eigen::Vector3d> poses;
+  for (const double lon_gap : {-1.0, 1.0, 10.0}) {
+    const auto ref_point = reference_line_.GetReferencePoint(obstacle_s - 0.5 - lon_gap - half_length
+                                                                 - shift_distance);
+    poses.emplace_back(ref_point.x(), ref_point.y(), ref_point.theta());
+  }
+  const double max_clearance = 3.0;
+  std::vector<double> clearances;
+  collision_checker.Clearances(poses, max_clearance, &clearances);
+  ASSERT_EQ(clearances.size(), poses.size());
+  const double lat_gap = 1.4 - 0.5 * vehicle_params.width;
+  EXPECT_NEAR(clearances[0], lat_gap, 1e-2);
+  EXPECT_NEAR(clearances[1], std::hypot(1.0, lat_gap), 1e-2);
+  EXPECT_DOUBLE_EQ(clearances[2], max_clearance);
+}
+
+TEST_F(CollisionCheckTest, polygon_footprint_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 20; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 4.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 5 - 2) * 1.7);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 3) * 2.0;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  auto footprint_table = std::make_shared<planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                             lookahead_time_ + delta_t_,
+                                                                             delta_t_, nullptr);
+  auto inflated_footprint_table = footprint_table->Inflate(2.0, 0.3);
+  EXPECT_DOUBLE_EQ(inflated_footprint_table->LonBuffer(), 2.0);
+  EXPECT_DOUBLE_EQ(inflated_footprint_table->LatBuffer(), 0.3);
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  planning::CollisionChecker box_collision_checker(footprint_table, inflated_footprint_table, ptr_reference_line_,
+                                                   st_graph, start_s_, init_d_[0], vehicle_params_, nullptr);
+  planning::CollisionChecker polygon_collision_checker(footprint_table, inflated_footprint_table,
+                                                       ptr_reference_line_, st_graph, start_s_, init_d_[0],
+                                                       vehicle_params_, nullptr, 1, true);
+  size_t num_box_collisions = 0;
+  size_t num_polygon_collisions = 0;
+  for (double d = -6.0; d <= 6.0; d += 0.25) {
+    for (double v = 0.0; v <= 12.0; v += 3.0) {
+      planning_msgs::Trajectory trajectory;
+      double t = 0.0;
+      double s = start_s_;
+      while (t <= 8.0) {
+        auto ref_point = reference_line_.GetReferencePoint(s);
+        auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(),
+                                                                   ref_point.y(), d);
+        planning_msgs::TrajectoryPoint tp;
+        tp.path_point.x = xy.x();
+        tp.path_point.y = xy.y();
+        tp.path_point.theta = ref_point.theta();
+        tp.vel = v;
+        tp.relative_time = t;
+        trajectory.trajectory_points.push_back(tp);
+        s += v * delta_t_;
+        t += delta_t_;
+      }
+      // the chamfered footprints lie between the raw and the inflated boxes
+      const bool is_box_collision = box_collision_checker.IsCollision(trajectory);
+      const bool is_polygon_collision = polygon_collision_checker.IsCollision(trajectory);
+      if (is_polygon_collision) {
+        EXPECT_TRUE(is_box_collision) << "d: " << d << ", v: " << v;
+      }
+      if (polygon_collision_checker.IsCollisionExhaustive(trajectory, *footprint_table)) {
+        EXPECT_TRUE(is_polygon_collision) << "d: " << d << ", v: " << v;
+      }
+      num_box_collisions += is_box_collision ? 1 : 0;
+      num_polygon_collisions += is_polygon_collision ? 1 : 0;
+    }
+  }
+  EXPECT_GT(num_polygon_collisions, 0);
+  EXPECT_LE(num_polygon_collisions, num_box_collisions);
+
+  // the sl boundary of the box polygon is the one of the box
+  const auto box = obstacles.front()->GetBoundingBox();
+  common::SLBoundary box_sl_boundary;
+  common::SLBoundary polygon_sl_boundary;
+  ASSERT_TRUE(reference_line_.GetSLBoundary(box, &box_sl_boundary));
+  ASSERT_TRUE(reference_line_.GetSLBoundary(common::Polygon2d(box), &polygon_sl_boundary));
+  EXPECT_DOUBLE_EQ(box_sl_boundary.start_s, polygon_sl_boundary.start_s);
+  EXPECT_DOUBLE_EQ(box_sl_boundary.end_s, polygon_sl_boundary.end_s);
+  EXPECT_DOUBLE_EQ(box_sl_boundary.start_l, polygon_sl_boundary.start_l);
+  EXPECT_DOUBLE_EQ(box_sl_boundary.end_l, polygon_sl_boundary.end_l);
+}
+
+TEST_F(CollisionCheckTest, batch_first_collision_free_test) {
+  std::vector<planning_msgs::Trajectory> trajectories;
+  for (double d = -1.0; d <= 8.0; d += 1.0) {
+    planning_msgs::Trajectory trajectory;
+    double t = 0.0;
+    double s = start_s_;
+    while (t <= 8.0) {
+      auto ref_point = reference_line_.GetReferencePoint(s);
+      auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(),
+                                                                 ref_point.y(), d);
+      planning_msgs::TrajectoryPoint tp;
+      tp.path_point.x = xy.x();
+      tp.path_point.y = xy.y();
+      tp.path_point.theta = ref_point.theta();
+      tp.vel = 3.0;
+      tp.relative_time = t;
+      trajectory.trajectory_points.push_back(tp);
+      s += tp.vel * delta_t_;
+      t += delta_t_;
+    }
+    trajectories.push_back(trajectory);
+  }
+  size_t expected_index = trajectories.size();
+  for (size_t i = 0; i < trajectories.size(); ++i) {
+    if (!collision_checker_->IsCollision(trajectories[i])) {
+      expected_index = i;
+      break;
+    }
+  }
+  ASSERT_GT(expected_index, 0);
+  ASSERT_LT(expected_index, trajectories.size());
+  EXPECT_EQ(collision_checker_->FirstCollisionFree(trajectories), expected_index);
+
+  common::ThreadPool thread_pool(4);
+  collision_checker_->thread_pool_ = &thread_pool;
+  for (int run = 0; run < 20; ++run) {
+    EXPECT_EQ(collision_checker_->FirstCollisionFree(trajectories), expected_index);
+  }
+  const std::vector<planning_msgs::Trajectory> colliding_trajectories(trajectories.begin(),
+                                                                      trajectories.begin() + expected_index);
+  EXPECT_EQ(collision_checker_->FirstCollisionFree(colliding_trajectories), colliding_trajectories.size());
+  collision_checker_->thread_pool_ = nullptr;
+}
+
+TEST_F(CollisionCheckTest, st_graph_index_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 40; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 2.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 3 - 1) * 0.5);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 4) * 1.5;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  auto st_graph = std::make_shared<planning::STGraph>(obstacles, ptr_reference_line_, start_s_, end_s_,
+                                                      t_start_, t_end_, init_d_, 8.0, 0.1);
+  ASSERT_GT(st_graph->obstacles_st_boundary_.size(), 1);
+  for (double t = t_start_; t <= t_end_; t += 0.05) {
+    std::vector<std::pair<double, double>> expected_intervals;
+    for (const auto &st_boundary : st_graph->obstacles_st_boundary_) {
+      double s_upper, s_lower;
+      if (t >= st_boundary.min_t() && t <= st_boundary.max_t()
+          && st_boundary.GetBoundarySRange(t, &s_upper, &s_lower)) {
+        expected_intervals.emplace_back(s_lower, s_upper);
+      }
+    }
+    EXPECT_EQ(st_graph->GetPathBlockingIntervals(t), expected_intervals) << "t: " << t;
+    const auto merged_intervals = st_graph->GetMergedBlockingIntervals(t);
+    for (size_t i = 1; i < merged_intervals.size(); ++i) {
+      EXPECT_LT(merged_intervals[i - 1].second, merged_intervals[i].first);
+    }
+    for (double s = start_s_ - 5.0; s <= end_s_ + 5.0; s += 0.7) {
+      bool expected_blocked = false;
+      for (const auto &interval : expected_intervals) {
+        expected_blocked = expected_blocked || (interval.first <= s && s <= interval.second);
+      }
+      EXPECT_EQ(st_graph->IsSBlocked(t, s), expected_blocked) << "t: " << t << ", s: " << s;
+      std::pair<double, double> gap;
+      ASSERT_TRUE(st_graph->GetNearestFreeGap(t, s, &gap));
+      EXPECT_LE(gap.first, gap.second);
+      for (const auto &interval : expected_intervals) {
+        // the grid slices are cached at the accumulated grid times, which may differ from t in the last bits
+        EXPECT_TRUE(interval.second <= gap.first + 1e-6 || interval.first >= gap.second - 1e-6)
+                  << "t: " << t << ", s: " << s;
+      }
+      if (!expected_blocked) {
+        EXPECT_TRUE(gap.first < s && s < gap.second) << "t: " << t << ", s: " << s;
+      }
+    }
+  }
+}
+
+TEST_F(CollisionCheckTest, parallel_st_graph_test) {
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles;
+  for (int i = 0; i < 20; ++i) {
+    auto ref_point = reference_line_.GetReferencePoint(start_s_ + 4.0 * i);
+    auto object = object_;
+    object.id = 100 + i;
+    auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(),
+                                                               (i % 3 - 1) * 1.0);
+    object.pose.position.x = xy.x();
+    object.pose.position.y = xy.y();
+    object.twist.linear.x = (i % 2) * 3.0;
+    obstacles.push_back(std::make_shared<planning::Obstacle>(object));
+    obstacles.back()->PredictTrajectory(8.0, 0.1);
+  }
+  planning::STGraph st_graph(obstacles, ptr_reference_line_, start_s_, end_s_, t_start_, t_end_, init_d_, 8.0, 0.1);
+  common::ThreadPool thread_pool(4);
+  planning::STGraph parallel_st_graph(obstacles, ptr_reference_line_, start_s_, end_s_, t_start_, t_end_, init_d_,
+                                      8.0, 0.1, nullptr, &thread_pool);
+  const auto &st_boundaries = st_graph.GetObstaclesSTBoundary();
+  const auto &parallel_st_boundaries = parallel_st_graph.GetObstaclesSTBoundary();
+  ASSERT_GT(st_boundaries.size(), 1);
+  ASSERT_EQ(st_boundaries.size(), parallel_st_boundaries.size());
+  for (size_t i = 0; i < st_boundaries.size(); ++i) {
+    EXPECT_EQ(st_boundaries[i].id(), parallel_st_boundaries[i].id());
+    ASSERT_EQ(st_boundaries[i].lower_points().size(), parallel_st_boundaries[i].lower_points().size());
+    for (size_t k = 0; k < st_boundaries[i].lower_points().size(); ++k) {
+      EXPECT_EQ(st_boundaries[i].lower_points()[k].s(), parallel_st_boundaries[i].lower_points()[k].s());
+      EXPECT_EQ(st_boundaries[i].upper_points()[k].s(), parallel_st_boundaries[i].upper_points()[k].s());
+      EXPECT_EQ(st_boundaries[i].lower_points()[k].t(), parallel_st_boundaries[i].lower_points()[k].t());
+    }
+  }
+}
+
+TEST_F(CollisionCheckTest, memoized_sl_boundary_test) {
+  // a still obstacle and a moving one, the boundaries of both match a fresh projection of their footprints
+  auto moving_object = object_;
+  moving_object.id = 2;
+  moving_object.twist.linear.x = -3.0;
+  auto moving_obstacle = std::make_shared<planning::Obstacle>(moving_object);
+  moving_obstacle->PredictTrajectory(8.0, 0.1);
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{obstacle_, moving_obstacle};
+  auto footprint_table = std::make_shared<planning::PredictedFootprintTable>(obstacles, 0.0,
+                                                                             lookahead_time_ + delta_t_,
+                                                                             delta_t_, nullptr);
+  planning::STGraph st_graph(obstacles, ptr_reference_line_, start_s_, end_s_, t_start_, t_end_, init_d_, 8.0, 0.1,
+                             footprint_table);
+  for (size_t index = 0; index < obstacles.size(); ++index) {
+    for (size_t step = 0; step < footprint_table->NumOfSteps(); step += 10) {
+      const double t = footprint_table->RelativeTime(step);
+      common::SLBoundary memoized_sl_boundary;
+      common::SLBoundary sl_boundary;
+      ASSERT_TRUE(st_graph.GetObstacleSLBoundary(obstacles[index]->Id(), t, &memoized_sl_boundary));
+      ASSERT_TRUE(reference_line_.GetSLBoundary(footprint_table->Footprint(index, step), &sl_boundary));
+      EXPECT_NEAR(memoized_sl_boundary.start_s, sl_boundary.start_s, 1e-6);
+      EXPECT_NEAR(memoized_sl_boundary.end_s, sl_boundary.end_s, 1e-6);
+      EXPECT_NEAR(memoized_sl_boundary.start_l, sl_boundary.start_l, 1e-6);
+      EXPECT_NEAR(memoized_sl_boundary.end_l, sl_boundary.end_l, 1e-6);
+    }
+  }
+  common::SLBoundary sl_boundary;
+  EXPECT_FALSE(st_graph.GetObstacleSLBoundary(obstacle_->Id(), 0.05, &sl_boundary));
+  EXPECT_FALSE(st_graph.GetObstacleSLBoundary(100, 0.0, &sl_boundary));
+}
+
+TEST(CollisionCheck, swept_box_test) {
+  const double length = 4.8;
+  const double width = 2.1;
+  std::vector<Eigen::Vector3d> poses;
+  for (int i = 0; i <= 5; ++i) {
+    const double theta = 3.0 + 0.08 * i;
+    poses.emplace_back(10.0 * std::cos(theta), 10.0 * std::sin(theta), theta + M_PI_2);
+  }
+  const auto swept_box = planning::CollisionChecker::SweptBox(poses, length, width);
+  for (size_t i = 0; i + 1 < poses.size(); ++i) {
+    for (double ratio = 0.0; ratio <= 1.0; ratio += 0.25) {
+      const Eigen::Vector3d pose = poses[i] + ratio * (poses[i + 1] - poses[i]);
+      common::Box2d box({pose.x(), pose.y()}, pose.z(), length, width);
+      for (const auto &corner : box.Corners()) {
+        EXPECT_TRUE(swept_box.IsPointIn(corner)) << "pose: " << i << ", ratio: " << ratio;
+      }
+    }
+  }
+  const std::vector<Eigen::Vector3d> single_pose{{1.0, 2.0, 0.3}};
+  const auto box = planning::CollisionChecker::SweptBox(single_pose, length, width);
+  EXPECT_NEAR(box.length(), length, 1e-9);
+  EXPECT_NEAR(box.width(), width, 1e-9);
+  EXPECT_NEAR(box.heading(), 0.3, 1e-9);
+}
+
 TEST(CollisionCheck, box_test) {
   Eigen::Vector2d obstacle_center{37.3609, 170.3};
   Eigen::Vector2d ego_center{35.3921, 166.691};
@@ -450,4 +1132,81 @@ TEST(CollisionCheck, box_test) {
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+
+TEST_F(CollisionCheckTest, obstacle_prediction_model_test) {
+  // the twist is taken as the squared speed, see the Obstacle constructor
+  auto make_obstacle = [&](double x, double y, double heading, double speed, double yaw_rate, double acc) {
+    auto object = object_;
+    object.pose.position.x = x;
+    object.pose.position.y = y;
+    object.pose.orientation = tf::createQuaternionMsgFromYaw(heading);
+    object.twist.linear.x = speed * speed;
+    object.twist.angular.z = yaw_rate;
+    object.accel.linear.x = acc * std::cos(heading);
+    object.accel.linear.y = acc * std::sin(heading);
+    return std::make_shared<planning::Obstacle>(object);
+  };
+  auto cruising = make_obstacle(0.0, 0.0, 0.5, 4.0, 0.0, 0.0);
+  auto turning = make_obstacle(10.0, 10.0, 0.0, 5.0, 0.5, 0.0);
+  auto braking = make_obstacle(-10.0, 5.0, 1.0, 6.0, 0.0, -2.0);
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{cruising, turning, braking};
+  planning::PredictionBatch batch(obstacles, lookahead_time_, delta_t_);
+  planning::ConstantTurnRateModel().Predict(&batch);
+  batch.Apply();
+  ASSERT_EQ(turning->GetPredictedTrajectory().trajectory_points.size(), 80);
+  for (const auto &tp : cruising->GetPredictedTrajectory().trajectory_points) {
+    EXPECT_NEAR(tp.path_point.x, 4.0 * tp.relative_time * std::cos(0.5), 1e-6);
+    EXPECT_NEAR(tp.path_point.y, 4.0 * tp.relative_time * std::sin(0.5), 1e-6);
+  }
+  // the circle of radius v / w around the turning center
+  const double radius = 5.0 / 0.5;
+  for (const auto &tp : turning->GetPredictedTrajectory().trajectory_points) {
+    EXPECT_NEAR(std::hypot(tp.path_point.x - 10.0, tp.path_point.y - (10.0 + radius)), radius, 1e-6);
+    EXPECT_NEAR(tp.path_point.s, 5.0 * tp.relative_time, 1e-6);
+  }
+  // stops after v^2 / 2a
+  const auto &stop_point = braking->GetPredictedTrajectory().trajectory_points.back();
+  EXPECT_NEAR(stop_point.path_point.s, 6.0 * 6.0 / 4.0, 1e-6);
+  EXPECT_NEAR(stop_point.vel, 0.0, 1e-9);
+
+  // the constant velocity model ignores the yaw rate and the acceleration
+  planning::PredictionBatch cv_batch(obstacles, lookahead_time_, delta_t_);
+  planning::ConstantTurnRateModel(false, false).Predict(&cv_batch);
+  cv_batch.Apply();
+  const auto &straight_point = turning->GetPredictedTrajectory().trajectory_points.back();
+  EXPECT_NEAR(straight_point.path_point.x, 10.0 + 5.0 * straight_point.relative_time, 1e-6);
+  EXPECT_NEAR(straight_point.path_point.y, 10.0, 1e-6);
+  EXPECT_NEAR(braking->GetPredictedTrajectory().trajectory_points.back().vel, 6.0, 1e-9);
+}
+
+TEST_F(CollisionCheckTest, lane_following_prediction_test) {
+  // an obstacle driving along the reference line, heading off it by a little, and one across it
+  const auto ref_point = reference_line_.GetReferencePoint(20.0);
+  auto object = object_;
+  object.pose.position.x = ref_point.x() - std::sin(ref_point.theta()) * 0.5;
+  object.pose.position.y = ref_point.y() + std::cos(ref_point.theta()) * 0.5;
+  object.pose.orientation = tf::createQuaternionMsgFromYaw(ref_point.theta() + 0.1);
+  object.twist.linear.x = 25.0;
+  auto following = std::make_shared<planning::Obstacle>(object);
+  object.id = 2;
+  object.pose.orientation = tf::createQuaternionMsgFromYaw(ref_point.theta() + M_PI_2);
+  auto crossing = std::make_shared<planning::Obstacle>(object);
+  std::vector<std::shared_ptr<planning::Obstacle>> obstacles{following, crossing};
+  planning::PredictionBatch batch(obstacles, lookahead_time_, delta_t_);
+  std::vector<std::shared_ptr<const planning::ReferenceLine>> lanes{ptr_reference_line_};
+  planning::LaneFollowingModel(lanes, std::make_shared<planning::ConstantTurnRateModel>()).Predict(&batch);
+  batch.Apply();
+  for (const auto &tp : following->GetPredictedTrajectory().trajectory_points) {
+    common::SLPoint sl_point;
+    ASSERT_TRUE(reference_line_.XYToSL(tp.path_point.x, tp.path_point.y, &sl_point));
+    EXPECT_NEAR(sl_point.l, 0.5, 0.05);
+    EXPECT_NEAR(sl_point.s, 20.0 + 5.0 * tp.relative_time, 0.05);
+  }
+  const auto &crossing_point = crossing->GetPredictedTrajectory().trajectory_points.back();
+  EXPECT_NEAR(std::hypot(crossing_point.path_point.x - object.pose.position.x,
+                         crossing_point.path_point.y - object.pose.position.y),
+              crossing_point.path_point.s, 1e-6);
+  EXPECT_NEAR(crossing_point.path_point.theta, common::MathUtils::NormalizeAngle(ref_point.theta() + M_PI_2),
+              1e-6);
+}
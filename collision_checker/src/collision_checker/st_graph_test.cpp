@@ -52,7 +52,7 @@ TEST(STGraphTEST, st_graph_build) {
     x += ds * std::cos(heading);
     y += ds * std::sin(heading);
   }
-  auto smoothed_ref_line = ReferenceLine(way_points);
+  auto smoothed_ref_line = std::make_shared<const ReferenceLine>(way_points);
   derived_object_msgs::Object object;
   object.object_classified = derived_object_msgs::Object::OBJECT_DETECTED;
   object.classification = derived_object_msgs::Object::CLASSIFICATION_CAR;
@@ -102,7 +102,7 @@ TEST(STGraphTEST, st_graph_build) {
   planning_msgs::Trajectory ego_trajectory;
   double t = 0;
   while (t <= 8.0) {
-    auto ref_point = smoothed_ref_line.GetReferencePoint(s);
+    auto ref_point = smoothed_ref_line->GetReferencePoint(s);
     auto xy = common::CoordinateTransformer::CalcCatesianPoint(ref_point.theta(), ref_point.x(), ref_point.y(), 0.0);
     planning_msgs::TrajectoryPoint tp;
     tp.path_point.x = xy.x();
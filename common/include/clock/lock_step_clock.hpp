@@ -0,0 +1,68 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_CLOCK_LOCK_STEP_CLOCK_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_CLOCK_LOCK_STEP_CLOCK_HPP_
+#include <ros/ros.h>
+#include <atomic>
+
+namespace common {
+/**
+ * @brief: paces a loop by the ticks of a simulator publishing /clock instead of by the wall time, so the loop runs
+ * one cycle per tick and as soon as the tick arrives. with use_sim_time the ros time only moves with /clock.
+ */
+class LockStepClock {
+ public:
+  /**
+   * @param timeout: the wall time WaitFor waits at most, in s
+   */
+  explicit LockStepClock(double timeout) : timeout_(timeout) {}
+
+  /**
+   * @brief: block until the ros time passes the last tick
+   * @param is_running: gives up once false
+   * @return: false if ros shut down or is_running turned false
+   */
+  bool WaitForNextTick(const std::atomic<bool> &is_running) {
+    while (ros::ok() && is_running) {
+      const ros::Time now = ros::Time::now();
+      if (now > tick_) {
+        tick_ = now;
+        return true;
+      }
+      ros::WallDuration(kPollPeriod).sleep();
+    }
+    return false;
+  }
+
+  /**
+   * @brief: block until is_ready returns true, e.g. the message of the tick arrived, or the timeout passed
+   * @param is_running: gives up once false
+   * @param is_ready
+   * @return: false on timeout or shutdown
+   */
+  template<class Predicate>
+  bool WaitFor(const std::atomic<bool> &is_running, Predicate &&is_ready) const {
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout_);
+    while (ros::ok() && is_running) {
+      if (is_ready()) {
+        return true;
+      }
+      if (ros::WallTime::now() > deadline) {
+        return false;
+      }
+      ros::WallDuration(kPollPeriod).sleep();
+    }
+    return false;
+  }
+
+  /**
+   * @brief: the ros time of the current tick
+   */
+  const ros::Time &tick() const { return tick_; }
+
+ private:
+  // the polls stay far below the run time of a cycle
+  static constexpr double kPollPeriod = 2e-4;
+  ros::Time tick_;
+  double timeout_ = 0.0;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_CLOCK_LOCK_STEP_CLOCK_HPP_
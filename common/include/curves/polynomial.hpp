@@ -2,6 +2,7 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYNOMIAL_HPP_
 #include <vector>
 #include <cstdint>
+#include <utility>
 namespace common{
 class Polynomial {
  public:
@@ -12,6 +13,34 @@ class Polynomial {
   virtual size_t Order() const = 0;
   virtual double Coef(size_t order) const = 0;
 
+  /**
+   * @brief: evaluate the value and the derivatives up to max_order at every param in one call
+   * @param params: num_params params to evaluate
+   * @param num_params: number of params
+   * @param max_order: the highest derivative order
+   * @param values: values[order][i] is the order-th derivative at params[i], order from 0 to max_order
+   */
+  virtual void EvaluateBatch(const double *params, size_t num_params,
+                             size_t max_order, double *const *values) const;
+
+  /**
+   * @brief: the params in [param0, param1] where the order-th derivative has a zero slope, the real roots of the
+   * next derivative from its coefs
+   * @param order: derivative order
+   * @param param0, param1: a param interval within [0, ParamLength()]
+   * @return: the params in ascending order
+   */
+  std::vector<double> CriticalParams(size_t order, double param0, double param1) const;
+
+  /**
+   * @brief: the exact range of the order-th derivative over [param0, param1], from its values at the interval ends
+   * and at the critical params, so a peak between the samples of a sampled check is not missed
+   * @param order: derivative order
+   * @param param0, param1: a param interval within [0, ParamLength()]
+   * @return: the lowest and the highest value
+   */
+  std::pair<double, double> DerivativeRange(size_t order, double param0, double param1) const;
+
  protected:
   double param_ = 0.0;
   size_t order_ = 0;
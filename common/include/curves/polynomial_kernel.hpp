@@ -0,0 +1,50 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYNOMIAL_KERNEL_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYNOMIAL_KERNEL_HPP_
+#include <cstddef>
+namespace common {
+/**
+ * @brief: batch evaluation of polynomials p(x) = sum(coefs[i] * x^i) and their derivatives.
+ * the kernels are vectorized with AVX (x86) or NEON (aarch64) when the compiler targets them and fall back
+ * to scalar code otherwise. every lane runs the same horner scheme as the scalar Evaluate of
+ * QuinticPolynomial and QuarticPolynomial without fused multiply-add, so the results are bit-identical.
+ */
+class PolynomialKernel {
+ public:
+  // the highest supported polynomial degree
+  static constexpr size_t kMaxDegree = 7;
+
+  /**
+   * @brief: evaluate one polynomial at every param, for every derivative order from 0 to max_order
+   * @param coefs: degree + 1 coefs, coefs[i] is the coef of x^i
+   * @param degree: degree of the polynomial
+   * @param params: num_params params to evaluate
+   * @param num_params: number of params
+   * @param max_order: the highest derivative order
+   * @param values: values[order][i] is the order-th derivative at params[i], order from 0 to max_order
+   */
+  static void Evaluate(const double *coefs, size_t degree,
+                       const double *params, size_t num_params,
+                       size_t max_order, double *const *values);
+
+  /**
+   * @brief: evaluate many polynomials of the same degree on a shared param grid, lanes run across the polynomials.
+   * @param coefs: coefs in SoA layout, coefs[i * num_polynomials + j] is the coef of x^i of the j-th polynomial
+   * @param degree: degree of the polynomials
+   * @param num_polynomials: number of polynomials
+   * @param params: num_params params to evaluate
+   * @param num_params: number of params
+   * @param max_order: the highest derivative order
+   * @param values: values[order][i * num_polynomials + j] is the order-th derivative of the j-th polynomial
+   * at params[i], order from 0 to max_order
+   */
+  static void EvaluateMultiple(const double *coefs, size_t degree, size_t num_polynomials,
+                               const double *params, size_t num_params,
+                               size_t max_order, double *const *values);
+
+  /**
+   * @brief: name of the instruction set the kernels are compiled for, "avx", "neon" or "scalar"
+   */
+  static const char *Backend();
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYNOMIAL_KERNEL_HPP_
@@ -27,6 +27,16 @@ class QuarticPolynomial : public Polynomial {
    */
   double Evaluate(size_t order, double p) const override;
 
+  /**
+   * @brief: vectorized batch evaluation, bit-identical to Evaluate
+   * @param params
+   * @param num_params
+   * @param max_order
+   * @param values
+   */
+  void EvaluateBatch(const double *params, size_t num_params,
+                     size_t max_order, double *const *values) const override;
+
   /**
    * @brief: the param length
    * @return
@@ -25,6 +25,9 @@ class QuinticPolynomial : public Polynomial {
 
   double Evaluate(size_t order, double p) const override;
 
+  void EvaluateBatch(const double *params, size_t num_params,
+                     size_t max_order, double *const *values) const override;
+
   double ParamLength() const override { return param_; }
 
   double Coef(size_t order) const override;
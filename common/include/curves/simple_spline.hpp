@@ -72,8 +72,34 @@ class spline {
                     bool force_linear_extrapolation = false);
   void set_points(const std::vector<double> &x,
                   const std::vector<double> &y, bool cubic_spline = true);
+  // cubic splines through (x, y0) and (x, y1), e.g. the x and y of a curve on the same knots, with the
+  // same boundary types, the tridiagonal system is eliminated once for both right hand sides
+  static void set_points(const std::vector<double> &x,
+                         const std::vector<double> &y0,
+                         const std::vector<double> &y1,
+                         spline *spline0, spline *spline1);
   double operator()(double x) const;
   double deriv(int order, double x) const;
+  // the segment holding x, the last knot m_x[idx] < x, 0 if x is before the second knot, the same as in operator()
+  size_t find_segment(double x) const;
+  // the segment holding x by walking from the segment hint, O(1) for the queries of increasing x
+  size_t find_segment(double x, size_t hint) const;
+  // the value and the derivatives up to max_order at x on the segment idx from find_segment, into values[0] to
+  // values[max_order], the same as operator() and deriv()
+  void evaluate(double x, size_t idx, int max_order, double *values) const;
+  // keep the segments starting at the knots [first, last) and continue with tail, whose first knot is the knot last
+  // of this spline shifted by -shift, all the kept knots are shifted by -shift. the curve is unchanged on the kept
+  // segments, it is C1 at the knot last if tail is clamped to the slope of this spline there
+  void splice(size_t first, size_t last, const spline &tail, double shift);
+  size_t size() const { return m_x.size(); }
+
+ private:
+  void store_points(const std::vector<double> &x, const std::vector<double> &y);
+  // row i of the system for b[]: lower[i]*b[i-1] + diag[i]*b[i] + upper[i]*b[i+1] = rhs[i]
+  void set_up_system(double *lower, double *diag, double *upper, double *rhs) const;
+  // a[] and c[] from b[] and the extrapolation coefficients
+  void set_cubic_coefficients();
+  void set_extrapolation();
 };
 }
 
@@ -3,18 +3,75 @@
 
 #include <vector>
 #include "simple_spline.hpp"
+#include "math/point_grid_index.hpp"
 namespace common {
+/**
+ * @brief: a point of a Spline2d and its derivatives by the chord length, only the orders evaluated are set
+ */
+struct Spline2dPoint {
+  double x = 0.0;
+  double y = 0.0;
+  double dx = 0.0;
+  double dy = 0.0;
+  double ddx = 0.0;
+  double ddy = 0.0;
+  double dddx = 0.0;
+  double dddy = 0.0;
+};
 
 class Spline2d {
  public:
+  // the orders evaluated by EvaluateAll, combined by or
+  enum EvaluationOrder : int {
+    POSITION = 1 << 0,
+    FIRST_DERIVATIVE = 1 << 1,
+    SECOND_DERIVATIVE = 1 << 2,
+    THIRD_DERIVATIVE = 1 << 3,
+    ALL_ORDERS = POSITION | FIRST_DERIVATIVE | SECOND_DERIVATIVE | THIRD_DERIVATIVE,
+  };
+
   Spline2d() = default;
   Spline2d(const std::vector<double> &xs, const std::vector<double> &ys, size_t order);
   Spline2d(const std::vector<double> &xs, const std::vector<double> &ys);
   ~Spline2d() = default;
+
+  /**
+   * @brief: turn the spline in place into the spline through xs and ys, which start at one of its points and share
+   * the following ones with it, e.g. the points of a window sliding ahead along a lane. the leading points are
+   * trimmed, and only the last shared segments and the new points are fitted again, clamped to the slope of the
+   * spline where the refit starts, so the curve is unchanged before there. the chord length starts at 0 again.
+   * @param xs
+   * @param ys
+   * @param shift: the chord length of the new first point before the refit, so the chord length of a point kept
+   * is its last one minus shift
+   * @return: false if xs and ys do not continue the spline for long enough, it is unchanged then
+   */
+  bool Refit(const std::vector<double> &xs, const std::vector<double> &ys, double *shift);
+  /**
+   * @brief: the range of the spline parameter, which is the chord length, all the evaluations take the chord length
+   */
   double ArcLength() const { return this->arc_length_; }
+  /**
+   * @brief: the length along the curve, integrated at build time
+   */
+  double CurveLength() const { return this->curve_length_; }
   const std::vector<double> &ChordLength() const { return chord_lengths_; }
   size_t Order() const { return this->order_; }
 
+  /**
+   * @brief: map the chord length to the length along the curve, O(1) by the lookup table
+   * @param t: the chord length, clamped to [0, ArcLength()]
+   * @return: the length along the curve
+   */
+  double ChordLengthToArcLength(double t) const;
+
+  /**
+   * @brief: map the length along the curve to the chord length, O(1) by the lookup table
+   * @param s: the length along the curve, clamped to [0, CurveLength()]
+   * @return: the chord length which can be passed to the evaluations
+   */
+  double ArcLengthToChordLength(double s) const;
+
   /**
    * @brief:
    * @param s
@@ -52,6 +109,25 @@ class Spline2d {
    */
   bool EvaluateThirdDerivative(double s, double *const dddx, double *const dddy) const;
 
+  /**
+   * @brief: evaluate the orders in order_mask at once, the segment holding s is searched once for all of them and
+   * for both x and y, the results are the same as those of Evaluate and Evaluate*Derivative
+   * @param s: the chord length
+   * @param order_mask: the EvaluationOrder flags
+   * @param point: [out]
+   * @return
+   */
+  bool EvaluateAll(double s, int order_mask, Spline2dPoint *point) const;
+
+  /**
+   * @brief: evaluate the orders in order_mask at every s, the segment is found by walking forward from the one of
+   * the previous s, which is O(1) per point if sorted_s is in ascending order. any order is correct, only slower.
+   * @param sorted_s: the chord lengths
+   * @param order_mask: the EvaluationOrder flags
+   * @param points: [out] the points at sorted_s
+   */
+  void EvaluateAll(const std::vector<double> &sorted_s, int order_mask, std::vector<Spline2dPoint> *points) const;
+
   /**
    * @brief: get the nearest point on spline curve
    * @param x
@@ -65,41 +141,70 @@ class Spline2d {
                                double *const nearest_y,
                                double *const nearest_s) const;
 
+  /**
+   * @brief: get the nearest point on spline curve, the nearest sample search is warm-started from the
+   * previous query, which is O(1) for monotone queries along a trajectory
+   * @param x
+   * @param y
+   * @param nearest_x
+   * @param nearest_y
+   * @param nearest_s
+   * @param hint_index: [in] the nearest sample index of the previous query, negative for a global search,
+   * [out] the nearest sample index of this query
+   * @return
+   */
+  bool GetNearestPointOnSpline(double x, double y,
+                               double *const nearest_x,
+                               double *const nearest_y,
+                               double *const nearest_s,
+                               int *const hint_index) const;
+
  private:
   /**
-   * @brief: calc arc length
+   * @brief: refine the nearest point on spline curve around the sample point min_index
+   */
+  bool GetNearestPointFromIndex(int min_index, double x, double y,
+                                double *const nearest_x,
+                                double *const nearest_y,
+                                double *const nearest_s) const;
+
+  /**
+   * @brief: the chord length clamped to the spline as in Evaluate
+   */
+  double ClampEvaluation(double s) const;
+
+  void EvaluateOnSegment(double t, size_t segment, int order_mask, Spline2dPoint *point) const;
+
+  /**
+   * @brief: calc arc length and the lookup tables between the chord length and the length along the curve
    */
   void CalcArcLength();
 
   /**
-   * @brief: calc the arc length at chord length t [0, 1]
-   * @param t
+   * @brief: the length along the curve at the uniform chord length samples by gauss legendre quadrature, and its
+   * inverse at the uniform curve length samples, both with their derivatives for the hermite interpolation
    */
-  double CalcArcLengthAtT(double t) const;
+  void CalcArcLengthTable();
 
-  double SimpsonIntegral(double t0, double t1) const;
+  /**
+   * @brief: the samples of the curve length table from first_sample on, up to the first one at or after the end
+   */
+  void CalcCurveLengthSamples(size_t first_sample);
 
   /**
-   * @brief: adaptive simpson integral
-   * @param l
-   * @param r
-   * @param eps
-   * @return
+   * @brief: the samples of the chord length table from first_sample on, up to the first one at or after the end
    */
-  double AdaptiveSimpsonIntegral(double l, double r, double eps) const;
+  void CalcChordLengthSamples(size_t first_sample);
 
   /**
-   * calculate the chord lengths,
+   * @brief: |(x'(t), y'(t))|, the derivative of the length along the curve by the chord length
    */
-  inline void CalcChordLengths();
+  double Speed(double t) const;
 
   /**
-   * @brief: given arc length, calculate chord length
-   * @param[in] s:  the input arc length
-   * @param[out] t: the normalized chord length, which in [0, 1]
-   * @return
+   * calculate the chord lengths,
    */
-  bool ArcLengthMapToChordLength(double s, double *const t) const;
+  inline void CalcChordLengths();
 
   /**
    * @brief: we setup the object function to calculate the nearest point on spline as :
@@ -147,7 +252,7 @@ class Spline2d {
   static double Clamp(double t, double lb, double ub);
 
   /**
-   * @brief: calc the nearest index
+   * @brief: calc the nearest index with the grid index of the sample points
    * @param x
    * @param y
    * @return
@@ -161,7 +266,20 @@ class Spline2d {
   spline x_spline_;
   spline y_spline_;
   double arc_length_ = 0.0;
+  double curve_length_ = 0.0;
   std::vector<double> chord_lengths_;
+  // the curve length and its derivative at the chord length chord_origin_ + i * chord_step_, the origin is only
+  // negative after a refit trimmed the spline, which keeps the samples
+  double chord_origin_ = 0.0;
+  double chord_step_ = 0.0;
+  std::vector<double> curve_length_table_;
+  std::vector<double> curve_length_derivative_table_;
+  // the chord length and its derivative at the curve length curve_origin_ + i * curve_step_
+  double curve_origin_ = 0.0;
+  double curve_step_ = 0.0;
+  std::vector<double> chord_length_table_;
+  std::vector<double> chord_length_derivative_table_;
+  PointGridIndex point_index_;
 };
 }
 #endif //CATKIN_WS_SRC_LOCAL_PLANNER_COMMON_INCLUDE_SPLINE2D_HPP_
@@ -0,0 +1,56 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MATH_ADMM_QP_SOLVER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MATH_ADMM_QP_SOLVER_HPP_
+#include <Eigen/Sparse>
+
+namespace common {
+
+/**
+ * @brief: min 0.5 * x'Px + q'x s.t. l <= Ax <= u by the ADMM of OSQP. kept across the solves, a QP of the same
+ * pattern reuses the symbolic factorization of the KKT matrix and is warm started from the last solution, so a
+ * sequence of QPs such as the linearizations of an SQP or the optimizations of the planning cycles stays cheap.
+ */
+class AdmmQpSolver {
+ public:
+  typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+  AdmmQpSolver() = default;
+  ~AdmmQpSolver() = default;
+  void set_max_iter(int max_iter) { this->max_iter_ = max_iter; }
+
+  /**
+   * @brief: set the primal warm start of the next Solve, the dual one is dropped
+   */
+  void SetWarmStart(const Eigen::VectorXd &x);
+
+  /**
+   * @brief: solve the QP, warm started from the last solution or SetWarmStart if it has as many variables. the
+   * variables pinned by a row of A with a single coefficient and l == u are set to their values exactly
+   * @return: true if the residuals converged
+   */
+  bool Solve(const SparseMatrix &P, const Eigen::VectorXd &q, const SparseMatrix &A,
+             const Eigen::VectorXd &l, const Eigen::VectorXd &u);
+
+  const Eigen::VectorXd &x() const { return x_; }
+
+ private:
+  /**
+   * @brief: the admm only meets the pinned values up to its tolerance, set them exactly
+   */
+  void SnapPinnedVariables(const SparseMatrix &A, const Eigen::VectorXd &l, const Eigen::VectorXd &u);
+
+  int max_iter_ = 4000;
+  double rho_ = 1.0;
+  double sigma_ = 1e-6;
+  double alpha_ = 1.6;
+  // the admm iterates, the primal, the constraint values and the dual
+  Eigen::VectorXd x_;
+  Eigen::VectorXd z_;
+  Eigen::VectorXd y_;
+  Eigen::SimplicialLDLT<SparseMatrix> kkt_solver_;
+  // the dimension and the non zeros kkt_solver_ analyzed the pattern for
+  Eigen::Index num_analyzed_variables_ = 0;
+  Eigen::Index num_analyzed_non_zeros_ = 0;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MATH_ADMM_QP_SOLVER_HPP_
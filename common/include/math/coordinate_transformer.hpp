@@ -3,9 +3,48 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MATH_COORDINATE_TRANSFORMER_HPP_
 
 #include <array>
+#include <vector>
 #include <Eigen/src/Core/Matrix.h>
 namespace common {
 
+/**
+ * @brief: the frenet states of a batch of points and their matched reference points, one array per field
+ */
+struct FrenetBatch {
+  std::vector<double> rx;
+  std::vector<double> ry;
+  std::vector<double> rtheta;
+  std::vector<double> rkappa;
+  std::vector<double> rdkappa;
+  std::vector<double> s_dot;
+  std::vector<double> s_dot_dot;
+  std::vector<double> d;
+  std::vector<double> d_prime;
+  std::vector<double> d_prime_prime;
+
+  size_t Size() const { return rx.size(); }
+  /**
+   * @brief: drop the points, the capacity is kept
+   */
+  void Clear(size_t capacity);
+  void Append(double ref_x, double ref_y, double ref_theta, double ref_kappa, double ref_dkappa,
+              const std::array<double, 3> &s_condition, const std::array<double, 3> &d_condition);
+};
+
+/**
+ * @brief: the cartesian states of a batch of points, one array per field
+ */
+struct CartesianBatch {
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> theta;
+  std::vector<double> kappa;
+  std::vector<double> v;
+  std::vector<double> a;
+
+  size_t Size() const { return x.size(); }
+  void Resize(size_t size);
+};
 
 // apollo and the reference paper
 
@@ -38,6 +77,31 @@ class CoordinateTransformer {
                                 double *ptr_theta, double *ptr_kappa,
                                 double *ptr_v, double *ptr_a);
 
+  /**
+   * @brief: FrenetToCartesian of every point of the batch in one loop over contiguous arrays without a branch. the
+   * sine and cosine of the reference heading are taken together and the cosine of the heading difference is
+   * algebraic instead of a cosine of the atan2.
+   * @param frenet
+   * @param cartesian: resized to the size of the batch
+   */
+  static void FrenetToCartesian(const FrenetBatch &frenet, CartesianBatch *cartesian);
+
+  /**
+   * @brief: the position only CartesianToFrenet of every point, all the arrays have the size of x
+   * @param rtheta: the headings of the matched reference points
+   * @param rx
+   * @param ry
+   * @param x
+   * @param y
+   * @param d: resized to the size of x, the s of a point is the s of its matched reference point
+   */
+  static void CartesianToFrenet(const std::vector<double> &rtheta,
+                                const std::vector<double> &rx,
+                                const std::vector<double> &ry,
+                                const std::vector<double> &x,
+                                const std::vector<double> &y,
+                                std::vector<double> *d);
+
   static double CalcTheta(double rtheta, double rkappa,
                           double l, double dl);
 
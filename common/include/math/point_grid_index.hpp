@@ -0,0 +1,89 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POINT_GRID_INDEX_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POINT_GRID_INDEX_HPP_
+#include <cstddef>
+#include <vector>
+namespace common {
+/**
+ * @brief: uniform grid over the points of a polyline for the nearest point query.
+ * the query visits the cells ring by ring around the query point and stops as soon as no unvisited cell can hold
+ * a closer point, so it only touches the points around the query instead of all of them.
+ */
+class PointGridIndex {
+ public:
+  PointGridIndex() = default;
+  ~PointGridIndex() = default;
+
+  /**
+   * @brief: build the grid, the cell size is derived from the mean gap between neighbouring points
+   * @param xs
+   * @param ys
+   */
+  PointGridIndex(const std::vector<double> &xs, const std::vector<double> &ys);
+
+  /**
+   * @brief: build the grid with the given cell size, for the scattered points which are no polyline
+   * @param xs
+   * @param ys
+   * @param cell_size
+   */
+  PointGridIndex(const std::vector<double> &xs, const std::vector<double> &ys, double cell_size);
+
+  bool Empty() const { return xs_.empty(); }
+
+  size_t Size() const { return xs_.size(); }
+
+  /**
+   * @brief: the index of the nearest point, ties are broken by the smaller index as in a linear scan
+   * @param x
+   * @param y
+   * @return: index of the nearest point, 0 if the index is empty
+   */
+  size_t Nearest(double x, double y) const;
+
+  /**
+   * @brief: walk along the polyline from hint_index downhill to the locally nearest point.
+   * this is O(1) for the monotone queries along a trajectory, whose nearest point is next to the previous one.
+   * @param x
+   * @param y
+   * @param hint_index: the nearest index of the previous query
+   * @return: index of the locally nearest point
+   */
+  size_t NearestFromHint(double x, double y, size_t hint_index) const;
+
+  /**
+   * @brief: the indices of the points within radius of (x, y), only the cells overlapping the circle are visited
+   * @param x
+   * @param y
+   * @param radius
+   * @param indices: the indices in ascending order as in a linear scan
+   */
+  void WithinRadius(double x, double y, double radius, std::vector<size_t> *indices) const;
+
+ private:
+  /**
+   * @brief: sort the points into the cells of cell_size, which grows until the grid is small enough
+   */
+  void Build(double cell_size);
+
+  double SquaredDistance(size_t index, double x, double y) const;
+
+  /**
+   * @brief: visit the points in the cells at chebyshev distance ring from (cell_x, cell_y)
+   */
+  void SearchRing(long cell_x, long cell_y, long ring, double x, double y,
+                  size_t *nearest_index, double *nearest_dist_sqr) const;
+
+ private:
+  std::vector<double> xs_;
+  std::vector<double> ys_;
+  double min_x_ = 0.0;
+  double min_y_ = 0.0;
+  double cell_size_ = 1.0;
+  long num_cells_x_ = 0;
+  long num_cells_y_ = 0;
+  // points of cell i are cell_points_[cell_starts_[i], cell_starts_[i + 1]), cell i = cell_y * num_cells_x_ + cell_x
+  std::vector<size_t> cell_starts_;
+  std::vector<size_t> cell_points_;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POINT_GRID_INDEX_HPP_
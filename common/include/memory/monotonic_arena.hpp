@@ -0,0 +1,116 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MEMORY_MONOTONIC_ARENA_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MEMORY_MONOTONIC_ARENA_HPP_
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace common {
+
+/**
+ * @brief: monotonic buffer for the temporaries of one planning cycle. an allocation bumps an offset into the current
+ * block, nothing is freed until Reset, which releases everything at once and keeps the memory for the next cycle.
+ * not thread safe, every thread allocating concurrently needs its own arena.
+ */
+class MonotonicArena {
+ public:
+  /**
+   * @param block_size: the size of the first block and the least size of the blocks added when it runs out, in bytes
+   */
+  explicit MonotonicArena(size_t block_size = 64 * 1024);
+  ~MonotonicArena() = default;
+  MonotonicArena(const MonotonicArena &) = delete;
+  MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+  /**
+   * @param bytes
+   * @param alignment: a power of two
+   * @return: never nullptr, throws std::bad_alloc like operator new
+   */
+  void *Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * @brief: release every allocation, the objects in the arena have to be destroyed before. the blocks are merged
+   * into one as large as all of them, so a cycle no larger than the last one allocates nothing from the heap
+   */
+  void Reset();
+
+  // the bytes handed out since the last reset, with the alignment padding
+  size_t BytesUsed() const { return bytes_used_; }
+  size_t Capacity() const;
+  size_t NumBlocks() const { return blocks_.size(); }
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+
+  void AddBlock(size_t size);
+
+ private:
+  size_t block_size_;
+  std::vector<Block> blocks_;
+  size_t current_block_ = 0;
+  size_t offset_ = 0;
+  size_t bytes_used_ = 0;
+};
+
+/**
+ * @brief: the stl allocator on an arena, deallocate is a no-op. without an arena it falls back to the heap, so the
+ * same container type serves both. the arena propagates with the container on copy, move and swap, a container
+ * built on an arena must not outlive its reset.
+ */
+template<class T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  explicit ArenaAllocator(MonotonicArena *arena = nullptr) noexcept : arena_(arena) {}
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena_(other.arena()) {}
+
+  T *allocate(size_t n) {
+    if (arena_ == nullptr) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, size_t) noexcept {
+    if (arena_ == nullptr) {
+      ::operator delete(p);
+    }
+  }
+
+  MonotonicArena *arena() const { return arena_; }
+
+ private:
+  MonotonicArena *arena_;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return !(lhs == rhs);
+}
+
+/**
+ * @brief: std::make_shared with the object and its control block in the arena, or on the heap if arena is nullptr
+ */
+template<class T, class... Args>
+std::shared_ptr<T> MakeShared(MonotonicArena *arena, Args &&... args) {
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_MEMORY_MONOTONIC_ARENA_HPP_
@@ -9,6 +9,7 @@ const std::string kCarlaActorListName = "/carla/actor_list";
 const std::string kEgoVehicleControlName = "/carla/ego_vehicle/vehicle_control_cmd";                           //NOLINT
 const std::string kObjectsName = "/carla/objects";                                                             //NOLINT
 const std::string kPublishedTrajectoryName = "/motion_planner/published_trajectory";                           //NOLINT
+const std::string kPublishedCompactTrajectoryName = "/motion_planner/published_compact_trajectory";            //NOLINT
 const std::string kEgoVehicleInfoName = "/carla/ego_vehicle/vehicle_info";                                     //NOLINT
 const std::string kEgoVehicleOdometryName = "/carla/ego_vehicle/odometry";                                     //NOLINT
 const std::string kVisualizedTrajectoryName = "/motion_planner/visualized_trajectory";                      //NOLINT
@@ -23,6 +24,8 @@ const std::string kBehaviourName = "/behaviour_planner/behaviour";
 const std::string kVisualizedObstacleTrajectoriesName = "/motion_planner/visualized_obstacle_trajectries";     //NOLINT
 const std::string kVisualizedObstacleInfoName = "/motion_planner/visualized_obstacle_infos";                    //NOLINT
 const std::string kEgoVehicleVisualizedName = "/motion_planner/visualized_ego_vehicle";                         //NOLINT
+const std::string kPlanningStageDiagnosticsName = "/motion_planner/stage_diagnostics";                          //NOLINT
+const std::string kPlanningRouteName = "/motion_planner/route";                                                 //NOLINT
 }
 
 namespace service {
@@ -31,6 +34,8 @@ const std::string kGetActorWaypointServiceName = "/carla_waypoint_publisher/ego_
 const std::string kGetEgoWaypontServiceName = "/carla_waypoint_publisher/ego_vehicle/get_waypoint";             //NOLINT
 const std::string
     kGetAgentPotentialRouteServiceName = "/carla_client_interface/ego_vehicle/agent_potential_routes"; //NOLINT
+// relative to the private namespace of the planner process, see profiler/trace_dump_service.hpp
+const std::string kDumpTraceServiceName = "dump_trace";                                                         //NOLINT
 
 }
 }
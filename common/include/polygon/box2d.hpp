@@ -2,6 +2,8 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_BOX2D_HPP_
 //from apollo
 #include <Eigen/Core>
+#include <array>
+#include <limits>
 #include <vector>
 
 namespace common {
@@ -24,9 +26,17 @@ class Box2d {
   // the diagonal length
   double diagonal() const;
   std::vector<Eigen::Vector2d> GetAllCorners() const;
+  /**
+   * @brief: the corners in counter-clockwise order, stored inline, so querying them does not allocate
+   */
+  const std::array<Eigen::Vector2d, 4> &Corners() const;
   bool IsPointIn(const Eigen::Vector2d &point) const;
   bool IsPointOnBoundary(const Eigen::Vector2d &point) const;
   double DistanceToPoint(const Eigen::Vector2d &poiny) const;
+  /**
+   * @brief: the distance between the boxes, 0 if they overlap
+   */
+  double DistanceTo(const Box2d &box) const;
   bool HasOverlapWithBox2d(const Box2d &box) const;
   void RotateFromCenter(double rotate_angle);
   void Shift(const Eigen::Vector2d &shift_vec);
@@ -48,7 +58,8 @@ class Box2d {
 
   double cos_heading_ = 1.0;
   double sin_heading_ = 0.0;
-  std::vector<Eigen::Vector2d> corners_;
+  std::array<Eigen::Vector2d, 4> corners_{{Eigen::Vector2d::Zero(), Eigen::Vector2d::Zero(),
+                                           Eigen::Vector2d::Zero(), Eigen::Vector2d::Zero()}};
   double max_x_ = std::numeric_limits<double>::lowest();
   double min_x_ = std::numeric_limits<double>::max();
   double max_y_ = std::numeric_limits<double>::lowest();
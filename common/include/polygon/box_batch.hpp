@@ -0,0 +1,84 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_BOX_BATCH_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_BOX_BATCH_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "polygon/box2d.hpp"
+
+namespace common {
+/**
+ * @brief: boxes in plain arrays, one per field, so the overlap test of one box against all of them runs over the
+ * arrays without branches and the compiler vectorizes it
+ */
+class BoxBatch {
+ public:
+  BoxBatch() = default;
+  ~BoxBatch() = default;
+
+  /**
+   * @brief: the batch of the boxes, in their order
+   * @param boxes
+   */
+  explicit BoxBatch(const std::vector<Box2d> &boxes);
+
+  void Reserve(size_t capacity);
+
+  void PushBack(const Box2d &box);
+
+  void Clear();
+
+  size_t Size() const { return center_xs_.size(); }
+
+  bool Empty() const { return center_xs_.empty(); }
+
+  const double *center_xs() const { return center_xs_.data(); }
+  const double *center_ys() const { return center_ys_.data(); }
+  const double *cos_headings() const { return cos_headings_.data(); }
+  const double *sin_headings() const { return sin_headings_.data(); }
+  const double *half_lengths() const { return half_lengths_.data(); }
+  const double *half_widths() const { return half_widths_.data(); }
+  const double *min_xs() const { return min_xs_.data(); }
+  const double *max_xs() const { return max_xs_.data(); }
+  const double *min_ys() const { return min_ys_.data(); }
+  const double *max_ys() const { return max_ys_.data(); }
+
+ private:
+  std::vector<double> center_xs_;
+  std::vector<double> center_ys_;
+  std::vector<double> cos_headings_;
+  std::vector<double> sin_headings_;
+  std::vector<double> half_lengths_;
+  std::vector<double> half_widths_;
+  // the bounding boxes, for the same early rejection as Box2d::HasOverlapWithBox2d
+  std::vector<double> min_xs_;
+  std::vector<double> max_xs_;
+  std::vector<double> min_ys_;
+  std::vector<double> max_ys_;
+};
+
+/**
+ * @brief: ego.HasOverlapWithBox2d(box) for the boxes [first, last) of the batch, the terms of ego are computed once
+ * and the four axes are tested across the boxes. the results equal those of the pairwise test
+ * @param ego
+ * @param boxes
+ * @param first
+ * @param last
+ * @param mask: [out] 1 for the boxes overlapping ego, 0 for the others, from the box first on
+ */
+void OverlapMask(const Box2d &ego, const BoxBatch &boxes, size_t first, size_t last, uint8_t *mask);
+
+/**
+ * @brief: whether ego overlaps any of the boxes [first, last) of the batch, the boxes are tested in blocks and the
+ * test stops after the first block with an overlap
+ * @param ego
+ * @param boxes
+ * @param first
+ * @param last
+ * @return
+ */
+bool OverlapAny(const Box2d &ego, const BoxBatch &boxes, size_t first, size_t last);
+
+bool OverlapAny(const Box2d &ego, const BoxBatch &boxes);
+}
+
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_BOX_BATCH_HPP_
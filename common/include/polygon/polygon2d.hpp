@@ -0,0 +1,97 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYGON2D_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYGON2D_HPP_
+#include <Eigen/Core>
+#include <array>
+#include <limits>
+#include <vector>
+#include "polygon/box2d.hpp"
+
+namespace common {
+/**
+ * @brief: convex polygon with at most kMaxNumVertices vertices stored inline.
+ * the vertices are kept in SoA layout and the unused slots repeat the last vertex, so the projections of the
+ * separating axis test run over all slots without branches.
+ */
+class Polygon2d {
+ public:
+  static constexpr size_t kMaxNumVertices = 8;
+
+  Polygon2d() = default;
+  ~Polygon2d() = default;
+
+  explicit Polygon2d(const Box2d &box);
+
+  /**
+   * @brief: the convex hull of points
+   * @param points
+   * @param polygon
+   * @return: false if the hull is degenerate or has more than kMaxNumVertices vertices
+   */
+  static bool FromConvexHull(const std::vector<Eigen::Vector2d> &points, Polygon2d *polygon);
+
+  /**
+   * @brief: box with its corners cut, the cut edges join the points lon_chamfer before the corners along the
+   * heading and lat_chamfer before them across it. for a box inflated by lon and lat buffers this is the raw box
+   * inflated by a diamond, it keeps the full buffers ahead and beside the raw box but not at its corners.
+   * @param box
+   * @param lon_chamfer
+   * @param lat_chamfer
+   * @return
+   */
+  static Polygon2d ChamferedBox(const Box2d &box, double lon_chamfer, double lat_chamfer);
+
+  size_t NumOfVertices() const { return num_vertices_; }
+
+  Eigen::Vector2d Vertex(size_t index) const { return {xs_[index], ys_[index]}; }
+
+  /**
+   * @brief: the vertices in counter-clockwise order
+   */
+  std::vector<Eigen::Vector2d> GetAllVertices() const;
+
+  double area() const;
+
+  bool IsPointIn(const Eigen::Vector2d &point) const;
+
+  /**
+   * @brief: separating axis test, touching polygons overlap
+   * @param polygon
+   * @return
+   */
+  bool HasOverlapWithPolygon2d(const Polygon2d &polygon) const;
+
+  bool HasOverlapWithBox2d(const Box2d &box) const { return HasOverlapWithPolygon2d(Polygon2d(box)); }
+
+  double max_x() const { return max_x_; }
+  double min_x() const { return min_x_; }
+  double max_y() const { return max_y_; }
+  double min_y() const { return min_y_; }
+
+ private:
+  /**
+   * @brief: pad the unused slots and compute the bounds, the vertices [0, num_vertices_) are set
+   */
+  void Init();
+
+  /**
+   * @brief: the range of the projections of the vertices on (nx, ny)
+   */
+  void Project(double nx, double ny, double *min_proj, double *max_proj) const;
+
+  /**
+   * @brief: whether an edge normal of this polygon separates it from polygon
+   */
+  bool HasSeparatingAxis(const Polygon2d &polygon) const;
+
+ private:
+  std::array<double, kMaxNumVertices> xs_{};
+  std::array<double, kMaxNumVertices> ys_{};
+  size_t num_vertices_ = 0;
+  double max_x_ = std::numeric_limits<double>::lowest();
+  double min_x_ = std::numeric_limits<double>::max();
+  double max_y_ = std::numeric_limits<double>::lowest();
+  double min_y_ = std::numeric_limits<double>::max();
+};
+}
+
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_POLYGON2D_HPP_
@@ -0,0 +1,132 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_STAGE_PROFILER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_STAGE_PROFILER_HPP_
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "profiler/trace_recorder.hpp"
+
+namespace common {
+/**
+ * @brief: HDR style histogram of latencies in microseconds. every power of two is split into kSubBuckets linear
+ * buckets, so a percentile is off by less than 1 / kSubBuckets of its value whatever the magnitude, in a fixed
+ * array without any allocation on Record.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram() = default;
+  ~LatencyHistogram() = default;
+
+  /**
+   * @brief: record a latency, the ones beyond about an hour fall into the last bucket
+   * @param seconds
+   */
+  void Record(double seconds);
+
+  /**
+   * @param percentile: in [0, 100]
+   * @return: the upper bound of the bucket holding the percentile in seconds, 0 if nothing is recorded
+   */
+  double Percentile(double percentile) const;
+
+  double Max() const { return static_cast<double>(max_) * 1e-6; }
+  double Mean() const { return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_); }
+  uint64_t Count() const { return count_; }
+
+  void Merge(const LatencyHistogram &other);
+  void Reset();
+
+ private:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxValueBits = 32;
+  static constexpr size_t kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  static size_t BucketIndex(uint64_t micros);
+  static uint64_t BucketUpperBound(size_t index);
+
+ private:
+  std::array<uint64_t, kNumBuckets> counts_{};
+  uint64_t count_ = 0;
+  uint64_t max_ = 0;
+  double sum_ = 0.0;
+};
+
+/**
+ * @brief: the summary of a stage over the recorded latencies, in seconds
+ */
+struct StageStatistics {
+  std::string name;
+  uint64_t count = 0;
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+};
+
+/**
+ * @brief: a latency histogram per named stage, recorded from any thread
+ */
+class StageProfiler {
+ public:
+  StageProfiler() = default;
+  ~StageProfiler() = default;
+
+  void Record(const char *stage, double seconds);
+
+  /**
+   * @return: the statistics of every stage, in the order they were first recorded
+   */
+  std::vector<StageStatistics> GetStatistics() const;
+
+  /**
+   * @brief: clear the histograms, the stages and their order are kept
+   */
+  void Reset();
+
+ private:
+  mutable std::mutex mutex_;
+  // only a handful of stages, a linear search is cheaper than hashing the name
+  std::vector<std::pair<std::string, LatencyHistogram>> stages_;
+};
+
+/**
+ * @brief: records the steady clock time from its construction to Stop or its destruction under the stage, does
+ * nothing without a profiler. with PLANNING_TRACING the time is also recorded as a trace zone, with or without one.
+ */
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(StageProfiler *profiler, const char *stage)
+      : profiler_(profiler), stage_(stage), begin_(std::chrono::steady_clock::now()) {}
+  ~ScopedStageTimer() { Stop(); }
+
+  /**
+   * @brief: record the time so far, for a stage that ends before the scope, the later calls do nothing
+   */
+  void Stop() {
+    if (is_stopped_) {
+      return;
+    }
+    is_stopped_ = true;
+    const auto end = std::chrono::steady_clock::now();
+    if (profiler_ != nullptr) {
+      profiler_->Record(stage_, std::chrono::duration<double>(end - begin_).count());
+    }
+#ifdef PLANNING_TRACING
+    TraceRecorder::Instance().RecordZone(stage_, TraceRecorder::ToNanos(begin_), TraceRecorder::ToNanos(end));
+#endif
+  }
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+ private:
+  StageProfiler *profiler_;
+  const char *stage_;
+  std::chrono::steady_clock::time_point begin_;
+  bool is_stopped_ = false;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_STAGE_PROFILER_HPP_
@@ -0,0 +1,30 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_DUMP_SERVICE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_DUMP_SERVICE_HPP_
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <memory>
+#include <common/DumpTrace.h>
+
+namespace common {
+/**
+ * @brief: the service writing the trace of the TraceRecorder to the requested path. the recorder is per process,
+ * so there is one service per process. it is spun by its own thread, a dump never stalls a planning cycle.
+ */
+class TraceDumpService {
+ public:
+  /**
+   * @param nh: the service is advertised as kDumpTraceServiceName in its namespace
+   */
+  explicit TraceDumpService(ros::NodeHandle nh);
+  ~TraceDumpService();
+
+ private:
+  bool DumpTrace(DumpTrace::Request &request, DumpTrace::Response &response);
+
+ private:
+  ros::CallbackQueue callback_queue_;
+  ros::ServiceServer service_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_DUMP_SERVICE_HPP_
@@ -0,0 +1,123 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_RECORDER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_RECORDER_HPP_
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace common {
+enum class TraceEventType : uint8_t {
+  ZONE = 0,
+  FLOW_BEGIN = 1,
+  FLOW_END = 2,
+};
+
+/**
+ * @brief: records the trace zones and the task flows of every thread into a ring buffer owned by the thread, so
+ * recording takes no lock. the rings keep the last kEventsPerThread events of each thread and are written as
+ * chrome trace json, which perfetto and chrome://tracing open. the zones are only recorded through the
+ * PLANNING_TRACE_ macros, which compile to nothing unless PLANNING_TRACING is defined.
+ */
+class TraceRecorder {
+ public:
+  static constexpr uint64_t kEventsPerThread = 1 << 14;
+
+  static TraceRecorder &Instance();
+
+  /**
+   * @brief: the steady clock time since the recorder was created, in nanoseconds
+   */
+  static uint64_t NowNanos();
+  static uint64_t ToNanos(std::chrono::steady_clock::time_point time);
+
+  /**
+   * @param name: must outlive the recorder, usually a string literal
+   */
+  void RecordZone(const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+  /**
+   * @brief: a flow arrow from the thread of the FLOW_BEGIN to the zone enclosing the FLOW_END of the same id
+   * @param type: FLOW_BEGIN or FLOW_END
+   * @param name: must outlive the recorder, usually a string literal
+   * @param flow_id: from NewFlowId
+   */
+  void RecordFlow(TraceEventType type, const char *name, uint64_t flow_id);
+
+  uint64_t NewFlowId() { return next_flow_id_.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief: write the events in the rings as chrome trace json, while the threads keep recording
+   * @param out
+   * @return: the number of written events
+   */
+  size_t WriteChromeTrace(std::ostream *out) const;
+
+ private:
+  TraceRecorder();
+
+  /**
+   * @brief: the fields are atomics, so the dump may read a slot the owner overwrites, the torn ones are dropped
+   */
+  struct Event {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> begin_ns{0};
+    // the end of a zone, the id of a flow
+    std::atomic<uint64_t> value{0};
+    std::atomic<uint8_t> type{0};
+  };
+
+  struct ThreadBuffer {
+    int tid = 0;
+    std::string thread_name;
+    // the events ever recorded, event i is in slot i % kEventsPerThread
+    std::atomic<uint64_t> num_events{0};
+    std::unique_ptr<Event[]> events;
+  };
+
+  ThreadBuffer *CurrentBuffer();
+
+  void Record(TraceEventType type, const char *name, uint64_t begin_ns, uint64_t value);
+
+ private:
+  const std::chrono::steady_clock::time_point epoch_;
+  std::atomic<uint64_t> next_flow_id_{1};
+  // only locked when a thread records its first event and by the dump
+  mutable std::mutex buffers_mutex_;
+  // kept after their threads exit, so the dump still shows them
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+/**
+ * @brief: records the time from its construction to its destruction as a zone of the calling thread
+ */
+class TraceZone {
+ public:
+  explicit TraceZone(const char *name) : name_(name), begin_ns_(TraceRecorder::NowNanos()) {}
+  ~TraceZone() { TraceRecorder::Instance().RecordZone(name_, begin_ns_, TraceRecorder::NowNanos()); }
+  TraceZone(const TraceZone &) = delete;
+  TraceZone &operator=(const TraceZone &) = delete;
+
+ private:
+  const char *name_;
+  uint64_t begin_ns_;
+};
+}
+
+#ifdef PLANNING_TRACING
+#define PLANNING_TRACE_CONCAT_INNER(a, b) a##b
+#define PLANNING_TRACE_CONCAT(a, b) PLANNING_TRACE_CONCAT_INNER(a, b)
+#define PLANNING_TRACE_ZONE(name) ::common::TraceZone PLANNING_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define PLANNING_TRACE_FLOW_BEGIN(name, flow_id) \
+  ::common::TraceRecorder::Instance().RecordFlow(::common::TraceEventType::FLOW_BEGIN, name, flow_id)
+#define PLANNING_TRACE_FLOW_END(name, flow_id) \
+  ::common::TraceRecorder::Instance().RecordFlow(::common::TraceEventType::FLOW_END, name, flow_id)
+#else
+#define PLANNING_TRACE_ZONE(name) static_cast<void>(0)
+#define PLANNING_TRACE_FLOW_BEGIN(name, flow_id) static_cast<void>(0)
+#define PLANNING_TRACE_FLOW_END(name, flow_id) static_cast<void>(0)
+#endif
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_PROFILER_TRACE_RECORDER_HPP_
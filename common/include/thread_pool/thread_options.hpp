@@ -0,0 +1,69 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_THREAD_POOL_THREAD_OPTIONS_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_THREAD_POOL_THREAD_OPTIONS_HPP_
+
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace common {
+/**
+ * @brief: the os scheduling of a thread, the defaults leave the thread as it is
+ */
+struct ThreadOptions {
+  // shown by top and perf, linux truncates it to 15 characters
+  std::string name;
+  // the cores the thread may run on, empty for all of them
+  std::vector<int> cpus;
+  // > 0 runs the thread under SCHED_FIFO with this priority, which usually needs CAP_SYS_NICE
+  int fifo_priority = 0;
+  // the nice level of a thread that is not under SCHED_FIFO
+  int nice_level = 0;
+};
+
+/**
+ * @brief: apply options to the calling thread, every option is tried even if a previous one failed
+ * @param options
+ * @param name: the thread name, overrides options.name if not empty
+ * @return: false if any option could not be applied, e.g. for lack of permissions
+ */
+inline bool ConfigureCurrentThread(const ThreadOptions &options, const std::string &name = "") {
+  bool success = true;
+#if defined(__linux__)
+  const std::string &thread_name = name.empty() ? options.name : name;
+  if (!thread_name.empty()) {
+    success &= pthread_setname_np(pthread_self(), thread_name.substr(0, 15).c_str()) == 0;
+  }
+  if (!options.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : options.cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    }
+    success &= pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+  }
+  if (options.fifo_priority > 0) {
+    sched_param param{};
+    param.sched_priority = options.fifo_priority;
+    success &= pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+  } else if (options.nice_level != 0) {
+    // the nice level of a linux thread is set through its thread id
+    success &= setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice_level) == 0;
+  }
+#else
+  success = options.name.empty() && name.empty() && options.cpus.empty() && options.fifo_priority <= 0
+      && options.nice_level == 0;
+#endif
+  return success;
+}
+}
+
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_THREAD_POOL_THREAD_OPTIONS_HPP_
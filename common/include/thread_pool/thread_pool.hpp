@@ -1,64 +1,279 @@
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_THREAD_POOL_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_THREAD_POOL_HPP_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#include "profiler/trace_recorder.hpp"
+#include "thread_pool/thread_options.hpp"
 
 namespace common {
 
+/**
+ * @brief: the load of a thread pool since its statistics were reset
+ */
+struct ThreadPoolStatistics {
+  uint64_t num_tasks = 0;
+  // the tasks queued now and at most
+  int queue_depth = 0;
+  int max_queue_depth = 0;
+  // the time from queueing a task until a thread starts it, in seconds
+  double mean_latency = 0.0;
+  double max_latency = 0.0;
+};
+
+/**
+ * @brief: work-stealing thread pool. every worker owns a lock-free deque, it pushes and pops its own tasks at the
+ * bottom while the idle workers steal from the top. the tasks pushed from outside the pool go through a shared
+ * queue. the threads waiting on a ParallelFor run the queued tasks meanwhile, so ParallelFor may be nested in
+ * the tasks of the same pool.
+ */
 class ThreadPool {
  public:
   // If the input pool_size < 1, it will be fixed to 1.
   ThreadPool(int pool_size = 1);
+
+  /**
+   * @param pool_size
+   * @param thread_options: applied to every worker, which is named after thread_options.name and its index
+   * @param collect_statistics: track the queue depth and the task latency, costs two clock reads per task
+   */
+  ThreadPool(int pool_size, const ThreadOptions &thread_options, bool collect_statistics);
   ~ThreadPool();
 
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
   // Get the size (thread number) of thread pool.
   int Size() const;
 
+  const std::string &Name() const { return name_; }
+
+  /**
+   * @brief: false if a worker failed to apply the thread options, e.g. for lack of permissions
+   */
+  bool ThreadOptionsApplied() const { return num_failed_workers_.load() == 0; }
+
+  ThreadPoolStatistics GetStatistics() const;
+
+  void ResetStatistics();
+
   template<class Func, class... Args>
   std::future<typename std::result_of<Func(Args...)>::type> PushTask(
       Func &&f, Args &&... args);
 
+  /**
+   * @brief: call func(i) for every i in [begin, end), in chunks of grain indices shared among the calling thread
+   * and the workers. blocks until all calls returned, without allocating. func must not throw.
+   * @param begin
+   * @param end
+   * @param grain: the number of indices a thread claims at once, 1 for expensive calls
+   * @param func
+   */
+  template<class Func>
+  void ParallelFor(size_t begin, size_t end, size_t grain, Func &&func);
+
+ private:
+  class Task {
+   public:
+    virtual ~Task() = default;
+    virtual void Run() = 0;
+    // only set if the statistics are collected
+    std::chrono::steady_clock::time_point enqueue_time;
+    // links the queueing thread to the run in the trace, only set with PLANNING_TRACING
+    uint64_t trace_flow_id = 0;
+  };
+
+  template<class R>
+  class PackagedTask : public Task {
+   public:
+    explicit PackagedTask(std::packaged_task<R()> task) : task_(std::move(task)) {}
+    void Run() override {
+      task_();
+      delete this;
+    }
+   private:
+    std::packaged_task<R()> task_;
+  };
+
+  /**
+   * @brief: the shared state of a ParallelFor, lives on the stack of the calling thread. it is queued once per
+   * helper and every run claims chunks until the range is exhausted.
+   */
+  class ForkJoinRegion : public Task {
+   public:
+    ForkJoinRegion(size_t begin, size_t end, size_t grain, void *func, void (*invoke)(void *, size_t),
+                   int num_helpers)
+        : next_(begin), end_(end), grain_(grain), func_(func), invoke_(invoke), num_helpers_(num_helpers) {}
+    void Run() override {
+      RunChunks();
+      num_helpers_.fetch_sub(1, std::memory_order_release);
+    }
+    void RunChunks() {
+      while (true) {
+        const size_t chunk_begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+        if (chunk_begin >= end_) {
+          return;
+        }
+        const size_t chunk_end = std::min(chunk_begin + grain_, end_);
+        for (size_t i = chunk_begin; i < chunk_end; ++i) {
+          invoke_(func_, i);
+        }
+      }
+    }
+    bool Done() const { return num_helpers_.load(std::memory_order_acquire) == 0; }
+   private:
+    std::atomic<size_t> next_;
+    const size_t end_;
+    const size_t grain_;
+    void *const func_;
+    void (*const invoke_)(void *, size_t);
+    // the queued runs that have not finished yet
+    std::atomic<int> num_helpers_;
+  };
+
+  /**
+   * @brief: fixed capacity chase-lev deque, Push and Take by the owner only, Steal by any thread
+   */
+  class WorkStealingDeque {
+   public:
+    static constexpr int64_t kCapacity = 1024;
+    WorkStealingDeque() {
+      for (auto &slot : buffer_) {
+        slot.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    bool Push(Task *task) {
+      const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+      const int64_t top = top_.load(std::memory_order_acquire);
+      if (bottom - top >= kCapacity) {
+        return false;
+      }
+      buffer_[bottom & (kCapacity - 1)].store(task, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return true;
+    }
+    Task *Take() {
+      const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+      bottom_.store(bottom, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t top = top_.load(std::memory_order_relaxed);
+      if (top > bottom) {
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      Task *task = buffer_[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+      if (top == bottom) {
+        // the last task, race the thieves for it
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          task = nullptr;
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+      }
+      return task;
+    }
+    Task *Steal() {
+      int64_t top = top_.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const int64_t bottom = bottom_.load(std::memory_order_acquire);
+      if (top >= bottom) {
+        return nullptr;
+      }
+      Task *task = buffer_[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+      }
+      return task;
+    }
+   private:
+    std::atomic<int64_t> top_{0};
+    std::atomic<int64_t> bottom_{0};
+    std::array<std::atomic<Task *>, kCapacity> buffer_;
+  };
+
+  struct WorkerContext {
+    const ThreadPool *pool = nullptr;
+    int index = -1;
+  };
+
+  static WorkerContext &CurrentWorker();
+
+  /**
+   * @brief: the index of the calling thread among the workers of this pool, -1 for the other threads
+   */
+  int WorkerIndex() const;
+
+  void Schedule(Task *task);
+
+  /**
+   * @brief: run one queued task, the own deque first, then the shared queue, then the other deques
+   * @return: false if no task was found
+   */
+  bool RunOneTask(int worker_index);
+
+  void WorkerLoop(int worker_index, const ThreadOptions &thread_options);
+
+  void RecordLatency(const Task &task);
+
  private:
   int pool_size_;
-  bool shutdown_;
+  std::string name_;
+  const bool collect_statistics_ = false;
+  std::atomic<bool> shutdown_;
+  std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
   std::vector<std::thread> thread_list_;
-  std::queue<std::function<void()>> task_queue_;
+  // the tasks pushed from outside the pool, or beyond the capacity of a deque
+  std::deque<Task *> task_queue_;
+  std::atomic<int> num_shared_tasks_{0};
+  // the tasks queued anywhere, the workers only sleep while it is 0
+  std::atomic<int> num_queued_tasks_{0};
+  std::atomic<int> num_sleeping_{0};
   std::mutex mtx_;
   std::condition_variable cv_;
+  std::atomic<int> num_started_workers_{0};
+  std::atomic<int> num_failed_workers_{0};
+
+  std::atomic<uint64_t> num_tasks_{0};
+  std::atomic<int> max_queue_depth_{0};
+  std::atomic<uint64_t> total_latency_ns_{0};
+  std::atomic<uint64_t> max_latency_ns_{0};
 };
 
-inline ThreadPool::ThreadPool(int pool_size)
-    : pool_size_(std::max(pool_size, 1)), shutdown_(false) {
-  auto thread_body = [this] {
-    while (true) {
-      std::function<void()> task;
-      {  // Critical region.
-        std::unique_lock<std::mutex> lck(mtx_);
-        cv_.wait(lck, [this] { return shutdown_ || !task_queue_.empty(); });
-        if (shutdown_ && task_queue_.empty()) return;
-        task = std::move(task_queue_.front());
-        task_queue_.pop();
-      }
-      task();
-    }
-  };
+inline ThreadPool::ThreadPool(int pool_size) : ThreadPool(pool_size, ThreadOptions(), false) {}
+
+inline ThreadPool::ThreadPool(int pool_size, const ThreadOptions &thread_options, bool collect_statistics)
+    : pool_size_(std::max(pool_size, 1)), name_(thread_options.name), collect_statistics_(collect_statistics),
+      shutdown_(false) {
+  deques_.reserve(pool_size_);
   for (int i = 0; i < pool_size_; i++) {
-    thread_list_.emplace_back(thread_body);
+    deques_.push_back(std::make_unique<WorkStealingDeque>());
+  }
+  for (int i = 0; i < pool_size_; i++) {
+    thread_list_.emplace_back([this, i, thread_options] { WorkerLoop(i, thread_options); });
+  }
+  // the workers report whether their options could be applied before the pool is used
+  while (num_started_workers_.load() < pool_size_) {
+    std::this_thread::yield();
   }
 }
 
 inline ThreadPool::~ThreadPool() {
   {  // Critical region.
     std::unique_lock<std::mutex> lck(mtx_);
-    shutdown_ = true;
+    shutdown_.store(true);
   }
   cv_.notify_all();
   for (auto &t : thread_list_) t.join();
@@ -66,20 +281,173 @@ inline ThreadPool::~ThreadPool() {
 
 inline int ThreadPool::Size() const { return pool_size_; }
 
+inline ThreadPoolStatistics ThreadPool::GetStatistics() const {
+  ThreadPoolStatistics statistics;
+  statistics.num_tasks = num_tasks_.load();
+  statistics.queue_depth = std::max(num_queued_tasks_.load(), 0);
+  statistics.max_queue_depth = max_queue_depth_.load();
+  statistics.mean_latency = statistics.num_tasks == 0 ? 0.0
+      : 1e-9 * static_cast<double>(total_latency_ns_.load()) / static_cast<double>(statistics.num_tasks);
+  statistics.max_latency = 1e-9 * static_cast<double>(max_latency_ns_.load());
+  return statistics;
+}
+
+inline void ThreadPool::ResetStatistics() {
+  num_tasks_.store(0);
+  max_queue_depth_.store(0);
+  total_latency_ns_.store(0);
+  max_latency_ns_.store(0);
+}
+
+inline void ThreadPool::RecordLatency(const Task &task) {
+  const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - task.enqueue_time).count();
+  const auto latency_ns = static_cast<uint64_t>(std::max<decltype(latency)>(latency, 0));
+  num_tasks_.fetch_add(1, std::memory_order_relaxed);
+  total_latency_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+  uint64_t max_latency_ns = max_latency_ns_.load(std::memory_order_relaxed);
+  while (latency_ns > max_latency_ns && !max_latency_ns_.compare_exchange_weak(max_latency_ns, latency_ns)) {}
+}
+
+inline ThreadPool::WorkerContext &ThreadPool::CurrentWorker() {
+  static thread_local WorkerContext context;
+  return context;
+}
+
+inline int ThreadPool::WorkerIndex() const {
+  const auto &context = CurrentWorker();
+  return context.pool == this ? context.index : -1;
+}
+
+inline void ThreadPool::Schedule(Task *task) {
+  // counted before it is visible, so a worker never sleeps while a task is queued
+  const int queue_depth = num_queued_tasks_.fetch_add(1) + 1;
+  if (collect_statistics_) {
+    int max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    while (queue_depth > max_queue_depth && !max_queue_depth_.compare_exchange_weak(max_queue_depth, queue_depth)) {}
+  }
+  const int worker_index = WorkerIndex();
+  if (worker_index < 0 || !deques_[worker_index]->Push(task)) {
+    std::unique_lock<std::mutex> lck(mtx_);
+    task_queue_.push_back(task);
+    num_shared_tasks_.fetch_add(1);
+  }
+  if (num_sleeping_.load() > 0) {
+    { std::unique_lock<std::mutex> lck(mtx_); }
+    cv_.notify_one();
+  }
+}
+
+inline bool ThreadPool::RunOneTask(int worker_index) {
+  Task *task = worker_index < 0 ? nullptr : deques_[worker_index]->Take();
+  if (task == nullptr && num_shared_tasks_.load() > 0) {
+    std::unique_lock<std::mutex> lck(mtx_);
+    if (!task_queue_.empty()) {
+      task = task_queue_.front();
+      task_queue_.pop_front();
+      num_shared_tasks_.fetch_sub(1);
+    }
+  }
+  const int first_victim = worker_index < 0 ? 0 : worker_index + 1;
+  for (int k = 0; task == nullptr && k < pool_size_; ++k) {
+    const int victim = (first_victim + k) % pool_size_;
+    if (victim != worker_index) {
+      task = deques_[victim]->Steal();
+    }
+  }
+  if (task == nullptr) {
+    return false;
+  }
+  num_queued_tasks_.fetch_sub(1);
+  if (collect_statistics_) {
+    RecordLatency(*task);
+  }
+#ifdef PLANNING_TRACING
+  {
+    // a packaged task deletes itself in Run
+    const uint64_t trace_flow_id = task->trace_flow_id;
+    TraceZone zone("thread_pool_task");
+    PLANNING_TRACE_FLOW_END("thread_pool_task", trace_flow_id);
+    task->Run();
+  }
+#else
+  task->Run();
+#endif
+  return true;
+}
+
+inline void ThreadPool::WorkerLoop(int worker_index, const ThreadOptions &thread_options) {
+  CurrentWorker() = WorkerContext{this, worker_index};
+  const std::string thread_name = thread_options.name.empty() ? ""
+                                                              : thread_options.name + "-" + std::to_string(worker_index);
+  if (!ConfigureCurrentThread(thread_options, thread_name)) {
+    num_failed_workers_.fetch_add(1);
+  }
+  num_started_workers_.fetch_add(1);
+  while (true) {
+    if (RunOneTask(worker_index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lck(mtx_);
+    num_sleeping_.fetch_add(1);
+    cv_.wait(lck, [this] { return shutdown_.load() || num_queued_tasks_.load() > 0; });
+    num_sleeping_.fetch_sub(1);
+    if (shutdown_.load() && num_queued_tasks_.load() <= 0) return;
+  }
+}
+
 template<class Func, class... Args>
 std::future<typename std::result_of<Func(Args...)>::type> ThreadPool::PushTask(
     Func &&f, Args &&... args) {
   using return_type = typename std::result_of<Func(Args...)>::type;
   // If thread pool is shutdown, return an empty future object.
-  if (shutdown_) return std::future<return_type>();
-  auto task_ptr = std::make_shared<std::packaged_task<return_type()>>(
-      std::bind(std::forward<Func>(f), std::forward<Args>(args)...));
-  {  // Critical region.
-    std::unique_lock<std::mutex> lck(mtx_);
-    task_queue_.emplace([task_ptr] { (*task_ptr)(); });
+  if (shutdown_.load()) return std::future<return_type>();
+  std::packaged_task<return_type()> task(std::bind(std::forward<Func>(f), std::forward<Args>(args)...));
+  auto future = task.get_future();
+  auto *packaged_task = new PackagedTask<return_type>(std::move(task));
+  if (collect_statistics_) {
+    packaged_task->enqueue_time = std::chrono::steady_clock::now();
+  }
+#ifdef PLANNING_TRACING
+  packaged_task->trace_flow_id = TraceRecorder::Instance().NewFlowId();
+  PLANNING_TRACE_FLOW_BEGIN("thread_pool_task", packaged_task->trace_flow_id);
+#endif
+  Schedule(packaged_task);
+  return future;
+}
+
+template<class Func>
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, Func &&func) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  const size_t num_chunks = (end - begin + grain - 1) / grain;
+  const int num_helpers = static_cast<int>(std::min<size_t>(num_chunks - 1, static_cast<size_t>(pool_size_)));
+  using FuncType = typename std::remove_reference<Func>::type;
+  ForkJoinRegion region(begin, end, grain, const_cast<void *>(static_cast<const void *>(std::addressof(func))),
+                        [](void *f, size_t i) { (*static_cast<FuncType *>(f))(i); }, num_helpers);
+  if (collect_statistics_) {
+    region.enqueue_time = std::chrono::steady_clock::now();
+  }
+#ifdef PLANNING_TRACING
+  // the runs of a region share one flow, which ends at the first of them
+  region.trace_flow_id = TraceRecorder::Instance().NewFlowId();
+  if (num_helpers > 0) {
+    PLANNING_TRACE_FLOW_BEGIN("thread_pool_task", region.trace_flow_id);
+  }
+#endif
+  for (int i = 0; i < num_helpers; ++i) {
+    Schedule(&region);
+  }
+  region.RunChunks();
+  // the queued runs hold the region until they are popped, help with the queued tasks meanwhile
+  const int worker_index = WorkerIndex();
+  while (!region.Done()) {
+    if (!RunOneTask(worker_index)) {
+      std::this_thread::yield();
+    }
   }
-  cv_.notify_one();
-  return task_ptr->get_future();
 }
 
 }
@@ -0,0 +1,61 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_COMPACT_TRAJECTORY_CODEC_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_COMPACT_TRAJECTORY_CODEC_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <common/CompactTrajectory.h>
+#include <planning_msgs/Trajectory.h>
+namespace common {
+/**
+ * @brief: encodes the trajectories of the planner into the compact message. the leading points a trajectory shares
+ * with the last encoded one, the stitched history, become a reference to it. every keyframe_interval trajectories
+ * are encoded whole, so a decoder missing a message or joining late recovers.
+ */
+class CompactTrajectoryEncoder {
+ public:
+  explicit CompactTrajectoryEncoder(uint32_t keyframe_interval = 10) : keyframe_interval_(keyframe_interval) {}
+  ~CompactTrajectoryEncoder() = default;
+
+  /**
+   * @brief: encode trajectory, which is kept as the reference of the next one
+   * @param trajectory
+   * @param compact: [out]
+   */
+  void Encode(const planning_msgs::Trajectory::ConstPtr &trajectory, CompactTrajectory *compact);
+
+  /**
+   * @brief: the leading points of trajectory shared with reference, at the same pose and state with s and the
+   * relative time shifted
+   * @param start_index: [out] the index in reference of the first shared point
+   * @param s_offset: [out] the shift of s from reference to trajectory
+   * @return: the number of shared points
+   */
+  static size_t MatchPrefix(const planning_msgs::Trajectory &reference, const planning_msgs::Trajectory &trajectory,
+                            size_t *start_index, double *s_offset);
+
+ private:
+  uint32_t keyframe_interval_;
+  uint32_t sequence_id_ = 0;
+  planning_msgs::Trajectory::ConstPtr last_trajectory_;
+};
+
+/**
+ * @brief: decodes the compact messages of one encoder back into trajectories, for the matchers of the controller
+ */
+class CompactTrajectoryDecoder {
+ public:
+  CompactTrajectoryDecoder() = default;
+  ~CompactTrajectoryDecoder() = default;
+
+  /**
+   * @brief: decode compact, which is kept as the reference of the next one
+   * @param compact
+   * @return: nullptr if the arrays differ in size or the referenced trajectory is not the last decoded one
+   */
+  planning_msgs::Trajectory::ConstPtr Decode(const CompactTrajectory &compact);
+
+ private:
+  uint32_t last_sequence_id_ = 0;
+  planning_msgs::Trajectory::ConstPtr last_trajectory_;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_COMMON_INCLUDE_COMMON_COMPACT_TRAJECTORY_CODEC_HPP_
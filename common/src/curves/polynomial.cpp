@@ -1,5 +1,98 @@
 #include "curves/polynomial.hpp"
+#include <algorithm>
 
 namespace common{
+namespace {
+constexpr int kMaxBisectionIterations = 60;
+constexpr double kRootTolerance = 1e-9;
+
+double EvaluateCoefs(const std::vector<double> &coefs, double x) {
+  double value = 0.0;
+  for (size_t i = coefs.size(); i > 0; --i) {
+    value = value * x + coefs[i - 1];
+  }
+  return value;
+}
+
+std::vector<double> DerivativeCoefs(const std::vector<double> &coefs) {
+  std::vector<double> derivative(coefs.empty() ? 0 : coefs.size() - 1);
+  for (size_t i = 1; i < coefs.size(); ++i) {
+    derivative[i - 1] = static_cast<double>(i) * coefs[i];
+  }
+  return derivative;
+}
+
+/**
+ * @brief: append the real roots of sum(coefs[i] * x^i) in [lower, upper]. the roots of the derivative split the
+ * interval into monotone pieces of at most one root each, which is found by bisection.
+ */
+void AppendRealRoots(const std::vector<double> &coefs, double lower, double upper, std::vector<double> *roots) {
+  if (coefs.size() < 2) {
+    return;
+  }
+  std::vector<double> breaks{lower};
+  AppendRealRoots(DerivativeCoefs(coefs), lower, upper, &breaks);
+  breaks.push_back(upper);
+  for (size_t k = 0; k + 1 < breaks.size(); ++k) {
+    double a = breaks[k];
+    double b = breaks[k + 1];
+    double fa = EvaluateCoefs(coefs, a);
+    const double fb = EvaluateCoefs(coefs, b);
+    if (fa == 0.0 || fb == 0.0) {
+      roots->push_back(fa == 0.0 ? a : b);
+      continue;
+    }
+    if ((fa < 0.0) == (fb < 0.0)) {
+      continue;
+    }
+    for (int iter = 0; iter < kMaxBisectionIterations && b - a > kRootTolerance; ++iter) {
+      const double mid = 0.5 * (a + b);
+      const double fmid = EvaluateCoefs(coefs, mid);
+      if ((fmid < 0.0) == (fa < 0.0)) {
+        a = mid;
+        fa = fmid;
+      } else {
+        b = mid;
+      }
+    }
+    roots->push_back(0.5 * (a + b));
+  }
+}
+}
+
+void Polynomial::EvaluateBatch(const double *params, size_t num_params,
+                               size_t max_order, double *const *values) const {
+  for (size_t order = 0; order <= max_order; ++order) {
+    for (size_t i = 0; i < num_params; ++i) {
+      values[order][i] = Evaluate(order, params[i]);
+    }
+  }
+}
+
+std::vector<double> Polynomial::CriticalParams(size_t order, double param0, double param1) const {
+  std::vector<double> coefs(Order() + 1);
+  for (size_t i = 0; i <= Order(); ++i) {
+    coefs[i] = Coef(i);
+  }
+  for (size_t k = 0; k <= order; ++k) {
+    coefs = DerivativeCoefs(coefs);
+  }
+  std::vector<double> critical_params;
+  AppendRealRoots(coefs, param0, param1, &critical_params);
+  std::sort(critical_params.begin(), critical_params.end());
+  return critical_params;
+}
+
+std::pair<double, double> Polynomial::DerivativeRange(size_t order, double param0, double param1) const {
+  const double value0 = Evaluate(order, param0);
+  const double value1 = Evaluate(order, param1);
+  std::pair<double, double> range(std::min(value0, value1), std::max(value0, value1));
+  for (const double param : CriticalParams(order, param0, param1)) {
+    const double value = Evaluate(order, param);
+    range.first = std::min(range.first, value);
+    range.second = std::max(range.second, value);
+  }
+  return range;
+}
 
 }
\ No newline at end of file
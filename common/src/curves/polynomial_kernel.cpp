@@ -0,0 +1,139 @@
+#include "curves/polynomial_kernel.hpp"
+#include <array>
+#include <vector>
+#include <ros/assert.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace common {
+
+namespace {
+// multiply then add, deliberately not fused to stay bit-identical to the scalar horner scheme.
+#if defined(__AVX__)
+constexpr size_t kLanes = 4;
+using Pack = __m256d;
+inline Pack Load(const double *x) { return _mm256_loadu_pd(x); }
+inline Pack Broadcast(double x) { return _mm256_set1_pd(x); }
+inline Pack MulAdd(Pack a, Pack b, Pack c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+inline void Store(double *x, Pack a) { _mm256_storeu_pd(x, a); }
+constexpr const char *kBackend = "avx";
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+constexpr size_t kLanes = 2;
+using Pack = float64x2_t;
+inline Pack Load(const double *x) { return vld1q_f64(x); }
+inline Pack Broadcast(double x) { return vdupq_n_f64(x); }
+inline Pack MulAdd(Pack a, Pack b, Pack c) { return vaddq_f64(vmulq_f64(a, b), c); }
+inline void Store(double *x, Pack a) { vst1q_f64(x, a); }
+constexpr const char *kBackend = "neon";
+#else
+constexpr size_t kLanes = 1;
+using Pack = double;
+inline Pack Load(const double *x) { return *x; }
+inline Pack Broadcast(double x) { return x; }
+inline Pack MulAdd(Pack a, Pack b, Pack c) { return a * b + c; }
+inline void Store(double *x, Pack a) { *x = a; }
+constexpr const char *kBackend = "scalar";
+#endif
+
+/**
+ * @brief: coefs of the order-th derivative, d[j] = (j + order)! / j! * coefs[j + order]
+ * @return: degree of the derivative
+ */
+size_t DerivativeCoefs(const double *coefs, size_t degree, size_t order, size_t stride,
+                       size_t num_polynomials, double *derivative_coefs) {
+  const size_t derivative_degree = degree - order;
+  for (size_t j = 0; j <= derivative_degree; ++j) {
+    double factor = 1.0;
+    for (size_t m = j + 1; m <= j + order; ++m) {
+      factor *= static_cast<double>(m);
+    }
+    for (size_t n = 0; n < num_polynomials; ++n) {
+      derivative_coefs[j * stride + n] = factor * coefs[(j + order) * stride + n];
+    }
+  }
+  return derivative_degree;
+}
+}
+
+constexpr size_t PolynomialKernel::kMaxDegree;
+
+void PolynomialKernel::Evaluate(const double *coefs, size_t degree,
+                                const double *params, size_t num_params,
+                                size_t max_order, double *const *values) {
+  ROS_ASSERT(degree <= kMaxDegree);
+  std::array<double, kMaxDegree + 1> d{};
+  for (size_t order = 0; order <= max_order; ++order) {
+    double *out = values[order];
+    if (order > degree) {
+      for (size_t i = 0; i < num_params; ++i) {
+        out[i] = 0.0;
+      }
+      continue;
+    }
+    const size_t top = DerivativeCoefs(coefs, degree, order, 1, 1, d.data());
+    size_t i = 0;
+    for (; i + kLanes <= num_params; i += kLanes) {
+      const Pack p = Load(params + i);
+      Pack r = Broadcast(d[top]);
+      for (size_t j = top; j-- > 0;) {
+        r = MulAdd(r, p, Broadcast(d[j]));
+      }
+      Store(out + i, r);
+    }
+    for (; i < num_params; ++i) {
+      const double p = params[i];
+      double r = d[top];
+      for (size_t j = top; j-- > 0;) {
+        r = r * p + d[j];
+      }
+      out[i] = r;
+    }
+  }
+}
+
+void PolynomialKernel::EvaluateMultiple(const double *coefs, size_t degree, size_t num_polynomials,
+                                        const double *params, size_t num_params,
+                                        size_t max_order, double *const *values) {
+  ROS_ASSERT(degree <= kMaxDegree);
+  std::vector<double> d((degree + 1) * num_polynomials, 0.0);
+  for (size_t order = 0; order <= max_order; ++order) {
+    double *out = values[order];
+    if (order > degree) {
+      for (size_t i = 0; i < num_params * num_polynomials; ++i) {
+        out[i] = 0.0;
+      }
+      continue;
+    }
+    const size_t top = DerivativeCoefs(coefs, degree, order, num_polynomials, num_polynomials, d.data());
+    const double *d_top = d.data() + top * num_polynomials;
+    for (size_t i = 0; i < num_params; ++i) {
+      double *out_row = out + i * num_polynomials;
+      const Pack p = Broadcast(params[i]);
+      size_t n = 0;
+      for (; n + kLanes <= num_polynomials; n += kLanes) {
+        Pack r = Load(d_top + n);
+        for (size_t j = top; j-- > 0;) {
+          r = MulAdd(r, p, Load(d.data() + j * num_polynomials + n));
+        }
+        Store(out_row + n, r);
+      }
+      for (; n < num_polynomials; ++n) {
+        double r = d_top[n];
+        for (size_t j = top; j-- > 0;) {
+          r = r * params[i] + d[j * num_polynomials + n];
+        }
+        out_row[n] = r;
+      }
+    }
+  }
+}
+
+const char *PolynomialKernel::Backend() {
+  return kBackend;
+}
+
+}
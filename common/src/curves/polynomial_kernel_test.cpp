@@ -0,0 +1,136 @@
+#include "curves/polynomial_kernel.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "curves/quintic_polynomial.hpp"
+#include "curves/quartic_polynomial.hpp"
+
+namespace common {
+namespace {
+// odd number of params, so the scalar tail of the vectorized loops is exercised too
+std::vector<double> MakeParams(double delta, double max_param) {
+  std::vector<double> params;
+  for (double param = 0.0; param <= max_param; param += delta) {
+    params.push_back(param);
+  }
+  if (params.size() % 2 == 0) {
+    params.push_back(max_param + delta);
+  }
+  return params;
+}
+
+void ExpectBatchMatchesScalar(const Polynomial &polynomial, const std::vector<double> &params, size_t max_order) {
+  std::vector<std::vector<double>> values(max_order + 1, std::vector<double>(params.size(), -1.0));
+  std::vector<double *> value_ptrs;
+  for (auto &value : values) {
+    value_ptrs.push_back(value.data());
+  }
+  polynomial.EvaluateBatch(params.data(), params.size(), max_order, value_ptrs.data());
+  for (size_t order = 0; order <= max_order; ++order) {
+    for (size_t i = 0; i < params.size(); ++i) {
+      EXPECT_DOUBLE_EQ(values[order][i], polynomial.Evaluate(order, params[i]))
+                << "order: " << order << ", param: " << params[i];
+    }
+  }
+}
+}
+
+TEST(PolynomialKernelTest, quintic_batch_evaluate) {
+  QuinticPolynomial quintic_polynomial({30.0458, 15.0, 0.0}, {35.5136, 0.0, 0.0}, 4.0);
+  ExpectBatchMatchesScalar(quintic_polynomial, MakeParams(0.1, 8.0), 6);
+  QuinticPolynomial lat_polynomial({-1.43473, 0.4, 0.0}, {0.5, 0.0, 0.0}, 20.0);
+  ExpectBatchMatchesScalar(lat_polynomial, MakeParams(0.1, 25.0), 3);
+}
+
+TEST(PolynomialKernelTest, quartic_batch_evaluate) {
+  QuarticPolynomial quartic_polynomial({0.0, 10.0, 0.5}, {15.0, 0.0}, 6.0);
+  ExpectBatchMatchesScalar(quartic_polynomial, MakeParams(0.1, 8.0), 5);
+}
+
+TEST(PolynomialKernelTest, empty_batch) {
+  QuarticPolynomial quartic_polynomial({0.0, 10.0, 0.5}, {15.0, 0.0}, 6.0);
+  double value = -1.0;
+  double *value_ptr = &value;
+  quartic_polynomial.EvaluateBatch(nullptr, 0, 0, &value_ptr);
+  EXPECT_DOUBLE_EQ(value, -1.0);
+}
+
+TEST(PolynomialKernelTest, evaluate_multiple_polynomials) {
+  const size_t max_order = 3;
+  std::vector<QuinticPolynomial> polynomials;
+  for (double end_v = 0.0; end_v < 20.0; end_v += 2.0) {
+    polynomials.emplace_back(std::array<double, 3>{0.0, 12.0, 0.3}, std::array<double, 3>{40.0, end_v, 0.0}, 4.0);
+  }
+  polynomials.emplace_back(std::array<double, 3>{0.0, 12.0, 0.3}, std::array<double, 3>{55.0, 13.0, 0.0}, 5.0);
+  const size_t num_polynomials = polynomials.size();
+  std::vector<double> coefs(6 * num_polynomials);
+  for (size_t k = 0; k < 6; ++k) {
+    for (size_t j = 0; j < num_polynomials; ++j) {
+      coefs[k * num_polynomials + j] = polynomials[j].Coef(k);
+    }
+  }
+  const auto params = MakeParams(0.1, 8.0);
+  std::vector<std::vector<double>> values(max_order + 1, std::vector<double>(params.size() * num_polynomials));
+  std::vector<double *> value_ptrs;
+  for (auto &value : values) {
+    value_ptrs.push_back(value.data());
+  }
+  PolynomialKernel::EvaluateMultiple(coefs.data(), 5, num_polynomials, params.data(), params.size(),
+                                     max_order, value_ptrs.data());
+  for (size_t order = 0; order <= max_order; ++order) {
+    for (size_t i = 0; i < params.size(); ++i) {
+      for (size_t j = 0; j < num_polynomials; ++j) {
+        EXPECT_DOUBLE_EQ(values[order][i * num_polynomials + j], polynomials[j].Evaluate(order, params[i]))
+                  << "order: " << order << ", param: " << params[i] << ", polynomial: " << j;
+      }
+    }
+  }
+}
+
+TEST(PolynomialTest, derivative_range) {
+  QuinticPolynomial quintic_polynomial({0.0, 12.0, 0.3}, {40.0, 6.0, 0.0}, 4.0);
+  QuarticPolynomial quartic_polynomial({0.0, 10.0, 0.5}, {15.0, 0.0}, 6.0);
+  for (const Polynomial *polynomial : {static_cast<const Polynomial *>(&quintic_polynomial),
+                                       static_cast<const Polynomial *>(&quartic_polynomial)}) {
+    const double param_length = polynomial->ParamLength();
+    for (size_t order = 0; order <= 3; ++order) {
+      const auto range = polynomial->DerivativeRange(order, 0.0, param_length);
+      double lowest = std::numeric_limits<double>::max();
+      double highest = std::numeric_limits<double>::lowest();
+      for (size_t i = 0; i <= 10000; ++i) {
+        const double param = param_length * static_cast<double>(i) / 10000.0;
+        const double value = polynomial->Evaluate(order, param);
+        lowest = std::min(lowest, value);
+        highest = std::max(highest, value);
+        EXPECT_GE(value, range.first - 1e-9) << "order: " << order << ", param: " << param;
+        EXPECT_LE(value, range.second + 1e-9) << "order: " << order << ", param: " << param;
+      }
+      EXPECT_NEAR(range.first, lowest, 1e-6) << "order: " << order;
+      EXPECT_NEAR(range.second, highest, 1e-6) << "order: " << order;
+    }
+  }
+}
+
+TEST(PolynomialTest, derivative_range_between_samples) {
+  // the acceleration peaks between the samples of a 0.1 grid
+  QuinticPolynomial quintic_polynomial({0.0, 10.0, 0.0}, {20.0, 12.0, 0.0}, 1.95);
+  const auto critical_params = quintic_polynomial.CriticalParams(2, 0.0, 1.95);
+  ASSERT_FALSE(critical_params.empty());
+  double sampled_max = std::numeric_limits<double>::lowest();
+  for (double t = 0.0; t < 1.95; t += 0.1) {
+    sampled_max = std::max(sampled_max, quintic_polynomial.Evaluate(2, t));
+  }
+  const auto range = quintic_polynomial.DerivativeRange(2, 0.0, 1.95);
+  EXPECT_GE(range.second, sampled_max);
+  for (const double param : critical_params) {
+    EXPECT_NEAR(quintic_polynomial.Evaluate(3, param), 0.0, 1e-6);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 #include <cassert>
 #include "curves/quartic_polynomial.hpp"
+#include "curves/polynomial_kernel.hpp"
 
 namespace common {
 
@@ -28,6 +29,11 @@ QuarticPolynomial::QuarticPolynomial(const QuarticPolynomial &other) {
   end_condition_ = other.end_condition_;
   coef_ = other.coef_;
 }
+void QuarticPolynomial::EvaluateBatch(const double *params, size_t num_params,
+                                      size_t max_order, double *const *values) const {
+  PolynomialKernel::Evaluate(coef_.data(), 4, params, num_params, max_order, values);
+}
+
 double QuarticPolynomial::Evaluate(size_t order, double p) const {
   switch (order) {
     case 0: {
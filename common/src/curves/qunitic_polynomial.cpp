@@ -1,6 +1,7 @@
 #include <array>
 #include <ros/assert.h>
 #include "curves/quintic_polynomial.hpp"
+#include "curves/polynomial_kernel.hpp"
 
 namespace common {
 
@@ -62,6 +63,11 @@ double QuinticPolynomial::Evaluate(size_t order,
   }
 }
 
+void QuinticPolynomial::EvaluateBatch(const double *params, size_t num_params,
+                                      size_t max_order, double *const *values) const {
+  PolynomialKernel::Evaluate(coef_.data(), 5, params, num_params, max_order, values);
+}
+
 void QuinticPolynomial::SetParam(double x0, double dx0,
                                  double ddx0, double x1,
                                  double dx1, double ddx1,
@@ -139,6 +139,34 @@ std::vector<double> band_matrix::lu_solve(const std::vector<double> &b,
 
 
 
+// tridiagonal solver
+// -------------------------
+
+// solves the n x n tridiagonal systems of the same matrix for num_rhs right hand sides by the thomas
+// algorithm without pivoting, which is stable for the diagonally dominant spline systems.
+// lower[0] and upper[n-1] are unused, diag and the right hand sides are overwritten, the right hand
+// sides by the solutions
+namespace {
+void thomas_solve(int n, const double *lower, double *diag, const double *upper,
+                         double *const *rhs, int num_rhs) {
+  for (int i = 1; i < n; i++) {
+    assert(diag[i - 1] != 0.0);
+    const double w = lower[i] / diag[i - 1];
+    diag[i] -= w * upper[i - 1];
+    for (int k = 0; k < num_rhs; k++) {
+      rhs[k][i] -= w * rhs[k][i - 1];
+    }
+  }
+  for (int k = 0; k < num_rhs; k++) {
+    double *r = rhs[k];
+    r[n - 1] /= diag[n - 1];
+    for (int i = n - 2; i >= 0; i--) {
+      r[i] = (r[i] - upper[i] * r[i + 1]) / diag[i];
+    }
+  }
+}
+}
+
 // spline implementation
 // -----------------------
 
@@ -153,71 +181,80 @@ void spline::set_boundary(spline::bd_type left, double left_value,
   m_force_linear_extrapolation = force_linear_extrapolation;
 }
 
-void spline::set_points(const std::vector<double> &x,
-                        const std::vector<double> &y, bool cubic_spline) {
+void spline::store_points(const std::vector<double> &x, const std::vector<double> &y) {
   assert(x.size() == y.size());
   assert(x.size() > 2);
   m_x = x;
   m_y = y;
-  int n = x.size();
   // TODO: maybe sort x and y, rather than returning an error
-  for (int i = 0; i < n - 1; i++) {
+  for (size_t i = 0; i + 1 < x.size(); i++) {
     assert(m_x[i] < m_x[i + 1]);
   }
+}
+
+void spline::set_up_system(double *lower, double *diag, double *upper, double *rhs) const {
+  const std::vector<double> &x = m_x;
+  const std::vector<double> &y = m_y;
+  const int n = x.size();
+  for (int i = 1; i < n - 1; i++) {
+    lower[i] = 1.0 / 3.0 * (x[i] - x[i - 1]);
+    diag[i] = 2.0 / 3.0 * (x[i + 1] - x[i - 1]);
+    upper[i] = 1.0 / 3.0 * (x[i + 1] - x[i]);
+    rhs[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
+  }
+  lower[0] = 0.0;
+  upper[n - 1] = 0.0;
+  // boundary conditions
+  if (m_left == spline::second_deriv) {
+    // 2*b[0] = f''
+    diag[0] = 2.0;
+    upper[0] = 0.0;
+    rhs[0] = m_left_value;
+  } else if (m_left == spline::first_deriv) {
+    // c[0] = f', needs to be re-expressed in terms of b:
+    // (2b[0]+b[1])(x[1]-x[0]) = 3 ((y[1]-y[0])/(x[1]-x[0]) - f')
+    diag[0] = 2.0 * (x[1] - x[0]);
+    upper[0] = 1.0 * (x[1] - x[0]);
+    rhs[0] = 3.0 * ((y[1] - y[0]) / (x[1] - x[0]) - m_left_value);
+  } else {
+    assert(false);
+  }
+  if (m_right == spline::second_deriv) {
+    // 2*b[n-1] = f''
+    diag[n - 1] = 2.0;
+    lower[n - 1] = 0.0;
+    rhs[n - 1] = m_right_value;
+  } else if (m_right == spline::first_deriv) {
+    // c[n-1] = f', needs to be re-expressed in terms of b:
+    // (b[n-2]+2b[n-1])(x[n-1]-x[n-2])
+    // = 3 (f' - (y[n-1]-y[n-2])/(x[n-1]-x[n-2]))
+    diag[n - 1] = 2.0 * (x[n - 1] - x[n - 2]);
+    lower[n - 1] = 1.0 * (x[n - 1] - x[n - 2]);
+    rhs[n - 1] = 3.0 * (m_right_value - (y[n - 1] - y[n - 2]) / (x[n - 1] - x[n - 2]));
+  } else {
+    assert(false);
+  }
+}
+
+void spline::set_points(const std::vector<double> &x,
+                        const std::vector<double> &y, bool cubic_spline) {
+  store_points(x, y);
+  int n = x.size();
 
   if (cubic_spline) { // cubic spline interpolation
-    // setting up the matrix and right hand side of the equation system
-    // for the parameters b[]
-    band_matrix A(n, 1, 1);
-    std::vector<double> rhs(n);
-    for (int i = 1; i < n - 1; i++) {
-      A(i, i - 1) = 1.0 / 3.0 * (x[i] - x[i - 1]);
-      A(i, i) = 2.0 / 3.0 * (x[i + 1] - x[i - 1]);
-      A(i, i + 1) = 1.0 / 3.0 * (x[i + 1] - x[i]);
-      rhs[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
-    }
-    // boundary conditions
-    if (m_left == spline::second_deriv) {
-      // 2*b[0] = f''
-      A(0, 0) = 2.0;
-      A(0, 1) = 0.0;
-      rhs[0] = m_left_value;
-    } else if (m_left == spline::first_deriv) {
-      // c[0] = f', needs to be re-expressed in terms of b:
-      // (2b[0]+b[1])(x[1]-x[0]) = 3 ((y[1]-y[0])/(x[1]-x[0]) - f')
-      A(0, 0) = 2.0 * (x[1] - x[0]);
-      A(0, 1) = 1.0 * (x[1] - x[0]);
-      rhs[0] = 3.0 * ((y[1] - y[0]) / (x[1] - x[0]) - m_left_value);
-    } else {
-      assert(false);
-    }
-    if (m_right == spline::second_deriv) {
-      // 2*b[n-1] = f''
-      A(n - 1, n - 1) = 2.0;
-      A(n - 1, n - 2) = 0.0;
-      rhs[n - 1] = m_right_value;
-    } else if (m_right == spline::first_deriv) {
-      // c[n-1] = f', needs to be re-expressed in terms of b:
-      // (b[n-2]+2b[n-1])(x[n-1]-x[n-2])
-      // = 3 (f' - (y[n-1]-y[n-2])/(x[n-1]-x[n-2]))
-      A(n - 1, n - 1) = 2.0 * (x[n - 1] - x[n - 2]);
-      A(n - 1, n - 2) = 1.0 * (x[n - 1] - x[n - 2]);
-      rhs[n - 1] = 3.0 * (m_right_value - (y[n - 1] - y[n - 2]) / (x[n - 1] - x[n - 2]));
-    } else {
-      assert(false);
-    }
+    // setting up the tridiagonal matrix and right hand side of the equation system
+    // for the parameters b[], in one contiguous buffer
+    std::vector<double> buffer(4 * n);
+    double *lower = buffer.data();
+    double *diag = lower + n;
+    double *upper = diag + n;
+    double *rhs = upper + n;
+    set_up_system(lower, diag, upper, rhs);
 
     // solve the equation system to obtain the parameters b[]
-    m_b = A.lu_solve(rhs);
-
-    // calculate parameters a[] and c[] based on b[]
-    m_a.resize(n);
-    m_c.resize(n);
-    for (int i = 0; i < n - 1; i++) {
-      m_a[i] = 1.0 / 3.0 * (m_b[i + 1] - m_b[i]) / (x[i + 1] - x[i]);
-      m_c[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i])
-          - 1.0 / 3.0 * (2.0 * m_b[i] + m_b[i + 1]) * (x[i + 1] - x[i]);
-    }
+    thomas_solve(n, lower, diag, upper, &rhs, 1);
+    m_b.assign(rhs, rhs + n);
+    set_cubic_coefficients();
   } else { // linear interpolation
     m_a.resize(n);
     m_b.resize(n);
@@ -228,7 +265,57 @@ void spline::set_points(const std::vector<double> &x,
       m_c[i] = (m_y[i + 1] - m_y[i]) / (m_x[i + 1] - m_x[i]);
     }
   }
+  set_extrapolation();
+}
 
+void spline::set_points(const std::vector<double> &x,
+                        const std::vector<double> &y0,
+                        const std::vector<double> &y1,
+                        spline *spline0, spline *spline1) {
+  assert(spline0 != nullptr && spline1 != nullptr);
+  if (spline0->m_left != spline1->m_left || spline0->m_right != spline1->m_right) {
+    // different matrices
+    spline0->set_points(x, y0);
+    spline1->set_points(x, y1);
+    return;
+  }
+  spline0->store_points(x, y0);
+  spline1->store_points(x, y1);
+  int n = x.size();
+  std::vector<double> buffer(5 * n);
+  double *lower = buffer.data();
+  double *diag = lower + n;
+  double *upper = diag + n;
+  double *rhs[2] = {upper + n, upper + 2 * n};
+  // the matrix only depends on the knots and the boundary types, the second call rewrites the same values
+  spline0->set_up_system(lower, diag, upper, rhs[0]);
+  spline1->set_up_system(lower, diag, upper, rhs[1]);
+  thomas_solve(n, lower, diag, upper, rhs, 2);
+  spline0->m_b.assign(rhs[0], rhs[0] + n);
+  spline1->m_b.assign(rhs[1], rhs[1] + n);
+  for (spline *s : {spline0, spline1}) {
+    s->set_cubic_coefficients();
+    s->set_extrapolation();
+  }
+}
+
+void spline::set_cubic_coefficients() {
+  const std::vector<double> &x = m_x;
+  const std::vector<double> &y = m_y;
+  int n = x.size();
+  // calculate parameters a[] and c[] based on b[]
+  m_a.resize(n);
+  m_c.resize(n);
+  for (int i = 0; i < n - 1; i++) {
+    m_a[i] = 1.0 / 3.0 * (m_b[i + 1] - m_b[i]) / (x[i + 1] - x[i]);
+    m_c[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i])
+        - 1.0 / 3.0 * (2.0 * m_b[i] + m_b[i + 1]) * (x[i + 1] - x[i]);
+  }
+}
+
+void spline::set_extrapolation() {
+  const std::vector<double> &x = m_x;
+  int n = x.size();
   // for left extrapolation coefficients
   m_b0 = !m_force_linear_extrapolation ? m_b[0] : 0.0;
   m_c0 = m_c[0];
@@ -243,6 +330,29 @@ void spline::set_points(const std::vector<double> &x,
     m_b[n - 1] = 0.0;
 }
 
+void spline::splice(size_t first, size_t last, const spline &tail, double shift) {
+  assert(first < last && last < m_x.size());
+  assert(tail.m_x.size() > 2);
+  const size_t num_kept = last - first;
+  for (std::vector<double> *values : {&m_x, &m_y, &m_a, &m_b, &m_c}) {
+    values->erase(values->begin() + last, values->end());
+    values->erase(values->begin(), values->begin() + first);
+  }
+  for (size_t i = 0; i < num_kept; ++i) {
+    m_x[i] -= shift;
+  }
+  m_x.insert(m_x.end(), tail.m_x.begin(), tail.m_x.end());
+  m_y.insert(m_y.end(), tail.m_y.begin(), tail.m_y.end());
+  m_a.insert(m_a.end(), tail.m_a.begin(), tail.m_a.end());
+  m_b.insert(m_b.end(), tail.m_b.begin(), tail.m_b.end());
+  m_c.insert(m_c.end(), tail.m_c.begin(), tail.m_c.end());
+  m_right = tail.m_right;
+  m_right_value = tail.m_right_value;
+  // the left extrapolation follows the new first segment
+  m_b0 = !m_force_linear_extrapolation ? m_b[0] : 0.0;
+  m_c0 = m_c[0];
+}
+
 double spline::operator()(double x) const {
   size_t n = m_x.size();
   // find the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
@@ -312,4 +422,57 @@ double spline::deriv(int order, double x) const {
   return interpol;
 }
 
+size_t spline::find_segment(double x) const {
+  const auto it = std::lower_bound(m_x.begin(), m_x.end(), x);
+  return static_cast<size_t>(std::max(int(it - m_x.begin()) - 1, 0));
+}
+
+size_t spline::find_segment(double x, size_t hint) const {
+  const size_t n = m_x.size();
+  size_t idx = std::min(hint, n - 1);
+  // the segment idx holds (m_x[idx], m_x[idx + 1]]
+  while (idx + 1 < n && m_x[idx + 1] < x) {
+    ++idx;
+  }
+  while (idx > 0 && m_x[idx] >= x) {
+    --idx;
+  }
+  return idx;
+}
+
+void spline::evaluate(double x, size_t idx, int max_order, double *values) const {
+  assert(max_order >= 0 && max_order <= 3);
+  const size_t n = m_x.size();
+  const double h = x - m_x[idx];
+  double a = 0.0;
+  double b = 0.0;
+  double c = 0.0;
+  double y = 0.0;
+  if (x < m_x[0]) {
+    b = m_b0;
+    c = m_c0;
+    y = m_y[0];
+  } else if (x > m_x[n - 1]) {
+    b = m_b[n - 1];
+    c = m_c[n - 1];
+    y = m_y[n - 1];
+  } else {
+    a = m_a[idx];
+    b = m_b[idx];
+    c = m_c[idx];
+    y = m_y[idx];
+  }
+  values[0] = ((a * h + b) * h + c) * h + y;
+  if (max_order >= 1) {
+    values[1] = (3.0 * a * h + 2.0 * b) * h + c;
+  }
+  if (max_order >= 2) {
+    // as in deriv(), constant right of the last knot and scaled by h left of the first one
+    values[2] = x > m_x[n - 1] ? 2.0 * b : x < m_x[0] ? 2.0 * b * h : 6.0 * a * h + 2.0 * b;
+  }
+  if (max_order >= 3) {
+    values[3] = 6.0 * a;
+  }
+}
+
 }
\ No newline at end of file
@@ -1,6 +1,46 @@
 #include "curves/spline2d.hpp"
 #include <ros/ros.h>
+#include <algorithm>
+#include <cmath>
 namespace common {
+namespace {
+// the samples of the lookup tables between two points, the hermite interpolation between the samples keeps the
+// mapping error far below a millimeter
+constexpr size_t kArcLengthSamplesPerSegment = 8;
+// the 3 points gauss legendre quadrature on [-1, 1]
+constexpr double kGaussAbscissas[3] = {-0.7745966692414834, 0.0, 0.7745966692414834};
+constexpr double kGaussWeights[3] = {5.0 / 9.0, 8.0 / 9.0, 5.0 / 9.0};
+constexpr double kMinSpeed = 1e-6;
+
+// the spline segments before a change that are fitted again, the effect of a change on a cubic spline decays by
+// about 0.27 per segment, so it is below 1e-4 of the change before these
+constexpr size_t kNumRefitSegments = 8;
+constexpr double kSamePointEpsilon = 1e-9;
+
+/**
+ * @brief: the cubic hermite interpolation of the uniform samples values[i] at origin + i * step with the derivatives
+ */
+double HermiteLookUp(const std::vector<double> &values, const std::vector<double> &derivatives,
+                     double origin, double step, double x) {
+  const double position = std::max((x - origin) / step, 0.0);
+  const size_t index = std::min(static_cast<size_t>(position), values.size() - 2);
+  const double u = std::min(std::max(position - static_cast<double>(index), 0.0), 1.0);
+  const double u2 = u * u;
+  const double u3 = u2 * u;
+  return (2.0 * u3 - 3.0 * u2 + 1.0) * values[index] + (u3 - 2.0 * u2 + u) * step * derivatives[index]
+      + (-2.0 * u3 + 3.0 * u2) * values[index + 1] + (u3 - u2) * step * derivatives[index + 1];
+}
+
+/**
+ * @brief: drop the leading samples at origin + i * step before the interval holding 0, and move the origin
+ */
+void TrimLeadingSamples(double *origin, double step, std::vector<double> *values, std::vector<double> *derivatives) {
+  const auto num_dropped = std::min(static_cast<size_t>(std::max(-*origin / step, 0.0)), values->size() - 2);
+  values->erase(values->begin(), values->begin() + num_dropped);
+  derivatives->erase(derivatives->begin(), derivatives->begin() + num_dropped);
+  *origin += static_cast<double>(num_dropped) * step;
+}
+}
 
 Spline2d::Spline2d(const std::vector<double> &xs,
                    const std::vector<double> &ys) : xs_(xs), ys_(ys) {
@@ -10,9 +50,9 @@ Spline2d::Spline2d(const std::vector<double> &xs,
   assert(chord_lengths_.size() == xs.size());
   x_spline_ = spline();
   y_spline_ = spline();
-  x_spline_.set_points(chord_lengths_, xs_);
-  y_spline_.set_points(chord_lengths_, ys_);
+  spline::set_points(chord_lengths_, xs_, ys_, &x_spline_, &y_spline_);
   CalcArcLength();
+  point_index_ = PointGridIndex(xs_, ys_);
 }
 
 Spline2d::Spline2d(const std::vector<double> &xs,
@@ -24,9 +64,9 @@ Spline2d::Spline2d(const std::vector<double> &xs,
   assert(chord_lengths_.size() == xs.size());
   x_spline_ = spline();
   y_spline_ = spline();
-  x_spline_.set_points(chord_lengths_, xs_);
-  y_spline_.set_points(chord_lengths_, ys_);
+  spline::set_points(chord_lengths_, xs_, ys_, &x_spline_, &y_spline_);
   CalcArcLength();
+  point_index_ = PointGridIndex(xs_, ys_);
 }
 
 bool Spline2d::Evaluate(double s, double *x, double *y) const {
@@ -101,31 +141,213 @@ bool Spline2d::EvaluateThirdDerivative(double s,
   }
 }
 
+double Spline2d::ClampEvaluation(double s) const {
+  if (s < 1e-3) {
+    return 0.0;
+  } else if (s > arc_length_ - 1e-3) {
+    return arc_length_;
+  }
+  return s;
+}
+
+void Spline2d::EvaluateOnSegment(double t, size_t segment, int order_mask, Spline2dPoint *point) const {
+  // the flag of the order k is 1 << k
+  int max_order = 0;
+  for (int order = 1; order <= 3; ++order) {
+    if (order_mask & (1 << order)) {
+      max_order = order;
+    }
+  }
+  double x_values[4];
+  double y_values[4];
+  // x and y are fitted on the same knots, the segment of x is the one of y
+  x_spline_.evaluate(t, segment, max_order, x_values);
+  y_spline_.evaluate(t, segment, max_order, y_values);
+  if (order_mask & POSITION) {
+    point->x = x_values[0];
+    point->y = y_values[0];
+  }
+  if (order_mask & FIRST_DERIVATIVE) {
+    point->dx = x_values[1];
+    point->dy = y_values[1];
+  }
+  if (order_mask & SECOND_DERIVATIVE) {
+    point->ddx = x_values[2];
+    point->ddy = y_values[2];
+  }
+  if (order_mask & THIRD_DERIVATIVE) {
+    point->dddx = x_values[3];
+    point->dddy = y_values[3];
+  }
+}
+
+bool Spline2d::EvaluateAll(double s, int order_mask, Spline2dPoint *point) const {
+  const double t = ClampEvaluation(s);
+  EvaluateOnSegment(t, x_spline_.find_segment(t), order_mask, point);
+  return true;
+}
+
+void Spline2d::EvaluateAll(const std::vector<double> &sorted_s, int order_mask,
+                           std::vector<Spline2dPoint> *points) const {
+  points->assign(sorted_s.size(), Spline2dPoint());
+  size_t segment = 0;
+  for (size_t i = 0; i < sorted_s.size(); ++i) {
+    const double t = ClampEvaluation(sorted_s[i]);
+    segment = x_spline_.find_segment(t, segment);
+    EvaluateOnSegment(t, segment, order_mask, &(*points)[i]);
+  }
+}
+
 void Spline2d::CalcArcLength() {
-//  const double step = 0.001;
-//  double t = step;
-//  double last_x = spline2d_(0.0)(0, 0);
-//  double last_y = spline2d_(0.0)(1, 0);
-//  double arc_length = 0.0;
-//  while (t < 1.0 + step) {
-//    if (t > 1.0) {
-//      t = 1.0;
-//    }
-//    if (t < 1e-6) {
-//      t = 0.0;
-//    }
-//    auto xy = spline2d_(t);
-//    double x = xy(0, 0);
-//    double y = xy(1, 0);
-//    double delta_s = std::hypot(x - last_x, y - last_y);
-//    arc_length += delta_s;
-//    last_x = x;
-//    last_y = y;
-//    t += step;
-//
-//  }
   arc_length_ = chord_lengths_.back();
+  CalcArcLengthTable();
+}
 
+void Spline2d::CalcArcLengthTable() {
+  const size_t num_samples = (chord_lengths_.size() - 1) * kArcLengthSamplesPerSegment + 1;
+  chord_origin_ = 0.0;
+  chord_step_ = arc_length_ / static_cast<double>(num_samples - 1);
+  curve_length_table_.assign(1, 0.0);
+  curve_length_derivative_table_.assign(1, Speed(0.0));
+  CalcCurveLengthSamples(1);
+
+  curve_origin_ = 0.0;
+  curve_step_ = curve_length_ / static_cast<double>(num_samples - 1);
+  chord_length_table_.clear();
+  chord_length_derivative_table_.clear();
+  CalcChordLengthSamples(0);
+  chord_length_table_.front() = 0.0;
+  chord_length_table_.back() = arc_length_;
+}
+
+void Spline2d::CalcCurveLengthSamples(size_t first_sample) {
+  const auto num_samples =
+      static_cast<size_t>(std::ceil((arc_length_ - chord_origin_) / chord_step_ - 1e-9)) + 1;
+  curve_length_table_.resize(std::max(num_samples, first_sample));
+  curve_length_derivative_table_.resize(curve_length_table_.size());
+  for (size_t i = first_sample; i < curve_length_table_.size(); ++i) {
+    const double t_mid = chord_origin_ + (static_cast<double>(i) - 0.5) * chord_step_;
+    double length = 0.0;
+    for (size_t k = 0; k < 3; ++k) {
+      length += kGaussWeights[k] * Speed(t_mid + 0.5 * chord_step_ * kGaussAbscissas[k]);
+    }
+    curve_length_table_[i] = curve_length_table_[i - 1] + 0.5 * chord_step_ * length;
+    curve_length_derivative_table_[i] = Speed(chord_origin_ + static_cast<double>(i) * chord_step_);
+  }
+  curve_length_ = ChordLengthToArcLength(arc_length_);
+}
+
+void Spline2d::CalcChordLengthSamples(size_t first_sample) {
+  // invert the monotone table at the uniform curve length samples, one newton step refines the linear guess
+  const auto num_samples =
+      static_cast<size_t>(std::ceil((curve_length_ - curve_origin_) / curve_step_ - 1e-9)) + 1;
+  chord_length_table_.resize(std::max(num_samples, first_sample));
+  chord_length_derivative_table_.resize(chord_length_table_.size());
+  const size_t num_curve_samples = curve_length_table_.size();
+  size_t index = 0;
+  for (size_t j = first_sample; j < chord_length_table_.size(); ++j) {
+    const double s = curve_origin_ + static_cast<double>(j) * curve_step_;
+    if (s > curve_length_) {
+      // past the end, continue the curve along its end tangent
+      const double end_speed = std::max(Speed(arc_length_), kMinSpeed);
+      chord_length_table_[j] = arc_length_ + (s - curve_length_) / end_speed;
+      chord_length_derivative_table_[j] = 1.0 / end_speed;
+      continue;
+    }
+    while (index + 2 < num_curve_samples && curve_length_table_[index + 1] < s) {
+      ++index;
+    }
+    const double ds = curve_length_table_[index + 1] - curve_length_table_[index];
+    const double ratio = ds > 0.0 ? Clamp((s - curve_length_table_[index]) / ds, 0.0, 1.0) : 0.0;
+    double t = chord_origin_ + (static_cast<double>(index) + ratio) * chord_step_;
+    t = Clamp(t - (ChordLengthToArcLength(t) - s) / std::max(Speed(t), kMinSpeed), 0.0, arc_length_);
+    chord_length_table_[j] = t;
+    chord_length_derivative_table_[j] = 1.0 / std::max(Speed(t), kMinSpeed);
+  }
+}
+
+bool Spline2d::Refit(const std::vector<double> &xs, const std::vector<double> &ys, double *shift) {
+  assert(xs.size() == ys.size());
+  if (xs.size() <= order_ || xs_.empty()) {
+    return false;
+  }
+  auto is_same = [&](size_t i, size_t j) {
+    return std::fabs(xs_[i] - xs[j]) < kSamePointEpsilon && std::fabs(ys_[i] - ys[j]) < kSamePointEpsilon;
+  };
+  const size_t first = point_index_.Nearest(xs[0], ys[0]);
+  if (!is_same(first, 0)) {
+    return false;
+  }
+  size_t num_shared = 1;
+  while (first + num_shared < xs_.size() && num_shared < xs.size() && is_same(first + num_shared, num_shared)) {
+    ++num_shared;
+  }
+  // the last shared point and the segments before it are fitted again
+  if (num_shared < kNumRefitSegments + 3) {
+    return false;
+  }
+  const size_t refit_start = first + num_shared - 1 - kNumRefitSegments;
+  const double trimmed_chord_length = chord_lengths_[first];
+  const double trimmed_curve_length = ChordLengthToArcLength(trimmed_chord_length);
+  const double refit_chord_length = chord_lengths_[refit_start] - trimmed_chord_length;
+  const double x_slope = x_spline_.deriv(1, chord_lengths_[refit_start]);
+  const double y_slope = y_spline_.deriv(1, chord_lengths_[refit_start]);
+
+  const size_t tail_start = refit_start - first;
+  std::vector<double> chord_lengths(chord_lengths_.begin() + first, chord_lengths_.begin() + refit_start + 1);
+  for (auto &chord_length : chord_lengths) {
+    chord_length -= trimmed_chord_length;
+  }
+  chord_lengths.reserve(xs.size());
+  for (size_t i = chord_lengths.size(); i < xs.size(); ++i) {
+    chord_lengths.push_back(chord_lengths.back() + std::hypot(xs[i] - xs[i - 1], ys[i] - ys[i - 1]));
+  }
+  const std::vector<double> tail_chord_lengths(chord_lengths.begin() + tail_start, chord_lengths.end());
+  spline x_tail;
+  spline y_tail;
+  x_tail.set_boundary(spline::first_deriv, x_slope, spline::second_deriv, 0.0);
+  y_tail.set_boundary(spline::first_deriv, y_slope, spline::second_deriv, 0.0);
+  spline::set_points(tail_chord_lengths,
+                     std::vector<double>(xs.begin() + tail_start, xs.end()),
+                     std::vector<double>(ys.begin() + tail_start, ys.end()),
+                     &x_tail, &y_tail);
+  x_spline_.splice(first, refit_start, x_tail, trimmed_chord_length);
+  y_spline_.splice(first, refit_start, y_tail, trimmed_chord_length);
+  xs_ = xs;
+  ys_ = ys;
+  chord_lengths_ = std::move(chord_lengths);
+  arc_length_ = chord_lengths_.back();
+  point_index_ = PointGridIndex(xs_, ys_);
+
+  // the samples up to the refit start keep their curve, only their origin moves
+  chord_origin_ -= trimmed_chord_length;
+  for (auto &curve_length : curve_length_table_) {
+    curve_length -= trimmed_curve_length;
+  }
+  TrimLeadingSamples(&chord_origin_, chord_step_, &curve_length_table_, &curve_length_derivative_table_);
+  const auto num_kept_curve_samples = std::min(
+      static_cast<size_t>(std::max((refit_chord_length - chord_origin_) / chord_step_, 0.0)) + 1,
+      curve_length_table_.size());
+  CalcCurveLengthSamples(num_kept_curve_samples);
+
+  const double refit_curve_length = ChordLengthToArcLength(refit_chord_length);
+  curve_origin_ -= trimmed_curve_length;
+  for (auto &chord_length : chord_length_table_) {
+    chord_length -= trimmed_chord_length;
+  }
+  TrimLeadingSamples(&curve_origin_, curve_step_, &chord_length_table_, &chord_length_derivative_table_);
+  const auto num_kept_chord_samples = std::min(
+      static_cast<size_t>(std::max((refit_curve_length - curve_origin_) / curve_step_, 0.0)) + 1,
+      chord_length_table_.size());
+  CalcChordLengthSamples(num_kept_chord_samples);
+  if (shift != nullptr) {
+    *shift = trimmed_chord_length;
+  }
+  return true;
+}
+
+double Spline2d::Speed(double t) const {
+  return std::hypot(x_spline_.deriv(1, t), y_spline_.deriv(1, t));
 }
 
 void Spline2d::CalcChordLengths() {
@@ -147,89 +369,50 @@ void Spline2d::CalcChordLengths() {
   }
 }
 
-double Spline2d::CalcArcLengthAtT(double t) const {
-  if (t < 1e-3) {
+double Spline2d::ChordLengthToArcLength(double t) const {
+  if (curve_length_table_.size() < 2 || chord_step_ <= 0.0) {
     return 0.0;
   }
-  if (t > arc_length_ - 1e-3) {
-    return arc_length_;
-  }
-  const double eps = 0.001;
-  return t * arc_length_;
-//  return AdaptiveSimpsonIntegral(0.0, t, eps);
+  return HermiteLookUp(curve_length_table_, curve_length_derivative_table_, chord_origin_, chord_step_,
+                       Clamp(t, 0.0, arc_length_));
 }
 
-bool Spline2d::ArcLengthMapToChordLength(double s, double *const t) const {
-//  int max_iter = 10;
-//  int iter = 0;
-//  const double iter_eps = 0.001;
-//  double approx_t = s / arc_length_;
-//  double pre_approx_t;
-//  while (iter < max_iter) {
-//    double approx_s = CalcArcLengthAtT(approx_t);
-//    double d = approx_s - s;
-//    if (std::fabs(d) < iter_eps) {
-//      break;
-//    }
-//    double first_derivative = std::hypot(spline2d_.derivatives(approx_t, 1)(0, 1),
-//                                         spline2d_.derivatives(approx_t, 1)(1, 1));
-//    double second_derivative = std::hypot(spline2d_.derivatives(approx_t, 2)(0, 2),
-//                                          spline2d_.derivatives(approx_t, 2)(1, 2));
-//    double numerator = d * first_derivative;
-//    double denominator = d * second_derivative + first_derivative * first_derivative;
-//    pre_approx_t = approx_t;
-//    approx_t -= numerator / denominator;
-//    if (std::fabs(pre_approx_t - approx_t) < iter_eps) {
-//      break;
-//    }
-//    iter++;
-//  }
-//  *t = approx_t;
-  *t = s / arc_length_;
-  return true;
+double Spline2d::ArcLengthToChordLength(double s) const {
+  if (chord_length_table_.size() < 2 || curve_step_ <= 0.0) {
+    return 0.0;
+  }
+  return HermiteLookUp(chord_length_table_, chord_length_derivative_table_, curve_origin_, curve_step_,
+                       Clamp(s, 0.0, curve_length_));
 }
 
-//double Spline2d::SimpsonIntegral(double l, double r) const {
-//  assert(r > l);
-//  const double mid_l = (2.0 * l + r) / 3.0;
-//  const double mid_r = (l + 2.0 * r) / 3.0;
-//  const double d_l = std::hypot(spline2d_.derivatives(l, 1)(0, 1),
-//                                spline2d_.derivatives(l, 1)(1, 1));
-//  const double d_mid_l = std::hypot(spline2d_.derivatives(mid_l, 1)(0, 1),
-//                                    spline2d_.derivatives(mid_l, 1)(1, 1));
-//  const double d_mid_r = std::hypot(spline2d_.derivatives(mid_r, 1)(0, 1),
-//                                    spline2d_.derivatives(mid_r, 1)(1, 1));
-//  const double d_r = std::hypot(spline2d_.derivatives(r, 1)(0, 1),
-//                                spline2d_.derivatives(r, 1)(1, 1));
-//  return (r - l) / 8.0 * (d_l + 3.0 * d_mid_l + 3.0 * d_mid_r + d_r);
-//}
-
-//double Spline2d::AdaptiveSimpsonIntegral(double l, double r, double eps) const {
-//
-//  double mid = (l + r) / 2.0;
-//
-//  double st = SimpsonIntegral(l, r);
-//  double sl = SimpsonIntegral(l, mid);
-//  double sr = SimpsonIntegral(mid, r);
-//  if (std::fabs(sl + sr - st) < 15.0 * eps) {
-//    return sl + sr + (sl + sr - st) / 15.0;
-//  } else {
-//    return AdaptiveSimpsonIntegral(l, mid, eps / 2.0) +
-//        AdaptiveSimpsonIntegral(mid, r, eps / 2.0);
-//  }
-//}
-
 bool Spline2d::GetNearestPointOnSpline(double x, double y,
                                        double *const nearest_x,
                                        double *const nearest_y,
                                        double *const nearest_s) const {
+  return GetNearestPointFromIndex(this->CalcNearestIndex(x, y), x, y, nearest_x, nearest_y, nearest_s);
+}
+
+bool Spline2d::GetNearestPointOnSpline(double x, double y,
+                                       double *const nearest_x,
+                                       double *const nearest_y,
+                                       double *const nearest_s,
+                                       int *const hint_index) const {
+  int min_index = *hint_index < 0 ? this->CalcNearestIndex(x, y)
+                                  : static_cast<int>(point_index_.NearestFromHint(x, y, *hint_index));
+  *hint_index = min_index;
+  return GetNearestPointFromIndex(min_index, x, y, nearest_x, nearest_y, nearest_s);
+}
+
+bool Spline2d::GetNearestPointFromIndex(int min_index, double x, double y,
+                                        double *const nearest_x,
+                                        double *const nearest_y,
+                                        double *const nearest_s) const {
   // 1. prepared, set the init s1, s2, s3
   // note: here we use the chord length rather than arc length for eliminating the calculate time;
 
   // t1, t2, t3, tk_star  refer to: Robust and Efficient Computation of the
   // Closest Point on a Spline Curve
   double s_opt;
-  int min_index = this->CalcNearestIndex(x, y);
 //  double t1 = chord_lengths_[min_index] / chord_lengths_.back();
   double s1 = chord_lengths_[min_index];
   Clamp(s1, chord_lengths_[0], chord_lengths_.back());
@@ -389,15 +572,6 @@ double Spline2d::Clamp(double t, double lb, double ub) {
 }
 
 int Spline2d::CalcNearestIndex(double x, double y) const {
-  double min_dist = std::numeric_limits<double>::max();
-  int min_index = 0;
-  for (size_t i = 0; i < xs_.size(); ++i) {
-    const double sqrt_dist = std::hypot(x - xs_[i], y - ys_[i]);
-    if (sqrt_dist < min_dist) {
-      min_dist = sqrt_dist;
-      min_index = i;
-    }
-  }
-  return min_index;
+  return static_cast<int>(point_index_.Nearest(x, y));
 }
 }
\ No newline at end of file
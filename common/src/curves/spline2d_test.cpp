@@ -145,6 +145,42 @@ TEST_F(Spline2dTest, evaluate) {
   EXPECT_NEAR(y, 18.965567614990277, 0.2);
 }
 
+TEST_F(Spline2dTest, arc_length_lookup) {
+  // the polyline through dense samples approaches the length along the curve from below
+  const size_t num_steps = 200000;
+  const double step = spline2d_->ArcLength() / num_steps;
+  double last_x, last_y;
+  spline2d_->Evaluate(0.0, &last_x, &last_y);
+  double polyline_length = 0.0;
+  std::vector<double> lengths(1, 0.0);
+  for (size_t i = 1; i <= num_steps; ++i) {
+    double x, y;
+    spline2d_->Evaluate(i * step, &x, &y);
+    polyline_length += std::hypot(x - last_x, y - last_y);
+    lengths.push_back(polyline_length);
+    last_x = x;
+    last_y = y;
+  }
+  EXPECT_NEAR(spline2d_->CurveLength(), polyline_length, 1e-4);
+  EXPECT_GE(spline2d_->CurveLength(), spline2d_->ChordLength().back());
+
+  for (size_t i = 0; i <= num_steps; i += 997) {
+    const double t = i * step;
+    const double s = spline2d_->ChordLengthToArcLength(t);
+    EXPECT_NEAR(s, lengths[i], 1e-3) << "t: " << t;
+    EXPECT_NEAR(spline2d_->ArcLengthToChordLength(s), t, 1e-3) << "s: " << s;
+  }
+  EXPECT_DOUBLE_EQ(spline2d_->ArcLengthToChordLength(0.0), 0.0);
+  EXPECT_DOUBLE_EQ(spline2d_->ArcLengthToChordLength(spline2d_->CurveLength() + 1.0), spline2d_->ArcLength());
+  EXPECT_DOUBLE_EQ(spline2d_->ChordLengthToArcLength(-1.0), 0.0);
+  double last_t = 0.0;
+  for (double s = 0.0; s < spline2d_->CurveLength(); s += 0.01) {
+    const double t = spline2d_->ArcLengthToChordLength(s);
+    EXPECT_GE(t, last_t);
+    last_t = t;
+  }
+}
+
 TEST_F(Spline2dTest, closed_point) {
   double x = 6.816157665116366;
   double y = -16.461121748326214;
@@ -194,6 +230,51 @@ TEST_F(Spline2dTest, derivatives) {
 //  std::cout << "dkappa: " << dkappa << std::endl;
 }
 
+TEST_F(Spline2dTest, evaluate_all) {
+  std::vector<double> ss;
+  for (double s = -1.0; s < spline2d_->ArcLength() + 1.0; s += 0.37) {
+    ss.push_back(s);
+  }
+  ss.push_back(spline2d_->ArcLength());
+  for (double knot : spline2d_->ChordLength()) {
+    ss.push_back(knot);
+  }
+  std::sort(ss.begin(), ss.end());
+  std::vector<Spline2dPoint> points;
+  spline2d_->EvaluateAll(ss, Spline2d::ALL_ORDERS, &points);
+  ASSERT_EQ(points.size(), ss.size());
+  for (size_t i = 0; i < ss.size(); ++i) {
+    double x, y, dx, dy, ddx, ddy, dddx, dddy;
+    spline2d_->Evaluate(ss[i], &x, &y);
+    spline2d_->EvaluateFirstDerivative(ss[i], &dx, &dy);
+    spline2d_->EvaluateSecondDerivative(ss[i], &ddx, &ddy);
+    spline2d_->EvaluateThirdDerivative(ss[i], &dddx, &dddy);
+    Spline2dPoint point;
+    EXPECT_TRUE(spline2d_->EvaluateAll(ss[i], Spline2d::ALL_ORDERS, &point));
+    for (const auto &evaluated : {point, points[i]}) {
+      EXPECT_EQ(evaluated.x, x) << "s: " << ss[i];
+      EXPECT_EQ(evaluated.y, y);
+      EXPECT_EQ(evaluated.dx, dx);
+      EXPECT_EQ(evaluated.dy, dy);
+      EXPECT_EQ(evaluated.ddx, ddx);
+      EXPECT_EQ(evaluated.ddy, ddy);
+      EXPECT_EQ(evaluated.dddx, dddx);
+      EXPECT_EQ(evaluated.dddy, dddy);
+    }
+  }
+  // only the orders asked for are set, the batch is also right out of order
+  std::reverse(ss.begin(), ss.end());
+  spline2d_->EvaluateAll(ss, Spline2d::FIRST_DERIVATIVE, &points);
+  for (size_t i = 0; i < ss.size(); ++i) {
+    double dx, dy;
+    spline2d_->EvaluateFirstDerivative(ss[i], &dx, &dy);
+    EXPECT_EQ(points[i].dx, dx);
+    EXPECT_EQ(points[i].dy, dy);
+    EXPECT_EQ(points[i].x, 0.0);
+    EXPECT_EQ(points[i].ddy, 0.0);
+  }
+}
+
 TEST_F(Spline2dTest, spline) {
   Eigen::MatrixXd xy(17, 2);
   xy << 127.413, -196.713,
@@ -225,6 +306,147 @@ TEST_F(Spline2dTest, spline) {
   spline2d->GetNearestPointOnSpline(117, -194, &x, &y, &s);
   std::cout << "x: " << x << " y: " << y << " s: " << s << std::endl;
 }
+
+TEST(Spline2dRefitTest, refit_slides_the_window) {
+  // a lane with a point every meter
+  std::vector<double> lane_xs, lane_ys;
+  for (size_t i = 0; i < 400; ++i) {
+    const double x = static_cast<double>(i);
+    lane_xs.push_back(x);
+    lane_ys.push_back(5.0 * std::sin(x / 40.0) + 0.3 * std::sin(x / 7.0));
+  }
+  auto window = [&](size_t begin, size_t end, std::vector<double> *xs, std::vector<double> *ys) {
+    xs->assign(lane_xs.begin() + begin, lane_xs.begin() + end);
+    ys->assign(lane_ys.begin() + begin, lane_ys.begin() + end);
+  };
+  std::vector<double> xs, ys;
+  window(0, 200, &xs, &ys);
+  Spline2d spline2d(xs, ys);
+  size_t begin = 0;
+  for (size_t step : {30, 7, 12, 1, 25}) {
+    const Spline2d last_spline2d = spline2d;
+    begin += step;
+    window(begin, begin + 200, &xs, &ys);
+    double shift = 0.0;
+    ASSERT_TRUE(spline2d.Refit(xs, ys, &shift));
+    EXPECT_DOUBLE_EQ(shift, last_spline2d.ChordLength()[step]);
+    EXPECT_NEAR(spline2d.ArcLength(), Spline2d(xs, ys).ArcLength(), 1e-9);
+    double x, y, last_x, last_y;
+    // the curve is kept up to the refit start
+    const double refit_start = spline2d.ChordLength()[200 - step - 9];
+    for (double t = 0.0; t < refit_start; t += 0.37) {
+      spline2d.Evaluate(t, &x, &y);
+      last_spline2d.Evaluate(t + shift, &last_x, &last_y);
+      EXPECT_NEAR(x, last_x, 1e-9);
+      EXPECT_NEAR(y, last_y, 1e-9);
+    }
+    // and close to the spline built from scratch away from its start
+    const Spline2d built_spline2d(xs, ys);
+    for (double t = 20.0; t < spline2d.ArcLength(); t += 0.37) {
+      spline2d.Evaluate(t, &x, &y);
+      built_spline2d.Evaluate(t, &last_x, &last_y);
+      EXPECT_NEAR(x, last_x, 1e-4) << "t: " << t;
+      EXPECT_NEAR(y, last_y, 1e-4) << "t: " << t;
+    }
+    // the lookup tables follow the refit curve
+    const size_t num_steps = 20000;
+    const double dt = spline2d.ArcLength() / num_steps;
+    spline2d.Evaluate(0.0, &last_x, &last_y);
+    double length = 0.0;
+    for (size_t i = 1; i <= num_steps; ++i) {
+      spline2d.Evaluate(i * dt, &x, &y);
+      length += std::hypot(x - last_x, y - last_y);
+      last_x = x;
+      last_y = y;
+      if (i % 499 == 0) {
+        EXPECT_NEAR(spline2d.ChordLengthToArcLength(i * dt), length, 1e-3) << "t: " << i * dt;
+        EXPECT_NEAR(spline2d.ArcLengthToChordLength(length), i * dt, 1e-3) << "s: " << length;
+      }
+    }
+    EXPECT_NEAR(spline2d.CurveLength(), length, 1e-3);
+    EXPECT_NEAR(spline2d.ChordLengthToArcLength(0.0), 0.0, 1e-9);
+  }
+}
+
+TEST(Spline2dRefitTest, refit_rejects_other_points) {
+  std::vector<double> xs, ys;
+  for (size_t i = 0; i < 50; ++i) {
+    xs.push_back(static_cast<double>(i));
+    ys.push_back(0.01 * static_cast<double>(i * i));
+  }
+  Spline2d spline2d(xs, ys);
+  const double arc_length = spline2d.ArcLength();
+  double shift = 0.0;
+  // not a point of the spline
+  std::vector<double> other_xs(xs.begin() + 5, xs.end());
+  std::vector<double> other_ys(ys.begin() + 5, ys.end());
+  other_ys[0] += 0.1;
+  EXPECT_FALSE(spline2d.Refit(other_xs, other_ys, &shift));
+  // too few shared points to keep any segment
+  other_xs.assign(xs.begin() + 40, xs.end());
+  other_ys.assign(ys.begin() + 40, ys.end());
+  for (size_t i = 0; i < 10; ++i) {
+    other_xs.push_back(50.0 + static_cast<double>(i));
+    other_ys.push_back(other_ys.back());
+  }
+  EXPECT_FALSE(spline2d.Refit(other_xs, other_ys, &shift));
+  EXPECT_DOUBLE_EQ(spline2d.ArcLength(), arc_length);
+}
+
+TEST(SimpleSplineTest, tridiagonal_solve) {
+  const std::vector<double> knots{0.0, 0.7, 1.5, 3.1, 3.4, 5.0, 6.2};
+  const std::vector<double> y0{1.0, -0.5, 2.0, 0.3, 0.8, -1.2, 0.0};
+  const std::vector<double> y1{0.0, 0.4, 0.9, 1.7, 2.1, 2.2, 3.5};
+  for (auto boundary : {spline::second_deriv, spline::first_deriv}) {
+    // the b[] of the general band matrix solve
+    const int n = knots.size();
+    band_matrix A(n, 1, 1);
+    std::vector<double> rhs(n);
+    for (int i = 1; i < n - 1; i++) {
+      A(i, i - 1) = 1.0 / 3.0 * (knots[i] - knots[i - 1]);
+      A(i, i) = 2.0 / 3.0 * (knots[i + 1] - knots[i - 1]);
+      A(i, i + 1) = 1.0 / 3.0 * (knots[i + 1] - knots[i]);
+      rhs[i] = (y0[i + 1] - y0[i]) / (knots[i + 1] - knots[i]) - (y0[i] - y0[i - 1]) / (knots[i] - knots[i - 1]);
+    }
+    const double h0 = knots[1] - knots[0];
+    const double h1 = knots[n - 1] - knots[n - 2];
+    if (boundary == spline::second_deriv) {
+      A(0, 0) = 2.0;
+      A(n - 1, n - 1) = 2.0;
+      rhs[0] = 0.5;
+      rhs[n - 1] = -0.3;
+    } else {
+      A(0, 0) = 2.0 * h0;
+      A(0, 1) = h0;
+      A(n - 1, n - 1) = 2.0 * h1;
+      A(n - 1, n - 2) = h1;
+      rhs[0] = 3.0 * ((y0[1] - y0[0]) / h0 - 0.5);
+      rhs[n - 1] = 3.0 * (-0.3 - (y0[n - 1] - y0[n - 2]) / h1);
+    }
+    const std::vector<double> b = A.lu_solve(rhs);
+
+    spline single, pair0, pair1;
+    single.set_boundary(boundary, 0.5, boundary, -0.3);
+    pair0.set_boundary(boundary, 0.5, boundary, -0.3);
+    pair1.set_boundary(boundary, 0.5, boundary, -0.3);
+    single.set_points(knots, y0);
+    spline::set_points(knots, y0, y1, &pair0, &pair1);
+    spline reference1;
+    reference1.set_boundary(boundary, 0.5, boundary, -0.3);
+    reference1.set_points(knots, y1);
+    for (int i = 0; i < n; ++i) {
+      // b[i] = f''(x_i) / 2
+      EXPECT_NEAR(single.deriv(2, knots[i]), 2.0 * b[i], 1e-12) << "boundary: " << boundary << ", i: " << i;
+      EXPECT_NEAR(single(knots[i]), y0[i], 1e-12);
+    }
+    for (double x = -0.5; x < 7.0; x += 0.05) {
+      EXPECT_DOUBLE_EQ(pair0(x), single(x));
+      EXPECT_DOUBLE_EQ(pair0.deriv(1, x), single.deriv(1, x));
+      EXPECT_DOUBLE_EQ(pair1(x), reference1(x));
+      EXPECT_DOUBLE_EQ(pair1.deriv(2, x), reference1.deriv(2, x));
+    }
+  }
+}
 }
 
 int main(int argc, char **argv) {
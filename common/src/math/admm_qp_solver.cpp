@@ -0,0 +1,107 @@
+#include "math/admm_qp_solver.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace common {
+namespace {
+// the ADMM stops once both residuals are below kAbsTolerance + kRelTolerance * their scale
+constexpr double kAbsTolerance = 1e-4;
+constexpr double kRelTolerance = 1e-4;
+// the equality rows get a much stiffer step like in OSQP
+constexpr double kEqualityRhoScale = 1e3;
+constexpr int kCheckInterval = 10;
+
+double InfNorm(const Eigen::VectorXd &v) {
+  return v.size() == 0 ? 0.0 : v.lpNorm<Eigen::Infinity>();
+}
+}
+
+void AdmmQpSolver::SetWarmStart(const Eigen::VectorXd &x) {
+  x_ = x;
+  y_.resize(0);
+}
+
+bool AdmmQpSolver::Solve(const SparseMatrix &P, const Eigen::VectorXd &q, const SparseMatrix &A,
+                         const Eigen::VectorXd &l, const Eigen::VectorXd &u) {
+  const Eigen::Index num_variables = P.rows();
+  const Eigen::Index num_constraints = A.rows();
+  if (x_.size() != num_variables) {
+    x_ = Eigen::VectorXd::Zero(num_variables);
+  }
+  if (y_.size() != num_constraints) {
+    y_ = Eigen::VectorXd::Zero(num_constraints);
+  }
+  Eigen::VectorXd rho(num_constraints);
+  for (Eigen::Index i = 0; i < num_constraints; ++i) {
+    rho[i] = l[i] == u[i] ? kEqualityRhoScale * rho_ : rho_;
+  }
+  SparseMatrix identity(num_variables, num_variables);
+  identity.setIdentity();
+  const SparseMatrix kkt = P + sigma_ * identity + SparseMatrix(A.transpose() * rho.asDiagonal() * A);
+  if (num_analyzed_variables_ != num_variables || num_analyzed_non_zeros_ != kkt.nonZeros()) {
+    kkt_solver_.analyzePattern(kkt);
+    num_analyzed_variables_ = num_variables;
+    num_analyzed_non_zeros_ = kkt.nonZeros();
+  }
+  kkt_solver_.factorize(kkt);
+  if (kkt_solver_.info() != Eigen::Success) {
+    num_analyzed_variables_ = 0;
+    return false;
+  }
+  const SparseMatrix A_transpose = A.transpose();
+  z_ = (A * x_).cwiseMax(l).cwiseMin(u);
+  Eigen::VectorXd x_tilde(num_variables);
+  Eigen::VectorXd z_tilde(num_constraints);
+  Eigen::VectorXd z_next(num_constraints);
+  for (int iter = 1; iter <= max_iter_; ++iter) {
+    x_tilde = kkt_solver_.solve(sigma_ * x_ - q + A_transpose * (rho.cwiseProduct(z_) - y_));
+    z_tilde = A * x_tilde;
+    x_ = alpha_ * x_tilde + (1.0 - alpha_) * x_;
+    z_tilde = alpha_ * z_tilde + (1.0 - alpha_) * z_;
+    z_next = (z_tilde + y_.cwiseQuotient(rho)).cwiseMax(l).cwiseMin(u);
+    y_ += rho.cwiseProduct(z_tilde - z_next);
+    z_.swap(z_next);
+    if (iter % kCheckInterval != 0) {
+      continue;
+    }
+    const Eigen::VectorXd Ax = A * x_;
+    const Eigen::VectorXd Px = P * x_;
+    const Eigen::VectorXd Aty = A_transpose * y_;
+    const double primal_residual = InfNorm(Ax - z_);
+    const double dual_residual = InfNorm(Px + q + Aty);
+    const double primal_tolerance = kAbsTolerance + kRelTolerance * std::max(InfNorm(Ax), InfNorm(z_));
+    const double dual_tolerance =
+        kAbsTolerance + kRelTolerance * std::max(std::max(InfNorm(Px), InfNorm(Aty)), InfNorm(q));
+    if (primal_residual < primal_tolerance && dual_residual < dual_tolerance) {
+      SnapPinnedVariables(A, l, u);
+      return true;
+    }
+  }
+  // a diverged iterate is no warm start
+  x_.resize(0);
+  y_.resize(0);
+  return false;
+}
+
+void AdmmQpSolver::SnapPinnedVariables(const SparseMatrix &A, const Eigen::VectorXd &l, const Eigen::VectorXd &u) {
+  // the number of non zero coefficients of every row, and the column and the coefficient of the last one
+  std::vector<int> row_non_zeros(A.rows(), 0);
+  std::vector<Eigen::Index> row_cols(A.rows(), 0);
+  std::vector<double> row_coeffs(A.rows(), 0.0);
+  for (Eigen::Index col = 0; col < A.outerSize(); ++col) {
+    for (SparseMatrix::InnerIterator it(A, col); it; ++it) {
+      if (it.value() != 0.0) {
+        ++row_non_zeros[it.row()];
+        row_cols[it.row()] = it.col();
+        row_coeffs[it.row()] = it.value();
+      }
+    }
+  }
+  for (Eigen::Index row = 0; row < A.rows(); ++row) {
+    if (row_non_zeros[row] == 1 && l[row] == u[row]) {
+      x_[row_cols[row]] = l[row] / row_coeffs[row];
+    }
+  }
+}
+
+}
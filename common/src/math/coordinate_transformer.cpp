@@ -117,6 +117,95 @@ void CoordinateTransformer::FrenetToCartesian(double rs, double rx,
           (d_condition[1] * delta_theta_prime - kappa_r_d_prime);
 }
 
+void FrenetBatch::Clear(size_t capacity) {
+  for (auto *field : {&rx, &ry, &rtheta, &rkappa, &rdkappa, &s_dot, &s_dot_dot, &d, &d_prime, &d_prime_prime}) {
+    field->clear();
+    field->reserve(capacity);
+  }
+}
+
+void FrenetBatch::Append(double ref_x, double ref_y, double ref_theta, double ref_kappa, double ref_dkappa,
+                         const std::array<double, 3> &s_condition, const std::array<double, 3> &d_condition) {
+  rx.push_back(ref_x);
+  ry.push_back(ref_y);
+  rtheta.push_back(ref_theta);
+  rkappa.push_back(ref_kappa);
+  rdkappa.push_back(ref_dkappa);
+  s_dot.push_back(s_condition[1]);
+  s_dot_dot.push_back(s_condition[2]);
+  d.push_back(d_condition[0]);
+  d_prime.push_back(d_condition[1]);
+  d_prime_prime.push_back(d_condition[2]);
+}
+
+void CartesianBatch::Resize(size_t size) {
+  for (auto *field : {&x, &y, &theta, &kappa, &v, &a}) {
+    field->resize(size);
+  }
+}
+
+void CoordinateTransformer::FrenetToCartesian(const FrenetBatch &frenet, CartesianBatch *cartesian) {
+  const size_t size = frenet.Size();
+  cartesian->Resize(size);
+  const double *const rx = frenet.rx.data();
+  const double *const ry = frenet.ry.data();
+  const double *const rtheta = frenet.rtheta.data();
+  const double *const rkappa = frenet.rkappa.data();
+  const double *const rdkappa = frenet.rdkappa.data();
+  const double *const s_dot = frenet.s_dot.data();
+  const double *const s_dot_dot = frenet.s_dot_dot.data();
+  const double *const d = frenet.d.data();
+  const double *const d_prime = frenet.d_prime.data();
+  const double *const d_prime_prime = frenet.d_prime_prime.data();
+  double *const x = cartesian->x.data();
+  double *const y = cartesian->y.data();
+  double *const theta = cartesian->theta.data();
+  double *const kappa = cartesian->kappa.data();
+  double *const v = cartesian->v.data();
+  double *const a = cartesian->a.data();
+  for (size_t i = 0; i < size; ++i) {
+    const double cos_theta_r = std::cos(rtheta[i]);
+    const double sin_theta_r = std::sin(rtheta[i]);
+    x[i] = rx[i] - sin_theta_r * d[i];
+    y[i] = ry[i] + cos_theta_r * d[i];
+
+    const double one_minus_kappa_r_d = 1 - rkappa[i] * d[i];
+    const double tan_delta_theta = d_prime[i] / one_minus_kappa_r_d;
+    // cos(atan2(y, x)) = x / hypot(x, y) in every quadrant
+    const double cos_delta_theta =
+        one_minus_kappa_r_d / std::sqrt(one_minus_kappa_r_d * one_minus_kappa_r_d + d_prime[i] * d_prime[i]);
+    theta[i] = MathUtils::NormalizeAngle(std::atan2(d_prime[i], one_minus_kappa_r_d) + rtheta[i]);
+
+    const double kappa_r_d_prime = rdkappa[i] * d[i] + rkappa[i] * d_prime[i];
+    kappa[i] = (((d_prime_prime[i] + kappa_r_d_prime * tan_delta_theta) * cos_delta_theta * cos_delta_theta)
+        / one_minus_kappa_r_d + rkappa[i]) * cos_delta_theta / one_minus_kappa_r_d;
+
+    const double d_dot = d_prime[i] * s_dot[i];
+    v[i] = std::sqrt(one_minus_kappa_r_d * one_minus_kappa_r_d * s_dot[i] * s_dot[i] + d_dot * d_dot);
+
+    const double delta_theta_prime = one_minus_kappa_r_d / cos_delta_theta * kappa[i] - rkappa[i];
+    a[i] = s_dot_dot[i] * one_minus_kappa_r_d / cos_delta_theta
+        + s_dot[i] * s_dot[i] / cos_delta_theta * (d_prime[i] * delta_theta_prime - kappa_r_d_prime);
+  }
+}
+
+void CoordinateTransformer::CartesianToFrenet(const std::vector<double> &rtheta,
+                                              const std::vector<double> &rx,
+                                              const std::vector<double> &ry,
+                                              const std::vector<double> &x,
+                                              const std::vector<double> &y,
+                                              std::vector<double> *d) {
+  const size_t size = x.size();
+  assert(rtheta.size() == size && rx.size() == size && ry.size() == size && y.size() == size);
+  d->resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    const double dx = x[i] - rx[i];
+    const double dy = y[i] - ry[i];
+    const double cross_rd_nd = std::cos(rtheta[i]) * dy - std::sin(rtheta[i]) * dx;
+    (*d)[i] = std::copysign(std::sqrt(dx * dx + dy * dy), cross_rd_nd);
+  }
+}
+
 double CoordinateTransformer::CalcTheta(double rtheta, double rkappa,
                                         double l, double dl) {
   return MathUtils::NormalizeAngle(rtheta + std::atan2(dl, 1 - l * rkappa));
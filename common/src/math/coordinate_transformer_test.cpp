@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "math/math_utils.hpp"
+#include "math/coordinate_transformer.hpp"
+
+namespace common {
+TEST(CoordinateTransformerTest, batch_frenet_to_cartesian) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> position(-100.0, 100.0);
+  std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+  std::uniform_real_distribution<double> curvature(-0.05, 0.05);
+  std::uniform_real_distribution<double> offset(-3.0, 3.0);
+  std::uniform_real_distribution<double> derivative(-0.5, 0.5);
+  std::uniform_real_distribution<double> vel(0.0, 20.0);
+  FrenetBatch frenet;
+  frenet.Clear(200);
+  std::vector<std::array<double, 3>> s_conditions;
+  std::vector<std::array<double, 3>> d_conditions;
+  for (size_t i = 0; i < 200; ++i) {
+    s_conditions.push_back({position(gen), vel(gen), derivative(gen)});
+    d_conditions.push_back({offset(gen), derivative(gen), 0.1 * derivative(gen)});
+    frenet.Append(position(gen), position(gen), heading(gen), curvature(gen), 0.1 * curvature(gen),
+                  s_conditions.back(), d_conditions.back());
+  }
+  CartesianBatch cartesian;
+  CoordinateTransformer::FrenetToCartesian(frenet, &cartesian);
+  ASSERT_EQ(cartesian.Size(), frenet.Size());
+  for (size_t i = 0; i < frenet.Size(); ++i) {
+    double x, y, theta, kappa, v, a;
+    CoordinateTransformer::FrenetToCartesian(s_conditions[i][0], frenet.rx[i], frenet.ry[i], frenet.rtheta[i],
+                                             frenet.rkappa[i], frenet.rdkappa[i], s_conditions[i], d_conditions[i],
+                                             &x, &y, &theta, &kappa, &v, &a);
+    EXPECT_NEAR(cartesian.x[i], x, 1e-9);
+    EXPECT_NEAR(cartesian.y[i], y, 1e-9);
+    EXPECT_NEAR(MathUtils::NormalizeAngle(cartesian.theta[i] - theta), 0.0, 1e-9);
+    EXPECT_NEAR(cartesian.kappa[i], kappa, 1e-9);
+    EXPECT_NEAR(cartesian.v[i], v, 1e-9);
+    EXPECT_NEAR(cartesian.a[i], a, 1e-9);
+  }
+}
+
+TEST(CoordinateTransformerTest, batch_cartesian_to_frenet) {
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> position(-100.0, 100.0);
+  std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+  std::uniform_real_distribution<double> offset(-3.0, 3.0);
+  std::vector<double> rtheta, rx, ry, x, y;
+  for (size_t i = 0; i < 200; ++i) {
+    rtheta.push_back(heading(gen));
+    rx.push_back(position(gen));
+    ry.push_back(position(gen));
+    x.push_back(rx.back() + offset(gen));
+    y.push_back(ry.back() + offset(gen));
+  }
+  std::vector<double> d;
+  CoordinateTransformer::CartesianToFrenet(rtheta, rx, ry, x, y, &d);
+  ASSERT_EQ(d.size(), x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    double s, expected_d;
+    CoordinateTransformer::CartesianToFrenet(0.0, rx[i], ry[i], rtheta[i], x[i], y[i], &s, &expected_d);
+    EXPECT_NEAR(d[i], expected_d, 1e-12);
+  }
+}
+}
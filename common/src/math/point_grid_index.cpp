@@ -0,0 +1,186 @@
+#include "math/point_grid_index.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ros/assert.h>
+
+namespace common {
+
+namespace {
+// the grid never holds more cells than this, the cells grow for sparse or very long polylines
+constexpr long kMaxNumCells = 1L << 16;
+constexpr double kMinCellSize = 0.5;
+}
+
+PointGridIndex::PointGridIndex(const std::vector<double> &xs, const std::vector<double> &ys)
+    : xs_(xs), ys_(ys) {
+  ROS_ASSERT(xs_.size() == ys_.size());
+  if (xs_.empty()) {
+    return;
+  }
+  const size_t num_points = xs_.size();
+  min_x_ = *std::min_element(xs_.begin(), xs_.end());
+  min_y_ = *std::min_element(ys_.begin(), ys_.end());
+  double polyline_length = 0.0;
+  for (size_t i = 1; i < num_points; ++i) {
+    polyline_length += std::hypot(xs_[i] - xs_[i - 1], ys_[i] - ys_[i - 1]);
+  }
+  const double mean_gap = num_points > 1 ? polyline_length / static_cast<double>(num_points - 1) : 0.0;
+  Build(2.0 * mean_gap);
+}
+
+PointGridIndex::PointGridIndex(const std::vector<double> &xs, const std::vector<double> &ys, double cell_size)
+    : xs_(xs), ys_(ys) {
+  ROS_ASSERT(xs_.size() == ys_.size());
+  if (xs_.empty()) {
+    return;
+  }
+  min_x_ = *std::min_element(xs_.begin(), xs_.end());
+  min_y_ = *std::min_element(ys_.begin(), ys_.end());
+  Build(cell_size);
+}
+
+void PointGridIndex::Build(double cell_size) {
+  const size_t num_points = xs_.size();
+  const double max_x = *std::max_element(xs_.begin(), xs_.end());
+  const double max_y = *std::max_element(ys_.begin(), ys_.end());
+  cell_size_ = std::max(cell_size, kMinCellSize);
+  while (true) {
+    num_cells_x_ = static_cast<long>((max_x - min_x_) / cell_size_) + 1;
+    num_cells_y_ = static_cast<long>((max_y - min_y_) / cell_size_) + 1;
+    if (num_cells_x_ * num_cells_y_ <= kMaxNumCells) {
+      break;
+    }
+    cell_size_ *= 2.0;
+  }
+
+  // counting sort of the points into the cells, the points of a cell keep ascending order
+  std::vector<size_t> cell_ids(num_points);
+  cell_starts_.assign(static_cast<size_t>(num_cells_x_ * num_cells_y_) + 1, 0);
+  for (size_t i = 0; i < num_points; ++i) {
+    const auto cell_x = std::min(static_cast<long>((xs_[i] - min_x_) / cell_size_), num_cells_x_ - 1);
+    const auto cell_y = std::min(static_cast<long>((ys_[i] - min_y_) / cell_size_), num_cells_y_ - 1);
+    cell_ids[i] = static_cast<size_t>(cell_y * num_cells_x_ + cell_x);
+    ++cell_starts_[cell_ids[i] + 1];
+  }
+  for (size_t i = 1; i < cell_starts_.size(); ++i) {
+    cell_starts_[i] += cell_starts_[i - 1];
+  }
+  cell_points_.resize(num_points);
+  std::vector<size_t> fill = cell_starts_;
+  for (size_t i = 0; i < num_points; ++i) {
+    cell_points_[fill[cell_ids[i]]++] = i;
+  }
+}
+
+double PointGridIndex::SquaredDistance(size_t index, double x, double y) const {
+  const double dx = xs_[index] - x;
+  const double dy = ys_[index] - y;
+  return dx * dx + dy * dy;
+}
+
+void PointGridIndex::SearchRing(long cell_x, long cell_y, long ring, double x, double y,
+                                size_t *const nearest_index, double *const nearest_dist_sqr) const {
+  auto search_cell = [&](long ix, long iy) {
+    const auto cell = static_cast<size_t>(iy * num_cells_x_ + ix);
+    for (size_t k = cell_starts_[cell]; k < cell_starts_[cell + 1]; ++k) {
+      const size_t index = cell_points_[k];
+      const double dist_sqr = SquaredDistance(index, x, y);
+      if (dist_sqr < *nearest_dist_sqr || (dist_sqr == *nearest_dist_sqr && index < *nearest_index)) {
+        *nearest_dist_sqr = dist_sqr;
+        *nearest_index = index;
+      }
+    }
+  };
+  const long min_iy = std::max(cell_y - ring, 0L);
+  const long max_iy = std::min(cell_y + ring, num_cells_y_ - 1);
+  const long min_ix = std::max(cell_x - ring, 0L);
+  const long max_ix = std::min(cell_x + ring, num_cells_x_ - 1);
+  for (long iy = min_iy; iy <= max_iy; ++iy) {
+    if (iy == cell_y - ring || iy == cell_y + ring) {
+      for (long ix = min_ix; ix <= max_ix; ++ix) {
+        search_cell(ix, iy);
+      }
+      continue;
+    }
+    if (cell_x - ring >= 0 && cell_x - ring < num_cells_x_) {
+      search_cell(cell_x - ring, iy);
+    }
+    if (ring > 0 && cell_x + ring >= 0 && cell_x + ring < num_cells_x_) {
+      search_cell(cell_x + ring, iy);
+    }
+  }
+}
+
+size_t PointGridIndex::Nearest(double x, double y) const {
+  if (xs_.empty()) {
+    return 0;
+  }
+  // clamp before the cast, the query may lie far away from the grid
+  const double kMaxCellCoord = 1e9;
+  const auto cell_x = static_cast<long>(std::floor(
+      std::max(-kMaxCellCoord, std::min(kMaxCellCoord, (x - min_x_) / cell_size_))));
+  const auto cell_y = static_cast<long>(std::floor(
+      std::max(-kMaxCellCoord, std::min(kMaxCellCoord, (y - min_y_) / cell_size_))));
+  const long outside_x = cell_x < 0 ? -cell_x : std::max(cell_x - num_cells_x_ + 1, 0L);
+  const long outside_y = cell_y < 0 ? -cell_y : std::max(cell_y - num_cells_y_ + 1, 0L);
+  const long first_ring = std::max(outside_x, outside_y);
+  const long last_ring = first_ring + std::max(num_cells_x_, num_cells_y_);
+  size_t nearest_index = 0;
+  double nearest_dist_sqr = std::numeric_limits<double>::max();
+  for (long ring = first_ring; ring <= last_ring; ++ring) {
+    SearchRing(cell_x, cell_y, ring, x, y, &nearest_index, &nearest_dist_sqr);
+    // every point beyond this ring is at least ring * cell_size_ away
+    const double ring_dist = static_cast<double>(ring) * cell_size_;
+    if (nearest_dist_sqr < ring_dist * ring_dist) {
+      break;
+    }
+  }
+  return nearest_index;
+}
+
+void PointGridIndex::WithinRadius(double x, double y, double radius, std::vector<size_t> *const indices) const {
+  indices->clear();
+  if (xs_.empty() || radius < 0.0) {
+    return;
+  }
+  // the cell range of the bounding box of the circle, empty if the circle misses the grid
+  const double kMaxCellCoord = 1e9;
+  auto to_cell = [&](double coord, double min_coord, long num_cells) {
+    const double cell = std::floor(std::max(-kMaxCellCoord, std::min(kMaxCellCoord, (coord - min_coord) / cell_size_)));
+    return std::max(0L, std::min(static_cast<long>(cell), num_cells - 1));
+  };
+  const long min_ix = to_cell(x - radius, min_x_, num_cells_x_);
+  const long max_ix = to_cell(x + radius, min_x_, num_cells_x_);
+  const long min_iy = to_cell(y - radius, min_y_, num_cells_y_);
+  const long max_iy = to_cell(y + radius, min_y_, num_cells_y_);
+  const double radius_sqr = radius * radius;
+  for (long iy = min_iy; iy <= max_iy; ++iy) {
+    for (long ix = min_ix; ix <= max_ix; ++ix) {
+      const auto cell = static_cast<size_t>(iy * num_cells_x_ + ix);
+      for (size_t k = cell_starts_[cell]; k < cell_starts_[cell + 1]; ++k) {
+        if (SquaredDistance(cell_points_[k], x, y) <= radius_sqr) {
+          indices->push_back(cell_points_[k]);
+        }
+      }
+    }
+  }
+  std::sort(indices->begin(), indices->end());
+}
+
+size_t PointGridIndex::NearestFromHint(double x, double y, size_t hint_index) const {
+  if (xs_.empty()) {
+    return 0;
+  }
+  size_t index = std::min(hint_index, xs_.size() - 1);
+  double dist_sqr = SquaredDistance(index, x, y);
+  while (index + 1 < xs_.size() && SquaredDistance(index + 1, x, y) < dist_sqr) {
+    dist_sqr = SquaredDistance(++index, x, y);
+  }
+  while (index > 0 && SquaredDistance(index - 1, x, y) < dist_sqr) {
+    dist_sqr = SquaredDistance(--index, x, y);
+  }
+  return index;
+}
+
+}
@@ -0,0 +1,110 @@
+#include "math/point_grid_index.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace common {
+namespace {
+size_t LinearNearest(const std::vector<double> &xs, const std::vector<double> &ys, double x, double y) {
+  double min_dist_sqr = std::numeric_limits<double>::max();
+  size_t min_index = 0;
+  for (size_t i = 0; i < xs.size(); ++i) {
+    const double dist_sqr = (xs[i] - x) * (xs[i] - x) + (ys[i] - y) * (ys[i] - y);
+    if (dist_sqr < min_dist_sqr) {
+      min_dist_sqr = dist_sqr;
+      min_index = i;
+    }
+  }
+  return min_index;
+}
+}
+
+TEST(PointGridIndexTest, nearest_matches_linear_scan) {
+  // a lane going straight and then turning along an arc
+  std::vector<double> xs, ys;
+  for (size_t i = 0; i < 100; ++i) {
+    xs.push_back(static_cast<double>(i));
+    ys.push_back(0.0);
+  }
+  const double radius = 40.0;
+  for (size_t i = 1; i < 150; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    xs.push_back(99.0 + radius * std::sin(theta));
+    ys.push_back(radius * (1.0 - std::cos(theta)));
+  }
+  PointGridIndex index(xs, ys);
+  EXPECT_EQ(index.Size(), xs.size());
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> x_distribution(-50.0, 200.0);
+  std::uniform_real_distribution<double> y_distribution(-60.0, 120.0);
+  for (size_t i = 0; i < 2000; ++i) {
+    const double x = x_distribution(generator);
+    const double y = y_distribution(generator);
+    EXPECT_EQ(index.Nearest(x, y), LinearNearest(xs, ys, x, y)) << "x: " << x << ", y: " << y;
+  }
+  // far away from the grid
+  EXPECT_EQ(index.Nearest(-1e4, 3.0), LinearNearest(xs, ys, -1e4, 3.0));
+  EXPECT_EQ(index.Nearest(1e12, -1e12), LinearNearest(xs, ys, 1e12, -1e12));
+}
+
+TEST(PointGridIndexTest, nearest_from_hint) {
+  std::vector<double> xs, ys;
+  for (size_t i = 0; i < 200; ++i) {
+    xs.push_back(static_cast<double>(i) * 0.5);
+    ys.push_back(0.1 * static_cast<double>(i));
+  }
+  PointGridIndex index(xs, ys);
+  size_t hint = index.Nearest(0.3, 1.0);
+  for (double x = 0.3; x < 95.0; x += 0.4) {
+    hint = index.NearestFromHint(x, 0.2 * x + 1.0, hint);
+    EXPECT_EQ(hint, LinearNearest(xs, ys, x, 0.2 * x + 1.0));
+  }
+  EXPECT_EQ(index.NearestFromHint(1.0, 0.2, 10000), LinearNearest(xs, ys, 1.0, 0.2));
+}
+
+TEST(PointGridIndexTest, within_radius_matches_linear_scan) {
+  // scattered actors over a town
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<double> distribution(-300.0, 300.0);
+  std::vector<double> xs, ys;
+  for (size_t i = 0; i < 500; ++i) {
+    xs.push_back(distribution(generator));
+    ys.push_back(distribution(generator));
+  }
+  PointGridIndex index(xs, ys, 20.0);
+  std::vector<size_t> indices;
+  for (const double radius : {0.0, 15.0, 80.0, 1000.0}) {
+    for (size_t i = 0; i < 50; ++i) {
+      const double x = 1.5 * distribution(generator);
+      const double y = 1.5 * distribution(generator);
+      index.WithinRadius(x, y, radius, &indices);
+      std::vector<size_t> expected;
+      for (size_t k = 0; k < xs.size(); ++k) {
+        if (std::hypot(xs[k] - x, ys[k] - y) <= radius) {
+          expected.push_back(k);
+        }
+      }
+      EXPECT_EQ(indices, expected) << "x: " << x << ", y: " << y << ", radius: " << radius;
+    }
+  }
+  PointGridIndex empty_index;
+  empty_index.WithinRadius(0.0, 0.0, 10.0, &indices);
+  EXPECT_TRUE(indices.empty());
+}
+
+TEST(PointGridIndexTest, empty_and_single_point) {
+  PointGridIndex empty_index;
+  EXPECT_TRUE(empty_index.Empty());
+  EXPECT_EQ(empty_index.Nearest(1.0, 2.0), 0);
+  PointGridIndex single_index({3.0}, {4.0});
+  EXPECT_EQ(single_index.Nearest(-100.0, 2.0), 0);
+  EXPECT_EQ(single_index.NearestFromHint(-100.0, 2.0, 5), 0);
+}
+
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
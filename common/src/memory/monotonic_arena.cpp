@@ -0,0 +1,53 @@
+#include "memory/monotonic_arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace common {
+
+MonotonicArena::MonotonicArena(size_t block_size) : block_size_(std::max<size_t>(1, block_size)) {}
+
+void *MonotonicArena::Allocate(size_t bytes, size_t alignment) {
+  while (current_block_ < blocks_.size()) {
+    auto &block = blocks_[current_block_];
+    const auto address = reinterpret_cast<uintptr_t>(block.data.get()) + offset_;
+    const size_t padding = (alignment - address % alignment) % alignment;
+    if (offset_ + padding + bytes <= block.size) {
+      offset_ += padding + bytes;
+      bytes_used_ += padding + bytes;
+      return reinterpret_cast<void *>(address + padding);
+    }
+    // the rest of the block is given up, the next one is tried from its start
+    ++current_block_;
+    offset_ = 0;
+  }
+  AddBlock(std::max(block_size_, bytes + alignment));
+  return Allocate(bytes, alignment);
+}
+
+void MonotonicArena::Reset() {
+  if (blocks_.size() > 1) {
+    const size_t capacity = Capacity();
+    blocks_.clear();
+    AddBlock(capacity);
+  }
+  current_block_ = 0;
+  offset_ = 0;
+  bytes_used_ = 0;
+}
+
+size_t MonotonicArena::Capacity() const {
+  size_t capacity = 0;
+  for (const auto &block : blocks_) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+void MonotonicArena::AddBlock(size_t size) {
+  Block block;
+  block.data.reset(new char[size]);
+  block.size = size;
+  blocks_.push_back(std::move(block));
+}
+
+}
@@ -0,0 +1,82 @@
+#include "memory/monotonic_arena.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace common {
+namespace {
+struct alignas(32) Aligned {
+  double values[4];
+};
+
+struct Counted {
+  explicit Counted(int *num_alive) : num_alive(num_alive) { ++*num_alive; }
+  ~Counted() { --*num_alive; }
+  int *num_alive;
+};
+}
+
+TEST(MonotonicArenaTest, allocations_are_aligned_and_disjoint) {
+  MonotonicArena arena(256);
+  std::vector<std::pair<uintptr_t, size_t>> ranges;
+  for (size_t i = 1; i < 200; ++i) {
+    const size_t alignment = size_t{1} << (i % 6);
+    const auto address = reinterpret_cast<uintptr_t>(arena.Allocate(i, alignment));
+    EXPECT_EQ(address % alignment, 0u) << i;
+    ranges.emplace_back(address, i);
+  }
+  std::sort(ranges.begin(), ranges.end());
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    EXPECT_LE(ranges[i - 1].first + ranges[i - 1].second, ranges[i].first);
+  }
+  EXPECT_GT(arena.NumBlocks(), 1u);
+}
+
+TEST(MonotonicArenaTest, reset_merges_blocks_and_reuses_them) {
+  MonotonicArena arena(128);
+  for (int i = 0; i < 100; ++i) {
+    arena.Allocate(64);
+  }
+  const size_t capacity = arena.Capacity();
+  EXPECT_GE(capacity, 6400u);
+  arena.Reset();
+  EXPECT_EQ(arena.NumBlocks(), 1u);
+  EXPECT_EQ(arena.Capacity(), capacity);
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+  // the same cycle again fits into the merged block
+  for (int i = 0; i < 100; ++i) {
+    arena.Allocate(64);
+  }
+  EXPECT_EQ(arena.NumBlocks(), 1u);
+  EXPECT_EQ(arena.BytesUsed(), 6400u);
+}
+
+TEST(MonotonicArenaTest, containers_and_shared_objects_on_arena) {
+  MonotonicArena arena(1024);
+  {
+    std::vector<Aligned, ArenaAllocator<Aligned>> aligned{ArenaAllocator<Aligned>(&arena)};
+    for (int i = 0; i < 100; ++i) {
+      aligned.push_back(Aligned());
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned.data()) % alignof(Aligned), 0u);
+    }
+    EXPECT_GE(arena.BytesUsed(), 100 * sizeof(Aligned));
+  }
+  int num_alive = 0;
+  {
+    auto counted = MakeShared<Counted>(&arena, &num_alive);
+    auto copy = counted;
+    EXPECT_EQ(num_alive, 1);
+  }
+  EXPECT_EQ(num_alive, 0);
+  arena.Reset();
+  // without an arena the allocator is the heap
+  const size_t capacity = arena.Capacity();
+  std::vector<int, ArenaAllocator<int>> on_heap(1000, 1);
+  auto shared_on_heap = MakeShared<Counted>(nullptr, &num_alive);
+  EXPECT_EQ(on_heap.get_allocator().arena(), nullptr);
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+  EXPECT_EQ(arena.Capacity(), capacity);
+}
+
+}
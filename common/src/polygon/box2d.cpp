@@ -2,6 +2,7 @@
 #include "polygon/box2d.hpp"
 #include "math/math_utils.hpp"
 #include <Eigen/Core>
+#include <algorithm>
 #include <utility>
 namespace common {
 
@@ -27,11 +28,10 @@ void Box2d::InitCorners() {
   const double dy1 = sin_heading_ * half_length_;
   const double dx2 = sin_heading_ * half_width_;
   const double dy2 = -cos_heading_ * half_width_;
-  corners_.clear();
-  corners_.emplace_back(center_.x() + dx1 + dx2, center_.y() + dy1 + dy2);
-  corners_.emplace_back(center_.x() + dx1 - dx2, center_.y() + dy1 - dy2);
-  corners_.emplace_back(center_.x() - dx1 - dx2, center_.y() - dy1 - dy2);
-  corners_.emplace_back(center_.x() - dx1 + dx2, center_.y() - dy1 + dy2);
+  corners_[0] = Eigen::Vector2d(center_.x() + dx1 + dx2, center_.y() + dy1 + dy2);
+  corners_[1] = Eigen::Vector2d(center_.x() + dx1 - dx2, center_.y() + dy1 - dy2);
+  corners_[2] = Eigen::Vector2d(center_.x() - dx1 - dx2, center_.y() - dy1 - dy2);
+  corners_[3] = Eigen::Vector2d(center_.x() - dx1 + dx2, center_.y() - dy1 + dy2);
 
   for (auto &corner : corners_) {
     max_x_ = std::fmax(corner.x(), max_x_);
@@ -42,9 +42,11 @@ void Box2d::InitCorners() {
 }
 
 std::vector<Eigen::Vector2d> Box2d::GetAllCorners() const {
-  return corners_;
+  return {corners_.begin(), corners_.end()};
 }
 
+const std::array<Eigen::Vector2d, 4> &Box2d::Corners() const { return corners_; }
+
 bool Box2d::IsPointIn(const Eigen::Vector2d &point) const {
   const double x0 = point.x() - center_.x();
   const double y0 = point.y() - center_.y();
@@ -78,6 +80,18 @@ double Box2d::DistanceToPoint(const Eigen::Vector2d &point) const {
   return hypot(dx, dy);
 }
 
+double Box2d::DistanceTo(const Box2d &box) const {
+  if (HasOverlapWithBox2d(box)) {
+    return 0.0;
+  }
+  // the nearest points of two disjoint convex polygons include a corner of either of them
+  double distance = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < corners_.size(); ++i) {
+    distance = std::min({distance, box.DistanceToPoint(corners_[i]), DistanceToPoint(box.Corners()[i])});
+  }
+  return distance;
+}
+
 // ref: https://zhuanlan.zhihu.com/p/146778379
 // ref: apollo
 bool Box2d::HasOverlapWithBox2d(const common::Box2d &box) const {
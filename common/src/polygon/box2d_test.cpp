@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <polygon/box2d.hpp>
+#include <polygon/box_batch.hpp>
+#include <random>
 using namespace common;
 TEST(BoxTest, corner_test) {
   Eigen::Vector2d center{0, 0};
@@ -91,7 +93,13 @@ TEST(Box2dTest, DistanceTo) {
   EXPECT_NEAR(box1.DistanceToPoint({1, 0}), 0.0, 1e-5);
   EXPECT_NEAR(box1.DistanceToPoint({0, -1}), 0.0, 1e-5);
   EXPECT_NEAR(box1.DistanceToPoint({-1, 0}), 0.0, 1e-5);
-
+  EXPECT_NEAR(box1.DistanceTo(box2), 1.0, 1e-5);
+  EXPECT_NEAR(box2.DistanceTo(box1), 1.0, 1e-5);
+  EXPECT_NEAR(box1.DistanceTo(box3), 0.0, 1e-5);
+  // the corner of the rotated box is nearest to the edge of box1
+  const Box2d rotated_box({0, 5}, M_PI_4, 2, 2);
+  EXPECT_NEAR(box1.DistanceTo(rotated_box), 4.0 - std::sqrt(2.0), 1e-5);
+  EXPECT_NEAR(rotated_box.DistanceTo(box1), 4.0 - std::sqrt(2.0), 1e-5);
 }
 
 TEST(Box2dTest, IsPointIn) {
@@ -144,6 +152,61 @@ TEST(Box2dTest, RotateFromCenterAndShift) {
   EXPECT_NEAR(corners[3].y(), 38.0, 1e-5);
 }
 
+TEST(Box2dTest, InlineCornersFollowExtend) {
+  Box2d box({1, 2}, M_PI_4, 4, 2);
+  box.LongitudinalExtend(2.0);
+  box.LateralExtend(1.0);
+  Box2d copied_box = box;
+  const auto &corners = copied_box.Corners();
+  const std::vector<Eigen::Vector2d> expected_corners = Box2d({1, 2}, M_PI_4, 6, 3).GetAllCorners();
+  ASSERT_EQ(expected_corners.size(), corners.size());
+  for (size_t i = 0; i < corners.size(); ++i) {
+    EXPECT_NEAR(corners[i].x(), expected_corners[i].x(), 1e-9);
+    EXPECT_NEAR(corners[i].y(), expected_corners[i].y(), 1e-9);
+  }
+}
+
+TEST(BoxBatchTest, OverlapMatchesPairwiseTest) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> position(-15.0, 15.0);
+  std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+  std::uniform_real_distribution<double> extent(0.5, 6.0);
+  std::vector<Box2d> boxes;
+  for (size_t i = 0; i < 500; ++i) {
+    boxes.emplace_back(Eigen::Vector2d(position(generator), position(generator)), heading(generator),
+                       extent(generator), extent(generator));
+  }
+  // touching the first box along its side, where the rounding decides
+  boxes.emplace_back(Eigen::Vector2d(boxes[0].center_x() + boxes[0].cos_heading() * boxes[0].length(),
+                                     boxes[0].center_y() + boxes[0].sin_heading() * boxes[0].length()),
+                     boxes[0].heading(), boxes[0].length(), boxes[0].width());
+  const BoxBatch batch(boxes);
+  ASSERT_EQ(batch.Size(), boxes.size());
+  std::vector<uint8_t> mask(boxes.size());
+  size_t num_overlaps = 0;
+  for (size_t i = 0; i < 50; ++i) {
+    const Box2d ego(Eigen::Vector2d(position(generator), position(generator)), heading(generator), 4.8, 2.0);
+    OverlapMask(ego, batch, 0, batch.Size(), mask.data());
+    bool is_any_overlap = false;
+    for (size_t k = 0; k < boxes.size(); ++k) {
+      EXPECT_EQ(mask[k] != 0, ego.HasOverlapWithBox2d(boxes[k])) << "ego: " << i << ", box: " << k;
+      is_any_overlap = is_any_overlap || mask[k] != 0;
+      num_overlaps += mask[k];
+    }
+    EXPECT_EQ(OverlapAny(ego, batch), is_any_overlap);
+  }
+  EXPECT_GT(num_overlaps, 0);
+  for (size_t k = 0; k < boxes.size(); ++k) {
+    OverlapMask(boxes[0], batch, k, k + 1, mask.data());
+    EXPECT_EQ(mask[0] != 0, boxes[0].HasOverlapWithBox2d(boxes[k]));
+  }
+  // only the range is tested
+  const Box2d ego = boxes[7];
+  EXPECT_TRUE(OverlapAny(ego, batch, 7, 8));
+  EXPECT_FALSE(OverlapAny(ego, batch, 7, 7));
+  EXPECT_FALSE(OverlapAny(ego, BoxBatch()));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
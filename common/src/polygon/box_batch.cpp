@@ -0,0 +1,115 @@
+#include "polygon/box_batch.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace common {
+namespace {
+// the boxes OverlapAny tests before it looks for an overlap
+constexpr size_t kOverlapBlockSize = 64;
+}
+
+BoxBatch::BoxBatch(const std::vector<Box2d> &boxes) {
+  Reserve(boxes.size());
+  for (const auto &box : boxes) {
+    PushBack(box);
+  }
+}
+
+void BoxBatch::Reserve(size_t capacity) {
+  for (auto *values : {&center_xs_, &center_ys_, &cos_headings_, &sin_headings_, &half_lengths_, &half_widths_,
+                       &min_xs_, &max_xs_, &min_ys_, &max_ys_}) {
+    values->reserve(capacity);
+  }
+}
+
+void BoxBatch::PushBack(const Box2d &box) {
+  center_xs_.push_back(box.center_x());
+  center_ys_.push_back(box.center_y());
+  cos_headings_.push_back(box.cos_heading());
+  sin_headings_.push_back(box.sin_heading());
+  half_lengths_.push_back(box.half_length());
+  half_widths_.push_back(box.half_width());
+  min_xs_.push_back(box.min_x());
+  max_xs_.push_back(box.max_x());
+  min_ys_.push_back(box.min_y());
+  max_ys_.push_back(box.max_y());
+}
+
+void BoxBatch::Clear() {
+  for (auto *values : {&center_xs_, &center_ys_, &cos_headings_, &sin_headings_, &half_lengths_, &half_widths_,
+                       &min_xs_, &max_xs_, &min_ys_, &max_ys_}) {
+    values->clear();
+  }
+}
+
+void OverlapMask(const Box2d &ego, const BoxBatch &boxes, size_t first, size_t last, uint8_t *mask) {
+  // the terms of Box2d::HasOverlapWithBox2d which only depend on ego, in the same order of operations
+  const double ego_x = ego.center_x();
+  const double ego_y = ego.center_y();
+  const double ego_cos = ego.cos_heading();
+  const double ego_sin = ego.sin_heading();
+  const double ego_half_length = ego.half_length();
+  const double ego_half_width = ego.half_width();
+  const double ego_min_x = ego.min_x();
+  const double ego_max_x = ego.max_x();
+  const double ego_min_y = ego.min_y();
+  const double ego_max_y = ego.max_y();
+  const double dx1 = ego_cos * ego_half_length;
+  const double dy1 = ego_sin * ego_half_length;
+  const double dx2 = ego_sin * ego_half_width;
+  const double dy2 = -ego_cos * ego_half_width;
+  const double *center_xs = boxes.center_xs();
+  const double *center_ys = boxes.center_ys();
+  const double *cos_headings = boxes.cos_headings();
+  const double *sin_headings = boxes.sin_headings();
+  const double *half_lengths = boxes.half_lengths();
+  const double *half_widths = boxes.half_widths();
+  const double *min_xs = boxes.min_xs();
+  const double *max_xs = boxes.max_xs();
+  const double *min_ys = boxes.min_ys();
+  const double *max_ys = boxes.max_ys();
+  for (size_t k = first; k < last; ++k) {
+    // the conditions are combined with & instead of &&, so the loop has no branches
+    const bool is_bound_overlap = !(max_xs[k] < ego_min_x) & !(min_xs[k] > ego_max_x)
+        & !(max_ys[k] < ego_min_y) & !(min_ys[k] > ego_max_y);
+    const double shift_x = center_xs[k] - ego_x;
+    const double shift_y = center_ys[k] - ego_y;
+    const double dx3 = cos_headings[k] * half_lengths[k];
+    const double dy3 = sin_headings[k] * half_lengths[k];
+    const double dx4 = sin_headings[k] * half_widths[k];
+    const double dy4 = -cos_headings[k] * half_widths[k];
+    const bool is_ego_lon_overlap = std::abs(shift_x * ego_cos + shift_y * ego_sin)
+        <= std::abs(dx3 * ego_cos + dy3 * ego_sin) + std::abs(dx4 * ego_cos + dy4 * ego_sin) + ego_half_length;
+    const bool is_ego_lat_overlap = std::abs(shift_x * ego_sin - shift_y * ego_cos)
+        <= std::abs(dx3 * ego_sin - dy3 * ego_cos) + std::abs(dx4 * ego_sin - dy4 * ego_cos) + ego_half_width;
+    const bool is_lon_overlap = std::abs(shift_x * cos_headings[k] + shift_y * sin_headings[k])
+        <= std::abs(dx1 * cos_headings[k] + dy1 * sin_headings[k])
+            + std::abs(dx2 * cos_headings[k] + dy2 * sin_headings[k]) + half_lengths[k];
+    const bool is_lat_overlap = std::abs(shift_x * sin_headings[k] - shift_y * cos_headings[k])
+        <= std::abs(dx1 * sin_headings[k] - dy1 * cos_headings[k])
+            + std::abs(dx2 * sin_headings[k] - dy2 * cos_headings[k]) + half_widths[k];
+    mask[k - first] = static_cast<uint8_t>(is_bound_overlap & is_ego_lon_overlap & is_ego_lat_overlap
+                                               & is_lon_overlap & is_lat_overlap);
+  }
+}
+
+bool OverlapAny(const Box2d &ego, const BoxBatch &boxes, size_t first, size_t last) {
+  uint8_t mask[kOverlapBlockSize];
+  for (size_t begin = first; begin < last; begin += kOverlapBlockSize) {
+    const size_t end = std::min(begin + kOverlapBlockSize, last);
+    OverlapMask(ego, boxes, begin, end, mask);
+    uint8_t is_overlap = 0;
+    for (size_t k = 0; k < end - begin; ++k) {
+      is_overlap |= mask[k];
+    }
+    if (is_overlap != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OverlapAny(const Box2d &ego, const BoxBatch &boxes) {
+  return OverlapAny(ego, boxes, 0, boxes.Size());
+}
+}
@@ -0,0 +1,211 @@
+#include "polygon/polygon2d.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace common {
+constexpr size_t Polygon2d::kMaxNumVertices;
+
+namespace {
+double CrossProd(const Eigen::Vector2d &origin, const Eigen::Vector2d &a, const Eigen::Vector2d &b) {
+  return (a.x() - origin.x()) * (b.y() - origin.y()) - (a.y() - origin.y()) * (b.x() - origin.x());
+}
+}
+
+Polygon2d::Polygon2d(const Box2d &box) {
+  const auto &corners = box.Corners();
+  for (size_t i = 0; i < corners.size(); ++i) {
+    xs_[i] = corners[i].x();
+    ys_[i] = corners[i].y();
+  }
+  num_vertices_ = corners.size();
+  Init();
+}
+
+bool Polygon2d::FromConvexHull(const std::vector<Eigen::Vector2d> &points, Polygon2d *polygon) {
+  if (polygon == nullptr || points.size() < 3) {
+    return false;
+  }
+  // andrew's monotone chain, the collinear points are dropped
+  std::vector<Eigen::Vector2d> sorted_points(points);
+  std::sort(sorted_points.begin(), sorted_points.end(), [](const Eigen::Vector2d &p0, const Eigen::Vector2d &p1) {
+    return p0.x() < p1.x() || (p0.x() == p1.x() && p0.y() < p1.y());
+  });
+  std::vector<Eigen::Vector2d> hull(2 * sorted_points.size());
+  size_t num_hull = 0;
+  for (const auto &point : sorted_points) {
+    while (num_hull >= 2 && CrossProd(hull[num_hull - 2], hull[num_hull - 1], point) <= 0.0) {
+      --num_hull;
+    }
+    hull[num_hull++] = point;
+  }
+  const size_t lower_size = num_hull + 1;
+  for (size_t i = sorted_points.size() - 1; i > 0; --i) {
+    const auto &point = sorted_points[i - 1];
+    while (num_hull >= lower_size && CrossProd(hull[num_hull - 2], hull[num_hull - 1], point) <= 0.0) {
+      --num_hull;
+    }
+    hull[num_hull++] = point;
+  }
+  // the first point closes the hull
+  --num_hull;
+  if (num_hull < 3 || num_hull > kMaxNumVertices) {
+    return false;
+  }
+  for (size_t i = 0; i < num_hull; ++i) {
+    polygon->xs_[i] = hull[i].x();
+    polygon->ys_[i] = hull[i].y();
+  }
+  polygon->num_vertices_ = num_hull;
+  polygon->Init();
+  return true;
+}
+
+Polygon2d Polygon2d::ChamferedBox(const Box2d &box, double lon_chamfer, double lat_chamfer) {
+  const double half_length = box.half_length();
+  const double half_width = box.half_width();
+  lon_chamfer = std::min(lon_chamfer, half_length);
+  lat_chamfer = std::min(lat_chamfer, half_width);
+  if (lon_chamfer <= 0.0 || lat_chamfer <= 0.0) {
+    return Polygon2d(box);
+  }
+  // counter-clockwise in the box frame, starting at the front edge
+  const std::array<std::pair<double, double>, kMaxNumVertices> local_vertices{{
+      {half_length, -(half_width - lat_chamfer)}, {half_length, half_width - lat_chamfer},
+      {half_length - lon_chamfer, half_width}, {-(half_length - lon_chamfer), half_width},
+      {-half_length, half_width - lat_chamfer}, {-half_length, -(half_width - lat_chamfer)},
+      {-(half_length - lon_chamfer), -half_width}, {half_length - lon_chamfer, -half_width}}};
+  Polygon2d polygon;
+  for (size_t i = 0; i < local_vertices.size(); ++i) {
+    const double x = local_vertices[i].first;
+    const double y = local_vertices[i].second;
+    polygon.xs_[i] = box.center_x() + x * box.cos_heading() - y * box.sin_heading();
+    polygon.ys_[i] = box.center_y() + x * box.sin_heading() + y * box.cos_heading();
+  }
+  polygon.num_vertices_ = local_vertices.size();
+  polygon.Init();
+  return polygon;
+}
+
+std::vector<Eigen::Vector2d> Polygon2d::GetAllVertices() const {
+  std::vector<Eigen::Vector2d> vertices;
+  vertices.reserve(num_vertices_);
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    vertices.push_back(Vertex(i));
+  }
+  return vertices;
+}
+
+double Polygon2d::area() const {
+  double area = 0.0;
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    const size_t next = (i + 1) % num_vertices_;
+    area += xs_[i] * ys_[next] - xs_[next] * ys_[i];
+  }
+  return 0.5 * area;
+}
+
+bool Polygon2d::IsPointIn(const Eigen::Vector2d &point) const {
+  if (num_vertices_ < 3) {
+    return false;
+  }
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    const size_t next = (i + 1) % num_vertices_;
+    if (CrossProd(Vertex(i), Vertex(next), point) < 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Polygon2d::HasOverlapWithPolygon2d(const Polygon2d &polygon) const {
+  if (num_vertices_ == 0 || polygon.num_vertices_ == 0) {
+    return false;
+  }
+  if (polygon.max_x() < min_x() || polygon.min_x() > max_x() || polygon.max_y() < min_y()
+      || polygon.min_y() > max_y()) {
+    return false;
+  }
+  return !HasSeparatingAxis(polygon) && !polygon.HasSeparatingAxis(*this);
+}
+
+void Polygon2d::Init() {
+  for (size_t i = num_vertices_; i < kMaxNumVertices; ++i) {
+    xs_[i] = num_vertices_ == 0 ? 0.0 : xs_[num_vertices_ - 1];
+    ys_[i] = num_vertices_ == 0 ? 0.0 : ys_[num_vertices_ - 1];
+  }
+  max_x_ = std::numeric_limits<double>::lowest();
+  min_x_ = std::numeric_limits<double>::max();
+  max_y_ = std::numeric_limits<double>::lowest();
+  min_y_ = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    max_x_ = std::max(xs_[i], max_x_);
+    min_x_ = std::min(xs_[i], min_x_);
+    max_y_ = std::max(ys_[i], max_y_);
+    min_y_ = std::min(ys_[i], min_y_);
+  }
+}
+
+void Polygon2d::Project(double nx, double ny, double *min_proj, double *max_proj) const {
+  static_assert(kMaxNumVertices == 8, "the projection handles 8 slots");
+#if defined(__AVX__)
+  const __m256d pack_nx = _mm256_set1_pd(nx);
+  const __m256d pack_ny = _mm256_set1_pd(ny);
+  const __m256d proj0 = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(xs_.data()), pack_nx),
+                                      _mm256_mul_pd(_mm256_loadu_pd(ys_.data()), pack_ny));
+  const __m256d proj1 = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(xs_.data() + 4), pack_nx),
+                                      _mm256_mul_pd(_mm256_loadu_pd(ys_.data() + 4), pack_ny));
+  alignas(32) std::array<double, 4> mins{};
+  alignas(32) std::array<double, 4> maxs{};
+  _mm256_store_pd(mins.data(), _mm256_min_pd(proj0, proj1));
+  _mm256_store_pd(maxs.data(), _mm256_max_pd(proj0, proj1));
+  *min_proj = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+  *max_proj = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const float64x2_t pack_nx = vdupq_n_f64(nx);
+  const float64x2_t pack_ny = vdupq_n_f64(ny);
+  float64x2_t mins = vdupq_n_f64(std::numeric_limits<double>::max());
+  float64x2_t maxs = vdupq_n_f64(std::numeric_limits<double>::lowest());
+  for (size_t i = 0; i < kMaxNumVertices; i += 2) {
+    const float64x2_t proj = vaddq_f64(vmulq_f64(vld1q_f64(xs_.data() + i), pack_nx),
+                                       vmulq_f64(vld1q_f64(ys_.data() + i), pack_ny));
+    mins = vminq_f64(mins, proj);
+    maxs = vmaxq_f64(maxs, proj);
+  }
+  *min_proj = vminvq_f64(mins);
+  *max_proj = vmaxvq_f64(maxs);
+#else
+  *min_proj = std::numeric_limits<double>::max();
+  *max_proj = std::numeric_limits<double>::lowest();
+  for (size_t i = 0; i < kMaxNumVertices; ++i) {
+    const double proj = xs_[i] * nx + ys_[i] * ny;
+    *min_proj = std::min(*min_proj, proj);
+    *max_proj = std::max(*max_proj, proj);
+  }
+#endif
+}
+
+bool Polygon2d::HasSeparatingAxis(const Polygon2d &polygon) const {
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    const size_t next = (i + 1) % num_vertices_;
+    // the outward normal of the counter-clockwise edge
+    const double nx = ys_[next] - ys_[i];
+    const double ny = xs_[i] - xs_[next];
+    double min_proj = 0.0;
+    double max_proj = 0.0;
+    double other_min_proj = 0.0;
+    double other_max_proj = 0.0;
+    Project(nx, ny, &min_proj, &max_proj);
+    polygon.Project(nx, ny, &other_min_proj, &other_max_proj);
+    if (other_min_proj > max_proj || other_max_proj < min_proj) {
+      return true;
+    }
+  }
+  return false;
+}
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <polygon/polygon2d.hpp>
+using namespace common;
+
+TEST(Polygon2dTest, BoxPolygonKeepsCorners) {
+  const Box2d box({1.0, 2.0}, 0.3, 4.0, 2.0);
+  const Polygon2d polygon(box);
+  ASSERT_EQ(polygon.NumOfVertices(), 4);
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_DOUBLE_EQ(polygon.Vertex(i).x(), box.Corners()[i].x());
+    EXPECT_DOUBLE_EQ(polygon.Vertex(i).y(), box.Corners()[i].y());
+  }
+  EXPECT_NEAR(polygon.area(), box.area(), 1e-9);
+  EXPECT_TRUE(polygon.IsPointIn({1.0, 2.0}));
+  EXPECT_FALSE(polygon.IsPointIn({5.0, 2.0}));
+}
+
+TEST(Polygon2dTest, OverlapMatchesBox2d) {
+  const Box2d box({0.0, 0.0}, 0.4, 4.5, 2.0);
+  const Polygon2d polygon(box);
+  for (int ix = -14; ix <= 14; ++ix) {
+    for (int iy = -10; iy <= 10; ++iy) {
+      for (int ih = 0; ih < 8; ++ih) {
+        const Box2d other({0.4 * ix, 0.4 * iy}, 0.4 * ih, 3.0, 1.5);
+        EXPECT_EQ(polygon.HasOverlapWithBox2d(other), box.HasOverlapWithBox2d(other))
+                    << ix << ", " << iy << ", " << ih;
+      }
+    }
+  }
+}
+
+TEST(Polygon2dTest, ChamferedBoxBetweenRawAndInflatedBox) {
+  const double lon_buffer = 1.0;
+  const double lat_buffer = 0.5;
+  const Box2d raw_box({3.0, -1.0}, 0.7, 4.0, 2.0);
+  Box2d inflated_box = raw_box;
+  inflated_box.LongitudinalExtend(2.0 * lon_buffer);
+  inflated_box.LateralExtend(2.0 * lat_buffer);
+  const Polygon2d chamfered = Polygon2d::ChamferedBox(inflated_box, lon_buffer, lat_buffer);
+  ASSERT_EQ(chamfered.NumOfVertices(), 8);
+  EXPECT_GT(chamfered.area(), 0.0);
+  EXPECT_LT(chamfered.area(), inflated_box.area());
+  EXPECT_NEAR(chamfered.area(), inflated_box.area() - 2.0 * lon_buffer * lat_buffer, 1e-9);
+  for (const auto &vertex : chamfered.GetAllVertices()) {
+    EXPECT_TRUE(inflated_box.IsPointIn(vertex));
+  }
+  // the raw corners lie on the cut edges
+  for (const auto &corner : raw_box.Corners()) {
+    EXPECT_TRUE(chamfered.IsPointIn(corner + 1e-9 * (raw_box.Center() - corner)));
+  }
+  EXPECT_FALSE(chamfered.IsPointIn(inflated_box.Corners()[0]));
+  EXPECT_EQ(Polygon2d::ChamferedBox(inflated_box, 0.0, lat_buffer).NumOfVertices(), 4);
+}
+
+TEST(Polygon2dTest, ConvexHull) {
+  const std::vector<Eigen::Vector2d> points{{0.0, 0.0}, {2.0, 0.0}, {1.0, 0.5}, {2.0, 2.0},
+                                            {1.0, 2.0}, {0.0, 2.0}, {1.0, 1.0}};
+  Polygon2d polygon;
+  ASSERT_TRUE(Polygon2d::FromConvexHull(points, &polygon));
+  EXPECT_EQ(polygon.NumOfVertices(), 4);
+  EXPECT_NEAR(polygon.area(), 4.0, 1e-9);
+  EXPECT_TRUE(polygon.HasOverlapWithPolygon2d(Polygon2d(Box2d({2.5, 1.0}, 0.0, 1.2, 1.0))));
+  EXPECT_FALSE(polygon.HasOverlapWithPolygon2d(Polygon2d(Box2d({2.7, 1.0}, 0.0, 1.2, 1.0))));
+
+  EXPECT_FALSE(Polygon2d::FromConvexHull({{0.0, 0.0}, {1.0, 1.0}, {2.0, 2.0}}, &polygon));
+  std::vector<Eigen::Vector2d> circle;
+  for (int i = 0; i < 12; ++i) {
+    circle.emplace_back(std::cos(i * M_PI / 6.0), std::sin(i * M_PI / 6.0));
+  }
+  EXPECT_FALSE(Polygon2d::FromConvexHull(circle, &polygon));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include "profiler/stage_profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace common {
+
+constexpr uint64_t LatencyHistogram::kSubBuckets;
+constexpr size_t LatencyHistogram::kNumBuckets;
+
+void LatencyHistogram::Record(double seconds) {
+  const uint64_t micros = static_cast<uint64_t>(std::max(0.0, std::round(seconds * 1e6)));
+  ++counts_[BucketIndex(micros)];
+  ++count_;
+  max_ = std::max(max_, micros);
+  sum_ += seconds;
+}
+
+double LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_)));
+  uint64_t num_below = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    num_below += counts_[i];
+    if (num_below >= rank) {
+      return static_cast<double>(std::min(BucketUpperBound(i), max_)) * 1e-6;
+    }
+  }
+  return Max();
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+void LatencyHistogram::Reset() {
+  counts_.fill(0);
+  count_ = 0;
+  max_ = 0;
+  sum_ = 0.0;
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t micros) {
+  if (micros < kSubBuckets) {
+    return static_cast<size_t>(micros);
+  }
+  const int msb = 63 - __builtin_clzll(micros);
+  const int shift = msb - kSubBucketBits;
+  if (shift > kMaxValueBits - kSubBucketBits - 1) {
+    return kNumBuckets - 1;
+  }
+  // micros >> shift is in [kSubBuckets, 2 * kSubBuckets)
+  return static_cast<size_t>(shift + 1) * kSubBuckets + static_cast<size_t>((micros >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const int shift = static_cast<int>(index / kSubBuckets) - 1;
+  const uint64_t sub_bucket = index % kSubBuckets;
+  return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+}
+
+void StageProfiler::Record(const char *stage, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = std::find_if(stages_.begin(), stages_.end(),
+                           [stage](const std::pair<std::string, LatencyHistogram> &entry) {
+                             return entry.first == stage;
+                           });
+  if (iter == stages_.end()) {
+    stages_.emplace_back(stage, LatencyHistogram());
+    iter = stages_.end() - 1;
+  }
+  iter->second.Record(seconds);
+}
+
+std::vector<StageStatistics> StageProfiler::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<StageStatistics> statistics;
+  statistics.reserve(stages_.size());
+  for (const auto &stage : stages_) {
+    StageStatistics stage_statistics;
+    stage_statistics.name = stage.first;
+    stage_statistics.count = stage.second.Count();
+    stage_statistics.p50 = stage.second.Percentile(50.0);
+    stage_statistics.p99 = stage.second.Percentile(99.0);
+    stage_statistics.max = stage.second.Max();
+    stage_statistics.mean = stage.second.Mean();
+    statistics.push_back(std::move(stage_statistics));
+  }
+  return statistics;
+}
+
+void StageProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &stage : stages_) {
+    stage.second.Reset();
+  }
+}
+}
@@ -0,0 +1,79 @@
+#include "profiler/stage_profiler.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace common {
+namespace {
+double ExactPercentile(std::vector<double> values, double percentile) {
+  std::sort(values.begin(), values.end());
+  const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(percentile / 100.0 * values.size())));
+  return values[rank - 1];
+}
+}
+
+TEST(LatencyHistogramTest, percentiles_within_bucket_resolution) {
+  std::mt19937 engine(7);
+  std::lognormal_distribution<double> distribution(std::log(0.01), 1.0);
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Percentile(50.0), 0.0);
+  std::vector<double> values;
+  for (int i = 0; i < 5000; ++i) {
+    values.push_back(distribution(engine));
+    histogram.Record(values.back());
+  }
+  EXPECT_EQ(histogram.Count(), values.size());
+  EXPECT_NEAR(histogram.Max(), *std::max_element(values.begin(), values.end()), 1e-6);
+  for (double percentile : {1.0, 50.0, 90.0, 99.0, 100.0}) {
+    const double exact = ExactPercentile(values, percentile);
+    // the upper bound of the bucket is at most 1 / 16 above the value
+    EXPECT_GE(histogram.Percentile(percentile), exact - 1e-6) << percentile;
+    EXPECT_LE(histogram.Percentile(percentile), exact * (1.0 + 1.0 / 16.0) + 1e-6) << percentile;
+  }
+  LatencyHistogram other;
+  other.Record(100.0);
+  histogram.Merge(other);
+  EXPECT_EQ(histogram.Count(), values.size() + 1);
+  EXPECT_DOUBLE_EQ(histogram.Max(), 100.0);
+  histogram.Reset();
+  EXPECT_EQ(histogram.Count(), 0);
+  EXPECT_EQ(histogram.Max(), 0.0);
+}
+
+TEST(StageProfilerTest, scoped_timers_from_several_threads) {
+  StageProfiler profiler;
+  {
+    ScopedStageTimer timer(nullptr, "ignored");
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&profiler]() {
+      for (int k = 0; k < 50; ++k) {
+        ScopedStageTimer outer(&profiler, "outer");
+        ScopedStageTimer inner(&profiler, "inner");
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto statistics = profiler.GetStatistics();
+  ASSERT_EQ(statistics.size(), 2);
+  for (const auto &stage : statistics) {
+    EXPECT_EQ(stage.count, 200);
+    EXPECT_LE(stage.p50, stage.p99);
+    EXPECT_LE(stage.p99, stage.max);
+  }
+  profiler.Reset();
+  statistics = profiler.GetStatistics();
+  ASSERT_EQ(statistics.size(), 2);
+  EXPECT_EQ(statistics[0].count, 0);
+}
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
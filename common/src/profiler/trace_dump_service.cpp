@@ -0,0 +1,35 @@
+#include "profiler/trace_dump_service.hpp"
+#include <fstream>
+#include "name/string_name.hpp"
+#include "profiler/trace_recorder.hpp"
+
+namespace common {
+TraceDumpService::TraceDumpService(ros::NodeHandle nh) {
+  nh.setCallbackQueue(&callback_queue_);
+  service_ = nh.advertiseService(service::kDumpTraceServiceName, &TraceDumpService::DumpTrace, this);
+  spinner_ = std::make_unique<ros::AsyncSpinner>(1, &callback_queue_);
+  spinner_->start();
+}
+
+TraceDumpService::~TraceDumpService() {
+  spinner_->stop();
+  service_.shutdown();
+}
+
+bool TraceDumpService::DumpTrace(DumpTrace::Request &request, DumpTrace::Response &response) {
+#ifndef PLANNING_TRACING
+  ROS_WARN("[TraceDumpService::DumpTrace], the zones are compiled out, build with PLANNING_TRACING to record them");
+#endif
+  std::ofstream out(request.path);
+  if (!out) {
+    response.success = false;
+    response.message = "failed to open " + request.path;
+    return true;
+  }
+  response.num_events = TraceRecorder::Instance().WriteChromeTrace(&out);
+  out.close();
+  response.success = static_cast<bool>(out);
+  response.message = response.success ? "" : "failed to write " + request.path;
+  return true;
+}
+}
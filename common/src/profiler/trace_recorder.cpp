@@ -0,0 +1,165 @@
+#include "profiler/trace_recorder.hpp"
+#include <pthread.h>
+#include <algorithm>
+
+namespace common {
+namespace {
+// the pid of every event, the trace is of one process
+constexpr int kTracePid = 1;
+
+/**
+ * @brief: a copy of an event, read out of a ring
+ */
+struct EventCopy {
+  const char *name = nullptr;
+  uint64_t begin_ns = 0;
+  uint64_t value = 0;
+  TraceEventType type = TraceEventType::ZONE;
+};
+
+void WriteJsonString(const char *value, std::ostream *out) {
+  *out << '"';
+  for (const char *c = value; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      *out << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) >= 0x20) {
+      *out << *c;
+    }
+  }
+  *out << '"';
+}
+
+void WriteMicros(uint64_t nanos, std::ostream *out) {
+  *out << nanos / 1000 << '.' << static_cast<char>('0' + nanos / 100 % 10) << static_cast<char>('0' + nanos / 10 % 10)
+       << static_cast<char>('0' + nanos % 10);
+}
+}
+
+constexpr uint64_t TraceRecorder::kEventsPerThread;
+
+TraceRecorder::TraceRecorder() : epoch_(std::chrono::steady_clock::now()) {}
+
+TraceRecorder &TraceRecorder::Instance() {
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+uint64_t TraceRecorder::NowNanos() {
+  return ToNanos(std::chrono::steady_clock::now());
+}
+
+uint64_t TraceRecorder::ToNanos(std::chrono::steady_clock::time_point time) {
+  const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(time - Instance().epoch_).count();
+  return static_cast<uint64_t>(std::max<decltype(nanos)>(nanos, 0));
+}
+
+void TraceRecorder::RecordZone(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+  Record(TraceEventType::ZONE, name, begin_ns, end_ns);
+}
+
+void TraceRecorder::RecordFlow(TraceEventType type, const char *name, uint64_t flow_id) {
+  Record(type, name, NowNanos(), flow_id);
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::CurrentBuffer() {
+  static thread_local ThreadBuffer *current = nullptr;
+  if (current != nullptr) {
+    return current;
+  }
+  auto buffer = std::make_shared<ThreadBuffer>();
+  buffer->events.reset(new Event[kEventsPerThread]);
+  // the name given by ConfigureCurrentThread, if any
+  char thread_name[16] = {0};
+  if (pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name)) == 0) {
+    buffer->thread_name = thread_name;
+  }
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  buffer->tid = static_cast<int>(buffers_.size()) + 1;
+  buffers_.push_back(buffer);
+  current = buffer.get();
+  return current;
+}
+
+void TraceRecorder::Record(TraceEventType type, const char *name, uint64_t begin_ns, uint64_t value) {
+  ThreadBuffer *buffer = CurrentBuffer();
+  const uint64_t index = buffer->num_events.load(std::memory_order_relaxed);
+  // a dump reading this slot and seeing any of the new fields also sees the count, so it drops the slot
+  std::atomic_thread_fence(std::memory_order_release);
+  Event &event = buffer->events[index % kEventsPerThread];
+  event.name.store(name, std::memory_order_relaxed);
+  event.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  event.value.store(value, std::memory_order_relaxed);
+  event.type.store(static_cast<uint8_t>(type), std::memory_order_relaxed);
+  buffer->num_events.store(index + 1, std::memory_order_release);
+}
+
+size_t TraceRecorder::WriteChromeTrace(std::ostream *out) const {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffers = buffers_;
+  }
+  size_t num_written = 0;
+  bool is_first = true;
+  const auto begin_event = [out, &is_first]() {
+    *out << (is_first ? "\n" : ",\n");
+    is_first = false;
+  };
+  *out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  std::vector<EventCopy> events;
+  for (const auto &buffer : buffers) {
+    const uint64_t end = buffer->num_events.load(std::memory_order_acquire);
+    const uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+    events.resize(end - begin);
+    for (uint64_t i = begin; i < end; ++i) {
+      const Event &event = buffer->events[i % kEventsPerThread];
+      auto &copy = events[i - begin];
+      copy.name = event.name.load(std::memory_order_relaxed);
+      copy.begin_ns = event.begin_ns.load(std::memory_order_relaxed);
+      copy.value = event.value.load(std::memory_order_relaxed);
+      copy.type = static_cast<TraceEventType>(event.type.load(std::memory_order_relaxed));
+    }
+    // the slots of the events recorded meanwhile, and the one being recorded, may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t current_end = buffer->num_events.load(std::memory_order_relaxed);
+    const uint64_t first_valid = std::max(begin, current_end + 1 > kEventsPerThread
+                                                 ? current_end + 1 - kEventsPerThread : 0);
+
+    begin_event();
+    *out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kTracePid << ",\"tid\":" << buffer->tid
+         << ",\"args\":{\"name\":";
+    WriteJsonString(buffer->thread_name.empty() ? ("thread-" + std::to_string(buffer->tid)).c_str()
+                                                : buffer->thread_name.c_str(), out);
+    *out << "}}";
+    for (uint64_t i = std::min(first_valid, end); i < end; ++i) {
+      const auto &event = events[i - begin];
+      if (event.name == nullptr) {
+        continue;
+      }
+      begin_event();
+      *out << "{\"name\":";
+      WriteJsonString(event.name, out);
+      *out << ",\"pid\":" << kTracePid << ",\"tid\":" << buffer->tid << ",\"ts\":";
+      WriteMicros(event.begin_ns, out);
+      switch (event.type) {
+        case TraceEventType::ZONE:
+          *out << ",\"ph\":\"X\",\"dur\":";
+          WriteMicros(event.value >= event.begin_ns ? event.value - event.begin_ns : 0, out);
+          break;
+        case TraceEventType::FLOW_BEGIN:
+          *out << ",\"ph\":\"s\",\"cat\":\"flow\",\"id\":" << event.value;
+          break;
+        case TraceEventType::FLOW_END:
+          // bound to the enclosing zone, which is the task the flow leads to
+          *out << ",\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"flow\",\"id\":" << event.value;
+          break;
+      }
+      *out << "}";
+      ++num_written;
+    }
+  }
+  *out << "\n]}\n";
+  return num_written;
+}
+
+}
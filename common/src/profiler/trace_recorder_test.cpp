@@ -0,0 +1,85 @@
+#include "profiler/trace_recorder.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace common {
+namespace {
+size_t CountOf(const std::string &text, const std::string &pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+}
+
+// the recorder is a process wide singleton, the tests look for their own zone names
+TEST(TraceRecorderTest, zones_and_flows_across_threads) {
+  auto &recorder = TraceRecorder::Instance();
+  const uint64_t flow_id = recorder.NewFlowId();
+  recorder.RecordFlow(TraceEventType::FLOW_BEGIN, "test_flow", flow_id);
+  std::thread worker([&recorder, flow_id]() {
+    TraceZone zone("test_worker_zone");
+    recorder.RecordFlow(TraceEventType::FLOW_END, "test_flow", flow_id);
+  });
+  worker.join();
+  {
+    TraceZone zone("test_caller_zone");
+  }
+  std::ostringstream out;
+  const size_t num_events = recorder.WriteChromeTrace(&out);
+  const std::string trace = out.str();
+  EXPECT_GE(num_events, 4u);
+  EXPECT_EQ(trace.find("{\"displayTimeUnit\""), 0u);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"test_worker_zone\""), 1u);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"test_caller_zone\""), 1u);
+  const std::string flow_id_field = "\"id\":" + std::to_string(flow_id) + "}";
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"s\",\"cat\":\"flow\"," + flow_id_field), 1u);
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"flow\"," + flow_id_field), 1u);
+}
+
+TEST(TraceRecorderTest, ring_keeps_the_last_events) {
+  auto &recorder = TraceRecorder::Instance();
+  std::thread worker([&recorder]() {
+    recorder.RecordZone("test_first_zone", 0, 1);
+    for (uint64_t i = 0; i < TraceRecorder::kEventsPerThread; ++i) {
+      recorder.RecordZone("test_ring_zone", i, i + 1500);
+    }
+  });
+  worker.join();
+  std::ostringstream out;
+  recorder.WriteChromeTrace(&out);
+  const std::string trace = out.str();
+  EXPECT_EQ(CountOf(trace, "\"name\":\"test_first_zone\""), 0u);
+  // the oldest slot of a full ring is the one the next event overwrites, so the dump drops it
+  EXPECT_EQ(CountOf(trace, "\"name\":\"test_ring_zone\""), TraceRecorder::kEventsPerThread - 1);
+  EXPECT_NE(trace.find("\"dur\":1.500"), std::string::npos);
+}
+
+TEST(TraceRecorderTest, dump_while_recording) {
+  auto &recorder = TraceRecorder::Instance();
+  std::atomic<bool> is_running{true};
+  std::vector<std::thread> workers;
+  for (int k = 0; k < 4; ++k) {
+    workers.emplace_back([&recorder, &is_running]() {
+      while (is_running.load()) {
+        TraceZone zone("test_busy_zone");
+      }
+    });
+  }
+  for (int i = 0; i < 5; ++i) {
+    std::ostringstream out;
+    recorder.WriteChromeTrace(&out);
+    EXPECT_EQ(out.str().substr(out.str().size() - 4), "\n]}\n");
+  }
+  is_running.store(false);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <numeric>
+#include <thread_pool/thread_pool.hpp>
+using namespace common;
+
+TEST(ThreadPoolTest, PushTask) {
+  ThreadPool thread_pool(4);
+  std::vector<std::future<size_t>> futures;
+  for (size_t i = 0; i < 200; ++i) {
+    futures.push_back(thread_pool.PushTask([](size_t value) { return value * value; }, i));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    EXPECT_EQ(futures[i].get(), i * i);
+  }
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+  ThreadPool thread_pool(4);
+  for (size_t grain : {1, 3, 64, 1000}) {
+    std::vector<std::atomic<int>> visits(997);
+    for (auto &visit : visits) {
+      visit.store(0);
+    }
+    thread_pool.ParallelFor(0, visits.size(), grain, [&visits](size_t i) { visits[i].fetch_add(1); });
+    for (size_t i = 0; i < visits.size(); ++i) {
+      EXPECT_EQ(visits[i].load(), 1) << "grain: " << grain << ", index: " << i;
+    }
+  }
+  size_t num_calls = 0;
+  thread_pool.ParallelFor(5, 5, 1, [&num_calls](size_t) { ++num_calls; });
+  EXPECT_EQ(num_calls, 0);
+}
+
+TEST(ThreadPoolTest, NestedParallelFor) {
+  // the outer calls occupy every worker, the inner ones only finish if the waiting threads help
+  ThreadPool thread_pool(2);
+  std::vector<size_t> sums(16, 0);
+  thread_pool.ParallelFor(0, sums.size(), 1, [&](size_t i) {
+    std::vector<size_t> values(100, 0);
+    thread_pool.ParallelFor(0, values.size(), 7, [&values, i](size_t k) { values[k] = i + k; });
+    sums[i] = std::accumulate(values.begin(), values.end(), size_t{0});
+  });
+  for (size_t i = 0; i < sums.size(); ++i) {
+    EXPECT_EQ(sums[i], 100 * i + 4950);
+  }
+}
+
+TEST(ThreadPoolTest, PushTaskFromWorker) {
+  ThreadPool thread_pool(3);
+  std::atomic<int> count(0);
+  thread_pool.ParallelFor(0, 3000, 1, [&](size_t) {
+    // beyond the deque capacity, the tasks spill into the shared queue
+    thread_pool.PushTask([&count]() { count.fetch_add(1); });
+  });
+  thread_pool.ParallelFor(0, 1, 1, [](size_t) {});
+  while (count.load() < 3000) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(count.load(), 3000);
+}
+
+TEST(ThreadPoolTest, ThreadOptionsAndStatistics) {
+  ThreadOptions thread_options;
+  thread_options.name = "test_pool";
+  thread_options.cpus = {0};
+  ThreadPool thread_pool(2, thread_options, true);
+  EXPECT_TRUE(thread_pool.ThreadOptionsApplied());
+  EXPECT_EQ(thread_pool.Name(), "test_pool");
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 50; ++i) {
+    futures.push_back(thread_pool.PushTask([]() { std::this_thread::sleep_for(std::chrono::microseconds(100)); }));
+  }
+  for (auto &future : futures) {
+    future.get();
+  }
+  auto statistics = thread_pool.GetStatistics();
+  EXPECT_EQ(statistics.num_tasks, 50);
+  EXPECT_EQ(statistics.queue_depth, 0);
+  EXPECT_GE(statistics.max_queue_depth, 1);
+  EXPECT_GT(statistics.max_latency, 0.0);
+  EXPECT_LE(statistics.mean_latency, statistics.max_latency);
+  thread_pool.ResetStatistics();
+  statistics = thread_pool.GetStatistics();
+  EXPECT_EQ(statistics.num_tasks, 0);
+  EXPECT_EQ(statistics.max_latency, 0.0);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
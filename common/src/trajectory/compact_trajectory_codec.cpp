@@ -0,0 +1,164 @@
+#include "trajectory/compact_trajectory_codec.hpp"
+#include <cmath>
+#include <boost/make_shared.hpp>
+#include <ros/assert.h>
+
+namespace common {
+
+namespace {
+// the stitched points are copies of the reference points up to the shift of s and the relative time
+constexpr double kMatchTolerance = 1e-6;
+// the points off the even spacing by more than this are sent with their relative times
+constexpr double kTimeTolerance = 1e-4;
+
+bool IsSamePoint(const planning_msgs::TrajectoryPoint &reference_point, const planning_msgs::TrajectoryPoint &point,
+                 double time_offset, double s_offset) {
+  const auto &ref_path_point = reference_point.path_point;
+  const auto &path_point = point.path_point;
+  return std::fabs(ref_path_point.x - path_point.x) < kMatchTolerance
+      && std::fabs(ref_path_point.y - path_point.y) < kMatchTolerance
+      && std::fabs(ref_path_point.theta - path_point.theta) < kMatchTolerance
+      && std::fabs(ref_path_point.kappa - path_point.kappa) < kMatchTolerance
+      && std::fabs(ref_path_point.dkappa - path_point.dkappa) < kMatchTolerance
+      && std::fabs(ref_path_point.s + s_offset - path_point.s) < kMatchTolerance
+      && std::fabs(reference_point.vel - point.vel) < kMatchTolerance
+      && std::fabs(reference_point.acc - point.acc) < kMatchTolerance
+      && std::fabs(reference_point.jerk - point.jerk) < kMatchTolerance
+      && std::fabs(reference_point.steer_angle - point.steer_angle) < kMatchTolerance
+      && std::fabs(reference_point.relative_time + time_offset - point.relative_time) < kMatchTolerance;
+}
+}
+
+void CompactTrajectoryEncoder::Encode(const planning_msgs::Trajectory::ConstPtr &trajectory,
+                                      CompactTrajectory *compact) {
+  ROS_ASSERT(trajectory != nullptr && compact != nullptr);
+  ++sequence_id_;
+  size_t prefix_size = 0;
+  size_t start_index = 0;
+  double s_offset = 0.0;
+  if (last_trajectory_ != nullptr && keyframe_interval_ > 1 && (sequence_id_ - 1) % keyframe_interval_ != 0) {
+    prefix_size = MatchPrefix(*last_trajectory_, *trajectory, &start_index, &s_offset);
+  }
+  compact->header = trajectory->header;
+  compact->sequence_id = sequence_id_;
+  compact->status = static_cast<uint8_t>(trajectory->status);
+  compact->prefix_sequence_id = prefix_size > 0 ? sequence_id_ - 1 : 0;
+  compact->prefix_start_index = static_cast<uint32_t>(start_index);
+  compact->prefix_size = static_cast<uint32_t>(prefix_size);
+  compact->prefix_s_offset = s_offset;
+
+  const auto &points = trajectory->trajectory_points;
+  const size_t num_points = points.size() - prefix_size;
+  compact->start_time = num_points > 0 ? points[prefix_size].relative_time : 0.0;
+  compact->dt = num_points > 1 ? points[prefix_size + 1].relative_time - compact->start_time : 0.0;
+  compact->origin_x = num_points > 0 ? points[prefix_size].path_point.x : 0.0;
+  compact->origin_y = num_points > 0 ? points[prefix_size].path_point.y : 0.0;
+  bool is_evenly_spaced = true;
+  for (auto *values : {&compact->x, &compact->y, &compact->theta, &compact->kappa, &compact->dkappa, &compact->s,
+                       &compact->vel, &compact->acc, &compact->jerk, &compact->steer_angle}) {
+    values->resize(num_points);
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    const auto &tp = points[prefix_size + i];
+    compact->x[i] = static_cast<float>(tp.path_point.x - compact->origin_x);
+    compact->y[i] = static_cast<float>(tp.path_point.y - compact->origin_y);
+    compact->theta[i] = static_cast<float>(tp.path_point.theta);
+    compact->kappa[i] = static_cast<float>(tp.path_point.kappa);
+    compact->dkappa[i] = static_cast<float>(tp.path_point.dkappa);
+    compact->s[i] = static_cast<float>(tp.path_point.s);
+    compact->vel[i] = static_cast<float>(tp.vel);
+    compact->acc[i] = static_cast<float>(tp.acc);
+    compact->jerk[i] = static_cast<float>(tp.jerk);
+    compact->steer_angle[i] = static_cast<float>(tp.steer_angle);
+    is_evenly_spaced = is_evenly_spaced && std::fabs(compact->start_time + static_cast<double>(i) * compact->dt
+                                                         - tp.relative_time) < kTimeTolerance;
+  }
+  compact->relative_times.clear();
+  if (!is_evenly_spaced) {
+    compact->relative_times.reserve(num_points);
+    for (size_t i = 0; i < num_points; ++i) {
+      compact->relative_times.push_back(static_cast<float>(points[prefix_size + i].relative_time));
+    }
+  }
+  last_trajectory_ = trajectory;
+}
+
+size_t CompactTrajectoryEncoder::MatchPrefix(const planning_msgs::Trajectory &reference,
+                                             const planning_msgs::Trajectory &trajectory,
+                                             size_t *start_index, double *s_offset) {
+  const auto &ref_points = reference.trajectory_points;
+  const auto &points = trajectory.trajectory_points;
+  if (ref_points.empty() || points.empty()) {
+    return 0;
+  }
+  const double time_offset = (reference.header.stamp - trajectory.header.stamp).toSec();
+  for (size_t i = 0; i < ref_points.size(); ++i) {
+    const double offset = points.front().path_point.s - ref_points[i].path_point.s;
+    if (!IsSamePoint(ref_points[i], points.front(), time_offset, offset)) {
+      continue;
+    }
+    size_t size = 1;
+    while (i + size < ref_points.size() && size < points.size()
+        && IsSamePoint(ref_points[i + size], points[size], time_offset, offset)) {
+      ++size;
+    }
+    *start_index = i;
+    *s_offset = offset;
+    return size;
+  }
+  return 0;
+}
+
+planning_msgs::Trajectory::ConstPtr CompactTrajectoryDecoder::Decode(const CompactTrajectory &compact) {
+  const size_t num_points = compact.x.size();
+  for (const auto *values : {&compact.y, &compact.theta, &compact.kappa, &compact.dkappa, &compact.s, &compact.vel,
+                             &compact.acc, &compact.jerk, &compact.steer_angle}) {
+    if (values->size() != num_points) {
+      return nullptr;
+    }
+  }
+  if (!compact.relative_times.empty() && compact.relative_times.size() != num_points) {
+    return nullptr;
+  }
+  const size_t prefix_size = compact.prefix_size;
+  const size_t start_index = compact.prefix_start_index;
+  if (prefix_size > 0 && (last_trajectory_ == nullptr || compact.prefix_sequence_id != last_sequence_id_
+      || start_index + prefix_size > last_trajectory_->trajectory_points.size())) {
+    return nullptr;
+  }
+  auto trajectory = boost::make_shared<planning_msgs::Trajectory>();
+  trajectory->header = compact.header;
+  trajectory->status = compact.status;
+  auto &points = trajectory->trajectory_points;
+  points.reserve(prefix_size + num_points);
+  if (prefix_size > 0) {
+    const double time_offset = (last_trajectory_->header.stamp - compact.header.stamp).toSec();
+    points.insert(points.end(), last_trajectory_->trajectory_points.begin() + start_index,
+                  last_trajectory_->trajectory_points.begin() + start_index + prefix_size);
+    for (auto &tp : points) {
+      tp.path_point.s += compact.prefix_s_offset;
+      tp.relative_time += time_offset;
+    }
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    planning_msgs::TrajectoryPoint tp;
+    tp.path_point.x = compact.origin_x + compact.x[i];
+    tp.path_point.y = compact.origin_y + compact.y[i];
+    tp.path_point.theta = compact.theta[i];
+    tp.path_point.kappa = compact.kappa[i];
+    tp.path_point.dkappa = compact.dkappa[i];
+    tp.path_point.s = compact.s[i];
+    tp.vel = compact.vel[i];
+    tp.acc = compact.acc[i];
+    tp.jerk = compact.jerk[i];
+    tp.steer_angle = compact.steer_angle[i];
+    tp.relative_time = compact.relative_times.empty() ? compact.start_time + static_cast<double>(i) * compact.dt
+                                                      : compact.relative_times[i];
+    points.push_back(tp);
+  }
+  last_sequence_id_ = compact.sequence_id;
+  last_trajectory_ = trajectory;
+  return trajectory;
+}
+
+}
@@ -0,0 +1,161 @@
+#include "trajectory/compact_trajectory_codec.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <boost/make_shared.hpp>
+
+namespace common {
+namespace {
+constexpr double kDt = 0.1;
+// the float32 of the points, the map coordinates are kept precise by the origin
+constexpr double kFloatTolerance = 1e-4;
+
+/**
+ * @brief: a trajectory along an arc far from the map origin, its points evenly spaced by kDt
+ */
+planning_msgs::Trajectory MakeTrajectory(double stamp, double start_time, size_t num_points, double v) {
+  planning_msgs::Trajectory trajectory;
+  trajectory.header.stamp = ros::Time(stamp);
+  trajectory.status = planning_msgs::Trajectory::NORMAL;
+  const double radius = 80.0;
+  for (size_t i = 0; i < num_points; ++i) {
+    planning_msgs::TrajectoryPoint tp;
+    tp.relative_time = start_time + static_cast<double>(i) * kDt;
+    tp.path_point.s = v * tp.relative_time;
+    tp.path_point.x = 3000.0 + radius * std::sin(tp.path_point.s / radius);
+    tp.path_point.y = -2000.0 + radius * (1.0 - std::cos(tp.path_point.s / radius));
+    tp.path_point.theta = tp.path_point.s / radius;
+    tp.path_point.kappa = 1.0 / radius;
+    tp.vel = v;
+    tp.acc = 0.5;
+    tp.steer_angle = 0.05;
+    trajectory.trajectory_points.push_back(tp);
+  }
+  return trajectory;
+}
+
+/**
+ * @brief: the points [start_index, end_index) of history as the planner stitches them at stamp, followed by the
+ * points of planned
+ */
+planning_msgs::Trajectory Stitch(const planning_msgs::Trajectory &history, size_t start_index, size_t end_index,
+                                 double stamp, const planning_msgs::Trajectory &planned) {
+  planning_msgs::Trajectory trajectory;
+  trajectory.header.stamp = ros::Time(stamp);
+  trajectory.status = planning_msgs::Trajectory::NORMAL;
+  const double zero_s = history.trajectory_points[end_index].path_point.s;
+  for (size_t i = start_index; i < end_index; ++i) {
+    auto tp = history.trajectory_points[i];
+    tp.relative_time = tp.relative_time + (history.header.stamp - trajectory.header.stamp).toSec();
+    tp.path_point.s = tp.path_point.s - zero_s;
+    trajectory.trajectory_points.push_back(tp);
+  }
+  trajectory.trajectory_points.insert(trajectory.trajectory_points.end(), planned.trajectory_points.begin(),
+                                      planned.trajectory_points.end());
+  return trajectory;
+}
+
+void ExpectNear(const planning_msgs::Trajectory &expected, const planning_msgs::Trajectory &actual) {
+  EXPECT_EQ(expected.header.stamp.toSec(), actual.header.stamp.toSec());
+  EXPECT_EQ(expected.status, actual.status);
+  ASSERT_EQ(expected.trajectory_points.size(), actual.trajectory_points.size());
+  for (size_t i = 0; i < expected.trajectory_points.size(); ++i) {
+    const auto &expected_tp = expected.trajectory_points[i];
+    const auto &actual_tp = actual.trajectory_points[i];
+    EXPECT_NEAR(expected_tp.path_point.x, actual_tp.path_point.x, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.path_point.y, actual_tp.path_point.y, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.path_point.theta, actual_tp.path_point.theta, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.path_point.kappa, actual_tp.path_point.kappa, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.path_point.s, actual_tp.path_point.s, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.vel, actual_tp.vel, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.acc, actual_tp.acc, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.steer_angle, actual_tp.steer_angle, kFloatTolerance);
+    EXPECT_NEAR(expected_tp.relative_time, actual_tp.relative_time, kFloatTolerance);
+  }
+}
+}
+
+TEST(CompactTrajectoryCodecTest, keyframe_round_trip) {
+  const auto trajectory = boost::make_shared<const planning_msgs::Trajectory>(MakeTrajectory(10.0, 0.0, 80, 12.0));
+  CompactTrajectoryEncoder encoder;
+  CompactTrajectory compact;
+  encoder.Encode(trajectory, &compact);
+  EXPECT_EQ(compact.sequence_id, 1u);
+  EXPECT_EQ(compact.prefix_size, 0u);
+  EXPECT_EQ(compact.x.size(), 80u);
+  EXPECT_NEAR(compact.dt, kDt, 1e-12);
+  EXPECT_TRUE(compact.relative_times.empty());
+
+  CompactTrajectoryDecoder decoder;
+  const auto decoded = decoder.Decode(compact);
+  ASSERT_TRUE(decoded != nullptr);
+  ExpectNear(*trajectory, *decoded);
+}
+
+TEST(CompactTrajectoryCodecTest, stitched_prefix_is_referenced) {
+  const auto history = boost::make_shared<const planning_msgs::Trajectory>(MakeTrajectory(10.0, 0.0, 80, 12.0));
+  const auto planned = MakeTrajectory(10.3, 0.0, 80, 11.0);
+  const auto trajectory = boost::make_shared<const planning_msgs::Trajectory>(Stitch(*history, 1, 6, 10.3, planned));
+  CompactTrajectoryEncoder encoder;
+  CompactTrajectoryDecoder decoder;
+  CompactTrajectory compact;
+  encoder.Encode(history, &compact);
+  ASSERT_TRUE(decoder.Decode(compact) != nullptr);
+  encoder.Encode(trajectory, &compact);
+  EXPECT_EQ(compact.prefix_sequence_id, 1u);
+  EXPECT_EQ(compact.prefix_start_index, 1u);
+  EXPECT_EQ(compact.prefix_size, 5u);
+  EXPECT_EQ(compact.x.size(), 80u);
+
+  const auto decoded = decoder.Decode(compact);
+  ASSERT_TRUE(decoded != nullptr);
+  ExpectNear(*trajectory, *decoded);
+}
+
+TEST(CompactTrajectoryCodecTest, missing_reference_recovers_at_keyframe) {
+  CompactTrajectoryEncoder encoder(3);
+  CompactTrajectoryDecoder decoder;
+  CompactTrajectory compact;
+  planning_msgs::Trajectory::ConstPtr last_decoded;
+  auto history = boost::make_shared<const planning_msgs::Trajectory>(MakeTrajectory(0.0, 0.0, 80, 12.0));
+  for (size_t i = 1; i <= 4; ++i) {
+    const double stamp = 0.1 * static_cast<double>(i);
+    const auto trajectory = boost::make_shared<const planning_msgs::Trajectory>(
+        Stitch(*history, 0, 1, stamp, MakeTrajectory(stamp, 0.0, 80, 12.0 - static_cast<double>(i))));
+    encoder.Encode(i == 1 ? history : trajectory, &compact);
+    history = i == 1 ? history : trajectory;
+    // the first trajectory is lost
+    if (i == 1) {
+      continue;
+    }
+    last_decoded = decoder.Decode(compact);
+    if (i < 4) {
+      EXPECT_GT(compact.prefix_size, 0u);
+      EXPECT_TRUE(last_decoded == nullptr);
+    }
+  }
+  // the fourth trajectory is a keyframe
+  EXPECT_EQ(compact.prefix_size, 0u);
+  ASSERT_TRUE(last_decoded != nullptr);
+  ExpectNear(*history, *last_decoded);
+}
+
+TEST(CompactTrajectoryCodecTest, uneven_relative_times_are_sent) {
+  auto uneven = MakeTrajectory(10.0, 0.0, 20, 12.0);
+  for (size_t i = 10; i < uneven.trajectory_points.size(); ++i) {
+    uneven.trajectory_points[i].relative_time += 0.05;
+  }
+  const auto trajectory = boost::make_shared<const planning_msgs::Trajectory>(uneven);
+  CompactTrajectoryEncoder encoder;
+  CompactTrajectoryDecoder decoder;
+  CompactTrajectory compact;
+  encoder.Encode(trajectory, &compact);
+  EXPECT_EQ(compact.relative_times.size(), 20u);
+  const auto decoded = decoder.Decode(compact);
+  ASSERT_TRUE(decoded != nullptr);
+  ExpectNear(*trajectory, *decoded);
+
+  compact.vel.pop_back();
+  EXPECT_TRUE(decoder.Decode(compact) == nullptr);
+}
+
+}
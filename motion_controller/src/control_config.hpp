@@ -21,10 +21,28 @@ struct PurePursuitConfigs {
   double steer_weight = 1.3;
 };
 
+struct LQRConfigs {
+  // the weights of the lateral error, the heading error and the steer angle
+  double lateral_error_weight = 0.5;
+  double heading_error_weight = 1.0;
+  double steer_weight = 5.0;
+  // the gains are precomputed for the speeds from min_speed to max_speed every speed_step, in m/s
+  double min_speed = 1.0;
+  double max_speed = 40.0;
+  double speed_step = 1.0;
+  // the linear mpc over mpc_horizon control cycles instead of the lqr gain, the lqr cost to go is its terminal cost
+  bool use_mpc = false;
+  int mpc_horizon = 20;
+  int mpc_max_iter = 50;
+};
+
 struct ControlConfigs {
   double lookahead_time{};
+  // the trajectory points searched before and after the last matched point
+  int matched_point_search_window = 20;
   LonPIDConfigs lon_configs;
   PurePursuitConfigs pure_pursuit_configs;
+  LQRConfigs lqr_configs;
 //  LatPIDConfigs lat_configs;
 };
 }
@@ -1,18 +1,67 @@
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_CONTROL_STRATEGY_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_CONTROL_STRATEGY_HPP_
 #include <ros/ros.h>
+#include <numeric>
+#include <boost/circular_buffer.hpp>
 #include "vehicle_state/vehicle_state.hpp"
+#include "control_config.hpp"
+#include "trajectory_matcher.hpp"
 namespace control {
 class ControlStrategy {
  public:
   ControlStrategy() = default;
+  explicit ControlStrategy(size_t matched_point_search_window) : trajectory_matcher_(matched_point_search_window) {}
   virtual ~ControlStrategy() = default;
   virtual bool Execute(double current_time_stamp,
                        const vehicle_state::VehicleState &vehicle_state,
                        const planning_msgs::Trajectory &trajectory,
                        carla_msgs::CarlaEgoVehicleControl &control) = 0;
+
+  /**
+   * @brief: a new trajectory arrived, the next match searches all of it
+   * @param point_index: the grid index of its points, may be nullptr, see TrajectoryMatcher::Reset
+   */
+  void ResetTrajectoryMatch(const common::PointGridIndex *point_index = nullptr) {
+    trajectory_matcher_.Reset(point_index);
+  }
  protected:
+  /**
+   * @brief: pid on the speed error over the last cycles, shared by the controllers
+   * @param lon_configs: the pid gains
+   * @param delta_t: the control period
+   * @param[out] throttle: in [0, 1]
+   */
+  bool LongitudinalControl(const LonPIDConfigs &lon_configs, double current_speed, double target_speed,
+                           double delta_t, double *throttle) {
+    double speed_error = (target_speed - current_speed) / 3.6;
+    this->lon_error_buffer_.push_back(speed_error);
+    double speed_error_rate = 0.0;
+    double speed_error_intergal = 0.0;
+    if (lon_error_buffer_.size() >= 2) {
+      speed_error_rate = (lon_error_buffer_.back() - *(lon_error_buffer_.end() - 2)) / delta_t;
+      speed_error_intergal = std::accumulate(lon_error_buffer_.begin(), lon_error_buffer_.end(), 0.0) * delta_t;
+    }
+    *throttle = Clamp<double>(
+        lon_configs.lon_kp * speed_error
+            + lon_configs.lon_kd * speed_error_rate / delta_t
+            + lon_configs.lon_ki * speed_error_intergal * delta_t, 0.0, 1.0);
+    return true;
+  }
+
+  template<class T>
+  static T Clamp(const T &value, const T &lower, const T &upper) {
+    ROS_ASSERT(upper > lower);
+    if (value < lower) {
+      return lower;
+    }
+    if (value > upper) {
+      return upper;
+    }
+    return value;
+  }
 
+  TrajectoryMatcher trajectory_matcher_;
+  boost::circular_buffer<double> lon_error_buffer_ = boost::circular_buffer<double>(15);
 };
 
 }
@@ -1,12 +1,16 @@
-#include <derived_object_msgs/ObjectArray.h>
+#include <algorithm>
 #include <pid_stanley_controller/pid_stanley_controller.hpp>
 #include "controller.hpp"
 #include "pid_pure_pursuit_controller/pid_pure_pursuit_controller.hpp"
+#include "pid_lqr_controller/pid_lqr_controller.hpp"
 #include "name/string_name.hpp"
+#include "clock/lock_step_clock.hpp"
 #include "planning_msgs/Trajectory.h"
 namespace control {
 
-Controller::Controller(ros::NodeHandle &nh) : nh_(nh), vehicle_state_(std::make_unique<vehicle_state::VehicleState>()) {
+Controller::Controller(ros::NodeHandle &nh, ros::CallbackQueue *callback_queue)
+    : nh_(nh), callback_queue_(callback_queue != nullptr ? callback_queue : ros::getGlobalCallbackQueue()),
+      vehicle_state_(std::make_unique<vehicle_state::VehicleState>()) {
   nh_.param<std::string>("/motion_control/controller_type", controller_type_, "pure_pursuit_pid");
   nh_.param<double>("/motion_control/pid_lookahead_time", control_configs_.lookahead_time, 1.0);
 //  nh_.param<double>("/motion_control/lateral_pid_kp", control_configs_.lat_configs.lat_kp, 1.95);
@@ -26,42 +30,80 @@ Controller::Controller(ros::NodeHandle &nh) : nh_(nh), vehicle_state_(std::make_
   nh_.param<double>("/motion_control/longitudinal_pid_kd", control_configs_.lon_configs.lon_kd, 0.2);
   nh_.param<double>("/motion_control/longitudinal_pid_ki", control_configs_.lon_configs.lon_ki, 0.36);
 
+  nh_.param<double>("/motion_control/lqr_lateral_error_weight", control_configs_.lqr_configs.lateral_error_weight, 0.5);
+  nh_.param<double>("/motion_control/lqr_heading_error_weight", control_configs_.lqr_configs.heading_error_weight, 1.0);
+  nh_.param<double>("/motion_control/lqr_steer_weight", control_configs_.lqr_configs.steer_weight, 5.0);
+  nh_.param<double>("/motion_control/lqr_min_speed", control_configs_.lqr_configs.min_speed, 1.0);
+  nh_.param<double>("/motion_control/lqr_max_speed", control_configs_.lqr_configs.max_speed, 40.0);
+  nh_.param<double>("/motion_control/lqr_speed_step", control_configs_.lqr_configs.speed_step, 1.0);
+  nh_.param<bool>("/motion_control/lqr_use_mpc", control_configs_.lqr_configs.use_mpc, false);
+  nh_.param<int>("/motion_control/mpc_horizon", control_configs_.lqr_configs.mpc_horizon, 20);
+  nh_.param<int>("/motion_control/mpc_max_iter", control_configs_.lqr_configs.mpc_max_iter, 50);
+
   nh_.param<double>("/motion_control/loop_rate", loop_rate_, 50.0);
+  nh_.param<bool>("/motion_control/lock_step", lock_step_, false);
+  nh_.param<double>("/motion_control/lock_step_timeout", lock_step_timeout_, 0.5);
+  nh_.param<bool>("/motion_control/compact_trajectory", compact_trajectory_, false);
+  nh_.param<int>("/motion_control/matched_point_search_window", control_configs_.matched_point_search_window, 20);
+  nh_.param<std::string>("/motion_control/control_thread_name", control_thread_options_.name, "control");
+  nh_.param<std::vector<int>>("/motion_control/control_thread_cpus", control_thread_options_.cpus, std::vector<int>());
+  nh_.param<int>("/motion_control/control_thread_fifo_priority", control_thread_options_.fifo_priority, 0);
+  nh_.param<int>("/motion_control/control_thread_nice_level", control_thread_options_.nice_level, 0);
   if (controller_type_ == "pure_pursuit_pid") {
     control_strategy_ = std::make_unique<PIDPurePursuitController>(control_configs_, loop_rate_);
   } else if (controller_type_ == "pid_stanley") {
     control_strategy_ = std::make_unique<PIDStanleyController>(control_configs_, loop_rate_);
+  } else if (controller_type_ == "pid_lqr") {
+    control_strategy_ = std::make_unique<PIDLQRController>(control_configs_, loop_rate_);
   } else {
 
     ROS_FATAL("No such controller... [%s]", controller_type_.c_str());
     ROS_ASSERT(false);
   }
 
-  trajectory_subscriber_ = nh_.subscribe<planning_msgs::Trajectory>(
-      common::topic::kPublishedTrajectoryName,
-      5, [this](const planning_msgs::Trajectory::ConstPtr &trajectory) {
-        trajectory_ = *trajectory;
-      });
+  if (compact_trajectory_) {
+    trajectory_subscriber_ = nh_.subscribe<common::CompactTrajectory>(
+        common::topic::kPublishedCompactTrajectoryName,
+        5, [this](const common::CompactTrajectory::ConstPtr &compact) {
+          // decoded and indexed here, so the control loop only swaps the pointer
+          const auto trajectory = compact_trajectory_decoder_.Decode(*compact);
+          if (trajectory == nullptr) {
+            ROS_WARN("[Controller], the compact trajectory %u misses its reference, waiting for a keyframe",
+                     compact->sequence_id);
+            return;
+          }
+          std::atomic_store(&latest_trajectory_,
+                            std::shared_ptr<const IndexedTrajectory>(std::make_shared<IndexedTrajectory>(trajectory)));
+        });
+  } else {
+    trajectory_subscriber_ = nh_.subscribe<planning_msgs::Trajectory>(
+        common::topic::kPublishedTrajectoryName,
+        5, [this](const planning_msgs::Trajectory::ConstPtr &trajectory) {
+          // indexed here, so the control loop only swaps the pointer
+          std::atomic_store(&latest_trajectory_,
+                            std::shared_ptr<const IndexedTrajectory>(std::make_shared<IndexedTrajectory>(trajectory)));
+        });
+  }
   vehicle_info_subscriber_ = nh_.subscribe<carla_msgs::CarlaEgoVehicleInfo>(
       common::topic::kEgoVehicleInfoName, 5,
       [this](const carla_msgs::CarlaEgoVehicleInfo::ConstPtr &vehicle_info) {
+        boost::atomic_store(&ego_vehicle_info_, vehicle_info);
         ego_vehicle_id_ = vehicle_info->id;
-        ego_vehicle_info_ = *vehicle_info;
       });
   vehicle_status_subscriber_ = nh_.subscribe<carla_msgs::CarlaEgoVehicleStatus>(
       common::topic::kEgoVehicleStatusName, 5,
       [this](const carla_msgs::CarlaEgoVehicleStatus::ConstPtr &vehicle_status) {
-        this->ego_vehicle_status_ = *vehicle_status;
+        boost::atomic_store(&ego_vehicle_status_, vehicle_status);
       });
   this->objects_subscriber_ = nh_.subscribe<derived_object_msgs::ObjectArray>(
       common::topic::kObjectsName, 5,
       [this](const derived_object_msgs::ObjectArray::ConstPtr &object_array) {
-        this->objects_map_.clear();
-        for (const auto &object : object_array->objects) {
-          objects_map_.emplace(object.id, object);
-        }
-        ROS_INFO("the objects map_ size is: %lu", objects_map_.size());
+        // only the ego object is looked up, once per cycle
+        boost::atomic_store(&objects_, object_array);
+        ROS_INFO("the objects size is: %lu", object_array->objects.size());
       });
+  // a single thread, so the callbacks never race each other
+  callback_spinner_ = std::make_unique<ros::AsyncSpinner>(1, callback_queue_);
 
   carla_control_publisher_ = nh_.advertise<carla_msgs::CarlaEgoVehicleControl>(
       common::topic::kEgoVehicleControlName, 1);
@@ -73,24 +115,41 @@ void Controller::RunOnce() {
   control.header.frame_id = "/map";
   control.header.stamp = current_time_stamp;
 
-  if (ego_vehicle_id_ == -1) {
+  const auto trajectory = std::atomic_load(&latest_trajectory_);
+  if (trajectory != trajectory_) {
+    trajectory_ = trajectory;
+    control_strategy_->ResetTrajectoryMatch(trajectory_ != nullptr ? &trajectory_->point_index : nullptr);
+  }
+  const int ego_vehicle_id = ego_vehicle_id_;
+  const auto ego_vehicle_info = boost::atomic_load(&ego_vehicle_info_);
+  const auto ego_vehicle_status = boost::atomic_load(&ego_vehicle_status_);
+  if (ego_vehicle_id == -1 || ego_vehicle_info == nullptr || ego_vehicle_status == nullptr) {
     Controller::EmergencyStopControl(control);
     carla_control_publisher_.publish(control);
     return;
   }
-  if (objects_map_.find(ego_vehicle_id_) == objects_map_.end()) {
+  const auto objects = boost::atomic_load(&objects_);
+  const derived_object_msgs::Object *ego_object = nullptr;
+  if (objects != nullptr) {
+    const auto ego = std::find_if(objects->objects.begin(), objects->objects.end(),
+                                  [ego_vehicle_id](const derived_object_msgs::Object &object) {
+                                    return object.id == ego_vehicle_id;
+                                  });
+    ego_object = ego == objects->objects.end() ? nullptr : &(*ego);
+  }
+  if (ego_object == nullptr) {
     Controller::EmergencyStopControl(control);
     carla_control_publisher_.publish(control);
     return;
   }
-  if (trajectory_.status != planning_msgs::Trajectory::NORMAL) {
+  if (trajectory_ == nullptr || trajectory_->trajectory->status != planning_msgs::Trajectory::NORMAL) {
     Controller::EmergencyStopControl(control);
     carla_control_publisher_.publish(control);
     return;
   }
 
-  vehicle_state_->Update(ego_vehicle_status_, ego_vehicle_info_, objects_map_[ego_vehicle_id_]);
-  if (!control_strategy_->Execute(current_time_stamp.toSec(), *vehicle_state_, trajectory_, control)) {
+  vehicle_state_->Update(*ego_vehicle_status, *ego_vehicle_info, *ego_object);
+  if (!control_strategy_->Execute(current_time_stamp.toSec(), *vehicle_state_, *trajectory_->trajectory, control)) {
     Controller::EmergencyStopControl(control);
     carla_control_publisher_.publish(control);
     return;
@@ -109,13 +168,30 @@ void Controller::EmergencyStopControl(carla_msgs::CarlaEgoVehicleControl &contro
 }
 
 void Controller::Launch() {
-  ros::WallRate loop_rate(loop_rate_);
-  while (ros::ok()) {
-    ros::spinOnce();
-    RunOnce();
-    loop_rate.sleep();
+  if (!common::ConfigureCurrentThread(control_thread_options_)) {
+    ROS_WARN("[Controller::Launch], failed to apply the control thread options");
+  }
+  callback_spinner_->start();
+  if (lock_step_) {
+    common::LockStepClock lock_step_clock(lock_step_timeout_);
+    while (lock_step_clock.WaitForNextTick(is_running_)) {
+      // the planner plans the tick first, without a trajectory of the tick the last one is followed
+      if (!lock_step_clock.WaitFor(is_running_, [this, &lock_step_clock]() {
+        const auto trajectory = std::atomic_load(&latest_trajectory_);
+        return trajectory != nullptr && trajectory->trajectory->header.stamp >= lock_step_clock.tick();
+      })) {
+        ROS_WARN("[Controller::Launch], no trajectory of the tick at %lf s", lock_step_clock.tick().toSec());
+      }
+      RunOnce();
+    }
+  } else {
+    ros::WallRate loop_rate(loop_rate_);
+    while (ros::ok() && is_running_) {
+      RunOnce();
+      loop_rate.sleep();
+    }
   }
-  ros::shutdown();
+  callback_spinner_->stop();
 }
 
 }
\ No newline at end of file
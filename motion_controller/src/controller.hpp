@@ -2,27 +2,58 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_CONTROLLER_HPP_
 
 #include <ros/ros.h>
-#include <unordered_map>
+#include <ros/callback_queue.h>
+#include <atomic>
+#include <memory>
 #include <carla_msgs/CarlaEgoVehicleControl.h>
+#include <derived_object_msgs/ObjectArray.h>
 #include <planning_msgs/Trajectory.h>
 #include <carla_msgs/CarlaEgoVehicleInfo.h>
 #include <carla_msgs/CarlaEgoVehicleStatus.h>
 #include <carla_msgs/CarlaEgoVehicleControl.h>
 #include "control_config.hpp"
 #include "control_strategy.hpp"
+#include "trajectory_matcher.hpp"
+#include "trajectory/compact_trajectory_codec.hpp"
+#include "thread_pool/thread_options.hpp"
 #include "vehicle_state/vehicle_state.hpp"
 
 namespace control{
 class Controller {
  public:
-  explicit Controller(ros::NodeHandle& nh);
+  /**
+   * @brief: constructor
+   * @param nh
+   * @param callback_queue: the queue of nh, which Launch spins on a thread of its own, the global queue if nullptr
+   */
+  explicit Controller(ros::NodeHandle& nh, ros::CallbackQueue *callback_queue = nullptr);
+
+  /**
+   * @brief: run the control loop on the calling thread at the loop rate until Stop, the messages are received on
+   * another thread meanwhile, so the loop never waits for a message to be handled. in the lock step one cycle runs
+   * per tick of the simulator clock once the trajectory planned at the tick arrived, its control command lets a
+   * bridge waiting for it tick again
+   */
   void Launch();
+
+  /**
+   * @brief: one control cycle on the latest messages
+   */
   void RunOnce();
+
+  /**
+   * @brief: let Launch return after the current cycle, called from another thread
+   */
+  void Stop() { is_running_ = false; }
  private:
   static void EmergencyStopControl(carla_msgs::CarlaEgoVehicleControl& control);
 
  private:
   ros::NodeHandle nh_;
+  ros::CallbackQueue *callback_queue_ = nullptr;
+  std::unique_ptr<ros::AsyncSpinner> callback_spinner_;
+  common::ThreadOptions control_thread_options_;
+  std::atomic<bool> is_running_{true};
   ros::Publisher carla_control_publisher_;
   ros::Subscriber vehicle_info_subscriber_;
   ros::Subscriber vehicle_status_subscriber_;
@@ -32,13 +63,26 @@ class Controller {
   std::string controller_type_{"pid"};
   ControlConfigs control_configs_;
   std::unique_ptr<ControlStrategy> control_strategy_;
-  planning_msgs::Trajectory trajectory_;
-  carla_msgs::CarlaEgoVehicleInfo ego_vehicle_info_;
-  carla_msgs::CarlaEgoVehicleStatus ego_vehicle_status_;
+  // the latest messages as received, swapped by the atomic shared_ptr functions between the callback thread and the
+  // control loop, the boost ones for the message pointers. in the planner process the trajectory is the published
+  // message itself
+  std::shared_ptr<const IndexedTrajectory> latest_trajectory_;
+  carla_msgs::CarlaEgoVehicleInfo::ConstPtr ego_vehicle_info_;
+  carla_msgs::CarlaEgoVehicleStatus::ConstPtr ego_vehicle_status_;
+  derived_object_msgs::ObjectArray::ConstPtr objects_;
+  std::atomic<int> ego_vehicle_id_{-1};
+  // the trajectory the control loop follows, only touched by the control loop
+  std::shared_ptr<const IndexedTrajectory> trajectory_;
   std::unique_ptr<vehicle_state::VehicleState> vehicle_state_;
-  std::unordered_map<int, derived_object_msgs::Object> objects_map_;
-  int ego_vehicle_id_ = -1;
   double loop_rate_{};
+  // one cycle per tick of the simulator clock instead of at the loop rate, the loop rate then has to be the tick rate
+  bool lock_step_ = false;
+  // the wall time a tick waits for its trajectory, in s
+  double lock_step_timeout_ = 0.5;
+  // follow the compact trajectory of the planner, e.g. on a remote machine
+  bool compact_trajectory_ = false;
+  // only touched by the callback thread
+  common::CompactTrajectoryDecoder compact_trajectory_decoder_;
 
 
 
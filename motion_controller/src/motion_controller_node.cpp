@@ -7,5 +7,6 @@ int main(int argc, char** argv){
   ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Error);
   auto controller = std::make_unique<control::Controller>(nh);
   controller->Launch();
+  ros::shutdown();
   return 0;
 }
\ No newline at end of file
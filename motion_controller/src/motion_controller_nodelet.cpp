@@ -0,0 +1,39 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include <thread>
+#include "controller.hpp"
+
+namespace control {
+/**
+ * @brief: the Controller in a nodelet manager, it receives the trajectory of the planner nodelet of the same manager
+ * as the published shared pointer. the controller keeps its own loop thread and callback queue.
+ */
+class MotionControllerNodelet : public nodelet::Nodelet {
+ public:
+  MotionControllerNodelet() = default;
+  ~MotionControllerNodelet() override {
+    if (controller_) {
+      controller_->Stop();
+    }
+    if (control_thread_.joinable()) {
+      control_thread_.join();
+    }
+  }
+
+ private:
+  void onInit() override {
+    ros::NodeHandle nh(getNodeHandle());
+    nh.setCallbackQueue(&callback_queue_);
+    controller_ = std::make_unique<Controller>(nh, &callback_queue_);
+    control_thread_ = std::thread([this]() { controller_->Launch(); });
+  }
+
+ private:
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<Controller> controller_;
+  std::thread control_thread_;
+};
+}
+
+PLUGINLIB_EXPORT_CLASS(control::MotionControllerNodelet, nodelet::Nodelet)
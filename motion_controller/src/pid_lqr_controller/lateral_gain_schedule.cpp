@@ -0,0 +1,138 @@
+#include "pid_lqr_controller/lateral_gain_schedule.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ros/ros.h>
+
+namespace control {
+namespace {
+// the model is not stabilizable at standstill, the lowest speed of the table is above it
+constexpr double kMinScheduleSpeed = 0.1;
+constexpr double kRiccatiTolerance = 1e-10;
+constexpr int kRiccatiMaxIter = 100;
+}
+
+LateralGainSchedule::LateralGainSchedule(const LQRConfigs &lqr_configs, double delta_t)
+    : lqr_configs_(lqr_configs), delta_t_(delta_t) {
+  lqr_configs_.min_speed = std::max(kMinScheduleSpeed, lqr_configs_.min_speed);
+  lqr_configs_.max_speed = std::max(lqr_configs_.min_speed, lqr_configs_.max_speed);
+  if (lqr_configs_.speed_step <= 0.0) {
+    lqr_configs_.speed_step = lqr_configs_.max_speed - lqr_configs_.min_speed + 1.0;
+  }
+  lqr_configs_.mpc_horizon = std::max(1, lqr_configs_.mpc_horizon);
+  Q_.diagonal() << lqr_configs_.lateral_error_weight, lqr_configs_.heading_error_weight;
+}
+
+void LateralGainSchedule::Build(double wheelbase) {
+  wheelbase_ = wheelbase;
+  speeds_.clear();
+  gains_.clear();
+  mpc_problems_.clear();
+  for (double speed = lqr_configs_.min_speed; speed < lqr_configs_.max_speed + 1e-6;
+       speed += lqr_configs_.speed_step) {
+    speeds_.push_back(speed);
+  }
+  for (const double speed : speeds_) {
+    Eigen::Matrix2d A;
+    Eigen::Vector2d B;
+    Model(speed, &A, &B);
+    Eigen::Matrix2d P;
+    if (!SolveRiccati(A, B, Q_, lqr_configs_.steer_weight, &P)) {
+      ROS_WARN("the riccati equation did not converge at %f m/s", speed);
+    }
+    const double denominator = lqr_configs_.steer_weight + B.dot(P * B);
+    gains_.emplace_back((B.transpose() * P * A) / denominator);
+    if (lqr_configs_.use_mpc) {
+      mpc_problems_.push_back(BuildMPC(A, B, P));
+    }
+  }
+}
+
+bool LateralGainSchedule::IsBuiltFor(double wheelbase) const {
+  return !speeds_.empty() && wheelbase == wheelbase_;
+}
+
+Eigen::RowVector2d LateralGainSchedule::Gain(double speed) const {
+  if (speed <= speeds_.front()) {
+    return gains_.front();
+  }
+  if (speed >= speeds_.back()) {
+    return gains_.back();
+  }
+  const auto index = static_cast<size_t>((speed - speeds_.front()) / lqr_configs_.speed_step);
+  if (index + 1 >= speeds_.size()) {
+    return gains_.back();
+  }
+  const double ratio = (speed - speeds_[index]) / lqr_configs_.speed_step;
+  return (1.0 - ratio) * gains_[index] + ratio * gains_[index + 1];
+}
+
+const LateralGainSchedule::MPCProblem &LateralGainSchedule::MPC(double speed) const {
+  return mpc_problems_[Bin(speed)];
+}
+
+bool LateralGainSchedule::SolveRiccati(const Eigen::Matrix2d &A, const Eigen::Vector2d &B,
+                                       const Eigen::Matrix2d &Q, double R, Eigen::Matrix2d *P) {
+  Eigen::Matrix2d a = A;
+  Eigen::Matrix2d g = B * B.transpose() / R;
+  Eigen::Matrix2d h = Q;
+  for (int i = 0; i < kRiccatiMaxIter; ++i) {
+    const Eigen::Matrix2d w_inverse = (Eigen::Matrix2d::Identity() + g * h).inverse();
+    const Eigen::Matrix2d next_h = h + a.transpose() * h * w_inverse * a;
+    const Eigen::Matrix2d next_g = g + a * w_inverse * g * a.transpose();
+    a = a * w_inverse * a;
+    g = next_g;
+    const bool converged = (next_h - h).norm() <= kRiccatiTolerance * next_h.norm();
+    h = next_h;
+    if (converged) {
+      *P = h;
+      return true;
+    }
+  }
+  *P = h;
+  return false;
+}
+
+void LateralGainSchedule::Model(double speed, Eigen::Matrix2d *A, Eigen::Vector2d *B) const {
+  *A << 1.0, speed * delta_t_,
+      0.0, 1.0;
+  *B << speed * speed * delta_t_ * delta_t_ / (2.0 * wheelbase_), speed * delta_t_ / wheelbase_;
+}
+
+size_t LateralGainSchedule::Bin(double speed) const {
+  const double position = std::round((speed - speeds_.front()) / lqr_configs_.speed_step);
+  return static_cast<size_t>(std::min(std::max(0.0, position), static_cast<double>(speeds_.size() - 1)));
+}
+
+LateralGainSchedule::MPCProblem LateralGainSchedule::BuildMPC(const Eigen::Matrix2d &A, const Eigen::Vector2d &B,
+                                                              const Eigen::Matrix2d &P) const {
+  const int horizon = lqr_configs_.mpc_horizon;
+  // the stacked states x(1..N) = phi x0 + gamma u(0..N-1)
+  Eigen::MatrixXd phi = Eigen::MatrixXd::Zero(2 * horizon, 2);
+  Eigen::MatrixXd gamma = Eigen::MatrixXd::Zero(2 * horizon, horizon);
+  Eigen::Matrix2d power = Eigen::Matrix2d::Identity();
+  for (int k = 0; k < horizon; ++k) {
+    // power is A^k here
+    const Eigen::Vector2d column = power * B;
+    for (int row = k; row < horizon; ++row) {
+      gamma.block<2, 1>(2 * row, row - k) = column;
+    }
+    power = A * power;
+    phi.block<2, 2>(2 * k, 0) = power;
+  }
+  // the lqr cost to go ends the horizon, so the mpc equals the lqr while no steer limit is hit
+  Eigen::MatrixXd weights = Eigen::MatrixXd::Zero(2 * horizon, 2 * horizon);
+  for (int k = 0; k + 1 < horizon; ++k) {
+    weights.block<2, 2>(2 * k, 2 * k) = Q_;
+  }
+  weights.block<2, 2>(2 * (horizon - 1), 2 * (horizon - 1)) = P;
+
+  MPCProblem problem;
+  problem.hessian = gamma.transpose() * weights * gamma
+      + lqr_configs_.steer_weight * Eigen::MatrixXd::Identity(horizon, horizon);
+  problem.gradient_gain = gamma.transpose() * weights * phi;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(problem.hessian, Eigen::EigenvaluesOnly);
+  problem.step = 1.0 / solver.eigenvalues().maxCoeff();
+  return problem;
+}
+
+}
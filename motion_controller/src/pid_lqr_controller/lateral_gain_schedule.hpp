@@ -0,0 +1,70 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_LATERAL_GAIN_SCHEDULE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_LATERAL_GAIN_SCHEDULE_HPP_
+#include <vector>
+#include <Eigen/Dense>
+#include "control_config.hpp"
+
+namespace control {
+
+/**
+ * @brief: the lqr gains of the lateral error model for a table of speeds. the error state is [lateral error, heading
+ * error] at the rear axle and the input is the steer angle beyond the feedforward of the reference curvature:
+ *   x(k+1) = A(v) x(k) + B(v) u(k), A = [1, v dt; 0, 1], B = [v^2 dt^2 / (2 L), v dt / L]
+ * the model only changes with the speed, so the riccati equation is solved once per speed when the wheelbase is known
+ * instead of every control cycle. the condensed matrices of the mpc over the same model are cached alongside.
+ */
+class LateralGainSchedule {
+ public:
+  /**
+   * @brief: the condensed qp of the mpc at one speed, min 0.5 u' H u + x0' F' u over the inputs of the horizon
+   */
+  struct MPCProblem {
+    Eigen::MatrixXd hessian;
+    Eigen::MatrixXd gradient_gain;
+    // 1 / the largest eigenvalue of the hessian, the step of the projected gradient
+    double step = 0.0;
+  };
+
+  LateralGainSchedule(const LQRConfigs &lqr_configs, double delta_t);
+
+  /**
+   * @brief: solve the gains of all the speeds for the wheelbase, and the mpc problems if the mpc is used
+   */
+  void Build(double wheelbase);
+
+  bool IsBuiltFor(double wheelbase) const;
+
+  /**
+   * @brief: the gain linearly interpolated between the two nearest speeds, clamped to the table
+   */
+  Eigen::RowVector2d Gain(double speed) const;
+
+  /**
+   * @brief: the mpc problem of the nearest speed, only valid if the mpc is used
+   */
+  const MPCProblem &MPC(double speed) const;
+
+  /**
+   * @brief: the stabilizing solution of the discrete algebraic riccati equation by the structured doubling algorithm
+   * @return: false if it did not converge, the last iterate is returned anyway
+   */
+  static bool SolveRiccati(const Eigen::Matrix2d &A, const Eigen::Vector2d &B, const Eigen::Matrix2d &Q, double R,
+                           Eigen::Matrix2d *P);
+
+ private:
+  void Model(double speed, Eigen::Matrix2d *A, Eigen::Vector2d *B) const;
+  size_t Bin(double speed) const;
+  MPCProblem BuildMPC(const Eigen::Matrix2d &A, const Eigen::Vector2d &B, const Eigen::Matrix2d &P) const;
+
+ private:
+  LQRConfigs lqr_configs_;
+  double delta_t_;
+  double wheelbase_ = 0.0;
+  Eigen::Matrix2d Q_ = Eigen::Matrix2d::Zero();
+  std::vector<double> speeds_;
+  std::vector<Eigen::RowVector2d, Eigen::aligned_allocator<Eigen::RowVector2d>> gains_;
+  std::vector<MPCProblem> mpc_problems_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_LATERAL_GAIN_SCHEDULE_HPP_
@@ -0,0 +1,82 @@
+#include "pid_lqr_controller/lateral_gain_schedule.hpp"
+#include <gtest/gtest.h>
+
+namespace control {
+namespace {
+constexpr double kDeltaT = 0.05;
+constexpr double kWheelbase = 2.8;
+
+LQRConfigs SmallScheduleConfigs() {
+  LQRConfigs lqr_configs;
+  lqr_configs.min_speed = 2.0;
+  lqr_configs.max_speed = 10.0;
+  lqr_configs.speed_step = 2.0;
+  lqr_configs.mpc_horizon = 10;
+  return lqr_configs;
+}
+}
+
+TEST(LateralGainScheduleTest, lqr_gain_matches_unconstrained_mpc) {
+  auto lqr_configs = SmallScheduleConfigs();
+  lqr_configs.use_mpc = true;
+  LateralGainSchedule gain_schedule(lqr_configs, kDeltaT);
+  gain_schedule.Build(kWheelbase);
+  ASSERT_TRUE(gain_schedule.IsBuiltFor(kWheelbase));
+  EXPECT_FALSE(gain_schedule.IsBuiltFor(kWheelbase + 0.1));
+
+  const double speed = 6.0;
+  Eigen::Matrix2d A;
+  A << 1.0, speed * kDeltaT,
+      0.0, 1.0;
+  const Eigen::Vector2d B{speed * speed * kDeltaT * kDeltaT / (2.0 * kWheelbase), speed * kDeltaT / kWheelbase};
+  const Eigen::Matrix2d Q = Eigen::Vector2d{lqr_configs.lateral_error_weight,
+                                            lqr_configs.heading_error_weight}.asDiagonal();
+  const double R = lqr_configs.steer_weight;
+  Eigen::Matrix2d P;
+  ASSERT_TRUE(LateralGainSchedule::SolveRiccati(A, B, Q, R, &P));
+  // the fixed point of the riccati recursion
+  const Eigen::Matrix2d riccati_residual = A.transpose() * P * A - P + Q
+      - (A.transpose() * P * B) * (B.transpose() * P * A) / (R + B.dot(P * B));
+  EXPECT_LT(riccati_residual.norm(), 1e-8 * P.norm());
+
+  // the lqr cost to go ends the mpc horizon, so the first step of the unconstrained mpc is the lqr feedback
+  const auto &problem = gain_schedule.MPC(speed);
+  ASSERT_EQ(problem.hessian.rows(), lqr_configs.mpc_horizon);
+  const Eigen::RowVector2d gain = gain_schedule.Gain(speed);
+  for (const Eigen::Vector2d &error : {Eigen::Vector2d{0.5, 0.0}, Eigen::Vector2d{0.0, 0.1},
+                                       Eigen::Vector2d{-0.3, 0.05}}) {
+    const Eigen::VectorXd steers = -problem.hessian.ldlt().solve(problem.gradient_gain * error);
+    EXPECT_NEAR(steers[0], -gain * error, 1e-9);
+  }
+}
+
+TEST(LateralGainScheduleTest, gain_interpolated_and_clamped_to_table) {
+  const auto lqr_configs = SmallScheduleConfigs();
+  LateralGainSchedule gain_schedule(lqr_configs, kDeltaT);
+  gain_schedule.Build(kWheelbase);
+  const Eigen::RowVector2d min_gain = gain_schedule.Gain(lqr_configs.min_speed);
+  const Eigen::RowVector2d max_gain = gain_schedule.Gain(lqr_configs.max_speed);
+  // the model changes with the speed, so do the gains
+  EXPECT_GT((max_gain - min_gain).norm(), 1e-3);
+
+  // below and above the table, the gains of its ends
+  EXPECT_TRUE(gain_schedule.Gain(0.0).isApprox(min_gain));
+  EXPECT_TRUE(gain_schedule.Gain(lqr_configs.min_speed - 1.5).isApprox(min_gain));
+  EXPECT_TRUE(gain_schedule.Gain(lqr_configs.max_speed + 5.0).isApprox(max_gain));
+
+  // inside the table, linear between the two nearest speeds
+  const Eigen::RowVector2d gain_4 = gain_schedule.Gain(4.0);
+  const Eigen::RowVector2d gain_6 = gain_schedule.Gain(6.0);
+  EXPECT_TRUE(gain_schedule.Gain(5.0).isApprox(0.5 * (gain_4 + gain_6)));
+  EXPECT_TRUE(gain_schedule.Gain(4.5).isApprox(0.75 * gain_4 + 0.25 * gain_6));
+  const Eigen::RowVector2d gain_10 = gain_schedule.Gain(10.0);
+  const Eigen::RowVector2d gain_8 = gain_schedule.Gain(8.0);
+  EXPECT_TRUE(gain_schedule.Gain(9.9).isApprox(0.05 * gain_8 + 0.95 * gain_10));
+}
+
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+#include "pid_lqr_controller/pid_lqr_controller.hpp"
+#include <algorithm>
+#include <numeric>
+#include <math/math_utils.hpp>
+
+namespace control {
+namespace {
+constexpr double kMPCTolerance = 1e-6;
+}
+
+PIDLQRController::PIDLQRController(const ControlConfigs &control_configs, double loop_rate)
+    : ControlStrategy(static_cast<size_t>(std::max(0, control_configs.matched_point_search_window))),
+      control_configs_(control_configs), loop_rate_(loop_rate),
+      gain_schedule_(control_configs.lqr_configs, 1.0 / loop_rate) {}
+
+bool PIDLQRController::Execute(double current_time_stamp,
+                               const vehicle_state::VehicleState &vehicle_state,
+                               const planning_msgs::Trajectory &trajectory,
+                               carla_msgs::CarlaEgoVehicleControl &control) {
+  auto kinodynamic_state = vehicle_state.GetKinoDynamicVehicleState();
+  size_t cur_index = 0;
+  if (!trajectory_matcher_.MatchByPosition(kinodynamic_state.x, kinodynamic_state.y, trajectory, &cur_index)) {
+    return false;
+  }
+  const auto &cur_tp = trajectory.trajectory_points[cur_index];
+  if (cur_tp.path_point.s >= trajectory.trajectory_points.back().path_point.s - 1e-3) {
+    control.steer = 0.0;
+    control.throttle = 0.0;
+    control.brake = 1.0;
+    control.hand_brake = false;
+    control.manual_gear_shift = false;
+    return true;
+  }
+  const auto &target_tp = trajectory.trajectory_points[TrajectoryMatcher::MatchByS(
+      cur_tp.path_point.s + kinodynamic_state.v * control_configs_.lookahead_time, trajectory, cur_index)];
+  double throttle = 0.0;
+  double steer = 0.0;
+  if (!LongitudinalControl(control_configs_.lon_configs, kinodynamic_state.v, target_tp.vel,
+                           1.0 / loop_rate_, &throttle)) {
+    return false;
+  }
+  double wheel_base = vehicle_state.vehicle_params().lf_ + vehicle_state.vehicle_params().lr_;
+  double max_steer = vehicle_state.vehicle_params().max_steer_angle_;
+  if (!LQRSteerControl(max_steer, wheel_base, kinodynamic_state, cur_index, trajectory, &steer)) {
+    return false;
+  }
+  control.steer = steer;
+  control.throttle = throttle;
+  control.brake = 0.0;
+  control.hand_brake = false;
+  control.manual_gear_shift = false;
+  return true;
+}
+
+bool PIDLQRController::LQRSteerControl(double max_steer,
+                                       double wheelbase,
+                                       const vehicle_state::KinoDynamicState &vehicle_state,
+                                       size_t matched_index,
+                                       const planning_msgs::Trajectory &trajectory,
+                                       double *steer) {
+  if (!gain_schedule_.IsBuiltFor(wheelbase)) {
+    gain_schedule_.Build(wheelbase);
+  }
+  const auto &matched_tp = trajectory.trajectory_points[matched_index];
+  const double ref_theta = matched_tp.path_point.theta;
+  const double dx = vehicle_state.x - matched_tp.path_point.x;
+  const double dy = vehicle_state.y - matched_tp.path_point.y;
+  // positive to the left of the trajectory
+  const Eigen::Vector2d error{-dx * std::sin(ref_theta) + dy * std::cos(ref_theta),
+                              common::MathUtils::NormalizeAngle(vehicle_state.theta - ref_theta)};
+  const double speed = std::max(0.0, vehicle_state.v);
+  const double feedforward = std::atan(wheelbase * matched_tp.path_point.kappa);
+
+  double calc_steer = 0.0;
+  if (control_configs_.lqr_configs.use_mpc) {
+    const int horizon = std::max(1, control_configs_.lqr_configs.mpc_horizon);
+    Eigen::VectorXd lower_bounds(horizon);
+    Eigen::VectorXd upper_bounds(horizon);
+    size_t index = matched_index;
+    for (int k = 0; k < horizon; ++k) {
+      index = TrajectoryMatcher::MatchByS(matched_tp.path_point.s + speed * k / loop_rate_, trajectory, index);
+      const double step_feedforward = std::atan(wheelbase * trajectory.trajectory_points[index].path_point.kappa);
+      lower_bounds[k] = -max_steer - step_feedforward;
+      upper_bounds[k] = max_steer - step_feedforward;
+    }
+    calc_steer = feedforward + SolveMPC(speed, error, lower_bounds, upper_bounds);
+  } else {
+    calc_steer = feedforward - gain_schedule_.Gain(speed) * error;
+  }
+  double normalized_steer = calc_steer / max_steer;
+  *steer = Clamp<double>(normalized_steer, -1.0, 1.0);
+  return true;
+}
+
+double PIDLQRController::SolveMPC(double speed, const Eigen::Vector2d &error,
+                                  const Eigen::VectorXd &lower_bounds, const Eigen::VectorXd &upper_bounds) {
+  const auto &problem = gain_schedule_.MPC(speed);
+  const auto horizon = lower_bounds.size();
+  Eigen::VectorXd previous = Eigen::VectorXd::Zero(horizon);
+  if (mpc_solution_.size() == horizon) {
+    previous.head(horizon - 1) = mpc_solution_.tail(horizon - 1);
+    previous[horizon - 1] = mpc_solution_[horizon - 1];
+  }
+  previous = previous.cwiseMax(lower_bounds).cwiseMin(upper_bounds);
+  const Eigen::VectorXd gradient_offset = problem.gradient_gain * error;
+  // fista, the projected gradient with momentum on the box of the steer limits
+  Eigen::VectorXd extrapolated = previous;
+  Eigen::VectorXd solution = previous;
+  double momentum = 1.0;
+  for (int i = 0; i < control_configs_.lqr_configs.mpc_max_iter; ++i) {
+    solution = (extrapolated - problem.step * (problem.hessian * extrapolated + gradient_offset))
+        .cwiseMax(lower_bounds).cwiseMin(upper_bounds);
+    const double next_momentum = (1.0 + std::sqrt(1.0 + 4.0 * momentum * momentum)) / 2.0;
+    extrapolated = solution + ((momentum - 1.0) / next_momentum) * (solution - previous);
+    const bool converged = (solution - previous).norm() < kMPCTolerance;
+    previous = solution;
+    momentum = next_momentum;
+    if (converged) {
+      break;
+    }
+  }
+  mpc_solution_ = solution;
+  return solution[0];
+}
+
+}
@@ -0,0 +1,53 @@
+
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_PID_LQR_CONTROLLER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_PID_LQR_CONTROLLER_HPP_
+
+#include <planning_msgs/Trajectory.h>
+#include "control_strategy.hpp"
+#include "control_config.hpp"
+#include "pid_lqr_controller/lateral_gain_schedule.hpp"
+#include <boost/circular_buffer.hpp>
+
+namespace control {
+/**
+ * @brief: pid on the speed, and lqr on the lateral and heading errors plus the feedforward of the curvature on the
+ * steer. the gains come from a table over the speed solved once, or the steer from a warm started mpc over the same
+ * model, which respects the steer limit along the horizon
+ */
+class PIDLQRController : public ControlStrategy {
+ public:
+  PIDLQRController(const ControlConfigs &control_configs, double loop_rate);
+  ~PIDLQRController() override = default;
+  bool Execute(double current_time_stamp,
+               const vehicle_state::VehicleState &vehicle_state,
+               const planning_msgs::Trajectory &trajectory,
+               carla_msgs::CarlaEgoVehicleControl &control) override;
+
+ private:
+  bool LQRSteerControl(double max_steer,
+                       double wheelbase,
+                       const vehicle_state::KinoDynamicState &vehicle_state,
+                       size_t matched_index,
+                       const planning_msgs::Trajectory &trajectory,
+                       double *steer);
+
+  /**
+   * @brief: the steer beyond the feedforward at the first step of the mpc horizon
+   * @param speed
+   * @param error: the lateral and heading errors
+   * @param lower_bounds: the lowest steer beyond the feedforward of each step of the horizon
+   * @param upper_bounds: the highest steer beyond the feedforward of each step of the horizon
+   */
+  double SolveMPC(double speed, const Eigen::Vector2d &error,
+                  const Eigen::VectorXd &lower_bounds, const Eigen::VectorXd &upper_bounds);
+
+ private:
+  ControlConfigs control_configs_;
+  double loop_rate_{};
+  LateralGainSchedule gain_schedule_;
+  // the solution of the last cycle, shifted by one step it starts the next solve
+  Eigen::VectorXd mpc_solution_;
+};
+}
+
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_PID_LQR_CONTROLLER_PID_LQR_CONTROLLER_HPP_
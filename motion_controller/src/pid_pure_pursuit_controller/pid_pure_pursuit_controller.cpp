@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <numeric>
 #include <math/math_utils.hpp>
 #include "pid_pure_pursuit_controller.hpp"
@@ -5,22 +6,22 @@
 namespace control {
 
 PIDPurePursuitController::PIDPurePursuitController(const ControlConfigs &control_configs, double loop_rate)
-    : control_configs_(control_configs), loop_rate_(loop_rate) {
-  lon_error_buffer_.set_capacity(15);
-}
+    : ControlStrategy(static_cast<size_t>(std::max(0, control_configs.matched_point_search_window))),
+      control_configs_(control_configs), loop_rate_(loop_rate) {}
 
 bool PIDPurePursuitController::Execute(double current_time_stamp,
                                        const vehicle_state::VehicleState &vehicle_state,
                                        const planning_msgs::Trajectory &trajectory,
                                        carla_msgs::CarlaEgoVehicleControl &control) {
-  planning_msgs::TrajectoryPoint cur_tp, target_tp;
   auto kinodynamic_state = vehicle_state.GetKinoDynamicVehicleState();
-  if (!GetMatchedPointByPosition(kinodynamic_state.x, kinodynamic_state.y, trajectory, cur_tp)) {
+  size_t cur_index = 0;
+  if (!trajectory_matcher_.MatchByPosition(kinodynamic_state.x, kinodynamic_state.y, trajectory, &cur_index)) {
     return false;
   }
-  if (cur_tp == trajectory.trajectory_points.back()) {
+  if (cur_index + 1 == trajectory.trajectory_points.size()) {
     return false;
   }
+  const auto &cur_tp = trajectory.trajectory_points[cur_index];
 //  double preview_time = current_time_stamp + control_configs_.lookahead_time;
 //  if (!GetMatchedPointByAbsoluteTime(preview_time, trajectory, target_tp)) {
 //    return false;
@@ -30,9 +31,8 @@ bool PIDPurePursuitController::Execute(double current_time_stamp,
       std::min(std::max(control_configs_.pure_pursuit_configs.steer_control_min_lookahead_dist,
                         kinodynamic_state.v * control_configs_.pure_pursuit_configs.steer_control_gain),
                control_configs_.pure_pursuit_configs.steer_control_max_lookahead_dist);
-  if (!GetMatchedPointByS(cur_tp.path_point.s + approx_lookahead_dist, trajectory, target_tp)) {
-    return false;
-  }
+  const auto &target_tp = trajectory.trajectory_points[
+      TrajectoryMatcher::MatchByS(cur_tp.path_point.s + approx_lookahead_dist, trajectory, cur_index)];
 //  double max_vel = trajectory.trajectory_points.front().vel;
 //  for (const auto& tp: trajectory.trajectory_points) {
 //    if (tp.vel > max_vel) {
@@ -46,7 +46,8 @@ bool PIDPurePursuitController::Execute(double current_time_stamp,
   double throttle = 0.0;
   double steer = 0.0;
 
-  if (!LongitudinalControl(cur_lon_s_dot, target_lon_s_dot, 1.0 / loop_rate_, &throttle)) {
+  if (!LongitudinalControl(control_configs_.lon_configs, cur_lon_s_dot, target_lon_s_dot,
+                           1.0 / loop_rate_, &throttle)) {
     return false;
   }
   double wheel_base = vehicle_state.vehicle_params().lf_ + vehicle_state.vehicle_params().lr_;
@@ -63,22 +64,6 @@ bool PIDPurePursuitController::Execute(double current_time_stamp,
   return true;
 }
 
-bool PIDPurePursuitController::LongitudinalControl(double current_speed, double target_speed,
-                                                   double delta_t, double *throttle) {
-  double speed_error = (target_speed - current_speed) / 3.6;
-  this->lon_error_buffer_.push_back(speed_error);
-  double speed_error_rate = 0.0;
-  double speed_error_intergal = 0.0;
-  if (lon_error_buffer_.size() >= 2) {
-    speed_error_rate = (lon_error_buffer_.back() - *(lon_error_buffer_.end() - 2)) / delta_t;
-    speed_error_intergal = std::accumulate(lon_error_buffer_.begin(), lon_error_buffer_.end(), 0.0) * delta_t;
-  }
-  *throttle = Clamp<double>(
-      control_configs_.lon_configs.lon_kp * speed_error
-          + control_configs_.lon_configs.lon_kd * speed_error_rate / delta_t
-          + control_configs_.lon_configs.lon_ki * speed_error_intergal * delta_t, 0.0, 1.0);
-  return true;
-}
 //
 //bool PIDPurePursuitController::LateralControl(const Eigen::Vector3d &current_pose,
 //                                              const Eigen::Vector3d &target_pose,
@@ -112,38 +97,6 @@ bool PIDPurePursuitController::LongitudinalControl(double current_speed, double
 //  return true;
 //}
 
-template<class T>
-T PIDPurePursuitController::Clamp(const T &value, const T &lower, const T &upper) {
-  ROS_ASSERT(upper > lower);
-  if (value < lower) {
-    return lower;
-  }
-  if (value > upper) {
-    return upper;
-  }
-  return value;
-}
-bool PIDPurePursuitController::GetMatchedPointByPosition(double x,
-                                                         double y,
-                                                         const planning_msgs::Trajectory &trajectory,
-                                                         planning_msgs::TrajectoryPoint &matched_tp) {
-  if (trajectory.trajectory_points.empty()) {
-    return false;
-  }
-  size_t min_index = 0;
-  double min_sqr_dist = std::numeric_limits<double>::max();
-  for (size_t i = 0; i < trajectory.trajectory_points.size(); ++i) {
-    auto pp = trajectory.trajectory_points.at(i).path_point;
-    double sqr_dist = (pp.x - x) * (pp.x - x) + (pp.y - y) * (pp.y - y);
-    if (sqr_dist < min_sqr_dist) {
-      min_sqr_dist = sqr_dist;
-      min_index = i;
-    }
-  }
-  matched_tp = trajectory.trajectory_points.at(min_index);
-  return true;
-}
-
 bool PIDPurePursuitController::GetMatchedPointByAbsoluteTime(double &time_stamp,
                                                              const planning_msgs::Trajectory &trajectory,
                                                              planning_msgs::TrajectoryPoint &matched_tp) {
@@ -179,34 +132,6 @@ bool PIDPurePursuitController::GetMatchedPointByRelativeTime(double relative_tim
   }
   return true;
 }
-bool PIDPurePursuitController::GetMatchedPointByS(double s,
-                                                  const planning_msgs::Trajectory &trajectory,
-                                                  planning_msgs::TrajectoryPoint &matched_tp) {
-  if (trajectory.trajectory_points.empty()) {
-    return false;
-  }
-  auto it_low =
-      std::lower_bound(trajectory.trajectory_points.begin(), trajectory.trajectory_points.end(),
-                       s, [](const planning_msgs::TrajectoryPoint &tp, double s) -> bool {
-            return tp.path_point.s < s;
-          });
-  if (it_low == trajectory.trajectory_points.begin()) {
-    matched_tp = *it_low;
-    return true;
-  }
-  if (it_low == trajectory.trajectory_points.end()) {
-    matched_tp = trajectory.trajectory_points.back();
-    return true;
-  }
-  auto it_lower = it_low - 1;
-  if (s - it_lower->path_point.s < it_low->path_point.s - s) {
-    matched_tp = *it_lower;
-  } else {
-    matched_tp = *it_low;
-  }
-  return true;
-}
-
 bool PIDPurePursuitController::PurePursuitSteerControl(double max_steer,
                                                        double wheelbase,
                                                        const vehicle_state::KinoDynamicState &vehicle_state,
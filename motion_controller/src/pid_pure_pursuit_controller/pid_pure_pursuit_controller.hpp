@@ -17,7 +17,6 @@ class PIDPurePursuitController : public ControlStrategy {
                carla_msgs::CarlaEgoVehicleControl &control) override;
 
  private:
-  bool LongitudinalControl(double current_speed, double target_speed, double delta_t, double *throttle);
 //  bool LateralControl(const Eigen::Vector3d &current_pose,
 //                      const Eigen::Vector3d &target_pose,
 //                      double delta_t,
@@ -28,22 +27,12 @@ class PIDPurePursuitController : public ControlStrategy {
                                const planning_msgs::TrajectoryPoint &target_tp,
                                const planning_msgs::Trajectory &trajectory,
                                double *steer);
-  template<class T>
-  inline T Clamp(const T &value, const T &lower, const T &upper);
-
-  static inline bool GetMatchedPointByPosition(double x,
-                                 double y,
-                                 const planning_msgs::Trajectory &trajectory,
-                                 planning_msgs::TrajectoryPoint &matched_tp);
-
   static inline bool GetMatchedPointByAbsoluteTime(double &time_stamp, const planning_msgs::Trajectory& trajectory,
                                                    planning_msgs::TrajectoryPoint& matched_tp);
 
   static inline bool GetMatchedPointByRelativeTime(double relative_time, const planning_msgs::Trajectory& trajectory,
                                                    planning_msgs::TrajectoryPoint& matched_tp);
 
-  static inline bool GetMatchedPointByS(double s, const planning_msgs::Trajectory& trajectory,
-                                        planning_msgs::TrajectoryPoint& matched_tp);
 
 
 
@@ -52,7 +41,6 @@ class PIDPurePursuitController : public ControlStrategy {
   ControlConfigs control_configs_;
   double loop_rate_{};
   boost::circular_buffer<double> lat_error_buffer_{};
-  boost::circular_buffer<double> lon_error_buffer_{};
 
 };
 }
@@ -1,18 +1,17 @@
 #include <pid_stanley_controller/pid_stanley_controller.hpp>
+#include <algorithm>
 #include <numeric>
 #include <math/math_utils.hpp>
 namespace control {
 
 PIDStanleyController::PIDStanleyController(const ControlConfigs &control_configs, double loop_rate)
-    : control_configs_(control_configs), loop_rate_(loop_rate) {
-  lon_error_buffer_.set_capacity(15);
-}
+    : ControlStrategy(static_cast<size_t>(std::max(0, control_configs.matched_point_search_window))),
+      control_configs_(control_configs), loop_rate_(loop_rate) {}
 
 bool PIDStanleyController::Execute(double current_time_stamp,
                                    const vehicle_state::VehicleState &vehicle_state,
                                    const planning_msgs::Trajectory &trajectory,
                                    carla_msgs::CarlaEgoVehicleControl &control) {
-  planning_msgs::TrajectoryPoint target_tp;
   auto kinodynamic_state = vehicle_state.GetKinoDynamicVehicleState();
   double wheel_base = (vehicle_state.vehicle_params().lr_ + vehicle_state.vehicle_params().lf_);
   double front_x = kinodynamic_state.x + wheel_base * std::cos(kinodynamic_state.theta);
@@ -20,9 +19,11 @@ bool PIDStanleyController::Execute(double current_time_stamp,
   auto steer_control_state = kinodynamic_state;
   steer_control_state.x = front_x;
   steer_control_state.y = front_y;
-  if (!GetMatchedPointByPosition(front_x, front_y, trajectory, target_tp)) {
+  size_t target_index = 0;
+  if (!trajectory_matcher_.MatchByPosition(front_x, front_y, trajectory, &target_index)) {
     return false;
   }
+  const auto &target_tp = trajectory.trajectory_points[target_index];
 //  if (cur_tp == trajectory.trajectory_points.back()) {
 //    return false;
 //  }
@@ -40,7 +41,8 @@ bool PIDStanleyController::Execute(double current_time_stamp,
     control.manual_gear_shift = false;
     return true;
   }
-  if (!LongitudinalControl(cur_lon_s_dot, target_lon_s_dot, 1.0 / loop_rate_, &throttle)) {
+  if (!LongitudinalControl(control_configs_.lon_configs, cur_lon_s_dot, target_lon_s_dot,
+                           1.0 / loop_rate_, &throttle)) {
     return false;
   }
 //  double wheel_base = vehicle_state.vehicle_params().lf_ + vehicle_state.vehicle_params().lr_;
@@ -57,55 +59,6 @@ bool PIDStanleyController::Execute(double current_time_stamp,
   return true;
 }
 
-bool PIDStanleyController::LongitudinalControl(double current_speed, double target_speed,
-                                               double delta_t, double *throttle) {
-  double speed_error = (target_speed - current_speed) / 3.6;
-  this->lon_error_buffer_.push_back(speed_error);
-  double speed_error_rate = 0.0;
-  double speed_error_intergal = 0.0;
-  if (lon_error_buffer_.size() >= 2) {
-    speed_error_rate = (lon_error_buffer_.back() - *(lon_error_buffer_.end() - 2)) / delta_t;
-    speed_error_intergal = std::accumulate(lon_error_buffer_.begin(), lon_error_buffer_.end(), 0.0) * delta_t;
-  }
-  *throttle = Clamp<double>(
-      control_configs_.lon_configs.lon_kp * speed_error
-          + control_configs_.lon_configs.lon_kd * speed_error_rate / delta_t
-          + control_configs_.lon_configs.lon_ki * speed_error_intergal * delta_t, 0.0, 1.0);
-  return true;
-}
-
-template<class T>
-T PIDStanleyController::Clamp(const T &value, const T &lower, const T &upper) {
-  ROS_ASSERT(upper > lower);
-  if (value < lower) {
-    return lower;
-  }
-  if (value > upper) {
-    return upper;
-  }
-  return value;
-}
-
-bool PIDStanleyController::GetMatchedPointByPosition(double x, double y,
-                                                     const planning_msgs::Trajectory &trajectory,
-                                                     planning_msgs::TrajectoryPoint &matched_tp) {
-  if (trajectory.trajectory_points.empty()) {
-    return false;
-  }
-  size_t min_index = 0;
-  double min_sqr_dist = std::numeric_limits<double>::max();
-  for (size_t i = 0; i < trajectory.trajectory_points.size(); ++i) {
-    auto pp = trajectory.trajectory_points.at(i).path_point;
-    double sqr_dist = (pp.x - x) * (pp.x - x) + (pp.y - y) * (pp.y - y);
-    if (sqr_dist < min_sqr_dist) {
-      min_sqr_dist = sqr_dist;
-      min_index = i;
-    }
-  }
-  matched_tp = trajectory.trajectory_points.at(min_index);
-  return true;
-}
-
 bool PIDStanleyController::GetMatchedPointByAbsoluteTime(double &time_stamp,
                                                          const planning_msgs::Trajectory &trajectory,
                                                          planning_msgs::TrajectoryPoint &matched_tp) {
@@ -0,0 +1,89 @@
+#include "trajectory_matcher.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace control {
+
+namespace {
+common::PointGridIndex BuildPointIndex(const planning_msgs::Trajectory &trajectory) {
+  std::vector<double> xs, ys;
+  xs.reserve(trajectory.trajectory_points.size());
+  ys.reserve(trajectory.trajectory_points.size());
+  for (const auto &tp : trajectory.trajectory_points) {
+    xs.push_back(tp.path_point.x);
+    ys.push_back(tp.path_point.y);
+  }
+  return common::PointGridIndex(xs, ys);
+}
+}
+
+IndexedTrajectory::IndexedTrajectory(const planning_msgs::Trajectory::ConstPtr &trajectory)
+    : trajectory(trajectory), point_index(BuildPointIndex(*trajectory)) {}
+
+TrajectoryMatcher::TrajectoryMatcher(size_t search_window) : search_window_(search_window) {}
+
+bool TrajectoryMatcher::MatchByPosition(double x, double y, const planning_msgs::Trajectory &trajectory,
+                                        size_t *index) {
+  const auto &points = trajectory.trajectory_points;
+  if (points.empty()) {
+    return false;
+  }
+  auto sqr_dist = [&points, x, y](size_t i) -> double {
+    const auto &pp = points[i].path_point;
+    return (pp.x - x) * (pp.x - x) + (pp.y - y) * (pp.y - y);
+  };
+  if (!has_last_index_ && point_index_ != nullptr && point_index_->Size() == points.size()) {
+    has_last_index_ = true;
+    last_index_ = point_index_->Nearest(x, y);
+    *index = last_index_;
+    return true;
+  }
+  size_t begin = 0;
+  size_t end = points.size();
+  if (has_last_index_ && last_index_ < points.size()) {
+    begin = last_index_ > search_window_ ? last_index_ - search_window_ : 0;
+    end = std::min(points.size(), last_index_ + search_window_ + 1);
+  }
+  size_t min_index = begin;
+  double min_sqr_dist = std::numeric_limits<double>::max();
+  for (size_t i = begin; i < end; ++i) {
+    const double dist = sqr_dist(i);
+    if (dist < min_sqr_dist) {
+      min_sqr_dist = dist;
+      min_index = i;
+    }
+  }
+  // the ego moved past the window, e.g. after a stall of the control loop
+  if (min_index == begin) {
+    while (min_index > 0 && sqr_dist(min_index - 1) < min_sqr_dist) {
+      min_sqr_dist = sqr_dist(--min_index);
+    }
+  }
+  if (min_index + 1 == end) {
+    while (min_index + 1 < points.size() && sqr_dist(min_index + 1) < min_sqr_dist) {
+      min_sqr_dist = sqr_dist(++min_index);
+    }
+  }
+  has_last_index_ = true;
+  last_index_ = min_index;
+  *index = min_index;
+  return true;
+}
+
+size_t TrajectoryMatcher::MatchByS(double s, const planning_msgs::Trajectory &trajectory, size_t start_index) {
+  const auto &points = trajectory.trajectory_points;
+  size_t i = std::min(start_index, points.size() - 1);
+  // the last point before s, or the first point
+  while (i + 1 < points.size() && points[i + 1].path_point.s < s) {
+    ++i;
+  }
+  while (i > 0 && points[i].path_point.s >= s) {
+    --i;
+  }
+  if (points[i].path_point.s >= s || i + 1 == points.size()) {
+    return i;
+  }
+  return s - points[i].path_point.s < points[i + 1].path_point.s - s ? i : i + 1;
+}
+
+}
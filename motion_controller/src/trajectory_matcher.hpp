@@ -0,0 +1,65 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_TRAJECTORY_MATCHER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_TRAJECTORY_MATCHER_HPP_
+#include <cstddef>
+#include <planning_msgs/Trajectory.h>
+#include "math/point_grid_index.hpp"
+
+namespace control {
+
+/**
+ * @brief: a received trajectory with the grid index of its points, built once on receipt off the control loop
+ */
+struct IndexedTrajectory {
+  explicit IndexedTrajectory(const planning_msgs::Trajectory::ConstPtr &trajectory);
+  planning_msgs::Trajectory::ConstPtr trajectory;
+  common::PointGridIndex point_index;
+};
+
+/**
+ * @brief: matches the ego to the trajectory point nearest to it. the ego moves a few points at most between two
+ * control cycles, so the search only covers a window around the last matched point, and the whole trajectory once
+ * after every new trajectory.
+ */
+class TrajectoryMatcher {
+ public:
+  /**
+   * @param search_window: the points searched before and after the last matched point
+   */
+  explicit TrajectoryMatcher(size_t search_window = 20);
+
+  /**
+   * @brief: forget the last matched point, called when a new trajectory arrives
+   * @param point_index: the grid index of the points of the new trajectory for its first match, which scans all the
+   * points if nullptr. it has to outlive the matches until the next reset
+   */
+  void Reset(const common::PointGridIndex *point_index = nullptr) {
+    has_last_index_ = false;
+    point_index_ = point_index;
+  }
+
+  /**
+   * @brief: the index of the trajectory point nearest to (x, y). the search follows the distance downhill past the
+   * window, so a match on the window border is still the local minimum
+   * @return: false if the trajectory is empty
+   */
+  bool MatchByPosition(double x, double y, const planning_msgs::Trajectory &trajectory, size_t *index);
+
+  /**
+   * @brief: the index of the trajectory point whose s is nearest to s, walked from start_index, e.g. the lookahead
+   * point from the matched point
+   * @param s
+   * @param trajectory: not empty
+   * @param start_index
+   * @return
+   */
+  static size_t MatchByS(double s, const planning_msgs::Trajectory &trajectory, size_t start_index);
+
+ private:
+  size_t search_window_;
+  const common::PointGridIndex *point_index_ = nullptr;
+  bool has_last_index_ = false;
+  size_t last_index_ = 0;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_CONTROLLER_SRC_TRAJECTORY_MATCHER_HPP_
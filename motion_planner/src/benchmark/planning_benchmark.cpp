@@ -0,0 +1,225 @@
+/**
+ * the planning stages replayed on recorded scenes, one benchmark per stage and scene:
+ * rosrun motion_planner planning_benchmark [--benchmark_...] scene.bag[:time_offset] | captured.cycle ...
+ * the parameters are read from the parameter server as in the motion planner, so load the ones of the live run first.
+ */
+#include <benchmark/benchmark.h>
+#include <ros/ros.h>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "planning_scene.hpp"
+#include "collision_checker/collision_checker.hpp"
+#include "frenet_lattice_planner/frenet_lattice_planner.hpp"
+#include "obstacle_manager/predicted_footprint_table.hpp"
+#include "obstacle_manager/st_graph.hpp"
+#include "motion_planner.hpp"
+#include "profiler/stage_profiler.hpp"
+
+namespace planning {
+namespace {
+
+struct BenchmarkScene {
+  std::string name;
+  PlanningCycleInputs inputs;
+  std::array<double, 3> init_s{};
+  std::array<double, 3> init_d{};
+  // the optimal trajectory of the scene, what the collision checker is benchmarked on
+  planning_msgs::Trajectory optimal_trajectory;
+};
+
+std::unique_ptr<common::ThreadPool> thread_pool;
+
+std::shared_ptr<const PredictedFootprintTable> BuildFootprintTable(const BenchmarkScene &scene,
+                                                                   const PlanningParams &params) {
+  return std::make_shared<PredictedFootprintTable>(scene.inputs.obstacles, 0.0,
+                                                   params.max_lookahead_time + params.delta_t, params.delta_t,
+                                                   thread_pool.get());
+}
+
+void BM_ReferenceLineSmoother(benchmark::State &state, const BenchmarkScene *scene) {
+  const ReferenceLineConfig config = MotionPlanner::GetReferenceLineConfig();
+  const auto smoother = MakeReferenceLineSmoother(config);
+  for (auto _ : state) {
+    ReferenceLine ref_line = scene->inputs.raw_ref_line;
+    // every cycle a cold start, as after a new route
+    smoother->ResetWarmStart();
+    ref_line.SetSmoother(smoother);
+    benchmark::DoNotOptimize(ref_line.Smooth(config.reference_smooth_deviation_weight_,
+                                             config.reference_smooth_heading_weight_,
+                                             config.reference_smooth_length_weight_,
+                                             config.reference_smooth_slack_weight_,
+                                             config.reference_smooth_max_curvature_));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_STGraph(benchmark::State &state, const BenchmarkScene *scene) {
+  PlanningParams params = PlanningConfig::Instance().Snapshot();
+  params.vehicle_params = scene->inputs.vehicle_params;
+  const auto footprint_table = BuildFootprintTable(*scene, params);
+  const auto &ref_lane = scene->inputs.planning_targets.front().ref_lane;
+  for (auto _ : state) {
+    STGraph st_graph(scene->inputs.obstacles, ref_lane,
+                     scene->init_s[0], scene->init_s[0] + params.max_lookahead_distance,
+                     0.0, params.max_lookahead_time,
+                     scene->init_d,
+                     params.max_lookahead_time, params.delta_t,
+                     footprint_table, thread_pool.get());
+    benchmark::DoNotOptimize(st_graph.GetObstaclesSTBoundary().data());
+  }
+  state.counters["obstacles"] = static_cast<double>(scene->inputs.obstacles.size());
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_CollisionChecker(benchmark::State &state, const BenchmarkScene *scene) {
+  if (scene->optimal_trajectory.trajectory_points.empty()) {
+    state.SkipWithError("the planner found no trajectory in the scene");
+    return;
+  }
+  PlanningParams params = PlanningConfig::Instance().Snapshot();
+  params.vehicle_params = scene->inputs.vehicle_params;
+  const auto footprint_table = BuildFootprintTable(*scene, params);
+  const auto inflated_footprint_table = footprint_table->Inflate(params.lon_safety_buffer, params.lat_safety_buffer);
+  const auto &ref_lane = scene->inputs.planning_targets.front().ref_lane;
+  const auto st_graph = std::make_shared<STGraph>(scene->inputs.obstacles, ref_lane,
+                                                  scene->init_s[0],
+                                                  scene->init_s[0] + params.max_lookahead_distance,
+                                                  0.0, params.max_lookahead_time,
+                                                  scene->init_d,
+                                                  params.max_lookahead_time, params.delta_t,
+                                                  footprint_table, thread_pool.get());
+  const CollisionChecker collision_checker(footprint_table, inflated_footprint_table, ref_lane, st_graph,
+                                           scene->init_s[0], scene->init_d[0], params.vehicle_params,
+                                           thread_pool.get(),
+                                           static_cast<size_t>(std::max(
+                                               1, PlanningConfig::Instance().collision_check_swept_steps())),
+                                           PlanningConfig::Instance().collision_check_polygon_footprints(),
+                                           PlanningConfig::Instance().collision_check_float_broad_phase(),
+                                           PlanningConfig::Instance().collision_check_float_guard_band());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(collision_checker.IsCollision(scene->optimal_trajectory));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FrenetLatticePlanner(benchmark::State &state, const BenchmarkScene *scene) {
+  common::StageProfiler stage_profiler;
+  bool is_planned = true;
+  for (auto _ : state) {
+    // a new planner every cycle, so neither the warm start nor the footprints carry over between the iterations
+    FrenetLatticePlanner planner(thread_pool.get(), &stage_profiler);
+    planner.set_vehicle_params(scene->inputs.vehicle_params);
+    planning_msgs::Trajectory optimal_trajectory;
+    is_planned = planner.Process(scene->inputs.obstacles, scene->inputs.init_trajectory_point,
+                                 scene->inputs.planning_targets, optimal_trajectory, nullptr) && is_planned;
+    benchmark::DoNotOptimize(optimal_trajectory.trajectory_points.data());
+  }
+  if (!is_planned) {
+    state.SkipWithError("the planner found no trajectory in the scene");
+    return;
+  }
+  // the throughput of every stage, in ms
+  for (const auto &stage : stage_profiler.GetStatistics()) {
+    state.counters[stage.name + "_p50_ms"] = stage.p50 * 1e3;
+    state.counters[stage.name + "_mean_ms"] = stage.mean * 1e3;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief: load the scene of argument, a cycle captured by the motion planner if it ends in .cycle, a bag file
+ * otherwise, optionally followed by :time_offset
+ */
+bool LoadBenchmarkScene(const std::string &argument, BenchmarkScene *scene) {
+  const std::string kCaptureExtension = ".cycle";
+  if (argument.size() > kCaptureExtension.size()
+      && argument.compare(argument.size() - kCaptureExtension.size(), kCaptureExtension.size(),
+                          kCaptureExtension) == 0) {
+    CapturedPlanningCycle cycle;
+    if (!ReadPlanningCycleCapture(argument, &cycle)) {
+      ROS_ERROR("[LoadBenchmarkScene], %s is no captured cycle", argument.c_str());
+      return false;
+    }
+    if (!BuildPlanningCycleInputs(cycle, thread_pool.get(), &scene->inputs)) {
+      return false;
+    }
+  } else {
+    std::string bag_file = argument;
+    double time_offset = -1.0;
+    const auto separator = argument.rfind(':');
+    if (separator != std::string::npos) {
+      try {
+        time_offset = std::stod(argument.substr(separator + 1));
+        bag_file = argument.substr(0, separator);
+      } catch (const std::exception &) {
+        time_offset = -1.0;
+      }
+    }
+    PlanningScene planning_scene;
+    if (!LoadPlanningScene(bag_file, time_offset, &planning_scene)) {
+      return false;
+    }
+    // the reference generator always smooths the reference lines
+    if (!BuildPlanningCycleInputs(planning_scene, true, thread_pool.get(), &scene->inputs)) {
+      return false;
+    }
+  }
+  scene->name = argument;
+  FrenetLatticePlanner::GetInitCondition(*scene->inputs.planning_targets.front().ref_lane,
+                                         scene->inputs.init_trajectory_point, &scene->init_s, &scene->init_d);
+  FrenetLatticePlanner planner(thread_pool.get());
+  planner.set_vehicle_params(scene->inputs.vehicle_params);
+  if (!planner.Process(scene->inputs.obstacles, scene->inputs.init_trajectory_point, scene->inputs.planning_targets,
+                       scene->optimal_trajectory, nullptr)) {
+    scene->optimal_trajectory.trajectory_points.clear();
+  }
+  return true;
+}
+
+}
+}
+
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "planning_benchmark", ros::init_options::NoSigintHandler | ros::init_options::AnonymousName);
+  ros::NodeHandle nh;
+  planning::PlanningConfig::Instance().UpdateParams(nh);
+  // the planner logs every cycle
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn)) {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+  benchmark::Initialize(&argc, argv);
+  if (argc < 2) {
+    std::cerr << "usage: planning_benchmark [--benchmark_...] scene.bag[:time_offset] | captured.cycle ..." << std::endl;
+    return 1;
+  }
+  planning::thread_pool = std::make_unique<common::ThreadPool>(
+      std::max(1, planning::PlanningConfig::Instance().planner_thread_pool_size()),
+      planning::PlanningConfig::Instance().planner_thread_options(), false);
+  std::vector<std::unique_ptr<planning::BenchmarkScene>> scenes;
+  for (int i = 1; i < argc; ++i) {
+    auto scene = std::make_unique<planning::BenchmarkScene>();
+    if (!planning::LoadBenchmarkScene(argv[i], scene.get())) {
+      std::cerr << "failed to load the scene " << argv[i] << std::endl;
+      return 1;
+    }
+    const planning::BenchmarkScene *ptr_scene = scene.get();
+    benchmark::RegisterBenchmark(("ReferenceLineSmoother/" + scene->name).c_str(),
+                                 planning::BM_ReferenceLineSmoother, ptr_scene)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("STGraph/" + scene->name).c_str(),
+                                 planning::BM_STGraph, ptr_scene)->Unit(benchmark::kMicrosecond)->UseRealTime();
+    benchmark::RegisterBenchmark(("CollisionChecker/" + scene->name).c_str(),
+                                 planning::BM_CollisionChecker, ptr_scene)->Unit(benchmark::kMicrosecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("FrenetLatticePlanner/" + scene->name).c_str(),
+                                 planning::BM_FrenetLatticePlanner, ptr_scene)->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    scenes.push_back(std::move(scene));
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  planning::thread_pool.reset();
+  ros::shutdown();
+  return 0;
+}
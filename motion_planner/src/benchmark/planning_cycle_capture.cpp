@@ -0,0 +1,227 @@
+#include "planning_cycle_capture.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <ros/serialization.h>
+#include <planning_msgs/Lane.h>
+
+namespace planning {
+namespace {
+
+constexpr uint32_t kCaptureMagic = 0x43594350; // "PCYC"
+constexpr uint32_t kCaptureVersion = 1;
+
+template<class T>
+void WritePod(const T &value, std::ostream *out) {
+  out->write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<class T>
+bool ReadPod(std::istream *in, T *value) {
+  return static_cast<bool>(in->read(reinterpret_cast<char *>(value), sizeof(T)));
+}
+
+/**
+ * @brief: the message in its ros serialization, prefixed by its length
+ */
+template<class Message>
+void WriteMessage(const Message &message, std::ostream *out) {
+  const uint32_t length = ros::serialization::serializationLength(message);
+  std::vector<uint8_t> buffer(length);
+  ros::serialization::OStream stream(buffer.data(), length);
+  ros::serialization::serialize(stream, message);
+  WritePod(length, out);
+  out->write(reinterpret_cast<const char *>(buffer.data()), length);
+}
+
+template<class Message>
+bool ReadMessage(std::istream *in, Message *message) {
+  uint32_t length = 0;
+  if (!ReadPod(in, &length)) {
+    return false;
+  }
+  std::vector<uint8_t> buffer(length);
+  if (!in->read(reinterpret_cast<char *>(buffer.data()), length)) {
+    return false;
+  }
+  ros::serialization::IStream stream(buffer.data(), length);
+  try {
+    ros::serialization::deserialize(stream, *message);
+  } catch (const ros::serialization::StreamOverrunException &) {
+    return false;
+  }
+  return true;
+}
+
+}
+
+bool WritePlanningCycleCapture(const PlanningCycleCapture &capture, const std::string &file) {
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return false;
+  }
+  WritePod(kCaptureMagic, &out);
+  WritePod(kCaptureVersion, &out);
+  WritePod(capture.stamp.sec, &out);
+  WritePod(capture.stamp.nsec, &out);
+  WritePod(capture.latency, &out);
+  WritePod(capture.trigger, &out);
+  WritePod(capture.vehicle_params, &out);
+  WriteMessage(capture.init_trajectory_point, &out);
+
+  WritePod(static_cast<uint32_t>(capture.planning_targets.size()), &out);
+  planning_msgs::Lane lane;
+  for (const auto &target : capture.planning_targets) {
+    WritePod(target.desired_vel, &out);
+    WritePod(static_cast<uint8_t>(target.is_best_behaviour), &out);
+    WritePod(static_cast<uint8_t>(target.has_stop_point), &out);
+    WritePod(target.stop_s, &out);
+    WritePod(static_cast<uint8_t>(target.ref_lane != nullptr && target.ref_lane->IsSmoothedReferenceLine()), &out);
+    lane.way_points = target.ref_lane != nullptr ? target.ref_lane->way_points()
+                                                 : std::vector<planning_msgs::WayPoint>();
+    WriteMessage(lane, &out);
+  }
+
+  // the obstacles whose source is no longer in the world are left out
+  std::vector<std::pair<const Obstacle *, uint8_t>> key_obstacles;
+  key_obstacles.reserve(capture.obstacles.size());
+  for (const auto &obstacle : capture.obstacles) {
+    if (obstacle->IsVirtual()) {
+      if (capture.traffic_lights_info_list != nullptr && capture.traffic_light_status_list != nullptr
+          && capture.traffic_lights_info_list->count(obstacle->Id()) > 0
+          && capture.traffic_light_status_list->count(obstacle->Id()) > 0) {
+        key_obstacles.emplace_back(obstacle.get(), 1);
+      }
+    } else if (capture.objects != nullptr && capture.objects->count(obstacle->Id()) > 0) {
+      key_obstacles.emplace_back(obstacle.get(), 0);
+    }
+  }
+  WritePod(static_cast<uint32_t>(key_obstacles.size()), &out);
+  for (const auto &key_obstacle : key_obstacles) {
+    const Obstacle &obstacle = *key_obstacle.first;
+    WritePod(key_obstacle.second, &out);
+    if (key_obstacle.second == 1) {
+      WriteMessage(capture.traffic_lights_info_list->at(obstacle.Id()), &out);
+      WriteMessage(capture.traffic_light_status_list->at(obstacle.Id()), &out);
+    } else {
+      WriteMessage(capture.objects->at(obstacle.Id()), &out);
+    }
+    WriteMessage(obstacle.GetPredictedTrajectory(), &out);
+  }
+  return static_cast<bool>(out);
+}
+
+bool ReadPlanningCycleCapture(const std::string &file, CapturedPlanningCycle *cycle) {
+  std::ifstream in(file, std::ios::binary);
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  if (!in || !ReadPod(&in, &magic) || !ReadPod(&in, &version) || magic != kCaptureMagic
+      || version != kCaptureVersion) {
+    return false;
+  }
+  if (!ReadPod(&in, &cycle->stamp.sec) || !ReadPod(&in, &cycle->stamp.nsec) || !ReadPod(&in, &cycle->latency)
+      || !ReadPod(&in, &cycle->trigger) || !ReadPod(&in, &cycle->vehicle_params)
+      || !ReadMessage(&in, &cycle->init_trajectory_point)) {
+    return false;
+  }
+
+  uint32_t num_targets = 0;
+  if (!ReadPod(&in, &num_targets)) {
+    return false;
+  }
+  cycle->targets.resize(num_targets);
+  planning_msgs::Lane lane;
+  for (auto &target : cycle->targets) {
+    uint8_t is_best_behaviour = 0;
+    uint8_t has_stop_point = 0;
+    uint8_t is_smoothed = 0;
+    if (!ReadPod(&in, &target.desired_vel) || !ReadPod(&in, &is_best_behaviour) || !ReadPod(&in, &has_stop_point)
+        || !ReadPod(&in, &target.stop_s) || !ReadPod(&in, &is_smoothed) || !ReadMessage(&in, &lane)) {
+      return false;
+    }
+    target.is_best_behaviour = is_best_behaviour != 0;
+    target.has_stop_point = has_stop_point != 0;
+    target.is_smoothed = is_smoothed != 0;
+    target.way_points = std::move(lane.way_points);
+  }
+
+  uint32_t num_obstacles = 0;
+  if (!ReadPod(&in, &num_obstacles)) {
+    return false;
+  }
+  cycle->obstacles.resize(num_obstacles);
+  for (auto &obstacle : cycle->obstacles) {
+    uint8_t is_traffic_light = 0;
+    if (!ReadPod(&in, &is_traffic_light)) {
+      return false;
+    }
+    obstacle.is_traffic_light = is_traffic_light != 0;
+    const bool has_source = obstacle.is_traffic_light
+                            ? ReadMessage(&in, &obstacle.traffic_light_info)
+                                && ReadMessage(&in, &obstacle.traffic_light_status)
+                            : ReadMessage(&in, &obstacle.object);
+    if (!has_source || !ReadMessage(&in, &obstacle.prediction)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/********************************** PlanningCycleRecorder ******************************/
+PlanningCycleRecorder::PlanningCycleRecorder(std::string directory, size_t buffer_size)
+    : directory_(std::move(directory)), ring_(std::max<size_t>(1, buffer_size)) {
+  write_thread_ = std::thread(&PlanningCycleRecorder::WriteThread, this);
+}
+
+PlanningCycleRecorder::~PlanningCycleRecorder() {
+  {
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    is_stop_ = true;
+  }
+  cv_.notify_one();
+  if (write_thread_.joinable()) {
+    write_thread_.join();
+  }
+}
+
+bool PlanningCycleRecorder::Push(std::shared_ptr<const PlanningCycleCapture> capture) {
+  {
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    if (size_ == ring_.size()) {
+      ++num_dropped_;
+      return false;
+    }
+    ring_[(head_ + size_) % ring_.size()] = std::move(capture);
+    ++size_;
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void PlanningCycleRecorder::WriteThread() {
+  while (true) {
+    std::shared_ptr<const PlanningCycleCapture> capture;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return is_stop_ || size_ > 0; });
+      // the captures still waiting are written before stopping
+      if (size_ == 0) {
+        return;
+      }
+      capture = std::move(ring_[head_]);
+      head_ = (head_ + 1) % ring_.size();
+      --size_;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "planning_cycle_%u.%09u.cycle", capture->stamp.sec, capture->stamp.nsec);
+    const std::string file = directory_ + "/" + name;
+    if (!WritePlanningCycleCapture(*capture, file)) {
+      ROS_WARN("[PlanningCycleRecorder::WriteThread], failed to write %s", file.c_str());
+    } else {
+      ROS_INFO("[PlanningCycleRecorder::WriteThread], captured the cycle of %lf s in %s", capture->latency,
+               file.c_str());
+    }
+  }
+}
+
+}
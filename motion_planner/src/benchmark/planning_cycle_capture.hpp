@@ -0,0 +1,137 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_CYCLE_CAPTURE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_CYCLE_CAPTURE_HPP_
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <derived_object_msgs/ObjectArray.h>
+#include <carla_msgs/CarlaTrafficLightStatusList.h>
+#include <carla_msgs/CarlaTrafficLightInfoList.h>
+#include <planning_msgs/Trajectory.h>
+#include <planning_msgs/TrajectoryPoint.h>
+#include <planning_msgs/WayPoint.h>
+#include "obstacle_manager/obstacle.hpp"
+#include "vehicle_state/vehicle_params.hpp"
+#include "planning_config.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the inputs of a planning cycle as the motion planner hands them to the recorder. it only shares what the
+ * cycle built, the recorder thread serializes it, so capturing costs the cycle no copies of the reference lines,
+ * obstacles or world
+ */
+struct PlanningCycleCapture {
+  enum Trigger : uint8_t {
+    kSlowCycle = 1,
+    kEmergencyStop = 2
+  };
+  ros::Time stamp;
+  // the steady clock time from the start of the cycle to the capture, in s
+  double latency = 0.0;
+  uint8_t trigger = 0;
+  vehicle_state::VehicleParams vehicle_params{};
+  planning_msgs::TrajectoryPoint init_trajectory_point;
+  std::vector<PlanningTarget> planning_targets;
+  std::vector<std::shared_ptr<Obstacle>> obstacles;
+  // the world the key obstacles were built from, to look their sources up
+  std::shared_ptr<const std::unordered_map<int, derived_object_msgs::Object>> objects;
+  std::shared_ptr<const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus>> traffic_light_status_list;
+  std::shared_ptr<const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo>> traffic_lights_info_list;
+};
+
+/**
+ * @brief: write the capture in the binary capture format: a header, the vehicle params, the init point, then every
+ * target with the way points of its reference line and every key obstacle with the message it was built from and
+ * its prediction. the messages are in their ros serialization.
+ * @param capture
+ * @param file
+ * @return: false if the file can't be written
+ */
+bool WritePlanningCycleCapture(const PlanningCycleCapture &capture, const std::string &file);
+
+/**
+ * @brief: a capture as read back from its file
+ */
+struct CapturedPlanningCycle {
+  struct Target {
+    double desired_vel = 0.0;
+    bool is_best_behaviour = false;
+    bool has_stop_point = false;
+    double stop_s = 0.0;
+    // whether the reference line was smoothed in the cycle, the way points are the raw ones either way
+    bool is_smoothed = false;
+    std::vector<planning_msgs::WayPoint> way_points;
+  };
+  struct KeyObstacle {
+    bool is_traffic_light = false;
+    // the actor the obstacle was built from, or the traffic light if is_traffic_light
+    derived_object_msgs::Object object;
+    carla_msgs::CarlaTrafficLightInfo traffic_light_info;
+    carla_msgs::CarlaTrafficLightStatus traffic_light_status;
+    planning_msgs::Trajectory prediction;
+  };
+  ros::Time stamp;
+  double latency = 0.0;
+  uint8_t trigger = 0;
+  vehicle_state::VehicleParams vehicle_params{};
+  planning_msgs::TrajectoryPoint init_trajectory_point;
+  std::vector<Target> targets;
+  std::vector<KeyObstacle> obstacles;
+};
+
+/**
+ * @brief: read a capture written by WritePlanningCycleCapture
+ * @param file
+ * @param cycle
+ * @return: false if the file can't be read or is no capture
+ */
+bool ReadPlanningCycleCapture(const std::string &file, CapturedPlanningCycle *cycle);
+
+/**
+ * @brief: writes the captures to a directory on its own thread. they wait in a ring buffer, which drops the new
+ * captures while it is full rather than ever holding the planning cycle up
+ */
+class PlanningCycleRecorder {
+ public:
+  /**
+   * @param directory: the captures are written as planning_cycle_<stamp>.cycle in it
+   * @param buffer_size: the captures waiting to be written
+   */
+  PlanningCycleRecorder(std::string directory, size_t buffer_size);
+  ~PlanningCycleRecorder();
+
+  PlanningCycleRecorder(const PlanningCycleRecorder &) = delete;
+  PlanningCycleRecorder &operator=(const PlanningCycleRecorder &) = delete;
+
+  /**
+   * @brief: queue the capture for writing, called from the planning cycle
+   * @return: false if the buffer is full and the capture is dropped
+   */
+  bool Push(std::shared_ptr<const PlanningCycleCapture> capture);
+
+  size_t num_dropped() const { return num_dropped_; }
+
+ private:
+  void WriteThread();
+
+ private:
+  std::string directory_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // a ring of size_ captures from head_
+  std::vector<std::shared_ptr<const PlanningCycleCapture>> ring_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  bool is_stop_ = false;
+  std::atomic<size_t> num_dropped_{0};
+  std::thread write_thread_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_CYCLE_CAPTURE_HPP_
@@ -0,0 +1,210 @@
+#include "planning_scene.hpp"
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include "name/string_name.hpp"
+#include "motion_planner.hpp"
+#include "vehicle_state/vehicle_state.hpp"
+
+namespace planning {
+
+bool LoadPlanningScene(const std::string &bag_file, double time_offset, PlanningScene *scene) {
+  rosbag::Bag bag;
+  try {
+    bag.open(bag_file, rosbag::bagmode::Read);
+  } catch (const rosbag::BagException &e) {
+    ROS_ERROR("[LoadPlanningScene], failed to open %s: %s", bag_file.c_str(), e.what());
+    return false;
+  }
+  const std::vector<std::string> topics{common::topic::kEgoVehicleStatusName,
+                                        common::topic::kEgoVehicleInfoName,
+                                        common::topic::kObjectsName,
+                                        common::topic::kTrafficLigthsStatusName,
+                                        common::topic::kTrafficLightsInfoName,
+                                        common::topic::kPlanningRouteName};
+  ros::Time end_time = ros::TIME_MAX;
+  if (time_offset >= 0.0) {
+    rosbag::View bag_view(bag);
+    end_time = bag_view.getBeginTime() + ros::Duration(time_offset);
+  }
+  bool has_ego_vehicle_status = false;
+  bool has_ego_vehicle_info = false;
+  bool has_objects = false;
+  bool has_route = false;
+  // the messages are replayed in order, so every topic ends at its last message before end_time as in the subscribers
+  rosbag::View view(bag, rosbag::TopicQuery(topics), ros::TIME_MIN, end_time);
+  for (const rosbag::MessageInstance &message : view) {
+    const std::string &topic = message.getTopic();
+    if (topic == common::topic::kEgoVehicleStatusName) {
+      const auto status = message.instantiate<carla_msgs::CarlaEgoVehicleStatus>();
+      if (status != nullptr) {
+        scene->ego_vehicle_status = *status;
+        has_ego_vehicle_status = true;
+      }
+    } else if (topic == common::topic::kEgoVehicleInfoName) {
+      const auto info = message.instantiate<carla_msgs::CarlaEgoVehicleInfo>();
+      if (info != nullptr) {
+        scene->ego_vehicle_info = *info;
+        has_ego_vehicle_info = true;
+      }
+    } else if (topic == common::topic::kObjectsName) {
+      const auto object_array = message.instantiate<derived_object_msgs::ObjectArray>();
+      if (object_array != nullptr) {
+        scene->objects.clear();
+        for (const auto &object : object_array->objects) {
+          scene->objects.emplace(object.id, object);
+        }
+        has_objects = true;
+      }
+    } else if (topic == common::topic::kTrafficLigthsStatusName) {
+      const auto status_list = message.instantiate<carla_msgs::CarlaTrafficLightStatusList>();
+      if (status_list != nullptr) {
+        scene->traffic_light_status_list.clear();
+        for (const auto &traffic_light_status : status_list->traffic_lights) {
+          scene->traffic_light_status_list.emplace(traffic_light_status.id, traffic_light_status);
+        }
+      }
+    } else if (topic == common::topic::kTrafficLightsInfoName) {
+      const auto info_list = message.instantiate<carla_msgs::CarlaTrafficLightInfoList>();
+      if (info_list != nullptr) {
+        scene->traffic_lights_info_list.clear();
+        for (const auto &traffic_light_info : info_list->traffic_lights) {
+          scene->traffic_lights_info_list.emplace(traffic_light_info.id, traffic_light_info);
+        }
+      }
+    } else if (topic == common::topic::kPlanningRouteName) {
+      const auto route = message.instantiate<planning_msgs::Lane>();
+      if (route != nullptr) {
+        scene->route = *route;
+        has_route = true;
+      }
+    }
+  }
+  bag.close();
+  if (!has_ego_vehicle_status || !has_ego_vehicle_info || !has_objects || !has_route) {
+    ROS_ERROR("[LoadPlanningScene], %s misses the ego vehicle status: %d, the ego vehicle info: %d, the objects: %d "
+              "or the route: %d", bag_file.c_str(), has_ego_vehicle_status, has_ego_vehicle_info, has_objects,
+              has_route);
+    return false;
+  }
+  return true;
+}
+
+bool BuildPlanningCycleInputs(const PlanningScene &scene, bool smooth_reference_line,
+                              common::ThreadPool *thread_pool, PlanningCycleInputs *inputs) {
+  const int ego_id = scene.ego_vehicle_info.id;
+  const auto ego_object = scene.objects.find(ego_id);
+  if (ego_object == scene.objects.end()) {
+    ROS_ERROR("[BuildPlanningCycleInputs], no ego vehicle %d in the scene", ego_id);
+    return false;
+  }
+  vehicle_state::VehicleState vehicle_state;
+  vehicle_state.Update(scene.ego_vehicle_status, scene.ego_vehicle_info, ego_object->second);
+  inputs->vehicle_params = vehicle_state.vehicle_params();
+  const auto &kino_dynamic_state = vehicle_state.GetKinoDynamicVehicleState();
+  const double planning_cycle_time = 1.0 / static_cast<double>(PlanningConfig::Instance().loop_rate());
+  inputs->init_trajectory_point =
+      MotionPlanner::ComputeReinitStitchingTrajectory(planning_cycle_time, kino_dynamic_state).back();
+
+  // the lookahead and lookback of the reference generator in MotionPlanner
+  constexpr double kLookaheadLength = 300.0;
+  constexpr double kLookbackLength = 30.0;
+  const ReferenceLineConfig config = MotionPlanner::GetReferenceLineConfig();
+  if (scene.route.way_points.empty()
+      || !ReferenceGenerator::RetriveReferenceLine(inputs->raw_ref_line, kino_dynamic_state, scene.route.way_points,
+                                                   kLookaheadLength, kLookbackLength, false, config)) {
+    ROS_ERROR("[BuildPlanningCycleInputs], the ego is not on the route");
+    return false;
+  }
+  inputs->ref_lines.clear();
+  if (smooth_reference_line) {
+    inputs->ref_lines.emplace_back();
+    if (!ReferenceGenerator::RetriveReferenceLine(inputs->ref_lines.back(), kino_dynamic_state,
+                                                  scene.route.way_points, kLookaheadLength, kLookbackLength,
+                                                  true, config, MakeReferenceLineSmoother(config))) {
+      return false;
+    }
+  } else {
+    inputs->ref_lines.push_back(inputs->raw_ref_line);
+  }
+  inputs->planning_targets = MotionPlanner::GetPlanningTargets(inputs->ref_lines, inputs->init_trajectory_point);
+  if (inputs->planning_targets.empty()) {
+    ROS_ERROR("[BuildPlanningCycleInputs], the init point is not on the reference line");
+    return false;
+  }
+  const TrafficLightRegistry traffic_lights(scene.traffic_lights_info_list);
+  inputs->obstacles = MotionPlanner::GetKeyObstacle(scene.objects, scene.traffic_light_status_list,
+                                                    traffic_lights, inputs->init_trajectory_point,
+                                                    ego_id, inputs->planning_targets, thread_pool);
+  return true;
+}
+
+bool BuildPlanningCycleInputs(const CapturedPlanningCycle &cycle, common::ThreadPool *thread_pool,
+                              PlanningCycleInputs *inputs) {
+  if (cycle.targets.empty()) {
+    ROS_ERROR("[BuildPlanningCycleInputs], the captured cycle has no planning targets");
+    return false;
+  }
+  inputs->vehicle_params = cycle.vehicle_params;
+  inputs->init_trajectory_point = cycle.init_trajectory_point;
+  const ReferenceLineConfig config = MotionPlanner::GetReferenceLineConfig();
+  inputs->ref_lines.clear();
+  inputs->planning_targets.clear();
+  for (const auto &captured_target : cycle.targets) {
+    if (captured_target.way_points.size() < 3) {
+      ROS_ERROR("[BuildPlanningCycleInputs], a captured reference line has too few way points");
+      return false;
+    }
+    ReferenceLine ref_line(captured_target.way_points);
+    if (inputs->ref_lines.empty()) {
+      inputs->raw_ref_line = ref_line;
+      inputs->raw_ref_line.BuildReferencePointTable(config.reference_point_table_resolution_);
+    }
+    if (captured_target.is_smoothed) {
+      ref_line.SetSmoother(MakeReferenceLineSmoother(config));
+      if (!ref_line.Smooth(config.reference_smooth_deviation_weight_,
+                           config.reference_smooth_heading_weight_,
+                           config.reference_smooth_length_weight_,
+                           config.reference_smooth_slack_weight_,
+                           config.reference_smooth_max_curvature_)) {
+        ROS_WARN("[BuildPlanningCycleInputs], failed to smooth a captured reference line again");
+      }
+    }
+    ref_line.BuildReferencePointTable(config.reference_point_table_resolution_);
+    inputs->ref_lines.push_back(ref_line);
+    PlanningTarget target;
+    target.ref_lane = std::make_shared<const ReferenceLine>(ref_line);
+    target.desired_vel = captured_target.desired_vel;
+    target.is_best_behaviour = captured_target.is_best_behaviour;
+    target.has_stop_point = captured_target.has_stop_point;
+    target.stop_s = captured_target.stop_s;
+    inputs->planning_targets.push_back(target);
+  }
+  inputs->obstacles.resize(cycle.obstacles.size());
+  auto predict = [&](size_t i) {
+    const auto &key_obstacle = cycle.obstacles[i];
+    auto obstacle = key_obstacle.is_traffic_light
+                    ? std::make_shared<Obstacle>(key_obstacle.traffic_light_info, key_obstacle.traffic_light_status)
+                    : std::make_shared<Obstacle>(key_obstacle.object);
+    obstacle->PredictTrajectory(PlanningConfig::Instance().max_lookahead_time(),
+                                PlanningConfig::Instance().delta_t());
+    inputs->obstacles[i] = std::move(obstacle);
+  };
+  if (thread_pool != nullptr) {
+    thread_pool->ParallelFor(0, inputs->obstacles.size(), 1, predict);
+  } else {
+    for (size_t i = 0; i < inputs->obstacles.size(); ++i) {
+      predict(i);
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<ReferenceLineSmoother> MakeReferenceLineSmoother(const ReferenceLineConfig &config) {
+  auto smoother = std::make_shared<ReferenceLineSmoother>();
+  smoother->SetIncrementalParams(config.reference_smooth_incremental_, config.reference_smooth_blend_points_);
+  smoother->SetBackend(config.reference_smooth_backend_);
+  smoother->SetCachedTape(config.reference_smooth_cached_tape_);
+  return smoother;
+}
+
+}
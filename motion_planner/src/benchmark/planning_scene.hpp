@@ -0,0 +1,92 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_SCENE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_SCENE_HPP_
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <derived_object_msgs/ObjectArray.h>
+#include <carla_msgs/CarlaEgoVehicleStatus.h>
+#include <carla_msgs/CarlaEgoVehicleInfo.h>
+#include <carla_msgs/CarlaTrafficLightStatusList.h>
+#include <carla_msgs/CarlaTrafficLightInfoList.h>
+#include <planning_msgs/Lane.h>
+#include <planning_msgs/TrajectoryPoint.h>
+#include "obstacle_manager/obstacle.hpp"
+#include "reference_line/reference_line.hpp"
+#include "reference_generator/reference_generator.hpp"
+#include "thread_pool/thread_pool.hpp"
+#include "vehicle_state/vehicle_params.hpp"
+#include "planning_config.hpp"
+#include "planning_cycle_capture.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the world of a planning cycle, the last messages on the topics the motion planner subscribes to and the
+ * route it published, read from a rosbag recorded on a live run, e.g.
+ * rosbag record /carla/objects /carla/traffic_lights /carla/traffic_lights_info /carla/ego_vehicle/vehicle_status
+ * /carla/ego_vehicle/vehicle_info /motion_planner/route
+ */
+struct PlanningScene {
+  carla_msgs::CarlaEgoVehicleStatus ego_vehicle_status;
+  carla_msgs::CarlaEgoVehicleInfo ego_vehicle_info;
+  std::unordered_map<int, derived_object_msgs::Object> objects;
+  std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus> traffic_light_status_list;
+  std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> traffic_lights_info_list;
+  planning_msgs::Lane route;
+};
+
+/**
+ * @brief: the inputs of the planning stages derived from a scene the way MotionPlanner::RunOnce derives them, with
+ * no history trajectory to stitch
+ */
+struct PlanningCycleInputs {
+  planning_msgs::TrajectoryPoint init_trajectory_point;
+  vehicle_state::VehicleParams vehicle_params;
+  // the main reference line of the route around the ego before the smoothing
+  ReferenceLine raw_ref_line;
+  std::vector<ReferenceLine> ref_lines;
+  std::vector<PlanningTarget> planning_targets;
+  std::vector<std::shared_ptr<Obstacle>> obstacles;
+};
+
+/**
+ * @brief: read the scene at time_offset into the bag
+ * @param bag_file
+ * @param time_offset: seconds from the start of the bag, the messages after it are ignored, negative for the end
+ * @param scene
+ * @return: false if the bag can't be read or has no ego vehicle, objects or route up to time_offset
+ */
+bool LoadPlanningScene(const std::string &bag_file, double time_offset, PlanningScene *scene);
+
+/**
+ * @brief: the inputs of the planning stages, the vehicle params are also set in PlanningConfig as RunOnce does
+ * @param scene
+ * @param smooth_reference_line: smooth the main reference line as the reference generator does
+ * @param thread_pool: predicts the obstacles in parallel, sequential if nullptr
+ * @param inputs
+ * @return: false if the ego is not in the scene or not on the route
+ */
+bool BuildPlanningCycleInputs(const PlanningScene &scene, bool smooth_reference_line,
+                              common::ThreadPool *thread_pool, PlanningCycleInputs *inputs);
+
+/**
+ * @brief: the inputs of the planning stages of a captured cycle, the vehicle params are also set in PlanningConfig.
+ * the reference lines are smoothed again if they were smoothed in the cycle and the obstacles predicted again, so
+ * they take the same paths as in the cycle, the recorded predictions are only for inspecting the capture
+ * @param cycle
+ * @param thread_pool: predicts the obstacles in parallel, sequential if nullptr
+ * @param inputs
+ * @return: false if the cycle has no targets
+ */
+bool BuildPlanningCycleInputs(const CapturedPlanningCycle &cycle, common::ThreadPool *thread_pool,
+                              PlanningCycleInputs *inputs);
+
+/**
+ * @brief: a smoother set up like the ones of the reference generator
+ * @param config
+ * @return
+ */
+std::shared_ptr<ReferenceLineSmoother> MakeReferenceLineSmoother(const ReferenceLineConfig &config);
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_BENCHMARK_PLANNING_SCENE_HPP_
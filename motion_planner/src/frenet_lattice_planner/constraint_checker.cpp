@@ -6,42 +6,39 @@ namespace planning {
 bool ConstraintChecker::WithInRange(double value, double lower, double upper, double eps) {
   return value > lower - eps && value < upper + eps;
 }
-ConstraintChecker::Result ConstraintChecker::ValidTrajectory(const planning_msgs::Trajectory &trajectory) {
-  const double kMaxCheckRelativeTime = PlanningConfig::Instance().max_lookahead_time();
-  for (const auto &p : trajectory.trajectory_points) {
-    double t = p.relative_time;
+ConstraintChecker::Result ConstraintChecker::ValidTrajectory(const TrajectoryBuffer &trajectory,
+                                                             const PlanningParams &params) {
+  const double kMaxCheckRelativeTime = params.max_lookahead_time;
+  for (size_t i = 0; i < trajectory.Size(); ++i) {
+    double t = trajectory.RelativeTime(i);
     if (t < kMaxCheckRelativeTime) {
       break;
     }
-    double lon_v = p.vel;
-    if (!WithInRange(lon_v,
-                     PlanningConfig::Instance().min_lon_velocity(),
-                     PlanningConfig::Instance().max_lon_velocity())) {
+    double lon_v = trajectory.Vel(i);
+    if (!WithInRange(lon_v, params.min_lon_velocity, params.max_lon_velocity)) {
       return Result::LON_VELOCITY_OUT_OF_BOUND;
     }
-    double lon_a = p.acc;
-    if (!WithInRange(lon_a, PlanningConfig::Instance().min_lon_acc(), PlanningConfig::Instance().max_lon_acc())) {
+    double lon_a = trajectory.Acc(i);
+    if (!WithInRange(lon_a, params.min_lon_acc, params.max_lon_acc)) {
       return Result::LON_ACCELERATION_OUT_OF_BOUND;
     }
-    double kappa = p.path_point.kappa;
-    if (!WithInRange(kappa, PlanningConfig::Instance().min_kappa(), PlanningConfig::Instance().max_kappa())) {
+    double kappa = trajectory.Kappa(i);
+    if (!WithInRange(kappa, params.min_kappa, params.max_kappa)) {
       return Result::CURVATURE_OUT_OF_BOUND;
     }
   }
-  for (size_t i = 1; i < trajectory.trajectory_points.size(); ++i) {
-    const auto &p0 = trajectory.trajectory_points[i - 1];
-    const auto &p1 = trajectory.trajectory_points[i];
-    if (p1.relative_time > kMaxCheckRelativeTime) {
+  for (size_t i = 1; i < trajectory.Size(); ++i) {
+    if (trajectory.RelativeTime(i) > kMaxCheckRelativeTime) {
       break;
     }
-    double dt = p1.relative_time - p0.relative_time;
-    double d_lon_a = p1.acc - p0.acc;
+    double dt = trajectory.RelativeTime(i) - trajectory.RelativeTime(i - 1);
+    double d_lon_a = trajectory.Acc(i) - trajectory.Acc(i - 1);
     double lon_jerk = d_lon_a / dt;
-    if (!WithInRange(lon_jerk, PlanningConfig::Instance().min_lon_jerk(), PlanningConfig::Instance().max_lon_jerk())) {
+    if (!WithInRange(lon_jerk, params.min_lon_jerk, params.max_lon_jerk)) {
       return Result::LON_JERK_OUT_OF_BOUND;
     }
-    double lat_a = p1.vel * p1.vel * p1.path_point.kappa;
-    if (!WithInRange(lat_a, PlanningConfig::Instance().min_lat_acc(), PlanningConfig::Instance().max_lat_acc())) {
+    double lat_a = trajectory.Vel(i) * trajectory.Vel(i) * trajectory.Kappa(i);
+    if (!WithInRange(lat_a, params.min_lat_acc, params.max_lat_acc)) {
       return Result::LAT_ACCELERATION_OUT_OF_BOUND;
     }
   }
@@ -1,7 +1,8 @@
 
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_CONSTRAINT_CHECKER_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_CONSTRAINT_CHECKER_HPP_
-#include <planning_msgs/Trajectory.h>
+#include "frenet_lattice_planner/trajectory_buffer.hpp"
+#include "planning_config.hpp"
 namespace planning {
 class ConstraintChecker {
  public:
@@ -19,7 +20,7 @@ class ConstraintChecker {
   ~ConstraintChecker() = default;
 
   static bool WithInRange(double value, double lower, double upper, double eps = 1e-2);
-  static Result ValidTrajectory(const planning_msgs::Trajectory &trajectory);
+  static Result ValidTrajectory(const TrajectoryBuffer &trajectory, const PlanningParams &params);
 };
 
 }
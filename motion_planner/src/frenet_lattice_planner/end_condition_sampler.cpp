@@ -2,20 +2,69 @@
 #include <obstacle_manager/st_graph.hpp>
 #include "obstacle_manager/obstacle.hpp"
 #include "planning_config.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
 #include <utility>
 
 namespace planning {
 using namespace common;
 using State = std::array<double, 3>;
 using EndCondition = std::pair<std::array<double, 3>, double>;
+namespace {
+constexpr double kEpsilon = 1e-6;
+// the lat seeds are half the gap of the lat offset samples apart, and end no closer than the nearest ones
+constexpr double kLatSeedOffsetStep = 0.25;
+constexpr double kMinLatSeedDistance = 10.0;
+
+bool IsSampled(const std::vector<EndCondition> &end_conditions, double v, double t) {
+  return std::any_of(end_conditions.begin(), end_conditions.end(), [v, t](const EndCondition &end_condition) {
+    return std::fabs(end_condition.first[1] - v) < kEpsilon && std::fabs(end_condition.second - t) < kEpsilon;
+  });
+}
+
+/**
+ * @brief: the largest velocity gain within t, the acc rising from a0 by at most rise_jerk up to max_acc and falling
+ * back to zero at t by at most fall_jerk
+ * @return: -infinity if the acc cannot get back to zero by t
+ */
+double MaxVelocityGain(double a0, double max_acc, double rise_jerk, double fall_jerk, double t) {
+  if (a0 > fall_jerk * t + kEpsilon || a0 < -rise_jerk * t - kEpsilon) {
+    return -std::numeric_limits<double>::infinity();
+  }
+  // an acc already beyond its limit is no reason to prune, the trajectories of the cycle all start with it
+  max_acc = std::max(max_acc, a0);
+  const double peak_time = std::max(0.0, std::min(t, (fall_jerk * t - a0) / (rise_jerk + fall_jerk)));
+  const double peak_acc = a0 + rise_jerk * peak_time;
+  if (peak_acc <= max_acc) {
+    return a0 * peak_time + 0.5 * rise_jerk * peak_time * peak_time
+        + 0.5 * fall_jerk * (t - peak_time) * (t - peak_time);
+  }
+  const double rise_time = (max_acc - a0) / rise_jerk;
+  const double fall_time = max_acc / fall_jerk;
+  return 0.5 * (a0 + max_acc) * rise_time + max_acc * (t - rise_time - fall_time) + 0.5 * max_acc * fall_time;
+}
+
+struct GridCellHash {
+  size_t operator()(const std::array<long, 3> &cell) const {
+    size_t hash = std::hash<long>()(cell[0]);
+    hash = hash * 31 + std::hash<long>()(cell[1]);
+    return hash * 31 + std::hash<long>()(cell[2]);
+  }
+};
+}
+
 EndConditionSampler::EndConditionSampler(const std::array<double, 3> &init_s,
                                          const std::array<double, 3> &init_d,
-                                         const ReferenceLine &ref_line,
+                                         std::shared_ptr<const ReferenceLine> ref_line,
                                          const std::vector<std::shared_ptr<Obstacle>> &ptr_obstacles,
-                                         std::shared_ptr<STGraph> ptr_st_graph)
-    : init_s_(init_s),
+                                         std::shared_ptr<STGraph> ptr_st_graph,
+                                         const PlanningParams &params)
+    : params_(params),
+      init_s_(init_s),
       init_d_(init_d),
-      ref_line_(ref_line),
+      ref_line_(std::move(ref_line)),
       ptr_st_graph_(std::move(ptr_st_graph)) {
   for (const auto &obstacle : ptr_obstacles) {
     obstacles_.emplace(obstacle->Id(), obstacle);
@@ -24,13 +73,13 @@ EndConditionSampler::EndConditionSampler(const std::array<double, 3> &init_s,
 
 std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionForStopping(
     const double ref_stop_point) const {
-  constexpr size_t time_samples_num = 9;
-  std::array<double, time_samples_num> time_samples{};
+  const size_t time_samples_num = static_cast<size_t>(std::max(2, params_.lon_time_samples_num));
+  std::vector<double> time_samples(time_samples_num, 0.0);
   for (size_t i = 1; i < time_samples_num; ++i) {
     auto ratio = static_cast<double>(i) / static_cast<double>(time_samples_num - 1);
-    time_samples[i] = PlanningConfig::Instance().max_lookahead_time() * ratio;
+    time_samples[i] = params_.max_lookahead_time * ratio;
   }
-  time_samples[0] = PlanningConfig::Instance().min_lookahead_time();
+  time_samples[0] = params_.min_lookahead_time;
   std::vector<EndCondition> end_s_conditions;
   for (const auto &time : time_samples) {
     State end_s = {std::max(init_s_[0], ref_stop_point), 0.0, 0.0};
@@ -52,17 +101,107 @@ std::vector<EndCondition> EndConditionSampler::SampleLatEndCondition() {
   return end_d_conditions;
 }
 
+std::vector<EndCondition> EndConditionSampler::SampleLatEndConditionAroundSeed(const EndCondition &seed) {
+  std::vector<EndCondition> end_d_conditions;
+  const double end_s = std::max(kMinLatSeedDistance, seed.second);
+  for (const double d : {seed.first[0], seed.first[0] - kLatSeedOffsetStep, seed.first[0] + kLatSeedOffsetStep}) {
+    State end_d_state = {d, 0.0, 0.0};
+    end_d_conditions.emplace_back(end_d_state, end_s);
+  }
+  return end_d_conditions;
+}
+
 std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionForCruising(const double ref_target_vel) const {
-  constexpr int kVelSampleNum = 9;  // put  into PlanningConfig
-  constexpr int kTimeSampleNum = 9; // put into PlanningConfig
-  constexpr double vel_interval_step = 0.3; // put int PlanningConfig
-  std::array<double, kTimeSampleNum> time_samples{};
-
-  for (size_t i = 1; i < kTimeSampleNum; ++i) {
-    auto ratio = static_cast<double>(i) / static_cast<double>(kTimeSampleNum - 1);
-    time_samples[i] = PlanningConfig::Instance().max_lookahead_time() * ratio;
+  return SampleCruisingGrid(ref_target_vel,
+                            params_.lon_time_samples_num,
+                            params_.lon_vel_samples_num,
+                            params_.lon_vel_sample_step);
+}
+
+std::vector<EndCondition> EndConditionSampler::SampleCoarseLonEndConditionForCruising(
+    const double ref_target_vel) const {
+  return SampleCruisingGrid(ref_target_vel,
+                            params_.coarse_lon_time_samples_num,
+                            params_.coarse_lon_vel_samples_num,
+                            params_.lon_vel_sample_step);
+}
+
+std::vector<EndCondition> EndConditionSampler::RefineLonEndConditionForCruising(
+    const double ref_target_vel, const std::vector<EndCondition> &coarse_end_conditions) const {
+  const double min_time = params_.min_lookahead_time;
+  const double max_time = params_.max_lookahead_time;
+  const int coarse_time_samples_num = std::max(2, params_.coarse_lon_time_samples_num);
+  const int coarse_vel_samples_num = std::max(2, params_.coarse_lon_vel_samples_num);
+  const double vel_interval_step = params_.lon_vel_sample_step;
+  const double half_time_gap = 0.5 * max_time / static_cast<double>(coarse_time_samples_num - 1);
+  std::vector<EndCondition> end_s_conditions;
+  for (const auto &coarse_end_condition : coarse_end_conditions) {
+    const double coarse_time = coarse_end_condition.second;
+    const double coarse_vel = coarse_end_condition.first[1];
+    // the velocity gap of the coarse grid at the time of the cell
+    const double coarse_vel_gap = std::min(VUpper(coarse_time), ref_target_vel) - VLower(coarse_time);
+    const double coarse_vel_intervals_num = std::max(1.0, std::min(static_cast<double>(coarse_vel_samples_num - 2),
+                                                                   std::floor(coarse_vel_gap / vel_interval_step)));
+    const double half_vel_gap = 0.5 * std::max(vel_interval_step, coarse_vel_gap / coarse_vel_intervals_num);
+    for (const double time : {coarse_time - half_time_gap, coarse_time, coarse_time + half_time_gap}) {
+      if (time < min_time - kEpsilon || time > max_time + kEpsilon) {
+        continue;
+      }
+      const double v_upper = std::min(VUpper(time), ref_target_vel);
+      const double v_lower = VLower(time);
+      for (const double vel : {coarse_vel - half_vel_gap, coarse_vel, coarse_vel + half_vel_gap}) {
+        const double clamped_vel = std::max(v_lower, std::min(vel, v_upper));
+        if (IsSampled(end_s_conditions, clamped_vel, time) || IsSampled(coarse_end_conditions, clamped_vel, time)) {
+          continue;
+        }
+        State end_s = {0.0, clamped_vel, 0.0};
+        end_s_conditions.emplace_back(end_s, time);
+      }
+    }
+  }
+  return end_s_conditions;
+}
+
+std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionAroundSeed(
+    const double ref_target_vel, const EndCondition &seed) const {
+  const double min_time = params_.min_lookahead_time;
+  const double max_time = params_.max_lookahead_time;
+  const int time_samples_num = std::max(2, params_.lon_time_samples_num);
+  const double half_time_gap = 0.5 * max_time / static_cast<double>(time_samples_num - 1);
+  const double vel_step = params_.lon_vel_sample_step;
+  const double seed_time = std::max(min_time, std::min(seed.second, max_time));
+  const double seed_vel = seed.first[1];
+  std::vector<EndCondition> end_s_conditions;
+  for (const double time : {seed_time, seed_time - half_time_gap, seed_time + half_time_gap}) {
+    if (time < min_time - kEpsilon || time > max_time + kEpsilon) {
+      continue;
+    }
+    const double v_upper = std::min(VUpper(time), ref_target_vel);
+    const double v_lower = VLower(time);
+    for (const double vel : {seed_vel, seed_vel - vel_step, seed_vel + vel_step}) {
+      const double clamped_vel = std::max(v_lower, std::min(vel, v_upper));
+      if (IsSampled(end_s_conditions, clamped_vel, time)) {
+        continue;
+      }
+      State end_s = {0.0, clamped_vel, 0.0};
+      end_s_conditions.emplace_back(end_s, time);
+    }
   }
-  time_samples[0] = PlanningConfig::Instance().min_lookahead_time();
+  return end_s_conditions;
+}
+
+std::vector<EndCondition> EndConditionSampler::SampleCruisingGrid(double ref_target_vel,
+                                                                  int time_samples_num,
+                                                                  int vel_samples_num,
+                                                                  double vel_interval_step) const {
+  const size_t num_time_samples = static_cast<size_t>(std::max(2, time_samples_num));
+  std::vector<double> time_samples(num_time_samples, 0.0);
+
+  for (size_t i = 1; i < num_time_samples; ++i) {
+    auto ratio = static_cast<double>(i) / static_cast<double>(num_time_samples - 1);
+    time_samples[i] = params_.max_lookahead_time * ratio;
+  }
+  time_samples[0] = params_.min_lookahead_time;
   std::vector<EndCondition> end_s_conditions;
   for (const auto &time : time_samples) {
     double v_upper = std::min(VUpper(time), ref_target_vel);
@@ -74,7 +213,7 @@ std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionForCruising(
 
     double vel_gap = v_upper - v_lower;
     size_t vel_intervals_num =
-        std::min(static_cast<size_t>(kVelSampleNum - 2),
+        std::min(static_cast<size_t>(std::max(2, vel_samples_num) - 2),
                  static_cast<size_t>(vel_gap / vel_interval_step));
     if (vel_intervals_num > 0) {
       double vel_ratio = vel_gap / static_cast<double>(vel_intervals_num);
@@ -96,12 +235,12 @@ std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionForCruising(
 }
 
 double EndConditionSampler::VUpper(double t) const {
-  double comfortable_acc = PlanningConfig::Instance().max_lon_acc() * 0.9;
+  double comfortable_acc = params_.max_lon_acc * 0.9;
   return init_s_[1] + comfortable_acc * t;
 }
 
 double EndConditionSampler::VLower(double t) const {
-  double comfortable_decel = -PlanningConfig::Instance().min_lon_acc() * 0.9;
+  double comfortable_decel = -params_.min_lon_acc * 0.9;
   double t_at_zero_speed = init_s_[1] / (comfortable_decel);
   return t < t_at_zero_speed ?
          init_s_[1] - comfortable_decel * t :
@@ -109,13 +248,13 @@ double EndConditionSampler::VLower(double t) const {
 }
 
 double EndConditionSampler::SUpper(double t) const {
-  double comfortable_acc = PlanningConfig::Instance().max_lon_acc() * 0.9;
+  double comfortable_acc = params_.max_lon_acc * 0.9;
   return init_s_[0] + init_s_[1] * t +
       0.5 * comfortable_acc * t * t;
 }
 
 double EndConditionSampler::SLower(double t) const {
-  double comfortable_decel = -PlanningConfig::Instance().min_lon_acc() * 0.9;
+  double comfortable_decel = -params_.min_lon_acc * 0.9;
   const double t_at_zero_speed = init_s_[1] / (comfortable_decel);
   const double
       s_at_zero_speed = init_s_[0] + init_s_[1] * init_s_[1] / (2.0 * comfortable_decel);
@@ -123,7 +262,8 @@ double EndConditionSampler::SLower(double t) const {
                              : s_at_zero_speed;
 }
 
-std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionWithSTGraph() const {
+std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionWithSTGraph(
+    EndConditionPruningStatistics *statistics) const {
   std::vector<EndCondition> end_s_conditions;
   std::vector<std::pair<STPoint, double>> sample_points_follow;
   std::vector<std::pair<STPoint, double>> sample_points_overtake;
@@ -139,30 +279,25 @@ std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionWithSTGraph(
   }
 
   for (const auto &sample_point : sample_points) {
-    if (sample_point.first.t() < PlanningConfig::Instance().min_lookahead_time()) {
-      continue;
-    }
-    double s = sample_point.first.s();
-    double v = sample_point.second;
-    double t = sample_point.first.t();
-    if (s > SUpper(t) || s < SLower(t)) {
+    if (sample_point.first.t() < params_.min_lookahead_time) {
       continue;
     }
-    State end_state = {s, v, 0.0};
-    end_s_conditions.emplace_back(end_state, t);
+    State end_state = {sample_point.first.s(), sample_point.second, 0.0};
+    end_s_conditions.emplace_back(end_state, sample_point.first.t());
   }
+  PruneLonEndConditions(&end_s_conditions, statistics);
 #if DEBUG
   for (const auto &sample_point : sample_points_overtake) {
     std::cout << "overtake sample_point: s: " << sample_point.first.s() << ", t: " << sample_point.first.t() << ", v: "
               << sample_point.second << std::endl;
-    auto ref_point = ref_line_.GetReferencePoint(sample_point.first.s());
+    auto ref_point = ref_line_->GetReferencePoint(sample_point.first.s());
     std::cout << " overtake point in cartersian coordinate : x: " << ref_point.x() <<", y: " << ref_point.y() << std::endl;
   }
   std::cout << "----------------------------------" << std::endl;
   for (const auto &sample_point : sample_points_follow) {
     std::cout << "following sample_point: s: " << sample_point.first.s() << ", t: " << sample_point.first.t() << ", v: "
               << sample_point.second << std::endl;
-    auto ref_point = ref_line_.GetReferencePoint(sample_point.first.s());
+    auto ref_point = ref_line_->GetReferencePoint(sample_point.first.s());
     std::cout << " following point in cartersian coordinate : x: " << ref_point.x() <<", y: " << ref_point.y() << std::endl;
   }
 
@@ -178,17 +313,65 @@ std::vector<EndCondition> EndConditionSampler::SampleLonEndConditionWithSTGraph(
   return end_s_conditions;
 }
 
+void EndConditionSampler::PruneLonEndConditions(std::vector<EndCondition> *end_conditions,
+                                                EndConditionPruningStatistics *statistics) const {
+  EndConditionPruningStatistics pruning_statistics;
+  pruning_statistics.num_sampled = end_conditions->size();
+  const double s_resolution = params_.lon_end_condition_s_resolution;
+  const double v_resolution = params_.lon_end_condition_v_resolution;
+  const double t_resolution = params_.lon_end_condition_t_resolution;
+  const bool is_deduplicated = s_resolution > 0.0 && v_resolution > 0.0 && t_resolution > 0.0;
+  std::unordered_set<std::array<long, 3>, GridCellHash> cells;
+  cells.reserve(end_conditions->size());
+  size_t num_kept = 0;
+  for (const auto &end_condition : *end_conditions) {
+    const double s = end_condition.first[0];
+    const double v = end_condition.first[1];
+    const double t = end_condition.second;
+    if (!IsLonEndStateReachable(s, v, t)) {
+      ++pruning_statistics.num_infeasible;
+      continue;
+    }
+    if (is_deduplicated && !cells.insert({std::lround(s / s_resolution), std::lround(v / v_resolution),
+                                          std::lround(t / t_resolution)}).second) {
+      ++pruning_statistics.num_duplicates;
+      continue;
+    }
+    (*end_conditions)[num_kept++] = end_condition;
+  }
+  end_conditions->resize(num_kept);
+  if (statistics != nullptr) {
+    *statistics = pruning_statistics;
+  }
+}
+
+bool EndConditionSampler::IsLonEndStateReachable(double s, double v, double t) const {
+  if (s > SUpper(t) || s < SLower(t) || v < params_.min_lon_velocity || v > params_.max_lon_velocity) {
+    return false;
+  }
+  if (params_.max_lon_acc <= 0.0 || params_.min_lon_acc >= 0.0
+      || params_.max_lon_jerk <= 0.0 || params_.min_lon_jerk >= 0.0) {
+    return true;
+  }
+  // the speeding up and the slowing down case, the latter mirrored
+  const double a0 = init_s_[2];
+  const double delta_v = v - init_s_[1];
+  return delta_v <= MaxVelocityGain(a0, params_.max_lon_acc, params_.max_lon_jerk, -params_.min_lon_jerk, t) + kEpsilon
+      && -delta_v <= MaxVelocityGain(-a0, -params_.min_lon_acc, -params_.min_lon_jerk, params_.max_lon_jerk, t)
+          + kEpsilon;
+}
+
 std::vector<std::pair<STPoint, double>> EndConditionSampler::OvertakeSamplePoints(int obstacle_id) const {
   std::vector<std::pair<STPoint, double>> sample_points{};
   std::vector<STPoint> overtake_st_points = ptr_st_graph_->GetObstacleSurroundingPoints(
       obstacle_id, 1e-3, 0.2);
   for (const auto &st_point : overtake_st_points) {
-    double v = GetObstacleSpeedAlongReferenceLine(obstacle_id, st_point.s(), st_point.t(), ref_line_);
+    double v = GetObstacleSpeedAlongReferenceLine(obstacle_id, st_point.s(), st_point.t(), *ref_line_);
     std::pair<STPoint, double> sample_point;
     sample_point.first = st_point;
-    sample_point.first.set_s(st_point.s() + PlanningConfig::Instance().lon_safety_buffer()
-                                 + PlanningConfig::Instance().vehicle_params().half_length
-                                 - PlanningConfig::Instance().vehicle_params().back_axle_to_center_length);
+    sample_point.first.set_s(st_point.s() + params_.lon_safety_buffer
+                                 + params_.vehicle_params.half_length
+                                 - params_.vehicle_params.back_axle_to_center_length);
     sample_point.second = v;
     sample_points.push_back(sample_point);
   }
@@ -207,13 +390,13 @@ std::vector<std::pair<STPoint, double>> EndConditionSampler::FollowingSamplePoin
 //            << " back_to_center: " << PlanningConfig::Instance().vehicle_params().back_axle_to_center_length
 //            << " front_to_center: " << PlanningConfig::Instance().vehicle_params().front_axle_to_center_length << std::endl;
   for (const auto &st_point : follow_st_points) {
-    double v = GetObstacleSpeedAlongReferenceLine(obstacle_id, st_point.s(), st_point.t(), ref_line_);
-    double s_upper = st_point.s() - PlanningConfig::Instance().lon_safety_buffer()
-        - PlanningConfig::Instance().vehicle_params().half_length
-        - PlanningConfig::Instance().vehicle_params().back_axle_to_center_length;
-    double s_lower = s_upper - PlanningConfig::Instance().lon_safety_buffer();
+    double v = GetObstacleSpeedAlongReferenceLine(obstacle_id, st_point.s(), st_point.t(), *ref_line_);
+    double s_upper = st_point.s() - params_.lon_safety_buffer
+        - params_.vehicle_params.half_length
+        - params_.vehicle_params.back_axle_to_center_length;
+    double s_lower = s_upper - params_.lon_safety_buffer;
     double s_gap =
-        PlanningConfig::Instance().lon_safety_buffer() / static_cast<double>(num_sample_follow_per_timestamp - 1);
+        params_.lon_safety_buffer / static_cast<double>(num_sample_follow_per_timestamp - 1);
     for (size_t i = 0; i < num_sample_follow_per_timestamp; ++i) {
       double s = s_lower + s_gap * static_cast<double>(i);
       std::pair<STPoint, double> sample_point;
@@ -5,8 +5,18 @@
 #include "math/frenet_frame.hpp"
 #include "obstacle_manager/st_graph.hpp"
 #include "reference_line/reference_line.hpp"
+#include "planning_config.hpp"
 namespace planning {
 
+/**
+ * @brief: the lon end conditions of the st graph pruned before their polynomials are built
+ */
+struct EndConditionPruningStatistics {
+  size_t num_sampled = 0;
+  size_t num_duplicates = 0; // in the same cell of the (s, v, t) grid as an earlier one
+  size_t num_infeasible = 0; // out of reach from init_s under the velocity, acc and jerk limits
+};
+
 class EndConditionSampler {
  public:
 
@@ -16,9 +26,10 @@ class EndConditionSampler {
 
   EndConditionSampler(const std::array<double, 3> &init_s,
                       const std::array<double, 3> &init_d,
-                      const ReferenceLine &ref_line,
+                      std::shared_ptr<const ReferenceLine> ref_line,
                       const std::vector<std::shared_ptr<Obstacle>> &ptr_obstacles,
-                      std::shared_ptr<STGraph> ptr_st_graph);
+                      std::shared_ptr<STGraph> ptr_st_graph,
+                      const PlanningParams &params);
   /**
    *
    * @param ref_stop_point
@@ -36,10 +47,58 @@ class EndConditionSampler {
                         double>> SampleLonEndConditionForCruising(const double ref_target_vel) const;
 
   /**
-   *
+   * @brief: the cruising end conditions on the coarse grid of the coarse to fine sampling
+   * @param ref_target_vel
+   * @return
+   */
+  std::vector<std::pair<std::array<double, 3>,
+                        double>> SampleCoarseLonEndConditionForCruising(const double ref_target_vel) const;
+
+  /**
+   * @brief: the cruising end conditions half a coarse cell around each of the coarse ones, without the coarse ones
+   * @param ref_target_vel
+   * @param coarse_end_conditions: the best cells of SampleCoarseLonEndConditionForCruising
    * @return
    */
-  std::vector<std::pair<std::array<double, 3>, double>> SampleLonEndConditionWithSTGraph() const;
+  std::vector<std::pair<std::array<double, 3>, double>> RefineLonEndConditionForCruising(
+      const double ref_target_vel,
+      const std::vector<std::pair<std::array<double, 3>, double>> &coarse_end_conditions) const;
+
+  /**
+   * @brief: the cruising end conditions half a time gap and a velocity step of the dense grid around the seed
+   * @param ref_target_vel
+   * @param seed: the time-shifted end condition of the last optimal trajectory, its time is clamped to the horizon
+   * @return: the seed first
+   */
+  std::vector<std::pair<std::array<double, 3>, double>> SampleLonEndConditionAroundSeed(
+      const double ref_target_vel, const std::pair<std::array<double, 3>, double> &seed) const;
+
+  /**
+   * @brief: the following and overtaking end conditions of all the obstacles of the st graph, pruned
+   * @param statistics: [out] the counts of the pruned end conditions, may be nullptr
+   * @return
+   */
+  std::vector<std::pair<std::array<double, 3>, double>> SampleLonEndConditionWithSTGraph(
+      EndConditionPruningStatistics *statistics = nullptr) const;
+
+  /**
+   * @brief: drop the end conditions out of reach from init_s and the ones in the same cell of the (s, v, t) grid
+   * as an earlier one, the overlapping obstacles sample nearly the same states
+   * @param end_conditions: [in/out] the kept ones stay in their order
+   * @param statistics: [out] may be nullptr
+   */
+  void PruneLonEndConditions(std::vector<std::pair<std::array<double, 3>, double>> *end_conditions,
+                             EndConditionPruningStatistics *statistics) const;
+
+  /**
+   * @brief: whether the end state s, v with zero acc at t is reachable from init_s. the acc keeps within its limits,
+   * changes at most by the jerk limits and has to be back to zero at t, which bounds the velocity change
+   * @param s
+   * @param v
+   * @param t
+   * @return: false if every trajectory to the state breaks a limit of the constraint checker
+   */
+  bool IsLonEndStateReachable(double s, double v, double t) const;
 
   /**
    *
@@ -47,8 +106,35 @@ class EndConditionSampler {
    */
   static std::vector<std::pair<std::array<double, 3>, double>> SampleLatEndCondition() ;
 
+  /**
+   * @brief: the lat end conditions at the distance of the seed, at its offset and half the gap of
+   * the lat samples to either side
+   * @param seed: the end offset and distance of the last optimal trajectory on this reference line
+   * @return: the seed first
+   */
+  static std::vector<std::pair<std::array<double, 3>, double>> SampleLatEndConditionAroundSeed(
+      const std::pair<std::array<double, 3>, double> &seed);
+
+  /**
+   * @brief: the parameters of the planning cycle the sampler was built for
+   */
+  const PlanningParams &params() const { return params_; }
+
  private:
 
+  /**
+   * @brief: the cruising grid, the lower and upper velocity of every time sample and the velocities between them
+   * @param ref_target_vel
+   * @param time_samples_num
+   * @param vel_samples_num: at most this many velocities per time sample
+   * @param vel_interval_step: the smallest gap between the velocities
+   * @return
+   */
+  std::vector<std::pair<std::array<double, 3>, double>> SampleCruisingGrid(double ref_target_vel,
+                                                                           int time_samples_num,
+                                                                           int vel_samples_num,
+                                                                           double vel_interval_step) const;
+
   /**
    *
    * @param obstacle_id
@@ -103,9 +189,10 @@ class EndConditionSampler {
                                             const ReferenceLine &ref_line) const;
 
  private:
+  PlanningParams params_;
   std::array<double, 3> init_s_{};
   std::array<double, 3> init_d_{};
-  ReferenceLine ref_line_;
+  std::shared_ptr<const ReferenceLine> ref_line_;
   std::unordered_map<int, std::shared_ptr<Obstacle>> obstacles_;
   std::shared_ptr<STGraph> ptr_st_graph_;
 };
@@ -5,12 +5,16 @@
 #include "frenet_lattice_planner/end_condition_sampler.hpp"
 #include "math/coordinate_transformer.hpp"
 #include "frenet_lattice_planner/lattice_trajectory1d.hpp"
+#include "frenet_lattice_planner/speed_optimizer.hpp"
 #include "collision_checker/collision_checker.hpp"
+#include <algorithm>
+#include <atomic>
 
 namespace planning {
 using namespace common;
 
-FrenetLatticePlanner::FrenetLatticePlanner(ThreadPool *thread_pool) : thread_pool_(thread_pool) {}
+FrenetLatticePlanner::FrenetLatticePlanner(ThreadPool *thread_pool, StageProfiler *stage_profiler)
+    : thread_pool_(thread_pool), stage_profiler_(stage_profiler) {}
 
 bool FrenetLatticePlanner::Process(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
                                    const planning_msgs::TrajectoryPoint &init_trajectory_point,
@@ -18,60 +22,181 @@ bool FrenetLatticePlanner::Process(const std::vector<std::shared_ptr<Obstacle>>
                                    planning_msgs::Trajectory &pub_trajectory,
                                    std::vector<planning_msgs::Trajectory> *valid_trajectories) {
   obstacles_.assign(obstacles.begin(), obstacles.end());
+  is_deadline_missed_ = false;
 
   if (planning_targets.empty()) {
     ROS_FATAL("[FrenetLatticePlanner::Process]: ******No planning_targets provided*********");
     return false;
   }
+  // every stage and thread of the cycle reads the same parameters
+  const PlanningParams params = CycleParams();
+  // the footprints are the same on every reference line, build them once for the st graphs and collision checkers
+  const ros::Time now = ros::Time::now();
+  ScopedStageTimer footprint_timer(stage_profiler_, "footprints");
+  UpdateFootprintTables(params, now);
+  footprint_timer.Stop();
+  if (warm_start_seed_.is_valid) {
+    // the seed keeps ending at the same time, a stale one has no overlap with the horizon left
+    warm_start_seed_.lon_end_time -= (now - warm_start_seed_.stamp).toSec();
+    warm_start_seed_.stamp = now;
+    warm_start_seed_.is_valid = warm_start_seed_.lon_end_time > 0.0;
+  }
   ROS_INFO("[FrenetLatticePlanner::Process], the targets size: %zu", planning_targets.size());
   constexpr double kDefaultNonBestBehaviourCost = 100.0;
-  size_t index = 0;
-  size_t failed_ref_plan_num = 0;;
-  std::vector<std::pair<planning_msgs::Trajectory, double>> optimal_trajectories;
-  for (const auto &planning_target : planning_targets) {
-    std::pair<planning_msgs::Trajectory, double> optimal_trajectory;
-    auto result = PlanningOnRef(init_trajectory_point, planning_target, optimal_trajectory, valid_trajectories);
-    if (!result) {
-      ROS_FATAL("[FrenetLatticePlanner::Process], failed plan on reference line: %zu", index);
+  const size_t num_targets = planning_targets.size();
+  // one slot per target, so the results keep the target order whether they are planned serially or in parallel
+  std::vector<std::pair<planning_msgs::Trajectory, double>> optimal_trajectories(num_targets);
+  std::vector<std::vector<planning_msgs::Trajectory>> valid_trajectories_on_ref(num_targets);
+  std::vector<WarmStartSeed> optimal_seeds(num_targets);
+  std::vector<char> plan_results(num_targets, 0);
+  const int arena_block_size = PlanningConfig::Instance().planning_arena_block_size();
+  if (arena_block_size <= 0) {
+    arenas_.clear();
+  }
+  while (arena_block_size > 0 && arenas_.size() < num_targets) {
+    arenas_.push_back(std::make_unique<MonotonicArena>(static_cast<size_t>(arena_block_size)));
+  }
+  const auto target_arena = [this](size_t i) -> MonotonicArena * {
+    return i < arenas_.size() ? arenas_[i].get() : nullptr;
+  };
+  while (lateral_optimizers_.size() < num_targets) {
+    lateral_optimizers_.push_back(std::make_unique<LateralPathOptimizer>());
+  }
+  if (thread_pool_ != nullptr && num_targets > 1
+      && PlanningConfig::Instance().parallel_planning_on_reference_lines()) {
+    // the nested ParallelFor of every target help with the queued tasks while they wait, so they share the pool
+    thread_pool_->ParallelFor(0, num_targets, 1, [&](size_t i) {
+      plan_results[i] = PlanningOnRef(init_trajectory_point, planning_targets[i], params, thread_pool_,
+                                      target_arena(i), lateral_optimizers_[i].get(), optimal_trajectories[i],
+                                      &optimal_seeds[i],
+                                      valid_trajectories == nullptr ? nullptr : &valid_trajectories_on_ref[i]);
+    });
+  } else {
+    for (size_t i = 0; i < num_targets; ++i) {
+      plan_results[i] = PlanningOnRef(init_trajectory_point, planning_targets[i], params, thread_pool_,
+                                      target_arena(i), lateral_optimizers_[i].get(), optimal_trajectories[i],
+                                      &optimal_seeds[i],
+                                      valid_trajectories == nullptr ? nullptr : &valid_trajectories_on_ref[i]);
+    }
+  }
+  // the temporaries of every target are gone with its PlanningOnRef, release them wholesale
+  for (auto &arena : arenas_) {
+    arena->Reset();
+  }
+  size_t failed_ref_plan_num = 0;
+  for (size_t i = 0; i < num_targets; ++i) {
+    if (!plan_results[i]) {
+      ROS_FATAL("[FrenetLatticePlanner::Process], failed plan on reference line: %zu", i);
       failed_ref_plan_num++;
     }
-    ++index;
-    if (!planning_target.is_best_behaviour) {
-      optimal_trajectory.second += kDefaultNonBestBehaviourCost;
+    if (!planning_targets[i].is_best_behaviour) {
+      optimal_trajectories[i].second += kDefaultNonBestBehaviourCost;
+    }
+    if (valid_trajectories != nullptr) {
+      valid_trajectories->insert(valid_trajectories->end(),
+                                 valid_trajectories_on_ref[i].begin(),
+                                 valid_trajectories_on_ref[i].end());
     }
-    optimal_trajectories.push_back(optimal_trajectory);
   }
   if (failed_ref_plan_num >= planning_targets.size()) {
     ROS_FATAL("[FrenetLatticePlanner::Process], the process is failed on every reference line");
+    warm_start_seed_.is_valid = false;
     return false;
   }
-  std::sort(optimal_trajectories.begin(), optimal_trajectories.end(),
-            [](const std::pair<planning_msgs::Trajectory, double> &p0,
-               const std::pair<planning_msgs::Trajectory, double> &p1) -> bool {
-              return p0.second < p1.second;
-            });
-
-  pub_trajectory = std::move(optimal_trajectories.front().first);
+  // the first of the lowest cost, so that cost ties resolve by target order
+  const size_t optimal_index = static_cast<size_t>(std::distance(
+      optimal_trajectories.begin(),
+      std::min_element(optimal_trajectories.begin(), optimal_trajectories.end(),
+                       [](const std::pair<planning_msgs::Trajectory, double> &p0,
+                          const std::pair<planning_msgs::Trajectory, double> &p1) -> bool {
+                         return p0.second < p1.second;
+                       })));
+  warm_start_seed_ = optimal_seeds[optimal_index];
+  warm_start_seed_.stamp = now;
+  pub_trajectory = std::move(optimal_trajectories[optimal_index].first);
   return true;
 }
 
+bool FrenetLatticePlanner::IsTrajectoryValid(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                             const planning_msgs::Trajectory &trajectory) {
+  if (trajectory.trajectory_points.empty()) {
+    return false;
+  }
+  obstacles_.assign(obstacles.begin(), obstacles.end());
+  const PlanningParams params = CycleParams();
+  ScopedStageTimer footprint_timer(stage_profiler_, "footprints");
+  UpdateFootprintTables(params, ros::Time::now());
+  footprint_timer.Stop();
+  ScopedStageTimer validation_timer(stage_profiler_, "revalidation");
+  TrajectoryBuffer buffer;
+  buffer.Clear(trajectory.trajectory_points.size());
+  for (const auto &tp : trajectory.trajectory_points) {
+    buffer.Append(tp.path_point.x, tp.path_point.y, tp.path_point.theta, tp.path_point.kappa, tp.path_point.s,
+                  tp.vel, tp.acc, tp.relative_time);
+  }
+  if (ConstraintChecker::ValidTrajectory(buffer, params) != ConstraintChecker::Result::VALID) {
+    return false;
+  }
+  // the candidates are accepted against the inflated footprints, so is the kept trajectory
+  return !CollisionChecker::IsCollision(*inflated_footprint_table_, trajectory,
+                                        params.vehicle_params.length, params.vehicle_params.width,
+                                        params.vehicle_params.back_axle_to_center_length);
+}
+
+void FrenetLatticePlanner::UpdateFootprintTables(const PlanningParams &params, const ros::Time &now) {
+  const double delta_t = params.delta_t;
+  if (!params.sample_times.empty()) {
+    // the steps of the candidates are the steps of the table, a shift by whole steps does not map an uneven grid
+    // onto itself, so nothing is reused
+    footprint_table_ = std::make_shared<PredictedFootprintTable>(obstacles_, params.sample_times, thread_pool_);
+  } else if (PlanningConfig::Instance().incremental_footprint_update() && footprint_table_ != nullptr) {
+    FootprintReuseBounds reuse_bounds;
+    reuse_bounds.max_position_drift = PlanningConfig::Instance().footprint_reuse_max_position_drift();
+    reuse_bounds.max_heading_drift = PlanningConfig::Instance().footprint_reuse_max_heading_drift();
+    reuse_bounds.max_speed_drift = PlanningConfig::Instance().footprint_reuse_max_speed_drift();
+    reuse_bounds.max_age = PlanningConfig::Instance().footprint_reuse_max_age();
+    footprint_table_ = std::make_shared<PredictedFootprintTable>(
+        obstacles_, 0.0, params.max_lookahead_time + delta_t, delta_t, thread_pool_,
+        *footprint_table_, (now - footprint_table_stamp_).toSec(), reuse_bounds);
+  } else {
+    footprint_table_ = std::make_shared<PredictedFootprintTable>(
+        obstacles_, 0.0, params.max_lookahead_time + delta_t, delta_t, thread_pool_);
+  }
+  footprint_table_stamp_ = now;
+  inflated_footprint_table_ = footprint_table_->Inflate(params.lon_safety_buffer, params.lat_safety_buffer);
+}
+
 bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &init_trajectory_point,
                                          const PlanningTarget &planning_target,
+                                         const PlanningParams &params,
+                                         ThreadPool *thread_pool,
+                                         MonotonicArena *arena,
+                                         LateralPathOptimizer *lateral_optimizer,
                                          std::pair<planning_msgs::Trajectory, double> &optimal_trajectory,
+                                         WarmStartSeed *optimal_seed,
                                          std::vector<planning_msgs::Trajectory> *valid_trajectories) const {
   ros::Time begin = ros::Time::now();
-  ReferenceLine ref_line = planning_target.ref_lane;
+  if (planning_target.ref_lane == nullptr) {
+    ROS_FATAL("[FrenetLatticePlanner::PlanningOnRef], the planning target has no reference line");
+    return false;
+  }
+  const auto &ptr_ref_line = planning_target.ref_lane;
+  const ReferenceLine &ref_line = *ptr_ref_line;
   std::array<double, 3> init_s{};
   std::array<double, 3> init_d{};
   FrenetLatticePlanner::GetInitCondition(ref_line, init_trajectory_point, &init_s, &init_d);
 //  auto obstacle_vec = planning_target.obstacles;
-  auto st_graph = std::make_shared<STGraph>(obstacles_, ref_line,
-                                            init_s[0],
-                                            init_s[0] + PlanningConfig::Instance().max_lookahead_distance(),
-                                            0.0, PlanningConfig::Instance().max_lookahead_time(),
-                                            init_d,
-                                            PlanningConfig::Instance().max_lookahead_time(),
-                                            PlanningConfig::Instance().delta_t());
+  // the targets are planned in parallel, so the stages are recorded once per target
+  ScopedStageTimer st_graph_timer(stage_profiler_, "st_graph");
+  auto st_graph = MakeShared<STGraph>(arena, obstacles_, ptr_ref_line,
+                                      init_s[0],
+                                      init_s[0] + params.max_lookahead_distance,
+                                      0.0, params.max_lookahead_time,
+                                      init_d,
+                                      params.max_lookahead_time,
+                                      params.delta_t,
+                                      footprint_table_, thread_pool);
+  st_graph_timer.Stop();
 #if DEBUG
   std::cout << " obstacles_.size()" << obstacles_.size() << std::endl;
   for (const auto &obstacle : obstacles_) {
@@ -83,41 +208,54 @@ bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &i
   }
 #endif
 
-  std::vector<std::shared_ptr<Polynomial>> lon_traj_vec;
-  std::vector<std::shared_ptr<Polynomial>> lat_traj_vec;
+  std::vector<LatticePolynomial> lon_traj_vec;
+  std::vector<LatticePolynomial> lat_traj_vec;
 
+  ScopedStageTimer sampling_timer(stage_profiler_, "sampling");
   auto end_condition_sampler =
-      std::make_shared<EndConditionSampler>(init_s, init_d, ref_line, obstacles_, st_graph);
-  FrenetLatticePlanner::GenerateLonTrajectories(planning_target, init_s, end_condition_sampler, &lon_traj_vec);
-  FrenetLatticePlanner::GenerateLatTrajectories(init_d, end_condition_sampler, &lat_traj_vec);
+      MakeShared<EndConditionSampler>(arena, init_s, init_d, ptr_ref_line, obstacles_, st_graph, params);
+  FrenetLatticePlanner::GenerateLatTrajectories(planning_target, obstacles_, *st_graph, init_s, init_d,
+                                                end_condition_sampler, lateral_optimizer, &lat_traj_vec);
+  FrenetLatticePlanner::GenerateLonTrajectories(planning_target, init_s, end_condition_sampler, lat_traj_vec,
+                                                st_graph, thread_pool, arena, &lon_traj_vec);
+  PolynomialTrajectoryEvaluator::Seeds seeds;
+  seeds.is_seeded_lon.assign(lon_traj_vec.size(), 0);
+  seeds.is_seeded_lat.assign(lat_traj_vec.size(), 0);
+  seeds.cost_discount = PlanningConfig::Instance().warm_start_cost_discount();
+  if (PlanningConfig::Instance().warm_start_sampling()) {
+    GenerateWarmStartTrajectories(planning_target, init_s, init_d, end_condition_sampler, &lon_traj_vec,
+                                  &lat_traj_vec, &seeds.is_seeded_lon, &seeds.is_seeded_lat);
+  }
+  sampling_timer.Stop();
   ROS_INFO("[PlanningOnRef] : the lon end conditions size is %zu, the lat end_conditions size is %zu",
            lon_traj_vec.size(),
            lat_traj_vec.size());
 
+  CollisionChecker collision_checker = CollisionChecker(footprint_table_,
+                                                        inflated_footprint_table_,
+                                                        ptr_ref_line,
+                                                        st_graph,
+                                                        init_s[0],
+                                                        init_d[0],
+                                                        params.vehicle_params,
+                                                        thread_pool,
+                                                        static_cast<size_t>(std::max(
+                                                            1, PlanningConfig::Instance().collision_check_swept_steps())),
+                                                        PlanningConfig::Instance().collision_check_polygon_footprints(),
+                                                        PlanningConfig::Instance().collision_check_float_broad_phase(),
+                                                        PlanningConfig::Instance().collision_check_float_guard_band());
+  ScopedStageTimer evaluation_timer(stage_profiler_, "evaluation");
   PolynomialTrajectoryEvaluator trajectory_evaluator = PolynomialTrajectoryEvaluator(init_s,
                                                                                      planning_target,
                                                                                      lon_traj_vec,
                                                                                      lat_traj_vec,
-                                                                                     ref_line, st_graph,
-                                                                                     thread_pool_);
-  std::unordered_map<int, std::shared_ptr<Obstacle>> obstacle_map;
-  for (const auto &obstacle : obstacles_) {
-    obstacle_map.emplace(obstacle->Id(), obstacle);
-  }
+                                                                                     ptr_ref_line, st_graph,
+                                                                                     params, thread_pool, &seeds,
+                                                                                     arena, &collision_checker);
+  evaluation_timer.Stop();
 #if DEBUG
-  std::cout << " ======== obstacle size : " << obstacle_map.size() << std::endl;
+  std::cout << " ======== obstacle size : " << footprint_table_->NumOfObstacles() << std::endl;
 #endif
-  CollisionChecker collision_checker = CollisionChecker(obstacle_map,
-                                                        ref_line,
-                                                        st_graph,
-                                                        init_s[0],
-                                                        init_d[0],
-                                                        PlanningConfig::Instance().lon_safety_buffer(),
-                                                        PlanningConfig::Instance().lat_safety_buffer(),
-                                                        PlanningConfig::Instance().max_lookahead_time(),
-                                                        PlanningConfig::Instance().delta_t(),
-                                                        PlanningConfig::Instance().vehicle_params(),
-                                                        nullptr);
   size_t collision_failure_count = 0;
   size_t combined_constraint_failure_count = 0;
   size_t lon_vel_failure_count = 0;
@@ -131,13 +269,71 @@ bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &i
   if (!trajectory_evaluator.has_more_trajectory_pairs()) {
     ROS_FATAL("[PlanningOnRef]: Failed Reason: no Valid trajectory pairs");
   }
-  while (trajectory_evaluator.has_more_trajectory_pairs()) {
-    double trajectory_pair_cost = trajectory_evaluator.top_trajectory_pair_cost();
-    auto trajectory_pair = trajectory_evaluator.next_top_trajectory_pair();
-    auto combined_trajectory = CombineTrajectories(ref_line, *trajectory_pair.first, *trajectory_pair.second,
-                                                   init_trajectory_point.relative_time);
-    auto result = ConstraintChecker::ValidTrajectory(combined_trajectory);
-    if (result != ConstraintChecker::Result::VALID) {
+  // with a thread pool the next candidates are combined and validated concurrently, the first valid one in cost
+  // order wins as in the serial loop. the candidates behind it are given up and not counted as failures.
+  struct Candidate {
+    PolynomialTrajectoryEvaluator::TrajectoryPair trajectory_pair;
+    double cost = 0.0;
+    ConstraintChecker::Result result = ConstraintChecker::Result::VALID;
+    bool is_collision = false;
+  };
+  const size_t batch_size = thread_pool == nullptr ? 1 : static_cast<size_t>(
+      std::max(1, PlanningConfig::Instance().candidate_validation_batch_size()));
+  std::vector<Candidate> candidates;
+  candidates.reserve(batch_size);
+  // one buffer per validating task, the candidates are only combined into a message once one is accepted
+  std::vector<TrajectoryBuffer> buffers(thread_pool == nullptr ? 1 : std::min(
+      static_cast<size_t>(thread_pool->Size()), batch_size));
+  ScopedStageTimer validation_timer(stage_profiler_, "validation");
+  // past the deadline the reference line fails unless a valid one is found, only the first batch is always validated
+  while (num_lattice_traj == 0 && trajectory_evaluator.has_more_trajectory_pairs()
+      && (candidates.empty() || !IsPastDeadline())) {
+    candidates.clear();
+    while (candidates.size() < batch_size && trajectory_evaluator.has_more_trajectory_pairs()) {
+      Candidate candidate;
+      candidate.cost = trajectory_evaluator.top_trajectory_pair_cost();
+      candidate.trajectory_pair = trajectory_evaluator.next_top_trajectory_pair();
+      candidates.push_back(std::move(candidate));
+    }
+    const size_t num_candidates = candidates.size();
+    std::atomic<size_t> first_valid(num_candidates);
+    const auto validate = [&](size_t i, TrajectoryBuffer *buffer) {
+      auto &candidate = candidates[i];
+      CombineTrajectories(ref_line, lon_traj_vec[candidate.trajectory_pair.first],
+                          lat_traj_vec[candidate.trajectory_pair.second], init_trajectory_point.relative_time, params,
+                          buffer, true);
+      candidate.result = ConstraintChecker::ValidTrajectory(*buffer, params);
+      if (candidate.result != ConstraintChecker::Result::VALID) {
+        return;
+      }
+      candidate.is_collision = collision_checker.IsCollision(buffer->Poses(), i, &first_valid);
+      if (candidate.is_collision) {
+        return;
+      }
+      size_t current = first_valid.load(std::memory_order_relaxed);
+      while (i < current && !first_valid.compare_exchange_weak(current, i)) {}
+    };
+    if (thread_pool == nullptr || num_candidates < 2) {
+      for (size_t i = 0; i < num_candidates && first_valid.load() == num_candidates; ++i) {
+        validate(i, &buffers[0]);
+      }
+    } else {
+      // task k validates the candidates k, k + num_tasks, ..., so the low-cost candidates are validated first
+      const size_t num_tasks = std::min(static_cast<size_t>(thread_pool->Size()), num_candidates);
+      thread_pool->ParallelFor(0, num_tasks, 1, [&](size_t k) {
+        for (size_t i = k; i < num_candidates && first_valid.load(std::memory_order_relaxed) > i; i += num_tasks) {
+          validate(i, &buffers[k]);
+        }
+      });
+    }
+    const size_t winner = first_valid.load();
+    // every candidate in front of the winner is validated completely, so the counts match the serial loop
+    for (size_t i = 0; i < std::min(winner, num_candidates); ++i) {
+      const auto result = candidates[i].result;
+      if (result == ConstraintChecker::Result::VALID) {
+        collision_failure_count += candidates[i].is_collision ? 1 : 0;
+        continue;
+      }
       ++combined_constraint_failure_count;
       switch (result) {
         case ConstraintChecker::Result::LON_VELOCITY_OUT_OF_BOUND: {
@@ -167,7 +363,6 @@ bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &i
         case ConstraintChecker::Result::VALID:
         default: { break; }
       }
-      continue;
     }
 //    if (CollisionChecker::IsCollision(obstacles_, ref_line, combined_trajectory,
 //                                       PlanningConfig::Instance().vehicle_params().length
@@ -178,15 +373,28 @@ bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &i
 //      ++collision_failure_count;
 //      continue;
 //    }
-    if (collision_checker.IsCollision(combined_trajectory)) {
-      ++collision_failure_count;
+    if (winner >= num_candidates) {
       continue;
     }
     num_lattice_traj += 1;
-    optimal_trajectory.second = trajectory_pair_cost;
-    optimal_trajectory.first = combined_trajectory;
-    break;
+    optimal_trajectory.second = candidates[winner].cost;
+    const auto &lon_traj = lon_traj_vec[candidates[winner].trajectory_pair.first];
+    const auto &lat_traj = lat_traj_vec[candidates[winner].trajectory_pair.second];
+    optimal_trajectory.first = CombineTrajectories(ref_line, lon_traj, lat_traj, init_trajectory_point.relative_time,
+                                                   params);
+    SLPoint lat_end_sl;
+    lat_end_sl.s = init_s[0] + lat_traj.ParamLength();
+    lat_end_sl.l = lat_traj.Evaluate(0, lat_traj.ParamLength());
+    Eigen::Vector2d lat_end_xy;
+    if (optimal_seed != nullptr && ref_line.SLToXY(lat_end_sl, &lat_end_xy)) {
+      optimal_seed->is_valid = true;
+      optimal_seed->lon_end_vel = lon_traj.Evaluate(1, lon_traj.ParamLength());
+      optimal_seed->lon_end_time = lon_traj.ParamLength();
+      optimal_seed->lat_end_x = lat_end_xy.x();
+      optimal_seed->lat_end_y = lat_end_xy.y();
+    }
   }
+  validation_timer.Stop();
   ROS_WARN(
       "[PlanningOnRef]: the lon_vel_failure_count:%zu,  lon_acc_failure_count: %zu,  lon_jerk_failure_count: %zu,  curvature_failure_count: %zu,"
       "lat_acc_failure_count: %zu, lat_jerk_failure_count: %zu, collision_failure_count: %zu",
@@ -212,17 +420,40 @@ bool FrenetLatticePlanner::PlanningOnRef(const planning_msgs::TrajectoryPoint &i
 }
 
 planning_msgs::Trajectory FrenetLatticePlanner::CombineTrajectories(const ReferenceLine &ref_line,
-                                                                    const Polynomial &lon_traj,
-                                                                    const Polynomial &lat_traj,
-                                                                    double start_time) {
+                                                                    const LatticePolynomial &lon_traj,
+                                                                    const LatticePolynomial &lat_traj,
+                                                                    double start_time,
+                                                                    const PlanningParams &params) {
+  TrajectoryBuffer buffer;
+  CombineTrajectories(ref_line, lon_traj, lat_traj, start_time, params, &buffer);
+  planning_msgs::Trajectory combined_trajectory;
+  buffer.ToTrajectory(&combined_trajectory);
+  return combined_trajectory;
+}
+
+void FrenetLatticePlanner::CombineTrajectories(const ReferenceLine &ref_line,
+                                               const LatticePolynomial &lon_traj,
+                                               const LatticePolynomial &lat_traj,
+                                               double start_time,
+                                               const PlanningParams &params,
+                                               TrajectoryBuffer *combined_trajectory,
+                                               bool on_sample_times) {
+  const double delta_t = params.delta_t;
+  const auto &sample_times = params.sample_times;
+  const bool is_uniform = !on_sample_times || sample_times.empty();
+  const size_t num_steps = is_uniform ? params.num_time_steps : params.num_sample_steps;
+  const auto relative_time = [&](size_t i) {
+    return is_uniform ? static_cast<double>(i) * delta_t : sample_times[i];
+  };
+  combined_trajectory->Clear(num_steps);
+  auto *frenet_points = combined_trajectory->mutable_frenet_points();
+  auto *cartesian_points = combined_trajectory->mutable_cartesian_points();
+  frenet_points->Clear(num_steps);
   double s0 = lon_traj.Evaluate(0, 0.0);
   double s_ref_max = ref_line.Length();
-  double accumulated_s = 0.0;
   double last_s = -1.0 * std::numeric_limits<double>::epsilon();
-  double t_param = 0.0;
-  planning_msgs::PathPoint prev_path_point;
-  planning_msgs::Trajectory combined_trajectory;
-  while (t_param < PlanningConfig::Instance().max_lookahead_time()) {
+  for (size_t i = 0; i < num_steps; ++i) {
+    const double t_param = relative_time(i);
     double s = lon_traj.Evaluate(0, t_param);
     if (last_s > 0.0) {
       s = std::max(last_s, s);
@@ -238,53 +469,46 @@ planning_msgs::Trajectory FrenetLatticePlanner::CombineTrajectories(const Refere
     double d_prime = lat_traj.Evaluate(1, relative_s);
     double d_prime_prime = lat_traj.Evaluate(2, relative_s);
     auto matched_re_point = ref_line.GetReferencePoint(s);
-    double x = 0;
-    double y = 0.0;
-    double theta = 0.0;
-    double kappa = 0.0;
-    double v = 0.0;
-    double a = 0.0;
-    const double rs = s;
-    const double rx = matched_re_point.x();
-    const double ry = matched_re_point.y();
-    const double rtheta = matched_re_point.theta();
-    const double rkappa = matched_re_point.kappa();
-    const double rdkappa = matched_re_point.dkappa();
-    std::array<double, 3> s_conditions = {rs, s_dot, s_dot_dot};
-    std::array<double, 3> d_conditions = {d, d_prime, d_prime_prime};
-    CoordinateTransformer::FrenetToCartesian(rs, rx, ry,
-                                             rtheta, rkappa, rdkappa,
-                                             s_conditions, d_conditions,
-                                             &x, &y, &theta,
-                                             &kappa, &v, &a);
-    if (t_param >= PlanningConfig::Instance().delta_t()) {
-      double delta_x = x - prev_path_point.x;
-      double delta_y = y - prev_path_point.y;
-      accumulated_s += std::hypot(delta_x, delta_y);
+    frenet_points->Append(matched_re_point.x(), matched_re_point.y(), matched_re_point.theta(),
+                          matched_re_point.kappa(), matched_re_point.dkappa(),
+                          {s, s_dot, s_dot_dot}, {d, d_prime, d_prime_prime});
+  }
+  CoordinateTransformer::FrenetToCartesian(*frenet_points, cartesian_points);
+
+  double accumulated_s = 0.0;
+  for (size_t i = 0; i < cartesian_points->Size(); ++i) {
+    const double x = cartesian_points->x[i];
+    const double y = cartesian_points->y[i];
+    if (i > 0) {
+      accumulated_s += std::hypot(x - cartesian_points->x[i - 1], y - cartesian_points->y[i - 1]);
     }
-    planning_msgs::TrajectoryPoint tp;
-    tp.path_point.x = x;
-    tp.path_point.y = y;
-    tp.path_point.theta = theta;
-    tp.path_point.kappa = kappa;
-    tp.path_point.s = accumulated_s;
-    tp.vel = v;
-    tp.acc = a;
-    tp.relative_time = start_time + t_param;
-    combined_trajectory.trajectory_points.push_back(tp);
-    t_param += PlanningConfig::Instance().delta_t();
-    prev_path_point = tp.path_point;
+    combined_trajectory->Append(x, y, cartesian_points->theta[i], cartesian_points->kappa[i], accumulated_s,
+                                cartesian_points->v[i], cartesian_points->a[i],
+                                start_time + relative_time(i));
   }
-  return combined_trajectory;
 }
 
-void FrenetLatticePlanner::GenerateLatTrajectories(const std::array<double, 3> &init_d,
+void FrenetLatticePlanner::GenerateLatTrajectories(const PlanningTarget &planning_target,
+                                                   const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                                   const STGraph &st_graph,
+                                                   const std::array<double, 3> &init_s,
+                                                   const std::array<double, 3> &init_d,
                                                    const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                                   std::vector<std::shared_ptr<Polynomial>> *ptr_lat_traj_vec) {
+                                                   LateralPathOptimizer *lateral_optimizer,
+                                                   std::vector<LatticePolynomial> *ptr_lat_traj_vec) {
   if (ptr_lat_traj_vec == nullptr) {
     return;
   }
   ptr_lat_traj_vec->clear();
+  if (lateral_optimizer != nullptr && PlanningConfig::Instance().lat_planner() == "path_optimizer") {
+    LatticePolynomial lat_traj;
+    if (lateral_optimizer->Optimize(*planning_target.ref_lane, st_graph, obstacles, init_s, init_d,
+                                    end_condition_sampler->params(), &lat_traj)) {
+      ptr_lat_traj_vec->push_back(lat_traj);
+      return;
+    }
+    ROS_WARN("[FrenetLatticePlanner::GenerateLatTrajectories], the lat path optimizer failed, fall back to sampling");
+  }
   auto lat_end_conditions = end_condition_sampler->SampleLatEndCondition();
 //  ROS_INFO("[FrenetLatticePlanner::GenerateLatTrajectories], the end conditions size : %zu", lat_end_conditions.size());
 
@@ -295,33 +519,107 @@ void FrenetLatticePlanner::GenerateLatTrajectories(const std::array<double, 3> &
 void FrenetLatticePlanner::GenerateLonTrajectories(const PlanningTarget &planning_target,
                                                    const std::array<double, 3> &init_s,
                                                    const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                                   std::vector<std::shared_ptr<Polynomial>> *ptr_lon_traj_vec) {
+                                                   const std::vector<LatticePolynomial> &lat_traj_vec,
+                                                   const std::shared_ptr<STGraph> &st_graph,
+                                                   ThreadPool *thread_pool,
+                                                   MonotonicArena *arena,
+                                                   std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
   if (ptr_lon_traj_vec == nullptr) {
     return;
   }
   ptr_lon_traj_vec->clear();
-  auto ref_line = planning_target.ref_lane;
-  auto matched_ref_point = ref_line.GetReferencePoint(init_s[0]);
+  if (PlanningConfig::Instance().lon_planner() == "speed_optimizer") {
+    if (FrenetLatticePlanner::GenerateOptimizedLonTrajectory(planning_target, init_s, *st_graph,
+                                                             end_condition_sampler->params(), ptr_lon_traj_vec)) {
+      return;
+    }
+    ROS_WARN("[FrenetLatticePlanner::GenerateLonTrajectories], the speed optimizer failed, fall back to sampling");
+  }
+  auto matched_ref_point = planning_target.ref_lane->GetReferencePoint(init_s[0]);
 //  std::cout << "=========== matched_ref_point: kappa: " << matched_ref_point.kappa() << std::endl;
 //  double cruise_speed = std::min(PlanningConfig::Instance().max_lon_velocity() * 0.9,
 //                                 PlanningConfig::Instance().max_lat_acc()
 //                                     / (std::fabs(matched_ref_point.kappa()) + 1e-6));
   double cruise_speed = planning_target.desired_vel;
 //  std::cout << " -==========================-- cruise speed is: " << cruise_speed << "m/s==============-" << std::endl;
-  FrenetLatticePlanner::GenerateCruisingLonTrajectories(cruise_speed, init_s,
-                                                        end_condition_sampler, ptr_lon_traj_vec);
+  if (PlanningConfig::Instance().coarse_to_fine_sampling()) {
+    FrenetLatticePlanner::GenerateCoarseToFineCruisingLonTrajectories(planning_target, init_s, end_condition_sampler,
+                                                                      lat_traj_vec, st_graph, thread_pool, arena,
+                                                                      ptr_lon_traj_vec);
+  } else {
+    FrenetLatticePlanner::GenerateCruisingLonTrajectories(cruise_speed, init_s,
+                                                          end_condition_sampler, ptr_lon_traj_vec);
+  }
   FrenetLatticePlanner::GenerateOvertakeAndFollowingLonTrajectories(init_s, end_condition_sampler, ptr_lon_traj_vec);
   if (planning_target.has_stop_point) {
     FrenetLatticePlanner::GenerateStoppingLonTrajectories(planning_target.stop_s,
-                                                          init_s, end_condition_sampler,
-                                                          ptr_lon_traj_vec);
+                                                          init_s, end_condition_sampler, ptr_lon_traj_vec);
+  }
+}
+
+bool FrenetLatticePlanner::GenerateOptimizedLonTrajectory(const PlanningTarget &planning_target,
+                                                          const std::array<double, 3> &init_s,
+                                                          const STGraph &st_graph,
+                                                          const PlanningParams &params,
+                                                          std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
+  std::vector<std::vector<std::pair<double, double>>> blocking_intervals(params.num_time_steps + 1);
+  for (size_t i = 0; i < blocking_intervals.size(); ++i) {
+    blocking_intervals[i] = st_graph.GetMergedBlockingIntervals(
+        std::min(static_cast<double>(i) * params.delta_t, params.max_lookahead_time));
+  }
+  double max_s = std::min(planning_target.ref_lane->Length(), init_s[0] + params.max_lookahead_distance);
+  if (planning_target.has_stop_point && init_s[0] < planning_target.stop_s) {
+    // the evaluator drops the lon trajectories ending within the buffer, the fit may overshoot by half of it
+    max_s = std::min(max_s, planning_target.stop_s - 1.5 * params.lon_safety_buffer);
+  }
+  SpeedOptimizer::SpeedProfile profile;
+  if (!SpeedOptimizer(params).Optimize(init_s, blocking_intervals, planning_target.desired_vel, max_s, &profile)) {
+    return false;
   }
+  double max_deviation = 0.0;
+  const auto lon_polynomial = LatticePolynomial::FitQuintic(init_s, profile.s, profile.delta_t, &max_deviation);
+  if (max_deviation > 0.5 * params.lon_safety_buffer) {
+    return false;
+  }
+  ptr_lon_traj_vec->push_back(lon_polynomial);
+  return true;
+}
+
+void FrenetLatticePlanner::GenerateWarmStartTrajectories(
+    const PlanningTarget &planning_target,
+    const std::array<double, 3> &init_s,
+    const std::array<double, 3> &init_d,
+    const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
+    std::vector<LatticePolynomial> *ptr_lon_traj_vec,
+    std::vector<LatticePolynomial> *ptr_lat_traj_vec,
+    std::vector<char> *is_seeded_lon,
+    std::vector<char> *is_seeded_lat) const {
+  // beyond the lat offset samples, the seed ends on another lane
+  constexpr double kMaxLatSeedOffset = 1.0;
+  if (!warm_start_seed_.is_valid) {
+    return;
+  }
+  const std::pair<std::array<double, 3>, double> lon_seed({0.0, warm_start_seed_.lon_end_vel, 0.0},
+                                                          warm_start_seed_.lon_end_time);
+  const auto lon_end_conditions =
+      end_condition_sampler->SampleLonEndConditionAroundSeed(planning_target.desired_vel, lon_seed);
+  FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, lon_end_conditions, 4, ptr_lon_traj_vec);
+  is_seeded_lon->resize(ptr_lon_traj_vec->size(), 1);
+  SLPoint lat_end_sl;
+  if (!planning_target.ref_lane->XYToSL(warm_start_seed_.lat_end_x, warm_start_seed_.lat_end_y, &lat_end_sl)
+      || std::fabs(lat_end_sl.l) > kMaxLatSeedOffset || lat_end_sl.s <= init_s[0]) {
+    return;
+  }
+  const std::pair<std::array<double, 3>, double> lat_seed({lat_end_sl.l, 0.0, 0.0}, lat_end_sl.s - init_s[0]);
+  FrenetLatticePlanner::GeneratePolynomialTrajectories(
+      init_d, EndConditionSampler::SampleLatEndConditionAroundSeed(lat_seed), 5, ptr_lat_traj_vec);
+  is_seeded_lat->resize(ptr_lat_traj_vec->size(), 1);
 }
 
 void FrenetLatticePlanner::GenerateCruisingLonTrajectories(double cruise_speed,
                                                            const std::array<double, 3> &init_s,
                                                            const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                                           std::vector<std::shared_ptr<Polynomial>> *ptr_lon_traj_vec) {
+                                                           std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
   ros::Time begin = ros::Time::now();
   auto end_conditions = end_condition_sampler->SampleLonEndConditionForCruising(cruise_speed);
   FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, end_conditions, 4, ptr_lon_traj_vec);
@@ -329,10 +627,51 @@ void FrenetLatticePlanner::GenerateCruisingLonTrajectories(double cruise_speed,
   ROS_INFO("[GenerateCruisingLonTrajectories], GeneratePolynomialTrajectories elapsed %lf s", (end - begin).toSec());
 }
 
+void FrenetLatticePlanner::GenerateCoarseToFineCruisingLonTrajectories(
+    const PlanningTarget &planning_target,
+    const std::array<double, 3> &init_s,
+    const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
+    const std::vector<LatticePolynomial> &lat_traj_vec,
+    const std::shared_ptr<STGraph> &st_graph,
+    ThreadPool *thread_pool,
+    MonotonicArena *arena,
+    std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
+  const double cruise_speed = planning_target.desired_vel;
+  const auto coarse_end_conditions = end_condition_sampler->SampleCoarseLonEndConditionForCruising(cruise_speed);
+  std::vector<LatticePolynomial> coarse_traj_vec;
+  FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, coarse_end_conditions, 4, &coarse_traj_vec);
+  // the pairs pop in cost order, the first pairing of a coarse trajectory is its best one
+  const size_t refined_cells_num = static_cast<size_t>(std::max(1, PlanningConfig::Instance().refined_cells_num()));
+  std::vector<std::pair<std::array<double, 3>, double>> best_end_conditions;
+  std::vector<size_t> best_trajectories;
+  PolynomialTrajectoryEvaluator coarse_evaluator(init_s, planning_target, coarse_traj_vec, lat_traj_vec,
+                                                 planning_target.ref_lane, st_graph, end_condition_sampler->params(),
+                                                 thread_pool, nullptr, arena);
+  while (best_end_conditions.size() < refined_cells_num && coarse_evaluator.has_more_trajectory_pairs()) {
+    const size_t lon_index = coarse_evaluator.next_top_trajectory_pair().first;
+    if (std::find(best_trajectories.begin(), best_trajectories.end(), lon_index) != best_trajectories.end()) {
+      continue;
+    }
+    best_trajectories.push_back(lon_index);
+    best_end_conditions.push_back(coarse_end_conditions[lon_index]);
+  }
+  if (best_end_conditions.empty()) {
+    FrenetLatticePlanner::GenerateCruisingLonTrajectories(cruise_speed, init_s, end_condition_sampler,
+                                                          ptr_lon_traj_vec);
+    return;
+  }
+  ptr_lon_traj_vec->insert(ptr_lon_traj_vec->end(), coarse_traj_vec.begin(), coarse_traj_vec.end());
+  const auto refined_end_conditions =
+      end_condition_sampler->RefineLonEndConditionForCruising(cruise_speed, best_end_conditions);
+  FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, refined_end_conditions, 4, ptr_lon_traj_vec);
+  ROS_DEBUG("[GenerateCoarseToFineCruisingLonTrajectories], %zu coarse and %zu refined end conditions",
+            coarse_end_conditions.size(), refined_end_conditions.size());
+}
+
 void FrenetLatticePlanner::GenerateStoppingLonTrajectories(double stop_s,
                                                            const std::array<double, 3> &init_s,
                                                            const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                                           std::vector<std::shared_ptr<Polynomial>> *ptr_lon_traj_vec) {
+                                                           std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
   auto end_conditions = end_condition_sampler->SampleLonEndConditionForStopping(stop_s);
   ROS_DEBUG("[FrenetLatticePlanner::GenerateStoppingLonTrajectories], the end conditions size : %zu",
             end_conditions.size());
@@ -345,10 +684,12 @@ void FrenetLatticePlanner::GenerateStoppingLonTrajectories(double stop_s,
 void FrenetLatticePlanner::GenerateOvertakeAndFollowingLonTrajectories(
     const std::array<double, 3> &init_s,
     const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-    std::vector<std::shared_ptr<Polynomial>> *ptr_lon_traj_vec) {
-  auto end_conditions = end_condition_sampler->SampleLonEndConditionWithSTGraph();
-  ROS_INFO("[FrenetLatticePlanner::GenerateOvertakeAndFollowingLonTrajectories], the end conditions size : %zu",
-           end_conditions.size());
+    std::vector<LatticePolynomial> *ptr_lon_traj_vec) {
+  EndConditionPruningStatistics pruning_statistics;
+  auto end_conditions = end_condition_sampler->SampleLonEndConditionWithSTGraph(&pruning_statistics);
+  ROS_INFO("[FrenetLatticePlanner::GenerateOvertakeAndFollowingLonTrajectories], the end conditions size : %zu, "
+           "%zu of %zu sampled pruned as duplicates and %zu as infeasible", end_conditions.size(),
+           pruning_statistics.num_duplicates, pruning_statistics.num_sampled, pruning_statistics.num_infeasible);
   ros::Time begin = ros::Time::now();
   FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, end_conditions, 5, ptr_lon_traj_vec);
   ros::Time end = ros::Time::now();
@@ -360,7 +701,7 @@ void FrenetLatticePlanner::GenerateOvertakeAndFollowingLonTrajectories(
 void FrenetLatticePlanner::GeneratePolynomialTrajectories(
     const std::array<double, 3> &init_condition,
     const std::vector<std::pair<std::array<double, 3>, double>> &end_conditions,
-    size_t order, std::vector<std::shared_ptr<Polynomial>> *ptr_traj_vec) {
+    size_t order, std::vector<LatticePolynomial> *ptr_traj_vec) {
 
   if (ptr_traj_vec == nullptr) {
     ROS_FATAL("[FrenetLatticePlanner::GeneratePolynomialTrajectories], the pre_traj_vec is nullptr");
@@ -376,18 +717,15 @@ void FrenetLatticePlanner::GeneratePolynomialTrajectories(
   switch (order) {
     case 4: {
       for (const auto &end_condition : end_conditions) {
-        auto ptr_trajectory = std::make_shared<LatticeTrajectory1d>(
-            std::make_shared<QuarticPolynomial>(init_condition[0], init_condition[1], init_condition[2],
-                                                end_condition.first[1], end_condition.first[2], end_condition.second));
-        ptr_traj_vec->push_back(ptr_trajectory);
+        ptr_traj_vec->emplace_back(QuarticPolynomial(init_condition[0], init_condition[1], init_condition[2],
+                                                     end_condition.first[1], end_condition.first[2],
+                                                     end_condition.second));
       }
       break;
     }
     case 5: {
       for (const auto &end_condition : end_conditions) {
-        auto ptr_trajectory = std::make_shared<LatticeTrajectory1d>(
-            std::make_shared<QuinticPolynomial>(init_condition, end_condition.first, end_condition.second));
-        ptr_traj_vec->push_back(ptr_trajectory);
+        ptr_traj_vec->emplace_back(QuinticPolynomial(init_condition, end_condition.first, end_condition.second));
       }
       break;
     }
@@ -5,9 +5,15 @@
 #include <planning_msgs/Trajectory.h>
 #include "trajectory_planner.hpp"
 #include "end_condition_sampler.hpp"
+#include "trajectory_buffer.hpp"
+#include "lattice_trajectory1d.hpp"
+#include "lateral_path_optimizer.hpp"
 #include "curves/quartic_polynomial.hpp"
 #include "curves/quintic_polynomial.hpp"
 #include "thread_pool/thread_pool.hpp"
+#include "memory/monotonic_arena.hpp"
+#include "profiler/stage_profiler.hpp"
+#include "obstacle_manager/predicted_footprint_table.hpp"
 
 namespace planning {
 
@@ -15,7 +21,12 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
  public:
 
   FrenetLatticePlanner() = default;
-  explicit FrenetLatticePlanner(common::ThreadPool *thread_pool);
+  /**
+   * @brief: constructor
+   * @param thread_pool
+   * @param stage_profiler: records the time of the planning stages, nothing is recorded if nullptr
+   */
+  explicit FrenetLatticePlanner(common::ThreadPool *thread_pool, common::StageProfiler *stage_profiler = nullptr);
 
   ~FrenetLatticePlanner() override = default;
 
@@ -33,19 +44,83 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
                planning_msgs::Trajectory &pub_trajectory,
                std::vector<planning_msgs::Trajectory> *valid_trajectories) override;
 
+  /**
+   * @brief: check the trajectory with the constraint checker and against the inflated footprints of the obstacles,
+   * the footprint tables are rebuilt for the obstacles as in Process
+   * @param obstacles
+   * @param trajectory
+   * @return
+   */
+  bool IsTrajectoryValid(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                         const planning_msgs::Trajectory &trajectory) override;
+
+  /**
+   * @brief: the frenet state of the init trajectory point on the reference line
+   * @param ptr_ref_line
+   * @param init_trajectory_point
+   * @param init_s: [out] s, s_dot, s_ddot
+   * @param init_d: [out] d, d', d'' with respect to s
+   */
+  static void GetInitCondition(const ReferenceLine &ptr_ref_line,
+                               const planning_msgs::TrajectoryPoint &init_trajectory_point,
+                               std::array<double, 3> *const init_s,
+                               std::array<double, 3> *const init_d);
+
+  /**
+   * @brief: combine the lon and lat trajectories into the buffer, the form the candidates are checked and measured in
+   * @param ref_line: reference line
+   * @param lon_traj: lon trajectories
+   * @param lat_traj: lat trajectories
+   * @param start_time: relative time of the first point
+   * @param params: the parameters of the planning cycle
+   * @param combined_trajectory: [out] cleared first, its capacity is reused
+   * @param on_sample_times: combine at params.sample_times, the grid the candidates are evaluated and checked on,
+   * instead of the uniform delta_t of the published trajectory. ignored if the time grid is uniform
+   */
+  static void CombineTrajectories(const ReferenceLine &ref_line,
+                                  const LatticePolynomial &lon_traj,
+                                  const LatticePolynomial &lat_traj,
+                                  double start_time,
+                                  const PlanningParams &params,
+                                  TrajectoryBuffer *combined_trajectory,
+                                  bool on_sample_times = false);
+
  protected:
 
   static void GenerateEmergencyStopTrajectory(const planning_msgs::TrajectoryPoint &init_trajectory_point,
                                               planning_msgs::Trajectory &stop_trajectory);
+  /**
+   * @brief: the end conditions of an optimal trajectory, the lon one as a cruising end condition and the lat one as
+   * the point it ends at, so it can be projected on the reference lines of the next cycle
+   */
+  struct WarmStartSeed {
+    bool is_valid = false;
+    double lon_end_vel = 0.0;
+    // relative to stamp
+    double lon_end_time = 0.0;
+    double lat_end_x = 0.0;
+    double lat_end_y = 0.0;
+    ros::Time stamp;
+  };
+
   /**
    * @brief: generate lon trajectories and lat trajectories
    * @param maneuver_info: maneuver goal, comes from maneuver planner
+   * @param thread_pool: thread pool used by the trajectory evaluator, nullptr to evaluate serially
+   * @param arena: the st graph, the sampler, the sample tables and the cost queue are allocated in it,
+   * nullptr to allocate them on the heap. none of them outlives the call
+   * @param lateral_optimizer: the lat path optimizer of the target, only used if the lat planner is the path optimizer
    * @param[out] ptr_lon_traj_vec: lon trajectories
    * @param[out] ptr_lat_traj_vec: lat trajectories
    */
   bool PlanningOnRef(const planning_msgs::TrajectoryPoint &init_trajectory_point,
                      const PlanningTarget &planning_target,
+                     const PlanningParams &params,
+                     common::ThreadPool *thread_pool,
+                     common::MonotonicArena *arena,
+                     LateralPathOptimizer *lateral_optimizer,
                      std::pair<planning_msgs::Trajectory, double> &optimal_trajectory,
+                     WarmStartSeed *optimal_seed,
                      std::vector<planning_msgs::Trajectory> *valid_trajectories) const;
 
   /**
@@ -53,38 +128,93 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
    * @param ref_line: reference line
    * @param lon_traj: lon trajectories
    * @param lat_traj: lat trajectories
-   * @param ptr_combined_pub_traj: combined trajectory
-   * @return
+   * @param params: the parameters of the planning cycle
+   * @return: combined trajectory
    */
   static planning_msgs::Trajectory CombineTrajectories(const ReferenceLine &ref_line,
-                                                       const common::Polynomial &lon_traj,
-                                                       const common::Polynomial &lat_traj,
-                                                       double start_time);
+                                                       const LatticePolynomial &lon_traj,
+                                                       const LatticePolynomial &lat_traj,
+                                                       double start_time,
+                                                       const PlanningParams &params);
 
  private:
 
-  static void GetInitCondition(const ReferenceLine &ptr_ref_line,
-                               const planning_msgs::TrajectoryPoint &init_trajectory_point,
-                               std::array<double, 3> *const init_s,
-                               std::array<double, 3> *const init_d);
+  /**
+   * @brief: build the plain and inflated footprint tables of obstacles_, time-shifting the last ones if the
+   * incremental footprint update is enabled
+   * @param params
+   * @param now: the time the tables start at
+   */
+  void UpdateFootprintTables(const PlanningParams &params, const ros::Time &now);
 
   /**
-   * @brief: generate lat polynomial trajectories
+   * @brief: generate lat polynomial trajectories, the one optimized path if the lat planner is the path optimizer and
+   * it succeeds, the sampled ones otherwise
+   * @param lateral_optimizer: nullptr to sample
    * @param ptr_lat_traj_vec
    */
-  static void GenerateLatTrajectories(const std::array<double, 3> &init_d,
+  static void GenerateLatTrajectories(const PlanningTarget &planning_target,
+                                      const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                      const STGraph &st_graph,
+                                      const std::array<double, 3> &init_s,
+                                      const std::array<double, 3> &init_d,
                                       const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                      std::vector<std::shared_ptr<common::Polynomial>> *ptr_lat_traj_vec);
+                                      LateralPathOptimizer *lateral_optimizer,
+                                      std::vector<LatticePolynomial> *ptr_lat_traj_vec);
 
   /**
    *
    * @param maneuver_info
+   * @param lat_traj_vec: only used to rank the coarse cells of the coarse to fine sampling
+   * @param st_graph: only used to rank the coarse cells of the coarse to fine sampling
+   * @param thread_pool: only used to rank the coarse cells of the coarse to fine sampling
    * @param ptr_lon_traj_vec
    */
   static void GenerateLonTrajectories(const PlanningTarget &planning_target,
                                       const std::array<double, 3> &init_s,
                                       const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                      std::vector<std::shared_ptr<common::Polynomial>> *ptr_lon_traj_vec);
+                                      const std::vector<LatticePolynomial> &lat_traj_vec,
+                                      const std::shared_ptr<STGraph> &st_graph,
+                                      common::ThreadPool *thread_pool,
+                                      common::MonotonicArena *arena,
+                                      std::vector<LatticePolynomial> *ptr_lon_traj_vec);
+
+  /**
+   * @brief: the quintic fit of the speed profile of SpeedOptimizer as the only lon trajectory
+   * @param planning_target
+   * @param init_s
+   * @param st_graph
+   * @param params
+   * @param ptr_lon_traj_vec
+   * @return: false if the speed optimizer fails or its profile does not fit a quintic within half the lon safety
+   * buffer
+   */
+  static bool GenerateOptimizedLonTrajectory(const PlanningTarget &planning_target,
+                                             const std::array<double, 3> &init_s,
+                                             const STGraph &st_graph,
+                                             const PlanningParams &params,
+                                             std::vector<LatticePolynomial> *ptr_lon_traj_vec);
+
+  /**
+   * @brief: append the trajectories sampled around the time-shifted warm start seed, the lat ones only if the seed
+   * projects near this reference line
+   * @param planning_target
+   * @param init_s
+   * @param init_d
+   * @param end_condition_sampler
+   * @param ptr_lon_traj_vec
+   * @param ptr_lat_traj_vec
+   * @param is_seeded_lon: [out] one flag per lon trajectory
+   * @param is_seeded_lat: [out] one flag per lat trajectory
+   */
+  void GenerateWarmStartTrajectories(const PlanningTarget &planning_target,
+                                     const std::array<double, 3> &init_s,
+                                     const std::array<double, 3> &init_d,
+                                     const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
+                                     std::vector<LatticePolynomial> *ptr_lon_traj_vec,
+                                     std::vector<LatticePolynomial> *ptr_lat_traj_vec,
+                                     std::vector<char> *is_seeded_lon,
+                                     std::vector<char> *is_seeded_lat) const;
 
   /**
    * @brief: generate cruising lon trajectories
@@ -94,7 +224,29 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
   static void GenerateCruisingLonTrajectories(double cruise_speed,
                                               const std::array<double, 3> &init_s,
                                               const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                              std::vector<std::shared_ptr<common::Polynomial>> *ptr_lon_traj_vec);
+                                              std::vector<LatticePolynomial> *ptr_lon_traj_vec);
+
+  /**
+   * @brief: generate cruising lon trajectories on a coarse grid, rank its cells by the cost of their best pairing
+   * with the lat trajectories and add the refined cells around the best ones. falls back to the dense grid if no
+   * coarse cell has a valid pairing.
+   * @param planning_target
+   * @param init_s
+   * @param end_condition_sampler
+   * @param lat_traj_vec
+   * @param st_graph
+   * @param thread_pool
+   * @param ptr_lon_traj_vec
+   */
+  static void GenerateCoarseToFineCruisingLonTrajectories(
+      const PlanningTarget &planning_target,
+      const std::array<double, 3> &init_s,
+      const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
+      const std::vector<LatticePolynomial> &lat_traj_vec,
+      const std::shared_ptr<STGraph> &st_graph,
+      common::ThreadPool *thread_pool,
+      common::MonotonicArena *arena,
+      std::vector<LatticePolynomial> *ptr_lon_traj_vec);
 
   /**
    * @brief: generate stopping lon trajectories
@@ -104,7 +256,7 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
   static void GenerateStoppingLonTrajectories(double stop_s,
                                               const std::array<double, 3> &init_s,
                                               const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                              std::vector<std::shared_ptr<common::Polynomial>> *ptr_lon_traj_vec);
+                                              std::vector<LatticePolynomial> *ptr_lon_traj_vec);
 
   /**
    * @brief: generate overtake and following lon trajectories
@@ -112,7 +264,7 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
    */
   static void GenerateOvertakeAndFollowingLonTrajectories(const std::array<double, 3> &init_s,
                                                           const std::shared_ptr<EndConditionSampler> &end_condition_sampler,
-                                                          std::vector<std::shared_ptr<common::Polynomial>> *ptr_lon_traj_vec);
+                                                          std::vector<LatticePolynomial> *ptr_lon_traj_vec);
 
   /**
    * @brief: generate polynomial trajectories, quartic_polynomial or quintic_polynomial
@@ -125,10 +277,22 @@ class FrenetLatticePlanner : public TrajectoryPlanner {
                                              const std::vector<std::pair<std::array<double, 3>,
                                                                          double>> &end_conditions,
                                              size_t order,
-                                             std::vector<std::shared_ptr<common::Polynomial>> *ptr_traj_vec);
+                                             std::vector<LatticePolynomial> *ptr_traj_vec);
  private:
   common::ThreadPool *thread_pool_ = nullptr;
+  common::StageProfiler *stage_profiler_ = nullptr;
   std::vector<std::shared_ptr<Obstacle>> obstacles_;
+  // the predicted footprints of obstacles_ in the current cycle, plain and inflated by the safety buffers
+  std::shared_ptr<const PredictedFootprintTable> footprint_table_;
+  std::shared_ptr<const PredictedFootprintTable> inflated_footprint_table_;
+  // when footprint_table_ was built, the next cycle time-shifts it by the elapsed time
+  ros::Time footprint_table_stamp_;
+  // the optimum of the last cycle, time-shifted to the current one before the reference lines are planned
+  WarmStartSeed warm_start_seed_;
+  // one per planning target, as the targets may be planned concurrently, reset once all of them are planned
+  std::vector<std::unique_ptr<common::MonotonicArena>> arenas_;
+  // one per planning target, kept across the cycles so the QP of a target warm starts from its last path
+  std::vector<std::unique_ptr<LateralPathOptimizer>> lateral_optimizers_;
 };
 
 }
@@ -0,0 +1,218 @@
+#include "frenet_lattice_planner/lateral_path_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include "curves/quintic_polynomial.hpp"
+
+namespace planning {
+namespace {
+typedef common::AdmmQpSolver::SparseMatrix SparseMatrix;
+constexpr double kInfinity = 1e20;
+// the obstacles slower than this are nudged, the faster ones are left to the lon stage
+constexpr double kMaxStaticObstacleSpeed = 0.5;
+constexpr size_t kMinNumPoints = 5;
+// the path keeps to the reference line and is smoothed the stronger the higher the derivative
+constexpr double kLWeight = 1.0;
+constexpr double kDlWeight = 10.0;
+constexpr double kDdlWeight = 100.0;
+constexpr double kDddlWeight = 1000.0;
+// the largest deviation of the fitted quintic from the path, relative to the lat safety buffer
+constexpr double kMaxFitDeviationRatio = 0.5;
+}
+
+bool LateralPathOptimizer::Optimize(const ReferenceLine &ref_line,
+                                    const STGraph &st_graph,
+                                    const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                    const std::array<double, 3> &init_s,
+                                    const std::array<double, 3> &init_d,
+                                    const PlanningParams &params,
+                                    LatticePolynomial *lat_traj) {
+  std::vector<std::pair<double, double>> bounds;
+  std::vector<double> path;
+  if (lat_traj == nullptr || !GetPathBounds(ref_line, st_graph, obstacles, init_s[0], params, &bounds)
+      || !OptimizePath(init_d, bounds, params.lat_path_optimizer_delta_s, params.max_kappa, &path)) {
+    return false;
+  }
+  return FitPath(init_d, path, params.lat_path_optimizer_delta_s, lat_traj)
+      <= kMaxFitDeviationRatio * params.lat_safety_buffer;
+}
+
+double LateralPathOptimizer::FitPath(const std::array<double, 3> &init_d, const std::vector<double> &path,
+                                     double delta_s, LatticePolynomial *lat_traj) {
+  const auto max_deviation = [&path, delta_s](const LatticePolynomial &polynomial) {
+    double deviation = 0.0;
+    for (size_t i = 0; i < path.size(); ++i) {
+      deviation = std::max(deviation, std::fabs(polynomial.Evaluate(0, static_cast<double>(i) * delta_s) - path[i]));
+    }
+    return deviation;
+  };
+  // the least squares quintic of the whole path follows a nudge around an obstacle, but misses a path settling on
+  // a lat offset well before its end, which the sampled kind of quintic ending parallel to the lane follows
+  double min_deviation = 0.0;
+  *lat_traj = LatticePolynomial::FitQuintic(init_d, path, delta_s, &min_deviation);
+  for (size_t i = kMinNumPoints - 1; i < path.size(); ++i) {
+    const LatticePolynomial polynomial(common::QuinticPolynomial(
+        init_d, std::array<double, 3>{path[i], 0.0, 0.0}, static_cast<double>(i) * delta_s));
+    const double deviation = max_deviation(polynomial);
+    if (deviation < min_deviation) {
+      min_deviation = deviation;
+      *lat_traj = polynomial;
+    }
+  }
+  return min_deviation;
+}
+
+bool LateralPathOptimizer::GetPathBounds(const ReferenceLine &ref_line,
+                                         const STGraph &st_graph,
+                                         const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                         double init_s,
+                                         const PlanningParams &params,
+                                         std::vector<std::pair<double, double>> *bounds) {
+  const double delta_s = params.lat_path_optimizer_delta_s;
+  const double length = std::min(params.lat_path_optimizer_length, ref_line.Length() - init_s);
+  if (bounds == nullptr || delta_s <= 0.0 || length < static_cast<double>(kMinNumPoints - 1) * delta_s) {
+    return false;
+  }
+  const size_t num_points = static_cast<size_t>(std::floor(length / delta_s)) + 1;
+  const double half_width = params.vehicle_params.half_width;
+  const double margin = half_width + params.lat_safety_buffer;
+  bounds->resize(num_points);
+  std::vector<std::pair<double, double>> lane_widths(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    double left_width = 0.0;
+    double right_width = 0.0;
+    if (!ref_line.GetLaneWidth(init_s + static_cast<double>(i) * delta_s, &left_width, &right_width)) {
+      return false;
+    }
+    lane_widths[i] = std::make_pair(right_width, left_width);
+    (*bounds)[i] = std::make_pair(-(right_width - margin), left_width - margin);
+  }
+  const double end_s = init_s + static_cast<double>(num_points - 1) * delta_s;
+  // the ego passes an obstacle with its whole length
+  const double lon_margin = params.vehicle_params.half_length;
+  for (const auto &obstacle : obstacles) {
+    if (obstacle->IsVirtual() || obstacle->Speed() > kMaxStaticObstacleSpeed) {
+      continue;
+    }
+    // the current footprint was projected on the reference line by the st graph already
+    common::SLBoundary sl_boundary;
+    if ((!st_graph.GetObstacleSLBoundary(obstacle->Id(), 0.0, &sl_boundary)
+        && !ref_line.GetSLBoundary(obstacle->GetBoundingBox(), &sl_boundary))
+        || sl_boundary.end_s < init_s || sl_boundary.start_s - lon_margin > end_s) {
+      continue;
+    }
+    const size_t start_index = static_cast<size_t>(
+        std::max(0.0, std::ceil((sl_boundary.start_s - lon_margin - init_s) / delta_s)));
+    const size_t end_index = std::min(
+        num_points - 1, static_cast<size_t>(std::floor((sl_boundary.end_s + lon_margin - init_s) / delta_s)));
+    if (start_index > end_index) {
+      continue;
+    }
+    const size_t middle_index = (start_index + end_index) / 2;
+    if (sl_boundary.start_l > lane_widths[middle_index].second
+        || sl_boundary.end_l < -lane_widths[middle_index].first) {
+      continue;
+    }
+    // pass on the side with more room
+    const double left_room = (*bounds)[middle_index].second - (sl_boundary.end_l + margin);
+    const double right_room = (sl_boundary.start_l - margin) - (*bounds)[middle_index].first;
+    for (size_t i = start_index; i <= end_index; ++i) {
+      if (left_room > right_room) {
+        (*bounds)[i].first = std::max((*bounds)[i].first, sl_boundary.end_l + margin);
+      } else {
+        (*bounds)[i].second = std::min((*bounds)[i].second, sl_boundary.start_l - margin);
+      }
+    }
+  }
+  // the ego may start off the bounds, the pinned initial state lets the QP steer it back
+  for (size_t i = 1; i < num_points; ++i) {
+    if ((*bounds)[i].first > (*bounds)[i].second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LateralPathOptimizer::OptimizePath(const std::array<double, 3> &init_d,
+                                        const std::vector<std::pair<double, double>> &bounds,
+                                        double delta_s, double max_ddl,
+                                        std::vector<double> *path) {
+  const size_t num_points = bounds.size();
+  if (path == nullptr || num_points < kMinNumPoints || delta_s <= 0.0) {
+    return false;
+  }
+  const double ds = delta_s;
+  // l, l' and l'' of every point, then the l' and the l continuity between the points
+  const size_t num_variables = 3 * num_points;
+  const size_t num_constraints = num_variables + 2 * (num_points - 1);
+  const auto l_index = [](size_t i) { return i; };
+  const auto dl_index = [num_points](size_t i) { return num_points + i; };
+  const auto ddl_index = [num_points](size_t i) { return 2 * num_points + i; };
+
+  std::vector<Eigen::Triplet<double>> cost_triplets;
+  cost_triplets.reserve(3 * num_points + 4 * num_points);
+  const Eigen::VectorXd q = Eigen::VectorXd::Zero(num_variables);
+  for (size_t i = 0; i < num_points; ++i) {
+    cost_triplets.emplace_back(l_index(i), l_index(i), 2.0 * kLWeight);
+    cost_triplets.emplace_back(dl_index(i), dl_index(i), 2.0 * kDlWeight);
+    cost_triplets.emplace_back(ddl_index(i), ddl_index(i), 2.0 * kDdlWeight);
+  }
+  const double dddl_weight = 2.0 * kDddlWeight / (ds * ds);
+  for (size_t i = 0; i + 1 < num_points; ++i) {
+    cost_triplets.emplace_back(ddl_index(i), ddl_index(i), dddl_weight);
+    cost_triplets.emplace_back(ddl_index(i + 1), ddl_index(i + 1), dddl_weight);
+    cost_triplets.emplace_back(ddl_index(i), ddl_index(i + 1), -dddl_weight);
+    cost_triplets.emplace_back(ddl_index(i + 1), ddl_index(i), -dddl_weight);
+  }
+  SparseMatrix P(num_variables, num_variables);
+  P.setFromTriplets(cost_triplets.begin(), cost_triplets.end());
+
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(num_variables + 9 * (num_points - 1));
+  Eigen::VectorXd l(num_constraints);
+  Eigen::VectorXd u(num_constraints);
+  for (size_t i = 0; i < num_variables; ++i) {
+    triplets.emplace_back(i, i, 1.0);
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    l[l_index(i)] = bounds[i].first;
+    u[l_index(i)] = bounds[i].second;
+    l[dl_index(i)] = -kInfinity;
+    u[dl_index(i)] = kInfinity;
+    l[ddl_index(i)] = -max_ddl;
+    u[ddl_index(i)] = max_ddl;
+  }
+  l[l_index(0)] = u[l_index(0)] = init_d[0];
+  l[dl_index(0)] = u[dl_index(0)] = init_d[1];
+  l[ddl_index(0)] = u[ddl_index(0)] = init_d[2];
+  l[dl_index(num_points - 1)] = u[dl_index(num_points - 1)] = 0.0;
+  l[ddl_index(num_points - 1)] = u[ddl_index(num_points - 1)] = 0.0;
+  for (size_t i = 0; i + 1 < num_points; ++i) {
+    const size_t dl_row = num_variables + i;
+    triplets.emplace_back(dl_row, dl_index(i + 1), 1.0);
+    triplets.emplace_back(dl_row, dl_index(i), -1.0);
+    triplets.emplace_back(dl_row, ddl_index(i), -0.5 * ds);
+    triplets.emplace_back(dl_row, ddl_index(i + 1), -0.5 * ds);
+    l[dl_row] = u[dl_row] = 0.0;
+    const size_t l_row = num_variables + (num_points - 1) + i;
+    triplets.emplace_back(l_row, l_index(i + 1), 1.0);
+    triplets.emplace_back(l_row, l_index(i), -1.0);
+    triplets.emplace_back(l_row, dl_index(i), -ds);
+    triplets.emplace_back(l_row, ddl_index(i), -ds * ds / 3.0);
+    triplets.emplace_back(l_row, ddl_index(i + 1), -ds * ds / 6.0);
+    l[l_row] = u[l_row] = 0.0;
+  }
+  SparseMatrix A(num_constraints, num_variables);
+  A.setFromTriplets(triplets.begin(), triplets.end());
+
+  if (!solver_.Solve(P, q, A, l, u)) {
+    return false;
+  }
+  const Eigen::VectorXd &x = solver_.x();
+  path->resize(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    (*path)[i] = x[l_index(i)];
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATERAL_PATH_OPTIMIZER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATERAL_PATH_OPTIMIZER_HPP_
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "math/admm_qp_solver.hpp"
+#include "lattice_trajectory1d.hpp"
+#include "planning_config.hpp"
+#include "obstacle_manager/obstacle.hpp"
+#include "obstacle_manager/st_graph.hpp"
+#include "reference_line/reference_line.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the lat motion as one optimized path instead of the sampled end conditions. a piecewise jerk QP over
+ * l, l' and l'' at the points i * delta_s keeps l(s) inside the lane and passes the static obstacles on the side
+ * with more room. kept per reference line, the solver warm starts from the path of the last cycle.
+ */
+class LateralPathOptimizer {
+ public:
+  LateralPathOptimizer() = default;
+  ~LateralPathOptimizer() = default;
+
+  /**
+   * @brief: optimize the lat path and fit it by a quintic, so it pairs with the lon trajectories like the sampled ones
+   * @param ref_line
+   * @param st_graph: the st graph on ref_line, whose memoized sl boundaries of the obstacles are reused
+   * @param obstacles
+   * @param init_s: s, s_dot, s_ddot
+   * @param init_d: d, d', d'' with respect to s
+   * @param params: the parameters of the planning cycle
+   * @param lat_traj: [out]
+   * @return: false if the bounds leave no way, the QP does not converge or the quintic misses the path
+   */
+  bool Optimize(const ReferenceLine &ref_line,
+                const STGraph &st_graph,
+                const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                const std::array<double, 3> &init_s,
+                const std::array<double, 3> &init_d,
+                const PlanningParams &params,
+                LatticePolynomial *lat_traj);
+
+  /**
+   * @brief: the bounds of l at the points init_s + i * delta_s, the lane shrunk by the ego half width and the lat
+   * safety buffer, cut by the static obstacles
+   * @param bounds: [out] lower and upper bound per point
+   * @return: false if the lane width is unknown or a point has no room left
+   */
+  static bool GetPathBounds(const ReferenceLine &ref_line,
+                            const STGraph &st_graph,
+                            const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                            double init_s,
+                            const PlanningParams &params,
+                            std::vector<std::pair<double, double>> *bounds);
+
+  /**
+   * @brief: the piecewise jerk QP, from init_d to the end of the bounds where the path runs parallel to the lane
+   * @param init_d: d, d', d'' with respect to s
+   * @param bounds: lower and upper bound of l per point
+   * @param delta_s: the distance between the points
+   * @param max_ddl: the bound of |l''|
+   * @param path: [out] l per point
+   */
+  bool OptimizePath(const std::array<double, 3> &init_d,
+                    const std::vector<std::pair<double, double>> &bounds,
+                    double delta_s, double max_ddl,
+                    std::vector<double> *path);
+
+  /**
+   * @brief: the quintic closest to the path, the least squares one or one ending parallel to the lane at a point
+   * @param init_d: d, d', d'' with respect to s
+   * @param path: l at the points i * delta_s
+   * @param delta_s
+   * @param lat_traj: [out]
+   * @return: the largest deviation from the path, infinity if it has too few points
+   */
+  static double FitPath(const std::array<double, 3> &init_d, const std::vector<double> &path, double delta_s,
+                        LatticePolynomial *lat_traj);
+
+ private:
+  common::AdmmQpSolver solver_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATERAL_PATH_OPTIMIZER_HPP_
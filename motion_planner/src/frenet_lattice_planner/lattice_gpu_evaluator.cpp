@@ -0,0 +1,54 @@
+#include "frenet_lattice_planner/lattice_gpu_evaluator.hpp"
+#include <algorithm>
+
+namespace planning {
+
+#ifndef MOTION_PLANNER_WITH_CUDA
+bool LatticeGpuEvaluator::IsAvailable() {
+  return false;
+}
+
+bool LatticeGpuEvaluator::EvaluatePairs(const LatticePairBatch &batch, std::vector<ScoredLatticePair> *pairs) {
+  return false;
+}
+#endif
+
+void LatticeGpuEvaluator::EvaluatePairsOnHost(const LatticePairBatch &batch, common::ThreadPool *thread_pool,
+                                              std::vector<ScoredLatticePair> *pairs) {
+  if (pairs == nullptr) {
+    return;
+  }
+  const LatticePairBatchView view = batch.View();
+  const size_t num_lat = batch.num_lat;
+  // costs[lon_index * num_lat + lat_index], the invalid pairs are dropped afterwards
+  std::vector<double> costs(batch.NumOfPairs(), 0.0);
+  std::vector<char> is_valid(batch.NumOfPairs(), 0);
+  auto evaluate_lon_trajectory = [&view, &costs, &is_valid, num_lat](size_t lon_index) {
+    for (size_t j = 0; j < num_lat; ++j) {
+      const size_t pair_index = lon_index * num_lat + j;
+      is_valid[pair_index] = EvaluateLatticePair(view, lon_index, j, &costs[pair_index]) ? 1 : 0;
+    }
+  };
+  if (thread_pool != nullptr) {
+    const size_t grain = std::max<size_t>(1, batch.num_lon / (4 * static_cast<size_t>(thread_pool->Size())));
+    thread_pool->ParallelFor(0, batch.num_lon, grain, evaluate_lon_trajectory);
+  } else {
+    for (size_t i = 0; i < batch.num_lon; ++i) {
+      evaluate_lon_trajectory(i);
+    }
+  }
+  pairs->clear();
+  pairs->reserve(std::count(is_valid.begin(), is_valid.end(), 1));
+  for (size_t pair_index = 0; pair_index < costs.size(); ++pair_index) {
+    if (!is_valid[pair_index]) {
+      continue;
+    }
+    ScoredLatticePair pair;
+    pair.lon_index = static_cast<uint32_t>(pair_index / num_lat);
+    pair.lat_index = static_cast<uint32_t>(pair_index % num_lat);
+    pair.cost = costs[pair_index];
+    pairs->push_back(pair);
+  }
+}
+
+}
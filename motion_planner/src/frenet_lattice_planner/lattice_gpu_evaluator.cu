@@ -0,0 +1,140 @@
+#include "frenet_lattice_planner/lattice_gpu_evaluator.hpp"
+#include <cuda_runtime.h>
+#include <thrust/copy.h>
+#include <thrust/device_vector.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/sort.h>
+#include <thrust/system_error.h>
+
+namespace planning {
+namespace {
+constexpr unsigned int kThreadsPerBlock = 256;
+
+/**
+ * @brief: the arrays of a LatticePairBatch on the device
+ */
+struct DeviceBatch {
+  thrust::device_vector<double> lon_s;
+  thrust::device_vector<double> lon_s_dot;
+  thrust::device_vector<double> lon_s_ddot;
+  thrust::device_vector<uint32_t> lon_num_cost_steps;
+  thrust::device_vector<uint32_t> lon_num_check_steps;
+  thrust::device_vector<double> lon_costs;
+  thrust::device_vector<double> lon_min_s;
+  thrust::device_vector<double> lon_max_s;
+  thrust::device_vector<double> lon_offset_horizons;
+  thrust::device_vector<char> lon_seeded;
+  thrust::device_vector<double> lat_coefs;
+  thrust::device_vector<double> lat_param_lengths;
+  thrust::device_vector<double> lat_offset_starts;
+  thrust::device_vector<double> lat_sample_s;
+  thrust::device_vector<double> lat_offsets;
+  thrust::device_vector<uint32_t> lat_critical_offsets;
+  thrust::device_vector<double> lat_critical_params;
+  thrust::device_vector<char> lat_seeded;
+};
+
+template<class T>
+const T *Upload(const std::vector<T> &host, thrust::device_vector<T> *device) {
+  device->assign(host.begin(), host.end());
+  return thrust::raw_pointer_cast(device->data());
+}
+
+/**
+ * @brief: upload the arrays of batch, the view refers to them on the device
+ */
+LatticePairBatchView Upload(const LatticePairBatch &batch, DeviceBatch *device) {
+  LatticePairBatchView view = batch.View();
+  view.lon_s = Upload(batch.lon_s, &device->lon_s);
+  view.lon_s_dot = Upload(batch.lon_s_dot, &device->lon_s_dot);
+  view.lon_s_ddot = Upload(batch.lon_s_ddot, &device->lon_s_ddot);
+  view.lon_num_cost_steps = Upload(batch.lon_num_cost_steps, &device->lon_num_cost_steps);
+  view.lon_num_check_steps = Upload(batch.lon_num_check_steps, &device->lon_num_check_steps);
+  view.lon_costs = Upload(batch.lon_costs, &device->lon_costs);
+  view.lon_min_s = Upload(batch.lon_min_s, &device->lon_min_s);
+  view.lon_max_s = Upload(batch.lon_max_s, &device->lon_max_s);
+  view.lon_offset_horizons = Upload(batch.lon_offset_horizons, &device->lon_offset_horizons);
+  view.lon_seeded = Upload(batch.lon_seeded, &device->lon_seeded);
+  view.lat_coefs = Upload(batch.lat_coefs, &device->lat_coefs);
+  view.lat_param_lengths = Upload(batch.lat_param_lengths, &device->lat_param_lengths);
+  view.lat_offset_starts = Upload(batch.lat_offset_starts, &device->lat_offset_starts);
+  view.lat_sample_s = Upload(batch.lat_sample_s, &device->lat_sample_s);
+  view.lat_offsets = Upload(batch.lat_offsets, &device->lat_offsets);
+  view.lat_critical_offsets = Upload(batch.lat_critical_offsets, &device->lat_critical_offsets);
+  view.lat_critical_params = Upload(batch.lat_critical_params, &device->lat_critical_params);
+  view.lat_seeded = Upload(batch.lat_seeded, &device->lat_seeded);
+  return view;
+}
+
+__global__ void EvaluatePairsKernel(LatticePairBatchView batch, double *costs, char *is_valid) {
+  const size_t pair_index = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (pair_index >= batch.num_lon * batch.num_lat) {
+    return;
+  }
+  is_valid[pair_index] =
+      EvaluateLatticePair(batch, pair_index / batch.num_lat, pair_index % batch.num_lat, &costs[pair_index]) ? 1 : 0;
+}
+
+struct IsValidPair {
+  __host__ __device__ bool operator()(char is_valid) const { return is_valid != 0; }
+};
+}
+
+bool LatticeGpuEvaluator::IsAvailable() {
+  static const bool is_available = []() {
+    int num_devices = 0;
+    return cudaGetDeviceCount(&num_devices) == cudaSuccess && num_devices > 0;
+  }();
+  return is_available;
+}
+
+bool LatticeGpuEvaluator::EvaluatePairs(const LatticePairBatch &batch, std::vector<ScoredLatticePair> *pairs) {
+  if (pairs == nullptr || !IsAvailable()) {
+    return false;
+  }
+  pairs->clear();
+  const size_t num_pairs = batch.NumOfPairs();
+  if (num_pairs == 0) {
+    return true;
+  }
+  try {
+    DeviceBatch device_batch;
+    const LatticePairBatchView view = Upload(batch, &device_batch);
+    thrust::device_vector<double> costs(num_pairs);
+    thrust::device_vector<char> is_valid(num_pairs);
+    const auto num_blocks = static_cast<unsigned int>((num_pairs + kThreadsPerBlock - 1) / kThreadsPerBlock);
+    EvaluatePairsKernel<<<num_blocks, kThreadsPerBlock>>>(view, thrust::raw_pointer_cast(costs.data()),
+                                                          thrust::raw_pointer_cast(is_valid.data()));
+    if (cudaGetLastError() != cudaSuccess) {
+      return false;
+    }
+    // compact the valid pairs in the order of their index, the stable sort keeps that order among equal costs
+    thrust::device_vector<uint32_t> pair_indices(num_pairs);
+    const auto last = thrust::copy_if(thrust::counting_iterator<uint32_t>(0),
+                                      thrust::counting_iterator<uint32_t>(static_cast<uint32_t>(num_pairs)),
+                                      is_valid.begin(), pair_indices.begin(), IsValidPair());
+    pair_indices.resize(last - pair_indices.begin());
+    thrust::device_vector<double> valid_costs(pair_indices.size());
+    thrust::gather(pair_indices.begin(), pair_indices.end(), costs.begin(), valid_costs.begin());
+    thrust::stable_sort_by_key(valid_costs.begin(), valid_costs.end(), pair_indices.begin());
+
+    std::vector<uint32_t> host_pair_indices(pair_indices.size());
+    std::vector<double> host_costs(valid_costs.size());
+    thrust::copy(pair_indices.begin(), pair_indices.end(), host_pair_indices.begin());
+    thrust::copy(valid_costs.begin(), valid_costs.end(), host_costs.begin());
+    pairs->resize(host_pair_indices.size());
+    for (size_t i = 0; i < host_pair_indices.size(); ++i) {
+      auto &pair = (*pairs)[i];
+      pair.lon_index = static_cast<uint32_t>(host_pair_indices[i] / batch.num_lat);
+      pair.lat_index = static_cast<uint32_t>(host_pair_indices[i] % batch.num_lat);
+      pair.cost = host_costs[i];
+    }
+  } catch (const thrust::system_error &) {
+    pairs->clear();
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_GPU_EVALUATOR_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_GPU_EVALUATOR_HPP_
+#include <vector>
+#include "lattice_pair_kernel.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+namespace planning {
+
+/**
+ * @brief: scores every pair of a LatticePairBatch with EvaluateLatticePair. on the device the batch is uploaded
+ * once, every pair is scored by one thread of a single kernel launch and the valid pairs come back sorted by their
+ * cost. the device part is only built if CUDA is available, see MOTION_PLANNER_WITH_CUDA.
+ */
+class LatticeGpuEvaluator {
+ public:
+  /**
+   * @brief: whether the planner is built with CUDA and a device is present
+   */
+  static bool IsAvailable();
+
+  /**
+   * @brief: score the pairs on the device
+   * @param batch
+   * @param pairs: [out] the valid pairs sorted by their cost, the ties by their lon and lat index
+   * @return: false if no device is available or a CUDA call failed
+   */
+  static bool EvaluatePairs(const LatticePairBatch &batch, std::vector<ScoredLatticePair> *pairs);
+
+  /**
+   * @brief: score the pairs on the host with the same kernel, the blocks of lon trajectories in parallel if
+   * thread_pool is set
+   * @param batch
+   * @param thread_pool
+   * @param pairs: [out] the valid pairs in the order of their lon and lat index
+   */
+  static void EvaluatePairsOnHost(const LatticePairBatch &batch, common::ThreadPool *thread_pool,
+                                  std::vector<ScoredLatticePair> *pairs);
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_GPU_EVALUATOR_HPP_
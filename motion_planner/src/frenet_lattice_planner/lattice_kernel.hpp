@@ -0,0 +1,51 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_LATTICE_KERNEL_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_LATTICE_KERNEL_HPP_
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+namespace planning {
+/**
+ * @brief: the reductions of the cost terms over the first steps of the time grid. LatticeKernel<N> is the build for a
+ * horizon of N steps, its loops have a constant trip count the compiler unrolls and vectorizes; LatticeKernel<0> is
+ * the runtime-generic fallback which takes the count from the caller.
+ * @tparam N: the number of steps, 0 for a runtime count
+ */
+template<size_t N>
+struct LatticeKernel {
+  static size_t NumSteps(size_t num_steps) { return N == 0 ? num_steps : N; }
+
+  /**
+   * @brief: sum(cost^2) / (sum(|cost|) + eps) of the costs func(i) over the steps
+   */
+  template<class Func>
+  static double SquareOverAbsSum(size_t num_steps, double eps, Func &&func) {
+    const size_t n = NumSteps(num_steps);
+    double cost_sqr_sum = 0.0;
+    double cost_abs_sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      const double cost = func(i);
+      cost_sqr_sum += cost * cost;
+      cost_abs_sum += std::fabs(cost);
+    }
+    return cost_sqr_sum / (cost_abs_sum + eps);
+  }
+
+  /**
+   * @brief: max(|func(i)|) over the steps, 0 if there is none
+   */
+  template<class Func>
+  static double MaxAbs(size_t num_steps, Func &&func) {
+    const size_t n = NumSteps(num_steps);
+    double max_abs = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      max_abs = std::max(max_abs, std::fabs(func(i)));
+    }
+    return max_abs;
+  }
+};
+
+// the specialized horizon, 8 s at 0.1 s of the default config
+constexpr size_t kFixedHorizonSteps = 80;
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_LATTICE_KERNEL_HPP_
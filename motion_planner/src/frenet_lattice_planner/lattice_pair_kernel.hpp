@@ -0,0 +1,264 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_PAIR_KERNEL_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_PAIR_KERNEL_HPP_
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef __CUDACC__
+#define LATTICE_HOST_DEVICE __host__ __device__
+#else
+#define LATTICE_HOST_DEVICE
+#endif
+
+namespace planning {
+
+/**
+ * @brief: a valid pair of the batch with its cost
+ */
+struct ScoredLatticePair {
+  uint32_t lon_index = 0;
+  uint32_t lat_index = 0;
+  double cost = 0.0;
+};
+
+/**
+ * @brief: the raw arrays of a LatticePairBatch, on the host or on the device
+ */
+struct LatticePairBatchView {
+  size_t num_lon = 0;
+  size_t num_lat = 0;
+  size_t num_lon_samples = 0;
+  size_t num_lat_samples = 0;
+  double init_s = 0.0;
+  double max_lat_offset = 0.0;
+  double lat_jerk_weight = 0.0;
+  double lat_offset_weight = 0.0;
+  double same_side_offset_weight = 0.0;
+  double opposite_side_offset_weight = 0.0;
+  double seed_discount = 0.0;
+  const double *lon_s = nullptr;
+  const double *lon_s_dot = nullptr;
+  const double *lon_s_ddot = nullptr;
+  const uint32_t *lon_num_cost_steps = nullptr;
+  const uint32_t *lon_num_check_steps = nullptr;
+  const double *lon_costs = nullptr;
+  const double *lon_min_s = nullptr;
+  const double *lon_max_s = nullptr;
+  const double *lon_offset_horizons = nullptr;
+  const char *lon_seeded = nullptr;
+  const double *lat_coefs = nullptr;
+  const double *lat_param_lengths = nullptr;
+  const double *lat_offset_starts = nullptr;
+  const double *lat_sample_s = nullptr;
+  const double *lat_offsets = nullptr;
+  const uint32_t *lat_critical_offsets = nullptr;
+  const double *lat_critical_params = nullptr;
+  const char *lat_seeded = nullptr;
+};
+
+/**
+ * @brief: the kept lon and lat trajectories of a PolynomialTrajectoryEvaluator as flat arrays, everything the lat
+ * bound check and the lat cost terms of a pair read. the lon arrays hold num_lon_samples per trajectory, padded
+ * behind its samples, the lat offsets num_lat_samples per trajectory on the common s grid lat_sample_s.
+ */
+struct LatticePairBatch {
+  static constexpr size_t kNumCoefs = 6;
+
+  size_t num_lon = 0;
+  size_t num_lat = 0;
+  size_t num_lon_samples = 0;
+  size_t num_lat_samples = 0;
+  double init_s = 0.0;
+  double max_lat_offset = 0.0;
+  double lat_jerk_weight = 0.0;
+  double lat_offset_weight = 0.0;
+  double same_side_offset_weight = 0.0;
+  double opposite_side_offset_weight = 0.0;
+  // the discount of a seeded lon and a seeded lat trajectory, 0 without a warm start
+  double seed_discount = 0.0;
+  // s, s_dot and s_ddot on the time grid
+  std::vector<double> lon_s;
+  std::vector<double> lon_s_dot;
+  std::vector<double> lon_s_ddot;
+  // the steps of the lat jerk cost
+  std::vector<uint32_t> lon_num_cost_steps;
+  // the steps within the param length, the lat bound is checked on
+  std::vector<uint32_t> lon_num_check_steps;
+  std::vector<double> lon_costs;
+  // the lowest and highest sampled s within the param length
+  std::vector<double> lon_min_s;
+  std::vector<double> lon_max_s;
+  // the s the lat offset cost is summed up to
+  std::vector<double> lon_offset_horizons;
+  std::vector<char> lon_seeded;
+  // kNumCoefs per lat trajectory
+  std::vector<double> lat_coefs;
+  std::vector<double> lat_param_lengths;
+  std::vector<double> lat_offset_starts;
+  std::vector<double> lat_sample_s;
+  std::vector<double> lat_offsets;
+  // the critical params of the j-th lat trajectory are [lat_critical_offsets[j], lat_critical_offsets[j + 1])
+  std::vector<uint32_t> lat_critical_offsets;
+  std::vector<double> lat_critical_params;
+  std::vector<char> lat_seeded;
+
+  size_t NumOfPairs() const { return num_lon * num_lat; }
+
+  /**
+   * @brief: the view of the host arrays
+   */
+  LatticePairBatchView View() const {
+    LatticePairBatchView view;
+    view.num_lon = num_lon;
+    view.num_lat = num_lat;
+    view.num_lon_samples = num_lon_samples;
+    view.num_lat_samples = num_lat_samples;
+    view.init_s = init_s;
+    view.max_lat_offset = max_lat_offset;
+    view.lat_jerk_weight = lat_jerk_weight;
+    view.lat_offset_weight = lat_offset_weight;
+    view.same_side_offset_weight = same_side_offset_weight;
+    view.opposite_side_offset_weight = opposite_side_offset_weight;
+    view.seed_discount = seed_discount;
+    view.lon_s = lon_s.data();
+    view.lon_s_dot = lon_s_dot.data();
+    view.lon_s_ddot = lon_s_ddot.data();
+    view.lon_num_cost_steps = lon_num_cost_steps.data();
+    view.lon_num_check_steps = lon_num_check_steps.data();
+    view.lon_costs = lon_costs.data();
+    view.lon_min_s = lon_min_s.data();
+    view.lon_max_s = lon_max_s.data();
+    view.lon_offset_horizons = lon_offset_horizons.data();
+    view.lon_seeded = lon_seeded.data();
+    view.lat_coefs = lat_coefs.data();
+    view.lat_param_lengths = lat_param_lengths.data();
+    view.lat_offset_starts = lat_offset_starts.data();
+    view.lat_sample_s = lat_sample_s.data();
+    view.lat_offsets = lat_offsets.data();
+    view.lat_critical_offsets = lat_critical_offsets.data();
+    view.lat_critical_params = lat_critical_params.data();
+    view.lat_seeded = lat_seeded.data();
+    return view;
+  }
+};
+
+/**
+ * @brief: LatticePolynomial::Evaluate on the coefs, the same operations so host and device agree with it
+ */
+LATTICE_HOST_DEVICE inline double EvaluateLatticeCoefs(const double *coefs, double param_length, size_t derivative,
+                                                       double param) {
+  const auto evaluate = [coefs](size_t order, double p) {
+    switch (order) {
+      case 0:
+        return ((((coefs[5] * p + coefs[4]) * p + coefs[3]) * p + coefs[2]) * p + coefs[1]) * p + coefs[0];
+      case 1:
+        return (((5.0 * coefs[5] * p + 4.0 * coefs[4]) * p + 3.0 * coefs[3]) * p + 2.0 * coefs[2]) * p + coefs[1];
+      case 2:return (((20.0 * coefs[5] * p + 12.0 * coefs[4]) * p) + 6.0 * coefs[3]) * p + 2.0 * coefs[2];
+      default:return 0.0;
+    }
+  };
+  if (param < param_length) {
+    return evaluate(derivative, param);
+  }
+  const double p = evaluate(0, param_length);
+  const double v = evaluate(1, param_length);
+  const double a = evaluate(2, param_length);
+  const double t = param - param_length;
+  switch (derivative) {
+    case 0:return p + v * t + 0.5 * a * t * t;
+    case 1:return v + a * t;
+    case 2:return a;
+    default:return 0.0;
+  }
+}
+
+/**
+ * @brief: ConstraintChecker::WithInRange with its default tolerance
+ */
+LATTICE_HOST_DEVICE inline bool LatticeWithInRange(double value, double lower, double upper) {
+  constexpr double kEps = 1e-2;
+  return value > lower - kEps && value < upper + kEps;
+}
+
+/**
+ * @brief: the lat bound check and the cost of one pair, the operations of PolynomialTrajectoryEvaluator in the
+ * same order
+ * @param batch
+ * @param lon_index
+ * @param lat_index
+ * @param cost: [out] the cost of the pair if it is valid
+ * @return: false if the lat trajectory leaves the lat bound over the s range of the lon trajectory
+ */
+LATTICE_HOST_DEVICE inline bool EvaluateLatticePair(const LatticePairBatchView &batch, size_t lon_index,
+                                                    size_t lat_index, double *cost) {
+  const double *coefs = batch.lat_coefs + lat_index * LatticePairBatch::kNumCoefs;
+  const double param_length = batch.lat_param_lengths[lat_index];
+  const double *lon_s = batch.lon_s + lon_index * batch.num_lon_samples;
+  const double max_lat_offset = batch.max_lat_offset;
+  const double min_s = batch.lon_min_s[lon_index];
+  const double max_s = batch.lon_max_s[lon_index];
+  if (min_s <= max_s) {
+    if (!LatticeWithInRange(EvaluateLatticeCoefs(coefs, param_length, 0, min_s), -max_lat_offset, max_lat_offset)
+        || !LatticeWithInRange(EvaluateLatticeCoefs(coefs, param_length, 0, max_s), -max_lat_offset,
+                               max_lat_offset)) {
+      return false;
+    }
+    bool is_within_bound = true;
+    for (uint32_t k = batch.lat_critical_offsets[lat_index]; k < batch.lat_critical_offsets[lat_index + 1]; ++k) {
+      const double s = batch.lat_critical_params[k];
+      if (s > min_s && s < max_s
+          && !LatticeWithInRange(EvaluateLatticeCoefs(coefs, param_length, 0, s), -max_lat_offset, max_lat_offset)) {
+        is_within_bound = false;
+        break;
+      }
+    }
+    if (!is_within_bound) {
+      for (uint32_t i = 0; i < batch.lon_num_check_steps[lon_index]; ++i) {
+        if (!LatticeWithInRange(EvaluateLatticeCoefs(coefs, param_length, 0, lon_s[i]), -max_lat_offset,
+                                max_lat_offset)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // the lat offset cost on the s grid of the lat sample table
+  const double *lat_offsets = batch.lat_offsets + lat_index * batch.num_lat_samples;
+  const double evaluation_horizon = batch.lon_offset_horizons[lon_index];
+  const double lat_offset_start = batch.lat_offset_starts[lat_index];
+  double cost_sqr_sum = 0.0;
+  double cost_abs_sum = 0.0;
+  for (size_t i = 0; i < batch.num_lat_samples && batch.lat_sample_s[i] < evaluation_horizon; ++i) {
+    const double lat_offset = lat_offsets[i];
+    const double offset_cost = lat_offset / 3.0;
+    if (lat_offset * lat_offset_start < 0.0) {
+      cost_sqr_sum += offset_cost * offset_cost * batch.opposite_side_offset_weight;
+      cost_abs_sum += fabs(offset_cost) * batch.opposite_side_offset_weight;
+    } else {
+      cost_sqr_sum += offset_cost * offset_cost * batch.same_side_offset_weight;
+      cost_abs_sum += fabs(offset_cost) * batch.same_side_offset_weight;
+    }
+  }
+  const double lat_offset_cost = cost_sqr_sum / (cost_abs_sum + 1e-5);
+
+  // the lat jerk cost at the s of the lon trajectory on the time grid
+  const double *lon_s_dot = batch.lon_s_dot + lon_index * batch.num_lon_samples;
+  const double *lon_s_ddot = batch.lon_s_ddot + lon_index * batch.num_lon_samples;
+  double lat_jerk_cost = 0.0;
+  for (uint32_t i = 0; i < batch.lon_num_cost_steps[lon_index]; ++i) {
+    const double relative_s = lon_s[i] - batch.init_s;
+    const double l_prime = EvaluateLatticeCoefs(coefs, param_length, 1, relative_s);
+    const double l_primeprime = EvaluateLatticeCoefs(coefs, param_length, 2, relative_s);
+    const double lat_jerk = fabs(l_primeprime * lon_s_dot[i] * lon_s_dot[i] + l_prime * lon_s_ddot[i]);
+    lat_jerk_cost = lat_jerk_cost < lat_jerk ? lat_jerk : lat_jerk_cost;
+  }
+
+  const double seed_discount = batch.lon_seeded[lon_index] && batch.lat_seeded[lat_index] ? batch.seed_discount : 0.0;
+  *cost = batch.lon_costs[lon_index]
+      + (lat_jerk_cost * batch.lat_jerk_weight + lat_offset_cost * batch.lat_offset_weight) - seed_discount;
+  return true;
+}
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_LATTICE_PAIR_KERNEL_HPP_
@@ -1,31 +1,105 @@
 #include "frenet_lattice_planner/lattice_trajectory1d.hpp"
 
-#include <utility>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ros/assert.h>
+#include "curves/polynomial_kernel.hpp"
 namespace planning {
-LatticeTrajectory1d::LatticeTrajectory1d(std::shared_ptr<Polynomial> ptr_trajectory1d)
-    : ptr_trajectory1d_(std::move(ptr_trajectory1d)) {
+constexpr size_t LatticePolynomial::kMaxOrder;
+
+LatticePolynomial::LatticePolynomial(const common::Polynomial &polynomial)
+    : order(polynomial.Order()), param_length(polynomial.ParamLength()) {
+  ROS_ASSERT(order <= kMaxOrder);
+  for (size_t i = 0; i <= order; ++i) {
+    coefs[i] = polynomial.Coef(i);
+  }
+}
+
+LatticePolynomial LatticePolynomial::FitQuintic(const std::array<double, 3> &init, const std::vector<double> &samples,
+                                                double delta, double *max_deviation) {
+  LatticePolynomial polynomial;
+  polynomial.order = 5;
+  polynomial.coefs = {{init[0], init[1], 0.5 * init[2], 0.0, 0.0, 0.0}};
+  const size_t num_samples = samples.size();
+  if (num_samples < 4 || delta <= 0.0) {
+    *max_deviation = std::numeric_limits<double>::infinity();
+    return polynomial;
+  }
+  polynomial.param_length = static_cast<double>(num_samples - 1) * delta;
+  // the initial state fixes the coefs up to the 2nd order, the others are fitted in the normalized param p / T
+  Eigen::MatrixXd design(num_samples - 1, 3);
+  Eigen::VectorXd residual(num_samples - 1);
+  for (size_t i = 1; i < num_samples; ++i) {
+    const double p = static_cast<double>(i) * delta;
+    const double tau = p / polynomial.param_length;
+    design(i - 1, 0) = tau * tau * tau;
+    design(i - 1, 1) = design(i - 1, 0) * tau;
+    design(i - 1, 2) = design(i - 1, 1) * tau;
+    residual[i - 1] = samples[i] - polynomial.EvaluatePolynomial(0, p);
+  }
+  const Eigen::Vector3d normalized_coefs = design.colPivHouseholderQr().solve(residual);
+  for (size_t k = 0; k < 3; ++k) {
+    polynomial.coefs[k + 3] = normalized_coefs[k] / std::pow(polynomial.param_length, static_cast<double>(k + 3));
+  }
+  *max_deviation = 0.0;
+  for (size_t i = 0; i < num_samples; ++i) {
+    const double p = static_cast<double>(i) * delta;
+    *max_deviation = std::max(*max_deviation, std::fabs(polynomial.EvaluatePolynomial(0, p) - samples[i]));
+  }
+  return polynomial;
+}
+
+LatticeTrajectory1d::LatticeTrajectory1d(const LatticePolynomial &polynomial, common::MonotonicArena *arena)
+    : polynomial_(polynomial), sample_params_(common::ArenaAllocator<double>(arena)) {
+  // the allocator propagates on assignment, so the value tables take the arena of the empty one
+  sample_values_.fill(sample_params_);
 }
 
-double LatticeTrajectory1d::ParamLength() const {
-  return ptr_trajectory1d_->ParamLength();
+void LatticeTrajectory1d::BuildSampleTable(double delta, double max_param) {
+  sample_params_.clear();
+  for (auto &values : sample_values_) {
+    values.clear();
+  }
+  if (delta <= 0.0 || max_param < 0.0) {
+    return;
+  }
+  // counted from the ratio, the tolerance keeps an exact multiple of delta in the grid
+  const auto num_samples = static_cast<size_t>(max_param / delta + 1e-6) + 1;
+  sample_params_.resize(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    sample_params_[i] = static_cast<double>(i) * delta;
+  }
+  EvaluateSampleTable();
 }
-double LatticeTrajectory1d::Evaluate(size_t order, double param) const {
-  double param_length = ptr_trajectory1d_->ParamLength();
-  if (param < param_length) {
-    return ptr_trajectory1d_->Evaluate(order, param);
-  }
-  double p = ptr_trajectory1d_->Evaluate(0, param_length);
-  double v = ptr_trajectory1d_->Evaluate(1, param_length);
-  double a = ptr_trajectory1d_->Evaluate(2, param_length);
-  double t = param - param_length;
-  switch (order) {
-    case 0:return p + v * t + 0.5 * a * t * t;
-    case 1:return v + a * t;
-    case 2:return a;
-    default:return 0.0;
+
+void LatticeTrajectory1d::BuildSampleTable(const std::vector<double> &params, double max_param) {
+  // the same tolerance as the uniform grid, a param equal to max_param up to rounding is sampled
+  const auto last = std::upper_bound(params.begin(), params.end(), max_param + 1e-6);
+  sample_params_.assign(params.begin(), last);
+  EvaluateSampleTable();
+}
+
+void LatticeTrajectory1d::EvaluateSampleTable() {
+  // the params within the polynomial are evaluated by the batch kernel, the extension beyond one by one.
+  const double param_length = polynomial_.param_length;
+  const auto num_in_polynomial = static_cast<size_t>(
+      std::lower_bound(sample_params_.begin(), sample_params_.end(), param_length) - sample_params_.begin());
+  std::array<double *, kMaxSampleOrder + 1> value_ptrs{};
+  for (size_t order = 0; order <= kMaxSampleOrder; ++order) {
+    sample_values_[order].resize(sample_params_.size());
+    value_ptrs[order] = sample_values_[order].data();
+  }
+  common::PolynomialKernel::Evaluate(polynomial_.coefs.data(), polynomial_.order, sample_params_.data(),
+                                     num_in_polynomial, kMaxSampleOrder, value_ptrs.data());
+  for (size_t i = num_in_polynomial; i < sample_params_.size(); ++i) {
+    for (size_t order = 0; order <= kMaxSampleOrder; ++order) {
+      sample_values_[order][i] = polynomial_.Evaluate(order, sample_params_[i]);
+    }
   }
 }
-size_t LatticeTrajectory1d::Order() const { return ptr_trajectory1d_->Order(); }
-double LatticeTrajectory1d::Coef(size_t order) const { return ptr_trajectory1d_->Coef(order); }
+
+constexpr size_t LatticeTrajectory1d::kMaxSampleOrder;
 
 }
@@ -1,18 +1,130 @@
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_LATTICE_TRAJECTORY1D_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_LATTICE_TRAJECTORY1D_HPP_
 #include "curves/polynomial.hpp"
+#include "memory/monotonic_arena.hpp"
+#include <array>
 #include <memory>
+#include <vector>
 namespace planning {
-class LatticeTrajectory1d : public common::Polynomial {
+
+/**
+ * @brief: the coefs of a sampled quartic or quintic trajectory in one cache line. held by value, so the sampled
+ * trajectories lie contiguously in a vector and are evaluated without a virtual call. beyond the param length the
+ * trajectory goes on with the acceleration at its end.
+ */
+struct LatticePolynomial {
+  LatticePolynomial() = default;
+
+  /**
+   * @brief: copy the coefs of a polynomial of at most the 5th order
+   */
+  explicit LatticePolynomial(const common::Polynomial &polynomial);
+
+  /**
+   * @brief: the quintic through the initial state closest to the samples in the least squares sense, its param
+   * length is that of the last sample
+   * @param init: the value, 1st and 2nd derivative at 0
+   * @param samples: the values at 0, delta, 2 * delta, ...
+   * @param delta
+   * @param max_deviation: [out] the largest deviation from the samples, infinity if there are too few to fit
+   */
+  static LatticePolynomial FitQuintic(const std::array<double, 3> &init, const std::vector<double> &samples,
+                                      double delta, double *max_deviation);
+
+  double Evaluate(size_t derivative, double param) const;
+  double ParamLength() const { return param_length; }
+
+  /**
+   * @brief: the derivative of the polynomial itself, also beyond the param length. the horner scheme of
+   * QuinticPolynomial, with the zero 5th order coef of a quartic it is bit-identical to QuarticPolynomial.
+   */
+  double EvaluatePolynomial(size_t derivative, double p) const;
+
+  static constexpr size_t kMaxOrder = 5;
+  size_t order = 0;
+  double param_length = 0.0;
+  // f = sum(coefs[i] * x^i), the coefs above the order are zero
+  std::array<double, kMaxOrder + 1> coefs{{0.0, 0.0, 0.0, 0.0, 0.0, 0.0}};
+};
+
+inline double LatticePolynomial::EvaluatePolynomial(size_t derivative, double p) const {
+  switch (derivative) {
+    case 0:
+      return ((((coefs[5] * p + coefs[4]) * p + coefs[3]) * p + coefs[2]) * p + coefs[1]) * p + coefs[0];
+    case 1:
+      return (((5.0 * coefs[5] * p + 4.0 * coefs[4]) * p + 3.0 * coefs[3]) * p + 2.0 * coefs[2]) * p + coefs[1];
+    case 2:return (((20.0 * coefs[5] * p + 12.0 * coefs[4]) * p) + 6.0 * coefs[3]) * p + 2.0 * coefs[2];
+    case 3:return (60.0 * coefs[5] * p + 24.0 * coefs[4]) * p + 6.0 * coefs[3];
+    case 4:return 120.0 * coefs[5] * p + 24.0 * coefs[4];
+    case 5:return 120.0 * coefs[5];
+    default:return 0.0;
+  }
+}
+
+inline double LatticePolynomial::Evaluate(size_t derivative, double param) const {
+  if (param < param_length) {
+    return EvaluatePolynomial(derivative, param);
+  }
+  const double p = EvaluatePolynomial(0, param_length);
+  const double v = EvaluatePolynomial(1, param_length);
+  const double a = EvaluatePolynomial(2, param_length);
+  const double t = param - param_length;
+  switch (derivative) {
+    case 0:return p + v * t + 0.5 * a * t * t;
+    case 1:return v + a * t;
+    case 2:return a;
+    default:return 0.0;
+  }
+}
+
+class LatticeTrajectory1d final : public common::Polynomial {
  public:
-  explicit LatticeTrajectory1d(std::shared_ptr<common::Polynomial> ptr_trajectory1d);
-  ~LatticeTrajectory1d() override = default;
-  double Evaluate(size_t order, double param) const override;
-  double ParamLength() const override;
-  size_t Order() const override;;
-  double Coef(size_t order) const override;
+  typedef std::vector<double, common::ArenaAllocator<double>> SampleVector;
+
+  /**
+   * @param polynomial
+   * @param arena: where the sample table is allocated, nullptr for the heap
+   */
+  explicit LatticeTrajectory1d(const LatticePolynomial &polynomial, common::MonotonicArena *arena = nullptr);
+  double Evaluate(size_t order, double param) const override { return polynomial_.Evaluate(order, param); }
+  double ParamLength() const override { return polynomial_.param_length; }
+  size_t Order() const override { return polynomial_.order; }
+  double Coef(size_t order) const override { return polynomial_.coefs[order]; }
+  const LatticePolynomial &polynomial() const { return polynomial_; }
+
+  /**
+   * @brief: cache the value, 1st, 2nd and 3rd derivative on the grid 0, delta, 2 * delta, ... <= max_param.
+   * the i-th param is i * delta, not accumulated, so it does not drift along the grid.
+   * @param delta: grid resolution
+   * @param max_param: the last sampled param
+   */
+  void BuildSampleTable(double delta, double max_param);
+
+  /**
+   * @brief: cache the value, 1st, 2nd and 3rd derivative at the given params <= max_param, e.g. a time grid that
+   * is dense near the ego and coarse beyond
+   * @param params: the ascending params
+   * @param max_param: the last sampled param
+   */
+  void BuildSampleTable(const std::vector<double> &params, double max_param);
+  bool HasSampleTable() const { return !sample_params_.empty(); }
+  size_t NumOfSamples() const { return sample_params_.size(); }
+  double SampleParam(size_t index) const { return sample_params_[index]; }
+  double SampleValue(size_t order, size_t index) const { return sample_values_[order][index]; }
+  const SampleVector &SampleParams() const { return sample_params_; }
+  const SampleVector &SampleValues(size_t order) const { return sample_values_[order]; }
+
+  static constexpr size_t kMaxSampleOrder = 3;
  private:
-  std::shared_ptr<Polynomial> ptr_trajectory1d_;
+  /**
+   * @brief: evaluate the value tables at sample_params_
+   */
+  void EvaluateSampleTable();
+
+  LatticePolynomial polynomial_;
+  // SoA sample table, sample_values_[order][i] is the order-th derivative at sample_params_[i]
+  SampleVector sample_params_;
+  std::array<SampleVector, kMaxSampleOrder + 1> sample_values_;
 
 };
 
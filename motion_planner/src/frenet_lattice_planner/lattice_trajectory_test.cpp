@@ -1,11 +1,21 @@
 #include <gtest/gtest.h>
+#define private public
+#include "planning_config.hpp"
+#undef private
 #include "lattice_trajectory1d.hpp"
+#include "curves/quartic_polynomial.hpp"
 #include "curves/quintic_polynomial.hpp"
+#include "speed_optimizer.hpp"
+#include "lateral_path_optimizer.hpp"
 #define private public
 #include "frenet_lattice_planner.hpp"
 #undef private
+#include "lattice_gpu_evaluator.hpp"
+#include "polynomial_trajectory_evaluator.hpp"
 
 #include <boost/numeric/odeint.hpp>
+#include <limits>
+#include <thread>
 
 namespace planning {
 
@@ -14,7 +24,7 @@ TEST(LatticeTrajectroyTest, generate_lattice_trajectory1d_test) {
   std::array<double, 3> end_d{0.5, 0, 0};
   double param = 20.0;
   std::shared_ptr<common::Polynomial> curve = std::make_shared<common::QuinticPolynomial>(init_d, end_d, param);
-  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(curve);
+  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(LatticePolynomial(*curve));
   for (double s = 0; s < param + 5; s += 1) {
     std::cout << "s: " << s << ", l: " << lattice_trajectory->Evaluate(0, s)
               << ", l_prime: "
@@ -30,7 +40,7 @@ TEST(LatticeTrajectoryTest, lattice_trajectory1d_evaluate) {
   std::array<double, 3> end_s{4.0, 0.3, 0};
   double T = 3.0;
   std::shared_ptr<common::Polynomial> curve = std::make_shared<common::QuinticPolynomial>(init_s, end_s, T);
-  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(curve);
+  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(LatticePolynomial(*curve));
 
   for (double t = 0; t < T + 3.0; t += 1.0) {
     std::cout << "t: " << t << ", s: " << lattice_trajectory->Evaluate(0, t)
@@ -48,7 +58,7 @@ TEST(LatticeTrajectoryTest, lon_trajectory_test) {
   std::shared_ptr<common::Polynomial> curve = std::make_shared<common::QuinticPolynomial>(init_s, end_s, 4.0);
   EXPECT_DOUBLE_EQ(curve->ParamLength(), 4.0);
   EXPECT_EQ(curve->Order(), 5);
-  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(curve);
+  auto lattice_trajectory = std::make_shared<LatticeTrajectory1d>(LatticePolynomial(*curve));
   for (double t = 0.0; t < 7.0; t += 0.1) {
     std::cout << "t: " << t << ", s: " << lattice_trajectory->Evaluate(0, t)
               << ", s_dot: "
@@ -67,25 +77,592 @@ TEST(LatticeTrajectoryTest, lon_trajectory_test) {
 
 }
 
+TEST(LatticeTrajectoryTest, lattice_trajectory1d_sample_table) {
+  std::array<double, 3> init_s{30.0458, 15.0, 0};
+  std::array<double, 3> end_s{35.5136, 0.0, 0.0};
+  std::shared_ptr<common::Polynomial> curve = std::make_shared<common::QuinticPolynomial>(init_s, end_s, 4.0);
+  LatticeTrajectory1d lattice_trajectory{LatticePolynomial(*curve)};
+  EXPECT_FALSE(lattice_trajectory.HasSampleTable());
+  lattice_trajectory.BuildSampleTable(0.1, 8.0);
+  EXPECT_TRUE(lattice_trajectory.HasSampleTable());
+  ASSERT_EQ(81u, lattice_trajectory.NumOfSamples());
+  for (size_t index = 0; index < lattice_trajectory.NumOfSamples(); ++index) {
+    const double t = static_cast<double>(index) * 0.1;
+    EXPECT_DOUBLE_EQ(lattice_trajectory.SampleParam(index), t);
+    for (size_t order = 0; order <= LatticeTrajectory1d::kMaxSampleOrder; ++order) {
+      EXPECT_DOUBLE_EQ(lattice_trajectory.SampleValue(order, index), lattice_trajectory.Evaluate(order, t));
+    }
+  }
+  lattice_trajectory.BuildSampleTable(0.0, 8.0);
+  EXPECT_FALSE(lattice_trajectory.HasSampleTable());
+}
+
+TEST(LatticeTrajectoryTest, lattice_trajectory1d_non_uniform_sample_table) {
+  std::array<double, 3> init_s{30.0458, 15.0, 0};
+  std::array<double, 3> end_s{35.5136, 0.0, 0.0};
+  std::shared_ptr<common::Polynomial> curve = std::make_shared<common::QuinticPolynomial>(init_s, end_s, 4.0);
+  LatticeTrajectory1d lattice_trajectory{LatticePolynomial(*curve)};
+  const std::vector<double> params{0.0, 0.1, 0.2, 0.3, 0.7, 1.1, 3.1, 5.1, 8.0};
+  lattice_trajectory.BuildSampleTable(params, 5.1);
+  ASSERT_EQ(8u, lattice_trajectory.NumOfSamples());
+  for (size_t index = 0; index < lattice_trajectory.NumOfSamples(); ++index) {
+    EXPECT_DOUBLE_EQ(lattice_trajectory.SampleParam(index), params[index]);
+    for (size_t order = 0; order <= LatticeTrajectory1d::kMaxSampleOrder; ++order) {
+      EXPECT_DOUBLE_EQ(lattice_trajectory.SampleValue(order, index),
+                       lattice_trajectory.Evaluate(order, params[index]));
+    }
+  }
+}
+
 TEST(LatticeTrajectoryTest, lattice_planner_trajectory_generator) {
   std::array<double, 3> init_s{-1.43473, 0.4, 0.0};
   std::array<double, 3> end_s{2.0, 0.3, 0};
   std::vector<std::pair<std::array<double, 3>, double>> end_conditions;
   end_conditions.emplace_back(end_s, 3.0);
   double T = 3.0;
-  auto lattice_planner = FrenetLatticePlanner();
-  std::vector<std::shared_ptr<common::Polynomial>> lattice_trajectorys;
+  FrenetLatticePlanner lattice_planner;
+  std::vector<LatticePolynomial> lattice_trajectorys;
   FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, end_conditions, 5, &lattice_trajectorys);
   for (const auto &traj : lattice_trajectorys) {
     for (double t = 0; t < 5.0; t += 1.0) {
-      std::cout << "t: " << t << ", s: " << traj->Evaluate(0, t)
+      std::cout << "t: " << t << ", s: " << traj.Evaluate(0, t)
                 << ", s_dot: "
-                << traj->Evaluate(1, t) << ", s_ddot: "
-                << traj->Evaluate(2, t)
+                << traj.Evaluate(1, t) << ", s_ddot: "
+                << traj.Evaluate(2, t)
                 << std::endl;
     }
   }
 }
+TEST(LatticeTrajectoryTest, lattice_polynomial_matches_polynomials) {
+  const common::QuarticPolynomial quartic(0.0, 8.0, 0.5, 12.0, 0.0, 4.0);
+  const common::QuinticPolynomial quintic({-1.2, 0.3, 0.0}, {0.5, 0.0, 0.0}, 20.0);
+  for (const common::Polynomial *polynomial : {static_cast<const common::Polynomial *>(&quartic),
+                                               static_cast<const common::Polynomial *>(&quintic)}) {
+    const LatticePolynomial lattice_polynomial(*polynomial);
+    EXPECT_EQ(lattice_polynomial.order, polynomial->Order());
+    const double param_length = polynomial->ParamLength();
+    for (double param = 0.0; param < param_length; param += 0.05 * param_length) {
+      for (size_t order = 0; order <= polynomial->Order(); ++order) {
+        EXPECT_EQ(lattice_polynomial.Evaluate(order, param), polynomial->Evaluate(order, param)) << order;
+      }
+    }
+    // beyond the param length the acceleration at the end is kept
+    const double a = polynomial->Evaluate(2, param_length);
+    EXPECT_DOUBLE_EQ(lattice_polynomial.Evaluate(2, param_length + 3.0), a);
+    EXPECT_DOUBLE_EQ(lattice_polynomial.Evaluate(1, param_length + 3.0),
+                     polynomial->Evaluate(1, param_length) + 3.0 * a);
+    EXPECT_EQ(lattice_polynomial.Evaluate(3, param_length + 3.0), 0.0);
+  }
+}
+
+TEST(LatticeTrajectoryTest, sample_tables_on_arena) {
+  std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  std::vector<std::pair<std::array<double, 3>, double>> end_conditions;
+  for (int i = 1; i <= 8; ++i) {
+    end_conditions.push_back({{0.0, 4.0 + i, 0.0}, static_cast<double>(i)});
+  }
+  std::vector<LatticePolynomial> polynomials;
+  FrenetLatticePlanner::GeneratePolynomialTrajectories(init_s, end_conditions, 4, &polynomials);
+  ASSERT_EQ(polynomials.size(), end_conditions.size());
+  common::MonotonicArena arena(1024);
+  {
+    std::vector<LatticeTrajectory1d> trajectories;
+    for (size_t i = 0; i < polynomials.size(); ++i) {
+      const common::QuarticPolynomial quartic(init_s[0], init_s[1], init_s[2], end_conditions[i].first[1],
+                                              end_conditions[i].first[2], end_conditions[i].second);
+      trajectories.emplace_back(polynomials[i], &arena);
+      auto &lattice_trajectory = trajectories.back();
+      lattice_trajectory.BuildSampleTable(0.1, 8.0);
+      for (size_t index = 0; index < lattice_trajectory.NumOfSamples(); ++index) {
+        const double t = lattice_trajectory.SampleParam(index);
+        for (size_t order = 0; order <= LatticeTrajectory1d::kMaxSampleOrder; ++order) {
+          if (t < quartic.ParamLength()) {
+            EXPECT_EQ(lattice_trajectory.SampleValue(order, index), quartic.Evaluate(order, t));
+          }
+          EXPECT_EQ(lattice_trajectory.SampleValue(order, index), lattice_trajectory.Evaluate(order, t));
+        }
+      }
+    }
+    EXPECT_GE(arena.BytesUsed(), polynomials.size() * 5 * 81 * sizeof(double));
+  }
+  arena.Reset();
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+}
+
+TEST(LatticeTrajectoryTest, refine_cruising_end_conditions) {
+  std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  std::array<double, 3> init_d{0.0, 0.0, 0.0};
+  const double target_vel = 12.0;
+  EndConditionSampler sampler(init_s, init_d, nullptr, {}, nullptr, PlanningConfig::Instance().Snapshot());
+  const auto dense = sampler.SampleLonEndConditionForCruising(target_vel);
+  const auto coarse = sampler.SampleCoarseLonEndConditionForCruising(target_vel);
+  EXPECT_LT(coarse.size(), dense.size());
+  const std::vector<std::pair<std::array<double, 3>, double>> best_cells(coarse.begin(), coarse.begin() + 3);
+  const auto refined = sampler.RefineLonEndConditionForCruising(target_vel, best_cells);
+  ASSERT_FALSE(refined.empty());
+  const double half_time_gap = 0.5 * PlanningConfig::Instance().max_lookahead_time()
+      / static_cast<double>(PlanningConfig::Instance().coarse_lon_time_samples_num() - 1);
+  for (size_t i = 0; i < refined.size(); ++i) {
+    const double t = refined[i].second;
+    const double v = refined[i].first[1];
+    EXPECT_GE(t, PlanningConfig::Instance().min_lookahead_time() - 1e-6);
+    EXPECT_LE(t, PlanningConfig::Instance().max_lookahead_time() + 1e-6);
+    EXPECT_LE(v, target_vel + 1e-6);
+    double min_time_gap = std::numeric_limits<double>::max();
+    for (const auto &cell : best_cells) {
+      min_time_gap = std::min(min_time_gap, std::fabs(cell.second - t));
+      EXPECT_FALSE(std::fabs(cell.second - t) < 1e-6 && std::fabs(cell.first[1] - v) < 1e-6);
+    }
+    EXPECT_LE(min_time_gap, half_time_gap + 1e-6);
+    for (size_t k = 0; k < i; ++k) {
+      EXPECT_FALSE(std::fabs(refined[k].second - t) < 1e-6 && std::fabs(refined[k].first[1] - v) < 1e-6);
+    }
+  }
+}
+
+TEST(LatticeTrajectoryTest, sample_end_conditions_around_seed) {
+  std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  std::array<double, 3> init_d{0.0, 0.0, 0.0};
+  const double target_vel = 12.0;
+  EndConditionSampler sampler(init_s, init_d, nullptr, {}, nullptr, PlanningConfig::Instance().Snapshot());
+  const std::pair<std::array<double, 3>, double> lon_seed({0.0, 9.0, 0.0}, 4.0);
+  const auto lon_end_conditions = sampler.SampleLonEndConditionAroundSeed(target_vel, lon_seed);
+  ASSERT_FALSE(lon_end_conditions.empty());
+  EXPECT_NEAR(lon_end_conditions.front().first[1], 9.0, 1e-6);
+  EXPECT_NEAR(lon_end_conditions.front().second, 4.0, 1e-6);
+  const double half_time_gap = 0.5 * PlanningConfig::Instance().max_lookahead_time()
+      / static_cast<double>(PlanningConfig::Instance().lon_time_samples_num() - 1);
+  for (size_t i = 0; i < lon_end_conditions.size(); ++i) {
+    const double t = lon_end_conditions[i].second;
+    const double v = lon_end_conditions[i].first[1];
+    EXPECT_LE(std::fabs(t - 4.0), half_time_gap + 1e-6);
+    EXPECT_LE(std::fabs(v - 9.0), PlanningConfig::Instance().lon_vel_sample_step() + 1e-6);
+    for (size_t k = 0; k < i; ++k) {
+      EXPECT_FALSE(std::fabs(lon_end_conditions[k].second - t) < 1e-6
+                       && std::fabs(lon_end_conditions[k].first[1] - v) < 1e-6);
+    }
+  }
+  // a seed past the horizon is clamped to it
+  const std::pair<std::array<double, 3>, double> late_seed({0.0, 9.0, 0.0}, 100.0);
+  for (const auto &end_condition : sampler.SampleLonEndConditionAroundSeed(target_vel, late_seed)) {
+    EXPECT_LE(end_condition.second, PlanningConfig::Instance().max_lookahead_time() + 1e-6);
+  }
+  const std::pair<std::array<double, 3>, double> lat_seed({0.3, 0.0, 0.0}, 2.0);
+  const auto lat_end_conditions = EndConditionSampler::SampleLatEndConditionAroundSeed(lat_seed);
+  ASSERT_EQ(lat_end_conditions.size(), 3u);
+  EXPECT_NEAR(lat_end_conditions.front().first[0], 0.3, 1e-6);
+  for (const auto &end_condition : lat_end_conditions) {
+    EXPECT_GE(end_condition.second, 10.0 - 1e-6);
+    EXPECT_LE(std::fabs(end_condition.first[0] - 0.3), 0.25 + 1e-6);
+  }
+}
+
+TEST(LatticeTrajectoryTest, prune_lon_end_conditions) {
+  std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  std::array<double, 3> init_d{0.0, 0.0, 0.0};
+  PlanningParams params = PlanningConfig::Instance().Snapshot();
+  params.min_lookahead_time = 1.0;
+  params.max_lon_acc = 4.0;
+  params.min_lon_acc = -4.0;
+  params.max_lon_jerk = 8.0;
+  params.min_lon_jerk = -8.0;
+  params.max_lon_velocity = 20.0;
+  params.min_lon_velocity = -0.1;
+  params.lon_end_condition_s_resolution = 0.5;
+  params.lon_end_condition_v_resolution = 0.2;
+  params.lon_end_condition_t_resolution = 0.1;
+  EndConditionSampler sampler(init_s, init_d, nullptr, {}, nullptr, params);
+  std::vector<std::pair<std::array<double, 3>, double>> end_conditions{
+      {{24.0, 8.0, 0.0}, 3.0},
+      // the same cell of another obstacle
+      {{24.1, 8.05, 0.0}, 3.02},
+      // within the acc limit, but the acc cannot ramp up and down that fast
+      {{22.0, 15.0, 0.0}, 2.0},
+      // beyond the max velocity
+      {{150.0, 25.0, 0.0}, 8.0},
+      {{40.0, 9.0, 0.0}, 4.4}};
+  EndConditionPruningStatistics statistics;
+  sampler.PruneLonEndConditions(&end_conditions, &statistics);
+  EXPECT_EQ(statistics.num_sampled, 5u);
+  EXPECT_EQ(statistics.num_duplicates, 1u);
+  EXPECT_EQ(statistics.num_infeasible, 2u);
+  ASSERT_EQ(end_conditions.size(), 2u);
+  EXPECT_NEAR(end_conditions[0].second, 3.0, 1e-9);
+  EXPECT_NEAR(end_conditions[1].second, 4.4, 1e-9);
+
+  // a quintic to a pruned state breaks the jerk or the acc limit somewhere
+  EXPECT_FALSE(sampler.IsLonEndStateReachable(22.0, 15.0, 2.0));
+  const common::QuinticPolynomial polynomial(init_s, {22.0, 15.0, 0.0}, 2.0);
+  bool is_within_limits = true;
+  for (double t = 0.0; t <= 2.0; t += 0.01) {
+    is_within_limits = is_within_limits && polynomial.Evaluate(2, t) <= params.max_lon_acc
+        && polynomial.Evaluate(3, t) <= params.max_lon_jerk && polynomial.Evaluate(3, t) >= params.min_lon_jerk;
+  }
+  EXPECT_FALSE(is_within_limits);
+  // a stop from 8 m/s is out of reach within 1 s, but not within 4 s
+  EXPECT_FALSE(sampler.IsLonEndStateReachable(4.0, 0.0, 1.0));
+  EXPECT_TRUE(sampler.IsLonEndStateReachable(20.0, 0.0, 4.0));
+}
+
+PlanningParams SpeedOptimizerTestParams() {
+  PlanningParams params;
+  params.delta_t = 0.1;
+  params.max_lookahead_time = 8.0;
+  params.num_time_steps = 80;
+  params.max_lookahead_distance = 200.0;
+  params.lon_safety_buffer = 2.0;
+  params.max_lon_velocity = 20.0;
+  params.min_lon_velocity = -0.01;
+  params.max_lon_acc = 4.0;
+  params.min_lon_acc = -4.0;
+  params.max_lon_jerk = 8.0;
+  params.min_lon_jerk = -8.0;
+  params.speed_optimizer_dp_s_resolution = 1.0;
+  params.speed_optimizer_dp_t_resolution = 1.0;
+  params.vehicle_params.half_length = 2.5;
+  params.vehicle_params.back_axle_to_center_length = 1.5;
+  return params;
+}
+
+TEST(SpeedOptimizerTest, cruise_on_free_road) {
+  const auto params = SpeedOptimizerTestParams();
+  const std::array<double, 3> init_s{10.0, 5.0, 0.0};
+  const std::vector<std::vector<std::pair<double, double>>> blocking_intervals(params.num_time_steps + 1);
+  SpeedOptimizer::SpeedProfile profile;
+  ASSERT_TRUE(SpeedOptimizer(params).Optimize(init_s, blocking_intervals, 10.0, 210.0, &profile));
+  ASSERT_EQ(profile.s.size(), params.num_time_steps + 1);
+  EXPECT_DOUBLE_EQ(profile.s.front(), 10.0);
+  EXPECT_NEAR(profile.v.back(), 10.0, 0.5);
+  for (size_t i = 0; i < profile.s.size(); ++i) {
+    EXPECT_GE(profile.v[i], -1e-3);
+    EXPECT_LE(profile.v[i], params.max_lon_velocity + 1e-3);
+    EXPECT_GE(profile.a[i], params.min_lon_acc - 1e-3);
+    EXPECT_LE(profile.a[i], params.max_lon_acc + 1e-3);
+    if (i > 0) {
+      EXPECT_NEAR(profile.s[i] - profile.s[i - 1], 0.5 * (profile.v[i] + profile.v[i - 1]) * params.delta_t, 1e-2);
+    }
+  }
+  double max_deviation = 0.0;
+  const auto polynomial = LatticePolynomial::FitQuintic(init_s, profile.s, profile.delta_t, &max_deviation);
+  EXPECT_LT(max_deviation, 0.5 * params.lon_safety_buffer);
+  EXPECT_DOUBLE_EQ(polynomial.Evaluate(0, 0.0), init_s[0]);
+  EXPECT_DOUBLE_EQ(polynomial.Evaluate(1, 0.0), init_s[1]);
+  EXPECT_NEAR(polynomial.ParamLength(), 8.0, 1e-9);
+}
+
+TEST(SpeedOptimizerTest, keep_behind_static_obstacle) {
+  const auto params = SpeedOptimizerTestParams();
+  const std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  // a static obstacle on [40, 45] over the whole horizon
+  const std::vector<std::vector<std::pair<double, double>>> blocking_intervals(
+      params.num_time_steps + 1, std::vector<std::pair<double, double>>{{40.0, 45.0}});
+  SpeedOptimizer::SpeedProfile profile;
+  ASSERT_TRUE(SpeedOptimizer(params).Optimize(init_s, blocking_intervals, 10.0, 200.0, &profile));
+  const double front_margin = params.lon_safety_buffer + params.vehicle_params.half_length
+      + params.vehicle_params.back_axle_to_center_length;
+  for (size_t i = 0; i < profile.s.size(); ++i) {
+    EXPECT_LE(profile.s[i], 40.0 - front_margin + 1e-2);
+    EXPECT_GE(profile.v[i], -1e-3);
+  }
+  EXPECT_LT(profile.v.back(), 10.0);
+
+  // too fast to stop in front of an obstacle right ahead
+  const std::array<double, 3> fast_init_s{0.0, 20.0, 0.0};
+  const std::vector<std::vector<std::pair<double, double>>> near_intervals(
+      params.num_time_steps + 1, std::vector<std::pair<double, double>>{{12.0, 17.0}});
+  EXPECT_FALSE(SpeedOptimizer(params).Optimize(fast_init_s, near_intervals, 10.0, 200.0, &profile));
+}
+
+TEST(LatticeTrajectoryTest, fit_quintic) {
+  const std::array<double, 3> init_d{0.5, -0.1, 0.02};
+  const std::array<double, 3> end_d{-0.3, 0.0, 0.0};
+  const common::QuinticPolynomial quintic(init_d, end_d, 30.0);
+  std::vector<double> samples;
+  for (size_t i = 0; i <= 30; ++i) {
+    samples.push_back(quintic.Evaluate(0, static_cast<double>(i)));
+  }
+  double max_deviation = 0.0;
+  const auto polynomial = LatticePolynomial::FitQuintic(init_d, samples, 1.0, &max_deviation);
+  EXPECT_LT(max_deviation, 1e-6);
+  EXPECT_NEAR(polynomial.ParamLength(), 30.0, 1e-9);
+  for (double s = 0.0; s <= 30.0; s += 2.5) {
+    EXPECT_NEAR(polynomial.Evaluate(0, s), quintic.Evaluate(0, s), 1e-6);
+    EXPECT_NEAR(polynomial.Evaluate(1, s), quintic.Evaluate(1, s), 1e-6);
+  }
+  LatticePolynomial::FitQuintic(init_d, std::vector<double>(3, 0.0), 1.0, &max_deviation);
+  EXPECT_TRUE(std::isinf(max_deviation));
+}
+
+TEST(LateralPathOptimizerTest, back_to_lane_center) {
+  LateralPathOptimizer optimizer;
+  const std::array<double, 3> init_d{0.8, 0.0, 0.0};
+  const std::vector<std::pair<double, double>> bounds(41, std::make_pair(-1.0, 1.0));
+  std::vector<double> path;
+  ASSERT_TRUE(optimizer.OptimizePath(init_d, bounds, 1.0, 3.0, &path));
+  ASSERT_EQ(path.size(), bounds.size());
+  EXPECT_DOUBLE_EQ(path.front(), 0.8);
+  EXPECT_NEAR(path.back(), 0.0, 0.1);
+  for (size_t i = 0; i < path.size(); ++i) {
+    EXPECT_GE(path[i], -1.0 - 1e-3);
+    EXPECT_LE(path[i], 1.0 + 1e-3);
+  }
+  LatticePolynomial lat_traj;
+  EXPECT_LT(LateralPathOptimizer::FitPath(init_d, path, 1.0, &lat_traj), 0.15);
+  EXPECT_DOUBLE_EQ(lat_traj.Evaluate(0, 0.0), init_d[0]);
+
+  // the next cycle warm starts from the last path
+  ASSERT_TRUE(optimizer.OptimizePath(init_d, bounds, 1.0, 3.0, &path));
+}
+
+TEST(LateralPathOptimizerTest, nudge_static_obstacle) {
+  LateralPathOptimizer optimizer;
+  const std::array<double, 3> init_d{0.0, 0.0, 0.0};
+  // an obstacle cuts the right side of the lane on [15, 25]
+  std::vector<std::pair<double, double>> bounds(41, std::make_pair(-1.5, 1.5));
+  for (size_t i = 15; i <= 25; ++i) {
+    bounds[i].first = 0.6;
+  }
+  std::vector<double> path;
+  ASSERT_TRUE(optimizer.OptimizePath(init_d, bounds, 1.0, 3.0, &path));
+  for (size_t i = 0; i < path.size(); ++i) {
+    EXPECT_GE(path[i], bounds[i].first - 1e-3);
+    EXPECT_LE(path[i], bounds[i].second + 1e-3);
+  }
+  LatticePolynomial lat_traj;
+  EXPECT_LT(LateralPathOptimizer::FitPath(init_d, path, 1.0, &lat_traj), 0.15);
+  EXPECT_GT(lat_traj.Evaluate(0, 20.0), 0.4);
+
+  // no room on either side
+  bounds[20] = std::make_pair(0.5, -0.5);
+  EXPECT_FALSE(optimizer.OptimizePath(init_d, bounds, 1.0, 3.0, &path));
+}
+
+TEST(PolynomialTrajectoryEvaluatorTest, pair_kernel_matches_eager_evaluation) {
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (int i = 0; i < 120; ++i) {
+    planning_msgs::WayPoint way_point;
+    way_point.pose.position.x = static_cast<double>(i);
+    way_point.pose.position.y = 0.0;
+    way_point.pose.orientation.w = 1.0;
+    way_point.lane_width = 4.0;
+    way_points.push_back(way_point);
+  }
+  auto ref_line = std::make_shared<const ReferenceLine>(way_points);
+  const std::array<double, 3> init_s{0.0, 8.0, 0.0};
+  const std::array<double, 3> init_d{0.3, 0.0, 0.0};
+  auto st_graph = std::make_shared<STGraph>(std::vector<std::shared_ptr<Obstacle>>(), ref_line, 0.0, 100.0, 0.0,
+                                            8.0, init_d, 8.0, 0.1);
+  PlanningParams params;
+  params.max_lookahead_time = 8.0;
+  params.max_lookahead_distance = 60.0;
+  params.delta_t = 0.1;
+  params.num_time_steps = 80;
+  params.fixed_horizon_kernel = true;
+  params.lon_safety_buffer = 2.0;
+  params.min_lon_velocity = 0.0;
+  params.max_lon_velocity = 20.0;
+  params.min_lon_acc = -6.0;
+  params.max_lon_acc = 4.0;
+  params.min_lon_jerk = -10.0;
+  params.max_lon_jerk = 10.0;
+  params.lattice_weight_opposite_side_offset = 10.0;
+  params.lattice_weight_same_side_offset = 1.0;
+  params.lattice_weight_dist_travelled = 10.0;
+  params.lattice_weight_target_speed = 1.0;
+  params.lattice_weight_collision = 5.0;
+  params.lattice_weight_lon_jerk = 1.0;
+  params.lattice_weight_lon_target = 5.0;
+  params.lattice_weight_lat_jerk = 1.0;
+  params.lattice_weight_lat_offset = 1.0;
+  params.lattice_weight_centripetal_acc = 1.0;
+  params.eager_pair_evaluation = true;
+  PlanningTarget planning_target;
+  planning_target.desired_vel = 10.0;
+  planning_target.ref_lane = ref_line;
+
+  std::vector<LatticePolynomial> lon_trajectories;
+  for (const double end_v : {4.0, 6.0, 8.0, 10.0, 12.0}) {
+    for (const double t : {3.0, 4.0, 5.0, 6.0, 7.0, 8.0}) {
+      lon_trajectories.emplace_back(common::QuarticPolynomial(init_s[0], init_s[1], init_s[2], end_v, 0.0, t));
+    }
+  }
+  // the offsets beyond the half lane leave invalid pairs
+  std::vector<LatticePolynomial> lat_trajectories;
+  for (const double end_d : {-2.5, -1.5, -0.5, 0.0, 0.5, 1.5, 2.5}) {
+    for (const double length : {20.0, 30.0, 40.0, 50.0}) {
+      lat_trajectories.emplace_back(
+          common::QuinticPolynomial(init_d, std::array<double, 3>{end_d, 0.0, 0.0}, length));
+    }
+  }
+  PolynomialTrajectoryEvaluator::Seeds seeds;
+  seeds.cost_discount = 0.5;
+  seeds.is_seeded_lon.assign(lon_trajectories.size(), 0);
+  seeds.is_seeded_lat.assign(lat_trajectories.size(), 0);
+  seeds.is_seeded_lon[12] = seeds.is_seeded_lon[13] = 1;
+  seeds.is_seeded_lat[13] = seeds.is_seeded_lat[14] = 1;
+
+  PolynomialTrajectoryEvaluator evaluator(init_s, planning_target, lon_trajectories, lat_trajectories, ref_line,
+                                          st_graph, params, nullptr, &seeds);
+  common::ThreadPool thread_pool(2);
+  params.gpu_pair_evaluation = true;
+  PolynomialTrajectoryEvaluator batch_evaluator(init_s, planning_target, lon_trajectories, lat_trajectories,
+                                                ref_line, st_graph, params, &thread_pool, &seeds);
+  ASSERT_GT(evaluator.num_of_trajectory_pairs(), 0);
+  ASSERT_LT(evaluator.num_of_trajectory_pairs(), lon_trajectories.size() * lat_trajectories.size());
+  ASSERT_EQ(batch_evaluator.num_of_trajectory_pairs(), evaluator.num_of_trajectory_pairs());
+  // the kernel runs the operations of the evaluator in the same order, on the host the costs are bit-identical
+  while (evaluator.has_more_trajectory_pairs()) {
+    ASSERT_TRUE(batch_evaluator.has_more_trajectory_pairs());
+    if (!LatticeGpuEvaluator::IsAvailable()) {
+      EXPECT_EQ(batch_evaluator.top_trajectory_pair_cost(), evaluator.top_trajectory_pair_cost());
+    } else {
+      EXPECT_NEAR(batch_evaluator.top_trajectory_pair_cost(), evaluator.top_trajectory_pair_cost(), 1e-9);
+    }
+    const auto pair = evaluator.next_top_trajectory_pair();
+    const auto batch_pair = batch_evaluator.next_top_trajectory_pair();
+    if (!LatticeGpuEvaluator::IsAvailable()) {
+      EXPECT_EQ(batch_pair, pair);
+    }
+  }
+  EXPECT_FALSE(batch_evaluator.has_more_trajectory_pairs());
+}
+
+TEST(MotionPlanningServerTest, egos_of_different_sizes_on_shared_pool) {
+  // a static 2 m box on the left of the straight path of both egos
+  derived_object_msgs::Object object;
+  object.id = 1;
+  object.object_classified = derived_object_msgs::Object::OBJECT_DETECTED;
+  object.classification = derived_object_msgs::Object::CLASSIFICATION_CAR;
+  object.shape.type = shape_msgs::SolidPrimitive::BOX;
+  object.shape.dimensions = {2.0, 2.0, 1.5};
+  object.pose.position.x = 20.0;
+  object.pose.position.y = 4.5;
+  object.pose.orientation.w = 1.0;
+  auto obstacle = std::make_shared<Obstacle>(object);
+  obstacle->PredictTrajectory(PlanningConfig::Instance().max_lookahead_time(), PlanningConfig::Instance().delta_t());
+  const std::vector<std::shared_ptr<Obstacle>> obstacles{obstacle};
+  planning_msgs::Trajectory trajectory;
+  for (int i = 0; i <= 60; ++i) {
+    planning_msgs::TrajectoryPoint tp;
+    tp.relative_time = 0.1 * static_cast<double>(i);
+    tp.path_point.x = 5.0 * tp.relative_time;
+    tp.path_point.s = tp.path_point.x;
+    tp.vel = 5.0;
+    trajectory.trajectory_points.push_back(tp);
+  }
+
+  // the egos of a server share the pool and the config, but not their geometry
+  common::ThreadPool thread_pool(2);
+  vehicle_state::VehicleParams narrow_params{};
+  narrow_params.length = 3.0;
+  narrow_params.width = 1.0;
+  narrow_params.half_length = 1.5;
+  narrow_params.half_width = 0.5;
+  vehicle_state::VehicleParams wide_params{};
+  wide_params.length = 6.0;
+  wide_params.width = 6.0;
+  wide_params.half_length = 3.0;
+  wide_params.half_width = 3.0;
+  FrenetLatticePlanner narrow_planner(&thread_pool);
+  FrenetLatticePlanner wide_planner(&thread_pool);
+  narrow_planner.set_vehicle_params(narrow_params);
+  wide_planner.set_vehicle_params(wide_params);
+  constexpr int kCycles = 50;
+  int narrow_valid_cycles = 0;
+  int wide_valid_cycles = 0;
+  std::thread narrow_thread([&]() {
+    for (int i = 0; i < kCycles; ++i) {
+      narrow_valid_cycles += narrow_planner.IsTrajectoryValid(obstacles, trajectory) ? 1 : 0;
+    }
+  });
+  std::thread wide_thread([&]() {
+    for (int i = 0; i < kCycles; ++i) {
+      wide_valid_cycles += wide_planner.IsTrajectoryValid(obstacles, trajectory) ? 1 : 0;
+    }
+  });
+  narrow_thread.join();
+  wide_thread.join();
+  // the narrow ego passes the box in every cycle, the wide one sweeps over it in every cycle
+  EXPECT_EQ(narrow_valid_cycles, kCycles);
+  EXPECT_EQ(wide_valid_cycles, 0);
+}
+
+TEST(MotionPlanningServerTest, egos_of_different_sizes_plan_on_shared_scene) {
+  // the limits and buffers UpdateParams defaults to, the test has no parameter server
+  auto &config = PlanningConfig::Instance();
+  config.max_lookahead_distance_ = 80.0;
+  config.lon_safety_buffer_ = 2.0;
+  config.lat_safety_buffer_ = 0.2;
+  config.min_lon_acc_ = -6.0;
+  config.max_lon_acc_ = 6.0;
+  config.min_lon_jerk_ = -10.0;
+  config.max_lon_jerk_ = 10.0;
+  config.min_kappa_ = -2.0;
+  config.max_kappa_ = 2.0;
+  config.min_lat_acc_ = -4.0;
+  config.max_lat_acc_ = 4.0;
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (int i = 0; i < 120; ++i) {
+    planning_msgs::WayPoint way_point;
+    way_point.pose.position.x = static_cast<double>(i);
+    way_point.pose.position.y = 0.0;
+    way_point.pose.orientation.w = 1.0;
+    way_point.lane_width = 4.0;
+    way_points.push_back(way_point);
+  }
+  PlanningTarget planning_target;
+  planning_target.desired_vel = 5.0;
+  planning_target.ref_lane = std::make_shared<const ReferenceLine>(way_points);
+  planning_target.is_best_behaviour = true;
+  const std::vector<PlanningTarget> planning_targets{planning_target};
+  // both egos start on the lane center, next to a static box on the left edge of the lane
+  planning_msgs::TrajectoryPoint init_point;
+  init_point.path_point.x = 10.0;
+  init_point.vel = 5.0;
+  derived_object_msgs::Object object;
+  object.id = 1;
+  object.object_classified = derived_object_msgs::Object::OBJECT_DETECTED;
+  object.classification = derived_object_msgs::Object::CLASSIFICATION_CAR;
+  object.shape.type = shape_msgs::SolidPrimitive::BOX;
+  object.shape.dimensions = {6.0, 1.0, 1.5};
+  object.pose.position.x = 12.0;
+  object.pose.position.y = 2.25;
+  object.pose.orientation.w = 1.0;
+  auto obstacle = std::make_shared<Obstacle>(object);
+  obstacle->PredictTrajectory(PlanningConfig::Instance().max_lookahead_time(), PlanningConfig::Instance().delta_t());
+  const std::vector<std::shared_ptr<Obstacle>> obstacles{obstacle};
+
+  common::ThreadPool thread_pool(2);
+  vehicle_state::VehicleParams narrow_params{};
+  narrow_params.length = 3.0;
+  narrow_params.width = 1.0;
+  narrow_params.half_length = 1.5;
+  narrow_params.half_width = 0.5;
+  vehicle_state::VehicleParams wide_params = narrow_params;
+  wide_params.width = 6.0;
+  wide_params.half_width = 3.0;
+  FrenetLatticePlanner narrow_planner(&thread_pool);
+  FrenetLatticePlanner wide_planner(&thread_pool);
+  narrow_planner.set_vehicle_params(narrow_params);
+  wide_planner.set_vehicle_params(wide_params);
+  bool is_narrow_planned = false;
+  bool is_wide_planned = false;
+  planning_msgs::Trajectory narrow_trajectory;
+  planning_msgs::Trajectory wide_trajectory;
+  std::thread narrow_thread([&]() {
+    is_narrow_planned = narrow_planner.Process(obstacles, init_point, planning_targets, narrow_trajectory, nullptr);
+  });
+  std::thread wide_thread([&]() {
+    is_wide_planned = wide_planner.Process(obstacles, init_point, planning_targets, wide_trajectory, nullptr);
+  });
+  narrow_thread.join();
+  wide_thread.join();
+  // the narrow ego clears the inflated box from where it starts, the wide one already overlaps it there
+  EXPECT_TRUE(is_narrow_planned);
+  EXPECT_FALSE(narrow_trajectory.trajectory_points.empty());
+  EXPECT_FALSE(is_wide_planned);
+}
+
 typedef boost::array<double, 3> state_type;
 const double sigma = 10.0;
 const double R = 28.0;
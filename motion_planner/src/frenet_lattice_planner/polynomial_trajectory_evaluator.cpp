@@ -1,234 +1,600 @@
 #include "frenet_lattice_planner/polynomial_trajectory_evaluator.hpp"
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include <planning_config.hpp>
 #include "frenet_lattice_planner/constraint_checker.hpp"
+#include "frenet_lattice_planner/lattice_gpu_evaluator.hpp"
 #include "frenet_lattice_planner.hpp"
 
 namespace planning {
+constexpr double PolynomialTrajectoryEvaluator::kLatOffsetSampleResolution;
+
+namespace {
+// the gaussian of the lon collision cost, exp(-dist^2 / (2 sigma^2)), is tabulated up to the cutoff distance,
+// beyond which it is below 1.6e-8 and dropped.
+constexpr double kCollisionCostSigma = 2.0;
+constexpr double kCollisionCostCutoff = 6.0 * kCollisionCostSigma;
+constexpr double kCollisionCostResolution = 0.01;
+
+double CollisionGaussian(double dist) {
+  static const std::vector<double> table = []() {
+    const auto size = static_cast<size_t>(kCollisionCostCutoff / kCollisionCostResolution) + 2;
+    std::vector<double> values(size);
+    for (size_t i = 0; i < size; ++i) {
+      const double d = static_cast<double>(i) * kCollisionCostResolution;
+      values[i] = std::exp(-d * d / (2.0 * kCollisionCostSigma * kCollisionCostSigma));
+    }
+    return values;
+  }();
+  const double param = dist / kCollisionCostResolution;
+  const auto index = static_cast<size_t>(param);
+  if (index + 1 >= table.size()) {
+    return 0.0;
+  }
+  const double ratio = param - static_cast<double>(index);
+  return table[index] + ratio * (table[index + 1] - table[index]);
+}
+
+// the lat offset bound of IsValidLateralTrajectory
+constexpr double kMaxLatOffset = 3.5 / 2;
+
+// the clearance cost, exp(-clearance^2 / (2 sigma^2)), the clearances beyond the cutoff are not measured. the
+// collision cost is a distance along s to the blocked st intervals, which wants a headway of a few metres, while
+// the clearance is the gap to the footprints already inflated by the safety buffers, so only the last half metre
+// of it should cost. a sigma as wide as the collision one would charge every candidate passing within a lane of
+// an obstacle and outweigh the lat offset costs
+constexpr double kClearanceCostSigma = 0.5;
+// the same 6 sigma as the collision table, so a clearance scaled to its sigma stays inside the table
+constexpr double kClearanceCostCutoff = 6.0 * kClearanceCostSigma;
+}
+
 PolynomialTrajectoryEvaluator::PolynomialTrajectoryEvaluator(const std::array<double, 3> &init_s,
                                                              const PlanningTarget &planning_target,
-                                                             const std::vector<std::shared_ptr<common::Polynomial>> &lon_trajectory_vec,
-                                                             const std::vector<std::shared_ptr<common::Polynomial>> &lat_trajectory_vec,
-                                                             const ReferenceLine &ref_line,
+                                                             const std::vector<LatticePolynomial> &lon_trajectory_vec,
+                                                             const std::vector<LatticePolynomial> &lat_trajectory_vec,
+                                                             std::shared_ptr<const ReferenceLine> ref_line,
                                                              std::shared_ptr<STGraph> ptr_st_graph,
-                                                             common::ThreadPool *thread_pool)
-    : init_s_(init_s), ptr_st_graph_(std::move(ptr_st_graph)),
-      ref_line_(ref_line) {
+                                                             const PlanningParams &params,
+                                                             common::ThreadPool *thread_pool,
+                                                             const Seeds *seeds,
+                                                             common::MonotonicArena *arena,
+                                                             const CollisionChecker *collision_checker)
+    : params_(params), arena_(arena),
+      cost_queue_(Comparator(), CandidatePairVector(common::ArenaAllocator<CandidatePair>(arena))),
+      init_s_(init_s), ptr_st_graph_(std::move(ptr_st_graph)),
+      ref_line_(std::move(ref_line)),
+      collision_checker_(params_.lattice_weight_clearance > 0.0 ? collision_checker : nullptr) {
+  const bool is_uniform_grid = params_.sample_times.empty();
+  use_fixed_horizon_kernel_ = params_.fixed_horizon_kernel && is_uniform_grid
+      && params_.num_time_steps == kFixedHorizonSteps;
   double start_time = 0.0;
-  double end_time = PlanningConfig::Instance().max_lookahead_time();
-  intervals_ = ptr_st_graph_->GetPathBlockingIntervals(start_time, end_time, PlanningConfig::Instance().delta_t());
+  double end_time = params_.max_lookahead_time;
+  BuildBlockingIntervals(is_uniform_grid
+                         ? ptr_st_graph_->GetPathBlockingIntervals(start_time, end_time, params_.delta_t)
+                         : ptr_st_graph_->GetPathBlockingIntervals(params_.sample_times));
+  // the lon trajectories longer than the horizon are sampled beyond it on the last step of the grid
+  std::vector<double> sample_times = params_.sample_times;
+  if (sample_times.size() > 1) {
+    double max_param_length = 0.0;
+    for (const auto &lon_polynomial : lon_trajectory_vec) {
+      max_param_length = std::max(max_param_length, lon_polynomial.param_length);
+    }
+    const double last_step = sample_times.back() - sample_times[sample_times.size() - 2];
+    const double last_time = sample_times.back();
+    for (size_t i = 1; last_time + static_cast<double>(i - 1) * last_step < max_param_length; ++i) {
+      sample_times.push_back(last_time + static_cast<double>(i) * last_step);
+    }
+  }
   double stop_point = std::numeric_limits<double>::max();
   if (planning_target.has_stop_point) {
     stop_point = planning_target.stop_s;
   }
-  auto begin = ros::Time::now();
-  if (thread_pool != nullptr) {
-    std::vector<std::future<TrajectoryCostPair>> futures;
-    for (const auto &lon_traj : lon_trajectory_vec) {
-      double lon_end_s = lon_traj->Evaluate(0, end_time);
-      if (init_s[0] < stop_point && lon_end_s +
-          PlanningConfig::Instance().lon_safety_buffer() > stop_point) {
-        continue;
-      }
-      if (!IsValidLongitudinalTrajectory(*lon_traj)) {
-        continue;
-      }
-      for (const auto &lat_traj : lat_trajectory_vec) {
-        if (!IsValidLateralTrajectory(*lon_traj, *lat_traj)) {
-          continue;
-        }
-        auto lambda = [&lon_traj, &lat_traj, &planning_target, this]() -> TrajectoryCostPair {
-          double cost = Evaluate(planning_target, lon_traj, lat_traj);
-          return TrajectoryCostPair(TrajectoryPair(lon_traj, lat_traj), cost);
-        };
-        futures.push_back(thread_pool->PushTask(lambda));
-      }
+  const double delta_t = params_.delta_t;
+  const bool has_seeds = seeds != nullptr && seeds->cost_discount > 0.0
+      && seeds->is_seeded_lon.size() == lon_trajectory_vec.size()
+      && seeds->is_seeded_lat.size() == lat_trajectory_vec.size()
+      && std::find(seeds->is_seeded_lat.begin(), seeds->is_seeded_lat.end(), 1) != seeds->is_seeded_lat.end();
+  if (has_seeds) {
+    seed_discount_ = seeds->cost_discount;
+    is_seeded_lat_ = seeds->is_seeded_lat;
+  }
+  // reserved up front, the trajectories are not moved once their sample tables are built
+  lon_trajectory_vec_.reserve(lon_trajectory_vec.size());
+  lon_input_indices_.reserve(lon_trajectory_vec.size());
+  for (size_t k = 0; k < lon_trajectory_vec.size(); ++k) {
+    const auto &lon_polynomial = lon_trajectory_vec[k];
+    double lon_end_s = lon_polynomial.Evaluate(0, end_time);
+    if (init_s[0] < stop_point && lon_end_s +
+        params_.lon_safety_buffer > stop_point) {
+      continue;
+    }
+    lon_trajectory_vec_.emplace_back(lon_polynomial, arena_);
+    auto &lon_traj = lon_trajectory_vec_.back();
+    if (!IsValidLongitudinalTrajectory(lon_traj)) {
+      lon_trajectory_vec_.pop_back();
+      continue;
     }
-    for (auto &task : futures) {
-      cost_queue_.emplace(task.get());
+    // every lon cost term and the lat checker sample the same time grid
+    if (is_uniform_grid) {
+      lon_traj.BuildSampleTable(delta_t, std::max(end_time, lon_traj.ParamLength()));
+    } else {
+      lon_traj.BuildSampleTable(sample_times, std::max(end_time, lon_traj.ParamLength()));
     }
+    lon_input_indices_.push_back(k);
+    // the lat check only samples the lon trajectory within its param length
+    const auto &times = lon_traj.SampleParams();
+    const auto &lon_s = lon_traj.SampleValues(0);
+    std::pair<double, double> s_range(std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest());
+    for (size_t i = 0; i < times.size() && times[i] < lon_traj.ParamLength(); ++i) {
+      s_range.first = std::min(s_range.first, lon_s[i]);
+      s_range.second = std::max(s_range.second, lon_s[i]);
+    }
+    lon_s_ranges_.push_back(s_range);
+    if (has_seeds) {
+      is_seeded_lon_.push_back(seeds->is_seeded_lon[k]);
+    }
+  }
+  lat_trajectory_vec_.reserve(lat_trajectory_vec.size());
+  for (const auto &lat_polynomial : lat_trajectory_vec) {
+    lat_trajectory_vec_.emplace_back(lat_polynomial, arena_);
+    auto &lat_traj = lat_trajectory_vec_.back();
+    lat_traj.BuildSampleTable(kLatOffsetSampleResolution, params_.max_lookahead_distance);
+    lat_critical_params_.push_back(LatCriticalParams(lat_traj));
+  }
+  // only the lon cost terms are evaluated up front, the pairs are evaluated lazily in best-first order
+  // unless the eager evaluation is configured.
+  lon_costs_.resize(lon_trajectory_vec_.size());
+  if (thread_pool != nullptr) {
+    thread_pool->ParallelFor(0, lon_trajectory_vec_.size(), 1, [&planning_target, this](size_t i) {
+      lon_costs_[i] = LonCost(planning_target, lon_trajectory_vec_[i]);
+    });
   } else {
-    for (const auto &lon_traj : lon_trajectory_vec) {
-      double lon_end_s = lon_traj->Evaluate(0, end_time);
-      if (init_s[0] < stop_point && lon_end_s +
-          PlanningConfig::Instance().lon_safety_buffer() > stop_point) {
-        continue;
-      }
-      if (!IsValidLongitudinalTrajectory(*lon_traj)) {
-        continue;
-      }
+    for (size_t i = 0; i < lon_trajectory_vec_.size(); ++i) {
+      lon_costs_[i] = LonCost(planning_target, lon_trajectory_vec_[i]);
+    }
+  }
+  if (params_.eager_pair_evaluation || params_.gpu_pair_evaluation) {
+    EvaluateAllPairs(thread_pool);
+    ExpandTopLowerBounds();
+  } else {
+    for (size_t i = 0; i < lon_trajectory_vec_.size(); ++i) {
+      CandidatePair lower_bound;
+      lower_bound.lon_index = i;
+      lower_bound.cost = lon_costs_[i] - SeedDiscount(i, -1);
+      cost_queue_.push(lower_bound);
+    }
+    num_of_trajectory_pairs_ = lon_trajectory_vec_.size() * lat_trajectory_vec_.size();
+    ExpandTopLowerBounds();
+  }
 
-      for (const auto &lat_traj : lat_trajectory_vec) {
-        if (!IsValidLateralTrajectory(*lon_traj, *lat_traj)) {
-          continue;
-        }
-        double cost = Evaluate(planning_target, lon_traj, lat_traj);
-        cost_queue_.emplace(TrajectoryPair(lon_traj, lat_traj), cost);
-      }
+  ROS_INFO("[PolynomialTrajectoryEvaluator], the numeber of trajectory pairs: %zu", num_of_trajectory_pairs_);
+}
+
+PolynomialTrajectoryEvaluator::TrajectoryPair PolynomialTrajectoryEvaluator::next_top_trajectory_pair() {
+  ROS_ASSERT(has_more_trajectory_pairs());
+  auto top = cost_queue_.top();
+  cost_queue_.pop();
+  --num_of_trajectory_pairs_;
+  ExpandTopLowerBounds();
+  return TrajectoryPair(lon_input_indices_[top.lon_index], static_cast<size_t>(top.lat_index));
+}
+
+void PolynomialTrajectoryEvaluator::ExpandTopLowerBounds() {
+  while (!cost_queue_.empty()) {
+    auto top = cost_queue_.top();
+    if (!top.is_lower_bound() && (top.has_clearance || collision_checker_ == nullptr)) {
+      return;
     }
+    cost_queue_.pop();
+    if (top.is_lower_bound()) {
+      ExpandLonTrajectory(top.lon_index);
+      continue;
+    }
+    top.cost += ClearanceCost(top) * params_.lattice_weight_clearance;
+    top.has_clearance = true;
+    cost_queue_.push(top);
   }
+}
 
-  auto end = ros::Time::now();
-  ROS_WARN("[PolynomialTrajectoryEvaluator], the time elapsed by PolynomialTrajectoryEvaluator is %lf s",
-           (end - begin).toSec());
-  ROS_INFO("[PolynomialTrajectoryEvaluator], the numeber of trajectory pairs: %zu", cost_queue_.size());
+double PolynomialTrajectoryEvaluator::ClearanceCost(const CandidatePair &candidate_pair) {
+  // combined on the time grid of the footprint table, the start time does not matter to the clearances
+  FrenetLatticePlanner::CombineTrajectories(*ref_line_, lon_trajectory_vec_[candidate_pair.lon_index].polynomial(),
+                                            lat_trajectory_vec_[candidate_pair.lat_index].polynomial(), 0.0,
+                                            params_, &clearance_buffer_, true);
+  collision_checker_->Clearances(clearance_buffer_.Poses(), kClearanceCostCutoff, &clearances_);
+  double cost_sqr_sum = 0.0;
+  double cost_abs_sum = 0.0;
+  for (const double clearance : clearances_) {
+    if (clearance >= kClearanceCostCutoff) {
+      continue;
+    }
+    // the gaussian only depends on the distance over sigma, so the collision table serves the clearance sigma
+    const double cost = CollisionGaussian(clearance * (kCollisionCostSigma / kClearanceCostSigma));
+    cost_sqr_sum += cost * cost;
+    cost_abs_sum += cost;
+  }
+  return cost_sqr_sum / (cost_abs_sum + 1e-5);
 }
 
-bool PolynomialTrajectoryEvaluator::IsValidLongitudinalTrajectory(const common::Polynomial &lon_traj) {
+void PolynomialTrajectoryEvaluator::ExpandLonTrajectory(size_t lon_index) {
+  const auto &lon_traj = lon_trajectory_vec_[lon_index];
+  for (size_t j = 0; j < lat_trajectory_vec_.size(); ++j) {
+    const auto &lat_traj = lat_trajectory_vec_[j];
+    if (!IsValidLateralTrajectory(lon_index, j)) {
+      --num_of_trajectory_pairs_;
+      continue;
+    }
+    CandidatePair candidate_pair;
+    candidate_pair.lon_index = lon_index;
+    candidate_pair.lat_index = static_cast<int>(j);
+    candidate_pair.cost = lon_costs_[lon_index] + LatCost(lon_traj, lat_traj)
+        - SeedDiscount(lon_index, candidate_pair.lat_index);
+    cost_queue_.push(candidate_pair);
+  }
+}
 
-  double t = 0.0;
-  while (t < lon_traj.ParamLength()) {
-    double v = lon_traj.Evaluate(1, t);
-    if (!ConstraintChecker::WithInRange(v, PlanningConfig::Instance().min_lon_velocity(),
-                                        PlanningConfig::Instance().max_lon_velocity())) {
+void PolynomialTrajectoryEvaluator::EvaluateAllPairs(common::ThreadPool *thread_pool) {
+  if (params_.gpu_pair_evaluation && EvaluateAllPairsInBatch(thread_pool)) {
+    return;
+  }
+  const size_t num_lat = lat_trajectory_vec_.size();
+  // pairs[lon_index * num_lat + lat_index], the invalid pairs keep the lat index -1 and are dropped afterwards
+  CandidatePairVector pairs(lon_trajectory_vec_.size() * num_lat, CandidatePair(),
+                            common::ArenaAllocator<CandidatePair>(arena_));
+  auto evaluate_lon_trajectory = [&pairs, num_lat, this](size_t lon_index) {
+    const auto &lon_traj = lon_trajectory_vec_[lon_index];
+    for (size_t j = 0; j < num_lat; ++j) {
+      auto &candidate_pair = pairs[lon_index * num_lat + j];
+      candidate_pair.lon_index = lon_index;
+      const auto &lat_traj = lat_trajectory_vec_[j];
+      if (!IsValidLateralTrajectory(lon_index, j)) {
+        continue;
+      }
+      candidate_pair.lat_index = static_cast<int>(j);
+      candidate_pair.cost = lon_costs_[lon_index] + LatCost(lon_traj, lat_traj)
+        - SeedDiscount(lon_index, candidate_pair.lat_index);
+    }
+  };
+  if (thread_pool != nullptr) {
+    // contiguous blocks of lon trajectories, a few per thread to even out the blocks of many invalid pairs
+    const size_t grain = std::max<size_t>(1, lon_trajectory_vec_.size() / (4 * thread_pool->Size()));
+    thread_pool->ParallelFor(0, lon_trajectory_vec_.size(), grain, evaluate_lon_trajectory);
+  } else {
+    for (size_t i = 0; i < lon_trajectory_vec_.size(); ++i) {
+      evaluate_lon_trajectory(i);
+    }
+  }
+  pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [](const CandidatePair &candidate_pair) {
+    return candidate_pair.is_lower_bound();
+  }), pairs.end());
+  num_of_trajectory_pairs_ = pairs.size();
+  // a single heapify of all pairs instead of one push per pair
+  cost_queue_ = std::priority_queue<CandidatePair, CandidatePairVector, Comparator>(Comparator(), std::move(pairs));
+}
 
-//      ROS_FATAL("[PolynomialTrajectoryEvaluator], the lon_traj is not valid, because **LON_VEL** exceeds the  vel range. vel: %lf", v);
-      return false;
+bool PolynomialTrajectoryEvaluator::EvaluateAllPairsInBatch(common::ThreadPool *thread_pool) {
+  LatticePairBatch batch;
+  std::vector<ScoredLatticePair> scored_pairs;
+  if (!BuildPairBatch(&batch)) {
+    ROS_WARN("[PolynomialTrajectoryEvaluator], the lat trajectories have no common sample grid, "
+             "the pairs are evaluated one by one");
+    return false;
+  }
+  if (!LatticeGpuEvaluator::EvaluatePairs(batch, &scored_pairs)) {
+    ROS_WARN_ONCE("[PolynomialTrajectoryEvaluator], no CUDA device, the pair kernel runs on the thread pool");
+    LatticeGpuEvaluator::EvaluatePairsOnHost(batch, thread_pool, &scored_pairs);
+  }
+  CandidatePairVector pairs{common::ArenaAllocator<CandidatePair>(arena_)};
+  pairs.reserve(scored_pairs.size());
+  for (const auto &scored_pair : scored_pairs) {
+    CandidatePair candidate_pair;
+    candidate_pair.lon_index = scored_pair.lon_index;
+    candidate_pair.lat_index = static_cast<int>(scored_pair.lat_index);
+    candidate_pair.cost = scored_pair.cost;
+    pairs.push_back(candidate_pair);
+  }
+  num_of_trajectory_pairs_ = pairs.size();
+  // the pairs sorted on the device are a heap already, the heapify only checks them
+  cost_queue_ = std::priority_queue<CandidatePair, CandidatePairVector, Comparator>(Comparator(), std::move(pairs));
+  return true;
+}
+
+bool PolynomialTrajectoryEvaluator::BuildPairBatch(LatticePairBatch *batch) const {
+  const size_t num_lon = lon_trajectory_vec_.size();
+  const size_t num_lat = lat_trajectory_vec_.size();
+  batch->num_lon = num_lon;
+  batch->num_lat = num_lat;
+  batch->init_s = init_s_[0];
+  batch->max_lat_offset = kMaxLatOffset;
+  batch->lat_jerk_weight = params_.lattice_weight_lat_jerk;
+  batch->lat_offset_weight = params_.lattice_weight_lat_offset;
+  batch->same_side_offset_weight = params_.lattice_weight_same_side_offset;
+  batch->opposite_side_offset_weight = params_.lattice_weight_opposite_side_offset;
+  batch->seed_discount = seed_discount_;
+
+  size_t num_lon_samples = 0;
+  for (const auto &lon_traj : lon_trajectory_vec_) {
+    num_lon_samples = std::max(num_lon_samples, lon_traj.NumOfSamples());
+  }
+  batch->num_lon_samples = num_lon_samples;
+  batch->lon_s.assign(num_lon * num_lon_samples, 0.0);
+  batch->lon_s_dot.assign(num_lon * num_lon_samples, 0.0);
+  batch->lon_s_ddot.assign(num_lon * num_lon_samples, 0.0);
+  batch->lon_num_cost_steps.resize(num_lon);
+  batch->lon_num_check_steps.resize(num_lon);
+  batch->lon_costs = lon_costs_;
+  batch->lon_min_s.resize(num_lon);
+  batch->lon_max_s.resize(num_lon);
+  batch->lon_offset_horizons.resize(num_lon);
+  batch->lon_seeded.assign(num_lon, 0);
+  for (size_t i = 0; i < num_lon; ++i) {
+    const auto &lon_traj = lon_trajectory_vec_[i];
+    const size_t num_samples = lon_traj.NumOfSamples();
+    std::copy_n(lon_traj.SampleValues(0).begin(), num_samples, batch->lon_s.begin() + i * num_lon_samples);
+    std::copy_n(lon_traj.SampleValues(1).begin(), num_samples, batch->lon_s_dot.begin() + i * num_lon_samples);
+    std::copy_n(lon_traj.SampleValues(2).begin(), num_samples, batch->lon_s_ddot.begin() + i * num_lon_samples);
+    const size_t num_cost_steps = use_fixed_horizon_kernel_ ? kFixedHorizonSteps : NumOfCostSteps(lon_traj);
+    batch->lon_num_cost_steps[i] = static_cast<uint32_t>(std::min(num_cost_steps, num_samples));
+    const auto &times = lon_traj.SampleParams();
+    size_t num_check_steps = 0;
+    while (num_check_steps < times.size() && times[num_check_steps] < lon_traj.ParamLength()) {
+      ++num_check_steps;
     }
-    double a = lon_traj.Evaluate(2, t);
-    if (!ConstraintChecker::WithInRange(a,
-                                        PlanningConfig::Instance().min_lon_acc(),
-                                        PlanningConfig::Instance().max_lon_acc())) {
-//      ROS_FATAL("[PolynomialTrajectoryEvaluator], the lon_traj is not valid, because **LON_ACC** exceeds the  acc range. a: %lf", a);
-      return false;
+    batch->lon_num_check_steps[i] = static_cast<uint32_t>(num_check_steps);
+    batch->lon_min_s[i] = lon_s_ranges_[i].first;
+    batch->lon_max_s[i] = lon_s_ranges_[i].second;
+    batch->lon_offset_horizons[i] = std::min(params_.max_lookahead_distance,
+                                             lon_traj.Evaluate(0, lon_traj.ParamLength()));
+    if (!is_seeded_lon_.empty()) {
+      batch->lon_seeded[i] = is_seeded_lon_[i];
     }
-    double j = lon_traj.Evaluate(3, t);
-    if (!ConstraintChecker::WithInRange(j,
-                                        PlanningConfig::Instance().min_lon_jerk(),
-                                        PlanningConfig::Instance().max_lon_jerk())) {
-//      ROS_FATAL("[PolynomialTrajectoryEvaluator], the lon_traj is not valid, because **LON_JERK** exceeds the  jerk range. jerk: %lf", j);
+  }
+
+  // every lat sample table is built on the same s grid
+  const size_t num_lat_samples = num_lat == 0 ? 0 : lat_trajectory_vec_.front().NumOfSamples();
+  batch->num_lat_samples = num_lat_samples;
+  if (num_lat > 0) {
+    const auto &sample_s = lat_trajectory_vec_.front().SampleParams();
+    batch->lat_sample_s.assign(sample_s.begin(), sample_s.end());
+  }
+  batch->lat_coefs.resize(num_lat * LatticePairBatch::kNumCoefs);
+  batch->lat_param_lengths.resize(num_lat);
+  batch->lat_offset_starts.resize(num_lat);
+  batch->lat_offsets.resize(num_lat * num_lat_samples);
+  batch->lat_critical_offsets.assign(1, 0);
+  batch->lat_critical_params.clear();
+  batch->lat_seeded.assign(num_lat, 0);
+  for (size_t j = 0; j < num_lat; ++j) {
+    const auto &lat_traj = lat_trajectory_vec_[j];
+    if (lat_traj.NumOfSamples() != num_lat_samples) {
       return false;
     }
-    t += PlanningConfig::Instance().delta_t();
+    const auto &coefs = lat_traj.polynomial().coefs;
+    std::copy(coefs.begin(), coefs.end(), batch->lat_coefs.begin() + j * LatticePairBatch::kNumCoefs);
+    batch->lat_param_lengths[j] = lat_traj.ParamLength();
+    batch->lat_offset_starts[j] = lat_traj.Evaluate(0, 0.0);
+    std::copy_n(lat_traj.SampleValues(0).begin(), num_lat_samples, batch->lat_offsets.begin() + j * num_lat_samples);
+    batch->lat_critical_params.insert(batch->lat_critical_params.end(), lat_critical_params_[j].begin(),
+                                      lat_critical_params_[j].end());
+    batch->lat_critical_offsets.push_back(static_cast<uint32_t>(batch->lat_critical_params.size()));
+    if (!is_seeded_lat_.empty()) {
+      batch->lat_seeded[j] = is_seeded_lat_[j];
+    }
   }
   return true;
 }
 
-bool PolynomialTrajectoryEvaluator::IsValidLateralTrajectory(const common::Polynomial &lon_traj,
-                                                             const common::Polynomial &lat_traj) {
-  double t = 0.0;
-  while (t < lon_traj.ParamLength()) {
-    double s = lon_traj.Evaluate(0, t);
-    double l = lat_traj.Evaluate(0, s);
-//    double dsdt = lon_traj.Evaluate(1, t);
-//    double dsddt = lon_traj.Evaluate(2, t);
-//    double dlds = lat_traj.Evaluate(1, s);
-//    double dldds = lat_traj.Evaluate(2, s);
-//    double dldt = dlds * dsdt;
-//    double dlddt = dldds * dsdt * dsdt + dlds * dsddt;
-    if (!ConstraintChecker::WithInRange(l, -3.5/2, 3.5/2)) {
+double PolynomialTrajectoryEvaluator::SeedDiscount(size_t lon_index, int lat_index) const {
+  if (is_seeded_lon_.empty() || !is_seeded_lon_[lon_index]) {
+    return 0.0;
+  }
+  // the lat cost terms stay non-negative, so the discounted lon cost still bounds every discounted pairing
+  if (lat_index < 0) {
+    return seed_discount_;
+  }
+  return is_seeded_lat_[lat_index] ? seed_discount_ : 0.0;
+}
+
+void PolynomialTrajectoryEvaluator::BuildBlockingIntervals(
+    const std::vector<std::vector<std::pair<double, double>>> &intervals) {
+  const double lon_safety_buffer = params_.lon_safety_buffer;
+  blocking_intervals_.resize(intervals.size());
+  for (size_t i = 0; i < intervals.size(); ++i) {
+    auto sorted_intervals = intervals[i];
+    std::sort(sorted_intervals.begin(), sorted_intervals.end());
+    auto &blocking_intervals = blocking_intervals_[i];
+    for (const auto &interval : sorted_intervals) {
+      blocking_intervals.lower_s.push_back(interval.first - lon_safety_buffer);
+      blocking_intervals.upper_s.push_back(interval.second + lon_safety_buffer);
+      blocking_intervals.max_length = std::max(blocking_intervals.max_length,
+                                               blocking_intervals.upper_s.back() - blocking_intervals.lower_s.back());
+    }
+  }
+}
+
+bool PolynomialTrajectoryEvaluator::IsValidLongitudinalTrajectory(const LatticeTrajectory1d &lon_traj) const {
+  // the exact ranges over the polynomial, the sampled check missed the peaks between the samples
+  const double param_length = lon_traj.ParamLength();
+  if (param_length <= 0.0) {
+    return true;
+  }
+  const auto vel_range = lon_traj.DerivativeRange(1, 0.0, param_length);
+  if (!ConstraintChecker::WithInRange(vel_range.first, params_.min_lon_velocity, params_.max_lon_velocity)
+      || !ConstraintChecker::WithInRange(vel_range.second, params_.min_lon_velocity, params_.max_lon_velocity)) {
+    return false;
+  }
+  const auto acc_range = lon_traj.DerivativeRange(2, 0.0, param_length);
+  if (!ConstraintChecker::WithInRange(acc_range.first, params_.min_lon_acc, params_.max_lon_acc)
+      || !ConstraintChecker::WithInRange(acc_range.second, params_.min_lon_acc, params_.max_lon_acc)) {
+    return false;
+  }
+  const auto jerk_range = lon_traj.DerivativeRange(3, 0.0, param_length);
+  return ConstraintChecker::WithInRange(jerk_range.first, params_.min_lon_jerk, params_.max_lon_jerk)
+      && ConstraintChecker::WithInRange(jerk_range.second, params_.min_lon_jerk, params_.max_lon_jerk);
+}
+
+bool PolynomialTrajectoryEvaluator::IsValidLateralTrajectory(size_t lon_index, size_t lat_index) const {
+  const auto &lon_traj = lon_trajectory_vec_[lon_index];
+  const auto &lat_traj = lat_trajectory_vec_[lat_index];
+  const double min_s = lon_s_ranges_[lon_index].first;
+  const double max_s = lon_s_ranges_[lon_index].second;
+  if (min_s > max_s) {
+    return true;
+  }
+  // the range ends are sampled, the extremes of |l| between them are at the range ends or at the critical params
+  if (!ConstraintChecker::WithInRange(lat_traj.Evaluate(0, min_s), -kMaxLatOffset, kMaxLatOffset)
+      || !ConstraintChecker::WithInRange(lat_traj.Evaluate(0, max_s), -kMaxLatOffset, kMaxLatOffset)) {
+    return false;
+  }
+  bool is_within_bound = true;
+  for (const double s : lat_critical_params_[lat_index]) {
+    if (s > min_s && s < max_s
+        && !ConstraintChecker::WithInRange(lat_traj.Evaluate(0, s), -kMaxLatOffset, kMaxLatOffset)) {
+      is_within_bound = false;
+      break;
+    }
+  }
+  if (is_within_bound) {
+    return true;
+  }
+  // the bound is only crossed between the ends, it depends on whether a sampled s falls there
+  const auto &times = lon_traj.SampleParams();
+  const auto &lon_s = lon_traj.SampleValues(0);
+  const double param_length = lon_traj.ParamLength();
+  for (size_t i = 0; i < times.size() && times[i] < param_length; ++i) {
+    if (!ConstraintChecker::WithInRange(lat_traj.Evaluate(0, lon_s[i]), -kMaxLatOffset, kMaxLatOffset)) {
       return false;
     }
-    t += PlanningConfig::Instance().delta_t();
-//    if (!ConstraintChecker::WithInRange(dlddt,
-//                                        PlanningConfig::Instance().min_lat_acc(),
-//                                        PlanningConfig::Instance().max_lat_acc())) {
-//      return false;
-//    }
   }
   return true;
 }
 
-double PolynomialTrajectoryEvaluator::Evaluate(const PlanningTarget &planning_target,
-                                               const std::shared_ptr<common::Polynomial> &lon_traj,
-                                               const std::shared_ptr<common::Polynomial> &lat_traj) {
-  double lon_target_cost = PolynomialTrajectoryEvaluator::LonTargetCost(lon_traj, planning_target);
-  double lon_jerk_cost = PolynomialTrajectoryEvaluator::LonJerkCost(lon_traj);
+std::vector<double> PolynomialTrajectoryEvaluator::LatCriticalParams(const LatticeTrajectory1d &lat_traj) {
+  const double param_length = lat_traj.ParamLength();
+  std::vector<double> critical_params = lat_traj.CriticalParams(0, 0.0, param_length);
+  // the end conditions have a zero slope the bisection may miss by rounding, and the extension beyond the param
+  // length is a parabola
+  critical_params.push_back(param_length);
+  const double end_dl = lat_traj.Evaluate(1, param_length);
+  const double end_ddl = lat_traj.Evaluate(2, param_length);
+  if (end_ddl != 0.0 && -end_dl / end_ddl > 0.0) {
+    critical_params.push_back(param_length - end_dl / end_ddl);
+  }
+  return critical_params;
+}
+
+double PolynomialTrajectoryEvaluator::LonCost(const PlanningTarget &planning_target,
+                                              const LatticeTrajectory1d &lon_traj) const {
+  return use_fixed_horizon_kernel_ ? LonCostWithKernel<kFixedHorizonSteps>(planning_target, lon_traj)
+                                   : LonCostWithKernel<0>(planning_target, lon_traj);
+}
+
+double PolynomialTrajectoryEvaluator::LatCost(const LatticeTrajectory1d &lon_traj,
+                                              const LatticeTrajectory1d &lat_traj) const {
+  return use_fixed_horizon_kernel_ ? LatCostWithKernel<kFixedHorizonSteps>(lon_traj, lat_traj)
+                                   : LatCostWithKernel<0>(lon_traj, lat_traj);
+}
+
+template<size_t N>
+double PolynomialTrajectoryEvaluator::LonCostWithKernel(const PlanningTarget &planning_target,
+                                                        const LatticeTrajectory1d &lon_traj) const {
+  double lon_target_cost = this->LonTargetCost(lon_traj, planning_target);
+  double lon_jerk_cost = this->LonJerkCost<N>(lon_traj);
   double lon_collision_cost = this->LonCollisionCost(lon_traj);
-  double lat_offset_cost = PolynomialTrajectoryEvaluator::LatOffsetCost(lat_traj, lon_traj);
-  double lat_jerk_cost = this->LatJerkCost(lat_traj, lon_traj);
-  double centripental_cost = this->CentripetalAccelerationCost(lon_traj);
-#if DEBUG
-  //  std::cout << " lon_target_cost: " << lon_target_cost << ",lon_jerk_cost: " << lon_jerk_cost
-  //            << ", lon_collision_cost: " << lon_collision_cost
-  //            << ", lat_offset_cost: " << lat_offset_cost << ", lat_jerk_cost: " << lat_jerk_cost
-  //            << ", centripental_cost: " << centripental_cost << std::endl;
-#endif
-  return lon_collision_cost * PlanningConfig::Instance().lattice_weight_collision() +
-      lon_jerk_cost * PlanningConfig::Instance().lattice_weight_lon_jerk() +
-      lon_target_cost * PlanningConfig::Instance().lattice_weight_lon_target() +
-      lat_jerk_cost * PlanningConfig::Instance().lattice_weight_lat_jerk() +
-      lat_offset_cost * PlanningConfig::Instance().lattice_weight_lat_offset() +
-      centripental_cost * PlanningConfig::Instance().lattice_weight_centripetal_acc();
+  double centripental_cost = this->CentripetalAccelerationCost<N>(lon_traj);
+  return lon_collision_cost * params_.lattice_weight_collision +
+      lon_jerk_cost * params_.lattice_weight_lon_jerk +
+      lon_target_cost * params_.lattice_weight_lon_target +
+      centripental_cost * params_.lattice_weight_centripetal_acc;
+}
+
+template<size_t N>
+double PolynomialTrajectoryEvaluator::LatCostWithKernel(const LatticeTrajectory1d &lon_traj,
+                                                        const LatticeTrajectory1d &lat_traj) const {
+  double lat_offset_cost = this->LatOffsetCost(lat_traj, lon_traj);
+  double lat_jerk_cost = this->LatJerkCost<N>(lat_traj, lon_traj);
+  return lat_jerk_cost * params_.lattice_weight_lat_jerk +
+      lat_offset_cost * params_.lattice_weight_lat_offset;
+}
+
+size_t PolynomialTrajectoryEvaluator::NumOfCostSteps(const LatticeTrajectory1d &lon_trajectory) const {
+  const size_t num_steps = params_.sample_times.empty() ? params_.num_time_steps : params_.num_sample_steps;
+  return std::min(num_steps, lon_trajectory.NumOfSamples());
 }
 
 size_t PolynomialTrajectoryEvaluator::num_of_trajectory_pairs() const {
-  return cost_queue_.size();
+  return num_of_trajectory_pairs_;
 }
 bool PolynomialTrajectoryEvaluator::has_more_trajectory_pairs() const {
   return !cost_queue_.empty();
 }
 
-double PolynomialTrajectoryEvaluator::LatJerkCost(const std::shared_ptr<common::Polynomial> &lat_trajectory,
-                                                  const std::shared_ptr<common::Polynomial> &lon_trajectory) const {
-
-  double max_cost = 0.0;
-  for (double t = 0.0; t < PlanningConfig::Instance().max_lookahead_time();
-       t += PlanningConfig::Instance().delta_t()) {
-    double s = lon_trajectory->Evaluate(0, t);
-    double s_dot = lon_trajectory->Evaluate(1, t);
-    double s_dotdot = lon_trajectory->Evaluate(2, t);
-
-    double relative_s = s - init_s_[0];
-    double l_prime = lat_trajectory->Evaluate(1, relative_s);
-    double l_primeprime = lat_trajectory->Evaluate(2, relative_s);
-    double cost = l_primeprime * s_dot * s_dot + l_prime * s_dotdot;
-    max_cost = std::max(max_cost, std::fabs(cost));
-  }
-  return max_cost;
+template<size_t N>
+double PolynomialTrajectoryEvaluator::LatJerkCost(const LatticeTrajectory1d &lat_trajectory,
+                                                  const LatticeTrajectory1d &lon_trajectory) const {
+  const double *lon_s = lon_trajectory.SampleValues(0).data();
+  const double *lon_s_dot = lon_trajectory.SampleValues(1).data();
+  const double *lon_s_dotdot = lon_trajectory.SampleValues(2).data();
+  const double init_s = init_s_[0];
+  return LatticeKernel<N>::MaxAbs(NumOfCostSteps(lon_trajectory), [&](size_t i) {
+    // the lat trajectory is sampled at s values depending on the lon trajectory, so it can't use its table.
+    double relative_s = lon_s[i] - init_s;
+    double l_prime = lat_trajectory.Evaluate(1, relative_s);
+    double l_primeprime = lat_trajectory.Evaluate(2, relative_s);
+    return l_primeprime * lon_s_dot[i] * lon_s_dot[i] + l_prime * lon_s_dotdot[i];
+  });
 }
 
-double PolynomialTrajectoryEvaluator::LatOffsetCost(const std::shared_ptr<common::Polynomial> &lat_trajectory,
-                                                    const std::shared_ptr<common::Polynomial> &lon_trajectory) {
-  const double param_length = lon_trajectory->ParamLength();
-  double evaluation_horizon = std::min(PlanningConfig::Instance().max_lookahead_distance(),
-                                       lon_trajectory->Evaluate(0, param_length));
-  std::vector<double> s_values;
-  for (double s = 0.0; s < evaluation_horizon; s += 0.1) {
-    s_values.emplace_back(s);
-  }
-  double lat_offset_start = lat_trajectory->Evaluate(0, 0.0);
+double PolynomialTrajectoryEvaluator::LatOffsetCost(const LatticeTrajectory1d &lat_trajectory,
+                                                    const LatticeTrajectory1d &lon_trajectory) const {
+  ROS_ASSERT(lat_trajectory.HasSampleTable());
+  const double param_length = lon_trajectory.ParamLength();
+  double evaluation_horizon = std::min(params_.max_lookahead_distance,
+                                       lon_trajectory.Evaluate(0, param_length));
+  const auto &s_values = lat_trajectory.SampleParams();
+  const auto &lat_offsets = lat_trajectory.SampleValues(0);
+  double lat_offset_start = lat_trajectory.Evaluate(0, 0.0);
   double cost_sqr_sum = 0.0;
   double cost_abs_sum = 0.0;
-  for (const auto &s : s_values) {
-    double lat_offset = lat_trajectory->Evaluate(0, s);
+  for (size_t i = 0; i < s_values.size() && s_values[i] < evaluation_horizon; ++i) {
+    double lat_offset = lat_offsets[i];
     double cost = lat_offset / 3.0;
     if (lat_offset * lat_offset_start < 0.0) {
-      cost_sqr_sum += cost * cost * PlanningConfig::Instance().lattice_weight_opposite_side_offset();
-      cost_abs_sum += std::fabs(cost) * PlanningConfig::Instance().lattice_weight_opposite_side_offset();
+      cost_sqr_sum += cost * cost * params_.lattice_weight_opposite_side_offset;
+      cost_abs_sum += std::fabs(cost) * params_.lattice_weight_opposite_side_offset;
     } else {
-      cost_sqr_sum += cost * cost * PlanningConfig::Instance().lattice_weight_same_side_offset();
-      cost_abs_sum += std::fabs(cost) * PlanningConfig::Instance().lattice_weight_same_side_offset();
+      cost_sqr_sum += cost * cost * params_.lattice_weight_same_side_offset;
+      cost_abs_sum += std::fabs(cost) * params_.lattice_weight_same_side_offset;
     }
   }
   return cost_sqr_sum / (cost_abs_sum + 1e-5);
 }
 
-double PolynomialTrajectoryEvaluator::LonJerkCost(const std::shared_ptr<common::Polynomial> &lon_trajectory) {
-  double cost_sqr_sum = 0.0;
-  double cost_abs_sum = 0.0;
-  for (double t = 0.0; t < PlanningConfig::Instance().max_lookahead_time();
-       t += PlanningConfig::Instance().delta_t()) {
-    double jerk = lon_trajectory->Evaluate(3, t);
-    double cost = jerk / PlanningConfig::Instance().max_lon_jerk();
-    cost_sqr_sum += cost * cost;
-    cost_abs_sum += std::fabs(cost);
-  }
-  return cost_sqr_sum / (cost_abs_sum + 1.0e-5);
+template<size_t N>
+double PolynomialTrajectoryEvaluator::LonJerkCost(const LatticeTrajectory1d &lon_trajectory) const {
+  const double *jerks = lon_trajectory.SampleValues(3).data();
+  const double inv_max_lon_jerk = 1.0 / params_.max_lon_jerk;
+  return LatticeKernel<N>::SquareOverAbsSum(NumOfCostSteps(lon_trajectory), 1.0e-5, [&](size_t i) {
+    return jerks[i] * inv_max_lon_jerk;
+  });
 }
 
-double PolynomialTrajectoryEvaluator::LonTargetCost(const std::shared_ptr<common::Polynomial> &lon_trajectory,
-                                                    const PlanningTarget &planning_target) {
+double PolynomialTrajectoryEvaluator::LonTargetCost(const LatticeTrajectory1d &lon_trajectory,
+                                                    const PlanningTarget &planning_target) const {
 
-  double t_max = lon_trajectory->ParamLength();
-  double dist_s = lon_trajectory->Evaluate(0, t_max) - lon_trajectory->Evaluate(0, 0.0);
+  double t_max = lon_trajectory.ParamLength();
+  double dist_s = lon_trajectory.Evaluate(0, t_max) - lon_trajectory.Evaluate(0, 0.0);
 //  std::cout << " ............dist_s: " << dist_s << std::endl;
   double speed_cost_sqr_sum = 0.0;
   double speed_cost_weight_sum = 0.0;
 //  ROS_INFO("LonTargetCost: the desired vel is %f", planning_target.desired_vel);
   double target_speed = /*planning_target.has_stop_point ? 0.0 :*/ planning_target.desired_vel;
-  for (double t = 0; t <= t_max; t += PlanningConfig::Instance().delta_t()) {
-    double cost = target_speed - lon_trajectory->Evaluate(1, t);
+  const auto &times = lon_trajectory.SampleParams();
+  const auto &speeds = lon_trajectory.SampleValues(1);
+  for (size_t i = 0; i < times.size() && times[i] <= t_max; ++i) {
+    double t = times[i];
+    double cost = target_speed - speeds[i];
 //    std::cout << " ============cost:=======      " << cost << ", lon_trajectory->Evaluate(1, t): "
 //              << lon_trajectory->Evaluate(1, t) << ",  target_speed: " << target_speed << std::endl;
 
@@ -239,29 +605,37 @@ double PolynomialTrajectoryEvaluator::LonTargetCost(const std::shared_ptr<common
 
   double dist_travelled_cost = 1.0 / (1.0 + std::fabs(dist_s));
 //  std::cout << " speed cost: " << speed_cost << "dist_travleed_cost: " << dist_travelled_cost << std::endl;
-  return speed_cost * PlanningConfig::Instance().lattice_weight_target_speed() +
-      dist_travelled_cost * PlanningConfig::Instance().lattice_weight_dist_travelled();
+  return speed_cost * params_.lattice_weight_target_speed +
+      dist_travelled_cost * params_.lattice_weight_dist_travelled;
 }
 
-double PolynomialTrajectoryEvaluator::LonCollisionCost(const std::shared_ptr<common::Polynomial> &lon_trajectory) const {
+double PolynomialTrajectoryEvaluator::LonCollisionCost(const LatticeTrajectory1d &lon_trajectory) const {
   double cost_sqr_sum = 0.0;
   double cost_abs_sum = 0.0;
-  for (size_t i = 0; i < intervals_.size(); ++i) {
-    const auto &pt_interval = intervals_[i];
-    if (pt_interval.empty()) {
+  for (size_t i = 0; i < blocking_intervals_.size(); ++i) {
+    const auto &blocking_intervals = blocking_intervals_[i];
+    if (blocking_intervals.lower_s.empty()) {
       continue;
     }
-    double t = static_cast<double>(i) * PlanningConfig::Instance().delta_t();
-    double traj_s = lon_trajectory->Evaluate(0, t);
-    double sigma = 2.0;
-    for (const auto &m : pt_interval) {
+    double traj_s = 0.0;
+    if (i < lon_trajectory.NumOfSamples()) {
+      traj_s = lon_trajectory.SampleValue(0, i);
+    } else {
+      double t = params_.sample_times.empty() ? static_cast<double>(i) * params_.delta_t : params_.sample_times[i];
+      traj_s = lon_trajectory.Evaluate(0, t);
+    }
+    const auto &lower_s = blocking_intervals.lower_s;
+    const auto first = std::lower_bound(lower_s.begin(), lower_s.end(),
+                                        traj_s - kCollisionCostCutoff - blocking_intervals.max_length);
+    const auto last = std::upper_bound(first, lower_s.end(), traj_s + kCollisionCostCutoff);
+    for (auto k = static_cast<size_t>(first - lower_s.begin()); k < static_cast<size_t>(last - lower_s.begin()); ++k) {
       double dist = 0.0;
-      if (traj_s < m.first - PlanningConfig::Instance().lon_safety_buffer()) {
-        dist = m.first - PlanningConfig::Instance().lon_safety_buffer() - traj_s;
-      } else if (traj_s > m.second + PlanningConfig::Instance().lon_safety_buffer()) {
-        dist = traj_s - m.second - PlanningConfig::Instance().lon_safety_buffer();
+      if (traj_s < lower_s[k]) {
+        dist = lower_s[k] - traj_s;
+      } else if (traj_s > blocking_intervals.upper_s[k]) {
+        dist = traj_s - blocking_intervals.upper_s[k];
       }
-      double cost = std::exp(-dist * dist / (2.0 * sigma * sigma));
+      double cost = CollisionGaussian(dist);
 
       cost_sqr_sum += cost * cost;
       cost_abs_sum += cost;
@@ -270,22 +644,14 @@ double PolynomialTrajectoryEvaluator::LonCollisionCost(const std::shared_ptr<com
   return cost_sqr_sum / (cost_abs_sum + 1e-5);
 }
 
+template<size_t N>
 double PolynomialTrajectoryEvaluator::CentripetalAccelerationCost(
-    const std::shared_ptr<common::Polynomial> &lon_trajectory) const {
-  double centripetal_acc_sum = 0.0;
-  double centripetal_acc_sqr_sum = 0.0;
-  for (double t = 0.0; t < PlanningConfig::Instance().max_lookahead_time();
-       t += PlanningConfig::Instance().delta_t()) {
-    double s = lon_trajectory->Evaluate(0, t);
-    double v = lon_trajectory->Evaluate(1, t);
-    auto ref_point = ref_line_.GetReferencePoint(s);
-    double centripetal_acc = v * v * ref_point.kappa();
-    centripetal_acc_sum += std::fabs(centripetal_acc);
-    centripetal_acc_sqr_sum += centripetal_acc * centripetal_acc;
-  }
-
-  return centripetal_acc_sqr_sum /
-      (centripetal_acc_sum + 1e-5);
+    const LatticeTrajectory1d &lon_trajectory) const {
+  const double *lon_s = lon_trajectory.SampleValues(0).data();
+  const double *lon_v = lon_trajectory.SampleValues(1).data();
+  return LatticeKernel<N>::SquareOverAbsSum(NumOfCostSteps(lon_trajectory), 1e-5, [&](size_t i) {
+    return lon_v[i] * lon_v[i] * ref_line_->GetReferencePoint(lon_s[i]).kappa();
+  });
 }
 
-}
\ No newline at end of file
+}
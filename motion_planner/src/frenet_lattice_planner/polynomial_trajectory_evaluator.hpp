@@ -6,16 +6,30 @@
 #include <queue>
 #include <ros/ros.h>
 #include "curves/polynomial.hpp"
+#include "collision_checker/collision_checker.hpp"
 #include "obstacle_manager/st_graph.hpp"
 #include "end_condition_sampler.hpp"
+#include "lattice_kernel.hpp"
+#include "lattice_pair_kernel.hpp"
+#include "lattice_trajectory1d.hpp"
 #include "planning_config.hpp"
 #include "frenet_lattice_planner.hpp"
 
 namespace planning {
 class PolynomialTrajectoryEvaluator {
  public:
-  typedef std::pair<std::shared_ptr<common::Polynomial>, std::shared_ptr<common::Polynomial>> TrajectoryPair;
+  // the indices of the lon and the lat trajectory in the vectors the evaluator is built from
+  typedef std::pair<size_t, size_t> TrajectoryPair;
   typedef std::pair<TrajectoryPair, double> TrajectoryCostPair;
+  /**
+   * @brief: marks the trajectories sampled around the optimum of the last cycle, a pair of a seeded lon and a seeded
+   * lat trajectory gets cost_discount off its cost, so it pops ahead of the unseeded pairs of about the same cost
+   */
+  struct Seeds {
+    std::vector<char> is_seeded_lon; // one flag per lon trajectory passed in
+    std::vector<char> is_seeded_lat; // one flag per lat trajectory passed in
+    double cost_discount = 0.0;
+  };
   PolynomialTrajectoryEvaluator() = default;
   ~PolynomialTrajectoryEvaluator() = default;
 
@@ -26,56 +40,203 @@ class PolynomialTrajectoryEvaluator {
    * @param lat_trajectory_vec
    * @param ref_line
    * @param ptr_st_graph
+   * @param params: the parameters of the planning cycle
+   * @param thread_pool
+   * @param seeds: optional, the warm start of the lon and lat trajectories
+   * @param arena: optional, where the cost queue and the sample tables are allocated, it has to outlive the
+   * evaluator
+   * @param collision_checker: optional, the clearance cost of a pair is evaluated by it once the pair is on the top
+   * of the queue, if the clearance weight is set. it has to outlive the evaluator
    */
   PolynomialTrajectoryEvaluator(const std::array<double, 3> &init_s,
                                 const PlanningTarget &planning_target,
-                                const std::vector<std::shared_ptr<common::Polynomial>> &lon_trajectory_vec,
-                                const std::vector<std::shared_ptr<common::Polynomial>> &lat_trajectory_vec,
-                                const ReferenceLine &ref_line,
+                                const std::vector<LatticePolynomial> &lon_trajectory_vec,
+                                const std::vector<LatticePolynomial> &lat_trajectory_vec,
+                                std::shared_ptr<const ReferenceLine> ref_line,
                                 std::shared_ptr<STGraph> ptr_st_graph,
-                                common::ThreadPool *thread_pool);
+                                const PlanningParams &params,
+                                common::ThreadPool *thread_pool,
+                                const Seeds *seeds = nullptr,
+                                common::MonotonicArena *arena = nullptr,
+                                const CollisionChecker *collision_checker = nullptr);
   bool has_more_trajectory_pairs() const;
   size_t num_of_trajectory_pairs() const;
-  double top_trajectory_pair_cost() const { return cost_queue_.top().second; }
-  TrajectoryPair next_top_trajectory_pair() {
-    ROS_ASSERT(has_more_trajectory_pairs());
-    auto top = cost_queue_.top();
-    cost_queue_.pop();
-    return top.first;
-  }
+  double top_trajectory_pair_cost() const { return cost_queue_.top().cost; }
+  TrajectoryPair next_top_trajectory_pair();
+
  private:
-  double CentripetalAccelerationCost(
-      const  std::shared_ptr<common::Polynomial>& lon_trajectory) const;
-  double LatJerkCost(const std::shared_ptr<common::Polynomial> &lat_trajectory,
-                     const std::shared_ptr<common::Polynomial> &lon_trajectory) const;
-  static double LatOffsetCost(const std::shared_ptr<common::Polynomial> &lat_trajectory,
-                              const std::shared_ptr<common::Polynomial> &lon_trajectory);
-  static double LonJerkCost(const std::shared_ptr<common::Polynomial> &lon_trajectory);
-  static double LonTargetCost(const std::shared_ptr<common::Polynomial> &lon_trajectory,
-                              const PlanningTarget &planning_target);
-  double LonCollisionCost(const std::shared_ptr<common::Polynomial> &lon_trajectory) const;
-
-  static bool IsValidLongitudinalTrajectory(const common::Polynomial &lon_traj);
-
-  static bool IsValidLateralTrajectory(const common::Polynomial &lon_traj, const common::Polynomial &lat_traj);
-
-  double Evaluate(const PlanningTarget &planning_target, const std::shared_ptr<common::Polynomial> &lon_traj,
-                  const std::shared_ptr<common::Polynomial> &lat_traj);
-
-  // comparator for priority queue
-  struct Comparator : public std::binary_function<const TrajectoryCostPair &, const TrajectoryCostPair &, bool> {
-    bool operator()(const TrajectoryCostPair &left, const TrajectoryCostPair &right) {
-      return left.second > right.second;
+  // resolution of the s grid the lat offset cost is sampled on
+  static constexpr double kLatOffsetSampleResolution = 0.1;
+
+  /**
+   * @brief: candidate of the lazy cost queue. lat_index < 0 marks the lower bound entry of a lon trajectory,
+   * which stands for all of its not yet evaluated pairings.
+   */
+  struct CandidatePair {
+    size_t lon_index = 0;
+    int lat_index = -1;
+    double cost = 0.0;
+    // the clearance cost is in cost, always for a pair without the clearance weight
+    bool has_clearance = false;
+    bool is_lower_bound() const { return lat_index < 0; }
+  };
+
+  /**
+   * @brief: expand the lower bound entries on the top of the queue until an exactly evaluated pair is on the top,
+   * the lat cost terms are non-negative, so the lon cost less its seed discount is a lower bound of every pairing
+   * with that lon trajectory. the same holds for the clearance cost, a pair on the top without it gets it added
+   * and is pushed back.
+   */
+  void ExpandTopLowerBounds();
+
+  /**
+   * @brief: the cost of the pair passing close to the inflated footprints, from the clearances of its poses on the
+   * time steps of the footprint table
+   */
+  double ClearanceCost(const CandidatePair &candidate_pair);
+
+  /**
+   * @brief: evaluate every valid pairing of the lon trajectory and push them into the queue
+   * @param lon_index: index of lon trajectory
+   */
+  void ExpandLonTrajectory(size_t lon_index);
+
+  /**
+   * @brief: evaluate every valid pair up front into the queue, the blocks of lon trajectories are evaluated in
+   * parallel if thread_pool is set. pops the pairs in the same order as the lazy evaluation.
+   */
+  void EvaluateAllPairs(common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: EvaluateAllPairs by the pair kernel, on the device if the planner is built with CUDA and on the
+   * thread pool otherwise
+   * @return: false if the trajectories make no batch, nothing is evaluated then
+   */
+  bool EvaluateAllPairsInBatch(common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: the kept trajectories as flat arrays for the pair kernel
+   * @param batch: [out]
+   * @return: false if the lat sample tables are not on a common grid
+   */
+  bool BuildPairBatch(LatticePairBatch *batch) const;
+
+  /**
+   * @brief: the discount of the pair, lat_index < 0 for the lower bound of every pairing of the lon trajectory
+   */
+  double SeedDiscount(size_t lon_index, int lat_index) const;
+
+  /**
+   * @brief: cost terms only depend on the lon trajectory
+   */
+  double LonCost(const PlanningTarget &planning_target, const LatticeTrajectory1d &lon_traj) const;
+
+  /**
+   * @brief: cost terms depend on the lat trajectory
+   */
+  double LatCost(const LatticeTrajectory1d &lon_traj, const LatticeTrajectory1d &lat_traj) const;
+
+  /**
+   * @brief: LonCost and LatCost with the time grid cost terms built for N steps, see LatticeKernel
+   */
+  template<size_t N>
+  double LonCostWithKernel(const PlanningTarget &planning_target, const LatticeTrajectory1d &lon_traj) const;
+  template<size_t N>
+  double LatCostWithKernel(const LatticeTrajectory1d &lon_traj, const LatticeTrajectory1d &lat_traj) const;
+
+  /**
+   * @brief: the number of time grid steps the cost terms read, at most the samples of the lon trajectory
+   */
+  size_t NumOfCostSteps(const LatticeTrajectory1d &lon_trajectory) const;
+
+  template<size_t N>
+  double CentripetalAccelerationCost(const LatticeTrajectory1d &lon_trajectory) const;
+  template<size_t N>
+  double LatJerkCost(const LatticeTrajectory1d &lat_trajectory,
+                     const LatticeTrajectory1d &lon_trajectory) const;
+  double LatOffsetCost(const LatticeTrajectory1d &lat_trajectory,
+                       const LatticeTrajectory1d &lon_trajectory) const;
+  template<size_t N>
+  double LonJerkCost(const LatticeTrajectory1d &lon_trajectory) const;
+  double LonTargetCost(const LatticeTrajectory1d &lon_trajectory,
+                       const PlanningTarget &planning_target) const;
+  double LonCollisionCost(const LatticeTrajectory1d &lon_trajectory) const;
+
+  /**
+   * @brief: sort the blocking intervals of every time step for the lon collision cost
+   */
+  void BuildBlockingIntervals(const std::vector<std::vector<std::pair<double, double>>> &intervals);
+
+  bool IsValidLongitudinalTrajectory(const LatticeTrajectory1d &lon_traj) const;
+
+  /**
+   * @brief: the pair is accepted without sampling if the largest |l| of the lat trajectory over the s range of the
+   * lon trajectory is within the bound, and rejected if it is out of bound at either end of the range. only the
+   * others are checked at every sampled s.
+   * @param lon_index: index of lon trajectory
+   * @param lat_index: index of lat trajectory
+   */
+  bool IsValidLateralTrajectory(size_t lon_index, size_t lat_index) const;
+
+  /**
+   * @brief: the s where the lat trajectory has a zero slope, within the polynomial and on its extension beyond
+   */
+  static std::vector<double> LatCriticalParams(const LatticeTrajectory1d &lat_traj);
+
+  // comparator for priority queue, ties are broken by the lon and lat index to keep the order deterministic
+  struct Comparator {
+    bool operator()(const CandidatePair &left, const CandidatePair &right) const {
+      if (left.cost != right.cost) {
+        return left.cost > right.cost;
+      }
+      if (left.lon_index != right.lon_index) {
+        return left.lon_index > right.lon_index;
+      }
+      return left.lat_index > right.lat_index;
     }
   };
+  typedef std::vector<CandidatePair, common::ArenaAllocator<CandidatePair>> CandidatePairVector;
 
  private:
-  std::priority_queue<TrajectoryCostPair, std::vector<TrajectoryCostPair>, Comparator> cost_queue_;
+  PlanningParams params_;
+  // the time grid of the config has kFixedHorizonSteps steps, the cost terms run LatticeKernel<kFixedHorizonSteps>
+  bool use_fixed_horizon_kernel_ = false;
+  common::MonotonicArena *arena_ = nullptr;
+  std::priority_queue<CandidatePair, CandidatePairVector, Comparator> cost_queue_;
+  // the kept trajectories with their sample tables, the cost queue refers to them by index
+  std::vector<LatticeTrajectory1d> lon_trajectory_vec_;
+  std::vector<LatticeTrajectory1d> lat_trajectory_vec_;
+  // the index of every kept lon trajectory in the vector passed in, the lat trajectories are all kept
+  std::vector<size_t> lon_input_indices_;
+  std::vector<double> lon_costs_;
+  // the lowest and highest sampled s of every lon trajectory over its param length
+  std::vector<std::pair<double, double>> lon_s_ranges_;
+  // LatCriticalParams of every lat trajectory
+  std::vector<std::vector<double>> lat_critical_params_;
+  // the seed flags of the kept trajectories, empty without a warm start
+  std::vector<char> is_seeded_lon_;
+  std::vector<char> is_seeded_lat_;
+  double seed_discount_ = 0.0;
+  size_t num_of_trajectory_pairs_{};
   std::array<double, 3> init_s_{0.0, 0.0, 0.0};
   std::shared_ptr<STGraph> ptr_st_graph_;
-  ReferenceLine ref_line_;
+  std::shared_ptr<const ReferenceLine> ref_line_;
+  const CollisionChecker *collision_checker_ = nullptr;
+  // the pair and its clearances of the last ClearanceCost, reused across the pairs
+  TrajectoryBuffer clearance_buffer_;
+  std::vector<double> clearances_;
 
-  std::vector<std::vector<std::pair<double, double>>> intervals_;
+  /**
+   * @brief: the blocking intervals of one time step extended by the lon safety buffer and sorted by their lower s,
+   * a lon trajectory only looks up the intervals within the cutoff distance of the collision cost.
+   */
+  struct BlockingIntervals {
+    std::vector<double> lower_s;
+    std::vector<double> upper_s;
+    // the longest interval, bounds how far below s an interval reaching s can start
+    double max_length = 0.0;
+  };
+  std::vector<BlockingIntervals> blocking_intervals_;
 
 };
 }
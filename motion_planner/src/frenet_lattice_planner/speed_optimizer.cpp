@@ -0,0 +1,291 @@
+#include "frenet_lattice_planner/speed_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "math/admm_qp_solver.hpp"
+
+namespace planning {
+namespace {
+typedef common::AdmmQpSolver::SparseMatrix SparseMatrix;
+constexpr double kInfinity = 1e20;
+constexpr double kTimeEpsilon = 1e-6;
+// the dp edge cost per second
+constexpr double kDpSpeedWeight = 1.0;
+constexpr double kDpAccWeight = 1.0;
+// the QP follows the dp path and keeps the cruise speed loosely, so the free gaps decide where the profile goes
+constexpr double kQpDpDeviationWeight = 1.0;
+constexpr double kQpSpeedWeight = 0.1;
+constexpr double kQpAccWeight = 1.0;
+constexpr double kQpJerkWeight = 5.0;
+
+/**
+ * @brief: whether s lies in one of the sorted, disjoint intervals
+ */
+bool IsBlocked(const std::vector<std::pair<double, double>> &intervals, double s) {
+  const auto iter = std::lower_bound(intervals.begin(), intervals.end(), s,
+                                     [](const std::pair<double, double> &interval, double value) {
+                                       return interval.second < value;
+                                     });
+  return iter != intervals.end() && iter->first <= s;
+}
+
+/**
+ * @brief: the free gap between the sorted, disjoint intervals that holds s, the unbounded sides are -/+ kInfinity
+ */
+std::pair<double, double> GetFreeGap(const std::vector<std::pair<double, double>> &intervals, double s) {
+  std::pair<double, double> gap(-kInfinity, kInfinity);
+  for (const auto &interval : intervals) {
+    if (interval.second < s) {
+      gap.first = interval.second;
+    } else if (interval.first > s) {
+      gap.second = interval.first;
+      break;
+    }
+  }
+  return gap;
+}
+}
+
+SpeedOptimizer::SpeedOptimizer(const PlanningParams &params) : params_(params) {}
+
+bool SpeedOptimizer::Optimize(const std::array<double, 3> &init_s,
+                              const std::vector<std::vector<std::pair<double, double>>> &blocking_intervals,
+                              double cruise_speed, double max_s, SpeedProfile *profile) const {
+  if (profile == nullptr || params_.num_time_steps == 0 || params_.delta_t <= 0.0
+      || blocking_intervals.size() < params_.num_time_steps + 1 || max_s < init_s[0]) {
+    return false;
+  }
+  const double relative_max_s = max_s - init_s[0];
+  const double speed = std::max(0.0, std::min(cruise_speed, params_.max_lon_velocity));
+  const auto intervals = InflateIntervals(init_s[0], blocking_intervals);
+  std::vector<double> dp_s;
+  if (!SearchDp(init_s, intervals, speed, relative_max_s, &dp_s)
+      || !SmoothQp(init_s, dp_s, intervals, speed, relative_max_s, profile)) {
+    return false;
+  }
+  for (auto &s : profile->s) {
+    s += init_s[0];
+  }
+  return true;
+}
+
+std::vector<std::vector<std::pair<double, double>>> SpeedOptimizer::InflateIntervals(
+    double init_s, const std::vector<std::vector<std::pair<double, double>>> &blocking_intervals) const {
+  // the ego keeps the buffer of the following and overtaking end conditions of EndConditionSampler
+  const auto &vehicle_params = params_.vehicle_params;
+  const double front_margin =
+      params_.lon_safety_buffer + vehicle_params.half_length + vehicle_params.back_axle_to_center_length;
+  const double rear_margin =
+      params_.lon_safety_buffer + vehicle_params.half_length - vehicle_params.back_axle_to_center_length;
+  std::vector<std::vector<std::pair<double, double>>> intervals(params_.num_time_steps + 1);
+  for (size_t i = 0; i < intervals.size(); ++i) {
+    for (const auto &interval : blocking_intervals[i]) {
+      if (interval.first < init_s) {
+        continue;
+      }
+      intervals[i].emplace_back(interval.first - init_s - front_margin, interval.second - init_s + rear_margin);
+    }
+    std::sort(intervals[i].begin(), intervals[i].end());
+    std::vector<std::pair<double, double>> merged;
+    for (const auto &interval : intervals[i]) {
+      if (!merged.empty() && interval.first <= merged.back().second) {
+        merged.back().second = std::max(merged.back().second, interval.second);
+      } else {
+        merged.push_back(interval);
+      }
+    }
+    intervals[i].swap(merged);
+  }
+  return intervals;
+}
+
+bool SpeedOptimizer::SearchDp(const std::array<double, 3> &init_s,
+                              const std::vector<std::vector<std::pair<double, double>>> &intervals,
+                              double cruise_speed, double max_s, std::vector<double> *dp_s) const {
+  const double ds = params_.speed_optimizer_dp_s_resolution;
+  const double dp_dt = params_.speed_optimizer_dp_t_resolution;
+  if (ds <= 0.0 || dp_dt <= 0.0) {
+    return false;
+  }
+  const double delta_t = params_.delta_t;
+  const size_t num_steps = params_.num_time_steps;
+  const double horizon = static_cast<double>(num_steps) * delta_t;
+  const auto num_columns = static_cast<size_t>(std::max(1.0, std::ceil(horizon / dp_dt - kTimeEpsilon))) + 1;
+  const auto num_rows = static_cast<size_t>(std::floor(max_s / ds)) + 1;
+  std::vector<double> column_times(num_columns);
+  for (size_t k = 0; k < num_columns; ++k) {
+    column_times[k] = std::min(static_cast<double>(k) * dp_dt, horizon);
+  }
+  // the cost, the speed of the edge reaching the node and the row it comes from, row-major per column
+  std::vector<double> costs(num_columns * num_rows, std::numeric_limits<double>::infinity());
+  std::vector<double> speeds(num_columns * num_rows, 0.0);
+  std::vector<size_t> parents(num_columns * num_rows, 0);
+  costs[0] = 0.0;
+  speeds[0] = init_s[1];
+  for (size_t k = 0; k + 1 < num_columns; ++k) {
+    const double dt = column_times[k + 1] - column_times[k];
+    // the time steps within the edges, the first one is checked by the edges ending at it
+    const auto first_step = static_cast<size_t>(std::floor(column_times[k] / delta_t + kTimeEpsilon)) + 1;
+    const size_t last_step =
+        std::min(num_steps, static_cast<size_t>(std::floor(column_times[k + 1] / delta_t + kTimeEpsilon)));
+    const auto max_rows_per_edge = static_cast<size_t>(std::floor(params_.max_lon_velocity * dt / ds));
+    for (size_t r = 0; r < num_rows; ++r) {
+      const double cost = costs[k * num_rows + r];
+      if (std::isinf(cost)) {
+        continue;
+      }
+      const double speed = speeds[k * num_rows + r];
+      for (size_t j = r; j < num_rows && j - r <= max_rows_per_edge; ++j) {
+        const double v = static_cast<double>(j - r) * ds / dt;
+        // the edge speed is the mean speed of the edge, the first edge starts from the initial speed
+        const double a = k == 0 ? 2.0 * (v - speed) / dt : (v - speed) / dt;
+        if (a > params_.max_lon_acc) {
+          break;
+        }
+        if (a < params_.min_lon_acc) {
+          continue;
+        }
+        const double edge_cost = cost + dt * (kDpSpeedWeight * (v - cruise_speed) * (v - cruise_speed)
+            + kDpAccWeight * a * a);
+        const size_t node = (k + 1) * num_rows + j;
+        if (edge_cost >= costs[node]) {
+          continue;
+        }
+        bool is_blocked = false;
+        for (size_t step = first_step; step <= last_step && !is_blocked; ++step) {
+          const double ratio = (static_cast<double>(step) * delta_t - column_times[k]) / dt;
+          is_blocked = IsBlocked(intervals[step], static_cast<double>(r) * ds + v * dt * ratio);
+        }
+        if (is_blocked) {
+          continue;
+        }
+        costs[node] = edge_cost;
+        speeds[node] = v;
+        parents[node] = r;
+      }
+    }
+  }
+  const size_t last_column = (num_columns - 1) * num_rows;
+  const auto best = std::min_element(costs.begin() + last_column, costs.end());
+  if (std::isinf(*best)) {
+    return false;
+  }
+  std::vector<double> column_s(num_columns);
+  size_t row = static_cast<size_t>(std::distance(costs.begin() + last_column, best));
+  for (size_t k = num_columns - 1; k > 0; --k) {
+    column_s[k] = static_cast<double>(row) * ds;
+    row = parents[k * num_rows + row];
+  }
+  column_s[0] = 0.0;
+  dp_s->resize(num_steps + 1);
+  size_t k = 0;
+  for (size_t i = 0; i <= num_steps; ++i) {
+    const double t = static_cast<double>(i) * delta_t;
+    while (k + 2 < num_columns && column_times[k + 1] < t) {
+      ++k;
+    }
+    const double ratio = std::min(1.0, (t - column_times[k]) / (column_times[k + 1] - column_times[k]));
+    (*dp_s)[i] = column_s[k] + (column_s[k + 1] - column_s[k]) * ratio;
+  }
+  return true;
+}
+
+bool SpeedOptimizer::SmoothQp(const std::array<double, 3> &init_s, const std::vector<double> &dp_s,
+                              const std::vector<std::vector<std::pair<double, double>>> &intervals,
+                              double cruise_speed, double max_s, SpeedProfile *profile) const {
+  const size_t num_points = dp_s.size();
+  const double dt = params_.delta_t;
+  // s, v and a of every time step, then the jerk, the v and the s continuity between the steps
+  const size_t num_variables = 3 * num_points;
+  const size_t num_constraints = num_variables + 3 * (num_points - 1);
+  const auto s_index = [](size_t i) { return i; };
+  const auto v_index = [num_points](size_t i) { return num_points + i; };
+  const auto a_index = [num_points](size_t i) { return 2 * num_points + i; };
+
+  std::vector<Eigen::Triplet<double>> cost_triplets;
+  cost_triplets.reserve(3 * num_points + 4 * num_points);
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(num_variables);
+  for (size_t i = 0; i < num_points; ++i) {
+    cost_triplets.emplace_back(s_index(i), s_index(i), 2.0 * kQpDpDeviationWeight);
+    q[s_index(i)] = -2.0 * kQpDpDeviationWeight * dp_s[i];
+    cost_triplets.emplace_back(v_index(i), v_index(i), 2.0 * kQpSpeedWeight);
+    q[v_index(i)] = -2.0 * kQpSpeedWeight * cruise_speed;
+    cost_triplets.emplace_back(a_index(i), a_index(i), 2.0 * kQpAccWeight);
+  }
+  const double jerk_weight = 2.0 * kQpJerkWeight / (dt * dt);
+  for (size_t i = 0; i + 1 < num_points; ++i) {
+    cost_triplets.emplace_back(a_index(i), a_index(i), jerk_weight);
+    cost_triplets.emplace_back(a_index(i + 1), a_index(i + 1), jerk_weight);
+    cost_triplets.emplace_back(a_index(i), a_index(i + 1), -jerk_weight);
+    cost_triplets.emplace_back(a_index(i + 1), a_index(i), -jerk_weight);
+  }
+  SparseMatrix P(num_variables, num_variables);
+  P.setFromTriplets(cost_triplets.begin(), cost_triplets.end());
+
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(num_variables + 11 * (num_points - 1));
+  Eigen::VectorXd l(num_constraints);
+  Eigen::VectorXd u(num_constraints);
+  for (size_t i = 0; i < num_variables; ++i) {
+    triplets.emplace_back(i, i, 1.0);
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    const auto gap = GetFreeGap(intervals[i], dp_s[i]);
+    l[s_index(i)] = std::max(0.0, gap.first);
+    u[s_index(i)] = std::min(max_s, gap.second);
+    l[v_index(i)] = std::max(0.0, params_.min_lon_velocity);
+    u[v_index(i)] = params_.max_lon_velocity;
+    l[a_index(i)] = params_.min_lon_acc;
+    u[a_index(i)] = params_.max_lon_acc;
+  }
+  l[s_index(0)] = u[s_index(0)] = 0.0;
+  l[v_index(0)] = u[v_index(0)] = init_s[1];
+  l[a_index(0)] = u[a_index(0)] = init_s[2];
+  for (size_t i = 0; i + 1 < num_points; ++i) {
+    const size_t jerk_row = num_variables + i;
+    triplets.emplace_back(jerk_row, a_index(i + 1), 1.0);
+    triplets.emplace_back(jerk_row, a_index(i), -1.0);
+    l[jerk_row] = params_.min_lon_jerk * dt;
+    u[jerk_row] = params_.max_lon_jerk * dt;
+    const size_t v_row = num_variables + (num_points - 1) + i;
+    triplets.emplace_back(v_row, v_index(i + 1), 1.0);
+    triplets.emplace_back(v_row, v_index(i), -1.0);
+    triplets.emplace_back(v_row, a_index(i), -0.5 * dt);
+    triplets.emplace_back(v_row, a_index(i + 1), -0.5 * dt);
+    l[v_row] = u[v_row] = 0.0;
+    const size_t s_row = num_variables + 2 * (num_points - 1) + i;
+    triplets.emplace_back(s_row, s_index(i + 1), 1.0);
+    triplets.emplace_back(s_row, s_index(i), -1.0);
+    triplets.emplace_back(s_row, v_index(i), -dt);
+    triplets.emplace_back(s_row, a_index(i), -dt * dt / 3.0);
+    triplets.emplace_back(s_row, a_index(i + 1), -dt * dt / 6.0);
+    l[s_row] = u[s_row] = 0.0;
+  }
+  SparseMatrix A(num_constraints, num_variables);
+  A.setFromTriplets(triplets.begin(), triplets.end());
+
+  // warm started from the dp path at its mean speeds
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(num_variables);
+  for (size_t i = 0; i < num_points; ++i) {
+    x[s_index(i)] = dp_s[i];
+    x[v_index(i)] = i + 1 < num_points ? (dp_s[i + 1] - dp_s[i]) / dt : x[v_index(i - 1)];
+  }
+  common::AdmmQpSolver solver;
+  solver.SetWarmStart(x);
+  if (!solver.Solve(P, q, A, l, u)) {
+    return false;
+  }
+  x = solver.x();
+  profile->delta_t = dt;
+  profile->s.resize(num_points);
+  profile->v.resize(num_points);
+  profile->a.resize(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    profile->s[i] = x[s_index(i)];
+    profile->v[i] = x[v_index(i)];
+    profile->a[i] = x[a_index(i)];
+  }
+  return true;
+}
+
+}
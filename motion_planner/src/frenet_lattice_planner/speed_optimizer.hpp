@@ -0,0 +1,78 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_SPEED_OPTIMIZER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_SPEED_OPTIMIZER_HPP_
+#include <array>
+#include <utility>
+#include <vector>
+#include "lattice_trajectory1d.hpp"
+#include "planning_config.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the lon motion as one optimized speed profile instead of the sampled end conditions. a dynamic programming
+ * search on a coarse s-t grid finds the way through the st boundaries, the free gaps it passes at the time steps
+ * bound a piecewise jerk QP that smooths it. the run time only depends on the grids, not on the number of samples.
+ */
+class SpeedOptimizer {
+ public:
+  /**
+   * @brief: s, s_dot and s_ddot at the time steps i * delta_t, i = 0 ... num_time_steps
+   */
+  struct SpeedProfile {
+    double delta_t = 0.0;
+    std::vector<double> s;
+    std::vector<double> v;
+    std::vector<double> a;
+  };
+
+  explicit SpeedOptimizer(const PlanningParams &params);
+  ~SpeedOptimizer() = default;
+
+  /**
+   * @brief: optimize the speed profile
+   * @param init_s: s, s_dot, s_ddot
+   * @param blocking_intervals: the blocking s intervals of the st graph at the time steps i * delta_t,
+   * i = 0 ... num_time_steps. the intervals starting behind init_s are left to the collision checker
+   * @param cruise_speed: the speed the profile keeps where the road is free
+   * @param max_s: the largest s of the profile, in front of a stop point or the end of the reference line
+   * @param profile: [out]
+   * @return: false if no path passes the st boundaries or the QP does not converge
+   */
+  bool Optimize(const std::array<double, 3> &init_s,
+                const std::vector<std::vector<std::pair<double, double>>> &blocking_intervals,
+                double cruise_speed, double max_s, SpeedProfile *profile) const;
+
+ private:
+  /**
+   * @brief: the blocking intervals grown by the lon safety buffer and the ego extent, relative to init_s and merged
+   */
+  std::vector<std::vector<std::pair<double, double>>> InflateIntervals(
+      double init_s, const std::vector<std::vector<std::pair<double, double>>> &blocking_intervals) const;
+
+  /**
+   * @brief: the cheapest path through the coarse s-t grid, linearly interpolated on the time steps
+   * @param init_s: s, s_dot, s_ddot
+   * @param intervals: the inflated intervals relative to init_s
+   * @param dp_s: [out] s relative to init_s on the time steps
+   */
+  bool SearchDp(const std::array<double, 3> &init_s,
+                const std::vector<std::vector<std::pair<double, double>>> &intervals,
+                double cruise_speed, double max_s, std::vector<double> *dp_s) const;
+
+  /**
+   * @brief: smooth the dp path within the free gaps it passes
+   * @param init_s: s, s_dot, s_ddot
+   * @param dp_s: s relative to init_s on the time steps
+   * @param intervals: the inflated intervals relative to init_s
+   * @param profile: [out] s relative to init_s
+   */
+  bool SmoothQp(const std::array<double, 3> &init_s, const std::vector<double> &dp_s,
+                const std::vector<std::vector<std::pair<double, double>>> &intervals,
+                double cruise_speed, double max_s, SpeedProfile *profile) const;
+
+ private:
+  PlanningParams params_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_FRENET_LATTICE_PLANNER_SPEED_OPTIMIZER_HPP_
@@ -0,0 +1,45 @@
+#include "frenet_lattice_planner/trajectory_buffer.hpp"
+
+namespace planning {
+
+void TrajectoryBuffer::Clear(size_t capacity) {
+  poses_.clear();
+  kappas_.clear();
+  s_.clear();
+  vels_.clear();
+  accs_.clear();
+  relative_times_.clear();
+  poses_.reserve(capacity);
+  kappas_.reserve(capacity);
+  s_.reserve(capacity);
+  vels_.reserve(capacity);
+  accs_.reserve(capacity);
+  relative_times_.reserve(capacity);
+}
+
+void TrajectoryBuffer::Append(double x, double y, double theta, double kappa, double s, double vel, double acc,
+                              double relative_time) {
+  poses_.emplace_back(x, y, theta);
+  kappas_.push_back(kappa);
+  s_.push_back(s);
+  vels_.push_back(vel);
+  accs_.push_back(acc);
+  relative_times_.push_back(relative_time);
+}
+
+void TrajectoryBuffer::ToTrajectory(planning_msgs::Trajectory *trajectory) const {
+  trajectory->trajectory_points.clear();
+  trajectory->trajectory_points.resize(Size());
+  for (size_t i = 0; i < Size(); ++i) {
+    auto &tp = trajectory->trajectory_points[i];
+    tp.path_point.x = poses_[i].x();
+    tp.path_point.y = poses_[i].y();
+    tp.path_point.theta = poses_[i].z();
+    tp.path_point.kappa = kappas_[i];
+    tp.path_point.s = s_[i];
+    tp.vel = vels_[i];
+    tp.acc = accs_[i];
+    tp.relative_time = relative_times_[i];
+  }
+}
+}
@@ -0,0 +1,56 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_TRAJECTORY_BUFFER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_TRAJECTORY_BUFFER_HPP_
+#include <Eigen/Core>
+#include <vector>
+#include <planning_msgs/Trajectory.h>
+#include "math/coordinate_transformer.hpp"
+
+namespace planning {
+/**
+ * @brief: a combined candidate trajectory in plain arrays. the checkers read it directly and it keeps its capacity
+ * across the candidates, so only the accepted candidate is materialized as a message.
+ */
+class TrajectoryBuffer {
+ public:
+  TrajectoryBuffer() = default;
+  ~TrajectoryBuffer() = default;
+
+  /**
+   * @brief: drop the points, the capacity is kept
+   * @param capacity: reserved if the buffer holds less
+   */
+  void Clear(size_t capacity);
+
+  void Append(double x, double y, double theta, double kappa, double s, double vel, double acc,
+              double relative_time);
+
+  size_t Size() const { return poses_.size(); }
+  // x, y and heading of every point
+  const std::vector<Eigen::Vector3d> &Poses() const { return poses_; }
+  double Kappa(size_t index) const { return kappas_[index]; }
+  double Vel(size_t index) const { return vels_[index]; }
+  double Acc(size_t index) const { return accs_[index]; }
+  double RelativeTime(size_t index) const { return relative_times_[index]; }
+
+  /**
+   * @brief: the message of the points, the fields the buffer does not hold are zero
+   */
+  void ToTrajectory(planning_msgs::Trajectory *trajectory) const;
+
+  // the scratch of the batch conversion of the points, reused with the buffer
+  common::FrenetBatch *mutable_frenet_points() { return &frenet_points_; }
+  common::CartesianBatch *mutable_cartesian_points() { return &cartesian_points_; }
+
+ private:
+  common::FrenetBatch frenet_points_;
+  common::CartesianBatch cartesian_points_;
+  std::vector<Eigen::Vector3d> poses_;
+  std::vector<double> kappas_;
+  // accumulated along the points
+  std::vector<double> s_;
+  std::vector<double> vels_;
+  std::vector<double> accs_;
+  std::vector<double> relative_times_;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNING_INCLUDE_MOTION_PLANNER_FRENET_LATTICE_PLANNER_TRAJECTORY_BUFFER_HPP_
@@ -1,28 +1,82 @@
+#include <boost/make_shared.hpp>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <tf/transform_datatypes.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <planning_msgs/Behaviour.h>
 #include <planning_srvs/AgentRouteService.h>
 #include "motion_planner.hpp"
+#include "math/point_grid_index.hpp"
 #include "name/string_name.hpp"
 #include "planning_config.hpp"
+#include "profiler/trace_recorder.hpp"
 #include "reference_generator/reference_generator.hpp"
 
 namespace planning {
-MotionPlanner::MotionPlanner(const ros::NodeHandle &nh) : nh_(nh), thread_pool_size_(8) {
+MotionPlanner::MotionPlanner(const ros::NodeHandle &nh, ros::CallbackQueue *callback_queue,
+                             std::shared_ptr<common::ThreadPool> thread_pool)
+    : nh_(nh), callback_queue_(callback_queue != nullptr ? callback_queue : ros::getGlobalCallbackQueue()),
+      thread_pool_(std::move(thread_pool)) {
   PlanningConfig::Instance().UpdateParams(nh_);
-  this->thread_pool_ = std::make_unique<common::ThreadPool>(thread_pool_size_);
+  owns_thread_pool_ = thread_pool_ == nullptr;
+  if (owns_thread_pool_) {
+    thread_pool_size_ = static_cast<size_t>(std::max(1, PlanningConfig::Instance().planner_thread_pool_size()));
+    this->thread_pool_ = std::make_shared<common::ThreadPool>(
+        static_cast<int>(thread_pool_size_), PlanningConfig::Instance().planner_thread_options(),
+        PlanningConfig::Instance().executor_statistics_period() > 0);
+  }
+  thread_pool_size_ = static_cast<size_t>(thread_pool_->Size());
+  if (owns_thread_pool_ && !thread_pool_->ThreadOptionsApplied()) {
+    ROS_WARN("[MotionPlanner], failed to apply the thread options of the [%s] thread pool",
+             thread_pool_->Name().c_str());
+  }
   this->vehicle_state_ = std::make_unique<vehicle_state::VehicleState>();
+  if (PlanningConfig::Instance().stage_statistics_period() > 0) {
+    stage_profiler_ = std::make_unique<common::StageProfiler>();
+  }
+  if (!PlanningConfig::Instance().capture_directory().empty()) {
+    cycle_recorder_ = std::make_unique<PlanningCycleRecorder>(
+        PlanningConfig::Instance().capture_directory(),
+        static_cast<size_t>(std::max(1, PlanningConfig::Instance().capture_buffer_size())));
+  }
   if (PlanningConfig::Instance().planner_type() == "frenet_lattice") {
-    trajectory_planner_ = std::make_unique<FrenetLatticePlanner>(thread_pool_.get());
+    trajectory_planner_ = std::make_unique<FrenetLatticePlanner>(thread_pool_.get(), stage_profiler_.get());
   } else {
     ROS_FATAL("MotionPlanner, no such [%s] trajectory planner at now",
               PlanningConfig::Instance().planner_type().c_str());
     ROS_ASSERT(false);
   }
+  auto world_snapshot = std::make_shared<WorldSnapshot>();
+  world_snapshot->ego_vehicle_status = std::make_shared<const carla_msgs::CarlaEgoVehicleStatus>();
+  world_snapshot->ego_vehicle_info = std::make_shared<const carla_msgs::CarlaEgoVehicleInfo>();
+  world_snapshot->objects_map = std::make_shared<const std::unordered_map<int, derived_object_msgs::Object>>();
+  world_snapshot->traffic_light_status_list =
+      std::make_shared<const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus>>();
+  world_snapshot->traffic_lights_info_list =
+      std::make_shared<const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo>>();
+  world_snapshot->traffic_light_registry = std::make_shared<const TrafficLightRegistry>();
+  world_snapshot_ = std::move(world_snapshot);
   this->InitPublisher();
   this->InitSubscriber();
   this->InitServiceClient();
+  // a single thread, so the snapshot updates of the callbacks never race each other
+  world_spinner_ = std::make_unique<ros::AsyncSpinner>(1, &world_callback_queue_);
+  world_spinner_->start();
+  if (PlanningConfig::Instance().visualization_rate() > 0.0) {
+    is_visualizing_ = true;
+    visualization_thread_ = std::thread(&MotionPlanner::RunVisualization, this);
+  }
+  double lookahead_length = 300.0;
+  double lookback_length = 30.0;
+  reference_generator_ = std::make_unique<ReferenceGenerator>(GetReferenceLineConfig(), lookahead_length,
+                                                              lookback_length);
+  reference_generator_->Start();
+  is_requesting_routes_ = true;
+  route_thread_ = std::thread(&MotionPlanner::RunRouteRequests, this);
+}
+//
+
+ReferenceLineConfig MotionPlanner::GetReferenceLineConfig() {
   ReferenceLineConfig reference_line_config;
   reference_line_config.reference_smooth_deviation_weight_ =
       PlanningConfig::Instance().reference_smoother_deviation_weight();
@@ -33,39 +87,95 @@ MotionPlanner::MotionPlanner(const ros::NodeHandle &nh) : nh_(nh), thread_pool_s
   reference_line_config.reference_smooth_max_curvature_ =
       PlanningConfig::Instance().reference_smoother_max_curvature();
   reference_line_config.reference_smooth_slack_weight_ = PlanningConfig::Instance().reference_smoother_slack_weight();
-  double lookahead_length = 300.0;
-  double lookback_length = 30.0;
-  reference_generator_ = std::make_unique<ReferenceGenerator>(reference_line_config, lookahead_length, lookback_length);
-  reference_generator_->Start();
+  reference_line_config.reference_point_table_resolution_ =
+      PlanningConfig::Instance().reference_point_table_resolution();
+  reference_line_config.reference_smooth_incremental_ = PlanningConfig::Instance().reference_smoother_incremental();
+  reference_line_config.reference_smooth_blend_points_ = PlanningConfig::Instance().reference_smoother_blend_points();
+  reference_line_config.reference_smooth_backend_ = PlanningConfig::Instance().reference_smoother_backend() == "qp"
+                                                    ? ReferenceLineSmoother::Backend::QP
+                                                    : ReferenceLineSmoother::Backend::IPOPT;
+  reference_line_config.reference_smooth_cached_tape_ = PlanningConfig::Instance().reference_smoother_cached_tape();
+  reference_line_config.reference_smooth_segment_cache_size_ =
+      std::max(0, PlanningConfig::Instance().reference_smoother_segment_cache_size());
+  reference_line_config.reference_smooth_decimation_ = PlanningConfig::Instance().reference_smoother_decimation();
+  reference_line_config.reference_smooth_decimation_min_spacing_ =
+      PlanningConfig::Instance().reference_smoother_decimation_min_spacing();
+  reference_line_config.reference_smooth_decimation_max_spacing_ =
+      PlanningConfig::Instance().reference_smoother_decimation_max_spacing();
+  reference_line_config.reference_smooth_decimation_max_deviation_ =
+      PlanningConfig::Instance().reference_smoother_decimation_max_deviation();
+  reference_line_config.reference_smooth_thread_pool_size_ =
+      PlanningConfig::Instance().reference_smoother_thread_pool_size();
+  reference_line_config.reference_smooth_timeout_ = PlanningConfig::Instance().reference_smoother_timeout();
+  reference_line_config.reference_line_slide_ = PlanningConfig::Instance().reference_line_slide();
+  return reference_line_config;
 }
-//
-
 
 void MotionPlanner::Launch() {
 
   ros::Rate loop_rate(PlanningConfig::Instance().loop_rate());
-  while (ros::ok()) {
-    auto begin = ros::Time::now();
-    ros::spinOnce();
-    this->RunOnce();
-    auto end = ros::Time::now();
-    ROS_INFO("[MotionPlanner::Launch], the RunOnce Elapsed Time: %lf s", (end - begin).toSec());
-    loop_rate.sleep();
+  const int statistics_period = PlanningConfig::Instance().executor_statistics_period();
+  const int stage_statistics_period = PlanningConfig::Instance().stage_statistics_period();
+  const bool lock_step = PlanningConfig::Instance().lock_step();
+  common::LockStepClock lock_step_clock(PlanningConfig::Instance().lock_step_timeout());
+  int num_cycles = 0;
+  while (ros::ok() && is_running_) {
+    if (lock_step) {
+      PLANNING_TRACE_ZONE("lock_step_wait");
+      if (!lock_step_clock.WaitForNextTick(is_running_)) {
+        break;
+      }
+      // the bridge publishes the objects of a tick after its clock
+      if (!lock_step_clock.WaitFor(is_running_, [this, &lock_step_clock]() {
+        return std::atomic_load(&world_snapshot_)->objects_stamp >= lock_step_clock.tick();
+      })) {
+        ROS_WARN("[MotionPlanner::Launch], no objects of the tick at %lf s, planning on the last ones",
+                 lock_step_clock.tick().toSec());
+      }
+    }
+    // only the goal pose, the world messages are spun by world_spinner_
+    callback_queue_->callAvailable();
+    {
+      common::ScopedStageTimer cycle_timer(stage_profiler_.get(), "cycle");
+      this->RunOnce();
+    }
+    ++num_cycles;
+    if (stage_statistics_period > 0 && num_cycles % stage_statistics_period == 0) {
+      PublishStageStatistics();
+    }
+    if (owns_thread_pool_ && statistics_period > 0 && num_cycles % statistics_period == 0) {
+      const auto statistics = thread_pool_->GetStatistics();
+      ROS_INFO("[MotionPlanner::Launch], [%s] thread pool, tasks: %lu, queue depth: %d, max queue depth: %d, "
+               "mean latency: %lf s, max latency: %lf s", thread_pool_->Name().c_str(),
+               static_cast<unsigned long>(statistics.num_tasks), statistics.queue_depth, statistics.max_queue_depth,
+               statistics.mean_latency, statistics.max_latency);
+      thread_pool_->ResetStatistics();
+    }
+    if (!lock_step) {
+      PLANNING_TRACE_ZONE("loop_rate_sleep");
+      loop_rate.sleep();
+    }
   }
 }
 
 std::vector<PlanningTarget> MotionPlanner::GetPlanningTargets(const std::vector<ReferenceLine> &ref_lines,
                                                               const planning_msgs::TrajectoryPoint &init_point) {
+  return GetPlanningTargets(std::make_shared<const std::vector<ReferenceLine>>(ref_lines), init_point);
+}
+
+std::vector<PlanningTarget> MotionPlanner::GetPlanningTargets(
+    const std::shared_ptr<const std::vector<ReferenceLine>> &ref_lines,
+    const planning_msgs::TrajectoryPoint &init_point) {
   std::vector<PlanningTarget> targets;
-  targets.reserve(ref_lines.size());
+  targets.reserve(ref_lines->size());
   constexpr double kDefaultLaneWidth = 4.0;
-  for (const auto &ref_line : ref_lines) {
+  for (const auto &ref_line : *ref_lines) {
     common::SLPoint sl_point;
     if (!ref_line.XYToSL(init_point.path_point.x, init_point.path_point.y, &sl_point)) {
       continue;
     }
     PlanningTarget target;
-    target.ref_lane = ref_line;
+    target.ref_lane = std::shared_ptr<const ReferenceLine>(ref_lines, &ref_line);
     target.has_stop_point = ref_line.Length() < sl_point.s + 50.0;
     target.stop_s = target.has_stop_point ? ref_line.Length() : std::numeric_limits<double>::max();
 
@@ -81,79 +191,353 @@ std::vector<PlanningTarget> MotionPlanner::GetPlanningTargets(const std::vector<
 
 void MotionPlanner::RunOnce() {
   ros::Time current_time_stamp = ros::Time::now();
+  // on the steady clock, the sim time may stand still or jump
+  const auto cycle_begin = std::chrono::steady_clock::now();
+  const double planning_cycle_time = 1.0 / static_cast<double>(PlanningConfig::Instance().loop_rate());
+  // the messages arriving during the cycle go to the next snapshot
+  const auto world = std::atomic_load(&world_snapshot_);
+  ego_vehicle_id_ = world->ego_vehicle_id;
   if (ego_vehicle_id_ == -1) {
     return;
   }
-  if (objects_map_.find(ego_vehicle_id_) == objects_map_.end()) {
+  const auto ego_object = world->objects_map->find(ego_vehicle_id_);
+  if (ego_object == world->objects_map->end()) {
     ROS_FATAL("[MotionPlanner::RunOnce], no ego vehicle");
     return;
   }
-  ego_object_ = objects_map_[ego_vehicle_id_];
-  vehicle_state_->Update(ego_vehicle_status_, ego_vehicle_info_, ego_object_);
-  VisualizeEgoVehicle();
-  PlanningConfig::Instance().set_vehicle_params(vehicle_state_->vehicle_params());
+  ego_object_ = ego_object->second;
+  vehicle_state_->Update(*world->ego_vehicle_status, *world->ego_vehicle_info, ego_object_);
+  trajectory_planner_->set_vehicle_params(vehicle_state_->vehicle_params());
+  auto visualization = std::make_shared<VisualizationSnapshot>();
+  visualization->world = world;
+  visualization->ego_object = ego_object_;
+  visualization->ego_length = vehicle_state_->vehicle_params().length;
+  visualization->ego_width = vehicle_state_->vehicle_params().width;
+  common::ScopedStageTimer stitching_timer(stage_profiler_.get(), "stitching");
+  bool is_stitched = false;
   auto stitching_trajectory =
       this->GetStitchingTrajectory(current_time_stamp,
-                                   1.0 / static_cast<double>(PlanningConfig::Instance().loop_rate()),
-                                   PlanningConfig::Instance().preserve_history_trajectory_point_num());
+                                   planning_cycle_time,
+                                   PlanningConfig::Instance().preserve_history_trajectory_point_num(),
+                                   &is_stitched);
+  stitching_timer.Stop();
   auto init_trajectory_point = stitching_trajectory.back();
   reference_generator_->UpdateVehicleState(vehicle_state_->GetKinoDynamicVehicleState());
+  PrefetchRoute();
   planning_msgs::Trajectory optimal_trajectory;
-  std::vector<ReferenceLine> ref_lines;
-  if (!reference_generator_->GetReferenceLines(&ref_lines)) {
+  // shared with the generate thread, which publishes the rebuilt reference lines as a new vector
+  const auto ptr_ref_lines = reference_generator_->GetLatestReferenceLines();
+  if (ptr_ref_lines == nullptr) {
     GenerateEmergencyStopTrajectory(init_trajectory_point, optimal_trajectory);
     has_history_trajectory_ = false;
     optimal_trajectory.header.stamp = current_time_stamp;
     optimal_trajectory.status = planning_msgs::Trajectory::EMERGENCYSTOP;
-    trajectory_publisher_.publish(optimal_trajectory);
+    PublishTrajectory(boost::make_shared<const planning_msgs::Trajectory>(std::move(optimal_trajectory)));
+    ShareVisualization(std::move(visualization));
+    CaptureCycle(cycle_begin, current_time_stamp, true, *world, init_trajectory_point, {}, {});
     return;
   }
+  visualization->ref_lines = ptr_ref_lines;
 
-  VisualizeReferenceLine(ref_lines);
-
-  std::vector<PlanningTarget> planning_targets = GetPlanningTargets(ref_lines, init_trajectory_point);
+  common::ScopedStageTimer targets_timer(stage_profiler_.get(), "planning_targets");
+  std::vector<PlanningTarget> planning_targets = GetPlanningTargets(ptr_ref_lines, init_trajectory_point);
+  targets_timer.Stop();
 
+  common::ScopedStageTimer obstacles_timer(stage_profiler_.get(), "key_obstacles");
   std::vector<std::shared_ptr<Obstacle>> obstacles = GetKeyObstacle(
-      objects_map_,
-      traffic_light_status_list_,
-      traffic_lights_info_list_,
+      *world->objects_map,
+      *world->traffic_light_status_list,
+      *world->traffic_light_registry,
       init_trajectory_point,
-      ego_vehicle_id_, planning_targets);
+      ego_vehicle_id_, planning_targets, thread_pool_.get());
+  obstacles_timer.Stop();
+  visualization->obstacles = obstacles;
 
-  VisualizeObstacleTrajectory(obstacles);
+  if (CanKeepHistoryTrajectory(current_time_stamp, is_stitched, planning_targets, obstacles)) {
+    // nothing the last trajectory was planned for has changed, keep following it
+    PublishTrajectory(history_trajectory_);
+    visualization->optimal_trajectory = history_trajectory_;
+    ShareVisualization(std::move(visualization));
+    CaptureCycle(cycle_begin, current_time_stamp, false, *world, init_trajectory_point, planning_targets, obstacles);
+    return;
+  }
 
-  if (!trajectory_planner_->Process(obstacles, init_trajectory_point,
-                                    planning_targets,
-                                    optimal_trajectory,
-                                    nullptr)) {
+  const double deadline_ratio = PlanningConfig::Instance().planning_deadline_ratio();
+  trajectory_planner_->set_deadline(
+      deadline_ratio > 0.0 ? cycle_begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(deadline_ratio * planning_cycle_time))
+                           : std::chrono::steady_clock::time_point::max());
+  common::ScopedStageTimer planner_timer(stage_profiler_.get(), "planner");
+  const bool is_planned = trajectory_planner_->Process(obstacles, init_trajectory_point,
+                                                       planning_targets,
+                                                       optimal_trajectory,
+                                                       nullptr);
+  planner_timer.Stop();
+  if (trajectory_planner_->is_deadline_missed()) {
+    ++num_deadline_misses_;
+    ROS_WARN("[MotionPlanner::RunOnce], the planner missed its deadline, %lu misses so far",
+             static_cast<unsigned long>(num_deadline_misses_));
+  }
+  if (!is_planned && trajectory_planner_->is_deadline_missed()
+      && CanReuseHistoryTrajectory(current_time_stamp, planning_cycle_time)) {
+    // an overrun is no reason to stop, keep following the last trajectory
+    PublishTrajectory(history_trajectory_);
+    visualization->optimal_trajectory = history_trajectory_;
+    ShareVisualization(std::move(visualization));
+    CaptureCycle(cycle_begin, current_time_stamp, false, *world, init_trajectory_point, planning_targets, obstacles);
+    return;
+  }
+  if (!is_planned) {
     GenerateEmergencyStopTrajectory(init_trajectory_point, optimal_trajectory);
     has_history_trajectory_ = false;
     optimal_trajectory.header.stamp = current_time_stamp;
     optimal_trajectory.status = planning_msgs::Trajectory::EMERGENCYSTOP;
-    trajectory_publisher_.publish(optimal_trajectory);
+    PublishTrajectory(boost::make_shared<const planning_msgs::Trajectory>(std::move(optimal_trajectory)));
+    ShareVisualization(std::move(visualization));
+    CaptureCycle(cycle_begin, current_time_stamp, true, *world, init_trajectory_point, planning_targets, obstacles);
     return;
   }
 
   // because the first point of original optimal_trajectory is init_trajectory_point: the back of stitching_trajectory;
-  optimal_trajectory.trajectory_points.insert(optimal_trajectory.trajectory_points.begin(),
-                                              stitching_trajectory.begin(),
-                                              stitching_trajectory.end() - 1);
+  // the points are assembled once in a buffer of the final size instead of shifted by an insert at the front
+  std::vector<planning_msgs::TrajectoryPoint> trajectory_points;
+  trajectory_points.reserve(stitching_trajectory.size() - 1 + optimal_trajectory.trajectory_points.size());
+  trajectory_points.insert(trajectory_points.end(),
+                           std::make_move_iterator(stitching_trajectory.begin()),
+                           std::make_move_iterator(stitching_trajectory.end() - 1));
+  trajectory_points.insert(trajectory_points.end(),
+                           std::make_move_iterator(optimal_trajectory.trajectory_points.begin()),
+                           std::make_move_iterator(optimal_trajectory.trajectory_points.end()));
+  optimal_trajectory.trajectory_points = std::move(trajectory_points);
   if (optimal_trajectory.trajectory_points.empty()) {
     optimal_trajectory.status = planning_msgs::Trajectory::EMPTY;
   } else {
     optimal_trajectory.status = planning_msgs::Trajectory::NORMAL;
   }
   optimal_trajectory.header.stamp = current_time_stamp;
-  history_trajectory_ = optimal_trajectory;
+  common::ScopedStageTimer publishing_timer(stage_profiler_.get(), "publishing");
+  // published as a shared pointer, the subscribers in the same process get it without serialization
+  history_trajectory_ = boost::make_shared<const planning_msgs::Trajectory>(std::move(optimal_trajectory));
+  history_time_step_ = GetUniformTimeStep(history_trajectory_->trajectory_points);
   has_history_trajectory_ = true;
-  trajectory_publisher_.publish(optimal_trajectory);
-  // for visualization
-  VisualizeOptimalTrajectory(optimal_trajectory);
+  last_replan_stamp_ = current_time_stamp;
+  last_replan_targets_ = planning_targets;
+  PublishTrajectory(history_trajectory_);
+  publishing_timer.Stop();
+  visualization->optimal_trajectory = history_trajectory_;
+  ShareVisualization(std::move(visualization));
+  CaptureCycle(cycle_begin, current_time_stamp, false, *world, init_trajectory_point, planning_targets, obstacles);
+}
+
+void MotionPlanner::CaptureCycle(const std::chrono::steady_clock::time_point &cycle_begin,
+                                 const ros::Time &current_time_stamp,
+                                 bool is_emergency_stop,
+                                 const WorldSnapshot &world,
+                                 const planning_msgs::TrajectoryPoint &init_trajectory_point,
+                                 const std::vector<PlanningTarget> &planning_targets,
+                                 const std::vector<std::shared_ptr<Obstacle>> &obstacles) {
+  if (cycle_recorder_ == nullptr) {
+    return;
+  }
+  const double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - cycle_begin).count();
+  const double latency_threshold = PlanningConfig::Instance().capture_latency_threshold();
+  uint8_t trigger = 0;
+  if (latency_threshold > 0.0 && latency > latency_threshold) {
+    trigger |= PlanningCycleCapture::kSlowCycle;
+  }
+  if (is_emergency_stop && PlanningConfig::Instance().capture_emergency_stop()) {
+    trigger |= PlanningCycleCapture::kEmergencyStop;
+  }
+  if (trigger == 0) {
+    return;
+  }
+  // the targets, obstacles and world are shared, the recorder thread serializes them
+  auto capture = std::make_shared<PlanningCycleCapture>();
+  capture->stamp = current_time_stamp;
+  capture->latency = latency;
+  capture->trigger = trigger;
+  capture->vehicle_params = vehicle_state_->vehicle_params();
+  capture->init_trajectory_point = init_trajectory_point;
+  capture->planning_targets = planning_targets;
+  capture->obstacles = obstacles;
+  capture->objects = world.objects_map;
+  capture->traffic_light_status_list = world.traffic_light_status_list;
+  capture->traffic_lights_info_list = world.traffic_lights_info_list;
+  if (!cycle_recorder_->Push(std::move(capture))) {
+    ROS_WARN("[MotionPlanner::CaptureCycle], the capture buffer is full, %lu captures dropped so far",
+             static_cast<unsigned long>(cycle_recorder_->num_dropped()));
+  }
+}
+
+bool MotionPlanner::CanReuseHistoryTrajectory(const ros::Time &current_time_stamp,
+                                              double planning_cycle_time) const {
+  if (!has_history_trajectory_ || history_trajectory_ == nullptr || history_trajectory_->trajectory_points.empty()) {
+    return false;
+  }
+  const double relative_time = (current_time_stamp - history_trajectory_->header.stamp).toSec();
+  return relative_time + planning_cycle_time < history_trajectory_->trajectory_points.back().relative_time;
+}
+
+bool MotionPlanner::CanKeepHistoryTrajectory(const ros::Time &current_time_stamp,
+                                             bool is_stitched,
+                                             const std::vector<PlanningTarget> &planning_targets,
+                                             const std::vector<std::shared_ptr<Obstacle>> &obstacles) {
+  if (!PlanningConfig::Instance().plan_reuse() || !is_stitched || !has_history_trajectory_
+      || history_trajectory_ == nullptr || history_trajectory_->trajectory_points.empty()) {
+    return false;
+  }
+  if ((current_time_stamp - last_replan_stamp_).toSec() >= PlanningConfig::Instance().plan_reuse_max_interval()) {
+    return false;
+  }
+  if (!IsSameBehaviour(planning_targets, last_replan_targets_)) {
+    return false;
+  }
+  const auto &history_points = history_trajectory_->trajectory_points;
+  const double relative_time = (current_time_stamp - history_trajectory_->header.stamp).toSec();
+  if (history_points.back().relative_time - relative_time < PlanningConfig::Instance().plan_reuse_min_horizon()) {
+    return false;
+  }
+  // the remainder from now on, in the time and s of the current cycle as the planned candidates
+  const size_t matched_index = GetTimeMatchIndex(relative_time, 1.0e-5, history_points, history_time_step_);
+  planning_msgs::Trajectory remainder;
+  remainder.trajectory_points.assign(history_points.begin() + matched_index, history_points.end());
+  const double zero_s = remainder.trajectory_points.front().path_point.s;
+  for (auto &tp : remainder.trajectory_points) {
+    tp.relative_time -= relative_time;
+    tp.path_point.s -= zero_s;
+  }
+  common::ScopedStageTimer revalidation_timer(stage_profiler_.get(), "plan_reuse");
+  return trajectory_planner_->IsTrajectoryValid(obstacles, remainder);
+}
+
+bool MotionPlanner::IsSameBehaviour(const std::vector<PlanningTarget> &targets,
+                                    const std::vector<PlanningTarget> &other) {
+  constexpr double kVelocityEpsilon = 0.1;
+  constexpr double kStopPointEpsilon = 0.5;
+  if (targets.size() != other.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (targets[i].is_best_behaviour != other[i].is_best_behaviour
+        || targets[i].has_stop_point != other[i].has_stop_point
+        || std::fabs(targets[i].desired_vel - other[i].desired_vel) > kVelocityEpsilon) {
+      return false;
+    }
+    // the reference lines of every cycle start behind the ego, so the same stop point has another stop_s on them
+    if (targets[i].has_stop_point
+        && (targets[i].ref_lane->GetReferencePoint(targets[i].stop_s).xy()
+            - other[i].ref_lane->GetReferencePoint(other[i].stop_s).xy()).norm() > kStopPointEpsilon) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MotionPlanner::PublishTrajectory(const planning_msgs::Trajectory::ConstPtr &trajectory) {
+  trajectory_publisher_.publish(trajectory);
+  if (compact_trajectory_encoder_ == nullptr || compact_trajectory_publisher_.getNumSubscribers() == 0) {
+    return;
+  }
+  // a subscriber joining late decodes from the next keyframe on
+  auto compact = boost::make_shared<common::CompactTrajectory>();
+  compact_trajectory_encoder_->Encode(trajectory, compact.get());
+  compact_trajectory_publisher_.publish(compact);
+}
+
+void MotionPlanner::PublishStageStatistics() {
+  if (stage_profiler_ == nullptr) {
+    return;
+  }
+  const auto statistics = stage_profiler_->GetStatistics();
+  stage_profiler_->Reset();
+  if (stage_diagnostics_publisher_.getNumSubscribers() == 0) {
+    return;
+  }
+  const auto milliseconds = [](double seconds) { return std::to_string(seconds * 1e3); };
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
+  diagnostics.status.reserve(statistics.size());
+  for (const auto &stage : statistics) {
+    diagnostic_msgs::DiagnosticStatus status;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = "motion_planner/" + stage.name;
+    status.message = "latency in ms";
+    diagnostic_msgs::KeyValue value;
+    value.key = "count";
+    value.value = std::to_string(stage.count);
+    status.values.push_back(value);
+    value.key = "p50";
+    value.value = milliseconds(stage.p50);
+    status.values.push_back(value);
+    value.key = "p99";
+    value.value = milliseconds(stage.p99);
+    status.values.push_back(value);
+    value.key = "max";
+    value.value = milliseconds(stage.max);
+    status.values.push_back(value);
+    value.key = "mean";
+    value.value = milliseconds(stage.mean);
+    status.values.push_back(value);
+    diagnostics.status.push_back(std::move(status));
+  }
+  diagnostic_msgs::DiagnosticStatus deadline_status;
+  deadline_status.level = num_deadline_misses_ == 0 ? diagnostic_msgs::DiagnosticStatus::OK
+                                                     : diagnostic_msgs::DiagnosticStatus::WARN;
+  deadline_status.name = "motion_planner/deadline";
+  deadline_status.message = "planning deadline misses since the start";
+  diagnostic_msgs::KeyValue misses;
+  misses.key = "misses";
+  misses.value = std::to_string(num_deadline_misses_);
+  deadline_status.values.push_back(misses);
+  diagnostics.status.push_back(std::move(deadline_status));
+  stage_diagnostics_publisher_.publish(diagnostics);
+}
+
+void MotionPlanner::ShareVisualization(std::shared_ptr<const VisualizationSnapshot> snapshot) {
+  if (visualization_thread_.joinable()) {
+    std::atomic_store(&visualization_snapshot_, std::move(snapshot));
+  }
+}
+
+void MotionPlanner::RunVisualization() {
+  const auto period = std::chrono::duration<double>(1.0 / PlanningConfig::Instance().visualization_rate());
+  std::shared_ptr<const VisualizationSnapshot> last_snapshot;
+  // the reference lines have no lifetime, they are only sent again when rebuilt or to a new subscriber
+  std::shared_ptr<const std::vector<ReferenceLine>> last_ref_lines;
+  uint32_t last_num_ref_line_subscribers = 0;
+  std::unique_lock<std::mutex> lock(visualization_mutex_);
+  while (is_visualizing_) {
+    lock.unlock();
+    const auto snapshot = std::atomic_load(&visualization_snapshot_);
+    if (snapshot != nullptr && snapshot != last_snapshot) {
+      VisualizeEgoVehicle(*snapshot);
+      VisualizeObstacleTrajectory(snapshot->obstacles, *snapshot->world);
+      if (snapshot->optimal_trajectory != nullptr) {
+        VisualizeOptimalTrajectory(*snapshot->optimal_trajectory);
+      }
+      last_snapshot = snapshot;
+    }
+    const uint32_t num_ref_line_subscribers = visualized_reference_lines_publisher_.getNumSubscribers();
+    if (snapshot != nullptr && snapshot->ref_lines != nullptr && num_ref_line_subscribers > 0
+        && (snapshot->ref_lines != last_ref_lines || num_ref_line_subscribers > last_num_ref_line_subscribers)) {
+      VisualizeReferenceLine(*snapshot->ref_lines);
+      last_ref_lines = snapshot->ref_lines;
+    }
+    last_num_ref_line_subscribers = num_ref_line_subscribers;
+    lock.lock();
+    visualization_cv_.wait_for(lock, period, [this] { return !is_visualizing_; });
+  }
 }
 
 void MotionPlanner::InitPublisher() {
   this->trajectory_publisher_ = nh_.advertise<planning_msgs::Trajectory>(
       common::topic::kPublishedTrajectoryName, 1);
+  if (PlanningConfig::Instance().publish_compact_trajectory()) {
+    this->compact_trajectory_publisher_ = nh_.advertise<common::CompactTrajectory>(
+        common::topic::kPublishedCompactTrajectoryName, 1);
+    this->compact_trajectory_encoder_ = std::make_unique<common::CompactTrajectoryEncoder>(
+        static_cast<uint32_t>(std::max(0, PlanningConfig::Instance().compact_trajectory_keyframe_interval())));
+  }
   this->visualized_trajectory_publisher_ = nh_.advertise<visualization_msgs::Marker>(
       common::topic::kVisualizedTrajectoryName, 1);
   this->visualized_valid_trajectories_publisher_ = nh_.advertise<visualization_msgs::MarkerArray>(
@@ -168,46 +552,70 @@ void MotionPlanner::InitPublisher() {
       common::topic::kVisualizedObstacleInfoName, 1);
   this->visualized_ego_vehicle_publisher_ =
       nh_.advertise<visualization_msgs::Marker>(common::topic::kEgoVehicleVisualizedName, 1);
+  this->stage_diagnostics_publisher_ =
+      nh_.advertise<diagnostic_msgs::DiagnosticArray>(common::topic::kPlanningStageDiagnosticsName, 1);
+  this->route_publisher_ = nh_.advertise<planning_msgs::Lane>(common::topic::kPlanningRouteName, 1, true);
 }
 
 void MotionPlanner::InitSubscriber() {
-
-  this->ego_vehicle_subscriber_ = nh_.subscribe<carla_msgs::CarlaEgoVehicleStatus>(
+  ros::NodeHandle world_nh(nh_);
+  world_nh.setCallbackQueue(&world_callback_queue_);
+  this->ego_vehicle_subscriber_ = world_nh.subscribe<carla_msgs::CarlaEgoVehicleStatus>(
       common::topic::kEgoVehicleStatusName, 5,
       [this](const carla_msgs::CarlaEgoVehicleStatus::ConstPtr &ego_vehicle_status) {
-        this->ego_vehicle_status_ = *ego_vehicle_status;
+        auto status = std::make_shared<const carla_msgs::CarlaEgoVehicleStatus>(*ego_vehicle_status);
+        UpdateWorldSnapshot([&status](WorldSnapshot *world) { world->ego_vehicle_status = std::move(status); });
       });
-  this->traffic_lights_subscriber_ = nh_.subscribe<carla_msgs::CarlaTrafficLightStatusList>(
+  this->traffic_lights_subscriber_ = world_nh.subscribe<carla_msgs::CarlaTrafficLightStatusList>(
       common::topic::kTrafficLigthsStatusName, 5,
       [this](const carla_msgs::CarlaTrafficLightStatusList::ConstPtr &traffic_light_status_list) {
-        traffic_light_status_list_ = decltype(traffic_light_status_list_)();
+        auto status_list = std::make_shared<std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus>>();
+        status_list->reserve(traffic_light_status_list->traffic_lights.size());
         for (const auto &traffic_light_status : traffic_light_status_list->traffic_lights) {
-          traffic_light_status_list_.emplace(traffic_light_status.id, traffic_light_status);
+          status_list->emplace(traffic_light_status.id, traffic_light_status);
         }
+        UpdateWorldSnapshot([&status_list](WorldSnapshot *world) {
+          world->traffic_light_status_list = std::move(status_list);
+        });
       });
-  this->traffic_lights_info_subscriber_ = nh_.subscribe<carla_msgs::CarlaTrafficLightInfoList>(
+  this->traffic_lights_info_subscriber_ = world_nh.subscribe<carla_msgs::CarlaTrafficLightInfoList>(
       common::topic::kTrafficLightsInfoName, 5,
       [this](const carla_msgs::CarlaTrafficLightInfoList::ConstPtr &traffic_lights_info_list) {
-        traffic_lights_info_list_ = decltype(traffic_lights_info_list_)();
+        auto info_list = std::make_shared<std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo>>();
+        info_list->reserve(traffic_lights_info_list->traffic_lights.size());
         for (const auto &traffic_light_info : traffic_lights_info_list->traffic_lights) {
-          traffic_lights_info_list_.emplace(traffic_light_info.id, traffic_light_info);
+          info_list->emplace(traffic_light_info.id, traffic_light_info);
         }
+        auto registry = std::make_shared<const TrafficLightRegistry>(*info_list);
+        UpdateWorldSnapshot([&info_list, &registry](WorldSnapshot *world) {
+          world->traffic_lights_info_list = std::move(info_list);
+          world->traffic_light_registry = std::move(registry);
+        });
       });
-  this->ego_vehicle_info_subscriber_ = nh_.subscribe<carla_msgs::CarlaEgoVehicleInfo>(
+  this->ego_vehicle_info_subscriber_ = world_nh.subscribe<carla_msgs::CarlaEgoVehicleInfo>(
       common::topic::kEgoVehicleInfoName, 5,
       [this](const carla_msgs::CarlaEgoVehicleInfo::ConstPtr &ego_vehicle_info) {
-        ego_vehicle_info_ = *ego_vehicle_info;
-        this->ego_vehicle_id_ = ego_vehicle_info_.id;
-        ROS_INFO("the ego_vehicle_id_: %i", ego_vehicle_id_);
+        auto info = std::make_shared<const carla_msgs::CarlaEgoVehicleInfo>(*ego_vehicle_info);
+        ROS_INFO("the ego_vehicle_id_: %i", info->id);
+        UpdateWorldSnapshot([&info](WorldSnapshot *world) {
+          world->ego_vehicle_id = info->id;
+          world->ego_vehicle_info = std::move(info);
+        });
       });
-  this->objects_subscriber_ = nh_.subscribe<derived_object_msgs::ObjectArray>(
+  this->objects_subscriber_ = world_nh.subscribe<derived_object_msgs::ObjectArray>(
       common::topic::kObjectsName, 5,
       [this](const derived_object_msgs::ObjectArray::ConstPtr &object_array) {
-        this->objects_map_.clear();
+        auto objects_map = std::make_shared<std::unordered_map<int, derived_object_msgs::Object>>();
+        objects_map->reserve(object_array->objects.size());
         for (const auto &object : object_array->objects) {
-          objects_map_.emplace(object.id, object);
+          objects_map->emplace(object.id, object);
         }
-        ROS_INFO("the objects map_ size is: %lu", objects_map_.size());
+        ROS_INFO("the objects map_ size is: %lu", objects_map->size());
+        const ros::Time objects_stamp = object_array->header.stamp;
+        UpdateWorldSnapshot([&objects_map, &objects_stamp](WorldSnapshot *world) {
+          world->objects_map = std::move(objects_map);
+          world->objects_stamp = objects_stamp;
+        });
       });
 
   this->goal_pose_subscriber_ = nh_.subscribe<geometry_msgs::PoseStamped>(
@@ -217,12 +625,17 @@ void MotionPlanner::InitSubscriber() {
         if (ego_vehicle_id_ == -1) {
           return;
         }
-        if (!ReRoute()) {
-          return;
-        }
+        ReRoute();
       });
 }
 
+void MotionPlanner::UpdateWorldSnapshot(const std::function<void(WorldSnapshot *)> &update) {
+  // the callback thread is the only writer, the copy only shares the pointers of the parts
+  auto world = std::make_shared<WorldSnapshot>(*std::atomic_load(&world_snapshot_));
+  update(world.get());
+  std::atomic_store(&world_snapshot_, std::shared_ptr<const WorldSnapshot>(std::move(world)));
+}
+
 void MotionPlanner::InitServiceClient() {
   this->get_waypoint_client_ = nh_.serviceClient<carla_waypoint_types::GetWaypoint>(
       common::service::kGetEgoWaypontServiceName);
@@ -235,7 +648,12 @@ void MotionPlanner::InitServiceClient() {
   ROS_DEBUG("MotionPlanner::InitServiceClient finished");
 }
 
-void MotionPlanner::VisualizeObstacleTrajectory(const std::vector<std::shared_ptr<Obstacle>> &obstacles) {
+void MotionPlanner::VisualizeObstacleTrajectory(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                                const WorldSnapshot &world) const {
+  if (visualized_obstacle_trajectory_publisher_.getNumSubscribers() == 0
+      && visualized_obstacle_info_publisher_.getNumSubscribers() == 0) {
+    return;
+  }
   visualization_msgs::MarkerArray obstacle_trajectory_mark_array;
   visualization_msgs::MarkerArray obstacle_info_mark_array;
 
@@ -252,16 +670,19 @@ void MotionPlanner::VisualizeObstacleTrajectory(const std::vector<std::shared_pt
     info_marker.pose.orientation = tf::createQuaternionMsgFromYaw(obstacle->GetBoundingBox().heading());
     info_marker.pose.position.x = obstacle->x();
     info_marker.pose.position.y = obstacle->y();
-    info_marker.pose.position.z = obstacle->IsVirtual() ? traffic_lights_info_list_[obstacle->Id()].trigger_volume.center.z
-                                                        : objects_map_[obstacle->Id()].pose.position.z;
+    // the obstacles are built from the same snapshot
+    info_marker.pose.position.z =
+        obstacle->IsVirtual() ? world.traffic_lights_info_list->at(obstacle->Id()).trigger_volume.center.z
+                              : world.objects_map->at(obstacle->Id()).pose.position.z;
     info_marker.header.stamp = ros::Time::now();
     info_marker.header.frame_id = "map";
     info_marker.lifetime = ros::Duration(1.0);
     info_marker.action = visualization_msgs::Marker::ADD;
     info_marker.scale.x = obstacle->GetBoundingBox().length();
     info_marker.scale.y = obstacle->GetBoundingBox().width();
-    info_marker.scale.z = obstacle->IsVirtual() ? traffic_lights_info_list_[obstacle->Id()].trigger_volume.size.z
-                                                : objects_map_[obstacle->Id()].shape.dimensions[2];
+    info_marker.scale.z =
+        obstacle->IsVirtual() ? world.traffic_lights_info_list->at(obstacle->Id()).trigger_volume.size.z
+                              : world.objects_map->at(obstacle->Id()).shape.dimensions[2];
     obstacle_info_mark_array.markers.push_back(info_marker);
 
     trajectory_marker.type = visualization_msgs::Marker::LINE_STRIP;
@@ -322,6 +743,9 @@ void MotionPlanner::VisualizeValidTrajectories(
 }
 
 void MotionPlanner::VisualizeOptimalTrajectory(const planning_msgs::Trajectory &optimal_trajectory) const {
+  if (visualized_trajectory_publisher_.getNumSubscribers() == 0) {
+    return;
+  }
   visualization_msgs::Marker optimal_trajectory_marker;
   optimal_trajectory_marker.type = visualization_msgs::Marker::POINTS;
   optimal_trajectory_marker.header.stamp = ros::Time::now();
@@ -347,14 +771,15 @@ void MotionPlanner::VisualizeOptimalTrajectory(const planning_msgs::Trajectory &
   visualized_trajectory_publisher_.publish(optimal_trajectory_marker);
 }
 
-void MotionPlanner::VisualizeTrafficLightBox() {
+void MotionPlanner::VisualizeTrafficLightBox(const WorldSnapshot &world) {
   visualization_msgs::MarkerArray traffic_light_boxes_markers;
 
-  for (const auto &traffic_light : traffic_lights_info_list_) {
-    if (traffic_light_status_list_.find(traffic_light.first) == traffic_light_status_list_.end()) {
+  for (const auto &traffic_light : *world.traffic_lights_info_list) {
+    const auto status = world.traffic_light_status_list->find(traffic_light.first);
+    if (status == world.traffic_light_status_list->end()) {
       continue;
     }
-    if (traffic_light_status_list_[traffic_light.first].state == carla_msgs::CarlaTrafficLightStatus::GREEN) {
+    if (status->second.state == carla_msgs::CarlaTrafficLightStatus::GREEN) {
       continue;
     }
     visualization_msgs::Marker traffic_light_marker;
@@ -378,7 +803,7 @@ void MotionPlanner::VisualizeTrafficLightBox() {
   visualized_traffic_light_box_publisher_.publish(traffic_light_boxes_markers);
 }
 
-void MotionPlanner::VisualizeReferenceLine(std::vector<ReferenceLine> &ref_lanes) {
+void MotionPlanner::VisualizeReferenceLine(const std::vector<ReferenceLine> &ref_lanes) const {
   visualization_msgs::MarkerArray marker_array;
   int i = 0;
   for (const auto &ref_line : ref_lanes) {
@@ -456,30 +881,38 @@ void MotionPlanner::GenerateEmergencyStopTrajectory(const planning_msgs::Traject
 std::vector<planning_msgs::TrajectoryPoint> MotionPlanner::GetStitchingTrajectory(
     const ros::Time &current_time_stamp,
     double planning_cycle_time,
-    size_t preserve_points_num) {
+    size_t preserve_points_num,
+    bool *is_stitched) {
+  if (is_stitched != nullptr) {
+    *is_stitched = false;
+  }
   auto state = vehicle_state_->GetKinoDynamicVehicleState();
   if (!has_history_trajectory_ || (state.v < 0.2 && std::fabs(state.a) < 0.4)) {
     return MotionPlanner::ComputeReinitStitchingTrajectory(planning_cycle_time, state);
   }
-  if (history_trajectory_.trajectory_points.empty()) {
+  if (history_trajectory_->trajectory_points.empty()) {
     return MotionPlanner::ComputeReinitStitchingTrajectory(planning_cycle_time, state);
   }
-  double relative_time = (current_time_stamp - history_trajectory_.header.stamp).toSec();
-  auto time_matched_index = GetTimeMatchIndex(relative_time, 1.0e-5, history_trajectory_.trajectory_points);
+  double relative_time = (current_time_stamp - history_trajectory_->header.stamp).toSec();
+  auto time_matched_index = GetTimeMatchIndex(relative_time, 1.0e-5, history_trajectory_->trajectory_points,
+                                              history_time_step_);
 
   // current time smaller than prev first trajectory point's relative time.
-  if (time_matched_index == 0 && relative_time < history_trajectory_.trajectory_points.front().relative_time) {
+  if (time_matched_index == 0 && relative_time < history_trajectory_->trajectory_points.front().relative_time) {
     return MotionPlanner::ComputeReinitStitchingTrajectory(planning_cycle_time, state);
   }
   // current time exceeds the prev last trajectory point's relative time
-  if (time_matched_index >= history_trajectory_.trajectory_points.size() - 1) {
+  if (time_matched_index >= history_trajectory_->trajectory_points.size() - 1) {
     return MotionPlanner::ComputeReinitStitchingTrajectory(planning_cycle_time, state);
   }
   // time matched trajectory point from history trajectory
-  auto time_matched_tp = history_trajectory_.trajectory_points[time_matched_index];
-  size_t position_matched_index = GetPositionMatchedIndex({state.x, state.y}, history_trajectory_.trajectory_points);
+  auto time_matched_tp = history_trajectory_->trajectory_points[time_matched_index];
+  // the ego is near the point it was planned to reach by now, the search starts there
+  size_t position_matched_index = GetPositionMatchedIndex(
+      {state.x, state.y}, history_trajectory_->trajectory_points, time_matched_index,
+      static_cast<size_t>(std::max(0, PlanningConfig::Instance().stitching_position_match_window())));
   // position matched trajectory point from history trajectory
-  auto position_matched_tp = history_trajectory_.trajectory_points[position_matched_index];
+  auto position_matched_tp = history_trajectory_->trajectory_points[position_matched_index];
   auto sd = GetLatAndLonDistFromRefPoint(state.x, state.y, position_matched_tp.path_point);
   double lon_diff = time_matched_tp.path_point.s - sd.first;
   double lat_diff = sd.second;
@@ -491,18 +924,22 @@ std::vector<planning_msgs::TrajectoryPoint> MotionPlanner::GetStitchingTrajector
   }
   double forward_rel_time = relative_time + planning_cycle_time;
   size_t forward_rel_matched_index = GetTimeMatchIndex(forward_rel_time, 1.0e-5,
-                                                       history_trajectory_.trajectory_points);
+                                                       history_trajectory_->trajectory_points,
+                                                       history_time_step_);
 
   auto matched_index = std::min(position_matched_index, time_matched_index);
   std::vector<planning_msgs::TrajectoryPoint> stitching_trajectory;
-  stitching_trajectory.assign(history_trajectory_.trajectory_points.begin()
+  stitching_trajectory.assign(history_trajectory_->trajectory_points.begin()
                                   + std::max(0, static_cast<int>(matched_index - preserve_points_num)),
-                              history_trajectory_.trajectory_points.begin() + forward_rel_matched_index + 1);
+                              history_trajectory_->trajectory_points.begin() + forward_rel_matched_index + 1);
   const double zero_s = stitching_trajectory.back().path_point.s;
   for (auto &tp : stitching_trajectory) {
-    tp.relative_time = tp.relative_time + (history_trajectory_.header.stamp - current_time_stamp).toSec();
+    tp.relative_time = tp.relative_time + (history_trajectory_->header.stamp - current_time_stamp).toSec();
     tp.path_point.s = tp.path_point.s - zero_s;
   }
+  if (is_stitched != nullptr) {
+    *is_stitched = true;
+  }
   return stitching_trajectory;
 }
 
@@ -537,29 +974,61 @@ std::vector<planning_msgs::TrajectoryPoint> MotionPlanner::ComputeReinitStitchin
 }
 
 size_t MotionPlanner::GetPositionMatchedIndex(const std::pair<double, double> &xy,
-                                              const std::vector<planning_msgs::TrajectoryPoint> &trajectory) {
+                                              const std::vector<planning_msgs::TrajectoryPoint> &trajectory,
+                                              size_t start_index,
+                                              size_t window) {
   ROS_ASSERT(!trajectory.empty());
+  auto sqr_dist = [&trajectory, &xy](size_t i) -> double {
+    return (trajectory[i].path_point.x - xy.first) * (trajectory[i].path_point.x - xy.first) +
+        (trajectory[i].path_point.y - xy.second) * (trajectory[i].path_point.y - xy.second);
+  };
+  start_index = std::min(start_index, trajectory.size() - 1);
+  const size_t begin = start_index > window ? start_index - window : 0;
+  const size_t end = std::min(trajectory.size(), start_index + window + 1);
   double min_dist_sqr = std::numeric_limits<double>::max();
-  size_t min_index = 0;
+  size_t min_index = begin;
   constexpr double kEps = 1.0e-5;
-  for (size_t i = 0; i < trajectory.size(); ++i) {
-    double dist_sqr = (trajectory[i].path_point.x - xy.first) * (trajectory[i].path_point.x - xy.first) +
-        (trajectory[i].path_point.y - xy.second) * (trajectory[i].path_point.y - xy.second);
+  for (size_t i = begin; i < end; ++i) {
+    double dist_sqr = sqr_dist(i);
     if (dist_sqr < min_dist_sqr + kEps) {
       min_dist_sqr = dist_sqr;
       min_index = i;
     }
   }
+  // the ego is off the planned timing by more than the window
+  if (min_index == begin) {
+    while (min_index > 0 && sqr_dist(min_index - 1) < min_dist_sqr) {
+      min_dist_sqr = sqr_dist(--min_index);
+    }
+  }
+  if (min_index + 1 == end) {
+    while (min_index + 1 < trajectory.size() && sqr_dist(min_index + 1) < min_dist_sqr) {
+      min_dist_sqr = sqr_dist(++min_index);
+    }
+  }
   return min_index;
 }
 
 size_t MotionPlanner::GetTimeMatchIndex(double relative,
                                         double eps,
-                                        const std::vector<planning_msgs::TrajectoryPoint> &trajectory) {
+                                        const std::vector<planning_msgs::TrajectoryPoint> &trajectory,
+                                        double dt) {
   ROS_ASSERT(!trajectory.empty());
   if (relative > trajectory.back().relative_time) {
     return trajectory.size() - 1;
   }
+  if (dt > 0.0) {
+    // the first point not earlier than relative by more than eps, the steps below only absorb the rounding
+    const double steps = std::ceil((relative - eps - trajectory.front().relative_time) / dt);
+    size_t index = steps <= 0.0 ? 0 : std::min(static_cast<size_t>(steps), trajectory.size());
+    while (index > 0 && !(trajectory[index - 1].relative_time + eps < relative)) {
+      --index;
+    }
+    while (index < trajectory.size() && trajectory[index].relative_time + eps < relative) {
+      ++index;
+    }
+    return index;
+  }
   auto cmp = [&eps](const planning_msgs::TrajectoryPoint &tp, double relative_time) -> bool {
     return tp.relative_time + eps < relative_time;
   };
@@ -567,6 +1036,25 @@ size_t MotionPlanner::GetTimeMatchIndex(double relative,
   return std::distance(trajectory.begin(), iter);
 
 }
+
+double MotionPlanner::GetUniformTimeStep(const std::vector<planning_msgs::TrajectoryPoint> &trajectory) {
+  constexpr double kTimeTolerance = 1.0e-6;
+  if (trajectory.size() < 2) {
+    return 0.0;
+  }
+  const double start_time = trajectory.front().relative_time;
+  const double dt = trajectory[1].relative_time - start_time;
+  if (dt <= 0.0) {
+    return 0.0;
+  }
+  for (size_t i = 2; i < trajectory.size(); ++i) {
+    if (std::fabs(start_time + static_cast<double>(i) * dt - trajectory[i].relative_time) > kTimeTolerance) {
+      return 0.0;
+    }
+  }
+  return dt;
+}
+
 std::pair<double, double> MotionPlanner::GetLatAndLonDistFromRefPoint(double x,
                                                                       double y,
                                                                       const planning_msgs::PathPoint &point) {
@@ -579,6 +1067,27 @@ std::pair<double, double> MotionPlanner::GetLatAndLonDistFromRefPoint(double x,
 }
 
 MotionPlanner::~MotionPlanner() {
+  if (visualization_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(visualization_mutex_);
+      is_visualizing_ = false;
+    }
+    visualization_cv_.notify_all();
+    visualization_thread_.join();
+  }
+  // an outstanding service call is only given up at the ros shutdown
+  if (route_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(route_request_mutex_);
+      is_requesting_routes_ = false;
+    }
+    route_request_cv_.notify_all();
+    route_thread_.join();
+  }
+  // the callbacks write into this
+  if (world_spinner_) {
+    world_spinner_->stop();
+  }
   if (reference_generator_) {
     reference_generator_->Stop();
   }
@@ -587,113 +1096,132 @@ MotionPlanner::~MotionPlanner() {
 std::vector<std::shared_ptr<Obstacle>> MotionPlanner::GetKeyObstacle(
     const std::unordered_map<int, derived_object_msgs::Object> &objects,
     const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus> &traffic_light_status_list,
-    const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> &traffic_lights_info_list,
+    const TrafficLightRegistry &traffic_lights,
     const planning_msgs::TrajectoryPoint &trajectory_point,
-    int ego_id, const std::vector<PlanningTarget> &targets) {
-  std::vector<std::shared_ptr<Obstacle>> obstacles;
+    int ego_id, const std::vector<PlanningTarget> &targets,
+    common::ThreadPool *thread_pool) {
   auto ego_object = objects.at(ego_id);
   const double front_distance = PlanningConfig::Instance().max_lookahead_distance();
   const double back_distance = PlanningConfig::Instance().max_lookback_distance();
-  for (const auto& target : targets) {
-    if (!target.is_best_behaviour) {
-      continue;
+  const double lat_threshold = PlanningConfig::Instance().sample_lat_threshold();
+  auto is_near_target = [&](const PlanningTarget &target, double x, double y) {
+    common::SLPoint sl_point;
+    if (!target.ref_lane->XYToSL(x, y, &sl_point)) {
+      return false;
     }
-    for (const auto &object : objects) {
-      if (object.first == ego_id) {
-        continue;
-      }
-      double height_diff = std::fabs(object.second.pose.position.z - ego_object.pose.position.z);
-      if (height_diff > 3) {
-        continue;
-      }
-      double distance = std::hypot(object.second.pose.position.x - trajectory_point.path_point.x,
-                                   object.second.pose.position.y - trajectory_point.path_point.y);
-
-      if (distance > front_distance) {
-        continue;
-      }
-      common::SLPoint sl_point;
-      if (!target.ref_lane.XYToSL(object.second.pose.position.x, object.second.pose.position.y, &sl_point)) {
-        continue;
-      }
-      if (sl_point.s > front_distance || sl_point.s < -back_distance ||
-          sl_point.l > PlanningConfig::Instance().sample_lat_threshold() ||
-          sl_point.l < -PlanningConfig::Instance().sample_lat_threshold()) {
-        continue;
-      }
+    return sl_point.s <= front_distance && sl_point.s >= -back_distance &&
+        sl_point.l <= lat_threshold && sl_point.l >= -lat_threshold;
+  };
 
-//    Eigen::Vector2d
-//        ego_heading{std::cos(trajectory_point.path_point.theta), std::sin(trajectory_point.path_point.theta)};
-//    Eigen::Vector2d agent_to_ego{object.second.pose.position.x - trajectory_point.path_point.x,
-//                                 object.second.pose.position.y - trajectory_point.path_point.y};
-//    const double cross_prod = agent_to_ego.x() * ego_heading.y() - agent_to_ego.y() * ego_heading.x();
-//    if (std::fabs(cross_prod) > PlanningConfig::Instance().sample_lat_threshold()) {
-//      continue;
-//    }
-//    const double dot_prod = agent_to_ego.x() * ego_heading.x() + agent_to_ego.y() * ego_heading.y();
-//    if (dot_prod > front_distance || dot_prod < -back_distance) {
-//      continue;
-//    }
-      auto obstacle = std::make_shared<Obstacle>(object.second);
-      obstacle->PredictTrajectory(PlanningConfig::Instance().max_lookahead_time(),
-                                  PlanningConfig::Instance().delta_t());
-      obstacles.emplace_back(obstacle);
-    }
-
-    for (const auto &light_info : traffic_lights_info_list) {
-      auto id = light_info.first;
-      if (traffic_light_status_list.find(id) == traffic_light_status_list.end()) {
-        continue;
-      }
-      const auto light_status = traffic_light_status_list.at(id);
-      if (light_status.state == carla_msgs::CarlaTrafficLightStatus::GREEN
-          || light_status.state == carla_msgs::CarlaTrafficLightStatus::UNKNOWN) {
-        continue;
-      }
-      auto x = light_info.second.trigger_volume.center.x;
-      auto y = light_info.second.trigger_volume.center.y;
-      auto z = light_info.second.trigger_volume.center.z;
-      double height_diff = std::fabs(z - ego_object.pose.position.z);
-      if (height_diff > 3) {
-        continue;
-      }
-      double dist = std::hypot(trajectory_point.path_point.x - x,
-                               trajectory_point.path_point.y - y);
-      if (dist > front_distance) {
-        continue;
+  // the actors of this cycle in the iteration order of the map, the grid discards the far ones before any projection
+  std::vector<const derived_object_msgs::Object *> actors;
+  std::vector<double> actor_xs;
+  std::vector<double> actor_ys;
+  actors.reserve(objects.size());
+  actor_xs.reserve(objects.size());
+  actor_ys.reserve(objects.size());
+  for (const auto &object : objects) {
+    if (object.first == ego_id) {
+      continue;
+    }
+    actors.push_back(&object.second);
+    actor_xs.push_back(object.second.pose.position.x);
+    actor_ys.push_back(object.second.pose.position.y);
+  }
+  constexpr double kActorGridCellSize = 20.0;
+  const common::PointGridIndex actor_index(actor_xs, actor_ys, kActorGridCellSize);
+  std::vector<size_t> nearby_actors;
+  actor_index.WithinRadius(trajectory_point.path_point.x, trajectory_point.path_point.y, front_distance,
+                           &nearby_actors);
+  // every actor is kept once, even if it is close to several targets
+  std::vector<const derived_object_msgs::Object *> key_actors;
+  for (const size_t index : nearby_actors) {
+    const auto &object = *actors[index];
+    double height_diff = std::fabs(object.pose.position.z - ego_object.pose.position.z);
+    if (height_diff > 3) {
+      continue;
+    }
+    for (const auto &target : targets) {
+      if (target.is_best_behaviour && is_near_target(target, object.pose.position.x, object.pose.position.y)) {
+        key_actors.push_back(&object);
+        break;
       }
+    }
+  }
 
+  // only the registered lights around the ego are visited, their projections are cached per reference line
+  std::vector<std::pair<const carla_msgs::CarlaTrafficLightInfo *, const carla_msgs::CarlaTrafficLightStatus *>>
+      key_lights;
+  std::vector<size_t> nearby_lights;
+  traffic_lights.WithinRadius(trajectory_point.path_point.x, trajectory_point.path_point.y, front_distance,
+                              &nearby_lights);
+  for (const size_t index : nearby_lights) {
+    const auto &light_info = traffic_lights.Info(index);
+    const auto light_status = traffic_light_status_list.find(light_info.id);
+    if (light_status == traffic_light_status_list.end()) {
+      continue;
+    }
+    if (light_status->second.state == carla_msgs::CarlaTrafficLightStatus::GREEN
+        || light_status->second.state == carla_msgs::CarlaTrafficLightStatus::UNKNOWN) {
+      continue;
+    }
+    double height_diff = std::fabs(light_info.trigger_volume.center.z - ego_object.pose.position.z);
+    if (height_diff > 3) {
+      continue;
+    }
+    for (const auto &target : targets) {
       common::SLPoint sl_point;
-      if (!target.ref_lane.XYToSL(x, y, &sl_point)) {
-        continue;
-      }
-      if (sl_point.s > front_distance || sl_point.s < -back_distance ||
-          sl_point.l > PlanningConfig::Instance().sample_lat_threshold() ||
-          sl_point.l < -PlanningConfig::Instance().sample_lat_threshold()) {
-        continue;
+      if (target.is_best_behaviour && traffic_lights.Project(index, target.ref_lane, &sl_point)
+          && sl_point.s <= front_distance && sl_point.s >= -back_distance
+          && sl_point.l <= lat_threshold && sl_point.l >= -lat_threshold) {
+        key_lights.emplace_back(&light_info, &light_status->second);
+        break;
       }
-//    Eigen::Vector2d
-//        ego_heading{std::cos(trajectory_point.path_point.theta), std::sin(trajectory_point.path_point.theta)};
-//    Eigen::Vector2d agent_to_ego{x - trajectory_point.path_point.x, y - trajectory_point.path_point.y};
-//    const double cross_prod = agent_to_ego.x() * ego_heading.y() - agent_to_ego.y() * ego_heading.x();
-//    if (std::fabs(cross_prod) > PlanningConfig::Instance().sample_lat_threshold()) {
-//      continue;
-//    }
-//    const double dot_prod = agent_to_ego.x() * ego_heading.x() + agent_to_ego.y() * ego_heading.y();
-//    if (dot_prod > front_distance || dot_prod < -back_distance) {
-//      continue;
-//    }
-
-      auto obstacle = std::make_shared<Obstacle>(light_info.second, light_status);
-      obstacle->PredictTrajectory(PlanningConfig::Instance().max_lookahead_time(),
-                                  PlanningConfig::Instance().delta_t());
-      obstacles.emplace_back(obstacle);
     }
   }
 
+  // the obstacles are built independently of each other and predicted together
+  std::vector<std::shared_ptr<Obstacle>> obstacles(key_actors.size() + key_lights.size());
+  auto build = [&](size_t i) {
+    obstacles[i] = i < key_actors.size()
+                   ? std::make_shared<Obstacle>(*key_actors[i])
+                   : std::make_shared<Obstacle>(*key_lights[i - key_actors.size()].first,
+                                                *key_lights[i - key_actors.size()].second);
+  };
+  if (thread_pool != nullptr) {
+    thread_pool->ParallelFor(0, obstacles.size(), 1, build);
+  } else {
+    for (size_t i = 0; i < obstacles.size(); ++i) {
+      build(i);
+    }
+  }
+  PredictionBatch batch(obstacles, PlanningConfig::Instance().max_lookahead_time(),
+                        PlanningConfig::Instance().delta_t());
+  CreatePredictionModel(targets)->Predict(&batch);
+  batch.Apply();
   return obstacles;
 }
 
+std::shared_ptr<const PredictionModel> MotionPlanner::CreatePredictionModel(
+    const std::vector<PlanningTarget> &targets) {
+  const auto &model = PlanningConfig::Instance().obstacle_prediction_model();
+  if (model == "constant_turn_rate") {
+    return std::make_shared<ConstantTurnRateModel>();
+  }
+  if (model == "lane_following") {
+    std::vector<std::shared_ptr<const ReferenceLine>> lanes;
+    for (const auto &target : targets) {
+      lanes.push_back(target.ref_lane);
+    }
+    return std::make_shared<LaneFollowingModel>(std::move(lanes), std::make_shared<ConstantTurnRateModel>());
+  }
+  if (model != "constant_velocity") {
+    ROS_WARN_ONCE("[MotionPlanner::CreatePredictionModel], unknown obstacle prediction model %s, "
+                  "the obstacles are predicted at constant velocity", model.c_str());
+  }
+  return std::make_shared<ConstantTurnRateModel>(false, false);
+}
+
 bool MotionPlanner::AddAgentPotentialReferenceLines(const vehicle_state::KinoDynamicState &state,
                                                     const planning_msgs::Lane &lane,
                                                     double lookahead_length,
@@ -717,7 +1245,8 @@ bool MotionPlanner::AddAgentPotentialReferenceLines(const vehicle_state::KinoDyn
   return true;
 }
 
-bool MotionPlanner::GetEgoVehicleRoutes(geometry_msgs::Pose &start_pose, geometry_msgs::Pose &destination) {
+bool MotionPlanner::GetEgoVehicleRoutes(geometry_msgs::Pose &start_pose, geometry_msgs::Pose &destination,
+                                        bool is_extension) {
   planning_srvs::RoutePlanService srv;
   srv.request.start_pose = start_pose;
   srv.request.end_pose = destination;
@@ -727,16 +1256,87 @@ bool MotionPlanner::GetEgoVehicleRoutes(geometry_msgs::Pose &start_pose, geometr
   if (srv.response.route.way_points.size() < 20) {
     return false;
   }
-  return reference_generator_->UpdateRouteResponse(srv.response);
+  if (!is_extension) {
+    route_publisher_.publish(srv.response.route);
+    return reference_generator_->UpdateRouteResponse(srv.response);
+  }
+  if (!reference_generator_->ExtendRoute(srv.response)) {
+    return false;
+  }
+  planning_msgs::Lane route;
+  route.way_points = reference_generator_->GetRouteWayPoints();
+  route_publisher_.publish(route);
+  return true;
+}
+
+void MotionPlanner::RequestRoute(const geometry_msgs::Pose &start_pose, const geometry_msgs::Pose &destination,
+                                 bool is_extension) {
+  {
+    std::lock_guard<std::mutex> lock(route_request_mutex_);
+    if (is_extension && has_route_request_ && !route_request_.is_extension) {
+      return;
+    }
+    route_request_.start_pose = start_pose;
+    route_request_.destination = destination;
+    route_request_.is_extension = is_extension;
+    has_route_request_ = true;
+  }
+  route_request_cv_.notify_one();
+}
+
+void MotionPlanner::PrefetchRoute() {
+  const double prefetch_distance = PlanningConfig::Instance().route_prefetch_distance();
+  const uint64_t route_version = reference_generator_->RouteVersion();
+  if (prefetch_distance <= 0.0 || route_version == 0 || route_version == prefetched_route_version_) {
+    return;
+  }
+  if (reference_generator_->RemainingRouteLength() > prefetch_distance) {
+    return;
+  }
+  geometry_msgs::Pose route_end;
+  if (!reference_generator_->GetRouteEnd(&route_end)) {
+    return;
+  }
+  prefetched_route_version_ = route_version;
+  ROS_INFO("[MotionPlanner::PrefetchRoute], %lf m of the route left, requesting its extension",
+           reference_generator_->RemainingRouteLength());
+  RequestRoute(route_end, geometry_msgs::Pose(), true);
 }
-void MotionPlanner::VisualizeEgoVehicle() {
+
+void MotionPlanner::RunRouteRequests() {
+  while (true) {
+    RouteRequest request;
+    {
+      std::unique_lock<std::mutex> lock(route_request_mutex_);
+      route_request_cv_.wait(lock, [this] { return !is_requesting_routes_ || has_route_request_; });
+      if (!is_requesting_routes_) {
+        return;
+      }
+      request = route_request_;
+      has_route_request_ = false;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    if (!GetEgoVehicleRoutes(request.start_pose, request.destination, request.is_extension)) {
+      ROS_WARN("[MotionPlanner::RunRouteRequests], failed to get the %s, the planning goes on on the current route",
+               request.is_extension ? "route extension" : "route");
+      continue;
+    }
+    ROS_INFO("[MotionPlanner::RunRouteRequests], got the %s in %lf s",
+             request.is_extension ? "route extension" : "route",
+             std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  }
+}
+void MotionPlanner::VisualizeEgoVehicle(const VisualizationSnapshot &snapshot) const {
+  if (visualized_ego_vehicle_publisher_.getNumSubscribers() == 0) {
+    return;
+  }
   visualization_msgs::Marker vehicle_marker;
   vehicle_marker.type = visualization_msgs::Marker::CUBE;
-  vehicle_marker.scale.x = PlanningConfig::Instance().vehicle_params().length;
-  vehicle_marker.scale.y = PlanningConfig::Instance().vehicle_params().width;
-  vehicle_marker.scale.z = ego_object_.shape.dimensions[2];
-  vehicle_marker.pose = ego_object_.pose;
-  vehicle_marker.id = ego_vehicle_id_;
+  vehicle_marker.scale.x = snapshot.ego_length;
+  vehicle_marker.scale.y = snapshot.ego_width;
+  vehicle_marker.scale.z = snapshot.ego_object.shape.dimensions[2];
+  vehicle_marker.pose = snapshot.ego_object.pose;
+  vehicle_marker.id = snapshot.world->ego_vehicle_id;
   vehicle_marker.lifetime = ros::Duration(1.0);
   vehicle_marker.action = visualization_msgs::Marker::ADD;
   vehicle_marker.color.a = 1.0;
@@ -1,6 +1,14 @@
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_INCLUDE_PLANNER_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_INCLUDE_PLANNER_HPP_
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <nav_msgs/Odometry.h>
 #include <visualization_msgs/Marker.h>
@@ -16,41 +24,229 @@
 
 #include "vehicle_state/vehicle_state.hpp"
 #include "thread_pool/thread_pool.hpp"
+#include "profiler/stage_profiler.hpp"
+#include "clock/lock_step_clock.hpp"
+#include "trajectory/compact_trajectory_codec.hpp"
 #include "obstacle_manager/obstacle.hpp"
+#include "obstacle_manager/obstacle_predictor.hpp"
+#include "obstacle_manager/traffic_light_registry.hpp"
 #include <planning_msgs/Trajectory.h>
 #include <planning_msgs/Behaviour.h>
 #include <reference_line/reference_line.hpp>
 #include <reference_generator/reference_generator.hpp>
 #include "trajectory_planner.hpp"
 #include "frenet_lattice_planner/frenet_lattice_planner.hpp"
+#include "benchmark/planning_cycle_capture.hpp"
 
 namespace planning {
 
 class MotionPlanner {
  public:
   MotionPlanner() = default;
-  explicit MotionPlanner(const ros::NodeHandle &nh);
+  /**
+   * @brief: constructor
+   * @param nh
+   * @param callback_queue: the queue of nh, which Launch spins, the global queue if nullptr
+   * @param thread_pool: the pool shared with the other planners of the process, the planner creates its own if
+   * nullptr. only the owner logs and resets its statistics
+   */
+  explicit MotionPlanner(const ros::NodeHandle &nh, ros::CallbackQueue *callback_queue = nullptr,
+                         std::shared_ptr<common::ThreadPool> thread_pool = nullptr);
   ~MotionPlanner();
   void Launch();
 
+  /**
+   * @brief: let Launch return after the current cycle, called from another thread
+   */
+  void Stop() { is_running_ = false; }
+
+  // the stages of a planning cycle below are static, so the offline benchmark replays them on recorded scenes
+
+  /**
+   * @brief: the smoothing config of the reference lines from the planning config
+   */
+  static ReferenceLineConfig GetReferenceLineConfig();
+
+  /**
+   * @brief: the targets of the reference lines the init point projects on
+   * @param ref_lines
+   * @param init_point
+   * @return
+   */
+  static std::vector<PlanningTarget> GetPlanningTargets(const std::vector<ReferenceLine> &ref_lines,
+                                                        const planning_msgs::TrajectoryPoint &init_point);
+
+  /**
+   * @brief: the targets like above, their reference lines share ref_lines instead of copying them, so the caches
+   * keyed by the reference line, as those of the traffic light registry, hit as long as ref_lines is not rebuilt
+   * @param ref_lines
+   * @param init_point
+   * @return
+   */
+  static std::vector<PlanningTarget> GetPlanningTargets(
+      const std::shared_ptr<const std::vector<ReferenceLine>> &ref_lines,
+      const planning_msgs::TrajectoryPoint &init_point);
+
+  /**
+   * @brief: the actors and red traffic lights close to a best behaviour target, each predicted once
+   * @param objects
+   * @param traffic_light_status_list
+   * @param traffic_lights: the registry of the traffic light info list
+   * @param trajectory_point
+   * @param ego_id
+   * @param targets
+   * @param thread_pool: runs the predictions in parallel, sequential if nullptr
+   * @return
+   */
+  static std::vector<std::shared_ptr<Obstacle>> GetKeyObstacle(
+      const std::unordered_map<int, derived_object_msgs::Object> &objects,
+      const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus> &traffic_light_status_list,
+      const TrafficLightRegistry &traffic_lights,
+      const planning_msgs::TrajectoryPoint &trajectory_point, int ego_id,
+      const std::vector<PlanningTarget> &targets,
+      common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: the obstacle prediction model of the config, the lane following one follows the reference lines of
+   * the targets
+   */
+  static std::shared_ptr<const PredictionModel> CreatePredictionModel(const std::vector<PlanningTarget> &targets);
+
+  /**
+   * @brief: compute reinit stitchinig trajectory
+   * @param planning_cycle_time
+   * @param kino_dynamic_state
+   * @return
+   */
+  static std::vector<planning_msgs::TrajectoryPoint> ComputeReinitStitchingTrajectory(
+      double planning_cycle_time,
+      const vehicle_state::KinoDynamicState &kino_dynamic_state);
+
  private:
+  /**
+   * @brief: the latest messages of the world, published by the callback thread as a whole and never modified
+   * afterwards, the parts a message does not touch are shared with the previous snapshot
+   */
+  struct WorldSnapshot {
+    int ego_vehicle_id = -1;
+    std::shared_ptr<const carla_msgs::CarlaEgoVehicleStatus> ego_vehicle_status;
+    std::shared_ptr<const carla_msgs::CarlaEgoVehicleInfo> ego_vehicle_info;
+    std::shared_ptr<const std::unordered_map<int, derived_object_msgs::Object>> objects_map;
+    // the stamp of the objects, the lock step waits for those of the tick
+    ros::Time objects_stamp;
+    std::shared_ptr<const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus>> traffic_light_status_list;
+    std::shared_ptr<const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo>> traffic_lights_info_list;
+    // built from traffic_lights_info_list when it arrives, the trigger volumes are static per map
+    std::shared_ptr<const TrafficLightRegistry> traffic_light_registry;
+  };
+
+  /**
+   * @brief: what a planning cycle shows, handed to the visualization thread as a whole and never modified afterwards
+   */
+  struct VisualizationSnapshot {
+    std::shared_ptr<const WorldSnapshot> world;
+    derived_object_msgs::Object ego_object;
+    double ego_length = 0.0;
+    double ego_width = 0.0;
+    std::shared_ptr<const std::vector<ReferenceLine>> ref_lines;
+    std::vector<std::shared_ptr<Obstacle>> obstacles;
+    planning_msgs::Trajectory::ConstPtr optimal_trajectory;
+  };
+
   void RunOnce();
+
+  /**
+   * @brief: publish the p50, p99 and max latency of every stage since the last call on the diagnostics topic
+   */
+  void PublishStageStatistics();
+
+  /**
+   * @brief: whether the last published trajectory still covers the next cycle, so it can be kept when the planning
+   * misses its deadline
+   * @param current_time_stamp
+   * @param planning_cycle_time
+   * @return
+   */
+  bool CanReuseHistoryTrajectory(const ros::Time &current_time_stamp, double planning_cycle_time) const;
+
+  /**
+   * @brief: whether the last published trajectory can be kept instead of planning a new one. the ego follows it
+   * within the replan thresholds, the targets are the ones it was planned for, it still covers the min horizon and
+   * its remainder is valid against the current obstacles. a new one is planned at least every max interval.
+   * @param current_time_stamp
+   * @param is_stitched: whether the stitching trajectory was taken from the last published trajectory
+   * @param planning_targets
+   * @param obstacles
+   * @return
+   */
+  bool CanKeepHistoryTrajectory(const ros::Time &current_time_stamp,
+                                bool is_stitched,
+                                const std::vector<PlanningTarget> &planning_targets,
+                                const std::vector<std::shared_ptr<Obstacle>> &obstacles);
+
+  /**
+   * @brief: whether the targets ask for the same behaviour, the same number of targets with the same best behaviour,
+   * stop points and desired velocities. the stop points are compared where they are, not by their stop_s
+   */
+  static bool IsSameBehaviour(const std::vector<PlanningTarget> &targets, const std::vector<PlanningTarget> &other);
+
+  /**
+   * @brief: publish trajectory, and its compact form if it is enabled and subscribed
+   * @param trajectory
+   */
+  void PublishTrajectory(const planning_msgs::Trajectory::ConstPtr &trajectory);
+
+  /**
+   * @brief: hand the inputs of the cycle to the recorder if the cycle is slower than the capture latency threshold
+   * or ends in an emergency stop
+   * @param cycle_begin: the steady clock time the cycle began at
+   * @param current_time_stamp
+   * @param is_emergency_stop
+   * @param world: the snapshot the cycle planned on
+   * @param init_trajectory_point
+   * @param planning_targets
+   * @param obstacles
+   */
+  void CaptureCycle(const std::chrono::steady_clock::time_point &cycle_begin,
+                    const ros::Time &current_time_stamp,
+                    bool is_emergency_stop,
+                    const WorldSnapshot &world,
+                    const planning_msgs::TrajectoryPoint &init_trajectory_point,
+                    const std::vector<PlanningTarget> &planning_targets,
+                    const std::vector<std::shared_ptr<Obstacle>> &obstacles);
   void InitPublisher();
   void InitSubscriber();
+
+  /**
+   * @brief: publish a copy of the latest world snapshot changed by update, only called on the callback thread
+   * @param update
+   */
+  void UpdateWorldSnapshot(const std::function<void(WorldSnapshot *)> &update);
   void InitServiceClient();
-  void VisualizeEgoVehicle();
 
-  std::vector<PlanningTarget> GetPlanningTargets(const std::vector<ReferenceLine> &ref_lines,
-                                                 const planning_msgs::TrajectoryPoint &init_point);
+  /**
+   * @brief: hand the visualization of the cycle to the visualization thread, which only shows the latest one
+   * @param snapshot
+   */
+  void ShareVisualization(std::shared_ptr<const VisualizationSnapshot> snapshot);
 
-  static std::vector<std::shared_ptr<Obstacle>> GetKeyObstacle(
-      const std::unordered_map<int, derived_object_msgs::Object> &objects,
-      const std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus> &traffic_light_status_list,
-      const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> &traffic_lights_info_list,
-      const planning_msgs::TrajectoryPoint &trajectory_point, int ego_id,
-      const std::vector<PlanningTarget> &targets);
+  /**
+   * @brief: the loop of the visualization thread, publishes the latest snapshot at the visualization rate, only the
+   * topics with subscribers and only what changed since the last time
+   */
+  void RunVisualization();
+
+  /**
+   * @brief: visualize ego vehicle
+   * @param snapshot
+   */
+  void VisualizeEgoVehicle(const VisualizationSnapshot &snapshot) const;
 
-  bool ReRoute() {
+  /**
+   * @brief: request a new route from the ego pose on the route thread, the planning goes on on the current route
+   * until the new one arrives
+   */
+  void ReRoute() {
     geometry_msgs::Pose start_pose;
     auto state = vehicle_state_->GetKinoDynamicVehicleState();
     start_pose.position.x = state.x;
@@ -59,11 +255,28 @@ class MotionPlanner {
     start_pose.orientation = tf::createQuaternionMsgFromYaw(state.theta);
     geometry_msgs::Pose destination;
     std::cout << "destination is  : " << destination.position.x << ", y: " << destination.position.y << std::endl;
-    if (!GetEgoVehicleRoutes(start_pose, destination)) {
-      return false;
-    }
-    return true;
+    RequestRoute(start_pose, destination, false);
   }
+
+  /**
+   * @brief: hand a route request to the route thread, it replaces a pending request, but a pending new route is
+   * never replaced by an extension
+   * @param is_extension: true to append the route to the current one, false to replace it
+   */
+  void RequestRoute(const geometry_msgs::Pose &start_pose, const geometry_msgs::Pose &destination,
+                    bool is_extension);
+
+  /**
+   * @brief: request the extension of the route from its end once the route ahead of the ego is shorter than the
+   * route_prefetch_distance, once per version of the route
+   */
+  void PrefetchRoute();
+
+  /**
+   * @brief: the route thread, calls the route service for the latest request so a slow service never blocks the
+   * planning
+   */
+  void RunRouteRequests();
   /**
    * @brief: add agent potential reference line
    * @param state
@@ -83,12 +296,13 @@ class MotionPlanner {
       std::vector<ReferenceLine> *ptr_potential_lanes);
 
   /**
-   * @brief: get ego vehicle routes
+   * @brief: get ego vehicle routes, blocks on the route service, only called by the route thread
    * @param start_pose
    * @param destination
+   * @param is_extension: true to append the route to the current one, false to replace it
    * @return
    */
-  bool GetEgoVehicleRoutes(geometry_msgs::Pose &start_pose, geometry_msgs::Pose &destination);
+  bool GetEgoVehicleRoutes(geometry_msgs::Pose &start_pose, geometry_msgs::Pose &destination, bool is_extension);
 
   /**
    * @brief: generate emergency stop trajectory
@@ -103,11 +317,13 @@ class MotionPlanner {
    * @param current_time_stamp
    * @param planning_cycle_time
    * @param preserve_points_num
+   * @param is_stitched: [out] false if the trajectory is reinitialized from the vehicle state, may be nullptr
    * @return
    */
   std::vector<planning_msgs::TrajectoryPoint> GetStitchingTrajectory(const ros::Time &current_time_stamp,
                                                                      double planning_cycle_time,
-                                                                     size_t preserve_points_num);
+                                                                     size_t preserve_points_num,
+                                                                     bool *is_stitched = nullptr);
 
   /**
    * @brief: compute the trajectory point from vehicle state
@@ -119,37 +335,42 @@ class MotionPlanner {
       double planning_cycle_time,
       const vehicle_state::KinoDynamicState &kinodynamic_state);
 
-  /**
-   * @brief: compute reinit stitchinig trajectory
-   * @param planning_cycle_time
-   * @param kino_dynamic_state
-   * @return
-   */
-  static std::vector<planning_msgs::TrajectoryPoint> ComputeReinitStitchingTrajectory(
-      double planning_cycle_time,
-      const vehicle_state::KinoDynamicState &kino_dynamic_state);
-
   /**
    * @brief: get matched index from time
    * @param relative
    * @param eps
    * @param trajectory
+   * @param dt: the time step of trajectory if its points are evenly spaced, the index is then computed instead of
+   * searched. 0 if they are not.
    * @return
    */
   static size_t GetTimeMatchIndex(
       double relative,
       double eps,
-      const std::vector<planning_msgs::TrajectoryPoint> &trajectory);
+      const std::vector<planning_msgs::TrajectoryPoint> &trajectory,
+      double dt = 0.0);
 
   /**
-   * @brief: get the matched index from position
+   * @brief: get the matched index from position, the nearest point among window points before and after
+   * start_index, followed past the window while the distance decreases
    * @param xy
    * @param trajectory
+   * @param start_index
+   * @param window
    * @return
    */
   static size_t GetPositionMatchedIndex(
       const std::pair<double, double> &xy,
-      const std::vector<planning_msgs::TrajectoryPoint> &trajectory);
+      const std::vector<planning_msgs::TrajectoryPoint> &trajectory,
+      size_t start_index,
+      size_t window);
+
+  /**
+   * @brief: the time step of trajectory if its points are evenly spaced in time
+   * @param trajectory
+   * @return: 0 if they are not or there are less than 2 points
+   */
+  static double GetUniformTimeStep(const std::vector<planning_msgs::TrajectoryPoint> &trajectory);
 
   /**
    * @brief get lateral and longitudinal distance from reference path point.
@@ -177,15 +398,17 @@ class MotionPlanner {
 
   /**
    * @brief: visualize traffic light
+   * @param world
    */
-  void VisualizeTrafficLightBox();
+  void VisualizeTrafficLightBox(const WorldSnapshot &world);
 
   /**
    * @brief: visualize reference lines
    * @param ref_lanes
    */
-  void VisualizeReferenceLine(std::vector<ReferenceLine> &ref_lanes);
-  void VisualizeObstacleTrajectory(const std::vector<std::shared_ptr<Obstacle>> &obstacle);
+  void VisualizeReferenceLine(const std::vector<ReferenceLine> &ref_lanes) const;
+  void VisualizeObstacleTrajectory(const std::vector<std::shared_ptr<Obstacle>> &obstacle,
+                                   const WorldSnapshot &world) const;
 
 
  private:
@@ -195,15 +418,25 @@ class MotionPlanner {
   std::vector<std::shared_ptr<Obstacle>> obstacles_;
   std::vector<derived_object_msgs::Object> objects_;
 //  planning_msgs::Behaviour behaviour_;
-  carla_msgs::CarlaEgoVehicleInfo ego_vehicle_info_;
-  carla_msgs::CarlaEgoVehicleStatus ego_vehicle_status_;
-  std::unordered_map<int, carla_msgs::CarlaTrafficLightStatus> traffic_light_status_list_;
-  std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> traffic_lights_info_list_;
-  std::unordered_map<int, derived_object_msgs::Object> objects_map_;
+  // written by the callback thread, RunOnce plans on the snapshot it loads at the beginning of the cycle
+  std::shared_ptr<const WorldSnapshot> world_snapshot_;
   derived_object_msgs::Object ego_object_;
   ros::NodeHandle nh_;
-  planning_msgs::Trajectory history_trajectory_;
+  ros::CallbackQueue *callback_queue_ = nullptr;
+  std::atomic<bool> is_running_{true};
+  // the world messages are handled on their own queue by the spinner thread, the global queue keeps the goal pose
+  ros::CallbackQueue world_callback_queue_;
+  std::unique_ptr<ros::AsyncSpinner> world_spinner_;
+  // the last published trajectory, shared with the in-process subscribers
+  planning_msgs::Trajectory::ConstPtr history_trajectory_;
+  // the time step of history_trajectory_, computed once when it is published, 0 if it is not evenly spaced
+  double history_time_step_ = 0.0;
+  // when the last trajectory was planned rather than kept, and the targets it was planned for
+  ros::Time last_replan_stamp_;
+  std::vector<PlanningTarget> last_replan_targets_;
   std::unique_ptr<TrajectoryPlanner> trajectory_planner_;
+  // writes the captured cycles, nullptr if there is no capture directory
+  std::unique_ptr<PlanningCycleRecorder> cycle_recorder_;
 //  std::unique_ptr<BehaviourStrategy> behaviour_planner_;
 
   ////////////////// ServiceClinet //////////////////////
@@ -223,6 +456,9 @@ class MotionPlanner {
   ros::Subscriber goal_pose_subscriber_;
   /////////////////////// Publisher /////////////////////
   ros::Publisher trajectory_publisher_;
+  ros::Publisher compact_trajectory_publisher_;
+  // nullptr if the compact trajectory is not published
+  std::unique_ptr<common::CompactTrajectoryEncoder> compact_trajectory_encoder_;
   ros::Publisher visualized_trajectory_publisher_;
   ros::Publisher visualized_valid_trajectories_publisher_;
   ros::Publisher visualized_reference_lines_publisher_;
@@ -230,10 +466,40 @@ class MotionPlanner {
   ros::Publisher visualized_obstacle_trajectory_publisher_;
   ros::Publisher visualized_obstacle_info_publisher_;
   ros::Publisher visualized_ego_vehicle_publisher_;
+  ros::Publisher stage_diagnostics_publisher_;
+  // latched, so the scenes recorded for the offline benchmark hold the route
+  ros::Publisher route_publisher_;
   /////////////////// thread pool///////////////////
   size_t thread_pool_size_ = 6;
-  std::unique_ptr<common::ThreadPool> thread_pool_;
+  std::shared_ptr<common::ThreadPool> thread_pool_;
+  bool owns_thread_pool_ = false;
+  // nullptr if the stage statistics are disabled, the timers do nothing then
+  std::unique_ptr<common::StageProfiler> stage_profiler_;
+  // the cycles in which the planner gave up candidates for the deadline
+  uint64_t num_deadline_misses_ = 0;
   std::unique_ptr<ReferenceGenerator> reference_generator_;
+  /////////////////// route requests ///////////////////
+  struct RouteRequest {
+    geometry_msgs::Pose start_pose;
+    geometry_msgs::Pose destination;
+    bool is_extension = false;
+  };
+  // only the latest request is kept, the route thread is the only user of get_ego_vehicle_route_client_
+  std::thread route_thread_;
+  std::mutex route_request_mutex_;
+  std::condition_variable route_request_cv_;
+  RouteRequest route_request_;
+  bool has_route_request_ = false;
+  bool is_requesting_routes_ = false;
+  // the route version an extension was last requested for, only touched by the planning thread
+  uint64_t prefetched_route_version_ = 0;
+  /////////////////// visualization ///////////////////
+  // written by RunOnce, the visualization thread drops the snapshots it is too slow for
+  std::shared_ptr<const VisualizationSnapshot> visualization_snapshot_;
+  std::thread visualization_thread_;
+  std::mutex visualization_mutex_;
+  std::condition_variable visualization_cv_;
+  bool is_visualizing_ = false;
 
   std::vector<PlanningTarget> planning_targets_;
 //  std::vector<std::shared_ptr<Obstacle>> obstacles_;
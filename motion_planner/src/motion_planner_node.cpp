@@ -1,9 +1,11 @@
 #include <ros/ros.h>
 #include "motion_planner.hpp"
+#include "profiler/trace_dump_service.hpp"
 #include <memory>
 int main(int argc, char **argv) {
   ros::init(argc, argv, "motion_planning_node");
   ros::NodeHandle nh;
+  common::TraceDumpService trace_dump_service(ros::NodeHandle("~"));
   auto planner = std::make_unique<planning::MotionPlanner>(nh);
   planner->Launch();
   return 0;
@@ -0,0 +1,44 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include <thread>
+#include "motion_planner.hpp"
+#include "profiler/trace_dump_service.hpp"
+
+namespace planning {
+/**
+ * @brief: the MotionPlanner in a nodelet manager, the trajectory reaches the controller nodelet of the same manager
+ * as a shared pointer without serialization. the planner keeps its own loop thread and callback queue, so the
+ * manager threads never run its callbacks during a cycle.
+ */
+class MotionPlannerNodelet : public nodelet::Nodelet {
+ public:
+  MotionPlannerNodelet() = default;
+  ~MotionPlannerNodelet() override {
+    if (motion_planner_) {
+      motion_planner_->Stop();
+    }
+    if (planning_thread_.joinable()) {
+      planning_thread_.join();
+    }
+  }
+
+ private:
+  void onInit() override {
+    ros::NodeHandle nh(getNodeHandle());
+    nh.setCallbackQueue(&callback_queue_);
+    motion_planner_ = std::make_unique<MotionPlanner>(nh, &callback_queue_);
+    // the recorder is per process, so the dump also holds the pool tasks of the other nodelets of the manager
+    trace_dump_service_ = std::make_unique<common::TraceDumpService>(getPrivateNodeHandle());
+    planning_thread_ = std::thread([this]() { motion_planner_->Launch(); });
+  }
+
+ private:
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<MotionPlanner> motion_planner_;
+  std::unique_ptr<common::TraceDumpService> trace_dump_service_;
+  std::thread planning_thread_;
+};
+}
+
+PLUGINLIB_EXPORT_CLASS(planning::MotionPlannerNodelet, nodelet::Nodelet)
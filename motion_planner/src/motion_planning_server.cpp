@@ -0,0 +1,119 @@
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "motion_planner.hpp"
+#include "name/string_name.hpp"
+#include "planning_config.hpp"
+#include "profiler/trace_dump_service.hpp"
+
+namespace {
+constexpr char kDefaultEgoRoleName[] = "ego_vehicle";
+
+/**
+ * @brief: replace the default ego role name in name by role_name
+ */
+std::string ReplaceRoleName(const std::string &name, const std::string &role_name) {
+  std::string result = name;
+  const std::string default_role_name(kDefaultEgoRoleName);
+  const auto pos = result.find(default_role_name);
+  if (pos != std::string::npos) {
+    result.replace(pos, default_role_name.size(), role_name);
+  }
+  return result;
+}
+
+/**
+ * @brief: the remappings of one ego, its carla topics and services and its own namespace under /motion_planner for
+ * the published topics. the obstacles and the traffic lights stay shared by all egos
+ */
+ros::M_string EgoRemappings(const std::string &role_name) {
+  ros::M_string remappings;
+  for (const auto &name : {common::topic::kEgoVehicleStatusName, common::topic::kEgoVehicleInfoName,
+                           common::topic::kEgoVehicleOdometryName, common::service::kRouteServiceName,
+                           common::service::kGetActorWaypointServiceName, common::service::kGetEgoWaypontServiceName,
+                           common::service::kGetAgentPotentialRouteServiceName}) {
+    remappings[name] = ReplaceRoleName(name, role_name);
+  }
+  const std::string planner_namespace = "/motion_planner/";
+  for (const auto &name : {common::topic::kPublishedTrajectoryName, common::topic::kPublishedCompactTrajectoryName,
+                           common::topic::kVisualizedTrajectoryName,
+                           common::topic::kVisualizedValidTrajectoriesName,
+                           common::topic::kVisualizedTrafficLightBoxName,
+                           common::topic::kVisualizedReferenceLinesName,
+                           common::topic::kVisualizedObstacleTrajectoriesName,
+                           common::topic::kVisualizedObstacleInfoName, common::topic::kEgoVehicleVisualizedName,
+                           common::topic::kPlanningStageDiagnosticsName, common::topic::kPlanningRouteName}) {
+    remappings[name] = planner_namespace + role_name + "/" + name.substr(planner_namespace.size());
+  }
+  return remappings;
+}
+}
+
+/**
+ * @brief: one motion planner per ego of the simulation in a single process. the planners share one thread pool,
+ * whose workers steal the candidates of whichever ego is planning, and the parameters of the server. the cycles of
+ * the egos are staggered over the cycle time so that they rarely hit the pool at once.
+ */
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "motion_planning_server");
+  ros::NodeHandle nh;
+  // the egos share the process, so one trace holds the cycles of all of them
+  common::TraceDumpService trace_dump_service(ros::NodeHandle("~"));
+  auto &config = planning::PlanningConfig::Instance();
+  config.UpdateParams(nh);
+  const std::vector<std::string> role_names = config.server_ego_role_names();
+  if (role_names.empty()) {
+    ROS_FATAL("[MotionPlanningServer], no ego role names given");
+    return 1;
+  }
+  const auto thread_pool = std::make_shared<common::ThreadPool>(std::max(1, config.server_thread_pool_size()),
+                                                                config.planner_thread_options(),
+                                                                config.executor_statistics_period() > 0);
+  if (!thread_pool->ThreadOptionsApplied()) {
+    ROS_WARN("[MotionPlanningServer], failed to apply the thread options of the [%s] thread pool",
+             thread_pool->Name().c_str());
+  }
+
+  // the planners read the shared config in their constructors, so they are all built before any of them runs
+  std::vector<std::unique_ptr<ros::CallbackQueue>> callback_queues;
+  std::vector<std::unique_ptr<planning::MotionPlanner>> motion_planners;
+  for (const auto &role_name : role_names) {
+    callback_queues.push_back(std::make_unique<ros::CallbackQueue>());
+    ros::NodeHandle ego_nh("", EgoRemappings(role_name));
+    ego_nh.setCallbackQueue(callback_queues.back().get());
+    motion_planners.push_back(
+        std::make_unique<planning::MotionPlanner>(ego_nh, callback_queues.back().get(), thread_pool));
+    ROS_INFO("[MotionPlanningServer], planner of [%s] created", role_name.c_str());
+  }
+
+  const double cycle_time = 1.0 / std::max(1.0, config.loop_rate());
+  std::vector<std::thread> planning_threads;
+  for (size_t i = 0; i < motion_planners.size(); ++i) {
+    const auto phase = std::chrono::duration<double>(cycle_time * static_cast<double>(i)
+                                                         / static_cast<double>(motion_planners.size()));
+    planning_threads.emplace_back([phase, &motion_planners, i]() {
+      std::this_thread::sleep_for(phase);
+      motion_planners[i]->Launch();
+    });
+  }
+
+  ros::waitForShutdown();
+  for (auto &motion_planner : motion_planners) {
+    motion_planner->Stop();
+  }
+  for (auto &planning_thread : planning_threads) {
+    if (planning_thread.joinable()) {
+      planning_thread.join();
+    }
+  }
+  const auto statistics = thread_pool->GetStatistics();
+  ROS_INFO("[MotionPlanningServer], [%s] thread pool, tasks: %lu, max queue depth: %d, mean latency: %lf s, "
+           "max latency: %lf s", thread_pool->Name().c_str(), static_cast<unsigned long>(statistics.num_tasks),
+           statistics.max_queue_depth, statistics.mean_latency, statistics.max_latency);
+  return 0;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <vehicle_state/vehicle_params.hpp>
 #include "planning_config.hpp"
 
@@ -9,8 +11,13 @@ PlanningConfig &PlanningConfig::Instance() {
 }
 
 void PlanningConfig::UpdateParams(const ros::NodeHandle &nh) {
+  std::lock_guard<std::mutex> lock(mutex_);
   nh.param<std::string>("/motion_planner/planner_type", planner_type_, "frenet_lattice");
   nh.param<double>("/motion_planner/loop_rate", planning_loop_rate_, 8.0);
+  nh.param<bool>("/motion_planner/lock_step", lock_step_, false);
+  nh.param<double>("/motion_planner/lock_step_timeout", lock_step_timeout_, 0.5);
+  nh.param<bool>("/motion_planner/publish_compact_trajectory", publish_compact_trajectory_, false);
+  nh.param<int>("/motion_planner/compact_trajectory_keyframe_interval", compact_trajectory_keyframe_interval_, 10);
   nh.param<double>("/motion_planner/delta_t", delta_t_, 0.1);
   nh.param<double>("/motion_planner/reference_smoother_deviation_weight", reference_smoother_deviation_weight_, 5.5);
   nh.param<double>("/motion_planner/reference_smoother_curvature_weight", reference_smoother_curvature_weight_, 4.0);
@@ -18,6 +25,22 @@ void PlanningConfig::UpdateParams(const ros::NodeHandle &nh) {
   nh.param<double>("/motion_planner/reference_smoother_distance_weight", reference_smoother_distance_weight_, 6);
   nh.param<double>("/motion_planner/reference_smoother_max_curvature", reference_smoother_max_curvature_, 6);
   nh.param<double>("/motion_planner//reference_smoother_slack_weight", reference_smoother_slack_weight_, 5.0);
+  nh.param<double>("/motion_planner/reference_point_table_resolution", reference_point_table_resolution_, 0.1);
+  nh.param<bool>("/motion_planner/reference_smoother_incremental", reference_smoother_incremental_, false);
+  nh.param<int>("/motion_planner/reference_smoother_blend_points", reference_smoother_blend_points_, 10);
+  nh.param<std::string>("/motion_planner/reference_smoother_backend", reference_smoother_backend_, "ipopt");
+  nh.param<bool>("/motion_planner/reference_smoother_cached_tape", reference_smoother_cached_tape_, false);
+  nh.param<int>("/motion_planner/reference_smoother_segment_cache_size", reference_smoother_segment_cache_size_, 0);
+  nh.param<bool>("/motion_planner/reference_smoother_decimation", reference_smoother_decimation_, false);
+  nh.param<double>("/motion_planner/reference_smoother_decimation_min_spacing",
+                   reference_smoother_decimation_min_spacing_, 1.0);
+  nh.param<double>("/motion_planner/reference_smoother_decimation_max_spacing",
+                   reference_smoother_decimation_max_spacing_, 8.0);
+  nh.param<double>("/motion_planner/reference_smoother_decimation_max_deviation",
+                   reference_smoother_decimation_max_deviation_, 0.02);
+  nh.param<int>("/motion_planner/reference_smoother_thread_pool_size", reference_smoother_thread_pool_size_, 3);
+  nh.param<double>("/motion_planner/reference_smoother_timeout", reference_smoother_timeout_, 0.05);
+  nh.param<bool>("/motion_planner/reference_line_slide", reference_line_slide_, false);
   nh.param<int>("/motion_planner/spline_order", spline_order_, 3);
   nh.param<double>("/motion_planner/max_lookahead_time", max_lookahead_time_, 8.0);
   nh.param<double>("/motion_planner/min_lookahead_time", min_lookahead_time_, 1.0);
@@ -49,9 +72,11 @@ void PlanningConfig::UpdateParams(const ros::NodeHandle &nh) {
   nh.param<double>("/motion_planner/lattice_weight_lat_offset", lattice_weight_lat_offset_, 10.0);
   nh.param<double>("/motion_planner/lattice_weight_lat_jerk", lattice_weight_lat_jerk_, 1);
   nh.param<double>("/motion_planner/lattice_weight_centripetal_acc", lattice_weight_centripetal_acc_, 1.5);
+  nh.param<double>("/motion_planner/lattice_weight_clearance", lattice_weight_clearance_, 0.0);
   nh.param<double>("/motion_planner/max_replan_lat_distance_threshold", max_replan_lat_distance_threshold_, 0.5);
   nh.param<double>("/motion_planner/max_replan_lon_distance_threshold", max_replan_lon_distance_threshold_, 2.5);
   nh.param<int>("/motion_planner/preserve_history_trajectory_point_num", preserve_history_trajectory_point_num_, 15);
+  nh.param<int>("/motion_planner/stitching_position_match_window", stitching_position_match_window_, 20);
   nh.param<std::string> ("/motion_planner/behaviour_planner_type", behaviour_planner_type_, "mpdm");
   nh.param<double>("/motion_planner/sim_horizon", sim_horizon_, 10.0);
   nh.param<double>("/motion_planner/sim_step", sim_step_, 0.25);
@@ -63,6 +88,74 @@ void PlanningConfig::UpdateParams(const ros::NodeHandle &nh) {
   nh.param<double>("/motion_planner/cutting_in_lateral_approach_ratio", cutting_in_lateral_approach_ratio_, 0.95);
   nh.param<double>("/motion_planner/sample_lat_threshold", sample_lat_threshold_, 6.0);
   nh.param<double>("/motion_planner/sample_min_lon_threshold", sample_min_lon_threshold_, 20.0);
+  nh.param<bool>("/motion_planner/parallel_planning_on_reference_lines", parallel_planning_on_reference_lines_, true);
+  nh.param<int>("/motion_planner/candidate_validation_batch_size", candidate_validation_batch_size_, 8);
+  nh.param<bool>("/motion_planner/eager_pair_evaluation", eager_pair_evaluation_, false);
+  nh.param<bool>("/motion_planner/gpu_pair_evaluation", gpu_pair_evaluation_, false);
+  nh.param<int>("/motion_planner/collision_check_swept_steps", collision_check_swept_steps_, 1);
+  nh.param<bool>("/motion_planner/collision_check_polygon_footprints", collision_check_polygon_footprints_, false);
+  nh.param<bool>("/motion_planner/collision_check_float_broad_phase", collision_check_float_broad_phase_, false);
+  nh.param<double>("/motion_planner/collision_check_float_guard_band", collision_check_float_guard_band_, 0.01);
+  nh.param<bool>("/motion_planner/incremental_footprint_update", incremental_footprint_update_, false);
+  nh.param<double>("/motion_planner/footprint_reuse_max_position_drift", footprint_reuse_max_position_drift_, 0.2);
+  nh.param<double>("/motion_planner/footprint_reuse_max_heading_drift", footprint_reuse_max_heading_drift_, 0.02);
+  nh.param<double>("/motion_planner/footprint_reuse_max_speed_drift", footprint_reuse_max_speed_drift_, 0.2);
+  nh.param<double>("/motion_planner/footprint_reuse_max_age", footprint_reuse_max_age_, 0.5);
+  nh.param<int>("/motion_planner/planner_thread_pool_size", planner_thread_pool_size_, 8);
+  nh.param<std::string>("/motion_planner/planner_thread_name", planner_thread_options_.name, "planner");
+  nh.param<std::vector<int>>("/motion_planner/planner_thread_cpus", planner_thread_options_.cpus,
+                             std::vector<int>());
+  nh.param<int>("/motion_planner/planner_thread_fifo_priority", planner_thread_options_.fifo_priority, 0);
+  nh.param<int>("/motion_planner/planner_thread_nice_level", planner_thread_options_.nice_level, 0);
+  nh.param<std::vector<std::string>>("/motion_planner/server_ego_role_names", server_ego_role_names_,
+                                     std::vector<std::string>{"ego_vehicle"});
+  nh.param<int>("/motion_planner/server_thread_pool_size", server_thread_pool_size_, 8);
+  nh.param<std::string>("/motion_planner/reference_generator_thread_name", reference_generator_thread_options_.name,
+                        "ref_generator");
+  nh.param<std::vector<int>>("/motion_planner/reference_generator_thread_cpus",
+                             reference_generator_thread_options_.cpus, std::vector<int>());
+  nh.param<int>("/motion_planner/reference_generator_thread_fifo_priority",
+                reference_generator_thread_options_.fifo_priority, 0);
+  nh.param<int>("/motion_planner/reference_generator_thread_nice_level",
+                reference_generator_thread_options_.nice_level, 0);
+  nh.param<int>("/motion_planner/executor_statistics_period", executor_statistics_period_, 0);
+  nh.param<double>("/motion_planner/reference_line_rebuild_margin", reference_line_rebuild_margin_, 5.0);
+  nh.param<double>("/motion_planner/route_prefetch_distance", route_prefetch_distance_, 0.0);
+  nh.param<double>("/motion_planner/visualization_rate", visualization_rate_, 5.0);
+  nh.param<int>("/motion_planner/stage_statistics_period", stage_statistics_period_, 40);
+  nh.param<double>("/motion_planner/planning_deadline_ratio", planning_deadline_ratio_, 0.8);
+  nh.param<bool>("/motion_planner/plan_reuse", plan_reuse_, false);
+  nh.param<double>("/motion_planner/plan_reuse_max_interval", plan_reuse_max_interval_, 1.0);
+  nh.param<double>("/motion_planner/plan_reuse_min_horizon", plan_reuse_min_horizon_, 4.0);
+  nh.param<int>("/motion_planner/lon_time_samples_num", lon_time_samples_num_, 9);
+  nh.param<int>("/motion_planner/lon_vel_samples_num", lon_vel_samples_num_, 9);
+  nh.param<double>("/motion_planner/lon_vel_sample_step", lon_vel_sample_step_, 0.3);
+  nh.param<bool>("/motion_planner/coarse_to_fine_sampling", coarse_to_fine_sampling_, false);
+  nh.param<int>("/motion_planner/coarse_lon_time_samples_num", coarse_lon_time_samples_num_, 5);
+  nh.param<int>("/motion_planner/coarse_lon_vel_samples_num", coarse_lon_vel_samples_num_, 4);
+  nh.param<double>("/motion_planner/lon_end_condition_s_resolution", lon_end_condition_s_resolution_, 0.5);
+  nh.param<double>("/motion_planner/lon_end_condition_v_resolution", lon_end_condition_v_resolution_, 0.2);
+  nh.param<double>("/motion_planner/lon_end_condition_t_resolution", lon_end_condition_t_resolution_, 0.1);
+  nh.param<std::string>("/motion_planner/lon_planner", lon_planner_, "sampling");
+  nh.param<double>("/motion_planner/speed_optimizer_dp_s_resolution", speed_optimizer_dp_s_resolution_, 1.0);
+  nh.param<double>("/motion_planner/speed_optimizer_dp_t_resolution", speed_optimizer_dp_t_resolution_, 1.0);
+  nh.param<std::string>("/motion_planner/lat_planner", lat_planner_, "sampling");
+  nh.param<double>("/motion_planner/lat_path_optimizer_length", lat_path_optimizer_length_, 40.0);
+  nh.param<double>("/motion_planner/lat_path_optimizer_delta_s", lat_path_optimizer_delta_s_, 1.0);
+  nh.param<int>("/motion_planner/refined_cells_num", refined_cells_num_, 3);
+  nh.param<bool>("/motion_planner/warm_start_sampling", warm_start_sampling_, false);
+  nh.param<double>("/motion_planner/warm_start_cost_discount", warm_start_cost_discount_, 1.0);
+  nh.param<bool>("/motion_planner/fixed_horizon_kernel", fixed_horizon_kernel_, true);
+  nh.param<bool>("/motion_planner/non_uniform_time_grid", non_uniform_time_grid_, false);
+  nh.param<double>("/motion_planner/time_grid_dense_horizon", time_grid_dense_horizon_, 3.0);
+  nh.param<double>("/motion_planner/time_grid_sparse_delta_t", time_grid_sparse_delta_t_, 0.4);
+  nh.param<std::string>("/motion_planner/capture_directory", capture_directory_, "");
+  nh.param<double>("/motion_planner/capture_latency_threshold", capture_latency_threshold_, 0.0);
+  nh.param<bool>("/motion_planner/capture_emergency_stop", capture_emergency_stop_, true);
+  nh.param<int>("/motion_planner/capture_buffer_size", capture_buffer_size_, 8);
+  nh.param<int>("/motion_planner/planning_arena_block_size", planning_arena_block_size_, 262144);
+  nh.param<std::string>("/motion_planner/obstacle_prediction_model", obstacle_prediction_model_,
+                         "constant_velocity");
 }
 const std::string &PlanningConfig::planner_type() const { return planner_type_; }
 double PlanningConfig::max_lookahead_distance() const { return max_lookahead_distance_; }
@@ -124,12 +217,71 @@ double PlanningConfig::min_lon_acc() const { return min_lon_acc_; }
 double PlanningConfig::min_lon_velocity() const { return min_lon_velocity_; }
 double PlanningConfig::min_lon_jerk() const { return min_lon_jerk_; }
 double PlanningConfig::max_lon_jerk() const { return max_lon_jerk_; }
-const vehicle_state::VehicleParams &PlanningConfig::vehicle_params() const {
-  return vehicle_params_;
-}
-
-void PlanningConfig::set_vehicle_params(const vehicle_state::VehicleParams &vehicle_params) {
-  this->vehicle_params_ = vehicle_params;
+PlanningParams PlanningConfig::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PlanningParams params;
+  params.delta_t = delta_t_;
+  params.max_lookahead_time = max_lookahead_time_;
+  params.min_lookahead_time = min_lookahead_time_;
+  params.max_lookahead_distance = max_lookahead_distance_;
+  params.lon_safety_buffer = lon_safety_buffer_;
+  params.lat_safety_buffer = lat_safety_buffer_;
+  params.max_lon_velocity = max_lon_velocity_;
+  params.min_lon_velocity = min_lon_velocity_;
+  params.max_lon_acc = max_lon_acc_;
+  params.min_lon_acc = min_lon_acc_;
+  params.max_lon_jerk = max_lon_jerk_;
+  params.min_lon_jerk = min_lon_jerk_;
+  params.max_lat_acc = max_lat_acc_;
+  params.min_lat_acc = min_lat_acc_;
+  params.max_kappa = max_kappa_;
+  params.min_kappa = min_kappa_;
+  params.lattice_weight_opposite_side_offset = lattice_weight_opposite_side_offset_;
+  params.lattice_weight_same_side_offset = lattice_weight_same_side_offset_;
+  params.lattice_weight_dist_travelled = lattice_weight_dist_travelled_;
+  params.lattice_weight_target_speed = lattice_weight_target_speed_;
+  params.lattice_weight_collision = lattice_weight_collision_;
+  params.lattice_weight_lon_jerk = lattice_weight_lon_jerk_;
+  params.lattice_weight_lon_target = lattice_weight_lon_target_;
+  params.lattice_weight_lat_jerk = lattice_weight_lat_jerk_;
+  params.lattice_weight_lat_offset = lattice_weight_lat_offset_;
+  params.lattice_weight_centripetal_acc = lattice_weight_centripetal_acc_;
+  params.lattice_weight_clearance = lattice_weight_clearance_;
+  params.eager_pair_evaluation = eager_pair_evaluation_;
+  params.gpu_pair_evaluation = gpu_pair_evaluation_;
+  params.lon_time_samples_num = lon_time_samples_num_;
+  params.lon_vel_samples_num = lon_vel_samples_num_;
+  params.lon_vel_sample_step = lon_vel_sample_step_;
+  params.coarse_lon_time_samples_num = coarse_lon_time_samples_num_;
+  params.coarse_lon_vel_samples_num = coarse_lon_vel_samples_num_;
+  params.lon_end_condition_s_resolution = lon_end_condition_s_resolution_;
+  params.lon_end_condition_v_resolution = lon_end_condition_v_resolution_;
+  params.lon_end_condition_t_resolution = lon_end_condition_t_resolution_;
+  params.speed_optimizer_dp_s_resolution = speed_optimizer_dp_s_resolution_;
+  params.speed_optimizer_dp_t_resolution = speed_optimizer_dp_t_resolution_;
+  params.lat_path_optimizer_length = lat_path_optimizer_length_;
+  params.lat_path_optimizer_delta_s = lat_path_optimizer_delta_s_;
+  // counted from the ratio, not by accumulating delta_t, the tolerance keeps an exact multiple out of the grid
+  params.num_time_steps = delta_t_ > 0.0 && max_lookahead_time_ > 0.0 ?
+                          static_cast<size_t>(std::ceil(max_lookahead_time_ / delta_t_ - 1e-6)) : 0;
+  params.fixed_horizon_kernel = fixed_horizon_kernel_;
+  if (non_uniform_time_grid_ && time_grid_sparse_delta_t_ > delta_t_ && delta_t_ > 0.0) {
+    // delta_t apart up to the dense horizon, counted from the ratio like num_time_steps, then the sparse step
+    const auto num_dense_steps = static_cast<size_t>(
+        std::ceil(std::min(time_grid_dense_horizon_, max_lookahead_time_) / delta_t_ - 1e-6));
+    for (size_t i = 0; i < num_dense_steps; ++i) {
+      params.sample_times.push_back(static_cast<double>(i) * delta_t_);
+    }
+    const double sparse_start = static_cast<double>(num_dense_steps) * delta_t_;
+    for (size_t i = 0; sparse_start + static_cast<double>(i) * time_grid_sparse_delta_t_
+        < max_lookahead_time_ - 1e-6; ++i) {
+      params.sample_times.push_back(sparse_start + static_cast<double>(i) * time_grid_sparse_delta_t_);
+    }
+    params.num_sample_steps = params.sample_times.size();
+    // the end of the horizon is on the grid, as it is on the uniform one
+    params.sample_times.push_back(max_lookahead_time_);
+  }
+  return params;
 }
 
 double PlanningConfig::max_replan_lat_distance_threshold() const {
@@ -139,6 +291,7 @@ double PlanningConfig::max_replan_lon_distance_threshold() const {
   return max_replan_lon_distance_threshold_;
 }
 int PlanningConfig::preserve_history_trajectory_point_num() const { return preserve_history_trajectory_point_num_; }
+int PlanningConfig::stitching_position_match_window() const { return stitching_position_match_window_; }
 double PlanningConfig::lattice_weight_centripetal_acc() const {
   return lattice_weight_centripetal_acc_;
 }
@@ -1,5 +1,7 @@
 #ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_INCLUDE_PLANNING_CONFIG_HPP_
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_INCLUDE_PLANNING_CONFIG_HPP_
+#include <mutex>
+#include <vector>
 #include <ros/ros.h>
 #include "vehicle_state/vehicle_params.hpp"
 #include <carla_msgs/CarlaEgoVehicleInfo.h>
@@ -10,32 +12,112 @@
 #include "planning_msgs/LateralBehaviour.h"
 #include "planning_msgs/LongitudinalBehaviour.h"
 #include "obstacle_manager/obstacle.hpp"
+#include "thread_pool/thread_options.hpp"
 
 #define DEBUG false
 namespace planning {
 
 struct PlanningTarget {
   double desired_vel{};
-  ReferenceLine ref_lane{};
+  // shared by the st graph, samplers, evaluator and collision checker planning on it, never modified
+  std::shared_ptr<const ReferenceLine> ref_lane;
   bool is_best_behaviour = false;
   bool has_stop_point = false;
   double stop_s{};
 };
 
+/**
+ * @brief: a value copy of the parameters the lattice planner reads in its loops, taken once per planning cycle, so
+ * the loops read plain members, every stage and thread of a cycle sees the same values and an update of the
+ * config only takes effect at the next cycle
+ */
+struct PlanningParams {
+  double delta_t{};
+  double max_lookahead_time{};
+  double min_lookahead_time{};
+  double max_lookahead_distance{};
+  double lon_safety_buffer{};
+  double lat_safety_buffer{};
+  double max_lon_velocity{};
+  double min_lon_velocity{};
+  double max_lon_acc{};
+  double min_lon_acc{};
+  double max_lon_jerk{};
+  double min_lon_jerk{};
+  double max_lat_acc{};
+  double min_lat_acc{};
+  double max_kappa{};
+  double min_kappa{};
+  double lattice_weight_opposite_side_offset{};
+  double lattice_weight_same_side_offset{};
+  double lattice_weight_dist_travelled{};
+  double lattice_weight_target_speed{};
+  double lattice_weight_collision{};
+  double lattice_weight_lon_jerk{};
+  double lattice_weight_lon_target{};
+  double lattice_weight_lat_jerk{};
+  double lattice_weight_lat_offset{};
+  double lattice_weight_centripetal_acc{};
+  double lattice_weight_clearance{};
+  bool eager_pair_evaluation = false;
+  bool gpu_pair_evaluation = false;
+  int lon_time_samples_num{};
+  int lon_vel_samples_num{};
+  double lon_vel_sample_step{};
+  int coarse_lon_time_samples_num{};
+  int coarse_lon_vel_samples_num{};
+  double lon_end_condition_s_resolution{};
+  double lon_end_condition_v_resolution{};
+  double lon_end_condition_t_resolution{};
+  double speed_optimizer_dp_s_resolution{};
+  double speed_optimizer_dp_t_resolution{};
+  double lat_path_optimizer_length{};
+  double lat_path_optimizer_delta_s{};
+  // the points i * delta_t of the time grid before max_lookahead_time
+  size_t num_time_steps{};
+  bool fixed_horizon_kernel = false;
+  // the times the candidates are evaluated and checked at if the time grid is not uniform, delta_t apart up to
+  // the dense horizon and sparser beyond, up to max_lookahead_time inclusive. empty on the uniform grid
+  std::vector<double> sample_times;
+  // the sample_times before max_lookahead_time, the points of a candidate
+  size_t num_sample_steps{};
+  // not part of the shared config, the planner of each ego fills in its own
+  vehicle_state::VehicleParams vehicle_params{};
+};
+
 class PlanningConfig {
  public:
   static PlanningConfig &Instance();
   void UpdateParams(const ros::NodeHandle &nh);
+  /**
+   * @brief: the parameters of a planning cycle, consistent with respect to a concurrent UpdateParams
+   */
+  PlanningParams Snapshot() const;
   const std::string &planner_type() const;
   double loop_rate() const;
+  bool lock_step() const { return lock_step_; }
+  double lock_step_timeout() const { return lock_step_timeout_; }
+  bool publish_compact_trajectory() const { return publish_compact_trajectory_; }
+  int compact_trajectory_keyframe_interval() const { return compact_trajectory_keyframe_interval_; }
   double delta_t() const;
-  void set_vehicle_params(const vehicle_state::VehicleParams &vehicle_params);
-  const vehicle_state::VehicleParams &vehicle_params() const;
   double reference_smoother_distance_weight() const;
   double reference_smoother_deviation_weight() const;
   double reference_smoother_heading_weight() const;
   double reference_smoother_max_curvature() const;
   double reference_smoother_slack_weight() const { return reference_smoother_slack_weight_; }
+  double reference_point_table_resolution() const { return reference_point_table_resolution_; }
+  bool reference_smoother_incremental() const { return reference_smoother_incremental_; }
+  int reference_smoother_blend_points() const { return reference_smoother_blend_points_; }
+  const std::string &reference_smoother_backend() const { return reference_smoother_backend_; }
+  bool reference_smoother_cached_tape() const { return reference_smoother_cached_tape_; }
+  int reference_smoother_segment_cache_size() const { return reference_smoother_segment_cache_size_; }
+  bool reference_smoother_decimation() const { return reference_smoother_decimation_; }
+  double reference_smoother_decimation_min_spacing() const { return reference_smoother_decimation_min_spacing_; }
+  double reference_smoother_decimation_max_spacing() const { return reference_smoother_decimation_max_spacing_; }
+  double reference_smoother_decimation_max_deviation() const { return reference_smoother_decimation_max_deviation_; }
+  int reference_smoother_thread_pool_size() const { return reference_smoother_thread_pool_size_; }
+  double reference_smoother_timeout() const { return reference_smoother_timeout_; }
+  bool reference_line_slide() const { return reference_line_slide_; }
   const std::string &behaviour_planner_type() const { return behaviour_planner_type_; }
   double desired_velocity() const { return desired_velocity_; }
   double sim_horizon() const { return sim_horizon_; }
@@ -48,6 +130,63 @@ class PlanningConfig {
   double cutting_in_lateral_approach_ratio() const { return cutting_in_lateral_approach_ratio_; }
   double sample_lat_threshold() const { return sample_lat_threshold_; }
   double sample_min_lon_threshold() const { return sample_min_lon_threshold_; }
+  bool parallel_planning_on_reference_lines() const { return parallel_planning_on_reference_lines_; }
+  int candidate_validation_batch_size() const { return candidate_validation_batch_size_; }
+  bool eager_pair_evaluation() const { return eager_pair_evaluation_; }
+  bool gpu_pair_evaluation() const { return gpu_pair_evaluation_; }
+  int collision_check_swept_steps() const { return collision_check_swept_steps_; }
+  bool collision_check_polygon_footprints() const { return collision_check_polygon_footprints_; }
+  bool collision_check_float_broad_phase() const { return collision_check_float_broad_phase_; }
+  double collision_check_float_guard_band() const { return collision_check_float_guard_band_; }
+  bool incremental_footprint_update() const { return incremental_footprint_update_; }
+  double footprint_reuse_max_position_drift() const { return footprint_reuse_max_position_drift_; }
+  double footprint_reuse_max_heading_drift() const { return footprint_reuse_max_heading_drift_; }
+  double footprint_reuse_max_speed_drift() const { return footprint_reuse_max_speed_drift_; }
+  double footprint_reuse_max_age() const { return footprint_reuse_max_age_; }
+  int planner_thread_pool_size() const { return planner_thread_pool_size_; }
+  const common::ThreadOptions &planner_thread_options() const { return planner_thread_options_; }
+  const std::vector<std::string> &server_ego_role_names() const { return server_ego_role_names_; }
+  int server_thread_pool_size() const { return server_thread_pool_size_; }
+  const common::ThreadOptions &reference_generator_thread_options() const {
+    return reference_generator_thread_options_;
+  }
+  int executor_statistics_period() const { return executor_statistics_period_; }
+  double reference_line_rebuild_margin() const { return reference_line_rebuild_margin_; }
+  double route_prefetch_distance() const { return route_prefetch_distance_; }
+  double visualization_rate() const { return visualization_rate_; }
+  int stage_statistics_period() const { return stage_statistics_period_; }
+  double planning_deadline_ratio() const { return planning_deadline_ratio_; }
+  bool plan_reuse() const { return plan_reuse_; }
+  double plan_reuse_max_interval() const { return plan_reuse_max_interval_; }
+  double plan_reuse_min_horizon() const { return plan_reuse_min_horizon_; }
+  int lon_time_samples_num() const { return lon_time_samples_num_; }
+  int lon_vel_samples_num() const { return lon_vel_samples_num_; }
+  double lon_vel_sample_step() const { return lon_vel_sample_step_; }
+  bool coarse_to_fine_sampling() const { return coarse_to_fine_sampling_; }
+  int coarse_lon_time_samples_num() const { return coarse_lon_time_samples_num_; }
+  int coarse_lon_vel_samples_num() const { return coarse_lon_vel_samples_num_; }
+  double lon_end_condition_s_resolution() const { return lon_end_condition_s_resolution_; }
+  double lon_end_condition_v_resolution() const { return lon_end_condition_v_resolution_; }
+  double lon_end_condition_t_resolution() const { return lon_end_condition_t_resolution_; }
+  const std::string &lon_planner() const { return lon_planner_; }
+  double speed_optimizer_dp_s_resolution() const { return speed_optimizer_dp_s_resolution_; }
+  double speed_optimizer_dp_t_resolution() const { return speed_optimizer_dp_t_resolution_; }
+  const std::string &lat_planner() const { return lat_planner_; }
+  double lat_path_optimizer_length() const { return lat_path_optimizer_length_; }
+  double lat_path_optimizer_delta_s() const { return lat_path_optimizer_delta_s_; }
+  int refined_cells_num() const { return refined_cells_num_; }
+  bool warm_start_sampling() const { return warm_start_sampling_; }
+  double warm_start_cost_discount() const { return warm_start_cost_discount_; }
+  bool fixed_horizon_kernel() const { return fixed_horizon_kernel_; }
+  bool non_uniform_time_grid() const { return non_uniform_time_grid_; }
+  double time_grid_dense_horizon() const { return time_grid_dense_horizon_; }
+  double time_grid_sparse_delta_t() const { return time_grid_sparse_delta_t_; }
+  const std::string &capture_directory() const { return capture_directory_; }
+  double capture_latency_threshold() const { return capture_latency_threshold_; }
+  bool capture_emergency_stop() const { return capture_emergency_stop_; }
+  int capture_buffer_size() const { return capture_buffer_size_; }
+  int planning_arena_block_size() const { return planning_arena_block_size_; }
+  const std::string &obstacle_prediction_model() const { return obstacle_prediction_model_; }
 
   double max_lon_acc() const;
   double min_lon_acc() const;
@@ -77,13 +216,20 @@ class PlanningConfig {
   double max_replan_lon_distance_threshold() const;
   double max_replan_lat_distance_threshold() const;
   int preserve_history_trajectory_point_num() const;
+  int stitching_position_match_window() const;
 
   double lattice_weight_centripetal_acc() const;
+  double lattice_weight_clearance() const { return lattice_weight_clearance_; }
  private:
-  vehicle_state::VehicleParams vehicle_params_{};
   std::string planner_type_;
   double planning_loop_rate_{};
-  double delta_t_{}; // the trajectory delta time
+  // one cycle per tick of the simulator clock instead of at the loop rate, the loop rate then has to be the tick rate
+  bool lock_step_ = false;
+  double lock_step_timeout_ = 0.5; // the wall time a tick waits for the objects of the tick, in s
+  // the trajectory in float32 with the stitched points as a reference, for the remote controllers and the recording
+  bool publish_compact_trajectory_ = false;
+  int compact_trajectory_keyframe_interval_ = 10; // every so many compact trajectories are sent whole
+  double delta_t_ = 0.1; // the trajectory delta time
   double max_lookahead_distance_{}; // the max lookahead distance for ego vehicle
   double max_lookahead_time_ = 8.0; // max lookahead time
   double min_lookahead_time_ = 1.0;
@@ -95,6 +241,19 @@ class PlanningConfig {
   double reference_smoother_heading_weight_ = 50.0;
   double reference_smoother_max_curvature_ = 100;
   double reference_smoother_slack_weight_{5.0};
+  double reference_point_table_resolution_{0.1};
+  bool reference_smoother_incremental_{false}; // only optimize the new tail and a blend region of the main lane
+  int reference_smoother_blend_points_{10}; // the overlapping points re-optimized in the incremental smoothing
+  std::string reference_smoother_backend_{"ipopt"}; // "ipopt" or "qp", the sequential QP of the same problem
+  bool reference_smoother_cached_tape_{false}; // record the ipopt problem once per window size instead of every call
+  int reference_smoother_segment_cache_size_{0}; // the smoothed way points reused across the builds, 0 disables it
+  bool reference_smoother_decimation_{false}; // smooth the way points kept for the curvature, resample the others
+  double reference_smoother_decimation_min_spacing_{1.0}; // the spacing of the kept way points in the sharp curves
+  double reference_smoother_decimation_max_spacing_{8.0}; // the spacing of the kept way points on the straights
+  double reference_smoother_decimation_max_deviation_{0.02}; // the largest distance of a chord from the lane
+  int reference_smoother_thread_pool_size_{3}; // the workers smoothing the candidate lanes concurrently
+  double reference_smoother_timeout_{0.05}; // seconds, a lane smoothed later keeps its raw spline
+  bool reference_line_slide_{false}; // refit the splines of the last reference lines instead of building new ones
   int spline_order_ = 3;
   double max_lon_acc_ = 1.0;
   double min_lon_acc_{};
@@ -118,9 +277,12 @@ class PlanningConfig {
   double lattice_weight_lat_jerk_{};
   double lattice_weight_lat_offset_{};
   double lattice_weight_centripetal_acc_{};
+  // the cost of the candidates passing close to the inflated footprints, 0 leaves the clearance unevaluated
+  double lattice_weight_clearance_{};
   double max_replan_lat_distance_threshold_{};
   double max_replan_lon_distance_threshold_{};
   int preserve_history_trajectory_point_num_{};
+  int stitching_position_match_window_{};  // the history points searched around the time matched one
   std::string behaviour_planner_type_{};
   double sim_horizon_{};
   double sim_step_{};
@@ -132,6 +294,68 @@ class PlanningConfig {
   double cutting_in_lateral_approach_ratio_{};
   double sample_lat_threshold_{};
   double sample_min_lon_threshold_{};
+  bool parallel_planning_on_reference_lines_ = true; // plan every target concurrently on the thread pool
+  int candidate_validation_batch_size_ = 8; // candidates validated concurrently when PlanningOnRef owns the thread pool
+  bool eager_pair_evaluation_ = false; // evaluate all trajectory pairs up front in parallel instead of lazily
+  bool gpu_pair_evaluation_ = false; // evaluate all trajectory pairs up front on the gpu, on the cpu without CUDA
+  int collision_check_swept_steps_ = 1; // > 1 checks the boxes swept over this many time steps instead of every step
+  bool collision_check_polygon_footprints_ = false; // cut the buffer corners of the inflated obstacle footprints
+  bool collision_check_float_broad_phase_ = false; // test the boxes in float32 first, the close calls in double
+  double collision_check_float_guard_band_ = 0.01; // the margin of the float32 test left to the double one
+  bool incremental_footprint_update_ = false; // time-shift last cycle's footprints of the barely moved obstacles
+  double footprint_reuse_max_position_drift_ = 0.2;
+  double footprint_reuse_max_heading_drift_ = 0.02;
+  double footprint_reuse_max_speed_drift_ = 0.2;
+  double footprint_reuse_max_age_ = 0.5;
+  int planner_thread_pool_size_ = 8;
+  common::ThreadOptions planner_thread_options_; // pinning and priority of the planner thread pool workers
+  // the egos of the planning server, one planner each, and the size of the thread pool they share
+  std::vector<std::string> server_ego_role_names_{"ego_vehicle"};
+  int server_thread_pool_size_ = 8;
+  common::ThreadOptions reference_generator_thread_options_;
+  int executor_statistics_period_ = 0; // log the thread pool statistics every this many cycles, 0 disables them
+  double reference_line_rebuild_margin_ = 5.0; // the ego travel along the reference line that triggers a rebuild
+  double route_prefetch_distance_ = 0.0; // request a route extension once the route ahead is shorter, 0 disables it
+  double visualization_rate_ = 5.0; // the markers are published at most this often, 0 disables them
+  int stage_statistics_period_ = 40; // publish the stage latencies every this many cycles, 0 disables the timers
+  double planning_deadline_ratio_ = 0.8; // the share of the cycle time the planning may take, 0 disables the deadline
+  bool plan_reuse_ = false; // keep the last trajectory while it stays valid instead of planning every cycle
+  double plan_reuse_max_interval_ = 1.0; // a new trajectory is planned at least this often
+  double plan_reuse_min_horizon_ = 4.0; // the time the kept trajectory must still cover
+  int lon_time_samples_num_ = 9; // the time samples of the cruising and stopping end conditions
+  int lon_vel_samples_num_ = 9; // at most this many velocities per time sample of the cruising end conditions
+  double lon_vel_sample_step_ = 0.3; // the smallest gap between the sampled cruising velocities
+  bool coarse_to_fine_sampling_ = false; // refine the cruising end conditions around the best cells of a coarse grid
+  int coarse_lon_time_samples_num_ = 5;
+  int coarse_lon_vel_samples_num_ = 4;
+  // the end conditions of the st graph falling into the same cell of this grid are one, a resolution of 0 keeps all
+  double lon_end_condition_s_resolution_ = 0.5;
+  double lon_end_condition_v_resolution_ = 0.2;
+  double lon_end_condition_t_resolution_ = 0.1;
+  // "sampling" or "speed_optimizer", the dp and QP speed profile falling back to sampling if it fails
+  std::string lon_planner_{"sampling"};
+  double speed_optimizer_dp_s_resolution_ = 1.0;
+  double speed_optimizer_dp_t_resolution_ = 1.0;
+  // "sampling" or "path_optimizer", the piecewise jerk lat path falling back to sampling if it fails
+  std::string lat_planner_{"sampling"};
+  double lat_path_optimizer_length_ = 40.0;
+  double lat_path_optimizer_delta_s_ = 1.0;
+  int refined_cells_num_ = 3; // the number of best coarse cells refined
+  bool warm_start_sampling_ = false; // sample around the time-shifted end conditions of the last optimal trajectory
+  double warm_start_cost_discount_ = 1.0; // taken off the cost of a pair of seeded trajectories
+  bool fixed_horizon_kernel_ = true; // use the fixed-count cost loops when the time grid matches their horizon
+  // evaluate and check the candidates on delta_t up to the dense horizon and on the sparse step beyond
+  bool non_uniform_time_grid_ = false;
+  double time_grid_dense_horizon_ = 3.0; // in s
+  double time_grid_sparse_delta_t_ = 0.4; // in s, the grid is uniform unless it is above delta_t
+  std::string capture_directory_; // where the captured cycles are written, empty to capture nothing
+  double capture_latency_threshold_ = 0.0; // capture the cycles slower than this, in s, <= 0 for none
+  bool capture_emergency_stop_ = true; // capture the cycles ending in an emergency stop
+  int capture_buffer_size_ = 8; // the captures waiting to be written, the newest ones are dropped beyond it
+  int planning_arena_block_size_ = 262144; // bytes, the arena of the temporaries of a target, 0 allocates on the heap
+  // "constant_velocity", "constant_turn_rate" or "lane_following" along the reference lines of the targets
+  std::string obstacle_prediction_model_{"constant_velocity"};
+  mutable std::mutex mutex_; // UpdateParams against Snapshot
 
  private:
   PlanningConfig() = default;
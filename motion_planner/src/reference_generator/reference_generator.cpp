@@ -1,5 +1,6 @@
 #include "reference_generator.hpp"
 #include "planning_config.hpp"
+#include "profiler/trace_recorder.hpp"
 namespace planning {
 /********************************** ReferenceGenerator ******************************/
 ReferenceGenerator::ReferenceGenerator(const ReferenceLineConfig &config,
@@ -7,8 +8,26 @@ ReferenceGenerator::ReferenceGenerator(const ReferenceLineConfig &config,
                                        double lookback_distance)
     : smooth_config_(config),
       lookahead_distance_(lookahead_distance),
-      lookback_distance_(lookback_distance),
-      reference_line_history_(boost::circular_buffer<std::vector<ReferenceLine>>(3)) {
+      lookback_distance_(lookback_distance) {
+  for (auto &smoother : lane_smoothers_) {
+    smoother = std::make_shared<ReferenceLineSmoother>();
+    smoother->SetIncrementalParams(smooth_config_.reference_smooth_incremental_,
+                                   smooth_config_.reference_smooth_blend_points_);
+    smoother->SetBackend(smooth_config_.reference_smooth_backend_);
+    smoother->SetCachedTape(smooth_config_.reference_smooth_cached_tape_);
+  }
+  if (smooth_config_.reference_smooth_segment_cache_size_ > 0) {
+    segment_cache_ = std::make_shared<ReferenceLineSegmentCache>(smooth_config_.reference_smooth_segment_cache_size_);
+  }
+  if (smooth_config_.reference_smooth_decimation_) {
+    way_point_decimator_ = std::make_shared<const WayPointDecimator>(
+        smooth_config_.reference_smooth_decimation_min_spacing_, smooth_config_.reference_smooth_decimation_max_spacing_,
+        smooth_config_.reference_smooth_decimation_max_deviation_);
+  }
+  auto thread_options = PlanningConfig::Instance().reference_generator_thread_options();
+  thread_options.name = thread_options.name.empty() ? "ref_smoother" : thread_options.name + "_smoother";
+  lane_thread_pool_ = std::make_unique<common::ThreadPool>(
+      std::max(1, smooth_config_.reference_smooth_thread_pool_size_), thread_options, false);
   is_initialized_ = true;
 }
 
@@ -33,116 +52,164 @@ bool ReferenceGenerator::CreateReferenceLines(bool smooth, std::vector<Reference
   }
 
   RouteInfo route_info;
+  uint64_t route_version = 0;
   {
     std::lock_guard<std::mutex> lock_guard(route_mutex_);
     route_info = route_info_;
+    route_version = route_version_;
   }
+  UpdateRemainingRouteLength(route_info.main_lane, vehicle_state, route_version);
 
-  auto main_ref_lane = ReferenceLine();
-  auto result = ReferenceGenerator::RetriveReferenceLine(
-      main_ref_lane, vehicle_state,
+  // the unsmoothed candidates are cheap, and what a lane falls back to if its smoothing misses the deadline
+  std::array<ReferenceLine, kNumLaneSlots> candidates;
+  std::array<bool, kNumLaneSlots> has_candidates{};
+  has_candidates[kMainLane] = ReferenceGenerator::RetriveReferenceLine(
+      candidates[kMainLane], vehicle_state,
       route_info.main_lane,
       lookahead_distance_,
       lookback_distance_,
-      smooth, smooth_config_);
-  if (!result) {
+      false, smooth_config_, nullptr, PreviousReferenceLine(kMainLane));
+  if (!has_candidates[kMainLane]) {
     return false;
   }
-  ref_lanes.emplace_back(main_ref_lane);
-//
-//  double const kDefaultLaneWidth = 3.5;
-//  common::SLPoint sl_point;
-//  if (!main_ref_lane.XYToSL(vehicle_state.x, vehicle_state.y, &sl_point)) {
-//    return false;
-//  }
-//  auto tmp_sl = sl_point;
-//  tmp_sl.l = kDefaultLaneWidth;
-//  Eigen::Vector2d left_xy;
-//  if (!main_ref_lane.SLToXY(tmp_sl, &left_xy)) {
-//    return false;
-//  }
-//  common::SLPoint left_sl;
-//  for (const auto &lane : route_info.left_lanes) {
-//    auto left_ref_lane = ReferenceLine(lane);
-//    if (!left_ref_lane.XYToSL(left_xy, &left_sl)) {
-//      continue;
-//    }
-//    if (!left_ref_lane.IsOnLane(left_sl)) {
-//      continue;
-//    }
-//    auto left_ref = left_ref_lane.GetReferencePoint(left_sl.s);
-//    if (std::fabs(common::MathUtils::CalcAngleDist(left_ref.theta(), vehicle_state.theta)) > 0.25 * M_PI) {
-//      continue;
-//    } else {
-//      ReferenceGenerator::RetriveReferenceLine(left_ref_lane,
-//                                               vehicle_state,
-//                                               lane,
-//                                               lookahead_distance_,
-//                                               lookback_distance_,
-//                                               smooth,
-//                                               smooth_config_);
-//      ref_lanes.emplace_back(left_ref_lane);
-//      break;
-//    }
-//  }
-//  tmp_sl.l = -kDefaultLaneWidth;
-//  Eigen::Vector2d right_xy;
-//  if (!main_ref_lane.SLToXY(tmp_sl, &right_xy)) {
-//    return false;
-//  }
-//
-//  common::SLPoint right_sl;
-//  for (const auto &lane : route_info.right_lanes) {
-//    auto right_ref_lane = ReferenceLine(lane);
-//    if (!right_ref_lane.XYToSL(right_xy, &right_sl)) {
-//      continue;
-//    }
-//    if (!right_ref_lane.IsOnLane(right_sl)) {
-//      continue;
-//    }
-//    auto right_ref = right_ref_lane.GetReferencePoint(right_sl.s);
-//    if (std::fabs(common::MathUtils::CalcAngleDist(right_ref.theta(), vehicle_state.theta)) > 0.25 * M_PI) {
-//      continue;
-//    } else {
-//      ReferenceGenerator::RetriveReferenceLine(right_ref_lane,
-//                                               vehicle_state,
-//                                               lane,
-//                                               lookahead_distance_,
-//                                               lookback_distance_,
-//                                               smooth,
-//                                               smooth_config_);
-//      ref_lanes.emplace_back(right_ref_lane);
-//      break;
-//    }
-//  }
+  double const kDefaultLaneWidth = 3.5;
+  has_candidates[kLeftLane] = SelectNeighbourLane(candidates[kMainLane], vehicle_state, route_info.left_lanes,
+                                                  kDefaultLaneWidth, PreviousReferenceLine(kLeftLane),
+                                                  &candidates[kLeftLane]);
+  has_candidates[kRightLane] = SelectNeighbourLane(candidates[kMainLane], vehicle_state, route_info.right_lanes,
+                                                   -kDefaultLaneWidth, PreviousReferenceLine(kRightLane),
+                                                   &candidates[kRightLane]);
+  if (smooth) {
+    SmoothCandidateLanes(has_candidates, &candidates);
+  }
+  if (smooth_config_.reference_line_slide_) {
+    last_candidates_ = candidates;
+    has_last_candidates_ = has_candidates;
+  }
+  for (size_t slot = 0; slot < kNumLaneSlots; ++slot) {
+    if (has_candidates[slot]) {
+      ref_lanes.emplace_back(candidates[slot]);
+    }
+  }
 
   auto end = ros::Time::now();
   ROS_WARN("CreateReferenceLine elapsed time is %lf s", (end - begin).toSec());
   return true;
 }
 
+bool ReferenceGenerator::SelectNeighbourLane(const ReferenceLine &main_ref_lane,
+                                             const vehicle_state::KinoDynamicState &vehicle_state,
+                                             const std::vector<std::vector<planning_msgs::WayPoint>> &lanes,
+                                             double lateral_offset,
+                                             const ReferenceLine *previous_ref_lane,
+                                             ReferenceLine *ref_lane) const {
+  if (lanes.empty()) {
+    return false;
+  }
+  common::SLPoint sl_point;
+  if (!main_ref_lane.XYToSL(vehicle_state.x, vehicle_state.y, &sl_point)) {
+    return false;
+  }
+  sl_point.l = lateral_offset;
+  Eigen::Vector2d neighbour_xy;
+  if (!main_ref_lane.SLToXY(sl_point, &neighbour_xy)) {
+    return false;
+  }
+  common::SLPoint neighbour_sl;
+  for (const auto &lane : lanes) {
+    if (lane.size() < 3) {
+      continue;
+    }
+    auto neighbour_ref_lane = ReferenceLine(lane);
+    if (!neighbour_ref_lane.XYToSL(neighbour_xy, &neighbour_sl) || !neighbour_ref_lane.IsOnLane(neighbour_sl)) {
+      continue;
+    }
+    auto neighbour_ref = neighbour_ref_lane.GetReferencePoint(neighbour_sl.s);
+    if (std::fabs(common::MathUtils::CalcAngleDist(neighbour_ref.theta(), vehicle_state.theta)) > 0.25 * M_PI) {
+      continue;
+    }
+    return ReferenceGenerator::RetriveReferenceLine(*ref_lane, vehicle_state, lane, lookahead_distance_,
+                                                    lookback_distance_, false, smooth_config_, nullptr,
+                                                    previous_ref_lane);
+  }
+  return false;
+}
+
+const ReferenceLine *ReferenceGenerator::PreviousReferenceLine(LaneSlot slot) const {
+  if (!smooth_config_.reference_line_slide_ || !has_last_candidates_[slot]) {
+    return nullptr;
+  }
+  return &last_candidates_[slot];
+}
+
+void ReferenceGenerator::SmoothCandidateLanes(const std::array<bool, kNumLaneSlots> &has_candidates,
+                                              std::array<ReferenceLine, kNumLaneSlots> *candidates) {
+  const auto deadline = std::chrono::steady_clock::now()
+      + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(smooth_config_.reference_smooth_timeout_));
+  for (size_t slot = 0; slot < kNumLaneSlots; ++slot) {
+    if (!has_candidates[slot]) {
+      continue;
+    }
+    auto &future = smoothing_futures_[slot];
+    if (future.valid()) {
+      // the smoother of the slot is still busy with a lane that missed its deadline
+      if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        continue;
+      }
+      future.get();
+    }
+    const auto smoother = lane_smoothers_[slot];
+    const bool reset_warm_start = warm_start_stale_[slot];
+    warm_start_stale_[slot] = false;
+    const ReferenceLineConfig config = smooth_config_;
+    future = lane_thread_pool_->PushTask([smoother, reset_warm_start, config, segment_cache = segment_cache_,
+                                             way_point_decimator = way_point_decimator_, ref_lane = (*candidates)[slot]]() mutable {
+      if (reset_warm_start) {
+        smoother->ResetWarmStart();
+      }
+      ref_lane.SetSmoother(smoother);
+      ref_lane.SetSegmentCache(segment_cache);
+      ref_lane.SetWayPointDecimator(way_point_decimator);
+      if (!ref_lane.Smooth(config.reference_smooth_deviation_weight_,
+                           config.reference_smooth_heading_weight_,
+                           config.reference_smooth_length_weight_,
+                           config.reference_smooth_slack_weight_,
+                           config.reference_smooth_max_curvature_)) {
+        ROS_WARN("Failed to Smooth Reference Line");
+      }
+      return ref_lane;
+    });
+  }
+  for (size_t slot = 0; slot < kNumLaneSlots; ++slot) {
+    auto &future = smoothing_futures_[slot];
+    if (!has_candidates[slot] || !future.valid()) {
+      continue;
+    }
+    if (future.wait_until(deadline) != std::future_status::ready) {
+      // keep the future, the next build skips the slot until the smoother is free again
+      ROS_WARN("[ReferenceGenerator::SmoothCandidateLanes], lane %zu missed the smoothing deadline, "
+               "falls back to the raw spline", slot);
+      continue;
+    }
+    (*candidates)[slot] = future.get();
+  }
+}
+
 bool ReferenceGenerator::RetriveReferenceLine(ReferenceLine &ref_lane,
                                               const vehicle_state::KinoDynamicState &vehicle_state,
                                               const std::vector<planning_msgs::WayPoint> &lane,
                                               double lookahead_distance,
                                               double lookback_distance,
                                               bool smooth,
-                                              const ReferenceLineConfig &smooth_config) {
+                                              const ReferenceLineConfig &smooth_config,
+                                              const std::shared_ptr<ReferenceLineSmoother> &smoother,
+                                              const ReferenceLine *previous_ref_lane) {
   auto dist_sqr = [](const planning_msgs::WayPoint &way_point, Eigen::Vector2d &xy) -> double {
     return (way_point.pose.position.x - xy.x()) * (way_point.pose.position.x - xy.x())
         + (way_point.pose.position.y - xy.y()) * (way_point.pose.position.y - xy.y());
   };
-  size_t index_min = 0;
-  Eigen::Vector2d xy{vehicle_state.x, vehicle_state.y};
-  double d_min = dist_sqr(lane[0], xy);
-  for (size_t i = 1; i < lane.size(); ++i) {
-    double d = dist_sqr(lane[i], xy);
-    double angle_diff = common::MathUtils::CalcAngleDist(tf::getYaw(lane[i].pose.orientation), vehicle_state.theta);
-    if (d < d_min && std::fabs(angle_diff) < 0.25 * M_PI) {
-      d_min = d;
-      index_min = i;
-    }
-  }
+  const size_t index_min = NearestWayPointIndex(lane, vehicle_state);
   std::vector<planning_msgs::WayPoint> sampled_way_points;
   double s = 0;
   size_t index = index_min > 0 ? index_min - 1 : index_min;;
@@ -165,7 +232,12 @@ bool ReferenceGenerator::RetriveReferenceLine(ReferenceLine &ref_lane,
     return false;
   }
 //  auto main_ref_lane = ReferenceLine(sampled_way_points);
-  ref_lane = ReferenceLine(sampled_way_points);
+  // a lane which is not the one of previous_ref_lane any more is built from scratch
+  ref_lane = previous_ref_lane != nullptr ? ReferenceLine(sampled_way_points, *previous_ref_lane)
+                                          : ReferenceLine(sampled_way_points);
+  if (smoother != nullptr) {
+    ref_lane.SetSmoother(smoother);
+  }
   if (smooth) {
     if (!ref_lane.Smooth(smooth_config.reference_smooth_deviation_weight_,
                          smooth_config.reference_smooth_heading_weight_,
@@ -175,6 +247,7 @@ bool ReferenceGenerator::RetriveReferenceLine(ReferenceLine &ref_lane,
       ROS_WARN("Failed to Smooth Reference Line");
     }
   }
+  ref_lane.BuildReferencePointTable(smooth_config.reference_point_table_resolution_);
 
   return true;
 }
@@ -223,14 +296,121 @@ bool ReferenceGenerator::HasOverLapWithRefLane(const ReferenceLine &ref_lane,
 }
 
 bool ReferenceGenerator::UpdateRouteResponse(const planning_srvs::RoutePlanServiceResponse &route_response) {
-  std::lock_guard<std::mutex> lock_guard(route_mutex_);
-  auto raw_ref_lane = route_response.route;
-  route_info_.main_lane = raw_ref_lane.way_points;
-
+  {
+    std::lock_guard<std::mutex> lock_guard(route_mutex_);
+    auto raw_ref_lane = route_response.route;
+    route_info_.main_lane = raw_ref_lane.way_points;
+    ++route_version_;
+    remaining_route_length_ = std::numeric_limits<double>::max();
+  }
   has_route_ = true;
+  NotifyUpdate(true);
+  return true;
+}
+
+size_t ReferenceGenerator::NearestWayPointIndex(const std::vector<planning_msgs::WayPoint> &lane,
+                                                const vehicle_state::KinoDynamicState &vehicle_state) {
+  auto dist_sqr = [&vehicle_state](const planning_msgs::WayPoint &way_point) -> double {
+    return (way_point.pose.position.x - vehicle_state.x) * (way_point.pose.position.x - vehicle_state.x)
+        + (way_point.pose.position.y - vehicle_state.y) * (way_point.pose.position.y - vehicle_state.y);
+  };
+  size_t index_min = 0;
+  double d_min = dist_sqr(lane[0]);
+  for (size_t i = 1; i < lane.size(); ++i) {
+    double d = dist_sqr(lane[i]);
+    double angle_diff = common::MathUtils::CalcAngleDist(tf::getYaw(lane[i].pose.orientation), vehicle_state.theta);
+    if (d < d_min && std::fabs(angle_diff) < 0.25 * M_PI) {
+      d_min = d;
+      index_min = i;
+    }
+  }
+  return index_min;
+}
+
+bool ReferenceGenerator::ExtendRoute(const planning_srvs::RoutePlanServiceResponse &route_response) {
+  const auto &extension = route_response.route.way_points;
+  auto dist = [](const planning_msgs::WayPoint &p1, const planning_msgs::WayPoint &p2) -> double {
+    return std::hypot(p1.pose.position.x - p2.pose.position.x, p1.pose.position.y - p2.pose.position.y);
+  };
+  constexpr double kMaxDistanceGap = 5.0;
+  vehicle_state::KinoDynamicState vehicle_state{};
+  {
+    std::lock_guard<std::mutex> lock_guard(vehicle_mutex_);
+    vehicle_state = vehicle_state_;
+  }
+  {
+    std::lock_guard<std::mutex> lock_guard(route_mutex_);
+    auto &main_lane = route_info_.main_lane;
+    if (main_lane.empty() || extension.empty()) {
+      return false;
+    }
+    // the extension starts from the beginning of the lane the route ends on, so it overlaps the route up to its end
+    const auto &route_end = main_lane.back();
+    const double route_end_heading = tf::getYaw(route_end.pose.orientation);
+    size_t joint = extension.size();
+    double joint_dist = kMaxDistanceGap;
+    for (size_t i = 0; i < extension.size(); ++i) {
+      const double d = dist(extension[i], route_end);
+      const double angle_diff =
+          common::MathUtils::CalcAngleDist(tf::getYaw(extension[i].pose.orientation), route_end_heading);
+      if (d < joint_dist && std::fabs(angle_diff) < 0.25 * M_PI) {
+        joint_dist = d;
+        joint = i;
+      }
+    }
+    if (joint + 1 >= extension.size()) {
+      return false;
+    }
+    // drop the route behind the ego beyond the lookback, it would only grow with every extension
+    if (has_vehicle_state_) {
+      size_t index = NearestWayPointIndex(main_lane, vehicle_state);
+      double s = 0.0;
+      while (index > 0 && s < lookback_distance_) {
+        s += dist(main_lane[index], main_lane[index - 1]);
+        --index;
+      }
+      main_lane.erase(main_lane.begin(), main_lane.begin() + index);
+    }
+    main_lane.insert(main_lane.end(), extension.begin() + joint + 1, extension.end());
+    ++route_version_;
+    remaining_route_length_ = std::numeric_limits<double>::max();
+  }
+  NotifyUpdate(false, true);
+  return true;
+}
+
+bool ReferenceGenerator::GetRouteEnd(geometry_msgs::Pose *pose) {
+  std::lock_guard<std::mutex> lock_guard(route_mutex_);
+  if (route_info_.main_lane.empty()) {
+    return false;
+  }
+  *pose = route_info_.main_lane.back().pose;
   return true;
 }
 
+std::vector<planning_msgs::WayPoint> ReferenceGenerator::GetRouteWayPoints() {
+  std::lock_guard<std::mutex> lock_guard(route_mutex_);
+  return route_info_.main_lane;
+}
+
+void ReferenceGenerator::UpdateRemainingRouteLength(const std::vector<planning_msgs::WayPoint> &lane,
+                                                    const vehicle_state::KinoDynamicState &vehicle_state,
+                                                    uint64_t route_version) {
+  if (lane.empty()) {
+    return;
+  }
+  double remaining_length = 0.0;
+  for (size_t i = NearestWayPointIndex(lane, vehicle_state) + 1; i < lane.size(); ++i) {
+    remaining_length += std::hypot(lane[i].pose.position.x - lane[i - 1].pose.position.x,
+                                   lane[i].pose.position.y - lane[i - 1].pose.position.y);
+  }
+  // the route may have been extended since the copy, its length is measured on the next build
+  std::lock_guard<std::mutex> lock_guard(route_mutex_);
+  if (route_version == route_version_) {
+    remaining_route_length_ = remaining_length;
+  }
+}
+
 std::vector<std::vector<planning_msgs::WayPoint>> ReferenceGenerator::SplitRawLane(const planning_msgs::Lane &raw_lane) {
   std::vector<std::vector<planning_msgs::WayPoint>> split_lanes;
   std::vector<std::vector<planning_msgs::WayPoint>> lanes;
@@ -260,57 +440,115 @@ std::vector<std::vector<planning_msgs::WayPoint>> ReferenceGenerator::SplitRawLa
 }
 
 bool ReferenceGenerator::UpdateVehicleState(const vehicle_state::KinoDynamicState &vehicle_state) {
-  std::lock_guard<std::mutex> lock_guard(vehicle_mutex_);
-  vehicle_state_ = vehicle_state;
+  {
+    std::lock_guard<std::mutex> lock_guard(vehicle_mutex_);
+    vehicle_state_ = vehicle_state;
+  }
   has_vehicle_state_ = true;
+  NotifyUpdate(false);
   return true;
 }
 
+void ReferenceGenerator::NotifyUpdate(bool route_updated, bool route_extended) {
+  {
+    std::lock_guard<std::mutex> lock_guard(update_mutex_);
+    route_updated_ = route_updated_ || route_updated;
+    route_extended_ = route_extended_ || route_extended;
+    vehicle_state_updated_ = true;
+  }
+  update_cv_.notify_one();
+}
+
 bool ReferenceGenerator::UpdateReferenceLine(const std::vector<ReferenceLine> &reference_lines) {
   if (reference_lines.empty()) {
     return false;
   }
-  std::lock_guard<std::mutex> lock_guard(reference_line_mutex_);
-  ref_lines_.assign(reference_lines.begin(), reference_lines.end());
-  reference_line_history_.push_back(ref_lines_);
-  return false;
+  std::atomic_store(&ref_lines_, std::make_shared<const std::vector<ReferenceLine>>(reference_lines));
+  return true;
+}
+
+std::shared_ptr<const std::vector<ReferenceLine>> ReferenceGenerator::GetLatestReferenceLines() const {
+  return std::atomic_load(&ref_lines_);
 }
 
 bool ReferenceGenerator::GetReferenceLines(std::vector<ReferenceLine> *reference_lines) {
-  std::lock_guard<std::mutex> lock_guard(reference_line_mutex_);
-  if (!ref_lines_.empty()) {
-    reference_lines->assign(ref_lines_.begin(), ref_lines_.end());
+  const auto ref_lines = GetLatestReferenceLines();
+  if (ref_lines == nullptr) {
+    return false;
+  }
+  reference_lines->assign(ref_lines->begin(), ref_lines->end());
+  return true;
+}
+
+bool ReferenceGenerator::NeedsRebuild(const vehicle_state::KinoDynamicState &vehicle_state) const {
+  const auto ref_lines = GetLatestReferenceLines();
+  if (ref_lines == nullptr || ref_lines->empty()) {
     return true;
-  } else {
-    if (reference_line_history_.empty()) {
-      return false;
-    }
-    reference_lines->assign(reference_line_history_.back().begin(), reference_line_history_.back().end());
+  }
+  common::SLPoint sl_point;
+  if (!ref_lines->front().XYToSL(vehicle_state.x, vehicle_state.y, &sl_point)) {
     return true;
   }
+  return std::fabs(sl_point.s - build_s_) > PlanningConfig::Instance().reference_line_rebuild_margin();
 }
 
 void ReferenceGenerator::GenerateThread() {
+  if (!common::ConfigureCurrentThread(PlanningConfig::Instance().reference_generator_thread_options())) {
+    ROS_WARN("[ReferenceGenerator::GenerateThread], failed to apply the thread options");
+  }
+  // a route update or extension is kept pending until the reference lines are rebuilt on it
+  bool route_pending = false;
+  bool route_extension_pending = false;
   while (!is_stop_) {
-    static constexpr int32_t kSleepTime = 50;  // milliseconds
-    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepTime));
-    auto start_time = std::chrono::system_clock::now();
-    if (!has_route_) {
-      ROS_FATAL("Routing is not ready.");
+    {
+      PLANNING_TRACE_ZONE("reference_generator_wait");
+      std::unique_lock<std::mutex> lock(update_mutex_);
+      update_cv_.wait(lock, [this] { return is_stop_ || route_updated_ || vehicle_state_updated_; });
+      route_pending = route_pending || route_updated_;
+      route_extension_pending = route_extension_pending || route_extended_;
+      route_updated_ = false;
+      route_extended_ = false;
+      vehicle_state_updated_ = false;
+    }
+    if (is_stop_) {
+      break;
+    }
+    if (!has_route_ || !has_vehicle_state_) {
+      continue;
+    }
+    vehicle_state::KinoDynamicState vehicle_state{};
+    {
+      PLANNING_TRACE_ZONE("reference_generator_vehicle_lock");
+      std::lock_guard<std::mutex> lock_guard(vehicle_mutex_);
+      vehicle_state = vehicle_state_;
+    }
+    if (!route_pending && !route_extension_pending && !NeedsRebuild(vehicle_state)) {
       continue;
     }
+    if (route_pending) {
+      // the last lanes are no use as a warm start for a new route, the smoothing tasks reset their smoothers
+      warm_start_stale_.fill(true);
+      has_last_candidates_.fill(false);
+    }
+    PLANNING_TRACE_ZONE("reference_generator_build");
     std::vector<ReferenceLine> ref_lines;
     if (!CreateReferenceLines(true, ref_lines)) {
       ROS_FATAL("Failed to create ReferenceLines");
       continue;
     }
+    common::SLPoint sl_point;
+    build_s_ = ref_lines.front().XYToSL(vehicle_state.x, vehicle_state.y, &sl_point) ? sl_point.s : 0.0;
     UpdateReferenceLine(ref_lines);
-    auto end_time = std::chrono::system_clock::now();
-    std::lock_guard<std::mutex> lock(reference_line_mutex_);
+    route_pending = false;
+    route_extension_pending = false;
   }
 }
 void ReferenceGenerator::Stop() {
-  is_stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock_guard(update_mutex_);
+    is_stop_ = true;
+  }
+  update_cv_.notify_one();
   task_future_.get();
 
 }
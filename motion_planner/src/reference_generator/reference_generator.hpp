@@ -2,9 +2,13 @@
 #define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_MOTION_PLANNER_SRC_REFERENCE_GENERATOR_REFERENCE_GENERATOR_HPP_
 #include "reference_line/reference_line.hpp"
 #include "vehicle_state/vehicle_state.hpp"
+#include "thread_pool/thread_pool.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
-#include <boost/circular_buffer.hpp>
 #include <future>
+#include <limits>
 #include <tf/transform_datatypes.h>
 namespace planning {
 
@@ -14,12 +18,30 @@ struct ReferenceLineConfig {
         reference_smooth_deviation_weight_(0.0),
         reference_smooth_heading_weight_(0.0),
         reference_smooth_length_weight_(0.0),
-        reference_smooth_slack_weight_(0.0) {}
+        reference_smooth_slack_weight_(0.0),
+        reference_point_table_resolution_(0.0) {}
   double reference_smooth_max_curvature_{0.0};
   double reference_smooth_deviation_weight_{0.0};
   double reference_smooth_heading_weight_{0.0};
   double reference_smooth_length_weight_{0.0};
   double reference_smooth_slack_weight_{0.0};
+  double reference_point_table_resolution_{0.0};
+  bool reference_smooth_incremental_{false};
+  size_t reference_smooth_blend_points_{10};
+  ReferenceLineSmoother::Backend reference_smooth_backend_{ReferenceLineSmoother::Backend::IPOPT};
+  bool reference_smooth_cached_tape_{false};
+  // the smoothed way points kept across the builds and the routes, 0 smooths every lane from its slot smoother alone
+  size_t reference_smooth_segment_cache_size_{0};
+  // smooth only the way points kept by the spacing for the curvature and resample the others from them
+  bool reference_smooth_decimation_{false};
+  double reference_smooth_decimation_min_spacing_{1.0};
+  double reference_smooth_decimation_max_spacing_{8.0};
+  double reference_smooth_decimation_max_deviation_{0.02};
+  // the candidate lanes are smoothed concurrently, a lane not smoothed within the timeout keeps its raw spline
+  int reference_smooth_thread_pool_size_{3};
+  double reference_smooth_timeout_{0.05};
+  // slide the reference lines of a lane slot from the last ones, refitting only the splines after the shared points
+  bool reference_line_slide_{false};
 
 };
 
@@ -67,9 +89,51 @@ class ReferenceGenerator {
   bool Start();
   void Stop();
   bool UpdateRouteResponse(const planning_srvs::RoutePlanServiceResponse &route_response);
+
+  /**
+   * @brief: append a route requested from the end of the current route to it, the reference lines are rebuilt on
+   * the longer route without resetting the warm starts, the route behind the ego beyond the lookback is dropped
+   * @param route_response: the route from the end of the current route, it may overlap the current route
+   * @return: false if there is no route or the extension does not continue it
+   */
+  bool ExtendRoute(const planning_srvs::RoutePlanServiceResponse &route_response);
+
+  /**
+   * @brief: the pose of the last way point of the route
+   * @return: false if there is no route
+   */
+  bool GetRouteEnd(geometry_msgs::Pose *pose);
+
+  /**
+   * @brief: a copy of the way points of the route
+   */
+  std::vector<planning_msgs::WayPoint> GetRouteWayPoints();
+
+  /**
+   * @brief: the length of the route ahead of the ego at the last build, the max double until the first build on the
+   * current route
+   */
+  double RemainingRouteLength() const { return remaining_route_length_; }
+
+  /**
+   * @brief: counts the updates and extensions of the route, 0 before the first route
+   */
+  uint64_t RouteVersion() const { return route_version_; }
+
   bool UpdateVehicleState(const vehicle_state::KinoDynamicState &vehicle_state);
   bool GetReferenceLines(std::vector<ReferenceLine> *reference_lines);
+
+  /**
+   * @brief: the latest reference lines without copying them, nullptr before the first ones are built
+   */
+  std::shared_ptr<const std::vector<ReferenceLine>> GetLatestReferenceLines() const;
+
   bool UpdateReferenceLine(const std::vector<ReferenceLine> &reference_lines);
+
+  /**
+   * @brief: rebuild the reference lines on every route update, and on the vehicle state updates once the ego has
+   * moved more than the rebuild margin along the main reference line since the last build
+   */
   void GenerateThread();
 
   /**
@@ -91,6 +155,8 @@ class ReferenceGenerator {
    * @param heading_weight
    * @param length_weight
    * @param ref_lane
+   * @param smoother: the smoother to use instead of the reference line's own one, may be nullptr
+   * @param previous_ref_lane: the last reference line of the lane to slide from, may be nullptr
    * @return
    */
   static bool RetriveReferenceLine(ReferenceLine &ref_lane,
@@ -99,7 +165,9 @@ class ReferenceGenerator {
                                    double lookahead_distance,
                                    double lookback_distance,
                                    bool smooth = false,
-                                   const ReferenceLineConfig &smooth_config = ReferenceLineConfig());
+                                   const ReferenceLineConfig &smooth_config = ReferenceLineConfig(),
+                                   const std::shared_ptr<ReferenceLineSmoother> &smoother = nullptr,
+                                   const ReferenceLine *previous_ref_lane = nullptr);
 
  private:
   /**
@@ -122,23 +190,103 @@ class ReferenceGenerator {
    */
   static std::vector<std::vector<planning_msgs::WayPoint>> SplitRawLane(const planning_msgs::Lane &raw_lane);
 
+  // the candidate lanes, every one has its own smoother so they can be smoothed concurrently
+  enum LaneSlot : size_t {
+    kMainLane = 0,
+    kLeftLane,
+    kRightLane,
+    kNumLaneSlots
+  };
+
+  /**
+   * @brief: the first of lanes the ego would be on after moving lateral_offset off the main reference line,
+   * retrieved around the ego without smoothing
+   * @return: false if there is no such lane
+   */
+  bool SelectNeighbourLane(const ReferenceLine &main_ref_lane,
+                           const vehicle_state::KinoDynamicState &vehicle_state,
+                           const std::vector<std::vector<planning_msgs::WayPoint>> &lanes,
+                           double lateral_offset,
+                           const ReferenceLine *previous_ref_lane,
+                           ReferenceLine *ref_lane) const;
+
+  /**
+   * @brief: the last reference line of slot to slide from, nullptr if sliding is disabled or there is none
+   */
+  const ReferenceLine *PreviousReferenceLine(LaneSlot slot) const;
+
+  /**
+   * @brief: smooth the candidates on lane_thread_pool_, the ones not done by the smoothing timeout stay unsmoothed.
+   * a slot whose last smoothing is still running is not smoothed again
+   */
+  void SmoothCandidateLanes(const std::array<bool, kNumLaneSlots> &has_candidates,
+                            std::array<ReferenceLine, kNumLaneSlots> *candidates);
+
+  /**
+   * @brief: whether the ego at vehicle_state has left the rebuild margin around its s at the last build
+   */
+  bool NeedsRebuild(const vehicle_state::KinoDynamicState &vehicle_state) const;
+
+  /**
+   * @brief: the index of the way point of lane nearest to the ego among the ones heading its way, as
+   * RetriveReferenceLine matches it
+   */
+  static size_t NearestWayPointIndex(const std::vector<planning_msgs::WayPoint> &lane,
+                                     const vehicle_state::KinoDynamicState &vehicle_state);
+
+  /**
+   * @brief: measure the route ahead of the ego on a copy of the route, dropped if the route changed since the copy
+   */
+  void UpdateRemainingRouteLength(const std::vector<planning_msgs::WayPoint> &lane,
+                                  const vehicle_state::KinoDynamicState &vehicle_state,
+                                  uint64_t route_version);
+
+  /**
+   * @brief: wake the generate thread up
+   * @param route_updated: true for a route update, which always triggers a rebuild
+   * @param route_extended: true for a route extension, which triggers a rebuild keeping the warm starts
+   */
+  void NotifyUpdate(bool route_updated, bool route_extended = false);
+
  private:
   bool is_initialized_ = false;
   std::atomic<bool> is_stop_{false};
   ReferenceLineConfig smooth_config_;
   double lookahead_distance_{};
   double lookback_distance_{};
+  // smooth the lanes across the rebuilds, so they can warm start from the last reference lines
+  std::array<std::shared_ptr<ReferenceLineSmoother>, kNumLaneSlots> lane_smoothers_;
+  // nullptr if disabled, shared by the slots, so a lane keeps its smoothed points when it moves to another slot
+  std::shared_ptr<ReferenceLineSegmentCache> segment_cache_;
+  // nullptr if the lanes are smoothed over all their way points
+  std::shared_ptr<const WayPointDecimator> way_point_decimator_;
+  // the smoothing tasks, only touched by the generate thread
+  std::array<std::future<ReferenceLine>, kNumLaneSlots> smoothing_futures_;
+  std::array<bool, kNumLaneSlots> warm_start_stale_{};
+  // the reference lines of the last build by slot, only touched by the generate thread
+  std::array<ReferenceLine, kNumLaneSlots> last_candidates_;
+  std::array<bool, kNumLaneSlots> has_last_candidates_{};
   std::mutex route_mutex_;
   RouteInfo route_info_;
-  bool has_route_ = false;
-  bool has_vehicle_state_ = false;
+  std::atomic<bool> has_route_{false};
+  std::atomic<bool> has_vehicle_state_{false};
   std::mutex vehicle_mutex_;
   vehicle_state::KinoDynamicState vehicle_state_{};
-  std::mutex reference_line_mutex_;
-  std::vector<ReferenceLine> ref_lines_;
-  boost::circular_buffer<std::vector<ReferenceLine>> reference_line_history_;
+  // the generate thread sleeps on update_cv_ until one of the flags is set
+  std::mutex update_mutex_;
+  std::condition_variable update_cv_;
+  bool route_updated_ = false;
+  bool route_extended_ = false;
+  bool vehicle_state_updated_ = false;
+  std::atomic<uint64_t> route_version_{0};
+  std::atomic<double> remaining_route_length_{std::numeric_limits<double>::max()};
+  // the latest reference lines, swapped by the atomic shared_ptr functions so the readers never block the build
+  std::shared_ptr<const std::vector<ReferenceLine>> ref_lines_;
+  // the s of the ego on the main reference line of ref_lines_ when it was built, only used by the generate thread
+  double build_s_ = 0.0;
   std::future<void> task_future_;
-
+  // declared last, so it finishes the smoothing tasks before the smoothers go
+  std::unique_ptr<common::ThreadPool> lane_thread_pool_;
 };
 
 }
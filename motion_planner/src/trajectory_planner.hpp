@@ -1,6 +1,8 @@
 
 #ifndef CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_PLANNER_TRAJECTORY_PLANNER_HPP_
 #define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_PLANNER_TRAJECTORY_PLANNER_HPP_
+#include <atomic>
+#include <chrono>
 #include <planning_msgs/TrajectoryPoint.h>
 #include <planning_msgs/Trajectory.h>
 #include <planning_msgs/LongitudinalBehaviour.h>
@@ -8,6 +10,7 @@
 #include "reference_line/reference_line.hpp"
 #include "obstacle_manager/obstacle.hpp"
 #include "planning_config.hpp"
+#include "vehicle_state/vehicle_params.hpp"
 
 namespace planning {
 
@@ -28,6 +31,62 @@ class TrajectoryPlanner {
                        const std::vector<PlanningTarget> &planning_targets,
                        planning_msgs::Trajectory &optimal_trajectory,
                        std::vector<planning_msgs::Trajectory> *valid_trajectories) = 0;
+
+  /**
+   * @brief: re-validate a trajectory planned in an earlier cycle against the obstacles of the current one, so it can
+   * be kept instead of planning a new one
+   * @param obstacles: the key obstacles of the current cycle
+   * @param trajectory: the remainder of the trajectory, relative to the current time
+   * @return: true if it still satisfies the constraints and collides with no obstacle, false by default
+   */
+  virtual bool IsTrajectoryValid(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                 const planning_msgs::Trajectory &trajectory) {
+    return false;
+  }
+
+  /**
+   * @brief: the time Process should return by, the candidates which are not validated by then are given up
+   * @param deadline: time_point::max() for no deadline
+   */
+  void set_deadline(const std::chrono::steady_clock::time_point &deadline) { deadline_ = deadline; }
+
+  /**
+   * @brief: the geometry of the ego this planner plans for, every planner of a process keeps its own, so the
+   * egos of a planning server do not see each other's
+   * @param vehicle_params
+   */
+  void set_vehicle_params(const vehicle_state::VehicleParams &vehicle_params) { vehicle_params_ = vehicle_params; }
+
+  /**
+   * @return: true if the last Process gave up some candidates for the deadline
+   */
+  bool is_deadline_missed() const { return is_deadline_missed_; }
+
+ protected:
+  /**
+   * @return: true if the deadline has passed, which is remembered as a miss of the current Process
+   */
+  bool IsPastDeadline() const {
+    if (std::chrono::steady_clock::now() < deadline_) {
+      return false;
+    }
+    is_deadline_missed_ = true;
+    return true;
+  }
+
+  /**
+   * @brief: the parameters of a cycle, the shared config with the vehicle params of this planner
+   */
+  PlanningParams CycleParams() const {
+    PlanningParams params = PlanningConfig::Instance().Snapshot();
+    params.vehicle_params = vehicle_params_;
+    return params;
+  }
+
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+  vehicle_state::VehicleParams vehicle_params_{};
+  // set by the reference lines planned in parallel
+  mutable std::atomic<bool> is_deadline_missed_{false};
 };
 }
 #endif //CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_PLANNER_TRAJECTORY_PLANNER_HPP_
@@ -12,6 +12,16 @@
 #include "polygon/box2d.hpp"
 
 namespace planning {
+/**
+ * @brief: lightweight predicted state of an obstacle
+ */
+struct ObstacleState {
+  double x = 0.0;
+  double y = 0.0;
+  double theta = 0.0;
+  double v = 0.0;
+};
+
 class Obstacle {
  public:
   Obstacle() = default;
@@ -21,11 +31,34 @@ class Obstacle {
   Obstacle(const carla_msgs::CarlaTrafficLightInfo &traffic_light_info,
            const carla_msgs::CarlaTrafficLightStatus &traffic_light_status);
   Obstacle(const Obstacle &other);
+  /**
+   * @brief: predict the constant velocity straight line, see obstacle_predictor.hpp for the batched models
+   * @param predict_horizon
+   * @param predict_step
+   */
   void PredictTrajectory(double predict_horizon, double predict_step);
 
+  /**
+   * @brief: set the prediction on the uniform time grid, the i-th state is at the relative time i * predict_step.
+   * the trajectory message is built from it.
+   * @param predict_step
+   * @param xs, ys, thetas, vels: the predicted states
+   * @param ss: the travelled distance of every state
+   */
+  void SetPrediction(double predict_step, std::vector<double> xs, std::vector<double> ys,
+                     std::vector<double> thetas, std::vector<double> vels, const std::vector<double> &ss);
+
   void SetTrajectory(const planning_msgs::Trajectory &trajectory);
   const planning_msgs::Trajectory &trajectory() const { return trajectory_; }
   planning_msgs::TrajectoryPoint GetPointAtTime(double relative_time) const;
+
+  /**
+   * @brief: the predicted state at relative_time, an O(1) lookup into the uniform prediction grid.
+   * the trajectories set by SetTrajectory are not guaranteed to be uniform, they fall back to GetPointAtTime
+   * @param relative_time
+   * @return
+   */
+  ObstacleState GetStateAtTime(double relative_time) const;
   const common::Box2d &GetBoundingBox() const;
   bool HasTrajectory() const;
 
@@ -47,6 +80,7 @@ class Obstacle {
   const double &Heading() const;
   const common::Box2d &BoundingBox() const;
   common::Box2d GetBoundingBoxAtPoint(const planning_msgs::TrajectoryPoint &point) const;
+  common::Box2d GetBoundingBoxAtState(const ObstacleState &state) const;
 
  private:
   int id_{};
@@ -59,6 +93,12 @@ class Obstacle {
   bool is_virtual_ = false;
   bool is_valid_obstacle_{};
   planning_msgs::Trajectory trajectory_;
+  // the prediction in SoA layout, sample i is at relative time i * predict_step_
+  double predict_step_{};
+  std::vector<double> predicted_xs_;
+  std::vector<double> predicted_ys_;
+  std::vector<double> predicted_thetas_;
+  std::vector<double> predicted_vels_;
   double speed_{};
   double angular_speed_{};
 
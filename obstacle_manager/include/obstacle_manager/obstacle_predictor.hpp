@@ -0,0 +1,128 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_OBSTACLE_PREDICTOR_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_OBSTACLE_PREDICTOR_HPP_
+#include <memory>
+#include <vector>
+#include "obstacle_manager/obstacle.hpp"
+#include "reference_line/reference_line.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the obstacles of a cycle predicted together in SoA layout. the state of obstacle i at step k, at the
+ * relative time k * step, is at [k * NumOfObstacles() + i], so a model advances all obstacles of a step in one
+ * contiguous loop.
+ */
+struct PredictionBatch {
+  /**
+   * @brief: take the current states of the obstacles, the predicted states are sized but not set
+   * @param obstacles
+   * @param predict_horizon: the steps are below the horizon, at least one
+   * @param predict_step: the time step
+   */
+  PredictionBatch(const std::vector<std::shared_ptr<Obstacle>> &obstacles, double predict_horizon,
+                  double predict_step);
+
+  /**
+   * @brief: a batch of the one obstacle
+   */
+  PredictionBatch(Obstacle *obstacle, double predict_horizon, double predict_step);
+
+  size_t NumOfObstacles() const { return obstacles.size(); }
+  size_t NumOfSteps() const { return num_steps; }
+  size_t Index(size_t step, size_t obstacle_index) const { return step * NumOfObstacles() + obstacle_index; }
+
+  /**
+   * @brief: hand the predicted states over to the obstacles, see Obstacle::SetPrediction
+   */
+  void Apply() const;
+
+  std::vector<Obstacle *> obstacles;
+  double step = 0.0;
+  size_t num_steps = 0;
+  // the current states, one per obstacle
+  std::vector<double> init_x;
+  std::vector<double> init_y;
+  std::vector<double> init_theta;
+  std::vector<double> init_v;
+  std::vector<double> init_yaw_rate;
+  std::vector<double> init_acc;
+  // the predicted states, the travelled distance s is counted from the current position
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> theta;
+  std::vector<double> v;
+  std::vector<double> s;
+
+ private:
+  void Init(double predict_horizon, double predict_step);
+};
+
+/**
+ * @brief: a motion model predicting a whole batch of obstacles
+ */
+class PredictionModel {
+ public:
+  PredictionModel() = default;
+  virtual ~PredictionModel() = default;
+
+  /**
+   * @brief: set the predicted states of every obstacle of the batch
+   * @param batch
+   */
+  virtual void Predict(PredictionBatch *batch) const = 0;
+};
+
+/**
+ * @brief: constant turn rate with the current acceleration, the speed stops at zero. every obstacle keeps its yaw
+ * rate, so its heading is turned by a fixed rotation per step and the step only multiplies and adds, which
+ * vectorizes across the obstacles. with use_yaw_rate and use_acc off it is the constant velocity straight line.
+ */
+class ConstantTurnRateModel : public PredictionModel {
+ public:
+  /**
+   * @param use_yaw_rate: false to predict straight lines
+   * @param use_acc: false to keep the current speed
+   */
+  explicit ConstantTurnRateModel(bool use_yaw_rate = true, bool use_acc = true);
+  ~ConstantTurnRateModel() override = default;
+  void Predict(PredictionBatch *batch) const override;
+
+ private:
+  bool use_yaw_rate_ = true;
+  bool use_acc_ = true;
+};
+
+/**
+ * @brief: the obstacles driving along one of the lanes follow it at their lat offset, with the current speed and
+ * acceleration, and go on straight past its end. the static ones and the others are predicted by the fallback model.
+ */
+class LaneFollowingModel : public PredictionModel {
+ public:
+  /**
+   * @param lanes: the lanes an obstacle may follow
+   * @param fallback: the model of the obstacles on none of the lanes
+   * @param max_lat_offset: the largest |l| of an obstacle following a lane
+   * @param max_heading_diff: the largest heading difference to the lane of an obstacle following it
+   */
+  LaneFollowingModel(std::vector<std::shared_ptr<const ReferenceLine>> lanes,
+                     std::shared_ptr<const PredictionModel> fallback,
+                     double max_lat_offset = 1.75, double max_heading_diff = M_PI / 6.0);
+  ~LaneFollowingModel() override = default;
+  void Predict(PredictionBatch *batch) const override;
+
+ private:
+  /**
+   * @brief: the lane the obstacle follows and its sl on it, the one of the least |l| among the matching ones
+   * @return: nullptr if it follows none
+   */
+  const ReferenceLine *MatchLane(double x, double y, double theta, common::SLPoint *sl_point) const;
+
+ private:
+  std::vector<std::shared_ptr<const ReferenceLine>> lanes_;
+  std::shared_ptr<const PredictionModel> fallback_;
+  double max_lat_offset_;
+  double max_heading_diff_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_OBSTACLE_PREDICTOR_HPP_
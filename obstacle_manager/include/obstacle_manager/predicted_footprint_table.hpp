@@ -0,0 +1,149 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_PREDICTED_FOOTPRINT_TABLE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_PREDICTED_FOOTPRINT_TABLE_HPP_
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "obstacle_manager/obstacle.hpp"
+#include "polygon/box2d.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+namespace planning {
+/**
+ * @brief: how far an obstacle may drift from the last cycle's prediction before its footprints are rebuilt
+ */
+struct FootprintReuseBounds {
+  double max_position_drift = 0.2;
+  double max_heading_drift = 0.02;
+  double max_speed_drift = 0.2;
+  // the reused footprints are rebuilt once they are older than this, bounds the staleness of the prediction
+  double max_age = 0.5;
+};
+
+/**
+ * @brief: the predicted bounding boxes of the obstacles at every time step of a planning cycle.
+ * the table is built once per cycle and is immutable afterwards, so the st graphs and collision checkers of all
+ * reference lines share it by pointer instead of rebuilding the same boxes.
+ */
+class PredictedFootprintTable {
+ public:
+  PredictedFootprintTable() = default;
+  ~PredictedFootprintTable() = default;
+
+  /**
+   * @brief: build the footprints at the times start_time, start_time + delta_t, ... below end_time
+   * @param obstacles: the obstacles, usually the key obstacles of the cycle
+   * @param start_time: the first relative time
+   * @param end_time: the exclusive end of the relative times
+   * @param delta_t: the time step
+   * @param thread_pool: the footprints of the obstacles are built in parallel if provided
+   */
+  PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                          double start_time, double end_time, double delta_t,
+                          common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: build the footprints at the given times, e.g. a grid that is dense near the ego and coarse beyond
+   * @param obstacles: the obstacles, usually the key obstacles of the cycle
+   * @param relative_times: the ascending relative times
+   * @param thread_pool: the footprints of the obstacles are built in parallel if provided
+   */
+  PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                          const std::vector<double> &relative_times,
+                          common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: build the footprints like above, but time-shift the footprints of previous_table for the obstacles
+   * whose current state lies within reuse_bounds of their prediction elapsed_time ago. the steps beyond the
+   * previous horizon and the other obstacles are built from scratch. nothing is reused from a table off a uniform
+   * time grid.
+   * @param previous_table: the table of the previous cycle, on the same time step
+   * @param elapsed_time: the time since previous_table was built
+   * @param reuse_bounds: the staleness bounds of the reused footprints
+   */
+  PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                          double start_time, double end_time, double delta_t,
+                          common::ThreadPool *thread_pool,
+                          const PredictedFootprintTable &previous_table,
+                          double elapsed_time,
+                          const FootprintReuseBounds &reuse_bounds);
+
+  /**
+   * @brief: a copy of the table whose footprints are extended by the safety buffers
+   * @param lon_buffer: the buffer on each side in lon direction
+   * @param lat_buffer: the buffer on each side in lat direction
+   * @return
+   */
+  std::shared_ptr<const PredictedFootprintTable> Inflate(double lon_buffer, double lat_buffer) const;
+
+  /**
+   * @brief: the buffers the footprints were inflated by, 0 for a raw table
+   */
+  double LonBuffer() const { return lon_buffer_; }
+
+  double LatBuffer() const { return lat_buffer_; }
+
+  size_t NumOfObstacles() const { return obstacles_.size(); }
+
+  size_t NumOfSteps() const { return relative_times_.size(); }
+
+  double RelativeTime(size_t step) const { return relative_times_[step]; }
+
+  const std::shared_ptr<Obstacle> &GetObstacle(size_t index) const { return obstacles_[index]; }
+
+  /**
+   * @brief: the index of the obstacle with obstacle_id
+   * @param obstacle_id
+   * @param index: the index into the table
+   * @return: false if the obstacle is not in the table
+   */
+  bool GetObstacleIndex(int obstacle_id, size_t *index) const;
+
+  const common::Box2d &Footprint(size_t index, size_t step) const { return footprints_[index * NumOfSteps() + step]; }
+
+  /**
+   * @brief: the age of the footprints of the obstacle at index, 0 if they were built in this cycle
+   */
+  double RowAge(size_t index) const { return row_ages_[index]; }
+
+  /**
+   * @brief: the step whose relative time equals relative_time
+   * @param relative_time
+   * @param step
+   * @return: false if relative_time is not on the time grid of the table
+   */
+  bool GetStepAtTime(double relative_time, size_t *step) const;
+
+ private:
+  void InitTimes(double start_time, double end_time, double delta_t);
+
+  void InitIndices();
+
+  /**
+   * @brief: the step between the relative times, 0 if they are not evenly spaced
+   */
+  double UniformDeltaT() const;
+
+  /**
+   * @brief: build the footprints of the obstacles, from first_steps[index] on, in parallel if thread_pool is set
+   */
+  void BuildFootprints(const std::vector<size_t> &first_steps, common::ThreadPool *thread_pool);
+
+  /**
+   * @brief: the step of previous_table that the obstacle at index can be shifted from, false if it is stale
+   */
+  bool GetReusableStep(size_t index, const PredictedFootprintTable &previous_table, double elapsed_time,
+                       const FootprintReuseBounds &reuse_bounds, size_t *previous_index,
+                       size_t *shift_steps) const;
+
+ private:
+  std::vector<std::shared_ptr<Obstacle>> obstacles_;
+  std::unordered_map<int, size_t> obstacle_indices_;
+  std::vector<double> relative_times_;
+  // footprints_[index * NumOfSteps() + step]
+  std::vector<common::Box2d> footprints_;
+  std::vector<double> row_ages_;
+  double lon_buffer_ = 0.0;
+  double lat_buffer_ = 0.0;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_PREDICTED_FOOTPRINT_TABLE_HPP_
@@ -3,22 +3,33 @@
 
 #include <vector>
 #include <array>
+#include <utility>
 #include <ros/ros.h>
 #include <unordered_map>
 #include "obstacle_manager/obstacle.hpp"
+#include "obstacle_manager/predicted_footprint_table.hpp"
 #include "reference_line/reference_line.hpp"
 #include "math/frenet_frame.hpp"
+#include "thread_pool/thread_pool.hpp"
 namespace planning {
 class STGraph {
  public:
   STGraph() = default;
   ~STGraph() = default;
 
+  /**
+   * @param reference_line: the reference line, shared with the other components planning on it
+   * @param footprint_table: the predicted footprints shared in the planning cycle, it has to hold the obstacles
+   * on the time grid t_start, t_start + delta_t, ... . it is built from the obstacles if not provided
+   * @param thread_pool: the st boundaries of the obstacles are built in parallel if provided
+   */
   STGraph(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
-          const ReferenceLine &reference_line,
+          std::shared_ptr<const ReferenceLine> reference_line,
           double s_start, double s_end, double t_start, double t_end,
           const std::array<double, 3> &init_d,
-          double max_lookahead_time, double delta_t);
+          double max_lookahead_time, double delta_t,
+          std::shared_ptr<const PredictedFootprintTable> footprint_table = nullptr,
+          common::ThreadPool *thread_pool = nullptr);
   /**
    *
    * @return
@@ -45,6 +56,39 @@ class STGraph {
                                                                                double end_time,
                                                                                double resolution) const;
 
+  /**
+   * @brief: the blocking intervals at each of the times, for a time grid that is not evenly spaced
+   * @param times: the relative times within the time range of the graph
+   * @return: the intervals in the order of times
+   */
+  std::vector<std::vector<std::pair<double, double>>> GetPathBlockingIntervals(
+      const std::vector<double> &times) const;
+
+  /**
+   * @brief: the blocking intervals at t sorted by s, the overlapping ones are merged
+   * @param t
+   * @return
+   */
+  std::vector<std::pair<double, double>> GetMergedBlockingIntervals(double t) const;
+
+  /**
+   * @brief: whether s lies in a blocking interval at t
+   * @param t
+   * @param s
+   * @return
+   */
+  bool IsSBlocked(double t, double s) const;
+
+  /**
+   * @brief: the free gap between the merged blocking intervals at t that holds s,
+   * if s is blocked the gap next to the blocking interval whose end is closer to s
+   * @param t
+   * @param s
+   * @param gap: the free s range, the unbounded sides are -/+ infinity
+   * @return: false if gap is nullptr
+   */
+  bool GetNearestFreeGap(double t, double s, std::pair<double, double> *gap) const;
+
   /**
    *
    * @return
@@ -70,31 +114,71 @@ class STGraph {
 
   bool IsObstacleInGraph(int obstacle_id);
 
+  /**
+   * @brief: the sl boundary of the footprint of the obstacle at t on the reference line of the graph, memoized
+   * when the st boundaries are built, so the other stages of the cycle need not project it again. it has the
+   * s and l range only, no boundary points
+   * @param obstacle_id
+   * @param t: a time of the footprint table within the time range of the graph
+   * @param sl_boundary: [out]
+   * @return: false if the obstacle is not in the footprint table, t is off its time grid or the projection failed
+   */
+  bool GetObstacleSLBoundary(int obstacle_id, double t, common::SLBoundary *sl_boundary) const;
+
  private:
   void SetUp(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
-             ReferenceLine &ref_line);
+             const ReferenceLine &ref_line,
+             common::ThreadPool *thread_pool);
 
-  void SetUpStaticObstacle(const std::shared_ptr<Obstacle> &obstacle,
-                           const ReferenceLine &ref_line);
+  bool SetUpStaticObstacle(const std::shared_ptr<Obstacle> &obstacle,
+                           const ReferenceLine &ref_line,
+                           common::STBoundary *st_boundary);
 
-  void SetUpDynamicObstacle(const std::shared_ptr<Obstacle> &obstacle,
-                            const ReferenceLine &ref_line);
+  bool SetUpDynamicObstacle(const std::shared_ptr<Obstacle> &obstacle,
+                            const ReferenceLine &ref_line,
+                            common::STBoundary *st_boundary);
 
+  /**
+   * @brief: the st boundary of the footprints of the obstacle, their sl boundaries are memoized in sl_boundaries_.
+   * a footprint equal to the last projected one, as every footprint of a static obstacle, reuses its sl boundary
+   */
   bool MakeSTBoundary(const std::shared_ptr<Obstacle>& obstacle,
                       const ReferenceLine& ref_line,
-                      common::STBoundary& st_boundary) const;
+                      common::STBoundary& st_boundary);
 
   static common::STPoint SetSTPoint(double s, double t);
 
+  /**
+   * @brief: bucket the st boundaries over t and merge the blocking intervals of the time grid
+   */
+  void BuildIndex();
+
+  /**
+   * @brief: the indices of the st boundaries that may cover t, in ascending order
+   */
+  const std::vector<size_t> &GetCandidateBoundaries(double t) const;
+
+  static std::vector<std::pair<double, double>> MergeIntervals(std::vector<std::pair<double, double>> intervals);
+
  private:
   double max_lookahed_time_{};
   double delta_t_{};
   std::pair<double, double> time_range_;
   std::pair<double, double> s_range_;
-  ReferenceLine reference_line_;
+  std::shared_ptr<const ReferenceLine> reference_line_;
+  std::shared_ptr<const PredictedFootprintTable> footprint_table_;
   std::array<double, 3> init_d_{};
   std::unordered_map<int, common::STBoundary> st_map_;
   std::vector<common::STBoundary> obstacles_st_boundary_;
+  // time_buckets_[k] lists the boundaries overlapping [t_start + k * delta_t, t_start + (k + 1) * delta_t)
+  std::vector<std::vector<size_t>> time_buckets_;
+  // the merged blocking intervals at the grid times t_start, t_start + delta_t, ...
+  std::vector<double> slice_times_;
+  std::vector<std::vector<std::pair<double, double>>> merged_intervals_;
+  // the sl boundaries of the footprints in the layout of the footprint table, [index * num_steps + step], every
+  // obstacle row is only written by the task building its st boundary
+  std::vector<common::SLBoundary> sl_boundaries_;
+  std::vector<char> has_sl_boundary_;
 //  std::vector<common::SLBoundary> obstacles_sl_boundary_;
 };
 }
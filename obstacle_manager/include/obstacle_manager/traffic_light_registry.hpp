@@ -0,0 +1,72 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_TRAFFIC_LIGHT_REGISTRY_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_TRAFFIC_LIGHT_REGISTRY_HPP_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <carla_msgs/CarlaTrafficLightInfo.h>
+#include "math/point_grid_index.hpp"
+#include "reference_line/reference_line.hpp"
+
+namespace planning {
+/**
+ * @brief: the trigger volumes of the traffic lights of the map, which are static, built once when the info list
+ * arrives. the lights near a point are found through a grid instead of a scan over all of them, and the projection
+ * of a light onto a reference line is computed once and kept as long as the reference line lives.
+ */
+class TrafficLightRegistry {
+ public:
+  TrafficLightRegistry() = default;
+  ~TrafficLightRegistry() = default;
+
+  /**
+   * @brief: register the lights in the iteration order of traffic_lights_info_list
+   * @param traffic_lights_info_list
+   */
+  explicit TrafficLightRegistry(
+      const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> &traffic_lights_info_list);
+
+  size_t Size() const { return infos_.size(); }
+
+  const carla_msgs::CarlaTrafficLightInfo &Info(size_t index) const { return infos_[index]; }
+
+  /**
+   * @brief: the lights whose trigger volume center is within radius of (x, y)
+   * @param x
+   * @param y
+   * @param radius
+   * @param indices: [out] the indices in ascending order, which is the order of the info list
+   */
+  void WithinRadius(double x, double y, double radius, std::vector<size_t> *indices) const;
+
+  /**
+   * @brief: the projection of the trigger volume center of a light onto ref_lane, computed on the first query and
+   * cached for ref_lane. the cache is keyed by the reference line object, so the lines shared between cycles hit it.
+   * @param index: the index of the light
+   * @param ref_lane
+   * @param sl_point: [out]
+   * @return: false if the center does not project onto ref_lane
+   */
+  bool Project(size_t index, const std::shared_ptr<const ReferenceLine> &ref_lane, common::SLPoint *sl_point) const;
+
+ private:
+  enum class ProjectionState : uint8_t { UNKNOWN, VALID, INVALID };
+
+  /**
+   * @brief: the projections of the lights onto one reference line, expired with it
+   */
+  struct Projections {
+    std::weak_ptr<const ReferenceLine> ref_lane;
+    std::vector<ProjectionState> states;
+    std::vector<common::SLPoint> sl_points;
+  };
+
+  std::vector<carla_msgs::CarlaTrafficLightInfo> infos_;
+  common::PointGridIndex index_;
+  // the planner and the benchmark may query from several threads
+  mutable std::mutex projections_mutex_;
+  mutable std::unordered_map<const ReferenceLine *, Projections> projections_;
+};
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_OBSTACLE_MANAGER_INCLUDE_OBSTACLE_MANAGER_TRAFFIC_LIGHT_REGISTRY_HPP_
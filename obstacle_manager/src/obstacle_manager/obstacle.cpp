@@ -1,5 +1,6 @@
 #include <tf/transform_datatypes.h>
 #include "obstacle_manager/obstacle.hpp"
+#include "obstacle_manager/obstacle_predictor.hpp"
 #include "math/math_utils.hpp"
 
 namespace planning {
@@ -30,6 +31,11 @@ Obstacle::Obstacle(const Obstacle &other) {
   this->speed_ = other.speed_;
   this->angular_speed_ = other.angular_speed_;
   this->trajectory_ = other.trajectory_;
+  this->predict_step_ = other.predict_step_;
+  this->predicted_xs_ = other.predicted_xs_;
+  this->predicted_ys_ = other.predicted_ys_;
+  this->predicted_thetas_ = other.predicted_thetas_;
+  this->predicted_vels_ = other.predicted_vels_;
   this->is_valid_obstacle_ = other.is_valid_obstacle_;
   this->is_static_ = other.is_static_;
   this->center_ = other.center_;
@@ -41,6 +47,39 @@ Box2d Obstacle::GetBoundingBoxAtPoint(const planning_msgs::TrajectoryPoint &poin
   return Box2d(center, point.path_point.theta, bounding_box_.length(), bounding_box_.width());
 }
 
+Box2d Obstacle::GetBoundingBoxAtState(const ObstacleState &state) const {
+  return Box2d({state.x, state.y}, state.theta, bounding_box_.length(), bounding_box_.width());
+}
+
+ObstacleState Obstacle::GetStateAtTime(double relative_time) const {
+  ObstacleState state;
+  if (predicted_xs_.size() < 2) {
+    const auto point = GetPointAtTime(relative_time);
+    state.x = point.path_point.x;
+    state.y = point.path_point.y;
+    state.theta = point.path_point.theta;
+    state.v = point.vel;
+    return state;
+  }
+  const size_t last_index = predicted_xs_.size() - 1;
+  const double index_param = relative_time / predict_step_;
+  if (index_param <= 0.0 || index_param >= static_cast<double>(last_index)) {
+    const size_t index = index_param <= 0.0 ? 0 : last_index;
+    state.x = predicted_xs_[index];
+    state.y = predicted_ys_[index];
+    state.theta = predicted_thetas_[index];
+    state.v = predicted_vels_[index];
+    return state;
+  }
+  const auto index = static_cast<size_t>(index_param);
+  const double ratio = index_param - static_cast<double>(index);
+  state.x = predicted_xs_[index] + ratio * (predicted_xs_[index + 1] - predicted_xs_[index]);
+  state.y = predicted_ys_[index] + ratio * (predicted_ys_[index + 1] - predicted_ys_[index]);
+  state.theta = MathUtils::slerp(predicted_thetas_[index], 0.0, predicted_thetas_[index + 1], 1.0, ratio);
+  state.v = predicted_vels_[index] + ratio * (predicted_vels_[index + 1] - predicted_vels_[index]);
+  return state;
+}
+
 planning_msgs::TrajectoryPoint Obstacle::GetPointAtTime(double relative_time) const {
   const auto &trajectory_points = trajectory_.trajectory_points;
   // for static obstacle
@@ -97,61 +136,35 @@ const double &Obstacle::Heading() const { return heading_; }
 const double &Obstacle::AngularSpeed() const { return angular_speed_; }
 
 void Obstacle::PredictTrajectory(double predict_horizon, double predict_step) {
-  trajectory_ = decltype(trajectory_)();
-//  if (is_static_) {
-//    trajectory_.trajectory_points.emplace_back();
-//    auto &trajectory_point = trajectory_.trajectory_points.back();
-//    trajectory_point.path_point.x = center_.x();
-//    trajectory_point.path_point.y = center_.y();
-//    trajectory_point.path_point.s = 0.0;
-//    trajectory_point.path_point.theta = heading_;
-//    trajectory_point.path_point.kappa = 0.0;
-//    trajectory_point.path_point.dkappa = 0.0;
-//    trajectory_point.relative_time = 0.0;
-//    trajectory_point.vel = this->speed_;
-//    trajectory_point.acc = acc_;
-//    trajectory_point.jerk = 0.0;
-//    trajectory_point.steer_angle = 0.0;
-//  } else {
-  planning_msgs::TrajectoryPoint last_trajectory_point;
-  last_trajectory_point.path_point.x = this->center_.x();
-  last_trajectory_point.path_point.y = this->center_.y();
-  last_trajectory_point.path_point.kappa = 0.0;
-  last_trajectory_point.path_point.dkappa = 0.0;
-  last_trajectory_point.path_point.s = 0.0;
-  last_trajectory_point.path_point.theta = heading_;
-  last_trajectory_point.vel = speed_;
-  last_trajectory_point.acc = acc_;
-  last_trajectory_point.jerk = 0.0;
-  last_trajectory_point.steer_angle = 0.0;
-  last_trajectory_point.relative_time = 0.0;
-  trajectory_.trajectory_points.push_back(last_trajectory_point);
-  const int kStepSize =
-      static_cast<int>(predict_horizon / predict_step) < 1 ? 1 : static_cast<int>(predict_horizon / predict_step);
-  for (int i = 1; i < kStepSize; ++i) {
-    planning_msgs::TrajectoryPoint trajectory_point;
-//      trajectory_.trajectory_points.emplace_back();
-//      auto &trajectory_point = trajectory_.trajectory_points.back();
-    trajectory_point.path_point.x = last_trajectory_point.path_point.x +
-        predict_step * last_trajectory_point.vel * std::cos(last_trajectory_point.path_point.theta);
-    trajectory_point.path_point.y = last_trajectory_point.path_point.y +
-        predict_step * last_trajectory_point.vel * std::sin(last_trajectory_point.path_point.theta);
-    trajectory_point.path_point.theta = last_trajectory_point.path_point.theta;
+  PredictionBatch batch(this, predict_horizon, predict_step);
+  ConstantTurnRateModel(false, false).Predict(&batch);
+  batch.Apply();
+}
+
+void Obstacle::SetPrediction(double predict_step, std::vector<double> xs, std::vector<double> ys,
+                             std::vector<double> thetas, std::vector<double> vels, const std::vector<double> &ss) {
+  predict_step_ = predict_step;
+  predicted_xs_ = std::move(xs);
+  predicted_ys_ = std::move(ys);
+  predicted_thetas_ = std::move(thetas);
+  predicted_vels_ = std::move(vels);
+  const size_t num_points = predicted_xs_.size();
+  auto &trajectory_points = trajectory_.trajectory_points;
+  trajectory_points.resize(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    auto &trajectory_point = trajectory_points[i];
+    trajectory_point.path_point.x = predicted_xs_[i];
+    trajectory_point.path_point.y = predicted_ys_[i];
+    trajectory_point.path_point.s = ss[i];
+    trajectory_point.path_point.theta = predicted_thetas_[i];
     trajectory_point.path_point.kappa = 0.0;
     trajectory_point.path_point.dkappa = 0.0;
     trajectory_point.relative_time = predict_step * static_cast<double>(i);
-    trajectory_point.vel = last_trajectory_point.vel;
-    trajectory_point.acc = 0.0;
+    trajectory_point.vel = predicted_vels_[i];
+    trajectory_point.acc = i == 0 ? acc_ : (predicted_vels_[i] - predicted_vels_[i - 1]) / predict_step;
     trajectory_point.jerk = 0.0;
     trajectory_point.steer_angle = 0.0;
-    double dx = trajectory_point.path_point.x - last_trajectory_point.path_point.x;
-    double dy = trajectory_point.path_point.y - last_trajectory_point.path_point.y;
-    double delta_s = std::hypot(dx, dy);
-    trajectory_point.path_point.s = last_trajectory_point.path_point.s + delta_s;
-    trajectory_.trajectory_points.push_back(trajectory_point);
-    last_trajectory_point = trajectory_point;
   }
-//  }
 }
 
 Obstacle::Obstacle(const carla_msgs::CarlaTrafficLightInfo &traffic_light_info,
@@ -173,6 +186,11 @@ Obstacle::Obstacle(const carla_msgs::CarlaTrafficLightInfo &traffic_light_info,
 
 void Obstacle::SetTrajectory(const planning_msgs::Trajectory &trajectory) {
   this->trajectory_ = trajectory;
+  predict_step_ = 0.0;
+  predicted_xs_.clear();
+  predicted_ys_.clear();
+  predicted_thetas_.clear();
+  predicted_vels_.clear();
 }
 
 }
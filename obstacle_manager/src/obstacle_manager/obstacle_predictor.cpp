@@ -0,0 +1,215 @@
+#include "obstacle_manager/obstacle_predictor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "math/math_utils.hpp"
+
+namespace planning {
+using namespace common;
+
+namespace {
+/**
+ * @brief: advance the speed by one step of constant acceleration, stopping at zero
+ * @return: the distance travelled in the step
+ */
+inline double AdvanceSpeed(double v0, double acc, double dt, double *v1) {
+  const double v = v0 + acc * dt;
+  *v1 = std::max(0.0, v);
+  // a stop within the step travels the braking distance only
+  return v >= 0.0 ? 0.5 * (v0 + v) * dt : 0.5 * v0 * v0 / -acc;
+}
+}
+
+PredictionBatch::PredictionBatch(const std::vector<std::shared_ptr<Obstacle>> &obstacles, double predict_horizon,
+                                 double predict_step) {
+  this->obstacles.reserve(obstacles.size());
+  for (const auto &obstacle : obstacles) {
+    this->obstacles.push_back(obstacle.get());
+  }
+  Init(predict_horizon, predict_step);
+}
+
+PredictionBatch::PredictionBatch(Obstacle *obstacle, double predict_horizon, double predict_step)
+    : obstacles(1, obstacle) {
+  Init(predict_horizon, predict_step);
+}
+
+void PredictionBatch::Init(double predict_horizon, double predict_step) {
+  step = predict_step;
+  num_steps = static_cast<int>(predict_horizon / predict_step) < 1
+              ? 1 : static_cast<size_t>(predict_horizon / predict_step);
+  const size_t num_obstacles = obstacles.size();
+  init_x.resize(num_obstacles);
+  init_y.resize(num_obstacles);
+  init_theta.resize(num_obstacles);
+  init_v.resize(num_obstacles);
+  init_yaw_rate.resize(num_obstacles);
+  init_acc.resize(num_obstacles);
+  for (size_t i = 0; i < num_obstacles; ++i) {
+    const auto &obstacle = *obstacles[i];
+    init_x[i] = obstacle.x();
+    init_y[i] = obstacle.y();
+    init_theta[i] = obstacle.Heading();
+    init_v[i] = obstacle.Speed();
+    init_yaw_rate[i] = obstacle.AngularSpeed();
+    init_acc[i] = obstacle.acc();
+  }
+  const size_t num_states = num_steps * num_obstacles;
+  x.resize(num_states);
+  y.resize(num_states);
+  theta.resize(num_states);
+  v.resize(num_states);
+  s.resize(num_states);
+}
+
+void PredictionBatch::Apply() const {
+  for (size_t i = 0; i < NumOfObstacles(); ++i) {
+    std::vector<double> xs(num_steps);
+    std::vector<double> ys(num_steps);
+    std::vector<double> thetas(num_steps);
+    std::vector<double> vels(num_steps);
+    std::vector<double> ss(num_steps);
+    for (size_t k = 0; k < num_steps; ++k) {
+      const size_t index = Index(k, i);
+      xs[k] = x[index];
+      ys[k] = y[index];
+      thetas[k] = MathUtils::NormalizeAngle(theta[index]);
+      vels[k] = v[index];
+      ss[k] = s[index];
+    }
+    obstacles[i]->SetPrediction(step, std::move(xs), std::move(ys), std::move(thetas), std::move(vels), ss);
+  }
+}
+
+ConstantTurnRateModel::ConstantTurnRateModel(bool use_yaw_rate, bool use_acc)
+    : use_yaw_rate_(use_yaw_rate), use_acc_(use_acc) {}
+
+void ConstantTurnRateModel::Predict(PredictionBatch *batch) const {
+  const size_t num_obstacles = batch->NumOfObstacles();
+  const double dt = batch->step;
+  // the heading of every obstacle as a unit vector, turned by the rotation of one step. the step moves along the
+  // chord of the arc, which points half a rotation ahead and is shorter than the arc by chord_ratio.
+  std::vector<double> cos_theta(num_obstacles);
+  std::vector<double> sin_theta(num_obstacles);
+  std::vector<double> step_cos(num_obstacles);
+  std::vector<double> step_sin(num_obstacles);
+  std::vector<double> half_step_cos(num_obstacles);
+  std::vector<double> half_step_sin(num_obstacles);
+  std::vector<double> chord_ratio(num_obstacles);
+  std::vector<double> yaw_rate(num_obstacles);
+  std::vector<double> acc(num_obstacles);
+  for (size_t i = 0; i < num_obstacles; ++i) {
+    yaw_rate[i] = use_yaw_rate_ ? batch->init_yaw_rate[i] : 0.0;
+    acc[i] = use_acc_ ? batch->init_acc[i] : 0.0;
+    const double half_angle = 0.5 * yaw_rate[i] * dt;
+    cos_theta[i] = std::cos(batch->init_theta[i]);
+    sin_theta[i] = std::sin(batch->init_theta[i]);
+    step_cos[i] = std::cos(2.0 * half_angle);
+    step_sin[i] = std::sin(2.0 * half_angle);
+    half_step_cos[i] = std::cos(half_angle);
+    half_step_sin[i] = std::sin(half_angle);
+    chord_ratio[i] = std::fabs(half_angle) < 1e-6 ? 1.0 - half_angle * half_angle / 6.0
+                                                  : std::sin(half_angle) / half_angle;
+    batch->x[i] = batch->init_x[i];
+    batch->y[i] = batch->init_y[i];
+    batch->theta[i] = batch->init_theta[i];
+    batch->v[i] = batch->init_v[i];
+    batch->s[i] = 0.0;
+  }
+  // the obstacles are independent, the inner loop runs over the contiguous states of one step
+  for (size_t k = 1; k < batch->NumOfSteps(); ++k) {
+    const double t = static_cast<double>(k) * dt;
+    const double *prev_x = batch->x.data() + batch->Index(k - 1, 0);
+    const double *prev_y = batch->y.data() + batch->Index(k - 1, 0);
+    const double *prev_v = batch->v.data() + batch->Index(k - 1, 0);
+    const double *prev_s = batch->s.data() + batch->Index(k - 1, 0);
+    double *next_x = batch->x.data() + batch->Index(k, 0);
+    double *next_y = batch->y.data() + batch->Index(k, 0);
+    double *next_theta = batch->theta.data() + batch->Index(k, 0);
+    double *next_v = batch->v.data() + batch->Index(k, 0);
+    double *next_s = batch->s.data() + batch->Index(k, 0);
+    for (size_t i = 0; i < num_obstacles; ++i) {
+      const double dist = AdvanceSpeed(prev_v[i], acc[i], dt, &next_v[i]);
+      const double chord_cos = cos_theta[i] * half_step_cos[i] - sin_theta[i] * half_step_sin[i];
+      const double chord_sin = sin_theta[i] * half_step_cos[i] + cos_theta[i] * half_step_sin[i];
+      next_x[i] = prev_x[i] + dist * chord_ratio[i] * chord_cos;
+      next_y[i] = prev_y[i] + dist * chord_ratio[i] * chord_sin;
+      next_theta[i] = batch->init_theta[i] + yaw_rate[i] * t;
+      next_s[i] = prev_s[i] + dist;
+      const double rotated_cos = cos_theta[i] * step_cos[i] - sin_theta[i] * step_sin[i];
+      sin_theta[i] = sin_theta[i] * step_cos[i] + cos_theta[i] * step_sin[i];
+      cos_theta[i] = rotated_cos;
+    }
+  }
+}
+
+LaneFollowingModel::LaneFollowingModel(std::vector<std::shared_ptr<const ReferenceLine>> lanes,
+                                       std::shared_ptr<const PredictionModel> fallback,
+                                       double max_lat_offset, double max_heading_diff)
+    : lanes_(std::move(lanes)), fallback_(std::move(fallback)),
+      max_lat_offset_(max_lat_offset), max_heading_diff_(max_heading_diff) {}
+
+void LaneFollowingModel::Predict(PredictionBatch *batch) const {
+  if (fallback_ != nullptr) {
+    fallback_->Predict(batch);
+  }
+  const double dt = batch->step;
+  for (size_t i = 0; i < batch->NumOfObstacles(); ++i) {
+    if (batch->obstacles[i]->IsStatic()) {
+      continue;
+    }
+    SLPoint sl_point;
+    const auto lane = MatchLane(batch->init_x[i], batch->init_y[i], batch->init_theta[i], &sl_point);
+    if (lane == nullptr) {
+      continue;
+    }
+    const double acc = batch->init_acc[i];
+    batch->x[i] = batch->init_x[i];
+    batch->y[i] = batch->init_y[i];
+    batch->theta[i] = batch->init_theta[i];
+    batch->v[i] = batch->init_v[i];
+    batch->s[i] = 0.0;
+    for (size_t k = 1; k < batch->NumOfSteps(); ++k) {
+      const size_t prev = batch->Index(k - 1, i);
+      const size_t next = batch->Index(k, i);
+      const double dist = AdvanceSpeed(batch->v[prev], acc, dt, &batch->v[next]);
+      batch->s[next] = batch->s[prev] + dist;
+      const double lane_s = sl_point.s + batch->s[next];
+      if (lane_s <= lane->Length()) {
+        const auto ref_point = lane->GetReferencePoint(lane_s);
+        batch->x[next] = ref_point.x() - std::sin(ref_point.theta()) * sl_point.l;
+        batch->y[next] = ref_point.y() + std::cos(ref_point.theta()) * sl_point.l;
+        batch->theta[next] = ref_point.theta();
+      } else {
+        batch->x[next] = batch->x[prev] + dist * std::cos(batch->theta[prev]);
+        batch->y[next] = batch->y[prev] + dist * std::sin(batch->theta[prev]);
+        batch->theta[next] = batch->theta[prev];
+      }
+    }
+  }
+}
+
+const ReferenceLine *LaneFollowingModel::MatchLane(double x, double y, double theta, SLPoint *sl_point) const {
+  const ReferenceLine *matched_lane = nullptr;
+  double min_abs_l = std::numeric_limits<double>::max();
+  for (const auto &lane : lanes_) {
+    SLPoint lane_sl;
+    if (lane == nullptr || !lane->XYToSL(x, y, &lane_sl)) {
+      continue;
+    }
+    if (lane_sl.s < 0.0 || lane_sl.s > lane->Length() || std::fabs(lane_sl.l) > max_lat_offset_
+        || std::fabs(lane_sl.l) >= min_abs_l) {
+      continue;
+    }
+    const double heading_diff = MathUtils::NormalizeAngle(theta - lane->GetReferencePoint(lane_sl.s).theta());
+    if (std::fabs(heading_diff) > max_heading_diff_) {
+      continue;
+    }
+    matched_lane = lane.get();
+    min_abs_l = std::fabs(lane_sl.l);
+    *sl_point = lane_sl;
+  }
+  return matched_lane;
+}
+
+}
@@ -0,0 +1,182 @@
+#include "obstacle_manager/predicted_footprint_table.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ros/ros.h>
+#include "math/math_utils.hpp"
+
+namespace planning {
+using namespace common;
+
+namespace {
+constexpr double kTimeEpsilon = 1e-9;
+constexpr double kBoxSizeEpsilon = 1e-6;
+}
+
+PredictedFootprintTable::PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                                 double start_time, double end_time, double delta_t,
+                                                 ThreadPool *thread_pool)
+    : obstacles_(obstacles) {
+  InitTimes(start_time, end_time, delta_t);
+  BuildFootprints(std::vector<size_t>(obstacles_.size(), 0), thread_pool);
+}
+
+PredictedFootprintTable::PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                                 const std::vector<double> &relative_times,
+                                                 ThreadPool *thread_pool)
+    : obstacles_(obstacles), relative_times_(relative_times) {
+  InitIndices();
+  BuildFootprints(std::vector<size_t>(obstacles_.size(), 0), thread_pool);
+}
+
+PredictedFootprintTable::PredictedFootprintTable(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
+                                                 double start_time, double end_time, double delta_t,
+                                                 ThreadPool *thread_pool,
+                                                 const PredictedFootprintTable &previous_table,
+                                                 double elapsed_time,
+                                                 const FootprintReuseBounds &reuse_bounds)
+    : obstacles_(obstacles) {
+  InitTimes(start_time, end_time, delta_t);
+  const size_t num_steps = NumOfSteps();
+  const size_t num_previous_steps = previous_table.NumOfSteps();
+  std::vector<size_t> first_steps(obstacles_.size(), 0);
+  for (size_t i = 0; i < obstacles_.size(); ++i) {
+    size_t previous_index = 0;
+    size_t shift_steps = 0;
+    if (!GetReusableStep(i, previous_table, elapsed_time, reuse_bounds, &previous_index, &shift_steps)) {
+      continue;
+    }
+    // the previous footprints past the end of the previous prediction are frozen at its last state
+    const auto &previous_obstacle = previous_table.GetObstacle(previous_index);
+    const double previous_horizon = previous_obstacle->HasTrajectory()
+                                    ? previous_obstacle->trajectory().trajectory_points.back().relative_time
+                                    : std::numeric_limits<double>::max();
+    size_t step = 0;
+    for (; step < num_steps && step + shift_steps < num_previous_steps
+        && previous_table.RelativeTime(step + shift_steps) <= previous_horizon + kTimeEpsilon; ++step) {
+      footprints_[i * num_steps + step] = previous_table.Footprint(previous_index, step + shift_steps);
+    }
+    first_steps[i] = step;
+    row_ages_[i] = previous_table.RowAge(previous_index) + elapsed_time;
+  }
+  BuildFootprints(first_steps, thread_pool);
+}
+
+void PredictedFootprintTable::InitTimes(double start_time, double end_time, double delta_t) {
+  ROS_ASSERT(delta_t > 0.0);
+  // accumulated the same way as the time loops of the consumers, so their times hit the grid exactly
+  double relative_time = start_time;
+  while (relative_time < end_time) {
+    relative_times_.push_back(relative_time);
+    relative_time += delta_t;
+  }
+  InitIndices();
+}
+
+void PredictedFootprintTable::InitIndices() {
+  for (size_t i = 0; i < obstacles_.size(); ++i) {
+    obstacle_indices_.emplace(obstacles_[i]->Id(), i);
+  }
+  footprints_.resize(obstacles_.size() * relative_times_.size());
+  row_ages_.assign(obstacles_.size(), 0.0);
+}
+
+double PredictedFootprintTable::UniformDeltaT() const {
+  if (relative_times_.size() < 2) {
+    return 0.0;
+  }
+  const double delta_t = relative_times_[1] - relative_times_[0];
+  for (size_t step = 2; step < relative_times_.size(); ++step) {
+    if (std::fabs(relative_times_[step] - relative_times_[step - 1] - delta_t) > kTimeEpsilon) {
+      return 0.0;
+    }
+  }
+  return delta_t;
+}
+
+void PredictedFootprintTable::BuildFootprints(const std::vector<size_t> &first_steps, ThreadPool *thread_pool) {
+  const size_t num_steps = relative_times_.size();
+  auto build_footprints = [this, num_steps, &first_steps](size_t index) {
+    const auto &obstacle = obstacles_[index];
+    for (size_t step = first_steps[index]; step < num_steps; ++step) {
+      footprints_[index * num_steps + step] =
+          obstacle->GetBoundingBoxAtState(obstacle->GetStateAtTime(relative_times_[step]));
+    }
+  };
+  if (thread_pool == nullptr || obstacles_.size() < 2) {
+    for (size_t i = 0; i < obstacles_.size(); ++i) {
+      build_footprints(i);
+    }
+    return;
+  }
+  thread_pool->ParallelFor(0, obstacles_.size(), 1, build_footprints);
+}
+
+bool PredictedFootprintTable::GetReusableStep(size_t index, const PredictedFootprintTable &previous_table,
+                                              double elapsed_time, const FootprintReuseBounds &reuse_bounds,
+                                              size_t *previous_index, size_t *shift_steps) const {
+  const auto &obstacle = obstacles_[index];
+  if (!previous_table.GetObstacleIndex(obstacle->Id(), previous_index)) {
+    return false;
+  }
+  if (previous_table.RowAge(*previous_index) + elapsed_time > reuse_bounds.max_age) {
+    return false;
+  }
+  // a shift by whole steps only maps the time grid onto itself if the steps are even
+  const double delta_t = UniformDeltaT();
+  if (delta_t <= 0.0 || std::fabs(previous_table.UniformDeltaT() - delta_t) > kTimeEpsilon) {
+    return false;
+  }
+  // the step of the previous table nearest to the first step, the time rounding is covered by the drift check
+  const double shift_param =
+      std::round((relative_times_.front() + elapsed_time - previous_table.RelativeTime(0)) / delta_t);
+  if (shift_param < 0.0 || shift_param >= static_cast<double>(previous_table.NumOfSteps())) {
+    return false;
+  }
+  *shift_steps = static_cast<size_t>(shift_param);
+  const auto &previous_obstacle = previous_table.GetObstacle(*previous_index);
+  const auto &box = obstacle->BoundingBox();
+  const auto &previous_box = previous_obstacle->BoundingBox();
+  if (std::fabs(box.length() - previous_box.length()) > kBoxSizeEpsilon
+      || std::fabs(box.width() - previous_box.width()) > kBoxSizeEpsilon) {
+    return false;
+  }
+  const auto state = obstacle->GetStateAtTime(relative_times_.front());
+  const auto previous_state = previous_obstacle->GetStateAtTime(previous_table.RelativeTime(*shift_steps));
+  return std::hypot(state.x - previous_state.x, state.y - previous_state.y) <= reuse_bounds.max_position_drift
+      && std::fabs(MathUtils::NormalizeAngle(state.theta - previous_state.theta)) <= reuse_bounds.max_heading_drift
+      && std::fabs(state.v - previous_state.v) <= reuse_bounds.max_speed_drift;
+}
+
+std::shared_ptr<const PredictedFootprintTable> PredictedFootprintTable::Inflate(double lon_buffer,
+                                                                                double lat_buffer) const {
+  auto inflated_table = std::make_shared<PredictedFootprintTable>(*this);
+  for (auto &footprint : inflated_table->footprints_) {
+    footprint.LateralExtend(2.0 * lat_buffer);
+    footprint.LongitudinalExtend(2.0 * lon_buffer);
+  }
+  inflated_table->lon_buffer_ = lon_buffer_ + lon_buffer;
+  inflated_table->lat_buffer_ = lat_buffer_ + lat_buffer;
+  return inflated_table;
+}
+
+bool PredictedFootprintTable::GetObstacleIndex(int obstacle_id, size_t *index) const {
+  const auto iter = obstacle_indices_.find(obstacle_id);
+  if (iter == obstacle_indices_.end()) {
+    return false;
+  }
+  *index = iter->second;
+  return true;
+}
+
+bool PredictedFootprintTable::GetStepAtTime(double relative_time, size_t *step) const {
+  // the times may be unevenly spaced, the first one not below relative_time minus the tolerance is the candidate
+  const auto iter = std::lower_bound(relative_times_.begin(), relative_times_.end(), relative_time - kTimeEpsilon);
+  if (iter == relative_times_.end() || std::fabs(*iter - relative_time) > kTimeEpsilon) {
+    return false;
+  }
+  *step = static_cast<size_t>(iter - relative_times_.begin());
+  return true;
+}
+
+}
@@ -1,45 +1,83 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
 #include <utility>
 #include "obstacle_manager/st_graph.hpp"
 #include "obstacle_manager/obstacle.hpp"
 
 namespace {
 constexpr double kDefaultLaneWidth = 3.5;
+constexpr double kTimeEpsilon = 1e-9;
 double kLeftWidth = kDefaultLaneWidth / 2.0;
 double kRightWidth = kDefaultLaneWidth / 2.0;
+
+/**
+ * @brief: whether the boxes are bitwise the same pose and size, as the repeated footprints of a still obstacle
+ */
+bool IsSameBox(const common::Box2d &box0, const common::Box2d &box1) {
+  return box0.center_x() == box1.center_x() && box0.center_y() == box1.center_y()
+      && box0.heading() == box1.heading() && box0.length() == box1.length() && box0.width() == box1.width();
+}
 }
 namespace planning {
 using namespace common;
 STGraph::STGraph(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
-                 const ReferenceLine &reference_line,
+                 std::shared_ptr<const ReferenceLine> reference_line,
                  double s_start,
                  double s_end,
                  double t_start,
                  double t_end,
                  const std::array<double, 3> &init_d,
                  double max_lookahead_time,
-                 double delta_t)
+                 double delta_t,
+                 std::shared_ptr<const PredictedFootprintTable> footprint_table,
+                 ThreadPool *thread_pool)
     : max_lookahed_time_(max_lookahead_time),
       delta_t_(delta_t),
       time_range_({t_start, t_end}),
       s_range_({s_start, s_end}),
-      reference_line_(reference_line),
+      reference_line_(std::move(reference_line)),
+      footprint_table_(std::move(footprint_table)),
       init_d_(init_d) {
 
   ROS_ASSERT(s_end >= s_start);
   ROS_ASSERT(t_end >= t_start);
+  if (footprint_table_ == nullptr) {
+    footprint_table_ = std::make_shared<PredictedFootprintTable>(obstacles, t_start, t_end, delta_t, thread_pool);
+  }
 
-  SetUp(obstacles, reference_line_);
+  SetUp(obstacles, *reference_line_, thread_pool);
 }
 
 void STGraph::SetUp(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
-                    ReferenceLine &ref_line) {
+                    const ReferenceLine &ref_line,
+                    ThreadPool *thread_pool) {
 //  obstacles_sl_boundary_.clear();
   st_map_.clear();
-  for (const auto &obstacle : obstacles) {
+  sl_boundaries_.assign(footprint_table_->NumOfObstacles() * footprint_table_->NumOfSteps(), SLBoundary());
+  has_sl_boundary_.assign(sl_boundaries_.size(), 0);
+  // one slot per obstacle, the boundaries are built independently and merged in the obstacle order
+  std::vector<STBoundary> st_boundaries(obstacles.size());
+  std::vector<char> has_st_boundary(obstacles.size(), 0);
+  auto build_st_boundary = [&](size_t index) {
+    const auto &obstacle = obstacles[index];
     if (obstacle->IsStatic()) {
-      SetUpStaticObstacle(obstacle, ref_line);
+      has_st_boundary[index] = SetUpStaticObstacle(obstacle, ref_line, &st_boundaries[index]);
     } else {
-      SetUpDynamicObstacle(obstacle, ref_line);
+      has_st_boundary[index] = SetUpDynamicObstacle(obstacle, ref_line, &st_boundaries[index]);
+    }
+  };
+  if (thread_pool == nullptr || obstacles.size() < 2) {
+    for (size_t i = 0; i < obstacles.size(); ++i) {
+      build_st_boundary(i);
+    }
+  } else {
+    thread_pool->ParallelFor(0, obstacles.size(), 1, build_st_boundary);
+  }
+  for (size_t i = 0; i < obstacles.size(); ++i) {
+    if (has_st_boundary[i]) {
+      st_map_[obstacles[i]->Id()] = std::move(st_boundaries[i]);
     }
   }
 
@@ -53,60 +91,69 @@ void STGraph::SetUp(const std::vector<std::shared_ptr<Obstacle>> &obstacles,
   for (auto &obstacle_st : st_map_) {
     obstacles_st_boundary_.push_back(obstacle_st.second);
   }
+  BuildIndex();
   ROS_INFO("[STGraph::SetUp], obstacle_st_boundary size is %zu", obstacles_st_boundary_.size());
 }
 
-void STGraph::SetUpStaticObstacle(const std::shared_ptr<Obstacle> &obstacle,
-                                  const ReferenceLine &ref_line) {
-  auto box = obstacle->BoundingBox();
-  SLBoundary sl_boundary;
-  if (!ref_line.GetSLBoundary(box, &sl_boundary)) {
-    ROS_INFO("[STGraph::SetUpStaticObstacle] Failed to GetSLBoundary.");
-    return;
-  }
-  int obstacle_id = obstacle->Id();
-//  ref_line.GetLaneWidth(sl_boundary.start_s, &kLeftWidth, &kRightWidth);
-  if (sl_boundary.start_s > s_range_.second || sl_boundary.end_s < s_range_.first ||
-      sl_boundary.start_l > kLeftWidth || sl_boundary.end_l < -kRightWidth) {
-    ROS_INFO("[STGraph::SetUpStaticObstacle], obstacle[%i] is out of range. ", obstacle_id);
-    return;
-  }
-  STBoundary st_boundary;
-  if (!MakeSTBoundary(obstacle, ref_line, st_boundary)) {
-    ROS_FATAL("[SetUpStaticObstacle Failed], Failed To MakeSTBoundary");
-    return;
-  }
-  if (st_map_.find(obstacle->Id()) == st_map_.end()) {
-    st_map_.emplace(obstacle->Id(), st_boundary);
-  } else {
-    st_map_[obstacle->Id()] = st_boundary;
+bool STGraph::SetUpStaticObstacle(const std::shared_ptr<Obstacle> &obstacle,
+                                  const ReferenceLine &ref_line,
+                                  STBoundary *st_boundary) {
+  // the footprints of a static obstacle are its box, MakeSTBoundary projects it once and checks the range
+  if (!MakeSTBoundary(obstacle, ref_line, *st_boundary)) {
+    ROS_INFO("[STGraph::SetUpStaticObstacle], obstacle[%i] is out of range. ", obstacle->Id());
+    return false;
   }
-//  obstacles_sl_boundary_.push_back(std::move(sl_boundary));
+  return true;
 }
 
 bool STGraph::MakeSTBoundary(const std::shared_ptr<Obstacle> &obstacle,
                              const ReferenceLine &ref_line,
-                             STBoundary &st_boundary) const {
+                             STBoundary &st_boundary) {
 
-  double relative_time = time_range_.first;
+  size_t obstacle_index = 0;
+  if (!footprint_table_->GetObstacleIndex(obstacle->Id(), &obstacle_index)) {
+    ROS_WARN("[STGraph::MakeSTBoundary], obstacle[%i] is not in the footprint table", obstacle->Id());
+    return false;
+  }
+  const size_t num_steps = footprint_table_->NumOfSteps();
+  SLBoundary *const sl_row = sl_boundaries_.data() + obstacle_index * num_steps;
+  char *const has_sl_row = has_sl_boundary_.data() + obstacle_index * num_steps;
   std::vector<std::pair<STPoint, STPoint>> st_points;
-  while (relative_time < time_range_.second) {
-    planning_msgs::TrajectoryPoint point = obstacle->GetPointAtTime(relative_time);
-    Box2d box = obstacle->GetBoundingBoxAtPoint(point);
-    SLBoundary sl_boundary;
-    if (!ref_line.GetSLBoundary(box, &sl_boundary)) {
-      relative_time += delta_t_;
+  // the box moves little between the time steps, each projection is warm-started from the previous box
+  int hint_index = -1;
+  const Box2d *projected_box = nullptr;
+  size_t projected_step = 0;
+  for (size_t step = 0; step < num_steps; ++step) {
+    const double relative_time = footprint_table_->RelativeTime(step);
+    if (relative_time < time_range_.first) {
       continue;
     }
+    if (relative_time >= time_range_.second) {
+      break;
+    }
+    const Box2d &box = footprint_table_->Footprint(obstacle_index, step);
+    if (projected_box != nullptr && IsSameBox(*projected_box, box)) {
+      sl_row[step] = sl_row[projected_step];
+    } else {
+      SLBoundary projected_sl_boundary;
+      if (!ref_line.GetSLBoundary(box, &projected_sl_boundary, &hint_index)) {
+        continue;
+      }
+      // the range is all the st graph and its users need, the boundary points are not kept
+      sl_row[step] = SLBoundary(projected_sl_boundary.start_s, projected_sl_boundary.end_s,
+                                projected_sl_boundary.start_l, projected_sl_boundary.end_l);
+      projected_box = &box;
+      projected_step = step;
+    }
+    has_sl_row[step] = 1;
+    const SLBoundary &sl_boundary = sl_row[step];
     if (sl_boundary.start_s > s_range_.second || sl_boundary.end_s < s_range_.first ||
         sl_boundary.start_l > kLeftWidth || sl_boundary.end_l < -kRightWidth) {
-      relative_time += delta_t_;
       continue;
     }
     STPoint lower_st_point(sl_boundary.start_s, relative_time);
     STPoint upper_st_point(sl_boundary.end_s, relative_time);
     st_points.emplace_back(lower_st_point, upper_st_point);
-    relative_time += delta_t_;
   }
   if (st_points.empty()) {
     return false;
@@ -116,17 +163,25 @@ bool STGraph::MakeSTBoundary(const std::shared_ptr<Obstacle> &obstacle,
   return true;
 }
 
-void STGraph::SetUpDynamicObstacle(const std::shared_ptr<Obstacle> &obstacle,
-                                   const ReferenceLine &ref_line) {
-  common::STBoundary st_boundary;
-  if (!MakeSTBoundary(obstacle, ref_line, st_boundary)) {
-    return;
+bool STGraph::SetUpDynamicObstacle(const std::shared_ptr<Obstacle> &obstacle,
+                                   const ReferenceLine &ref_line,
+                                   STBoundary *st_boundary) {
+  return MakeSTBoundary(obstacle, ref_line, *st_boundary);
+}
+
+bool STGraph::GetObstacleSLBoundary(int obstacle_id, double t, SLBoundary *sl_boundary) const {
+  size_t obstacle_index = 0;
+  size_t step = 0;
+  if (sl_boundary == nullptr || !footprint_table_->GetObstacleIndex(obstacle_id, &obstacle_index)
+      || !footprint_table_->GetStepAtTime(t, &step)) {
+    return false;
   }
-  if (st_map_.find(obstacle->Id()) == st_map_.end()) {
-    st_map_.emplace(obstacle->Id(), st_boundary);
-  } else {
-    st_map_[obstacle->Id()] = st_boundary;
+  const size_t index = obstacle_index * footprint_table_->NumOfSteps() + step;
+  if (index >= has_sl_boundary_.size() || !has_sl_boundary_[index]) {
+    return false;
   }
+  *sl_boundary = sl_boundaries_[index];
+  return true;
 }
 
 STPoint STGraph::SetSTPoint(double s, double t) {
@@ -150,7 +205,8 @@ const std::vector<STBoundary> &STGraph::GetObstaclesSTBoundary() const { return
 std::vector<std::pair<double, double>> STGraph::GetPathBlockingIntervals(const double t) const {
   ROS_ASSERT(time_range_.first <= t && t <= time_range_.second);
   std::vector<std::pair<double, double>> intervals;
-  for (const auto &pt_obstacle : obstacles_st_boundary_) {
+  for (const size_t index : GetCandidateBoundaries(t)) {
+    const auto &pt_obstacle = obstacles_st_boundary_[index];
     if (t > pt_obstacle.max_t() || t < pt_obstacle.min_t()) {
       continue;
     }
@@ -164,6 +220,50 @@ std::vector<std::pair<double, double>> STGraph::GetPathBlockingIntervals(const d
   return intervals;
 }
 
+std::vector<std::pair<double, double>> STGraph::GetMergedBlockingIntervals(double t) const {
+  if (!slice_times_.empty() && delta_t_ > 0.0) {
+    const double step_param = std::round((t - slice_times_.front()) / delta_t_);
+    if (step_param >= 0.0 && step_param < static_cast<double>(slice_times_.size())) {
+      const auto step = static_cast<size_t>(step_param);
+      if (std::fabs(slice_times_[step] - t) <= kTimeEpsilon) {
+        return merged_intervals_[step];
+      }
+    }
+  }
+  return MergeIntervals(GetPathBlockingIntervals(t));
+}
+
+bool STGraph::IsSBlocked(double t, double s) const {
+  const auto intervals = GetMergedBlockingIntervals(t);
+  // the first interval that ends at or above s is the only one that can hold s
+  const auto iter = std::lower_bound(intervals.begin(), intervals.end(), s,
+                                     [](const std::pair<double, double> &interval, double value) {
+                                       return interval.second < value;
+                                     });
+  return iter != intervals.end() && iter->first <= s;
+}
+
+bool STGraph::GetNearestFreeGap(double t, double s, std::pair<double, double> *gap) const {
+  if (gap == nullptr) {
+    return false;
+  }
+  const auto intervals = GetMergedBlockingIntervals(t);
+  auto iter = std::lower_bound(intervals.begin(), intervals.end(), s,
+                               [](const std::pair<double, double> &interval, double value) {
+                                 return interval.second < value;
+                               });
+  if (iter != intervals.end() && iter->first <= s) {
+    // s is blocked, step to the upper gap if it is closer
+    if (iter->second - s < s - iter->first) {
+      ++iter;
+    }
+  }
+  // the free gap lies between the interval below iter and iter
+  gap->first = iter == intervals.begin() ? -std::numeric_limits<double>::infinity() : std::prev(iter)->second;
+  gap->second = iter == intervals.end() ? std::numeric_limits<double>::infinity() : iter->first;
+  return true;
+}
+
 std::vector<STPoint> STGraph::GetObstacleSurroundingPoints(int obstacle_id, double s_dist, double t_density) const {
   ROS_ASSERT(t_density > 0.0);
   std::vector<STPoint> pt_pairs;
@@ -245,4 +345,69 @@ STGraph::GetPathBlockingIntervals(double start_time,
   return intervals;
 }
 
-}
\ No newline at end of file
+std::vector<std::vector<std::pair<double, double>>>
+STGraph::GetPathBlockingIntervals(const std::vector<double> &times) const {
+  std::vector<std::vector<std::pair<double, double>>> intervals;
+  intervals.reserve(times.size());
+  for (const double t : times) {
+    intervals.push_back(GetPathBlockingIntervals(t));
+  }
+  return intervals;
+}
+
+void STGraph::BuildIndex() {
+  time_buckets_.clear();
+  slice_times_.clear();
+  merged_intervals_.clear();
+  if (delta_t_ <= 0.0) {
+    time_buckets_.emplace_back(obstacles_st_boundary_.size());
+    for (size_t i = 0; i < obstacles_st_boundary_.size(); ++i) {
+      time_buckets_.front()[i] = i;
+    }
+    return;
+  }
+  const auto num_buckets =
+      static_cast<long>((time_range_.second - time_range_.first) / delta_t_) + 1;
+  time_buckets_.resize(static_cast<size_t>(num_buckets));
+  for (size_t i = 0; i < obstacles_st_boundary_.size(); ++i) {
+    const auto &st_boundary = obstacles_st_boundary_[i];
+    // one spare bucket on each side, so a time rounded into the next bucket still finds the boundary
+    const long first_bucket = std::max(
+        static_cast<long>(std::floor((st_boundary.min_t() - time_range_.first) / delta_t_)) - 1, 0L);
+    const long last_bucket = std::min(
+        static_cast<long>(std::floor((st_boundary.max_t() - time_range_.first) / delta_t_)) + 1, num_buckets - 1);
+    for (long k = first_bucket; k <= last_bucket; ++k) {
+      time_buckets_[static_cast<size_t>(k)].push_back(i);
+    }
+  }
+  // accumulated the same way as the time loops of the consumers
+  for (double t = time_range_.first; t <= time_range_.second; t += delta_t_) {
+    slice_times_.push_back(t);
+    merged_intervals_.push_back(MergeIntervals(GetPathBlockingIntervals(t)));
+  }
+}
+
+const std::vector<size_t> &STGraph::GetCandidateBoundaries(double t) const {
+  static const std::vector<size_t> kNoBoundaries;
+  if (time_buckets_.empty()) {
+    return kNoBoundaries;
+  }
+  const double bucket_param = delta_t_ > 0.0 ? std::floor((t - time_range_.first) / delta_t_) : 0.0;
+  const double max_bucket = static_cast<double>(time_buckets_.size() - 1);
+  return time_buckets_[static_cast<size_t>(std::max(0.0, std::min(bucket_param, max_bucket)))];
+}
+
+std::vector<std::pair<double, double>> STGraph::MergeIntervals(std::vector<std::pair<double, double>> intervals) {
+  std::sort(intervals.begin(), intervals.end());
+  std::vector<std::pair<double, double>> merged_intervals;
+  for (const auto &interval : intervals) {
+    if (!merged_intervals.empty() && interval.first <= merged_intervals.back().second) {
+      merged_intervals.back().second = std::max(merged_intervals.back().second, interval.second);
+      continue;
+    }
+    merged_intervals.push_back(interval);
+  }
+  return merged_intervals;
+}
+
+}
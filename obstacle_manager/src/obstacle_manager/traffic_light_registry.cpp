@@ -0,0 +1,57 @@
+#include "obstacle_manager/traffic_light_registry.hpp"
+#include <iterator>
+
+namespace planning {
+namespace {
+constexpr double kLightGridCellSize = 20.0;
+}
+
+TrafficLightRegistry::TrafficLightRegistry(
+    const std::unordered_map<int, carla_msgs::CarlaTrafficLightInfo> &traffic_lights_info_list) {
+  infos_.reserve(traffic_lights_info_list.size());
+  std::vector<double> xs;
+  std::vector<double> ys;
+  xs.reserve(traffic_lights_info_list.size());
+  ys.reserve(traffic_lights_info_list.size());
+  for (const auto &light_info : traffic_lights_info_list) {
+    infos_.push_back(light_info.second);
+    xs.push_back(light_info.second.trigger_volume.center.x);
+    ys.push_back(light_info.second.trigger_volume.center.y);
+  }
+  index_ = common::PointGridIndex(xs, ys, kLightGridCellSize);
+}
+
+void TrafficLightRegistry::WithinRadius(double x, double y, double radius, std::vector<size_t> *indices) const {
+  indices->clear();
+  if (infos_.empty()) {
+    return;
+  }
+  index_.WithinRadius(x, y, radius, indices);
+}
+
+bool TrafficLightRegistry::Project(size_t index, const std::shared_ptr<const ReferenceLine> &ref_lane,
+                                   common::SLPoint *sl_point) const {
+  std::lock_guard<std::mutex> lock(projections_mutex_);
+  auto iter = projections_.find(ref_lane.get());
+  // a new reference line may be allocated where an expired one was
+  if (iter == projections_.end() || iter->second.ref_lane.lock() != ref_lane) {
+    for (auto it = projections_.begin(); it != projections_.end();) {
+      it = it->second.ref_lane.expired() ? projections_.erase(it) : std::next(it);
+    }
+    auto &projections = projections_[ref_lane.get()];
+    projections.ref_lane = ref_lane;
+    projections.states.assign(infos_.size(), ProjectionState::UNKNOWN);
+    projections.sl_points.assign(infos_.size(), common::SLPoint());
+    iter = projections_.find(ref_lane.get());
+  }
+  auto &projections = iter->second;
+  if (projections.states[index] == ProjectionState::UNKNOWN) {
+    const auto &center = infos_[index].trigger_volume.center;
+    projections.states[index] = ref_lane->XYToSL(center.x, center.y, &projections.sl_points[index])
+                                ? ProjectionState::VALID : ProjectionState::INVALID;
+  }
+  *sl_point = projections.sl_points[index];
+  return projections.states[index] == ProjectionState::VALID;
+}
+
+}
@@ -2,11 +2,15 @@
 #define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_HPP_
 #include <planning_srvs/RoutePlanService.h>
 #include "polygon/box2d.hpp"
+#include "polygon/polygon2d.hpp"
 #include <planning_msgs/PathPoint.h>
 #include "curves/spline2d.hpp"
 #include "reference_point.hpp"
 #include "reference_line_smoother.hpp"
+#include "reference_line_segment_cache.hpp"
+#include "way_point_decimator.hpp"
 #include "math/frenet_frame.hpp"
+#include "math/point_grid_index.hpp"
 
 namespace planning {
 
@@ -28,6 +32,16 @@ class ReferenceLine {
    */
   explicit ReferenceLine(const std::vector<planning_msgs::WayPoint> &waypoints);
 
+  /**
+   * @brief: construct the reference line from waypoints which continue the way points of previous from one of them
+   * on, e.g. the window of the lane around the ego after it moved ahead. the splines of previous are trimmed and only
+   * refitted after the shared way points, they are built from scratch if the way points do not continue previous.
+   * Smooth refits the smoothed spline of previous the same way.
+   * @param waypoints
+   * @param previous
+   */
+  ReferenceLine(const std::vector<planning_msgs::WayPoint> &waypoints, const ReferenceLine &previous);
+
   /**
    * constructor
    * @param route_response
@@ -46,6 +60,27 @@ class ReferenceLine {
    */
   int GetPriority() const { return priority_; }
 
+  /**
+   * @brief: smooth the reference line with smoother instead of the own one, e.g. one that keeps the warm start of
+   * the previous reference lines
+   */
+  void SetSmoother(const std::shared_ptr<ReferenceLineSmoother> &smoother) { this->reference_smoother_ = smoother; }
+
+  /**
+   * @brief: smooth only the way points after the leading ones found in segment_cache, and cache the smoothed ones
+   */
+  void SetSegmentCache(const std::shared_ptr<ReferenceLineSegmentCache> &segment_cache) {
+    this->segment_cache_ = segment_cache;
+  }
+
+  /**
+   * @brief: smooth over the way points picked by decimator instead of all of them, the smoothed curve is resampled
+   * at the dropped ones, so the smoothed points still match the way points one to one
+   */
+  void SetWayPointDecimator(const std::shared_ptr<const WayPointDecimator> &decimator) {
+    this->way_point_decimator_ = decimator;
+  }
+
   /**
    * @brief: smooth the reference line
    * @return : true if smoothing the reference line is successful, false otherwise
@@ -73,6 +108,25 @@ class ReferenceLine {
    */
   bool XYToSL(double x, double y, common::SLPoint *sl_point) const;
 
+  /**
+   * @brief: transform a run of nearby xy points to sl points, every projection is warm-started from the
+   * nearest spline sample of the previous one instead of searching the whole reference line
+   * @param xy_points: the points, the consecutive ones are expected to be close to each other
+   * @param sl_points: the output sl points, the same size as xy_points
+   * @param hint_index: [in/out] optional, carries the warm start across calls, negative for a cold start
+   * @return: false if any of the projections failed
+   */
+  bool BatchXYToSL(const std::vector<Eigen::Vector2d> &xy_points,
+                   std::vector<common::SLPoint> *sl_points,
+                   int *hint_index = nullptr) const;
+
+  /**
+   * @brief: BatchXYToSL on caller-owned buffers, e.g. the outline points of a box kept on the stack
+   * @param num_points: the size of both xy_points and sl_points
+   */
+  bool BatchXYToSL(const Eigen::Vector2d *xy_points, size_t num_points,
+                   common::SLPoint *sl_points, int *hint_index = nullptr) const;
+
   /**
    *
    * @param sl_point
@@ -89,12 +143,23 @@ class ReferenceLine {
   common::FrenetFramePoint GetFrenetFramePoint(const planning_msgs::PathPoint &path_point) const;
 
   /**
-   * get reference point according s
+   * get reference point according s, interpolated from the reference point table if it is built,
+   * evaluated on the spline otherwise
    * @param s
    * @return
    */
   ReferencePoint GetReferencePoint(double s) const;
 
+  /**
+   * @brief: sample the spline uniformly over arc length, so GetReferencePoint(s) becomes an O(1) table lookup.
+   * the table is rebuilt with the same resolution when the reference line is smoothed.
+   * @param resolution: sample gap in meter, non-positive value drops the table and falls back to the spline
+   * @return: true if the table is built
+   */
+  bool BuildReferencePointTable(double resolution);
+
+  bool HasReferencePointTable() const { return reference_point_table_ != nullptr; }
+
   /**
    * get the projection reference point in reference line
    * @param x
@@ -127,6 +192,12 @@ class ReferenceLine {
    */
   double Length() const;
 
+  /**
+   * @brief: the s of the start of this reference line on the first reference line it was slid from, so
+   * s + SOffset() of a place stays the same from one reference line to the next, 0 if not slid
+   */
+  double SOffset() const { return s_offset_; }
+
   /**
    * @brief: check the object has influence on this lane
    * @param sl_boundary
@@ -147,6 +218,26 @@ class ReferenceLine {
    */
   bool GetSLBoundary(const common::Box2d &box, common::SLBoundary *sl_boundary) const;
 
+  /**
+   * @brief : build object sl boundary, warm-started from the previous projection, e.g. the box of the
+   * same obstacle at the previous time step
+   * @param box : the object's bounding box
+   * @param sl_boundary : the output sl_boundary
+   * @param hint_index : [in/out] the warm start, negative for a cold start
+   * @return : false if build sl_boundary failed, true otherwise
+   */
+  bool GetSLBoundary(const common::Box2d &box, common::SLBoundary *sl_boundary, int *hint_index) const;
+
+  /**
+   * @brief : build the sl boundary of a convex polygon footprint
+   * @param polygon : the object's footprint
+   * @param sl_boundary : the output sl_boundary
+   * @return : false if build sl_boundary failed, true otherwise
+   */
+  bool GetSLBoundary(const common::Polygon2d &polygon, common::SLBoundary *sl_boundary) const;
+
+  bool GetSLBoundary(const common::Polygon2d &polygon, common::SLBoundary *sl_boundary, int *hint_index) const;
+
   /**
    * @brief : check the reference line is smoothed or not
    * @return : true if the reference line is smoothed, false otherwise
@@ -155,7 +246,6 @@ class ReferenceLine {
 
   bool HasJunctionInFront(double x, double y, double distance_threshold) const;
 
-//  bool ExtendReferenceLine(double length) ;
   /**
   *
   * @param p0
@@ -174,45 +264,60 @@ class ReferenceLine {
   bool CanChangeLeft(double s) const;
   bool CanChangeRight(double s) const;
 
-//  bool ExtendReferenceLine(double extend_length) {
-//    if (extend_length < 1e-2) {
-//      //do nothing
-//      return true;
-//    }
-//    const double kGap = 2.0;
-//    const auto kExtendNum = static_cast<size_t>(extend_length / kGap);
-//    if (kExtendNum < 1) {
-//      return true;
-//    }
-//    auto last_ref_point = reference_points_.back();
-//    auto last_waypoint = ref_points_.back();
-//    for (size_t i = 1; i < kExtendNum; ++i){
-//      length_ += kGap;
-//      double cos_theta = std::cos(last_ref_point.theta());
-//      double sin_theta = std::sin(last_ref_point.theta());
-//      ReferencePoint next_ref_point = last_ref_point;
-//      next_ref_point.set_xy(last_ref_point.x() + kGap * cos_theta, last_ref_point.y() + kGap * sin_theta);
-//      reference_points_.emplace_back(next_ref_point);
-//      auto next_waypoint = last_waypoint;
-//      next_waypoint.s += kGap;
-//      next_waypoint.pose.position.x = last_waypoint.pose.position.x + kGap * cos_theta;
-//      next_waypoint.pose.position.y = last_waypoint.pose.position.y + kGap * sin_theta;
-//      next_waypoint.id = last_waypoint.id + 1;
-//      next_waypoint.is_junction = false;
-//      next_waypoint.has_left_lane = false;
-//      next_waypoint.has_right_lane = false;
-//      next_waypoint.lane_change.type = planning_msgs::LaneChangeType::FORWARD;
-//      next_waypoint.
-//    }
-//
-//
-//  }
-
  private:
   planning_msgs::WayPoint NearestWayPoint(double x, double y, size_t *min_index) const;
   planning_msgs::WayPoint NearestWayPoint(double s) const;
 
+  /**
+   * @brief: the reference points and the boundaries of way_points_
+   */
+  void BuildReferencePoints();
+
   bool BuildReferenceLineWithSpline();
+
+  /**
+   * @brief: the splines refitted from copies of the ones of previous
+   * @return: false if the way points do not continue the ones of previous
+   */
+  bool SlideReferenceLineWithSpline(const ReferenceLine &previous);
+
+  /**
+   * @brief: the s of first_point on previous_spline
+   */
+  static double SlideShift(const common::Spline2d &previous_spline, const ReferencePoint &first_point);
+
+  /**
+   * @brief: smooth the reference points at kept_indices and resample the spline through them at the other ones
+   * @param kept_indices: ascending, from WayPointDecimator::Decimate
+   * @param cached_points: the known smoothed points of the leading way points
+   * @param smoothed_points: [out] as many as the reference points
+   */
+  bool SmoothDecimated(const std::vector<size_t> &kept_indices, const std::vector<ReferencePoint> &cached_points,
+                       std::vector<ReferencePoint> *smoothed_points) const;
+
+  /**
+   * @brief: sl point of xy, given its nearest point on the reference line spline
+   */
+  void NearestPointToSL(const Eigen::Vector2d &xy, double nearest_x, double nearest_y, double nearest_s,
+                        common::SLPoint *sl_point) const;
+
+  /**
+   * @brief: sl boundary of the outline through the counter-clockwise vertices
+   */
+  bool GetSLBoundaryOfVertices(const Eigen::Vector2d *vertices, size_t num_vertices,
+                               common::SLBoundary *sl_boundary, int *hint_index) const;
+
+  /**
+   * @brief: evaluate the reference point on the spline
+   * @param s
+   * @return
+   */
+  ReferencePoint EvaluateReferencePoint(double s) const;
+
+  /**
+   * @brief: the heading, kappa and dkappa from the derivatives of the spline at x, y
+   */
+  static ReferencePoint ToReferencePoint(double x, double y, const common::Spline2dPoint &point);
   /**
    *
    * @param start
@@ -232,9 +337,22 @@ class ReferenceLine {
   std::vector<Eigen::Vector2d> right_boundary_;
   double length_{}; // the total length of this reference line
   std::shared_ptr<common::Spline2d> ref_line_spline_;
+  // the spline through the way points, the same as ref_line_spline_ until smoothed
+  std::shared_ptr<common::Spline2d> raw_spline_;
+  // the smoothed spline of the reference line this one was slid from, until Smooth refits it
+  std::shared_ptr<const common::Spline2d> previous_smoothed_spline_;
+  double previous_s_offset_ = 0.0;
+  double s_offset_ = 0.0;
   std::shared_ptr<common::Spline2d> left_boundary_spline_;
   std::shared_ptr<common::Spline2d> right_boundary_spline_;
   std::shared_ptr<ReferenceLineSmoother> reference_smoother_;
+  std::shared_ptr<ReferenceLineSegmentCache> segment_cache_;
+  std::shared_ptr<const WayPointDecimator> way_point_decimator_;
+  std::shared_ptr<const common::PointGridIndex> way_point_index_;
+  // reference points sampled every reference_point_table_resolution_ meter, the last one at length_.
+  // shared between the copies, the copies are never modified
+  std::shared_ptr<const std::vector<ReferencePoint>> reference_point_table_;
+  double reference_point_table_resolution_ = 0.0;
   int priority_ = 0;
 };
 
@@ -0,0 +1,76 @@
+#ifndef CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SEGMENT_CACHE_HPP_
+#define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SEGMENT_CACHE_HPP_
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <planning_msgs/WayPoint.h>
+#include "reference_point.hpp"
+
+namespace planning {
+
+/**
+ * @brief: the smoothed positions of the way points of the lanes smoothed so far, keyed by the lane (road, section
+ * and lane id) and the s of the way point on its road. the reference lines of the same route overlap from one
+ * build to the next, and the routes of a town run over the same lanes, so a reference line only needs to smooth the
+ * way points after the leading ones found here. the least recently used points are dropped above the capacity.
+ * shared by the lanes smoothed concurrently, so all the methods lock.
+ */
+class ReferenceLineSegmentCache {
+ public:
+  /**
+   * @param capacity: the number of way points kept
+   */
+  explicit ReferenceLineSegmentCache(size_t capacity);
+
+  /**
+   * @brief: the smoothed positions of the leading way points in the cache
+   * @param way_points
+   * @param smoothed_points: the smoothed points of way_points[0, return value)
+   * @return: the number of leading way points found, a point only counts if its raw position is the cached one
+   */
+  size_t Lookup(const std::vector<planning_msgs::WayPoint> &way_points,
+                std::vector<ReferencePoint> *smoothed_points);
+
+  /**
+   * @brief: cache the smoothed positions of the way points, replacing the ones they are cached with
+   * @param way_points
+   * @param smoothed_points: as many as way_points
+   */
+  void Insert(const std::vector<planning_msgs::WayPoint> &way_points,
+              const std::vector<ReferencePoint> &smoothed_points);
+
+  size_t Size();
+
+  void Clear();
+
+ private:
+  struct CachedPoint {
+    double raw_x = 0.0;
+    double raw_y = 0.0;
+    ReferencePoint smoothed_point;
+    uint64_t last_use = 0;
+  };
+  // the points of a lane by their s in cm, a lane of the map is cut into sections with their own s
+  using LanePoints = std::map<int64_t, CachedPoint>;
+
+  static uint64_t LaneKey(const planning_msgs::WayPoint &way_point);
+  static int64_t SKey(const planning_msgs::WayPoint &way_point);
+
+  /**
+   * @brief: drop the least recently used points down to three quarters of the capacity, so the eviction runs once
+   * per many inserts
+   */
+  void Evict();
+
+ private:
+  std::mutex mutex_;
+  size_t capacity_;
+  size_t size_ = 0;
+  uint64_t tick_ = 0;
+  std::unordered_map<uint64_t, LanePoints> lanes_;
+};
+
+}
+#endif //CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SEGMENT_CACHE_HPP_
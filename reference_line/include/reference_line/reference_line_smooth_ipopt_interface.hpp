@@ -12,6 +12,14 @@ class ReferenceLineSmoothIpoptInterface {
   explicit ReferenceLineSmoothIpoptInterface(const std::vector<std::pair<double, double>> &ref_points);
   ~ReferenceLineSmoothIpoptInterface() = default;
   void operator()(ADvector &fg, const ADvector &x);
+
+  /**
+   * @brief: the same cost and constraints as operator(), with the raw points given as ref_xy, x0, y0, x1, y1, ...
+   * so they can be recorded as independent variables of a tape
+   */
+  void Evaluate(ADvector &fg, const ADvector &x, const ADvector &ref_xy) const;
+  size_t num_of_variables() const { return num_of_variables_; }
+  size_t num_of_constraint() const { return num_of_constraint_; }
   void set_ref_deviation_weight(double weight) { this->ref_deviation_weight_ = weight; }
   void set_curvature_weight(double weight) { this->curvature_weight_ = weight; }
   void set_length_weight(double weight) { this->length_weight_ = weight; }
@@ -0,0 +1,78 @@
+#ifndef CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_QP_SOLVER_HPP_
+#define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_QP_SOLVER_HPP_
+#include <Eigen/Sparse>
+#include <utility>
+#include "math/admm_qp_solver.hpp"
+#include <vector>
+
+namespace planning {
+/**
+ * @brief: the discrete points smoothing of ReferenceLineSmoothIpoptInterface as a sequence of sparse QPs. the
+ * curvature constraints are linearized around the last iterate, every QP is solved by common::AdmmQpSolver, whose
+ * KKT matrix keeps its sparsity pattern as long as the number of points does not change, so the symbolic
+ * factorization is reused.
+ */
+class ReferenceLineSmoothQpSolver {
+ public:
+  ReferenceLineSmoothQpSolver() = default;
+  ~ReferenceLineSmoothQpSolver() = default;
+  void set_ref_deviation_weight(double weight) { this->ref_deviation_weight_ = weight; }
+  void set_length_weight(double weight) { this->length_weight_ = weight; }
+  void set_heading_weight(double weight) { this->heading_weight_ = weight; }
+  void set_max_sqp_iter(int max_sqp_iter) { this->max_sqp_iter_ = max_sqp_iter; }
+  void set_max_admm_iter(int max_admm_iter) { this->max_admm_iter_ = max_admm_iter; }
+
+  /**
+   * @brief: smooth the reference points
+   * @param ref_points: the raw points
+   * @param init_value: the warm start, x0, y0, x1, y1, ...
+   * @param lower_bound: the lower bounds of the variables in the same order, equal to the upper bound to pin one
+   * @param upper_bound
+   * @param curvature_bound: the upper bound of |p[i - 1] + p[i + 1] - 2 * p[i]|^2, the same for every point
+   * @param solution: the smoothed points, x0, y0, x1, y1, ...
+   * @return: false if the problem is ill-formed or the ADMM does not converge
+   */
+  bool Solve(const std::vector<std::pair<double, double>> &ref_points,
+             const std::vector<double> &init_value,
+             const std::vector<double> &lower_bound,
+             const std::vector<double> &upper_bound,
+             double curvature_bound,
+             std::vector<double> *solution);
+
+ private:
+  typedef common::AdmmQpSolver::SparseMatrix SparseMatrix;
+
+  /**
+   * @brief: build the cost of the num_points points, which does not depend on the iterate
+   */
+  void SetUpCost(const std::vector<std::pair<double, double>> &ref_points);
+
+  /**
+   * @brief: the constraint matrix and bounds with the curvature constraints linearized around x
+   */
+  void SetUpConstraint(const Eigen::VectorXd &x,
+                       const std::vector<double> &lower_bound,
+                       const std::vector<double> &upper_bound,
+                       double curvature_bound);
+
+  /**
+   * @return: the largest |p[i - 1] + p[i + 1] - 2 * p[i]|^2 - curvature_bound of x
+   */
+  double MaxCurvatureViolation(const Eigen::VectorXd &x, double curvature_bound) const;
+
+ private:
+  double ref_deviation_weight_{};
+  double length_weight_{};
+  double heading_weight_{};
+  int max_sqp_iter_ = 5;
+  int max_admm_iter_ = 4000;
+  size_t num_points_ = 0;
+  SparseMatrix P_;
+  Eigen::VectorXd q_;
+  SparseMatrix A_;
+  Eigen::VectorXd l_;
+  Eigen::VectorXd u_;
+  common::AdmmQpSolver qp_solver_;
+};
+}
+#endif //CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_QP_SOLVER_HPP_
@@ -0,0 +1,112 @@
+#ifndef CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_TNLP_HPP_
+#define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_TNLP_HPP_
+#include <cppad/cppad.hpp>
+#include <coin/IpTNLP.hpp>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace planning {
+/**
+ * @brief: the problem of ReferenceLineSmoothIpoptInterface as an ipopt TNLP on a recorded CppAD tape. the raw
+ * points are independent variables of the tape next to the optimized ones, so the tape, its sparsity patterns and
+ * the colorings of the sparse derivatives only depend on the number of points and the weights, and are kept across
+ * the calls.
+ */
+class ReferenceLineSmoothTnlp : public Ipopt::TNLP {
+ public:
+  typedef CPPAD_TESTVECTOR(double) DVector;
+  ReferenceLineSmoothTnlp() = default;
+  ~ReferenceLineSmoothTnlp() override = default;
+
+  /**
+   * @brief: set up the next problem, the tape is only recorded again if the number of points or a weight changed
+   * @param ref_points: the raw points
+   * @param weights: the deviation, heading, length and slack weights
+   * @param xi: the starting point
+   * @param x_l, x_u: the variable bounds
+   * @param g_l, g_u: the constraint bounds
+   */
+  void SetUp(const std::vector<std::pair<double, double>> &ref_points,
+             const std::vector<double> &weights,
+             const DVector &xi,
+             const DVector &x_l,
+             const DVector &x_u,
+             const DVector &g_l,
+             const DVector &g_u);
+
+  /**
+   * @return: true if the last optimization succeeded
+   */
+  bool succeeded() const { return status_ == Ipopt::SUCCESS; }
+  const DVector &solution() const { return solution_; }
+  int num_of_tapings() const { return num_of_tapings_; }
+
+  bool get_nlp_info(Ipopt::Index &n, Ipopt::Index &m, Ipopt::Index &nnz_jac_g, Ipopt::Index &nnz_h_lag,
+                    IndexStyleEnum &index_style) override;
+  bool get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l, Ipopt::Number *x_u,
+                       Ipopt::Index m, Ipopt::Number *g_l, Ipopt::Number *g_u) override;
+  bool get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number *x,
+                          bool init_z, Ipopt::Number *z_L, Ipopt::Number *z_U,
+                          Ipopt::Index m, bool init_lambda, Ipopt::Number *lambda) override;
+  bool eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) override;
+  bool eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) override;
+  bool eval_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Number *g) override;
+  bool eval_jac_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Index nele_jac,
+                  Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) override;
+  bool eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number obj_factor,
+              Ipopt::Index m, const Ipopt::Number *lambda, bool new_lambda, Ipopt::Index nele_hess,
+              Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) override;
+  void finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number *x,
+                         const Ipopt::Number *z_L, const Ipopt::Number *z_U,
+                         Ipopt::Index m, const Ipopt::Number *g, const Ipopt::Number *lambda,
+                         Ipopt::Number obj_value, const Ipopt::IpoptData *ip_data,
+                         Ipopt::IpoptCalculatedQuantities *ip_cq) override;
+
+ private:
+  /**
+   * @brief: record fg(x, ref_xy) and the sparsity patterns of its jacobian and the hessian of the lagrangian in x
+   */
+  void RecordTape(const std::vector<std::pair<double, double>> &ref_points, const std::vector<double> &weights);
+
+  /**
+   * @brief: the tape arguments, x followed by the raw points
+   */
+  void SetArgument(const Ipopt::Number *x);
+
+  /**
+   * @brief: zero order forward sweep at x unless it is the argument of the last sweep
+   */
+  void Forward(const Ipopt::Number *x, bool new_x);
+
+ private:
+  CppAD::ADFun<double> fg_fun_;
+  size_t num_of_points_ = 0;
+  size_t num_of_variables_ = 0;
+  size_t num_of_constraint_ = 0;
+  std::vector<double> weights_;
+  int num_of_tapings_ = 0;
+  // the tape arguments and the fg of the last forward sweep
+  DVector argument_;
+  DVector fg_;
+  bool has_forward_ = false;
+  DVector xi_;
+  DVector x_l_;
+  DVector x_u_;
+  DVector g_l_;
+  DVector g_u_;
+  // the jacobian of the constraints, the rows of fg start at 1
+  std::vector<std::set<size_t>> jac_pattern_;
+  std::vector<size_t> jac_rows_;
+  std::vector<size_t> jac_cols_;
+  CppAD::sparse_jacobian_work jac_work_;
+  // the lower triangle of the hessian of the lagrangian in x
+  std::vector<std::set<size_t>> hes_pattern_;
+  std::vector<size_t> hes_rows_;
+  std::vector<size_t> hes_cols_;
+  CppAD::sparse_hessian_work hes_work_;
+  Ipopt::SolverReturn status_ = Ipopt::INTERNAL_ERROR;
+  DVector solution_;
+};
+}
+#endif //CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_REFERENCE_LINE_SMOOTH_TNLP_HPP_
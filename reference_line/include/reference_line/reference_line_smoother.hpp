@@ -4,11 +4,18 @@
 #include <cppad/ipopt/solve.hpp>
 #include <glog/logging.h>
 #include "reference_point.hpp"
+#include "reference_line_smooth_qp_solver.hpp"
+#include "reference_line_smooth_tnlp.hpp"
+#include <coin/IpIpoptApplication.hpp>
 #include <planning_msgs/WayPoint.h>
 
 namespace planning {
 class ReferenceLineSmoother {
  public:
+  enum class Backend {
+    IPOPT,
+    QP
+  };
   typedef CPPAD_TESTVECTOR(CppAD::AD<double>) ADVector;
   typedef CPPAD_TESTVECTOR(double) DVector;
   ReferenceLineSmoother() = default;
@@ -23,6 +30,18 @@ class ReferenceLineSmoother {
   bool SmoothReferenceLine(const std::vector<ReferencePoint> &raw_points,
                            std::vector<ReferencePoint> *smoothed_ref_points);
 
+  /**
+   * @brief: smooth raw points whose leading points were smoothed before, e.g. by a reference line over the same
+   * lane. the known points are stitched as the overlap of the incremental mode: all but the last num_blend_points
+   * are kept, the rest is optimized warm started from them. the points are not optimized at all if they are all known
+   * @param raw_points
+   * @param known_smoothed_points: the smoothed positions of raw_points[0, known_smoothed_points.size())
+   * @param smoothed_ref_points
+   */
+  bool SmoothReferenceLine(const std::vector<ReferencePoint> &raw_points,
+                           const std::vector<ReferencePoint> &known_smoothed_points,
+                           std::vector<ReferencePoint> *smoothed_ref_points);
+
 //    bool GetSmoothReferenceLine(const ReferenceLine &raw_ref_line,
 //                                ReferenceLine *smoothed_ref_line);
   void SetSmoothParams(double deviation_weight,
@@ -30,14 +49,58 @@ class ReferenceLineSmoother {
                        double heading_weight,
                        double slack_weight,
                        double max_curvature);
+
+  /**
+   * @brief: in the incremental mode, the raw points overlapping the last smoothed raw points keep their last
+   * smoothed positions except for the last num_blend_points of the overlap, only those and the new tail are optimized,
+   * warm started from the last solution
+   * @param incremental
+   * @param num_blend_points
+   */
+  void SetIncrementalParams(bool incremental, size_t num_blend_points);
+
+  /**
+   * @brief: forget the last solution, the next SmoothReferenceLine optimizes all the points
+   */
+  void ResetWarmStart();
+
+  /**
+   * @brief: solve the smoothing by ipopt, or by the sequential QP which keeps its factorization across the calls
+   * with the same number of points
+   */
+  void SetBackend(Backend backend) { this->backend_ = backend; }
+  Backend GetBackend() const { return backend_; }
+
+  /**
+   * @brief: let the ipopt backend record the tape once per number of points and weights and call ipopt through
+   * ReferenceLineSmoothTnlp, instead of CppAD::ipopt::solve taping every call
+   */
+  void SetCachedTape(bool cached_tape) { this->cached_tape_ = cached_tape; }
+
  private:
-  bool SetUpConstraint();
+  /**
+   * @brief: find the last raw points that the raw points start with
+   * @param raw_points
+   * @param offset: the index of raw_points[0] in the last raw points
+   * @param num_overlap: the number of leading raw_points equal to the last raw points from offset on
+   * @return: false if raw_points[0] is not one of the last raw points
+   */
+  bool FindOverlap(const std::vector<ReferencePoint> &raw_points, size_t *offset, size_t *num_overlap) const;
+  bool SetUpConstraint(size_t num_fixed_points);
   void SetUpOptions();
-  void SetUpInitValue();
+  void SetUpInitValue(const std::vector<ReferencePoint> &init_points);
   bool TraceSmoothReferenceLine(
       const CppAD::ipopt::solve_result<DVector> &result,
       std::vector<ReferencePoint> *smoothed_ref_line) const;
 
+  /**
+   * @brief: solve the problem set up in x_l_, x_u_, g_u_ and xi_, append the smoothed points to smoothed_ref_line
+   */
+  bool SolveByIpopt(const std::vector<std::pair<double, double>> &xy, std::vector<ReferencePoint> *smoothed_ref_line);
+  bool SolveByQp(const std::vector<std::pair<double, double>> &xy, std::vector<ReferencePoint> *smoothed_ref_line);
+  bool SolveByCachedTape(const std::vector<std::pair<double, double>> &xy,
+                         std::vector<ReferencePoint> *smoothed_ref_line);
+
  private:
   std::vector<ReferencePoint> ref_points_;
   std::string options_;
@@ -63,6 +126,17 @@ class ReferenceLineSmoother {
   size_t num_of_constraint_{};
   size_t slack_constraint_start_index_{};
   size_t slack_constraint_end_index_{};
+  Backend backend_ = Backend::IPOPT;
+  ReferenceLineSmoothQpSolver qp_solver_;
+  bool cached_tape_ = false;
+  // created on the first cached tape solve, the tnlp keeps the tape
+  Ipopt::SmartPtr<Ipopt::IpoptApplication> ipopt_app_;
+  Ipopt::SmartPtr<ReferenceLineSmoothTnlp> tnlp_;
+  bool incremental_ = false;
+  size_t num_blend_points_ = 10;
+  // the raw and smoothed points of the last successful SmoothReferenceLine, only kept in the incremental mode
+  std::vector<ReferencePoint> last_raw_points_;
+  std::vector<ReferencePoint> last_smoothed_points_;
 };
 
 }
@@ -0,0 +1,47 @@
+#ifndef CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_WAY_POINT_DECIMATOR_HPP_
+#define CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_WAY_POINT_DECIMATOR_HPP_
+#include <vector>
+#include <planning_msgs/WayPoint.h>
+
+namespace planning {
+
+/**
+ * @brief: picks the way points a reference line is smoothed over, sparse on the straights and dense in the curves
+ * and the junctions. the spacing at a way point is the longest chord min_spacing * 2^k up to max_spacing whose
+ * sagitta on the local curvature stays within max_deviation, and a way point is kept where its road s crosses the
+ * grid of that spacing. the grid is anchored to the road s, so the windows sliding along a lane keep the same
+ * points, which the warm start and the segment cache of the smoother rely on.
+ */
+class WayPointDecimator {
+ public:
+  /**
+   * @param min_spacing: the spacing in the sharpest curves, about the one of the way points keeps all of them
+   * @param max_spacing: the spacing on the straights
+   * @param max_deviation: the largest distance of the chord between two kept points from the curve
+   */
+  WayPointDecimator(double min_spacing, double max_spacing, double max_deviation);
+  ~WayPointDecimator() = default;
+
+  /**
+   * @brief: the indices of the way points kept, the first and the last ones, all the junction way points and the
+   * ones at a change of lane are always kept
+   * @param way_points
+   * @param indices: [out] in ascending order, all the way points if fewer than 4 would be kept
+   */
+  void Decimate(const std::vector<planning_msgs::WayPoint> &way_points, std::vector<size_t> *indices) const;
+
+ private:
+  /**
+   * @brief: the spacing of the grid for the curvature kappa
+   */
+  double Spacing(double kappa) const;
+
+  static bool IsSameLane(const planning_msgs::WayPoint &first, const planning_msgs::WayPoint &second);
+
+ private:
+  double min_spacing_;
+  double max_spacing_;
+  double max_deviation_;
+};
+}
+#endif //CATKIN_WS_SRC_LOCAL_PLANNER_INCLUDE_REFERENCE_LINE_WAY_POINT_DECIMATOR_HPP_
@@ -11,6 +11,35 @@ ReferenceLine::ReferenceLine(const std::vector<planning_msgs::WayPoint> &waypoin
     : way_points_(waypoints) {
   ROS_ASSERT(waypoints.size() >= 3);
   reference_smoother_ = std::make_shared<ReferenceLineSmoother>();
+  BuildReferencePoints();
+  bool result = BuildReferenceLineWithSpline();
+  ROS_ASSERT(result);
+  length_ = ref_line_spline_->ArcLength();
+  ROS_INFO("ReferenceLine's length : %lf", length_);
+}
+
+ReferenceLine::ReferenceLine(const std::vector<planning_msgs::WayPoint> &waypoints, const ReferenceLine &previous)
+    : way_points_(waypoints) {
+  ROS_ASSERT(waypoints.size() >= 3);
+  reference_smoother_ = std::make_shared<ReferenceLineSmoother>();
+  BuildReferencePoints();
+  if (previous.raw_spline_ == nullptr || !SlideReferenceLineWithSpline(previous)) {
+    bool result = BuildReferenceLineWithSpline();
+    ROS_ASSERT(result);
+    length_ = ref_line_spline_->ArcLength();
+    return;
+  }
+  length_ = ref_line_spline_->ArcLength();
+  s_offset_ = previous.s_offset_ + SlideShift(*previous.ref_line_spline_, reference_points_.front());
+  if (previous.smoothed_) {
+    // Smooth slides the smoothed spline of previous in turn
+    previous_smoothed_spline_ = previous.ref_line_spline_;
+    previous_s_offset_ = previous.s_offset_;
+  }
+}
+
+void ReferenceLine::BuildReferencePoints() {
+  const auto &waypoints = way_points_;
   size_t waypoints_size = waypoints.size();
   reference_points_.reserve(waypoints_size);
   left_boundary_.reserve(waypoints_size);
@@ -43,13 +72,18 @@ ReferenceLine::ReferenceLine(const std::vector<planning_msgs::WayPoint> &waypoin
         ref_point.y() + right_width * std::cos(ref_point.theta()));
   }
 
+  std::vector<double> way_point_xs, way_point_ys;
+  way_point_xs.reserve(waypoints_size);
+  way_point_ys.reserve(waypoints_size);
+  for (const auto &way_point : waypoints) {
+    way_point_xs.push_back(way_point.pose.position.x);
+    way_point_ys.push_back(way_point.pose.position.y);
+  }
+  way_point_index_ = std::make_shared<PointGridIndex>(way_point_xs, way_point_ys);
+
   ROS_ASSERT(reference_points_.size() == waypoints.size());
   ROS_ASSERT(left_boundary_.size() == waypoints.size());
   ROS_ASSERT(right_boundary_.size() == waypoints.size());
-  bool result = BuildReferenceLineWithSpline();
-  ROS_ASSERT(result);
-  length_ = ref_line_spline_->ArcLength();
-  ROS_INFO("ReferenceLine's length : %lf", length_);
 }
 
 FrenetFramePoint ReferenceLine::GetFrenetFramePoint(
@@ -79,34 +113,66 @@ FrenetFramePoint ReferenceLine::GetFrenetFramePoint(
 }
 
 ReferencePoint ReferenceLine::GetReferencePoint(double s) const {
-  double ref_x, ref_y;
-  double ref_dx, ref_dy;
-  double ref_ddx, ref_ddy;
-  double ref_dddx, ref_dddy;
-  ref_line_spline_->Evaluate(s, &ref_x, &ref_y);
-  ref_line_spline_->EvaluateFirstDerivative(s, &ref_dx, &ref_dy);
-  ref_line_spline_->EvaluateSecondDerivative(s, &ref_ddx, &ref_ddy);
-  ref_line_spline_->EvaluateThirdDerivative(s, &ref_dddx, &ref_dddy);
-  double ref_heading = MathUtils::NormalizeAngle(std::atan2(ref_dy, ref_dx));
-  double ref_kappa = MathUtils::CalcKappa(ref_dx, ref_dy, ref_ddx, ref_ddy);
-  double ref_dkappa = MathUtils::CalcDKappa(ref_dx, ref_dy, ref_ddx, ref_ddy, ref_dddx, ref_dddy);
-  return ReferencePoint(ref_x, ref_y, ref_heading, ref_kappa, ref_dkappa);
+  if (reference_point_table_ == nullptr || s < 0.0 || s > length_) {
+    return EvaluateReferencePoint(s);
+  }
+  const auto &table = *reference_point_table_;
+  const auto index = std::min(static_cast<size_t>(s / reference_point_table_resolution_), table.size() - 2);
+  const double s0 = static_cast<double>(index) * reference_point_table_resolution_;
+  const double s1 = std::min(s0 + reference_point_table_resolution_, length_);
+  if (s1 - s0 < 1e-9) {
+    return table[index];
+  }
+  return Interpolate(table[index], table[index + 1], s0, s1, s);
+}
+
+bool ReferenceLine::BuildReferencePointTable(double resolution) {
+  reference_point_table_.reset();
+  reference_point_table_resolution_ = 0.0;
+  if (resolution <= 0.0 || ref_line_spline_ == nullptr || length_ <= 0.0) {
+    return false;
+  }
+  // the last interval may be shorter than resolution, it ends at length_
+  const auto num_intervals = std::max<size_t>(1, static_cast<size_t>(std::ceil(length_ / resolution - 1e-9)));
+  const size_t num_samples = num_intervals + 1;
+  std::vector<double> sample_s(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    sample_s[i] = std::min(static_cast<double>(i) * resolution, length_);
+  }
+  // the samples are sorted, the spline walks its segments forward instead of searching each of them
+  std::vector<common::Spline2dPoint> spline_points;
+  ref_line_spline_->EvaluateAll(sample_s, common::Spline2d::ALL_ORDERS, &spline_points);
+  auto table = std::make_shared<std::vector<ReferencePoint>>();
+  table->reserve(num_samples);
+  for (const auto &spline_point : spline_points) {
+    table->push_back(ToReferencePoint(spline_point.x, spline_point.y, spline_point));
+  }
+  reference_point_table_ = std::move(table);
+  reference_point_table_resolution_ = resolution;
+  return true;
+}
+
+ReferencePoint ReferenceLine::EvaluateReferencePoint(double s) const {
+  common::Spline2dPoint spline_point;
+  ref_line_spline_->EvaluateAll(s, common::Spline2d::ALL_ORDERS, &spline_point);
+  return ToReferencePoint(spline_point.x, spline_point.y, spline_point);
+}
+
+ReferencePoint ReferenceLine::ToReferencePoint(double x, double y, const common::Spline2dPoint &point) {
+  double heading = MathUtils::NormalizeAngle(std::atan2(point.dy, point.dx));
+  double kappa = MathUtils::CalcKappa(point.dx, point.dy, point.ddx, point.ddy);
+  double dkappa = MathUtils::CalcDKappa(point.dx, point.dy, point.ddx, point.ddy, point.dddx, point.dddy);
+  return ReferencePoint(x, y, heading, kappa, dkappa);
 }
 
 ReferencePoint ReferenceLine::GetReferencePoint(double x, double y) const {
   ROS_ASSERT(!reference_points_.empty());
   double nearest_x, nearest_y, nearest_s;
   ref_line_spline_->GetNearestPointOnSpline(x, y, &nearest_x, &nearest_y, &nearest_s);
-  double ref_dx, ref_dy;
-  double ref_ddx, ref_ddy;
-  double ref_dddx, ref_dddy;
-  ref_line_spline_->EvaluateFirstDerivative(nearest_s, &ref_dx, &ref_dy);
-  ref_line_spline_->EvaluateSecondDerivative(nearest_s, &ref_ddx, &ref_ddy);
-  ref_line_spline_->EvaluateThirdDerivative(nearest_s, &ref_dddx, &ref_dddy);
-  double heading = MathUtils::NormalizeAngle(std::atan2(ref_dy, ref_dx));
-  double kappa = MathUtils::CalcKappa(ref_dx, ref_dy, ref_ddx, ref_ddy);
-  double dkappa = MathUtils::CalcDKappa(ref_dx, ref_dy, ref_ddx, ref_ddy, ref_dddx, ref_dddy);
-  return ReferencePoint(nearest_x, nearest_y, heading, kappa, dkappa);
+  common::Spline2dPoint spline_point;
+  ref_line_spline_->EvaluateAll(nearest_s, common::Spline2d::ALL_ORDERS & ~common::Spline2d::POSITION,
+                                &spline_point);
+  return ToReferencePoint(nearest_x, nearest_y, spline_point);
 }
 
 ReferencePoint ReferenceLine::GetReferencePoint(const std::pair<double, double> &xy) const {
@@ -169,41 +235,74 @@ bool ReferenceLine::IsOnLane(const SLBoundary &sl_boundary) const {
 }
 
 bool ReferenceLine::GetSLBoundary(const Box2d &box, SLBoundary *sl_boundary) const {
+  int hint_index = -1;
+  return GetSLBoundary(box, sl_boundary, &hint_index);
+}
+
+bool ReferenceLine::GetSLBoundary(const Box2d &box, SLBoundary *sl_boundary, int *hint_index) const {
+  const auto &corners = box.Corners();
+  return GetSLBoundaryOfVertices(corners.data(), corners.size(), sl_boundary, hint_index);
+}
+
+bool ReferenceLine::GetSLBoundary(const Polygon2d &polygon, SLBoundary *sl_boundary) const {
+  int hint_index = -1;
+  return GetSLBoundary(polygon, sl_boundary, &hint_index);
+}
+
+bool ReferenceLine::GetSLBoundary(const Polygon2d &polygon, SLBoundary *sl_boundary, int *hint_index) const {
+  if (polygon.NumOfVertices() < 3) {
+    return false;
+  }
+  const auto vertices = polygon.GetAllVertices();
+  return GetSLBoundaryOfVertices(vertices.data(), vertices.size(), sl_boundary, hint_index);
+}
+
+bool ReferenceLine::GetSLBoundaryOfVertices(const Eigen::Vector2d *vertices, size_t num_vertices,
+                                            SLBoundary *sl_boundary, int *hint_index) const {
 
   double start_s(std::numeric_limits<double>::max());
   double end_s(std::numeric_limits<double>::lowest());
   double start_l(std::numeric_limits<double>::max());
   double end_l(std::numeric_limits<double>::lowest());
-  std::vector<Eigen::Vector2d> corners = box.GetAllCorners();
   // The order must be counter-clockwise
-  std::vector<SLPoint> sl_corners;
-  for (const auto &point : corners) {
-    SLPoint sl_point;
-    if (!XYToSL(point, &sl_point)) {
-      return false;
-    }
-    sl_corners.push_back(std::move(sl_point));
+  // every vertex is followed by the middle point of its edge to the next vertex, so the batch walks along the outline.
+  // the outline of a box or a small polygon is projected on the stack, the larger ones on the heap
+  constexpr size_t kMaxInlineVertices = 8;
+  std::array<Eigen::Vector2d, 2 * kMaxInlineVertices> inline_xy_points;
+  std::array<SLPoint, 2 * kMaxInlineVertices> inline_sl_points;
+  std::vector<Eigen::Vector2d> heap_xy_points;
+  std::vector<SLPoint> heap_sl_points;
+  Eigen::Vector2d *xy_points = inline_xy_points.data();
+  SLPoint *sl_points = inline_sl_points.data();
+  if (num_vertices > kMaxInlineVertices) {
+    heap_xy_points.resize(2 * num_vertices);
+    heap_sl_points.resize(2 * num_vertices);
+    xy_points = heap_xy_points.data();
+    sl_points = heap_sl_points.data();
+  }
+  for (size_t i = 0; i < num_vertices; ++i) {
+    xy_points[2 * i] = vertices[i];
+    xy_points[2 * i + 1] = (vertices[i] + vertices[(i + 1) % num_vertices]) * 0.5;
+  }
+  if (!BatchXYToSL(xy_points, 2 * num_vertices, sl_points, hint_index)) {
+    return false;
   }
+  sl_boundary->boundary_points.reserve(sl_boundary->boundary_points.size() + 2 * num_vertices);
 
-  for (size_t i = 0; i < corners.size(); ++i) {
+  for (size_t i = 0; i < num_vertices; ++i) {
     auto index0 = i;
-    auto index1 = (i + 1) % corners.size();
-    const auto &p0 = corners[index0];
-    const auto &p1 = corners[index1];
-
-    const auto p_mid = (p0 + p1) * 0.5;
-    SLPoint sl_point_mid;
-    if (!XYToSL(p_mid, &sl_point_mid)) {
-      return false;
-    }
+    auto index1 = (i + 1) % num_vertices;
+    const auto &sl_corner0 = sl_points[2 * index0];
+    const auto &sl_corner1 = sl_points[2 * index1];
+    const auto &sl_point_mid = sl_points[2 * index0 + 1];
 
-    Eigen::Vector2d v0(sl_corners[index1].s - sl_corners[index0].s,
-                       sl_corners[index1].l - sl_corners[index0].l);
+    Eigen::Vector2d v0(sl_corner1.s - sl_corner0.s,
+                       sl_corner1.l - sl_corner0.l);
 
-    Eigen::Vector2d v1(sl_point_mid.s - sl_corners[index0].s,
-                       sl_point_mid.l - sl_corners[index0].l);
+    Eigen::Vector2d v1(sl_point_mid.s - sl_corner0.s,
+                       sl_point_mid.l - sl_corner0.l);
 
-    sl_boundary->boundary_points.push_back(sl_corners[index0]);
+    sl_boundary->boundary_points.push_back(sl_corner0);
 
     // sl_point is outside of polygon; add to the vertex list
     double cross_prod = v0.x() * v1.y() - v0.y() * v1.x();
@@ -250,6 +349,12 @@ bool ReferenceLine::XYToSL(const Eigen::Vector2d &xy, SLPoint *sl_point) const {
     ROS_FATAL("[ReferenceLine::XYToSL], Failed to Get NearestPointOnSpline {x: %lf, y:%lf}", xy(0), xy(1));
     return false;
   }
+  NearestPointToSL(xy, nearest_x, nearest_y, nearest_s, sl_point);
+  return true;
+}
+
+void ReferenceLine::NearestPointToSL(const Eigen::Vector2d &xy, double nearest_x, double nearest_y, double nearest_s,
+                                     SLPoint *sl_point) const {
   double x_der, y_der;
   Eigen::Vector2d heading;
 //  ref_line_spline_->EvaluateFirstDerivative(nearest_s, &x_der, &y_der);
@@ -287,8 +392,34 @@ bool ReferenceLine::XYToSL(const Eigen::Vector2d &xy, SLPoint *sl_point) const {
                                           xy(1) - nearest_y);
     }
   }
-  return true;
+}
+
+bool ReferenceLine::BatchXYToSL(const std::vector<Eigen::Vector2d> &xy_points,
+                                std::vector<SLPoint> *sl_points,
+                                int *hint_index) const {
+  sl_points->resize(xy_points.size());
+  return BatchXYToSL(xy_points.data(), xy_points.size(), sl_points->data(), hint_index);
+}
 
+bool ReferenceLine::BatchXYToSL(const Eigen::Vector2d *xy_points, size_t num_points,
+                                SLPoint *sl_points, int *hint_index) const {
+  int local_hint_index = -1;
+  int *hint = hint_index == nullptr ? &local_hint_index : hint_index;
+  for (size_t i = 0; i < num_points; ++i) {
+    const auto &xy = xy_points[i];
+    double nearest_x, nearest_y, nearest_s;
+    if (!ref_line_spline_->GetNearestPointOnSpline(xy(0), xy(1), &nearest_x, &nearest_y, &nearest_s, hint)) {
+      // the warm start may have settled in a wrong local minimum, retry with a global search
+      *hint = -1;
+      if (!ref_line_spline_->GetNearestPointOnSpline(xy(0), xy(1), &nearest_x, &nearest_y, &nearest_s, hint)) {
+        ROS_FATAL("[ReferenceLine::BatchXYToSL], Failed to Get NearestPointOnSpline {x: %lf, y:%lf}", xy(0), xy(1));
+        *hint = -1;
+        return false;
+      }
+    }
+    NearestPointToSL(xy, nearest_x, nearest_y, nearest_s, &sl_points[i]);
+  }
+  return true;
 }
 
 bool ReferenceLine::XYToSL(double x, double y, SLPoint *sl_point) const {
@@ -367,6 +498,7 @@ bool ReferenceLine::BuildReferenceLineWithSpline() {
 
   }
   ref_line_spline_ = std::make_shared<Spline2d>(xs, ys);
+  raw_spline_ = ref_line_spline_;
 //  std::cout << "ref_line_spline's length " << ref_line_spline_->ArcLength() << std::endl;
   std::vector<double> xs_left, ys_left;
   xs_left.reserve(left_boundary_.size());
@@ -391,15 +523,75 @@ bool ReferenceLine::BuildReferenceLineWithSpline() {
   return true;
 }
 
+bool ReferenceLine::SlideReferenceLineWithSpline(const ReferenceLine &previous) {
+  // the splines of previous are shared with the reference lines already handed out, so the copies are refitted
+  auto refit = [](const std::shared_ptr<Spline2d> &previous_spline, const std::vector<double> &xs,
+                  const std::vector<double> &ys) -> std::shared_ptr<Spline2d> {
+    double shift = 0.0;
+    auto spline = std::make_shared<Spline2d>(*previous_spline);
+    if (!spline->Refit(xs, ys, &shift)) {
+      return std::make_shared<Spline2d>(xs, ys);
+    }
+    return spline;
+  };
+  std::vector<double> xs, ys;
+  xs.reserve(reference_points_.size());
+  ys.reserve(reference_points_.size());
+  for (const auto &ref_point : reference_points_) {
+    xs.push_back(ref_point.x());
+    ys.push_back(ref_point.y());
+  }
+  double shift = 0.0;
+  auto raw_spline = std::make_shared<Spline2d>(*previous.raw_spline_);
+  if (!raw_spline->Refit(xs, ys, &shift)) {
+    return false;
+  }
+  ref_line_spline_ = raw_spline_ = std::move(raw_spline);
+  std::vector<double> xs_left, ys_left;
+  xs_left.reserve(left_boundary_.size());
+  ys_left.reserve(left_boundary_.size());
+  for (const auto &left : left_boundary_) {
+    xs_left.push_back(left.x());
+    ys_left.push_back(left.y());
+  }
+  left_boundary_spline_ = refit(previous.left_boundary_spline_, xs_left, ys_left);
+  std::vector<double> xs_right, ys_right;
+  xs_right.reserve(right_boundary_.size());
+  ys_right.reserve(right_boundary_.size());
+  for (const auto &right : right_boundary_) {
+    xs_right.push_back(right.x());
+    ys_right.push_back(right.y());
+  }
+  right_boundary_spline_ = refit(previous.right_boundary_spline_, xs_right, ys_right);
+  return true;
+}
+
+double ReferenceLine::SlideShift(const Spline2d &previous_spline, const ReferencePoint &first_point) {
+  double nearest_x, nearest_y, nearest_s = 0.0;
+  previous_spline.GetNearestPointOnSpline(first_point.x(), first_point.y(), &nearest_x, &nearest_y, &nearest_s);
+  return nearest_s;
+}
+
 bool ReferenceLine::Smooth(const double deviation_weight,
                            const double heading_weight,
                            const double distance_weight,
                            const double slack_weight,
                            const double max_curvature) {
-  const auto way_points = way_points_;
   std::vector<ReferencePoint> ref_point;
+  std::vector<ReferencePoint> cached_points;
+  if (segment_cache_ != nullptr) {
+    segment_cache_->Lookup(way_points_, &cached_points);
+  }
   reference_smoother_->SetSmoothParams(deviation_weight, distance_weight, heading_weight, slack_weight, max_curvature);
-  bool result = reference_smoother_->SmoothReferenceLine(reference_points_, &ref_point);
+  std::vector<size_t> kept_indices;
+  if (way_point_decimator_ != nullptr) {
+    way_point_decimator_->Decimate(way_points_, &kept_indices);
+  }
+  bool result = !kept_indices.empty() && kept_indices.size() < reference_points_.size()
+                ? SmoothDecimated(kept_indices, cached_points, &ref_point)
+                : reference_smoother_->SmoothReferenceLine(reference_points_, cached_points, &ref_point);
+  // the previous smoothed spline is only of use to the first smoothing
+  const auto previous_smoothed_spline = std::move(previous_smoothed_spline_);
   if (reference_points_.size() != ref_point.size()) {
     return false;
   }
@@ -408,6 +600,9 @@ bool ReferenceLine::Smooth(const double deviation_weight,
     return false;
   }
   smoothed_ = true;
+  if (segment_cache_ != nullptr) {
+    segment_cache_->Insert(way_points_, ref_point);
+  }
   std::vector<double> xs, ys;
   xs.reserve(ref_point.size());
   ys.reserve(ref_point.size());
@@ -415,8 +610,99 @@ bool ReferenceLine::Smooth(const double deviation_weight,
     xs.push_back(reference_point.x());
     ys.push_back(reference_point.y());
   }
-  ref_line_spline_.reset(new Spline2d(xs, ys));
+  // the smoothed points the previous reference line shares with this one are the same when the smoother stitches
+  // them or takes them from the segment cache, only the segments after them are fitted again then
+  std::shared_ptr<Spline2d> smoothed_spline;
+  double shift = 0.0;
+  if (previous_smoothed_spline != nullptr) {
+    smoothed_spline = std::make_shared<Spline2d>(*previous_smoothed_spline);
+    if (!smoothed_spline->Refit(xs, ys, &shift)) {
+      smoothed_spline.reset();
+      shift = SlideShift(*previous_smoothed_spline, ref_point.front());
+    }
+    s_offset_ = previous_s_offset_ + shift;
+  }
+  if (smoothed_spline == nullptr) {
+    smoothed_spline = std::make_shared<Spline2d>(xs, ys);
+  }
+  ref_line_spline_ = std::move(smoothed_spline);
   length_ = ref_line_spline_->ArcLength();
+  if (HasReferencePointTable()) {
+    BuildReferencePointTable(reference_point_table_resolution_);
+  }
+  return true;
+}
+
+bool ReferenceLine::SmoothDecimated(const std::vector<size_t> &kept_indices,
+                                    const std::vector<ReferencePoint> &cached_points,
+                                    std::vector<ReferencePoint> *smoothed_points) const {
+  std::vector<ReferencePoint> kept_points;
+  std::vector<ReferencePoint> kept_cached_points;
+  kept_points.reserve(kept_indices.size());
+  for (const size_t index : kept_indices) {
+    kept_points.push_back(reference_points_[index]);
+    // the cached points are a prefix, so are the kept ones among them
+    if (index < cached_points.size()) {
+      kept_cached_points.push_back(cached_points[index]);
+    }
+  }
+  std::vector<ReferencePoint> kept_smoothed_points;
+  if (!reference_smoother_->SmoothReferenceLine(kept_points, kept_cached_points, &kept_smoothed_points)
+      || kept_smoothed_points.size() != kept_points.size()) {
+    return false;
+  }
+  // the cached points up to the last kept one the smoother left as it was are kept too, so the smoothed points
+  // still share them with the previous reference line
+  size_t num_stitched = 0;
+  for (size_t k = 0; k < kept_cached_points.size(); ++k) {
+    if (kept_smoothed_points[k].x() != kept_cached_points[k].x()
+        || kept_smoothed_points[k].y() != kept_cached_points[k].y()) {
+      break;
+    }
+    num_stitched = kept_indices[k] + 1;
+  }
+
+  std::vector<double> xs, ys;
+  xs.reserve(kept_smoothed_points.size());
+  ys.reserve(kept_smoothed_points.size());
+  for (const auto &point : kept_smoothed_points) {
+    xs.push_back(point.x());
+    ys.push_back(point.y());
+  }
+  const Spline2d kept_spline(xs, ys);
+  const auto &knots = kept_spline.ChordLength();
+  // a dropped point is resampled at the chord length of the spline in proportion to its raw distance between the
+  // kept points around it, the chord lengths are ascending so the spline walks its segments once
+  std::vector<double> raw_distances(reference_points_.size(), 0.0);
+  for (size_t i = 1; i < reference_points_.size(); ++i) {
+    raw_distances[i] = raw_distances[i - 1] + std::hypot(reference_points_[i].x() - reference_points_[i - 1].x(),
+                                                         reference_points_[i].y() - reference_points_[i - 1].y());
+  }
+  std::vector<size_t> resampled_indices;
+  std::vector<double> resampled_chord_lengths;
+  for (size_t k = 0; k + 1 < kept_indices.size(); ++k) {
+    const size_t first = kept_indices[k];
+    const size_t last = kept_indices[k + 1];
+    const double raw_length = raw_distances[last] - raw_distances[first];
+    for (size_t i = std::max(first + 1, num_stitched); i < last; ++i) {
+      const double ratio = raw_length > 0.0 ? (raw_distances[i] - raw_distances[first]) / raw_length : 0.0;
+      resampled_indices.push_back(i);
+      resampled_chord_lengths.push_back(knots[k] + ratio * (knots[k + 1] - knots[k]));
+    }
+  }
+  std::vector<common::Spline2dPoint> resampled_points;
+  kept_spline.EvaluateAll(resampled_chord_lengths, Spline2d::POSITION, &resampled_points);
+
+  smoothed_points->assign(reference_points_.size(), ReferencePoint());
+  for (size_t i = 0; i < num_stitched; ++i) {
+    (*smoothed_points)[i] = cached_points[i];
+  }
+  for (size_t k = 0; k < kept_indices.size(); ++k) {
+    (*smoothed_points)[kept_indices[k]] = kept_smoothed_points[k];
+  }
+  for (size_t j = 0; j < resampled_indices.size(); ++j) {
+    (*smoothed_points)[resampled_indices[j]].set_xy(resampled_points[j].x, resampled_points[j].y);
+  }
   return true;
 }
 
@@ -431,16 +717,7 @@ double ReferenceLine::GetDrivingWidth(const SLBoundary &sl_boundary) const {
 }
 
 planning_msgs::WayPoint ReferenceLine::NearestWayPoint(double x, double y, size_t *index) const {
-  size_t way_point_size = way_points_.size();
-  double min_dist = std::numeric_limits<double>::infinity();
-  size_t min_index = 0;
-  for (size_t i = 0; i < way_point_size; ++i) {
-    double dist = std::hypot(x - way_points_[i].pose.position.x, y - way_points_[i].pose.position.y);
-    if (dist < min_dist) {
-      min_dist = dist;
-      min_index = i;
-    }
-  }
+  size_t min_index = way_point_index_->Nearest(x, y);
   *index = min_index;
   return way_points_[min_index];
 }
@@ -457,19 +734,14 @@ bool ReferenceLine::GetMatchedPoint(double x, double y, ReferencePoint *matched_
   if (!ref_line_spline_->GetNearestPointOnSpline(x, y, &nearest_x, &nearest_y, &nearest_s)) {
     return false;
   }
-  double ref_dx, ref_dy;
-  double ref_ddx, ref_ddy;
-  double ref_dddx, ref_dddy;
-  ref_line_spline_->EvaluateFirstDerivative(nearest_s, &ref_dx, &ref_dy);
-  ref_line_spline_->EvaluateSecondDerivative(nearest_s, &ref_ddx, &ref_ddy);
-  ref_line_spline_->EvaluateThirdDerivative(nearest_s, &ref_dddx, &ref_dddy);
-  double heading = MathUtils::NormalizeAngle(std::atan2(ref_dy, ref_dx));
-  double kappa = MathUtils::CalcKappa(ref_dx, ref_dy, ref_ddx, ref_ddy);
-  double dkappa = MathUtils::CalcDKappa(ref_dx, ref_dy, ref_ddx, ref_ddy, ref_dddx, ref_dddy);
+  common::Spline2dPoint spline_point;
+  ref_line_spline_->EvaluateAll(nearest_s, common::Spline2d::ALL_ORDERS & ~common::Spline2d::POSITION,
+                                &spline_point);
+  const ReferencePoint ref_point = ToReferencePoint(nearest_x, nearest_y, spline_point);
   matched_ref_point->set_xy(nearest_x, nearest_y);
-  matched_ref_point->set_theta(heading);
-  matched_ref_point->set_kappa(kappa);
-  matched_ref_point->set_dkappa(dkappa);
+  matched_ref_point->set_theta(ref_point.theta());
+  matched_ref_point->set_kappa(ref_point.kappa());
+  matched_ref_point->set_dkappa(ref_point.dkappa());
   *matched_s = nearest_s;
   return true;
 }
@@ -482,9 +754,18 @@ ReferenceLine::ReferenceLine(const ReferenceLine &other) {
   right_boundary_ = other.right_boundary_;
   length_ = other.length_; // the total length of this reference line
   ref_line_spline_ = other.ref_line_spline_;
+  raw_spline_ = other.raw_spline_;
+  previous_smoothed_spline_ = other.previous_smoothed_spline_;
+  previous_s_offset_ = other.previous_s_offset_;
+  s_offset_ = other.s_offset_;
   left_boundary_spline_ = other.left_boundary_spline_;
   right_boundary_spline_ = other.right_boundary_spline_;
   reference_smoother_ = other.reference_smoother_;
+  segment_cache_ = other.segment_cache_;
+  way_point_decimator_ = other.way_point_decimator_;
+  way_point_index_ = other.way_point_index_;
+  reference_point_table_ = other.reference_point_table_;
+  reference_point_table_resolution_ = other.reference_point_table_resolution_;
   priority_ = other.priority_;
 }
 
@@ -0,0 +1,111 @@
+#include "reference_line/reference_line_segment_cache.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace planning {
+namespace {
+// the raw points are the way points of the map, so a cached point either has the same position or is another one
+constexpr double kEpsilon = 1e-6;
+}
+
+ReferenceLineSegmentCache::ReferenceLineSegmentCache(size_t capacity) : capacity_(capacity) {}
+
+uint64_t ReferenceLineSegmentCache::LaneKey(const planning_msgs::WayPoint &way_point) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(way_point.road_id)) << 32u)
+      ^ (static_cast<uint64_t>(static_cast<uint16_t>(way_point.section_id)) << 16u)
+      ^ static_cast<uint64_t>(static_cast<uint16_t>(way_point.lane_id));
+}
+
+int64_t ReferenceLineSegmentCache::SKey(const planning_msgs::WayPoint &way_point) {
+  return static_cast<int64_t>(std::llround(way_point.s * 100.0));
+}
+
+size_t ReferenceLineSegmentCache::Lookup(const std::vector<planning_msgs::WayPoint> &way_points,
+                                         std::vector<ReferencePoint> *smoothed_points) {
+  smoothed_points->clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++tick_;
+  for (const auto &way_point : way_points) {
+    const auto lane = lanes_.find(LaneKey(way_point));
+    if (lane == lanes_.end()) {
+      break;
+    }
+    const auto point = lane->second.find(SKey(way_point));
+    if (point == lane->second.end()
+        || std::fabs(point->second.raw_x - way_point.pose.position.x) > kEpsilon
+        || std::fabs(point->second.raw_y - way_point.pose.position.y) > kEpsilon) {
+      break;
+    }
+    point->second.last_use = tick_;
+    smoothed_points->push_back(point->second.smoothed_point);
+  }
+  return smoothed_points->size();
+}
+
+void ReferenceLineSegmentCache::Insert(const std::vector<planning_msgs::WayPoint> &way_points,
+                                       const std::vector<ReferencePoint> &smoothed_points) {
+  if (capacity_ == 0 || way_points.size() != smoothed_points.size()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++tick_;
+  for (size_t i = 0; i < way_points.size(); ++i) {
+    auto &lane = lanes_[LaneKey(way_points[i])];
+    auto inserted = lane.emplace(SKey(way_points[i]), CachedPoint());
+    if (inserted.second) {
+      ++size_;
+    }
+    auto &point = inserted.first->second;
+    point.raw_x = way_points[i].pose.position.x;
+    point.raw_y = way_points[i].pose.position.y;
+    point.smoothed_point = smoothed_points[i];
+    point.last_use = tick_;
+  }
+  if (size_ > capacity_) {
+    Evict();
+  }
+}
+
+void ReferenceLineSegmentCache::Evict() {
+  const size_t num_kept = capacity_ * 3 / 4;
+  if (num_kept == 0) {
+    lanes_.clear();
+    size_ = 0;
+    return;
+  }
+  std::vector<uint64_t> last_uses;
+  last_uses.reserve(size_);
+  for (const auto &lane : lanes_) {
+    for (const auto &point : lane.second) {
+      last_uses.push_back(point.second.last_use);
+    }
+  }
+  const size_t num_dropped = last_uses.size() - num_kept;
+  std::nth_element(last_uses.begin(), last_uses.begin() + num_dropped, last_uses.end());
+  // the points used in the same call share a tick, the ones at the threshold are kept together
+  const uint64_t threshold = last_uses[num_dropped];
+  for (auto lane = lanes_.begin(); lane != lanes_.end();) {
+    for (auto point = lane->second.begin(); point != lane->second.end();) {
+      if (point->second.last_use < threshold) {
+        point = lane->second.erase(point);
+        --size_;
+      } else {
+        ++point;
+      }
+    }
+    lane = lane->second.empty() ? lanes_.erase(lane) : std::next(lane);
+  }
+}
+
+size_t ReferenceLineSegmentCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+void ReferenceLineSegmentCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lanes_.clear();
+  size_ = 0;
+}
+
+}
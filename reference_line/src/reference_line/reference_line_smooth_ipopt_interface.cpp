@@ -7,6 +7,17 @@ namespace planning {
 void ReferenceLineSmoothIpoptInterface::operator()(
     ReferenceLineSmoothIpoptInterface::ADvector &fg,
     const ReferenceLineSmoothIpoptInterface::ADvector &x) {
+  ADvector ref_xy(2 * num_of_points_);
+  for (size_t i = 0; i < num_of_points_; ++i) {
+    ref_xy[2 * i] = ref_points_[i].first;
+    ref_xy[2 * i + 1] = ref_points_[i].second;
+  }
+  Evaluate(fg, x, ref_xy);
+}
+
+void ReferenceLineSmoothIpoptInterface::Evaluate(ReferenceLineSmoothIpoptInterface::ADvector &fg,
+                                                 const ReferenceLineSmoothIpoptInterface::ADvector &x,
+                                                 const ReferenceLineSmoothIpoptInterface::ADvector &ref_xy) const {
 //  size_t point_num = ref_points_.size();
   assert(x.size() == num_of_variables_);
 //  assert(fg.size() == 1);
@@ -15,8 +26,8 @@ void ReferenceLineSmoothIpoptInterface::operator()(
   // deviation from origin reference line
   for (size_t i = 0; i < num_of_points_; ++i) {
     size_t index = i * 2;
-    fg[0] += ref_deviation_weight_ * ((x[index] - ref_points_[i].first) * (x[index] - ref_points_[i].first)
-        + (x[index + 1] - ref_points_[i].second) * (x[index + 1] - ref_points_[i].second));
+    fg[0] += ref_deviation_weight_ * ((x[index] - ref_xy[index]) * (x[index] - ref_xy[index])
+        + (x[index + 1] - ref_xy[index + 1]) * (x[index + 1] - ref_xy[index + 1]));
   }
   // the theta error cost;
   for (size_t i = 0; i < num_of_points_ - 2; ++i) {
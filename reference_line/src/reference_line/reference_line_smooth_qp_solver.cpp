@@ -0,0 +1,156 @@
+#include "reference_line/reference_line_smooth_qp_solver.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace planning {
+namespace {
+constexpr double kInfinity = 1e20;
+// the SQP stops once the curvature violation is below this share of the bound
+constexpr double kCurvatureTolerance = 0.01;
+}
+
+bool ReferenceLineSmoothQpSolver::Solve(const std::vector<std::pair<double, double>> &ref_points,
+                                        const std::vector<double> &init_value,
+                                        const std::vector<double> &lower_bound,
+                                        const std::vector<double> &upper_bound,
+                                        double curvature_bound,
+                                        std::vector<double> *solution) {
+  const size_t num_points = ref_points.size();
+  const size_t num_variables = 2 * num_points;
+  if (solution == nullptr || num_points < 3 || init_value.size() < num_variables
+      || lower_bound.size() < num_variables || upper_bound.size() < num_variables) {
+    return false;
+  }
+  // solve around the first raw point, so the tolerances do not depend on where the map origin is
+  const double origin_x = ref_points.front().first;
+  const double origin_y = ref_points.front().second;
+  std::vector<std::pair<double, double>> local_ref_points;
+  local_ref_points.reserve(num_points);
+  for (const auto &ref_point : ref_points) {
+    local_ref_points.emplace_back(ref_point.first - origin_x, ref_point.second - origin_y);
+  }
+  std::vector<double> local_lower_bound(num_variables);
+  std::vector<double> local_upper_bound(num_variables);
+  Eigen::VectorXd x(num_variables);
+  for (size_t i = 0; i < num_variables; ++i) {
+    const double origin = i % 2 == 0 ? origin_x : origin_y;
+    local_lower_bound[i] = lower_bound[i] - origin;
+    local_upper_bound[i] = upper_bound[i] - origin;
+    x[i] = std::min(std::max(init_value[i] - origin, local_lower_bound[i]), local_upper_bound[i]);
+  }
+
+  num_points_ = num_points;
+  SetUpCost(local_ref_points);
+  // every linearization is warm started from the iterates of the last one
+  qp_solver_.set_max_iter(max_admm_iter_);
+  qp_solver_.SetWarmStart(x);
+  bool converged = false;
+  for (int iter = 0; iter < max_sqp_iter_; ++iter) {
+    SetUpConstraint(qp_solver_.x(), local_lower_bound, local_upper_bound, curvature_bound);
+    converged = qp_solver_.Solve(P_, q_, A_, l_, u_);
+    if (!converged) {
+      break;
+    }
+    if (MaxCurvatureViolation(qp_solver_.x(), curvature_bound) < kCurvatureTolerance * curvature_bound) {
+      break;
+    }
+  }
+  if (!converged) {
+    return false;
+  }
+  const Eigen::VectorXd &solved_x = qp_solver_.x();
+  solution->resize(num_variables);
+  for (size_t i = 0; i < num_variables; ++i) {
+    (*solution)[i] = solved_x[i] + (i % 2 == 0 ? origin_x : origin_y);
+  }
+  return true;
+}
+
+void ReferenceLineSmoothQpSolver::SetUpCost(const std::vector<std::pair<double, double>> &ref_points) {
+  const size_t num_variables = 2 * num_points_;
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(num_variables * 13);
+  q_.resize(num_variables);
+  // 0.5 * x'Px + q'x equals the cost of ReferenceLineSmoothIpoptInterface without the unused slack variables
+  for (size_t i = 0; i < num_points_; ++i) {
+    for (size_t c = 0; c < 2; ++c) {
+      const size_t index = 2 * i + c;
+      const double ref = c == 0 ? ref_points[i].first : ref_points[i].second;
+      triplets.emplace_back(index, index, 2.0 * ref_deviation_weight_);
+      q_[index] = -2.0 * ref_deviation_weight_ * ref;
+    }
+  }
+  const double heading_coeffs[3] = {1.0, -2.0, 1.0};
+  for (size_t i = 0; i + 2 < num_points_; ++i) {
+    for (size_t c = 0; c < 2; ++c) {
+      for (size_t j = 0; j < 3; ++j) {
+        for (size_t k = 0; k < 3; ++k) {
+          triplets.emplace_back(2 * (i + j) + c, 2 * (i + k) + c,
+                                2.0 * heading_weight_ * heading_coeffs[j] * heading_coeffs[k]);
+        }
+      }
+    }
+  }
+  const double length_coeffs[2] = {-1.0, 1.0};
+  for (size_t i = 0; i + 1 < num_points_; ++i) {
+    for (size_t c = 0; c < 2; ++c) {
+      for (size_t j = 0; j < 2; ++j) {
+        for (size_t k = 0; k < 2; ++k) {
+          triplets.emplace_back(2 * (i + j) + c, 2 * (i + k) + c,
+                                2.0 * length_weight_ * length_coeffs[j] * length_coeffs[k]);
+        }
+      }
+    }
+  }
+  P_.resize(num_variables, num_variables);
+  P_.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+void ReferenceLineSmoothQpSolver::SetUpConstraint(const Eigen::VectorXd &x,
+                                                  const std::vector<double> &lower_bound,
+                                                  const std::vector<double> &upper_bound,
+                                                  double curvature_bound) {
+  const size_t num_variables = 2 * num_points_;
+  const size_t num_constraints = num_variables + num_points_ - 2;
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(num_variables + 6 * (num_points_ - 2));
+  l_.resize(num_constraints);
+  u_.resize(num_constraints);
+  for (size_t i = 0; i < num_variables; ++i) {
+    triplets.emplace_back(i, i, 1.0);
+    l_[i] = lower_bound[i];
+    u_[i] = upper_bound[i];
+  }
+  // |d|^2 <= bound with d = p[i] + p[i + 2] - 2 * p[i + 1], linearized around the d of x:
+  // n.d <= (bound + |d_x|^2) / (2 * |d_x|), n = d_x / |d_x|.
+  // the zero coefficients are kept, so the pattern only depends on the number of points
+  const double coeffs[3] = {1.0, -2.0, 1.0};
+  for (size_t i = 0; i + 2 < num_points_; ++i) {
+    const size_t row = num_variables + i;
+    const double dx = x[2 * i] + x[2 * (i + 2)] - 2.0 * x[2 * (i + 1)];
+    const double dy = x[2 * i + 1] + x[2 * (i + 2) + 1] - 2.0 * x[2 * (i + 1) + 1];
+    const double norm = std::hypot(dx, dy);
+    const bool is_active = norm > 1e-9;
+    const double nx = is_active ? dx / norm : 0.0;
+    const double ny = is_active ? dy / norm : 0.0;
+    for (size_t j = 0; j < 3; ++j) {
+      triplets.emplace_back(row, 2 * (i + j), coeffs[j] * nx);
+      triplets.emplace_back(row, 2 * (i + j) + 1, coeffs[j] * ny);
+    }
+    l_[row] = -kInfinity;
+    u_[row] = is_active ? (curvature_bound + norm * norm) / (2.0 * norm) : kInfinity;
+  }
+  A_.resize(num_constraints, num_variables);
+  A_.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+double ReferenceLineSmoothQpSolver::MaxCurvatureViolation(const Eigen::VectorXd &x, double curvature_bound) const {
+  double max_violation = -kInfinity;
+  for (size_t i = 0; i + 2 < num_points_; ++i) {
+    const double dx = x[2 * i] + x[2 * (i + 2)] - 2.0 * x[2 * (i + 1)];
+    const double dy = x[2 * i + 1] + x[2 * (i + 2) + 1] - 2.0 * x[2 * (i + 1) + 1];
+    max_violation = std::max(max_violation, dx * dx + dy * dy - curvature_bound);
+  }
+  return max_violation;
+}
+}
@@ -0,0 +1,249 @@
+#include "reference_line/reference_line_smooth_tnlp.hpp"
+#include "reference_line/reference_line_smooth_ipopt_interface.hpp"
+
+namespace planning {
+namespace {
+// older CppAD::vector only assigns vectors of the same size
+void Assign(const ReferenceLineSmoothTnlp::DVector &src, ReferenceLineSmoothTnlp::DVector *dst) {
+  dst->resize(src.size());
+  for (size_t i = 0; i < src.size(); ++i) {
+    (*dst)[i] = src[i];
+  }
+}
+}
+
+void ReferenceLineSmoothTnlp::SetUp(const std::vector<std::pair<double, double>> &ref_points,
+                                    const std::vector<double> &weights,
+                                    const DVector &xi,
+                                    const DVector &x_l,
+                                    const DVector &x_u,
+                                    const DVector &g_l,
+                                    const DVector &g_u) {
+  if (ref_points.size() != num_of_points_ || weights != weights_) {
+    RecordTape(ref_points, weights);
+  }
+  Assign(xi, &xi_);
+  Assign(x_l, &x_l_);
+  Assign(x_u, &x_u_);
+  Assign(g_l, &g_l_);
+  Assign(g_u, &g_u_);
+  argument_.resize(num_of_variables_ + 2 * num_of_points_);
+  for (size_t i = 0; i < num_of_points_; ++i) {
+    argument_[num_of_variables_ + 2 * i] = ref_points[i].first;
+    argument_[num_of_variables_ + 2 * i + 1] = ref_points[i].second;
+  }
+  has_forward_ = false;
+  status_ = Ipopt::INTERNAL_ERROR;
+}
+
+void ReferenceLineSmoothTnlp::RecordTape(const std::vector<std::pair<double, double>> &ref_points,
+                                         const std::vector<double> &weights) {
+  ReferenceLineSmoothIpoptInterface interface(ref_points);
+  interface.set_ref_deviation_weight(weights[0]);
+  interface.set_heading_weight(weights[1]);
+  interface.set_length_weight(weights[2]);
+  interface.set_slack_weight(weights[3]);
+  num_of_points_ = ref_points.size();
+  num_of_variables_ = interface.num_of_variables();
+  num_of_constraint_ = interface.num_of_constraint();
+  weights_ = weights;
+  ++num_of_tapings_;
+
+  // the values only pick the branches of the recording, the cost has none
+  const size_t num_of_arguments = num_of_variables_ + 2 * num_of_points_;
+  ReferenceLineSmoothIpoptInterface::ADvector a_argument(num_of_arguments);
+  for (size_t i = 0; i < num_of_arguments; ++i) {
+    a_argument[i] = 0.0;
+  }
+  CppAD::Independent(a_argument);
+  ReferenceLineSmoothIpoptInterface::ADvector a_x(num_of_variables_);
+  ReferenceLineSmoothIpoptInterface::ADvector a_ref_xy(2 * num_of_points_);
+  for (size_t i = 0; i < num_of_variables_; ++i) {
+    a_x[i] = a_argument[i];
+  }
+  for (size_t i = 0; i < 2 * num_of_points_; ++i) {
+    a_ref_xy[i] = a_argument[num_of_variables_ + i];
+  }
+  ReferenceLineSmoothIpoptInterface::ADvector a_fg(num_of_constraint_ + 1);
+  interface.Evaluate(a_fg, a_x, a_ref_xy);
+  fg_fun_.Dependent(a_argument, a_fg);
+  fg_fun_.optimize();
+
+  // the jacobian pattern of fg, only the constraint rows and the x columns are evaluated
+  std::vector<std::set<size_t>> identity(num_of_arguments);
+  for (size_t i = 0; i < num_of_arguments; ++i) {
+    identity[i].insert(i);
+  }
+  jac_pattern_ = fg_fun_.ForSparseJac(num_of_arguments, identity);
+  jac_rows_.clear();
+  jac_cols_.clear();
+  for (size_t row = 1; row < jac_pattern_.size(); ++row) {
+    for (const size_t col : jac_pattern_[row]) {
+      if (col < num_of_variables_) {
+        jac_rows_.push_back(row);
+        jac_cols_.push_back(col);
+      }
+    }
+  }
+  // the hessian pattern of the sum of fg contains the one of any lagrangian
+  std::vector<std::set<size_t>> all_rows(1);
+  for (size_t row = 0; row < num_of_constraint_ + 1; ++row) {
+    all_rows[0].insert(row);
+  }
+  hes_pattern_ = fg_fun_.RevSparseHes(num_of_arguments, all_rows);
+  hes_rows_.clear();
+  hes_cols_.clear();
+  for (size_t row = 0; row < num_of_variables_; ++row) {
+    for (const size_t col : hes_pattern_[row]) {
+      if (col <= row) {
+        hes_rows_.push_back(row);
+        hes_cols_.push_back(col);
+      }
+    }
+  }
+  // the colorings belong to the old patterns
+  jac_work_.clear();
+  hes_work_.clear();
+}
+
+void ReferenceLineSmoothTnlp::SetArgument(const Ipopt::Number *x) {
+  for (size_t i = 0; i < num_of_variables_; ++i) {
+    argument_[i] = x[i];
+  }
+}
+
+void ReferenceLineSmoothTnlp::Forward(const Ipopt::Number *x, bool new_x) {
+  if (!new_x && has_forward_) {
+    return;
+  }
+  SetArgument(x);
+  Assign(fg_fun_.Forward(0, argument_), &fg_);
+  has_forward_ = true;
+}
+
+bool ReferenceLineSmoothTnlp::get_nlp_info(Ipopt::Index &n, Ipopt::Index &m, Ipopt::Index &nnz_jac_g,
+                                           Ipopt::Index &nnz_h_lag, IndexStyleEnum &index_style) {
+  n = static_cast<Ipopt::Index>(num_of_variables_);
+  m = static_cast<Ipopt::Index>(num_of_constraint_);
+  nnz_jac_g = static_cast<Ipopt::Index>(jac_rows_.size());
+  nnz_h_lag = static_cast<Ipopt::Index>(hes_rows_.size());
+  index_style = C_STYLE;
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l, Ipopt::Number *x_u,
+                                              Ipopt::Index m, Ipopt::Number *g_l, Ipopt::Number *g_u) {
+  for (Ipopt::Index i = 0; i < n; ++i) {
+    x_l[i] = x_l_[i];
+    x_u[i] = x_u_[i];
+  }
+  for (Ipopt::Index i = 0; i < m; ++i) {
+    g_l[i] = g_l_[i];
+    g_u[i] = g_u_[i];
+  }
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number *x,
+                                                 bool init_z, Ipopt::Number *z_L, Ipopt::Number *z_U,
+                                                 Ipopt::Index m, bool init_lambda, Ipopt::Number *lambda) {
+  if (init_z || init_lambda) {
+    return false;
+  }
+  for (Ipopt::Index i = 0; init_x && i < n; ++i) {
+    x[i] = xi_[i];
+  }
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                                     Ipopt::Number &obj_value) {
+  Forward(x, new_x);
+  obj_value = fg_[0];
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                                          Ipopt::Number *grad_f) {
+  // the reverse sweep needs the forward sweep at x to be the last one
+  Forward(x, new_x);
+  DVector weight(num_of_constraint_ + 1);
+  for (size_t i = 0; i < num_of_constraint_ + 1; ++i) {
+    weight[i] = 0.0;
+  }
+  weight[0] = 1.0;
+  const DVector gradient = fg_fun_.Reverse(1, weight);
+  for (Ipopt::Index i = 0; i < n; ++i) {
+    grad_f[i] = gradient[i];
+  }
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::eval_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                                     Ipopt::Index m, Ipopt::Number *g) {
+  Forward(x, new_x);
+  for (Ipopt::Index i = 0; i < m; ++i) {
+    g[i] = fg_[i + 1];
+  }
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::eval_jac_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                                         Ipopt::Index m, Ipopt::Index nele_jac,
+                                         Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) {
+  if (values == nullptr) {
+    for (size_t k = 0; k < jac_rows_.size(); ++k) {
+      iRow[k] = static_cast<Ipopt::Index>(jac_rows_[k] - 1);
+      jCol[k] = static_cast<Ipopt::Index>(jac_cols_[k]);
+    }
+    return true;
+  }
+  SetArgument(x);
+  DVector jacobian(jac_rows_.size());
+  fg_fun_.SparseJacobianReverse(argument_, jac_pattern_, jac_rows_, jac_cols_, jacobian, jac_work_);
+  // the sparse jacobian leaves the zero order forward sweep at x
+  has_forward_ = false;
+  for (size_t k = 0; k < jac_rows_.size(); ++k) {
+    values[k] = jacobian[k];
+  }
+  return true;
+}
+
+bool ReferenceLineSmoothTnlp::eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                                     Ipopt::Number obj_factor, Ipopt::Index m, const Ipopt::Number *lambda,
+                                     bool new_lambda, Ipopt::Index nele_hess,
+                                     Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) {
+  if (values == nullptr) {
+    for (size_t k = 0; k < hes_rows_.size(); ++k) {
+      iRow[k] = static_cast<Ipopt::Index>(hes_rows_[k]);
+      jCol[k] = static_cast<Ipopt::Index>(hes_cols_[k]);
+    }
+    return true;
+  }
+  SetArgument(x);
+  DVector weight(num_of_constraint_ + 1);
+  weight[0] = obj_factor;
+  for (Ipopt::Index i = 0; i < m; ++i) {
+    weight[i + 1] = lambda[i];
+  }
+  DVector hessian(hes_rows_.size());
+  fg_fun_.SparseHessian(argument_, weight, hes_pattern_, hes_rows_, hes_cols_, hessian, hes_work_);
+  has_forward_ = false;
+  for (size_t k = 0; k < hes_rows_.size(); ++k) {
+    values[k] = hessian[k];
+  }
+  return true;
+}
+
+void ReferenceLineSmoothTnlp::finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number *x,
+                                                const Ipopt::Number *z_L, const Ipopt::Number *z_U,
+                                                Ipopt::Index m, const Ipopt::Number *g, const Ipopt::Number *lambda,
+                                                Ipopt::Number obj_value, const Ipopt::IpoptData *ip_data,
+                                                Ipopt::IpoptCalculatedQuantities *ip_cq) {
+  status_ = status;
+  solution_.resize(n);
+  for (Ipopt::Index i = 0; i < n; ++i) {
+    solution_[i] = x[i];
+  }
+}
+}
@@ -1,10 +1,22 @@
 #include "reference_line/reference_line_smoother.hpp"
 #include "reference_line/reference_line_smooth_ipopt_interface.hpp"
+#include <algorithm>
 
 
 namespace planning {
+namespace {
+// the points ahead of the optimized window that stay at their last smoothed positions, so the second differences
+// across the window start see the fixed prefix
+constexpr size_t kNumAnchorPoints = 2;
+}
+
+bool ReferenceLineSmoother::SmoothReferenceLine(const std::vector<ReferencePoint> &raw_points,
+                                                std::vector<ReferencePoint> *const smoothed_ref_points) {
+  return SmoothReferenceLine(raw_points, {}, smoothed_ref_points);
+}
 
 bool ReferenceLineSmoother::SmoothReferenceLine(const std::vector<ReferencePoint> &raw_points,
+                                                const std::vector<ReferencePoint> &known_smoothed_points,
                                                 std::vector<ReferencePoint> *const smoothed_ref_points) {
   if (smoothed_ref_points == nullptr) {
     ROS_FATAL("[ReferenceLineSmoother::GetSmoothReferenceLine],"
@@ -13,14 +25,47 @@ bool ReferenceLineSmoother::SmoothReferenceLine(const std::vector<ReferencePoint
   }
 
 //  way_points.route.reserve(waypoints.size());
-  ref_points_ = raw_points;
-
-  const size_t point_num = ref_points_.size();
-  if (point_num < 3) {
+  if (raw_points.size() < 3) {
     ROS_FATAL("[ReferenceLineSmoother::GetSmoothReferenceLine], "
               "the ref points num is less 3");
     return false;
   }
+  // the optimized window starts at window_start, the points before it are copied from the known smoothed points,
+  // the given ones or the overlap with the last solution, whichever is longer
+  size_t offset = 0;
+  size_t num_overlap = 0;
+  const ReferencePoint *known_points = known_smoothed_points.data();
+  size_t num_known = std::min(known_smoothed_points.size(), raw_points.size());
+  if (incremental_ && FindOverlap(raw_points, &offset, &num_overlap) && num_overlap > num_known) {
+    known_points = last_smoothed_points_.data() + offset;
+    num_known = num_overlap;
+  }
+  if (num_known == raw_points.size()) {
+    smoothed_ref_points->assign(known_points, known_points + num_known);
+    if (incremental_) {
+      last_raw_points_ = raw_points;
+      last_smoothed_points_ = *smoothed_ref_points;
+    }
+    return true;
+  }
+  size_t window_start = 0;
+  size_t num_fixed_points = 0;
+  if (num_known >= num_blend_points_ + kNumAnchorPoints) {
+    window_start = num_known - num_blend_points_ - kNumAnchorPoints;
+    num_fixed_points = kNumAnchorPoints;
+  }
+  ref_points_.assign(raw_points.begin() + window_start, raw_points.end());
+  if (ref_points_.size() < 3) {
+    window_start = 0;
+    num_fixed_points = 0;
+    ref_points_ = raw_points;
+  }
+  std::vector<ReferencePoint> init_points = ref_points_;
+  for (size_t i = 0; num_fixed_points > 0 && i < init_points.size() && window_start + i < num_known; ++i) {
+    init_points[i] = known_points[window_start + i];
+  }
+
+  const size_t point_num = ref_points_.size();
 
   num_of_points_ = point_num;
   num_of_slack_variable_ = num_of_points_ - 2;
@@ -40,17 +85,39 @@ bool ReferenceLineSmoother::SmoothReferenceLine(const std::vector<ReferencePoint
   for (const auto &ref_point : ref_points_) {
     xy.emplace_back(ref_point.x(), ref_point.y());
   }
+  SetUpOptions();
+  SetUpInitValue(init_points);
+  if (!this->SetUpConstraint(num_fixed_points)) {
+    ROS_ERROR("[ReferenceLineSmoother::SmoothReferenceLine], failed to set up the constraints");
+    return false;
+  }
+
+  smoothed_ref_points->clear();
+  smoothed_ref_points->reserve(raw_points.size());
+  for (size_t i = 0; i < window_start; ++i) {
+    smoothed_ref_points->push_back(known_points[i]);
+  }
+  bool result = backend_ == Backend::QP ? SolveByQp(xy, smoothed_ref_points) : SolveByIpopt(xy, smoothed_ref_points);
+  if (!result) {
+    smoothed_ref_points->clear();
+    ResetWarmStart();
+  } else if (incremental_) {
+    last_raw_points_ = raw_points;
+    last_smoothed_points_ = *smoothed_ref_points;
+  }
+  return result;
+}
+
+bool ReferenceLineSmoother::SolveByIpopt(const std::vector<std::pair<double, double>> &xy,
+                                         std::vector<ReferencePoint> *smoothed_ref_line) {
+  if (cached_tape_) {
+    return SolveByCachedTape(xy, smoothed_ref_line);
+  }
   ReferenceLineSmoothIpoptInterface smoother_interface(xy);
   smoother_interface.set_ref_deviation_weight(deviation_weight_);
   smoother_interface.set_heading_weight(heading_weight_);
   smoother_interface.set_length_weight(distance_weight_);
   smoother_interface.set_slack_weight(slack_weight_);
-  SetUpOptions();
-  SetUpInitValue();
-  if (!this->SetUpConstraint()) {
-    std::cout << "set up constraint error" << std::endl;
-    return false;
-  }
   CppAD::ipopt::solve_result<DVector> solution;
   CppAD::ipopt::solve<DVector, ReferenceLineSmoothIpoptInterface>(options_, xi_, x_l_, x_u_, g_l_, g_u_,
                                                                   smoother_interface, solution);
@@ -59,14 +126,97 @@ bool ReferenceLineSmoother::SmoothReferenceLine(const std::vector<ReferencePoint
            solution.status);
     return false;
   }
+  return this->TraceSmoothReferenceLine(solution, smoothed_ref_line);
+}
 
-  smoothed_ref_points->clear();
-  smoothed_ref_points->reserve(raw_points.size());
-  bool result = this->TraceSmoothReferenceLine(solution, smoothed_ref_points);
-  return result;
+bool ReferenceLineSmoother::SolveByCachedTape(const std::vector<std::pair<double, double>> &xy,
+                                              std::vector<ReferencePoint> *smoothed_ref_line) {
+  if (Ipopt::IsNull(ipopt_app_)) {
+    // the options of SetUpOptions
+    ipopt_app_ = IpoptApplicationFactory();
+    ipopt_app_->Options()->SetIntegerValue("print_level", 0);
+    ipopt_app_->Options()->SetStringValue("sb", "yes");
+    ipopt_app_->Options()->SetNumericValue("tol", 1e-5);
+    ipopt_app_->Options()->SetIntegerValue("max_iter", 15);
+    if (ipopt_app_->Initialize() != Ipopt::Solve_Succeeded) {
+      ROS_WARN("[ReferenceLineSmoother::SolveByCachedTape], failed to initialize ipopt");
+      ipopt_app_ = nullptr;
+      return false;
+    }
+    tnlp_ = new ReferenceLineSmoothTnlp();
+  }
+  tnlp_->SetUp(xy, {deviation_weight_, heading_weight_, distance_weight_, slack_weight_},
+               xi_, x_l_, x_u_, g_l_, g_u_);
+  ipopt_app_->OptimizeTNLP(Ipopt::SmartPtr<Ipopt::TNLP>(Ipopt::GetRawPtr(tnlp_)));
+  if (!tnlp_->succeeded() || tnlp_->solution().size() != num_of_variables_) {
+    ROS_WARN("[ReferenceLineSmoother::SolveByCachedTape], the cached tape solve failed");
+    return false;
+  }
+  ReferencePoint reference_point;
+  for (size_t i = 0; i < num_of_points_; ++i) {
+    reference_point.set_xy(tnlp_->solution()[2 * i], tnlp_->solution()[2 * i + 1]);
+    smoothed_ref_line->push_back(reference_point);
+  }
+  return true;
+}
+
+bool ReferenceLineSmoother::SolveByQp(const std::vector<std::pair<double, double>> &xy,
+                                      std::vector<ReferencePoint> *smoothed_ref_line) {
+  qp_solver_.set_ref_deviation_weight(deviation_weight_);
+  qp_solver_.set_heading_weight(heading_weight_);
+  qp_solver_.set_length_weight(distance_weight_);
+  // the position variables come first in the ipopt variables
+  const size_t num_position_variables = 2 * num_of_points_;
+  std::vector<double> init_value(num_position_variables);
+  std::vector<double> lower_bound(num_position_variables);
+  std::vector<double> upper_bound(num_position_variables);
+  for (size_t i = 0; i < num_position_variables; ++i) {
+    init_value[i] = xi_[i];
+    lower_bound[i] = x_l_[i];
+    upper_bound[i] = x_u_[i];
+  }
+  const double curvature_bound = num_curvature_constraint_ > 0 ? g_u_[curvature_constraint_start_index_] : 1e20;
+  std::vector<double> solution;
+  if (!qp_solver_.Solve(xy, init_value, lower_bound, upper_bound, curvature_bound, &solution)) {
+    ROS_WARN("[ReferenceLineSmoother::SolveByQp], the qp smoothing did not converge");
+    return false;
+  }
+  ReferencePoint reference_point;
+  for (size_t i = 0; i < num_of_points_; ++i) {
+    reference_point.set_xy(solution[2 * i], solution[2 * i + 1]);
+    smoothed_ref_line->push_back(reference_point);
+  }
+  return true;
+}
+
+bool ReferenceLineSmoother::FindOverlap(const std::vector<ReferencePoint> &raw_points,
+                                        size_t *offset,
+                                        size_t *num_overlap) const {
+  // the raw points are sampled from the same way points, so the overlapping ones are equal
+  constexpr double kEpsilon = 1e-6;
+  auto is_same = [](const ReferencePoint &p0, const ReferencePoint &p1) {
+    return std::fabs(p0.x() - p1.x()) < kEpsilon && std::fabs(p0.y() - p1.y()) < kEpsilon;
+  };
+  if (raw_points.empty() || last_smoothed_points_.size() != last_raw_points_.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < last_raw_points_.size(); ++i) {
+    if (!is_same(last_raw_points_[i], raw_points.front())) {
+      continue;
+    }
+    size_t num = 0;
+    while (i + num < last_raw_points_.size() && num < raw_points.size()
+        && is_same(last_raw_points_[i + num], raw_points[num])) {
+      ++num;
+    }
+    *offset = i;
+    *num_overlap = num;
+    return true;
+  }
+  return false;
 }
 
-bool ReferenceLineSmoother::SetUpConstraint() {
+bool ReferenceLineSmoother::SetUpConstraint(size_t num_fixed_points) {
 
   x_l_.resize(num_of_variables_);
   x_u_.resize(num_of_variables_);
@@ -91,6 +241,12 @@ bool ReferenceLineSmoother::SetUpConstraint() {
     x_l_[index + 1] = ref_points_[i].y() - boundary_bound[i];
     x_u_[index + 1] = ref_points_[i].y() + boundary_bound[i];
   }
+  // the anchor points are pinned to their warm start, i.e. the last smoothed positions
+  for (size_t i = 0; i < num_fixed_points && i < num_of_points_; ++i) {
+    size_t index = i * 2;
+    x_l_[index] = x_u_[index] = xi_[index];
+    x_l_[index + 1] = x_u_[index + 1] = xi_[index + 1];
+  }
 
   // slack variable
   for (size_t i = slack_variable_start_index_; i < slack_variable_end_index_; ++i) {
@@ -124,13 +280,13 @@ void ReferenceLineSmoother::SetUpOptions() {
   options_ += "Integer max_iter    15\n";
 }
 
-void ReferenceLineSmoother::SetUpInitValue() {
+void ReferenceLineSmoother::SetUpInitValue(const std::vector<ReferencePoint> &init_points) {
 
   xi_.resize(num_of_variables_);
   for (size_t i = 0; i < num_of_points_; ++i) {
     size_t index = i * 2;
-    xi_[index] = ref_points_[i].x();
-    xi_[index + 1] = ref_points_[i].y();
+    xi_[index] = init_points[i].x();
+    xi_[index + 1] = init_points[i].y();
   }
   // slack variables
   for (size_t i = slack_variable_start_index_; i < slack_variable_end_index_; ++i) {
@@ -185,4 +341,15 @@ void ReferenceLineSmoother::SetSmoothParams(double deviation_weight,
   slack_weight_ = slack_weight;
 }
 
+void ReferenceLineSmoother::SetIncrementalParams(bool incremental, size_t num_blend_points) {
+  incremental_ = incremental;
+  num_blend_points_ = num_blend_points;
+  ResetWarmStart();
+}
+
+void ReferenceLineSmoother::ResetWarmStart() {
+  last_raw_points_.clear();
+  last_smoothed_points_.clear();
+}
+
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include <tf/transform_datatypes.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #define private public
 #include "reference_line/reference_line.hpp"
@@ -522,6 +524,398 @@ TEST_F(ReferenceLineSmootherTest, spline2d_test) {
 //  }
 }
 
+TEST_F(ReferenceLineSmootherTest, incremental_smooth) {
+  const double radius = 50.0;
+  std::vector<ReferencePoint> raw_points;
+  for (size_t i = 0; i < 120; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    ReferencePoint ref_point;
+    ref_point.set_xy(radius * std::sin(theta), radius * (1.0 - std::cos(theta)));
+    raw_points.push_back(ref_point);
+  }
+  const size_t num_blend_points = 10;
+  smoother_->SetIncrementalParams(true, num_blend_points);
+  const std::vector<ReferencePoint> first_raw_points(raw_points.begin(), raw_points.begin() + 100);
+  std::vector<ReferencePoint> first_smoothed_points;
+  ASSERT_TRUE(smoother_->SmoothReferenceLine(first_raw_points, &first_smoothed_points));
+  // the window moves 20 points ahead
+  const std::vector<ReferencePoint> second_raw_points(raw_points.begin() + 20, raw_points.end());
+  std::vector<ReferencePoint> second_smoothed_points;
+  ASSERT_TRUE(smoother_->SmoothReferenceLine(second_raw_points, &second_smoothed_points));
+  ASSERT_EQ(second_smoothed_points.size(), second_raw_points.size());
+  // everything but the blend region of the overlap keeps its last position
+  for (size_t i = 0; i < 80 - num_blend_points; ++i) {
+    EXPECT_NEAR(second_smoothed_points[i].x(), first_smoothed_points[i + 20].x(), 1e-6);
+    EXPECT_NEAR(second_smoothed_points[i].y(), first_smoothed_points[i + 20].y(), 1e-6);
+  }
+  for (size_t i = 0; i < second_raw_points.size(); ++i) {
+    EXPECT_LT(std::hypot(second_smoothed_points[i].x() - second_raw_points[i].x(),
+                         second_smoothed_points[i].y() - second_raw_points[i].y()), 1.5 + 1e-6);
+  }
+}
+
+TEST_F(ReferenceLineSmootherTest, cached_tape_smooth) {
+  const double radius = 50.0;
+  std::vector<ReferencePoint> raw_points;
+  for (size_t i = 0; i < 100; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    const double noise = 0.2 * std::sin(1.3 * static_cast<double>(i));
+    ReferencePoint ref_point;
+    ref_point.set_xy((radius + noise) * std::sin(theta), radius - (radius + noise) * std::cos(theta));
+    raw_points.push_back(ref_point);
+  }
+  std::vector<ReferencePoint> expected_points;
+  ASSERT_TRUE(smoother_->SmoothReferenceLine(raw_points, &expected_points));
+  smoother_->SetCachedTape(true);
+  // the second call reuses the tape of the first one on shifted raw points
+  for (const double shift : {0.0, 3.0}) {
+    std::vector<ReferencePoint> shifted_raw_points = raw_points;
+    for (auto &ref_point : shifted_raw_points) {
+      ref_point.set_xy(ref_point.x() + shift, ref_point.y() - shift);
+    }
+    std::vector<ReferencePoint> smoothed_points;
+    ASSERT_TRUE(smoother_->SmoothReferenceLine(shifted_raw_points, &smoothed_points));
+    ASSERT_EQ(smoothed_points.size(), expected_points.size());
+    for (size_t i = 0; i < smoothed_points.size(); ++i) {
+      EXPECT_NEAR(smoothed_points[i].x(), expected_points[i].x() + shift, 1e-3);
+      EXPECT_NEAR(smoothed_points[i].y(), expected_points[i].y() - shift, 1e-3);
+    }
+  }
+}
+
+TEST_F(ReferenceLineSmootherTest, qp_backend_smooth) {
+  // a noisy circle of 320 points
+  const double radius = 60.0;
+  std::vector<ReferencePoint> raw_points;
+  for (size_t i = 0; i < 320; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    const double noise = 0.3 * std::sin(1.7 * static_cast<double>(i));
+    ReferencePoint ref_point;
+    ref_point.set_xy(100.0 + (radius + noise) * std::sin(theta), -200.0 + radius - (radius + noise) * std::cos(theta));
+    raw_points.push_back(ref_point);
+  }
+  auto max_second_difference = [](const std::vector<ReferencePoint> &points) {
+    double max_norm = 0.0;
+    for (size_t i = 1; i + 1 < points.size(); ++i) {
+      max_norm = std::max(max_norm, std::hypot(points[i - 1].x() + points[i + 1].x() - 2.0 * points[i].x(),
+                                               points[i - 1].y() + points[i + 1].y() - 2.0 * points[i].y()));
+    }
+    return max_norm;
+  };
+  const double max_curvature = 0.1;
+  smoother_->SetSmoothParams(10.0, 1.0, 100.0, 5.0, max_curvature);
+  smoother_->SetBackend(ReferenceLineSmoother::Backend::QP);
+  smoother_->SetIncrementalParams(true, 10);
+  const std::vector<ReferencePoint> first_raw_points(raw_points.begin(), raw_points.begin() + 300);
+  std::vector<ReferencePoint> first_smoothed_points;
+  ASSERT_TRUE(smoother_->SmoothReferenceLine(first_raw_points, &first_smoothed_points));
+  ASSERT_EQ(first_smoothed_points.size(), first_raw_points.size());
+  for (size_t i = 0; i < first_raw_points.size(); ++i) {
+    EXPECT_LT(std::fabs(first_smoothed_points[i].x() - first_raw_points[i].x()), 1.5 + 1e-3);
+    EXPECT_LT(std::fabs(first_smoothed_points[i].y() - first_raw_points[i].y()), 1.5 + 1e-3);
+  }
+  EXPECT_LT(max_second_difference(first_smoothed_points), 0.5 * max_second_difference(first_raw_points));
+  // the average ds is about 1 m, so the bound on the second difference is about max_curvature
+  EXPECT_LT(max_second_difference(first_smoothed_points), 1.05 * max_curvature);
+
+  // the warm started window keeps the prefix and pins the anchors
+  const std::vector<ReferencePoint> second_raw_points(raw_points.begin() + 20, raw_points.end());
+  std::vector<ReferencePoint> second_smoothed_points;
+  ASSERT_TRUE(smoother_->SmoothReferenceLine(second_raw_points, &second_smoothed_points));
+  ASSERT_EQ(second_smoothed_points.size(), second_raw_points.size());
+  for (size_t i = 0; i < 280 - 10; ++i) {
+    EXPECT_NEAR(second_smoothed_points[i].x(), first_smoothed_points[i + 20].x(), 1e-6);
+    EXPECT_NEAR(second_smoothed_points[i].y(), first_smoothed_points[i + 20].y(), 1e-6);
+  }
+  EXPECT_LT(max_second_difference(second_smoothed_points), 1.05 * max_curvature);
+}
+
+TEST(ReferenceLineTest, reference_point_table) {
+  const double radius = 50.0;
+  const double ds = 1.0;
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (size_t i = 0; i < 60; ++i) {
+    const double theta = static_cast<double>(i) * ds / radius;
+    planning_msgs::WayPoint way_point;
+    way_point.s = static_cast<double>(i) * ds;
+    way_point.pose.position.x = radius * std::sin(theta);
+    way_point.pose.position.y = radius * (1.0 - std::cos(theta));
+    way_point.pose.orientation = tf::createQuaternionMsgFromYaw(theta);
+    way_point.lane_width = 3.5;
+    way_point.id = i;
+    way_points.push_back(way_point);
+  }
+  auto ref_line = ReferenceLine(way_points);
+  EXPECT_FALSE(ref_line.HasReferencePointTable());
+  EXPECT_FALSE(ref_line.BuildReferencePointTable(0.0));
+  EXPECT_TRUE(ref_line.BuildReferencePointTable(0.1));
+  EXPECT_TRUE(ref_line.HasReferencePointTable());
+  const auto copied_ref_line = ref_line;
+  EXPECT_TRUE(copied_ref_line.HasReferencePointTable());
+  for (double s = 0.0; s <= ref_line.Length(); s += 0.37) {
+    const auto ref_point = copied_ref_line.GetReferencePoint(s);
+    const auto exact_ref_point = ref_line.EvaluateReferencePoint(s);
+    EXPECT_NEAR(ref_point.x(), exact_ref_point.x(), 1e-3);
+    EXPECT_NEAR(ref_point.y(), exact_ref_point.y(), 1e-3);
+    EXPECT_NEAR(ref_point.theta(), exact_ref_point.theta(), 1e-3);
+    EXPECT_NEAR(ref_point.kappa(), exact_ref_point.kappa(), 1e-3);
+  }
+  const auto end_ref_point = ref_line.GetReferencePoint(ref_line.Length());
+  const auto exact_end_ref_point = ref_line.EvaluateReferencePoint(ref_line.Length());
+  EXPECT_NEAR(end_ref_point.x(), exact_end_ref_point.x(), 1e-6);
+  EXPECT_NEAR(end_ref_point.y(), exact_end_ref_point.y(), 1e-6);
+}
+
+TEST(ReferenceLineSegmentCacheTest, lookup_insert_and_evict) {
+  std::vector<planning_msgs::WayPoint> way_points;
+  std::vector<ReferencePoint> smoothed_points;
+  for (size_t i = 0; i < 20; ++i) {
+    planning_msgs::WayPoint way_point;
+    way_point.road_id = 3;
+    way_point.lane_id = -1;
+    way_point.s = static_cast<double>(i);
+    way_point.pose.position.x = static_cast<double>(i);
+    way_points.push_back(way_point);
+    ReferencePoint smoothed_point;
+    smoothed_point.set_xy(static_cast<double>(i), 0.1);
+    smoothed_points.push_back(smoothed_point);
+  }
+  ReferenceLineSegmentCache cache(30);
+  std::vector<ReferencePoint> cached_points;
+  EXPECT_EQ(cache.Lookup(way_points, &cached_points), 0);
+  const std::vector<planning_msgs::WayPoint> first_way_points(way_points.begin(), way_points.begin() + 12);
+  cache.Insert(first_way_points,
+               std::vector<ReferencePoint>(smoothed_points.begin(), smoothed_points.begin() + 12));
+  // only the leading cached points count
+  const std::vector<planning_msgs::WayPoint> later_way_points(way_points.begin() + 5, way_points.end());
+  ASSERT_EQ(cache.Lookup(later_way_points, &cached_points), 7);
+  EXPECT_DOUBLE_EQ(cached_points.front().x(), 5.0);
+  EXPECT_DOUBLE_EQ(cached_points.back().y(), 0.1);
+  // another point of the lane at the same s
+  auto moved_way_points = first_way_points;
+  moved_way_points[0].pose.position.y = 1.0;
+  EXPECT_EQ(cache.Lookup(moved_way_points, &cached_points), 0);
+  // the same s on another lane
+  auto other_lane_way_points = first_way_points;
+  for (auto &way_point : other_lane_way_points) {
+    way_point.lane_id = 1;
+  }
+  EXPECT_EQ(cache.Lookup(other_lane_way_points, &cached_points), 0);
+  cache.Insert(other_lane_way_points,
+               std::vector<ReferencePoint>(smoothed_points.begin(), smoothed_points.begin() + 12));
+  EXPECT_EQ(cache.Size(), 24);
+  // the points of the first lane not looked up since its insert are the least recently used
+  cache.Insert(later_way_points, std::vector<ReferencePoint>(smoothed_points.begin() + 5, smoothed_points.end()));
+  EXPECT_EQ(cache.Size(), 27);
+  EXPECT_EQ(cache.Lookup(first_way_points, &cached_points), 0);
+  EXPECT_EQ(cache.Lookup(later_way_points, &cached_points), later_way_points.size());
+  EXPECT_EQ(cache.Lookup(other_lane_way_points, &cached_points), other_lane_way_points.size());
+}
+
+TEST(ReferenceLineTest, segment_cache_smooth) {
+  const double radius = 50.0;
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (size_t i = 0; i < 120; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    const double noise = 0.2 * std::sin(1.3 * static_cast<double>(i));
+    planning_msgs::WayPoint way_point;
+    way_point.road_id = 7;
+    way_point.lane_id = -1;
+    way_point.s = static_cast<double>(i);
+    way_point.pose.position.x = (radius + noise) * std::sin(theta);
+    way_point.pose.position.y = radius - (radius + noise) * std::cos(theta);
+    way_point.pose.orientation = tf::createQuaternionMsgFromYaw(theta);
+    way_point.lane_width = 3.5;
+    way_points.push_back(way_point);
+  }
+  const size_t num_blend_points = 10;
+  const auto segment_cache = std::make_shared<ReferenceLineSegmentCache>(1000);
+  // a fresh smoother per line, as after a route update, the cache alone carries the smoothed points
+  auto smooth = [&](const std::vector<planning_msgs::WayPoint> &lane) {
+    auto smoother = std::make_shared<ReferenceLineSmoother>();
+    smoother->SetIncrementalParams(true, num_blend_points);
+    ReferenceLine ref_line(lane);
+    ref_line.SetSmoother(smoother);
+    ref_line.SetSegmentCache(segment_cache);
+    EXPECT_TRUE(ref_line.Smooth(13.5, 100.0, 1.0, 5.0, 5.0));
+    return ref_line;
+  };
+  const std::vector<planning_msgs::WayPoint> first_way_points(way_points.begin(), way_points.begin() + 100);
+  smooth(first_way_points);
+  EXPECT_EQ(segment_cache->Size(), 100);
+  std::vector<ReferencePoint> first_smoothed_points;
+  ASSERT_EQ(segment_cache->Lookup(first_way_points, &first_smoothed_points), 100);
+
+  const std::vector<planning_msgs::WayPoint> second_way_points(way_points.begin() + 20, way_points.end());
+  const auto second_ref_line = smooth(second_way_points);
+  EXPECT_TRUE(second_ref_line.IsSmoothedReferenceLine());
+  std::vector<ReferencePoint> second_smoothed_points;
+  ASSERT_EQ(segment_cache->Lookup(second_way_points, &second_smoothed_points), 100);
+  // everything but the blend region of the cached points keeps its smoothed position
+  for (size_t i = 0; i < 80 - num_blend_points; ++i) {
+    EXPECT_NEAR(second_smoothed_points[i].x(), first_smoothed_points[i + 20].x(), 1e-6);
+    EXPECT_NEAR(second_smoothed_points[i].y(), first_smoothed_points[i + 20].y(), 1e-6);
+  }
+  // a line fully in the cache is not optimized again
+  const std::vector<planning_msgs::WayPoint> third_way_points(way_points.begin() + 30, way_points.begin() + 110);
+  smooth(third_way_points);
+  std::vector<ReferencePoint> third_smoothed_points;
+  ASSERT_EQ(segment_cache->Lookup(third_way_points, &third_smoothed_points), 80);
+  for (size_t i = 0; i < third_smoothed_points.size(); ++i) {
+    EXPECT_DOUBLE_EQ(third_smoothed_points[i].x(), second_smoothed_points[i + 10].x());
+  }
+}
+
+TEST(ReferenceLineTest, batch_xy_to_sl) {
+  const double radius = 50.0;
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (size_t i = 0; i < 60; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    planning_msgs::WayPoint way_point;
+    way_point.s = static_cast<double>(i);
+    way_point.pose.position.x = radius * std::sin(theta);
+    way_point.pose.position.y = radius * (1.0 - std::cos(theta));
+    way_point.pose.orientation = tf::createQuaternionMsgFromYaw(theta);
+    way_point.lane_width = 3.5;
+    way_point.id = i;
+    way_points.push_back(way_point);
+  }
+  auto ref_line = ReferenceLine(way_points);
+  // an obstacle driving along the lane
+  std::vector<Eigen::Vector2d> xy_points;
+  for (double s = 2.0; s < 55.0; s += 0.8) {
+    const double theta = s / radius;
+    const double l = 1.2;
+    xy_points.emplace_back((radius - l) * std::sin(theta), radius - (radius - l) * std::cos(theta));
+  }
+  std::vector<common::SLPoint> sl_points;
+  int hint_index = -1;
+  EXPECT_TRUE(ref_line.BatchXYToSL(xy_points, &sl_points, &hint_index));
+  EXPECT_GE(hint_index, 0);
+  ASSERT_EQ(sl_points.size(), xy_points.size());
+  for (size_t i = 0; i < xy_points.size(); ++i) {
+    common::SLPoint sl_point;
+    EXPECT_TRUE(ref_line.XYToSL(xy_points[i], &sl_point));
+    EXPECT_NEAR(sl_points[i].s, sl_point.s, 1e-4);
+    EXPECT_NEAR(sl_points[i].l, sl_point.l, 1e-4);
+  }
+}
+
+TEST(ReferenceLineTest, slide_from_previous) {
+  const double radius = 50.0;
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (size_t i = 0; i < 160; ++i) {
+    const double theta = static_cast<double>(i) / radius;
+    planning_msgs::WayPoint way_point;
+    way_point.s = static_cast<double>(i);
+    way_point.pose.position.x = radius * std::sin(theta);
+    way_point.pose.position.y = radius * (1.0 - std::cos(theta));
+    way_point.pose.orientation = tf::createQuaternionMsgFromYaw(theta);
+    way_point.lane_width = 3.5;
+    way_points.push_back(way_point);
+  }
+  const auto window = [&way_points](size_t first) {
+    return std::vector<planning_msgs::WayPoint>(way_points.begin() + first, way_points.begin() + first + 100);
+  };
+  const ReferenceLine first_ref_line(window(0));
+  const ReferenceLine slid_ref_line(window(25), first_ref_line);
+  const ReferenceLine fresh_ref_line(window(25));
+  EXPECT_NEAR(slid_ref_line.Length(), fresh_ref_line.Length(), 1e-6);
+  // s + SOffset() of a place is its s on the first reference line
+  common::SLPoint sl_point;
+  ASSERT_TRUE(first_ref_line.XYToSL(way_points[25].pose.position.x, way_points[25].pose.position.y, &sl_point));
+  EXPECT_NEAR(slid_ref_line.SOffset(), sl_point.s, 1e-6);
+  // the refit segments only differ from a fresh build by their boundary condition
+  for (double s = 20.0; s < fresh_ref_line.Length(); s += 2.5) {
+    const auto slid_point = slid_ref_line.GetReferencePoint(s);
+    const auto fresh_point = fresh_ref_line.GetReferencePoint(s);
+    EXPECT_NEAR(slid_point.x(), fresh_point.x(), 1e-3);
+    EXPECT_NEAR(slid_point.y(), fresh_point.y(), 1e-3);
+    double slid_left_width, slid_right_width, fresh_left_width, fresh_right_width;
+    ASSERT_TRUE(slid_ref_line.GetLaneWidth(s, &slid_left_width, &slid_right_width));
+    ASSERT_TRUE(fresh_ref_line.GetLaneWidth(s, &fresh_left_width, &fresh_right_width));
+    EXPECT_NEAR(slid_left_width, fresh_left_width, 1e-2);
+    EXPECT_NEAR(slid_right_width, fresh_right_width, 1e-2);
+  }
+  // the first reference line is shared with its readers, it is left as it was
+  ReferenceLine first_copy(window(0));
+  EXPECT_DOUBLE_EQ(first_ref_line.Length(), first_copy.Length());
+  // way points which do not continue the previous ones are built from scratch
+  const ReferenceLine other_ref_line(window(25), ReferenceLine(window(60)));
+  EXPECT_DOUBLE_EQ(other_ref_line.SOffset(), 0.0);
+  EXPECT_NEAR(other_ref_line.Length(), fresh_ref_line.Length(), 1e-9);
+}
+
+namespace {
+/**
+ * @brief: a 100 m straight along x and a quarter circle of radius 20 m after it, a way point every meter
+ */
+std::vector<planning_msgs::WayPoint> StraightThenCurve(size_t begin, size_t end) {
+  std::vector<planning_msgs::WayPoint> way_points;
+  for (size_t i = begin; i < end; ++i) {
+    planning_msgs::WayPoint way_point;
+    way_point.road_id = 2;
+    way_point.lane_id = -1;
+    way_point.s = static_cast<double>(i);
+    way_point.lane_width = 3.5;
+    if (i <= 100) {
+      way_point.pose.position.x = static_cast<double>(i);
+    } else {
+      const double angle = static_cast<double>(i - 100) / 20.0;
+      way_point.pose.position.x = 100.0 + 20.0 * std::sin(angle);
+      way_point.pose.position.y = 20.0 * (1.0 - std::cos(angle));
+    }
+    way_points.push_back(way_point);
+  }
+  return way_points;
+}
+}
+
+TEST(WayPointDecimatorTest, sparse_on_straights_dense_in_curves) {
+  const WayPointDecimator decimator(1.0, 8.0, 0.02);
+  const auto way_points = StraightThenCurve(0, 131);
+  std::vector<size_t> indices;
+  decimator.Decimate(way_points, &indices);
+  ASSERT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+  EXPECT_EQ(indices.front(), 0);
+  EXPECT_EQ(indices.back(), way_points.size() - 1);
+  // a 1 m chord is the only one within 2 cm of a 20 m radius
+  for (size_t i = 100; i < way_points.size(); ++i) {
+    EXPECT_TRUE(std::binary_search(indices.begin(), indices.end(), i)) << "i: " << i;
+  }
+  const auto num_straight = std::count_if(indices.begin(), indices.end(), [](size_t i) { return i < 95; });
+  EXPECT_LE(num_straight, 95 / 8 + 2);
+  // a window slid along the lane keeps the same points
+  std::vector<size_t> slid_indices;
+  decimator.Decimate(StraightThenCurve(13, 131), &slid_indices);
+  for (size_t k = 1; k + 1 < slid_indices.size(); ++k) {
+    EXPECT_TRUE(std::binary_search(indices.begin(), indices.end(), slid_indices[k] + 13));
+  }
+  // the junctions and the changes of lane are kept
+  auto junction_way_points = way_points;
+  for (size_t i = 30; i < 40; ++i) {
+    junction_way_points[i].is_junction = true;
+  }
+  junction_way_points[60].lane_id = -2;
+  decimator.Decimate(junction_way_points, &indices);
+  for (size_t i : {30, 35, 39, 59, 60, 61}) {
+    EXPECT_TRUE(std::binary_search(indices.begin(), indices.end(), i)) << "i: " << i;
+  }
+}
+
+TEST(ReferenceLineTest, smooth_decimated) {
+  const auto way_points = StraightThenCurve(0, 131);
+  auto ref_line = ReferenceLine(way_points);
+  ref_line.SetWayPointDecimator(std::make_shared<WayPointDecimator>(1.0, 8.0, 0.02));
+  ASSERT_TRUE(ref_line.Smooth(13.5, 100.0, 1.0, 5.0, 5.0));
+  EXPECT_NEAR(ref_line.Length(), 130.0, 1.0);
+  for (const auto &way_point : way_points) {
+    common::SLPoint sl_point;
+    ASSERT_TRUE(ref_line.XYToSL(way_point.pose.position.x, way_point.pose.position.y, &sl_point));
+    EXPECT_LT(std::fabs(sl_point.l), 0.3) << "s: " << way_point.s;
+  }
+}
+
 }
 
 int main(int argc, char **argv) {
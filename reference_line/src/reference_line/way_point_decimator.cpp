@@ -0,0 +1,86 @@
+#include "reference_line/way_point_decimator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace planning {
+namespace {
+// the fewest points a spline2d is fitted through
+constexpr size_t kMinKeptPoints = 4;
+
+/**
+ * @brief: the curvature of the circle through three way points, 0 if two of them coincide
+ */
+double CircleCurvature(const planning_msgs::WayPoint &a, const planning_msgs::WayPoint &b,
+                       const planning_msgs::WayPoint &c) {
+  const double abx = b.pose.position.x - a.pose.position.x;
+  const double aby = b.pose.position.y - a.pose.position.y;
+  const double bcx = c.pose.position.x - b.pose.position.x;
+  const double bcy = c.pose.position.y - b.pose.position.y;
+  const double denominator = std::hypot(abx, aby) * std::hypot(bcx, bcy) * std::hypot(abx + bcx, aby + bcy);
+  if (denominator < 1e-9) {
+    return 0.0;
+  }
+  return 2.0 * std::fabs(abx * bcy - aby * bcx) / denominator;
+}
+}
+
+WayPointDecimator::WayPointDecimator(double min_spacing, double max_spacing, double max_deviation)
+    : min_spacing_(min_spacing), max_spacing_(std::max(max_spacing, min_spacing)), max_deviation_(max_deviation) {}
+
+double WayPointDecimator::Spacing(double kappa) const {
+  // the sagitta of a chord c on a circle of curvature kappa is about c^2 * kappa / 8
+  const double max_chord = kappa > 0.0 ? std::sqrt(8.0 * max_deviation_ / kappa)
+                                       : std::numeric_limits<double>::infinity();
+  // the powers of two nest the grids, a point on a coarse grid is on all the finer ones
+  double spacing = min_spacing_;
+  while (2.0 * spacing <= std::min(max_chord, max_spacing_)) {
+    spacing *= 2.0;
+  }
+  return spacing;
+}
+
+bool WayPointDecimator::IsSameLane(const planning_msgs::WayPoint &first, const planning_msgs::WayPoint &second) {
+  return first.road_id == second.road_id && first.section_id == second.section_id
+      && first.lane_id == second.lane_id;
+}
+
+void WayPointDecimator::Decimate(const std::vector<planning_msgs::WayPoint> &way_points,
+                                 std::vector<size_t> *indices) const {
+  indices->clear();
+  const size_t num_points = way_points.size();
+  if (num_points == 0) {
+    return;
+  }
+  if (min_spacing_ <= 0.0 || max_deviation_ <= 0.0 || num_points <= kMinKeptPoints) {
+    for (size_t i = 0; i < num_points; ++i) {
+      indices->push_back(i);
+    }
+    return;
+  }
+  std::vector<double> curvatures(num_points, 0.0);
+  for (size_t i = 1; i + 1 < num_points; ++i) {
+    curvatures[i] = CircleCurvature(way_points[i - 1], way_points[i], way_points[i + 1]);
+  }
+  indices->push_back(0);
+  for (size_t i = 1; i + 1 < num_points; ++i) {
+    const auto &way_point = way_points[i];
+    const auto &previous = way_points[i - 1];
+    const auto &next = way_points[i + 1];
+    // the curvature around the point, so the spacing shrinks before a curve and not only inside it
+    const double kappa = std::max({curvatures[i - 1], curvatures[i], curvatures[i + 1]});
+    const double spacing = Spacing(kappa);
+    const bool crosses_grid = std::floor(way_point.s / spacing) != std::floor(previous.s / spacing);
+    if (way_point.is_junction || !IsSameLane(way_point, previous) || !IsSameLane(way_point, next) || crosses_grid) {
+      indices->push_back(i);
+    }
+  }
+  indices->push_back(num_points - 1);
+  if (indices->size() < kMinKeptPoints) {
+    indices->clear();
+    for (size_t i = 0; i < num_points; ++i) {
+      indices->push_back(i);
+    }
+  }
+}
+}
@@ -0,0 +1,150 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include "math/point_grid_index.hpp"
+#include "route_graph_file.hpp"
+
+namespace route_graph {
+
+/**
+ * @brief: a waypoint of a traced route and the turn decision it was traced with
+ */
+struct RoutePoint {
+  uint32_t waypoint;
+  int8_t road_option;
+};
+
+/**
+ * @brief: the topology of a carla town memory mapped from its route graph file, with the route queries of
+ * RandomRoutePlanner on top: the edges are localized through a grid over the waypoints and the routes searched by A*
+ * over the CSR adjacency. the file is only read, so loading costs the mapping and the grid, not a topology rebuild.
+ */
+class RouteGraph {
+ public:
+  static constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t kNoEdge = std::numeric_limits<uint32_t>::max();
+
+  RouteGraph() = default;
+  ~RouteGraph();
+
+  RouteGraph(const RouteGraph &) = delete;
+  RouteGraph &operator=(const RouteGraph &) = delete;
+
+  /**
+   * @brief: map the route graph file and index its waypoints
+   * @param file
+   * @return: false if the file can't be mapped or is no valid route graph file
+   */
+  bool Load(const std::string &file);
+
+  bool IsLoaded() const { return header_ != nullptr; }
+
+  double resolution() const { return header_->resolution; }
+
+  size_t NumNodes() const { return header_->num_nodes; }
+  size_t NumEdges() const { return header_->num_edges; }
+  size_t NumWaypoints() const { return header_->num_waypoints; }
+  size_t NumSpawnPoints() const { return header_->num_spawn_points; }
+
+  const RouteGraphNode &node(size_t index) const { return nodes_[index]; }
+  const RouteGraphEdge &edge(size_t index) const { return edges_[index]; }
+  const RouteGraphWaypoint &waypoint(size_t index) const { return waypoints_[index]; }
+  const RouteGraphSpawnPoint &spawn_point(size_t index) const { return spawn_points_[index]; }
+
+  /**
+   * @brief: the edge from node from to node to
+   * @return: kNoEdge if there is none
+   */
+  uint32_t FindEdge(uint32_t from, uint32_t to) const;
+
+  /**
+   * @brief: the waypoint nearest to the location in the carla frame, among the waypoints of the lanes around it
+   * the one on the closest level, so a location on a bridge is not localized to the road below
+   * @return: the waypoint index
+   */
+  uint32_t Localize(double x, double y, double z) const;
+
+  /**
+   * @brief: the nodes of the shortest route from the edge of the origin waypoint to the edge of the destination
+   * waypoint by A* with the distance heuristic, as RandomRoutePlanner::_path_search
+   * @param origin_waypoint
+   * @param destination_waypoint
+   * @param route
+   * @return: false if the destination can't be reached
+   */
+  bool PathSearch(uint32_t origin_waypoint, uint32_t destination_waypoint, std::vector<uint32_t> *route) const;
+
+  /**
+   * @brief: the waypoints from the origin to the destination with their turn decisions, as
+   * RandomRoutePlanner::trace_route
+   * @param origin_waypoint
+   * @param destination: the location of the destination in the carla frame
+   * @param trace
+   * @return: false if the destination can't be reached
+   */
+  bool TraceRoute(uint32_t origin_waypoint, const RouteGraphNode &destination, std::vector<RoutePoint> *trace) const;
+
+  /**
+   * @brief: the waypoints of the edge of waypoint before it, the ones previous_until_lane_start walks back to
+   * @param waypoint
+   * @param waypoints: in driving order
+   */
+  void PreviousUntilEdgeStart(uint32_t waypoint, std::vector<uint32_t> *waypoints) const;
+
+  /**
+   * @brief: the paths an agent on the edge of waypoint may take, the path of its edge followed by the path of every
+   * successor edge, as RandomRoutePlanner::get_potential_paths
+   * @param waypoint
+   * @param paths
+   */
+  void GetPotentialPaths(uint32_t waypoint, std::vector<std::vector<uint32_t>> *paths) const;
+
+ private:
+  /**
+   * @brief: the state the turn decisions carry along a route
+   */
+  struct TurnState {
+    int8_t previous_decision = kVoid;
+    uint32_t intersection_end_node = kNoNode;
+  };
+
+  /**
+   * @brief: the turn decision for the edges around index of route, as RandomRoutePlanner::_turn_decision
+   */
+  int8_t TurnDecision(size_t index, const std::vector<uint32_t> &route, TurnState *state) const;
+
+  /**
+   * @brief: the last of the successive junction edges from index of route and the node it ends in
+   */
+  void SuccessiveLastIntersectionEdge(size_t index, const std::vector<uint32_t> &route,
+                                      uint32_t *last_node, uint32_t *last_edge) const;
+
+  /**
+   * @brief: the offset in [0, num) of the waypoint of [first, first + num) closest to waypoint
+   */
+  size_t FindClosest(uint32_t waypoint, uint32_t first, uint32_t num) const;
+
+  double SquaredDistance(uint32_t waypoint, double x, double y, double z) const;
+
+  void Unmap();
+
+ private:
+  void *mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  const RouteGraphHeader *header_ = nullptr;
+  const RouteGraphNode *nodes_ = nullptr;
+  const uint32_t *edge_offsets_ = nullptr;
+  const RouteGraphEdge *edges_ = nullptr;
+  const RouteGraphWaypoint *waypoints_ = nullptr;
+  const RouteGraphSpawnPoint *spawn_points_ = nullptr;
+  // the grid holds all but the exit waypoint of every edge, which is the entry waypoint of its successors
+  common::PointGridIndex waypoint_index_;
+  std::vector<uint32_t> indexed_waypoints_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_HPP_
@@ -0,0 +1,146 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_FILE_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_FILE_HPP_
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * the route graph file of a carla town, written once by the carla client interface and memory mapped by the route
+ * graph server. it is little endian, a header followed by the sections at the byte offsets of the header, every
+ * section starts 8 byte aligned:
+ *   nodes          RouteGraphNode[num_nodes]
+ *   edge offsets   uint32_t[num_nodes + 1], the out edges of node i are edges[edge_offsets[i], edge_offsets[i + 1])
+ *   edges          RouteGraphEdge[num_edges], sorted by their from node
+ *   waypoints      RouteGraphWaypoint[num_waypoints], the ones of an edge are contiguous
+ *   spawn points   RouteGraphSpawnPoint[num_spawn_points]
+ * all positions are in the carla frame, the route graph server converts them to the ros frame.
+ * the layout is mirrored by carla_client_interface/route_graph_builder.py, change both together.
+ */
+namespace route_graph {
+
+// "RTEGRAPH"
+constexpr uint64_t kRouteGraphMagic = 0x4850415247455452ULL;
+constexpr uint32_t kRouteGraphVersion = 1;
+
+/**
+ * @brief: the RoadOption of agents.navigation.local_planner
+ */
+enum RoadOption : int8_t {
+  kVoid = -1,
+  kLeft = 1,
+  kRight = 2,
+  kStraight = 3,
+  kLaneFollow = 4,
+  kChangeLaneLeft = 5,
+  kChangeLaneRight = 6
+};
+
+struct RouteGraphHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t num_nodes;
+  uint32_t num_edges;
+  uint32_t num_waypoints;
+  uint32_t num_spawn_points;
+  uint32_t reserved;
+  // the sampling resolution of the waypoints, in m
+  double resolution;
+  uint64_t nodes_offset;
+  uint64_t edge_offsets_offset;
+  uint64_t edges_offset;
+  uint64_t waypoints_offset;
+  uint64_t spawn_points_offset;
+};
+
+struct RouteGraphNode {
+  double x;
+  double y;
+  double z;
+};
+
+struct RouteGraphEdge {
+  uint32_t from;
+  uint32_t to;
+  // the entry waypoint, the sampled path and the exit waypoint
+  uint32_t first_waypoint;
+  uint32_t num_waypoints;
+  // the A* weight, the number of sampled waypoints plus one as in RandomRoutePlanner
+  double length;
+  // unit vectors along the entry, the exit and the chord from entry to exit
+  double entry_vector[3];
+  double exit_vector[3];
+  double net_vector[3];
+  int8_t type;
+  uint8_t is_junction;
+  // the edges added for the loose ends of the topology have no vectors
+  uint8_t has_vectors;
+  uint8_t reserved[5];
+};
+
+/**
+ * @brief: a sampled waypoint with the static attributes of its lane the route service hands out
+ */
+struct RouteGraphWaypoint {
+  double x;
+  double y;
+  double z;
+  // in deg as in carla
+  double yaw;
+  double s;
+  double lane_width;
+  // -1.0 without a left or right lane
+  double left_lane_width;
+  double right_lane_width;
+  double junction_location[3];
+  double junction_extent[3];
+  int32_t road_id;
+  int32_t section_id;
+  int32_t lane_id;
+  int32_t junction_id;
+  // the edge the waypoint belongs to
+  uint32_t edge;
+  uint8_t is_junction;
+  uint8_t has_left_lane;
+  uint8_t has_right_lane;
+  // planning_msgs::LaneChangeType
+  uint8_t lane_change;
+  // planning_msgs::LaneType
+  uint8_t lane_type;
+  uint8_t reserved[7];
+};
+
+struct RouteGraphSpawnPoint {
+  double x;
+  double y;
+  double z;
+  double yaw;
+};
+
+static_assert(sizeof(RouteGraphHeader) == 80, "the layout of RouteGraphHeader changed");
+static_assert(sizeof(RouteGraphNode) == 24, "the layout of RouteGraphNode changed");
+static_assert(sizeof(RouteGraphEdge) == 104, "the layout of RouteGraphEdge changed");
+static_assert(sizeof(RouteGraphWaypoint) == 144, "the layout of RouteGraphWaypoint changed");
+static_assert(sizeof(RouteGraphSpawnPoint) == 32, "the layout of RouteGraphSpawnPoint changed");
+
+/**
+ * @brief: the sections of a route graph file, to write one
+ */
+struct RouteGraphData {
+  double resolution = 2.0;
+  std::vector<RouteGraphNode> nodes;
+  // the edges sorted by their from node
+  std::vector<RouteGraphEdge> edges;
+  std::vector<RouteGraphWaypoint> waypoints;
+  std::vector<RouteGraphSpawnPoint> spawn_points;
+};
+
+/**
+ * @brief: write the data in the route graph file format, the edge offsets are derived from the sorted edges
+ * @param data
+ * @param file
+ * @return: false if the edges are not sorted or the file can't be written
+ */
+bool WriteRouteGraphFile(const RouteGraphData &data, const std::string &file);
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_INCLUDE_ROUTE_GRAPH_ROUTE_GRAPH_FILE_HPP_
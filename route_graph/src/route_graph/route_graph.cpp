@@ -0,0 +1,444 @@
+#include "route_graph/route_graph.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace route_graph {
+
+namespace {
+// the cell size of the waypoint grid, in m
+constexpr double kWaypointGridCellSize = 8.0;
+// the waypoints this much farther in the plane than the nearest one are still candidates on another level, in m
+constexpr double kLevelSearchRadius = 4.0;
+// the deviation below which a turn is straight, 35 deg as in RandomRoutePlanner
+constexpr double kStraightThreshold = 35.0 * M_PI / 180.0;
+
+bool IsSectionInFile(uint64_t offset, uint64_t count, size_t item_size, size_t file_size) {
+  return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / item_size;
+}
+
+double CrossZ(const double *v1, const double *v2) {
+  return v1[0] * v2[1] - v1[1] * v2[0];
+}
+
+double Norm(const double *v) {
+  return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+}
+
+constexpr uint32_t RouteGraph::kNoNode;
+constexpr uint32_t RouteGraph::kNoEdge;
+
+RouteGraph::~RouteGraph() {
+  Unmap();
+}
+
+void RouteGraph::Unmap() {
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+  }
+  mapped_ = nullptr;
+  mapped_size_ = 0;
+  header_ = nullptr;
+  nodes_ = nullptr;
+  edge_offsets_ = nullptr;
+  edges_ = nullptr;
+  waypoints_ = nullptr;
+  spawn_points_ = nullptr;
+  waypoint_index_ = common::PointGridIndex();
+  indexed_waypoints_.clear();
+}
+
+bool RouteGraph::Load(const std::string &file) {
+  Unmap();
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat{};
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(RouteGraphHeader))) {
+    close(fd);
+    return false;
+  }
+  const auto file_size = static_cast<size_t>(file_stat.st_size);
+  void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  mapped_ = mapped;
+  mapped_size_ = file_size;
+
+  const char *base = static_cast<const char *>(mapped);
+  const auto *header = reinterpret_cast<const RouteGraphHeader *>(base);
+  if (header->magic != kRouteGraphMagic || header->version != kRouteGraphVersion
+      || !IsSectionInFile(header->nodes_offset, header->num_nodes, sizeof(RouteGraphNode), file_size)
+      || !IsSectionInFile(header->edge_offsets_offset, static_cast<uint64_t>(header->num_nodes) + 1,
+                          sizeof(uint32_t), file_size)
+      || !IsSectionInFile(header->edges_offset, header->num_edges, sizeof(RouteGraphEdge), file_size)
+      || !IsSectionInFile(header->waypoints_offset, header->num_waypoints, sizeof(RouteGraphWaypoint), file_size)
+      || !IsSectionInFile(header->spawn_points_offset, header->num_spawn_points, sizeof(RouteGraphSpawnPoint),
+                          file_size)) {
+    Unmap();
+    return false;
+  }
+  const auto *edge_offsets = reinterpret_cast<const uint32_t *>(base + header->edge_offsets_offset);
+  const auto *edges = reinterpret_cast<const RouteGraphEdge *>(base + header->edges_offset);
+  const auto *waypoints = reinterpret_cast<const RouteGraphWaypoint *>(base + header->waypoints_offset);
+
+  // the queries index the sections without checks, so a broken file is rejected here
+  bool is_valid = edge_offsets[0] == 0 && edge_offsets[header->num_nodes] == header->num_edges;
+  for (uint32_t i = 0; is_valid && i < header->num_nodes; ++i) {
+    is_valid = edge_offsets[i] <= edge_offsets[i + 1];
+    for (uint32_t j = edge_offsets[i]; is_valid && j < edge_offsets[i + 1]; ++j) {
+      const auto &edge = edges[j];
+      is_valid = edge.from == i && edge.to < header->num_nodes && edge.num_waypoints >= 2
+          && edge.first_waypoint <= header->num_waypoints
+          && edge.num_waypoints <= header->num_waypoints - edge.first_waypoint;
+    }
+  }
+  for (uint32_t i = 0; is_valid && i < header->num_waypoints; ++i) {
+    is_valid = waypoints[i].edge < header->num_edges;
+  }
+  if (!is_valid) {
+    Unmap();
+    return false;
+  }
+  header_ = header;
+  nodes_ = reinterpret_cast<const RouteGraphNode *>(base + header->nodes_offset);
+  edge_offsets_ = edge_offsets;
+  edges_ = edges;
+  waypoints_ = waypoints;
+  spawn_points_ = reinterpret_cast<const RouteGraphSpawnPoint *>(base + header->spawn_points_offset);
+
+  std::vector<double> xs;
+  std::vector<double> ys;
+  for (uint32_t i = 0; i < header_->num_edges; ++i) {
+    const auto &edge = edges_[i];
+    for (uint32_t j = edge.first_waypoint; j + 1 < edge.first_waypoint + edge.num_waypoints; ++j) {
+      indexed_waypoints_.push_back(j);
+      xs.push_back(waypoints_[j].x);
+      ys.push_back(waypoints_[j].y);
+    }
+  }
+  if (indexed_waypoints_.empty()) {
+    Unmap();
+    return false;
+  }
+  waypoint_index_ = common::PointGridIndex(xs, ys, kWaypointGridCellSize);
+  return true;
+}
+
+uint32_t RouteGraph::FindEdge(uint32_t from, uint32_t to) const {
+  for (uint32_t i = edge_offsets_[from]; i < edge_offsets_[from + 1]; ++i) {
+    if (edges_[i].to == to) {
+      return i;
+    }
+  }
+  return kNoEdge;
+}
+
+double RouteGraph::SquaredDistance(uint32_t waypoint, double x, double y, double z) const {
+  const auto &wp = waypoints_[waypoint];
+  return (wp.x - x) * (wp.x - x) + (wp.y - y) * (wp.y - y) + (wp.z - z) * (wp.z - z);
+}
+
+uint32_t RouteGraph::Localize(double x, double y, double z) const {
+  const size_t nearest = waypoint_index_.Nearest(x, y);
+  const auto &nearest_waypoint = waypoints_[indexed_waypoints_[nearest]];
+  const double planar_distance = std::hypot(nearest_waypoint.x - x, nearest_waypoint.y - y);
+  std::vector<size_t> candidates;
+  waypoint_index_.WithinRadius(x, y, planar_distance + kLevelSearchRadius, &candidates);
+  uint32_t best_waypoint = indexed_waypoints_[nearest];
+  double best_dist_sqr = SquaredDistance(best_waypoint, x, y, z);
+  for (const size_t candidate : candidates) {
+    const double dist_sqr = SquaredDistance(indexed_waypoints_[candidate], x, y, z);
+    if (dist_sqr < best_dist_sqr) {
+      best_dist_sqr = dist_sqr;
+      best_waypoint = indexed_waypoints_[candidate];
+    }
+  }
+  return best_waypoint;
+}
+
+bool RouteGraph::PathSearch(uint32_t origin_waypoint, uint32_t destination_waypoint,
+                            std::vector<uint32_t> *route) const {
+  const auto &start_edge = edges_[waypoints_[origin_waypoint].edge];
+  const auto &end_edge = edges_[waypoints_[destination_waypoint].edge];
+  const uint32_t source = start_edge.from;
+  const uint32_t target = end_edge.from;
+  const auto &target_node = nodes_[target];
+  auto heuristic = [&](uint32_t node) {
+    return std::sqrt((nodes_[node].x - target_node.x) * (nodes_[node].x - target_node.x)
+                         + (nodes_[node].y - target_node.y) * (nodes_[node].y - target_node.y)
+                         + (nodes_[node].z - target_node.z) * (nodes_[node].z - target_node.z));
+  };
+
+  const size_t num_nodes = header_->num_nodes;
+  std::vector<double> costs(num_nodes, std::numeric_limits<double>::infinity());
+  std::vector<uint32_t> parents(num_nodes, kNoNode);
+  std::vector<uint8_t> is_closed(num_nodes, 0);
+  using QueueItem = std::pair<double, uint32_t>;
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> open_queue;
+  costs[source] = 0.0;
+  open_queue.emplace(heuristic(source), source);
+  while (!open_queue.empty()) {
+    const uint32_t node = open_queue.top().second;
+    open_queue.pop();
+    if (is_closed[node]) {
+      continue;
+    }
+    is_closed[node] = 1;
+    if (node == target) {
+      break;
+    }
+    for (uint32_t i = edge_offsets_[node]; i < edge_offsets_[node + 1]; ++i) {
+      const auto &edge = edges_[i];
+      const double cost = costs[node] + edge.length;
+      if (cost < costs[edge.to]) {
+        costs[edge.to] = cost;
+        parents[edge.to] = node;
+        open_queue.emplace(cost + heuristic(edge.to), edge.to);
+      }
+    }
+  }
+  if (!is_closed[target]) {
+    return false;
+  }
+  route->clear();
+  for (uint32_t node = target; node != kNoNode; node = parents[node]) {
+    route->push_back(node);
+  }
+  std::reverse(route->begin(), route->end());
+  route->push_back(end_edge.to);
+  return true;
+}
+
+void RouteGraph::SuccessiveLastIntersectionEdge(size_t index, const std::vector<uint32_t> &route,
+                                                uint32_t *last_node, uint32_t *last_edge) const {
+  *last_node = kNoNode;
+  *last_edge = kNoEdge;
+  for (size_t i = index; i + 1 < route.size(); ++i) {
+    const uint32_t candidate_edge = FindEdge(route[i], route[i + 1]);
+    if (route[i] == route[index]) {
+      *last_edge = candidate_edge;
+    }
+    if (edges_[candidate_edge].type == kLaneFollow && edges_[candidate_edge].is_junction) {
+      *last_edge = candidate_edge;
+      *last_node = route[i + 1];
+    } else {
+      break;
+    }
+  }
+}
+
+int8_t RouteGraph::TurnDecision(size_t index, const std::vector<uint32_t> &route, TurnState *state) const {
+  const uint32_t current_node = route[index];
+  const uint32_t next_node = route[index + 1];
+  const RouteGraphEdge *next_edge = &edges_[FindEdge(current_node, next_node)];
+  int8_t decision = next_edge->type;
+  if (index > 0) {
+    const uint32_t previous_node = route[index - 1];
+    if (state->previous_decision != kVoid && state->intersection_end_node != kNoNode
+        && state->intersection_end_node != previous_node
+        && next_edge->type == kLaneFollow && next_edge->is_junction) {
+      decision = state->previous_decision;
+    } else {
+      state->intersection_end_node = kNoNode;
+      const auto &current_edge = edges_[FindEdge(previous_node, current_node)];
+      const bool calculate_turn = current_edge.type == kLaneFollow && !current_edge.is_junction
+          && next_edge->type == kLaneFollow && next_edge->is_junction;
+      if (calculate_turn) {
+        uint32_t last_node = kNoNode;
+        uint32_t tail_edge = kNoEdge;
+        SuccessiveLastIntersectionEdge(index, route, &last_node, &tail_edge);
+        state->intersection_end_node = last_node;
+        if (tail_edge != kNoEdge) {
+          next_edge = &edges_[tail_edge];
+        }
+        if (current_edge.has_vectors && next_edge->has_vectors) {
+          const double *cv = current_edge.exit_vector;
+          const double *nv = next_edge->net_vector;
+          double min_cross = std::numeric_limits<double>::infinity();
+          double max_cross = -std::numeric_limits<double>::infinity();
+          for (uint32_t i = edge_offsets_[current_node]; i < edge_offsets_[current_node + 1]; ++i) {
+            const auto &select_edge = edges_[i];
+            if (select_edge.type == kLaneFollow && select_edge.to != next_node && select_edge.has_vectors) {
+              const double cross = CrossZ(cv, select_edge.net_vector);
+              min_cross = std::min(min_cross, cross);
+              max_cross = std::max(max_cross, cross);
+            }
+          }
+          if (min_cross > max_cross) {
+            min_cross = 0.0;
+            max_cross = 0.0;
+          }
+          const double next_cross = CrossZ(cv, nv);
+          const double cos_deviation = (cv[0] * nv[0] + cv[1] * nv[1] + cv[2] * nv[2]) / (Norm(cv) * Norm(nv));
+          const double deviation = std::acos(std::max(-1.0, std::min(1.0, cos_deviation)));
+          if (deviation < kStraightThreshold) {
+            decision = kStraight;
+          } else if (next_cross < min_cross) {
+            decision = kLeft;
+          } else if (next_cross > max_cross) {
+            decision = kRight;
+          } else if (next_cross < 0.0) {
+            decision = kLeft;
+          } else if (next_cross > 0.0) {
+            decision = kRight;
+          } else {
+            decision = kVoid;
+          }
+        }
+      }
+    }
+  }
+  state->previous_decision = decision;
+  return decision;
+}
+
+size_t RouteGraph::FindClosest(uint32_t waypoint, uint32_t first, uint32_t num) const {
+  const auto &wp = waypoints_[waypoint];
+  size_t closest = 0;
+  double min_dist_sqr = std::numeric_limits<double>::infinity();
+  for (uint32_t i = 0; i < num; ++i) {
+    const double dist_sqr = SquaredDistance(first + i, wp.x, wp.y, wp.z);
+    if (dist_sqr < min_dist_sqr) {
+      min_dist_sqr = dist_sqr;
+      closest = i;
+    }
+  }
+  return closest;
+}
+
+bool RouteGraph::TraceRoute(uint32_t origin_waypoint, const RouteGraphNode &destination,
+                            std::vector<RoutePoint> *trace) const {
+  const uint32_t destination_waypoint = Localize(destination.x, destination.y, destination.z);
+  std::vector<uint32_t> route;
+  if (!PathSearch(origin_waypoint, destination_waypoint, &route)) {
+    return false;
+  }
+  const auto &destination_wp = waypoints_[destination_waypoint];
+  const double destination_range_sqr = 4.0 * header_->resolution * header_->resolution;
+  TurnState turn_state;
+  uint32_t current_waypoint = origin_waypoint;
+  trace->clear();
+  // the file holds no lane change links, every edge is followed along its waypoints
+  for (size_t i = 0; i + 1 < route.size(); ++i) {
+    const int8_t road_option = TurnDecision(i, route, &turn_state);
+    const auto &edge = edges_[FindEdge(route[i], route[i + 1])];
+    const bool is_last_edge = route.size() - i <= 2;
+    const size_t closest_index = FindClosest(current_waypoint, edge.first_waypoint, edge.num_waypoints);
+    for (size_t j = closest_index; j < edge.num_waypoints; ++j) {
+      current_waypoint = edge.first_waypoint + j;
+      trace->push_back({current_waypoint, road_option});
+      if (!is_last_edge) {
+        continue;
+      }
+      const auto &wp = waypoints_[current_waypoint];
+      if (SquaredDistance(current_waypoint, destination.x, destination.y, destination.z) < destination_range_sqr) {
+        break;
+      }
+      if (wp.road_id == destination_wp.road_id && wp.section_id == destination_wp.section_id
+          && wp.lane_id == destination_wp.lane_id
+          && closest_index > FindClosest(destination_waypoint, edge.first_waypoint, edge.num_waypoints)) {
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+void RouteGraph::PreviousUntilEdgeStart(uint32_t waypoint, std::vector<uint32_t> *waypoints) const {
+  const auto &edge = edges_[waypoints_[waypoint].edge];
+  waypoints->clear();
+  for (uint32_t i = edge.first_waypoint; i < waypoint; ++i) {
+    waypoints->push_back(i);
+  }
+}
+
+void RouteGraph::GetPotentialPaths(uint32_t waypoint, std::vector<std::vector<uint32_t>> *paths) const {
+  const auto &edge = edges_[waypoints_[waypoint].edge];
+  paths->clear();
+  for (uint32_t i = edge_offsets_[edge.to]; i < edge_offsets_[edge.to + 1]; ++i) {
+    const auto &next_edge = edges_[i];
+    // the sampled path lies between the entry and the exit waypoint
+    if (next_edge.num_waypoints < 4) {
+      continue;
+    }
+    std::vector<uint32_t> path;
+    for (uint32_t j = edge.first_waypoint + 1; j + 1 < edge.first_waypoint + edge.num_waypoints; ++j) {
+      path.push_back(j);
+    }
+    for (uint32_t j = next_edge.first_waypoint + 1; j < next_edge.first_waypoint + next_edge.num_waypoints; ++j) {
+      path.push_back(j);
+    }
+    paths->push_back(std::move(path));
+  }
+}
+
+/********************************** WriteRouteGraphFile ******************************/
+namespace {
+uint64_t AlignedOffset(uint64_t offset) {
+  return (offset + 7) / 8 * 8;
+}
+
+template<class T>
+void WriteSection(const std::vector<T> &items, uint64_t offset, std::FILE *file) {
+  std::fseek(file, static_cast<long>(offset), SEEK_SET);
+  if (!items.empty()) {
+    std::fwrite(items.data(), sizeof(T), items.size(), file);
+  }
+}
+}
+
+bool WriteRouteGraphFile(const RouteGraphData &data, const std::string &file) {
+  std::vector<uint32_t> edge_offsets(data.nodes.size() + 1, 0);
+  for (size_t i = 0; i < data.edges.size(); ++i) {
+    const auto &edge = data.edges[i];
+    if (edge.from >= data.nodes.size() || (i > 0 && edge.from < data.edges[i - 1].from)) {
+      return false;
+    }
+    ++edge_offsets[edge.from + 1];
+  }
+  for (size_t i = 1; i < edge_offsets.size(); ++i) {
+    edge_offsets[i] += edge_offsets[i - 1];
+  }
+
+  RouteGraphHeader header{};
+  header.magic = kRouteGraphMagic;
+  header.version = kRouteGraphVersion;
+  header.num_nodes = static_cast<uint32_t>(data.nodes.size());
+  header.num_edges = static_cast<uint32_t>(data.edges.size());
+  header.num_waypoints = static_cast<uint32_t>(data.waypoints.size());
+  header.num_spawn_points = static_cast<uint32_t>(data.spawn_points.size());
+  header.resolution = data.resolution;
+  header.nodes_offset = AlignedOffset(sizeof(RouteGraphHeader));
+  header.edge_offsets_offset = AlignedOffset(header.nodes_offset + data.nodes.size() * sizeof(RouteGraphNode));
+  header.edges_offset = AlignedOffset(header.edge_offsets_offset + edge_offsets.size() * sizeof(uint32_t));
+  header.waypoints_offset = AlignedOffset(header.edges_offset + data.edges.size() * sizeof(RouteGraphEdge));
+  header.spawn_points_offset =
+      AlignedOffset(header.waypoints_offset + data.waypoints.size() * sizeof(RouteGraphWaypoint));
+
+  std::FILE *out = std::fopen(file.c_str(), "wb");
+  if (out == nullptr) {
+    return false;
+  }
+  std::fwrite(&header, sizeof(header), 1, out);
+  WriteSection(data.nodes, header.nodes_offset, out);
+  WriteSection(edge_offsets, header.edge_offsets_offset, out);
+  WriteSection(data.edges, header.edges_offset, out);
+  WriteSection(data.waypoints, header.waypoints_offset, out);
+  WriteSection(data.spawn_points, header.spawn_points_offset, out);
+  const bool is_written = std::ferror(out) == 0;
+  return std::fclose(out) == 0 && is_written;
+}
+
+}
@@ -0,0 +1,190 @@
+#include "route_graph/route_graph.hpp"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace route_graph {
+namespace {
+
+void Normalize(double *v) {
+  const double norm = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  for (int i = 0; i < 3; ++i) {
+    v[i] /= norm;
+  }
+}
+
+/**
+ * @brief: an edge sampled every 2 m along the straight line from (x0, y0, z) to (x1, y1, z)
+ */
+void AddEdge(uint32_t from, uint32_t to, double x0, double y0, double x1, double y1, double z, bool is_junction,
+             int32_t road_id, RouteGraphData *data) {
+  RouteGraphEdge edge{};
+  edge.from = from;
+  edge.to = to;
+  edge.first_waypoint = static_cast<uint32_t>(data->waypoints.size());
+  edge.type = kLaneFollow;
+  edge.is_junction = is_junction;
+  edge.has_vectors = 1;
+  const double length = std::hypot(x1 - x0, y1 - y0);
+  const auto num_steps = static_cast<size_t>(std::round(length / 2.0));
+  for (size_t i = 0; i <= num_steps; ++i) {
+    const double ratio = static_cast<double>(i) / static_cast<double>(num_steps);
+    RouteGraphWaypoint waypoint{};
+    waypoint.x = x0 + ratio * (x1 - x0);
+    waypoint.y = y0 + ratio * (y1 - y0);
+    waypoint.z = z;
+    waypoint.yaw = std::atan2(y1 - y0, x1 - x0) * 180.0 / M_PI;
+    waypoint.s = ratio * length;
+    waypoint.lane_width = 3.5;
+    waypoint.left_lane_width = -1.0;
+    waypoint.right_lane_width = -1.0;
+    waypoint.road_id = road_id;
+    waypoint.lane_id = -1;
+    waypoint.is_junction = is_junction;
+    waypoint.edge = static_cast<uint32_t>(data->edges.size());
+    data->waypoints.push_back(waypoint);
+  }
+  edge.num_waypoints = static_cast<uint32_t>(num_steps + 1);
+  edge.length = static_cast<double>(num_steps);
+  double vector[3] = {x1 - x0, y1 - y0, 0.0};
+  Normalize(vector);
+  for (int i = 0; i < 3; ++i) {
+    edge.entry_vector[i] = vector[i];
+    edge.exit_vector[i] = vector[i];
+    edge.net_vector[i] = vector[i];
+  }
+  data->edges.push_back(edge);
+}
+
+/**
+ * @brief: a road along x into a junction, which turns right onto a road along y or goes straight on, and an
+ * overpass crossing the straight road 8 m above it
+ */
+RouteGraphData MakeJunctionData() {
+  RouteGraphData data;
+  data.resolution = 2.0;
+  data.nodes = {{0.0, 0.0, 0.0}, {20.0, 0.0, 0.0}, {30.0, 10.0, 0.0}, {40.0, 0.0, 0.0},
+                {30.0, 30.0, 0.0}, {60.0, 0.0, 0.0}, {50.0, -10.0, 8.0}, {50.0, 10.0, 8.0}};
+  AddEdge(0, 1, 0.0, 0.0, 20.0, 0.0, 0.0, false, 1, &data);
+  AddEdge(1, 2, 20.0, 0.0, 30.0, 10.0, 0.0, true, 2, &data);
+  AddEdge(1, 3, 20.0, 0.0, 40.0, 0.0, 0.0, true, 5, &data);
+  AddEdge(2, 4, 30.0, 10.0, 30.0, 30.0, 0.0, false, 3, &data);
+  AddEdge(3, 5, 40.0, 0.0, 60.0, 0.0, 0.0, false, 4, &data);
+  AddEdge(6, 7, 50.0, -10.0, 50.0, 10.0, 8.0, false, 6, &data);
+  data.spawn_points = {{30.0, 24.0, 0.5, 90.0}};
+  return data;
+}
+
+class RouteGraphTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    file_ = "/tmp/route_graph_test_" + std::to_string(getpid()) + ".rgraph";
+    ASSERT_TRUE(WriteRouteGraphFile(MakeJunctionData(), file_));
+    ASSERT_TRUE(route_graph_.Load(file_));
+  }
+
+  void TearDown() override {
+    std::remove(file_.c_str());
+  }
+
+  std::string file_;
+  RouteGraph route_graph_;
+};
+}
+
+TEST_F(RouteGraphTest, load_maps_the_sections) {
+  EXPECT_EQ(route_graph_.NumNodes(), 8);
+  EXPECT_EQ(route_graph_.NumEdges(), 6);
+  EXPECT_EQ(route_graph_.NumSpawnPoints(), 1);
+  EXPECT_DOUBLE_EQ(route_graph_.resolution(), 2.0);
+  EXPECT_EQ(route_graph_.FindEdge(1, 3), 2);
+  EXPECT_EQ(route_graph_.FindEdge(0, 3), RouteGraph::kNoEdge);
+  EXPECT_DOUBLE_EQ(route_graph_.spawn_point(0).yaw, 90.0);
+}
+
+TEST_F(RouteGraphTest, load_rejects_broken_files) {
+  RouteGraph route_graph;
+  EXPECT_FALSE(route_graph.Load(file_ + ".missing"));
+  // the file cut off in the waypoints
+  std::ifstream in(file_, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  const std::string truncated_file = file_ + ".truncated";
+  std::ofstream(truncated_file, std::ios::binary) << content.substr(0, content.size() / 2);
+  EXPECT_FALSE(route_graph.Load(truncated_file));
+  EXPECT_FALSE(route_graph.IsLoaded());
+  std::remove(truncated_file.c_str());
+}
+
+TEST_F(RouteGraphTest, localize_prefers_the_downstream_edge_and_the_closest_level) {
+  // the exit waypoint of the road is the entry waypoint of the junction edges
+  EXPECT_EQ(route_graph_.waypoint(route_graph_.Localize(20.0, 0.0, 0.0)).is_junction, 1);
+  EXPECT_EQ(route_graph_.waypoint(route_graph_.Localize(5.1, 0.4, 2.0)).road_id, 1);
+  EXPECT_EQ(route_graph_.waypoint(route_graph_.Localize(50.3, 0.2, 2.0)).road_id, 4);
+  EXPECT_EQ(route_graph_.waypoint(route_graph_.Localize(50.3, 0.2, 10.0)).road_id, 6);
+}
+
+TEST_F(RouteGraphTest, trace_route_turns_right_at_the_junction) {
+  const uint32_t origin = route_graph_.Localize(4.0, 0.0, 0.0);
+  std::vector<uint32_t> route;
+  ASSERT_TRUE(route_graph_.PathSearch(origin, route_graph_.Localize(30.0, 24.0, 0.0), &route));
+  EXPECT_EQ(route, std::vector<uint32_t>({0, 1, 2, 4}));
+
+  std::vector<RoutePoint> trace;
+  ASSERT_TRUE(route_graph_.TraceRoute(origin, {30.0, 24.0, 0.0}, &trace));
+  ASSERT_FALSE(trace.empty());
+  EXPECT_DOUBLE_EQ(route_graph_.waypoint(trace.front().waypoint).x, 4.0);
+  bool has_right_turn = false;
+  for (const auto &point : trace) {
+    const auto &waypoint = route_graph_.waypoint(point.waypoint);
+    if (waypoint.road_id == 1 || waypoint.road_id == 3) {
+      EXPECT_EQ(point.road_option, kLaneFollow);
+    } else if (waypoint.road_id == 2 && waypoint.x > 20.0) {
+      EXPECT_EQ(point.road_option, kRight);
+      has_right_turn = true;
+    }
+  }
+  EXPECT_TRUE(has_right_turn);
+  // the trace stops within twice the resolution of the destination
+  const auto &last = route_graph_.waypoint(trace.back().waypoint);
+  EXPECT_EQ(last.road_id, 3);
+  EXPECT_LT(std::hypot(last.x - 30.0, last.y - 24.0), 4.0);
+}
+
+TEST_F(RouteGraphTest, trace_route_goes_straight_through_the_junction) {
+  std::vector<RoutePoint> trace;
+  ASSERT_TRUE(route_graph_.TraceRoute(route_graph_.Localize(4.0, 0.0, 0.0), {56.0, 0.0, 0.0}, &trace));
+  bool has_straight = false;
+  for (const auto &point : trace) {
+    EXPECT_NE(point.road_option, kRight);
+    has_straight = has_straight || point.road_option == kStraight;
+  }
+  EXPECT_TRUE(has_straight);
+  EXPECT_EQ(route_graph_.waypoint(trace.back().waypoint).road_id, 4);
+}
+
+TEST_F(RouteGraphTest, trace_route_fails_without_a_route) {
+  std::vector<RoutePoint> trace;
+  EXPECT_FALSE(route_graph_.TraceRoute(route_graph_.Localize(30.0, 20.0, 0.0), {4.0, 0.0, 0.0}, &trace));
+}
+
+TEST_F(RouteGraphTest, previous_until_edge_start_and_potential_paths) {
+  const uint32_t waypoint = route_graph_.Localize(6.0, 0.0, 0.0);
+  std::vector<uint32_t> previous;
+  route_graph_.PreviousUntilEdgeStart(waypoint, &previous);
+  ASSERT_EQ(previous.size(), 3);
+  EXPECT_DOUBLE_EQ(route_graph_.waypoint(previous.front()).x, 0.0);
+  EXPECT_DOUBLE_EQ(route_graph_.waypoint(previous.back()).x, 4.0);
+
+  std::vector<std::vector<uint32_t>> paths;
+  route_graph_.GetPotentialPaths(waypoint, &paths);
+  ASSERT_EQ(paths.size(), 2);
+  for (const auto &path : paths) {
+    // the inner waypoints of the road, then the junction edge without its entry waypoint
+    EXPECT_DOUBLE_EQ(route_graph_.waypoint(path.front()).x, 2.0);
+    EXPECT_EQ(route_graph_.waypoint(path.back()).is_junction, 1);
+  }
+}
+
+}
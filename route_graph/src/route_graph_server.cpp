@@ -0,0 +1,208 @@
+#include "route_graph_server.hpp"
+#include <cmath>
+#include <chrono>
+#include <tf/transform_datatypes.h>
+#include <planning_msgs/CarlaRoadOption.h>
+#include <planning_msgs/LaneChangeType.h>
+#include "name/string_name.hpp"
+
+namespace route_graph {
+
+namespace {
+const std::string kWorldInfoName = "/carla/world_info"; //NOLINT
+const std::string kRouteGraphExtension = ".rgraph"; //NOLINT
+// the waypoints of a route closer than this to the previous one are dropped, in m
+constexpr double kMinWaypointGap = 1.0;
+
+uint8_t ToCarlaRoadOption(int8_t road_option) {
+  switch (road_option) {
+    case kLeft:return planning_msgs::CarlaRoadOption::LEFT;
+    case kRight:return planning_msgs::CarlaRoadOption::RIGHT;
+    case kStraight:return planning_msgs::CarlaRoadOption::STRAIGHT;
+    case kLaneFollow:return planning_msgs::CarlaRoadOption::LANEFOLLOW;
+    case kChangeLaneLeft:return planning_msgs::CarlaRoadOption::CHANGELANELEFT;
+    case kChangeLaneRight:return planning_msgs::CarlaRoadOption::CHANGELANERIGHT;
+    default:return planning_msgs::CarlaRoadOption::VOID;
+  }
+}
+}
+
+RouteGraphServer::RouteGraphServer(const ros::NodeHandle &nh)
+    : nh_(nh), random_engine_(std::random_device{}()) {
+  ros::NodeHandle private_nh("~");
+  private_nh.param<std::string>("route_graph_directory", route_graph_directory_, "");
+}
+
+void RouteGraphServer::Launch() {
+  world_info_subscriber_ = nh_.subscribe(kWorldInfoName, 1, &RouteGraphServer::WorldInfoCallback, this);
+  objects_subscriber_ = nh_.subscribe(common::topic::kObjectsName, 1, &RouteGraphServer::ObjectsCallback, this);
+  ROS_INFO("[RouteGraphServer::Launch], waiting for the CARLA world (topic: %s)", kWorldInfoName.c_str());
+  ros::spin();
+}
+
+void RouteGraphServer::WorldInfoCallback(const carla_msgs::CarlaWorldInfo::ConstPtr &world_info) {
+  // the map name is Town05 or Carla/Maps/Town05 depending on the carla version
+  std::string map_name = world_info->map_name;
+  const auto separator = map_name.rfind('/');
+  if (separator != std::string::npos) {
+    map_name = map_name.substr(separator + 1);
+  }
+  const std::string route_graph_file = route_graph_directory_ + "/" + map_name + kRouteGraphExtension;
+  if (route_graph_file == route_graph_file_) {
+    return;
+  }
+  route_graph_file_ = route_graph_file;
+  load_timer_ = nh_.createTimer(ros::Duration(1.0), &RouteGraphServer::TryLoad, this);
+  TryLoad(ros::TimerEvent());
+}
+
+void RouteGraphServer::ObjectsCallback(const derived_object_msgs::ObjectArray::ConstPtr &object_array) {
+  objects_.clear();
+  for (const auto &object : object_array->objects) {
+    objects_.emplace(object.id, object);
+  }
+}
+
+void RouteGraphServer::TryLoad(const ros::TimerEvent &) {
+  const auto load_begin = std::chrono::steady_clock::now();
+  if (!route_graph_.Load(route_graph_file_)) {
+    ROS_INFO_THROTTLE(10.0, "[RouteGraphServer::TryLoad], waiting for the route graph file %s",
+                      route_graph_file_.c_str());
+    return;
+  }
+  load_timer_.stop();
+  ROS_INFO("[RouteGraphServer::TryLoad], loaded %s in %lf s, nodes: %zu, edges: %zu, waypoints: %zu",
+           route_graph_file_.c_str(),
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - load_begin).count(),
+           route_graph_.NumNodes(), route_graph_.NumEdges(), route_graph_.NumWaypoints());
+  if (!route_service_) {
+    route_service_ = nh_.advertiseService(common::service::kRouteServiceName, &RouteGraphServer::GetRoute, this);
+    agent_potential_routes_service_ = nh_.advertiseService(common::service::kGetAgentPotentialRouteServiceName,
+                                                           &RouteGraphServer::GetAgentPotentialRoutes, this);
+  }
+}
+
+bool RouteGraphServer::GetRoute(planning_srvs::RoutePlanService::Request &req,
+                                planning_srvs::RoutePlanService::Response &res) {
+  if (!route_graph_.IsLoaded() || route_graph_.NumSpawnPoints() == 0) {
+    return false;
+  }
+  const auto begin = std::chrono::steady_clock::now();
+  // the carla frame is the ros frame mirrored in y
+  const uint32_t start_waypoint = route_graph_.Localize(req.start_pose.position.x, -req.start_pose.position.y,
+                                                        req.start_pose.position.z + 2.0);
+  std::uniform_int_distribution<size_t> spawn_point_distribution(0, route_graph_.NumSpawnPoints() - 1);
+  const auto &goal = route_graph_.spawn_point(spawn_point_distribution(random_engine_));
+  std::vector<RoutePoint> raw_route;
+  if (!route_graph_.TraceRoute(start_waypoint, {goal.x, goal.y, goal.z}, &raw_route)) {
+    ROS_WARN("[RouteGraphServer::GetRoute], no route to the spawn point x: %lf, y: %lf", goal.x, -goal.y);
+    return false;
+  }
+  std::vector<uint32_t> previous_waypoints;
+  route_graph_.PreviousUntilEdgeStart(start_waypoint, &previous_waypoints);
+  std::vector<RoutePoint> route;
+  route.reserve(previous_waypoints.size() + raw_route.size());
+  for (const uint32_t waypoint : previous_waypoints) {
+    route.push_back({waypoint, kLaneFollow});
+  }
+  route.insert(route.end(), raw_route.begin(), raw_route.end());
+
+  const RouteGraphWaypoint *last_waypoint = nullptr;
+  for (const auto &point : route) {
+    const auto &waypoint = route_graph_.waypoint(point.waypoint);
+    if (last_waypoint != nullptr
+        && std::hypot(waypoint.x - last_waypoint->x, waypoint.y - last_waypoint->y) < kMinWaypointGap) {
+      last_waypoint = &waypoint;
+      continue;
+    }
+    res.route.way_points.push_back(ToPlanningWayPoint(waypoint, point.road_option));
+    last_waypoint = &waypoint;
+  }
+  ROS_INFO("[RouteGraphServer::GetRoute], the route length is %zu, found in %lf s", res.route.way_points.size(),
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  return true;
+}
+
+void RouteGraphServer::AddNeighbourPotentialPaths(uint32_t waypoint, bool is_right,
+                                                  std::vector<std::vector<uint32_t>> *paths) const {
+  const auto &wp = route_graph_.waypoint(waypoint);
+  const bool is_allowed = wp.lane_change == planning_msgs::LaneChangeType::BOTH
+      || wp.lane_change == (is_right ? planning_msgs::LaneChangeType::RIGHT : planning_msgs::LaneChangeType::LEFT);
+  if (!is_allowed || !(is_right ? wp.has_right_lane : wp.has_left_lane)) {
+    return;
+  }
+  // the right of the heading in the carla frame, which is left handed
+  const double yaw = wp.yaw * M_PI / 180.0;
+  const double offset = 0.5 * (wp.lane_width + (is_right ? wp.right_lane_width : wp.left_lane_width))
+      * (is_right ? 1.0 : -1.0);
+  const uint32_t neighbour = route_graph_.Localize(wp.x - offset * std::sin(yaw), wp.y + offset * std::cos(yaw),
+                                                   wp.z);
+  if (route_graph_.waypoint(neighbour).edge == wp.edge) {
+    return;
+  }
+  std::vector<std::vector<uint32_t>> neighbour_paths;
+  route_graph_.GetPotentialPaths(neighbour, &neighbour_paths);
+  paths->insert(paths->end(), neighbour_paths.begin(), neighbour_paths.end());
+}
+
+bool RouteGraphServer::GetAgentPotentialRoutes(planning_srvs::AgentRouteService::Request &req,
+                                               planning_srvs::AgentRouteService::Response &res) {
+  if (!route_graph_.IsLoaded()) {
+    return false;
+  }
+  const auto object = objects_.find(req.actor_id);
+  if (object == objects_.end()) {
+    ROS_WARN("[RouteGraphServer::GetAgentPotentialRoutes], actor %d not valid", req.actor_id);
+    return true;
+  }
+  const auto &position = object->second.pose.position;
+  const uint32_t waypoint = route_graph_.Localize(position.x, -position.y, position.z);
+  std::vector<std::vector<uint32_t>> paths;
+  route_graph_.GetPotentialPaths(waypoint, &paths);
+  AddNeighbourPotentialPaths(waypoint, true, &paths);
+  AddNeighbourPotentialPaths(waypoint, false, &paths);
+  for (const auto &path : paths) {
+    planning_msgs::Lane lane;
+    lane.way_points.reserve(path.size());
+    for (const uint32_t path_waypoint : path) {
+      lane.way_points.push_back(ToPlanningWayPoint(route_graph_.waypoint(path_waypoint), kLaneFollow));
+    }
+    res.lanes.push_back(lane);
+  }
+  return true;
+}
+
+planning_msgs::WayPoint RouteGraphServer::ToPlanningWayPoint(const RouteGraphWaypoint &waypoint,
+                                                             int8_t road_option) const {
+  planning_msgs::WayPoint way_point;
+  way_point.pose.position.x = waypoint.x;
+  way_point.pose.position.y = -waypoint.y;
+  way_point.pose.position.z = waypoint.z;
+  way_point.pose.orientation = tf::createQuaternionMsgFromYaw(-waypoint.yaw * M_PI / 180.0);
+  way_point.road_id = waypoint.road_id;
+  way_point.section_id = waypoint.section_id;
+  way_point.lane_id = waypoint.lane_id;
+  way_point.is_junction = waypoint.is_junction;
+  way_point.has_value = true;
+  way_point.has_left_lane = waypoint.has_left_lane;
+  way_point.left_lane_width = waypoint.left_lane_width;
+  way_point.has_right_lane = waypoint.has_right_lane;
+  way_point.right_lane_width = waypoint.right_lane_width;
+  way_point.lane_width = waypoint.lane_width;
+  way_point.lane_type.type = waypoint.lane_type;
+  way_point.lane_change.type = waypoint.lane_change;
+  way_point.road_option.option = ToCarlaRoadOption(road_option);
+  if (waypoint.is_junction) {
+    way_point.junction.id = waypoint.junction_id;
+    way_point.junction.bounding_box.location.x = waypoint.junction_location[0];
+    way_point.junction.bounding_box.location.y = -waypoint.junction_location[1];
+    way_point.junction.bounding_box.location.z = waypoint.junction_location[2];
+    way_point.junction.bounding_box.extent.x = waypoint.junction_extent[0];
+    way_point.junction.bounding_box.extent.y = waypoint.junction_extent[1];
+    way_point.junction.bounding_box.extent.z = waypoint.junction_extent[2];
+  }
+  way_point.s = waypoint.s;
+  return way_point;
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_SRC_ROUTE_GRAPH_SERVER_HPP_
+#define CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_SRC_ROUTE_GRAPH_SERVER_HPP_
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ros/ros.h>
+#include <carla_msgs/CarlaWorldInfo.h>
+#include <derived_object_msgs/ObjectArray.h>
+#include <planning_msgs/Lane.h>
+#include <planning_msgs/WayPoint.h>
+#include <planning_srvs/AgentRouteService.h>
+#include <planning_srvs/RoutePlanService.h>
+#include "route_graph/route_graph.hpp"
+
+namespace route_graph {
+
+/**
+ * @brief: serves the route and the agent potential routes services of the carla client interface from the route
+ * graph file of the current town. the file is written by the carla client interface the first time it runs on a
+ * town, so the server waits for it and only advertises the services once it is loaded.
+ */
+class RouteGraphServer {
+ public:
+  explicit RouteGraphServer(const ros::NodeHandle &nh);
+
+  void Launch();
+
+ private:
+  void WorldInfoCallback(const carla_msgs::CarlaWorldInfo::ConstPtr &world_info);
+
+  void ObjectsCallback(const derived_object_msgs::ObjectArray::ConstPtr &object_array);
+
+  /**
+   * @brief: load the route graph file of the current town and advertise the services once it is loaded
+   */
+  void TryLoad(const ros::TimerEvent &);
+
+  /**
+   * @brief: a route from the start pose to a random spawn point, as ClinetInterface._get_route
+   */
+  bool GetRoute(planning_srvs::RoutePlanService::Request &req, planning_srvs::RoutePlanService::Response &res);
+
+  /**
+   * @brief: the potential routes of an agent on its lane and the lanes it may change to
+   */
+  bool GetAgentPotentialRoutes(planning_srvs::AgentRouteService::Request &req,
+                               planning_srvs::AgentRouteService::Response &res);
+
+  /**
+   * @brief: the potential paths of the lane next to waypoint, on the right if is_right, the left otherwise
+   */
+  void AddNeighbourPotentialPaths(uint32_t waypoint, bool is_right,
+                                  std::vector<std::vector<uint32_t>> *paths) const;
+
+  planning_msgs::WayPoint ToPlanningWayPoint(const RouteGraphWaypoint &waypoint, int8_t road_option) const;
+
+ private:
+  ros::NodeHandle nh_;
+  std::string route_graph_directory_;
+  std::string route_graph_file_;
+  RouteGraph route_graph_;
+  ros::Subscriber world_info_subscriber_;
+  ros::Subscriber objects_subscriber_;
+  ros::Timer load_timer_;
+  ros::ServiceServer route_service_;
+  ros::ServiceServer agent_potential_routes_service_;
+  std::unordered_map<int, derived_object_msgs::Object> objects_;
+  std::mt19937 random_engine_;
+};
+
+}
+#endif //CATKIN_WS_SRC_MOTION_PLANNING_WITH_CARLA_ROUTE_GRAPH_SRC_ROUTE_GRAPH_SERVER_HPP_
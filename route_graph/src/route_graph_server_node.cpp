@@ -0,0 +1,10 @@
+#include <ros/ros.h>
+#include "route_graph_server.hpp"
+#include <memory>
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "route_graph_server");
+  ros::NodeHandle nh;
+  auto server = std::make_unique<route_graph::RouteGraphServer>(nh);
+  server->Launch();
+  return 0;
+}